@@ -16,23 +16,41 @@ setup(
                 "src/compresso/csrc/registry.c",
                 "src/compresso/csrc/strategy.c",
                 "src/compresso/csrc/archives.c",
+                "src/compresso/csrc/catalog.c",
                 "src/compresso/csrc/validate.c",
+                "src/compresso/csrc/threadpool.c",
+                "src/compresso/csrc/context.c",
+                "src/compresso/csrc/context_objects.c",
+                "src/compresso/csrc/dictionary.c",
+                "src/compresso/csrc/checksum.c",
+                "src/compresso/csrc/fileio.c",
+                "src/compresso/csrc/batch.c",
+                "src/compresso/csrc/aio.c",
+                "src/compresso/csrc/benchmark.c",
+                "src/compresso/csrc/progress.c",
+                "src/compresso/csrc/cancel.c",
+                "src/compresso/csrc/stats.c",
+                "src/compresso/csrc/deflate_accel.c",
                 # Compression algorithms
+                "src/compresso/csrc/compression/stream_io.c",
                 "src/compresso/csrc/compression/py_zlib.c",
                 "src/compresso/csrc/compression/py_bzip2.c",
                 "src/compresso/csrc/compression/py_lzma.c",
                 "src/compresso/csrc/compression/py_zstd.c",
                 "src/compresso/csrc/compression/py_lz4.c",
                 "src/compresso/csrc/compression/py_snappy.c",
+                "src/compresso/csrc/compression/py_stored.c",
                 # Archive backends
                 "src/compresso/csrc/archives/tar.c",
                 "src/compresso/csrc/archives/zip.c",
+                "src/compresso/csrc/archives/cdar.c",
                 # Standalone formats
                 "src/compresso/csrc/standalone/gzip.c",
                 "src/compresso/csrc/standalone/bzip2.c",
                 "src/compresso/csrc/standalone/xz.c",
                 "src/compresso/csrc/standalone/zstd.c",
                 "src/compresso/csrc/standalone/lz4.c",
+                "src/compresso/csrc/standalone/frames.c",
                 "src/compresso/csrc/standalone/registry.c",
             ],
             include_dirs=[
@@ -42,7 +60,19 @@ setup(
             library_dirs=[
                 "/usr/local/opt/libarchive/lib",
             ],
-            libraries=["z", "bz2", "lzma", "zstd", "lz4", "snappy", "zip", "archive"],
+            libraries=[
+                "z",
+                "bz2",
+                "lzma",
+                "zstd",
+                "lz4",
+                "snappy",
+                "zip",
+                "archive",
+                "pthread",
+                "dl",
+                "m",
+            ],
         )
     ],
     python_requires=">=3.9",
@@ -1,16 +1,50 @@
 """Initialise the compressor package."""
 
-from ._core import BackendError, Error, HeaderError, compress_file, decompress_file
+from ._core import (
+    AsyncQueue,
+    BackendError,
+    CancelledError,
+    CancelToken,
+    Compressor,
+    CompressorStream,
+    Decompressor,
+    DecompressorStream,
+    Dictionary,
+    Error,
+    HeaderError,
+    Progress,
+    compress_bound,
+    compress_bytes,
+    compress_file,
+    compress_into,
+    compress_many,
+    decompress_bytes,
+    decompress_file,
+    decompress_into,
+    decompress_many,
+    decompress_range,
+    get_stats,
+    io_engines,
+    reset_stats,
+    train_dictionary,
+    verify_file,
+)
 from .backend.benchmark import benchmark_file, print_results
 from .backend.capabilities import list_capabilities
-from .backend.file_inspect import InspectResult, inspect
-from .backend.speeds import get_estimated_speeds
+from .backend.file_inspect import InspectResult, VerifyResult, inspect, verify
+from .backend.speeds import (
+    get_estimated_speeds,
+    load_calibration,
+    record_calibration,
+)
 from .frontend.api import (
     CompressionJob,
     CompressionOptions,
     CompressionPlan,
     DecompressionJob,
     DecompressionPlan,
+    acompress,
+    adecompress,
 )
 from .frontend.archive_api import (
     ArchiveEntry,
@@ -19,20 +53,47 @@ from .frontend.archive_api import (
     ArchivePlan,
     ExtractJob,
     ExtractPlan,
+    acreate_archive,
 )
 
 __all__: list[str] = [
     "compress_file",
     "decompress_file",
+    "decompress_range",
+    "verify_file",
+    "compress_many",
+    "decompress_many",
+    "io_engines",
+    "get_stats",
+    "reset_stats",
+    "compress_bytes",
+    "decompress_bytes",
+    "compress_into",
+    "decompress_into",
+    "compress_bound",
+    "Compressor",
+    "Decompressor",
+    "CompressorStream",
+    "DecompressorStream",
+    "Dictionary",
+    "Progress",
+    "CancelToken",
+    "AsyncQueue",
+    "train_dictionary",
     "Error",
     "HeaderError",
     "BackendError",
+    "CancelledError",
     "benchmark_file",
     "print_results",
     "list_capabilities",
     "inspect",
     "InspectResult",
+    "verify",
+    "VerifyResult",
     "get_estimated_speeds",
+    "load_calibration",
+    "record_calibration",
     "CompressionOptions",
     "CompressionPlan",
     "DecompressionPlan",
@@ -44,4 +105,7 @@ __all__: list[str] = [
     "ArchiveEntry",
     "ArchiveJob",
     "ExtractJob",
+    "acompress",
+    "adecompress",
+    "acreate_archive",
 ]
@@ -1,5 +1,11 @@
 """Type stubs for the _core C extension module."""
 
+from collections.abc import Callable, Sequence
+from os import PathLike
+from typing import Any
+
+from typing_extensions import Buffer
+
 class Error(Exception):
     """Base error for compression operations."""
 
@@ -15,26 +21,407 @@ class BackendError(Error):
 
     pass
 
+class CancelledError(Error):
+    """A native call was stopped through its CancelToken."""
+
+    pass
+
+class Progress:
+    """Byte counter advanced by native calls while they stream.
+
+    Pass one as progress= and poll `done` from another thread: it counts
+    the input bytes consumed so far (compressed bytes when decompressing).
+    """
+
+    done: int
+    def __init__(self) -> None: ...
+    def reset(self) -> None:
+        """Set the counter back to zero."""
+        ...
+
+class CancelToken:
+    """Cancellation flag and deadline checked by native calls while they stream.
+
+    Pass one as cancel= and call cancel() from any thread, or give it a
+    timeout: the call stops at its next chunk, removes its partial output
+    and raises CancelledError. A token stays tripped once it has.
+    """
+
+    cancelled: bool
+    expired: bool
+    def __init__(self, timeout: float | None = ...) -> None: ...
+    def cancel(self) -> None:
+        """Stop the calls using this token at their next chunk."""
+        ...
+
+    def set_timeout(self, timeout: float | None) -> None:
+        """Move the deadline to timeout seconds from now (None = no deadline)."""
+        ...
+
+class AsyncQueue:
+    """Native worker pool whose completions wake an event loop.
+
+    submit() runs a native call on a worker and returns its ticket; when
+    it finishes, fileno() turns readable and completed() hands back its
+    outcome. No Python thread waits on a call while it runs.
+    """
+
+    pending: int
+    def __init__(self, threads: int = ...) -> None: ...
+    def submit(self, call: Callable[..., Any], /, *args: Any, **kwargs: Any) -> int:
+        """Run call(*args, **kwargs) on a native worker; returns its ticket."""
+        ...
+
+    def completed(self) -> list[tuple[int, Any, BaseException | None]]:
+        """(ticket, result, error) of each call finished since the last call."""
+        ...
+
+    def fileno(self) -> int:
+        """Descriptor that turns readable when a call finishes."""
+        ...
+
+    def close(self) -> None:
+        """Stop taking calls and wait for the ones in flight."""
+        ...
+
+class Dictionary:
+    """Compression dictionary shared by compression and decompression."""
+
+    id: int
+    data: bytes
+
+    def __init__(self, data: Buffer) -> None: ...
+
+def train_dictionary(
+    samples: Sequence[Buffer], size: int = ..., algo: str = ...
+) -> Dictionary:
+    """Train a dictionary of at most `size` bytes from many small samples."""
+    ...
+
 def compress_file(
     src_path: str,
     dst_path: str,
     algo: str,
     strategy: str,
     level: int,
+    threads: int = ...,
+    seekable: bool = ...,
+    block_size: int = ...,
+    dictionary: Dictionary | None = ...,
+    checksum: bool = ...,
+    io_chunk_size: int = ...,
+    io_engine: str | None = ...,
+    progress: Progress | None = ...,
+    cancel: CancelToken | None = ...,
+    long_distance: bool = ...,
+    window_log: int = ...,
+    match_strategy: int = ...,
+    stats: dict[str, int] | None = ...,
 ) -> int:
-    """Compress a file using the specified algorithm and strategy."""
+    """Compress a file; threads != 1 enables parallel compression (0 = all CPUs).
+
+    strategy="auto" (without an algo) picks a backend per block, storing
+    incompressible blocks raw, and always writes a seekable file. So does
+    an input with holes: they, and any block of zeros in a seekable file,
+    are recorded in the index instead of compressed.
+    A budget strategy ("target_mb_s=500", "max_ratio_within=2s") picks the
+    backend and, unless given, the level and thread count (up to `threads`)
+    with the best calibrated ratio that meets it (see choose_for_budget).
+    checksum=True stores an XXH64 of the input that decompression checks;
+    block-split files ignore it, as every block already has a CRC-32.
+    io_chunk_size sets the bytes per read/write of the streaming loops
+    (64 KiB to 16 MiB; 0 = 64 KiB); other values raise ValueError.
+    io_engine="uring" overlaps that I/O with compression through io_uring
+    where the kernel allows it, and otherwise behaves like "stdio";
+    "threads" reads ahead and writes behind on two helper threads.
+    long_distance, window_log and match_strategy tune zstd beyond the level
+    for single-stream files (ValueError otherwise); window_log is recorded
+    in the header so decompression accepts the wider window.
+    stats, a dict, is filled with the call's wall_ns, codec_ns (wall time
+    less I/O waits), read_ns, write_ns, reads, writes, bytes_in and
+    bytes_out.
+    """
     ...
 
 def decompress_file(
     src_path: str,
     dst_path: str,
     algo: str,
+    threads: int = ...,
+    dictionary: Dictionary | None = ...,
+    io_chunk_size: int = ...,
+    io_engine: str | None = ...,
+    progress: Progress | None = ...,
+    cancel: CancelToken | None = ...,
+    stats: dict[str, int] | None = ...,
 ) -> int:
-    """Decompress a file."""
+    """Decompress a file; seekable files decode blocks on `threads` workers.
+
+    Holes and runs of zeros in the output are left as holes where the
+    filesystem supports them. stats is filled as for compress_file.
+    """
     ...
 
+def decompress_range(
+    path: str,
+    offset: int,
+    length: int,
+    threads: int = ...,
+    dictionary: Dictionary | None = ...,
+) -> bytes:
+    """Decompress `length` bytes at `offset` of a seekable file."""
+    ...
+
+def verify_file(
+    path: str,
+    threads: int = ...,
+    dictionary: Dictionary | None = ...,
+    io_chunk_size: int = ...,
+    io_engine: str | None = ...,
+    progress: Progress | None = ...,
+    cancel: CancelToken | None = ...,
+) -> None:
+    """Decode a file without writing output; raises Error if it is corrupt."""
+    ...
+
+def compress_many(
+    pairs: Sequence[tuple[str | PathLike[str], str | PathLike[str]]],
+    algo: str = ...,
+    strategy: str = ...,
+    level: int = ...,
+    threads: int = ...,
+    seekable: bool = ...,
+    block_size: int = ...,
+    dictionary: Dictionary | None = ...,
+    checksum: bool = ...,
+    io_chunk_size: int = ...,
+    io_engine: str | None = ...,
+    progress: Progress | None = ...,
+    cancel: CancelToken | None = ...,
+    long_distance: bool = ...,
+    window_log: int = ...,
+    match_strategy: int = ...,
+) -> list[Exception | None]:
+    """Compress every (src_path, dst_path) pair, `threads` files at a time.
+
+    The files run side by side on native workers (0 = one per CPU), each
+    single-threaded; options are as for compress_file. Returns one entry
+    per pair: None on success, or the exception that file raised (a
+    CancelledError for each file cut short or never started once `cancel`
+    trips).
+    """
+    ...
+
+def decompress_many(
+    pairs: Sequence[tuple[str | PathLike[str], str | PathLike[str]]],
+    algo: str = ...,
+    threads: int = ...,
+    dictionary: Dictionary | None = ...,
+    io_chunk_size: int = ...,
+    io_engine: str | None = ...,
+    progress: Progress | None = ...,
+    cancel: CancelToken | None = ...,
+) -> list[Exception | None]:
+    """Decompress every (src_path, dst_path) pair, `threads` files at a time.
+
+    Returns one entry per pair: None on success, or the exception raised.
+    """
+    ...
+
+def compress_bytes(
+    data: Buffer,
+    algo: str = ...,
+    strategy: str = ...,
+    level: int = ...,
+    dictionary: Dictionary | None = ...,
+) -> bytes:
+    """Compress a bytes-like object into a frame readable by decompress_bytes."""
+    ...
+
+def compress_bound(size: int, algo: str = ..., strategy: str = ...) -> int:
+    """Get the output buffer size that always suffices for compress_into."""
+    ...
+
+def compress_into(
+    data: Buffer,
+    out: Buffer,
+    algo: str = ...,
+    strategy: str = ...,
+    level: int = ...,
+    dictionary: Dictionary | None = ...,
+) -> int:
+    """Compress into a writable buffer; returns the number of bytes written."""
+    ...
+
+def decompress_bytes(
+    data: Buffer, algo: str = ..., dictionary: Dictionary | None = ...
+) -> bytes:
+    """Decompress a frame produced by compress_bytes (or a v1 file's bytes)."""
+    ...
+
+def decompress_into(
+    data: Buffer,
+    out: Buffer,
+    algo: str = ...,
+    dictionary: Dictionary | None = ...,
+) -> int:
+    """Decompress into a writable buffer; returns the number of bytes written."""
+    ...
+
+def benchmark(
+    data: Buffer,
+    algo: str = ...,
+    strategy: str = ...,
+    level: int = ...,
+    repeats: int = ...,
+    warmup: int = ...,
+    threads: int = ...,
+) -> dict[str, Any]:
+    """Time the backend's buffer calls on data in memory.
+
+    Each direction runs `warmup` untimed calls, then `repeats` timed calls on
+    each of `threads` workers (0 = one per CPU). The result holds the backend
+    used, the sizes, and for "compress" and "decompress" the per-call min,
+    median, p99 and mean, the user and system CPU seconds per call, and the
+    wall time of the timed calls, all in seconds.
+    """
+    ...
+
+def set_calibration(entries: Sequence[dict[str, Any]]) -> None:
+    """Replace the measured speeds budget strategies choose from.
+
+    Each entry holds "algo", "comp_mb_s" and "ratio", and optionally "level"
+    (-1 = the backend's default), "threads" (1) and "decomp_mb_s". An empty
+    sequence restores the built-in estimates.
+    """
+    ...
+
+def get_calibration() -> list[dict[str, Any]]:
+    """Return the speeds budget strategies choose from."""
+    ...
+
+def choose_for_budget(strategy: str, size: int, threads: int = ...) -> dict[str, Any]:
+    """Return what a budget strategy picks for `size` bytes on up to `threads`.
+
+    "target_mb_s=N" asks for at least N MB/s of compression, and
+    "max_ratio_within=T" (T in seconds, or with an "s" or "ms" unit) for the
+    whole input within T. The result is the calibration entry with the best
+    ratio that meets the budget, its comp_mb_s scaled to this input, plus
+    "estimated_seconds" and "meets_budget". When nothing meets it the
+    fastest entry is returned with meets_budget False.
+    """
+    ...
+
+def get_stats() -> dict[str, Any]:
+    """Return the process-wide counters, which are always on.
+
+    "backends" maps each available backend, and "formats" each file
+    format, to "compress" and "decompress" counters: calls, bytes_in,
+    bytes_out and codec_ns, plus contexts (codec contexts and stream states
+    created) for backends and errors, wall_ns, read_ns and write_ns for
+    formats. Backend codec_ns is time inside the codec; a stream's is its
+    run less the time spent waiting on reads and writes. "io" totals those
+    waits (reads, read_bytes, read_ns, writes, write_bytes, write_ns), and
+    "memory" has the bytes of I/O buffers live now and at most
+    (buffer_bytes, peak_buffer_bytes). Memory-mapped input and output
+    count as codec time, not I/O.
+    """
+    ...
+
+def reset_stats() -> None:
+    """Zero the get_stats counters; the peak restarts from the live bytes."""
+    ...
+
+class Compressor:
+    """Reusable compression context for one backend."""
+
+    algo: str | None
+
+    def __init__(
+        self,
+        algo: str = ...,
+        strategy: str = ...,
+        level: int = ...,
+        dictionary: Dictionary | None = ...,
+    ) -> None: ...
+    def compress(self, data: Buffer) -> bytes:
+        """Compress into a new frame, reusing this object's native context."""
+        ...
+
+    def compress_into(self, data: Buffer, out: Buffer) -> int:
+        """Compress into a writable buffer; returns the number of bytes written."""
+        ...
+
+class Decompressor:
+    """Reusable decompression context; binds to each frame's backend."""
+
+    algo: str | None
+
+    def __init__(
+        self, algo: str = ..., dictionary: Dictionary | None = ...
+    ) -> None: ...
+    def decompress(self, data: Buffer) -> bytes:
+        """Decompress a frame, reusing this object's native context."""
+        ...
+
+    def decompress_into(self, data: Buffer, out: Buffer) -> int:
+        """Decompress into a writable buffer; returns the number of bytes written."""
+        ...
+
+class CompressorStream:
+    """Incremental compressor producing a raw backend stream."""
+
+    algo: str | None
+    finished: bool
+
+    def __init__(
+        self,
+        algo: str = ...,
+        strategy: str = ...,
+        level: int = ...,
+        dictionary: Dictionary | None = ...,
+    ) -> None: ...
+    def feed(self, data: Buffer) -> bytes:
+        """Compress a chunk and return whatever output is ready."""
+        ...
+
+    def flush(self) -> bytes:
+        """Return output that makes everything fed so far decodable.
+
+        bzip2 decoders only release a flushed block once the next one begins.
+        """
+        ...
+
+    def finish(self) -> bytes:
+        """End the stream and return the remaining output."""
+        ...
+
+class DecompressorStream:
+    """Incremental decompressor for a raw backend stream."""
+
+    algo: str | None
+    eof: bool
+
+    def __init__(self, algo: str, dictionary: Dictionary | None = ...) -> None: ...
+    def feed(self, data: Buffer) -> bytes:
+        """Decompress a chunk and return whatever output is ready."""
+        ...
+
+    def finish(self) -> bytes:
+        """Return the remaining output; raises Error if the stream is truncated."""
+        ...
+
 def get_capabilities() -> list[tuple[str, int, bool, bool]]:
-    """Get list of available compression backends."""
+    """Get list of available compression backends.
+
+    Each entry also names the library its buffer calls run on
+    ("implementation"), e.g. "libdeflate" for zlib when the system has it.
+    """
+    ...
+
+def io_engines() -> list[str]:
+    """List the I/O engines this system can run ("stdio", "threads", and
+    "uring" on Linux)."""
     ...
 
 def get_default_backend_for_strategy(strategy: str) -> str:
@@ -46,18 +433,62 @@ def create_archive(
     format: str,
     input_paths: list[str],
     compression_level: int = ...,
+    threads: int = ...,
+    base: str | None = ...,
+    cancel: CancelToken | None = ...,
+    catalog: bool = ...,
 ) -> None:
-    """Create an archive from the given input paths in the given format."""
+    """Create an archive; threads != 1 compresses in parallel (0 = all CPUs).
+
+    For the cdar format, base names an earlier cdar archive whose chunks are
+    referenced rather than stored again, making the new archive incremental.
+    For tar, catalog also writes `<output_path>.catalog`, which listings read
+    instead of the archive, and which lets a plain tar's entries be
+    extracted by seeking to them.
+    """
     ...
 
 def extract_archive(
     archive_path: str,
     output_dir: str,
     files: list[str] = ...,
+    threads: int = ...,
+    cancel: CancelToken | None = ...,
 ) -> int:
-    """Extract an archive to output_dir, optionally selecting specific files."""
+    """Extract an archive to output_dir; threads != 1 writes files in parallel.
+
+    When `cancel` trips, the entries already written are kept and the one
+    in progress is removed.
+    """
     ...
 
 def list_archive_contents(archive_path: str) -> list[str]:
     """List the entry paths contained in an archive."""
     ...
+
+def list_archive_entries(archive_path: str) -> list[dict[str, Any]]:
+    """List an archive's entries with their metadata, in archive order.
+
+    Each entry is a dict with path, type ("file", "dir", "symlink" or
+    "special"), size, mtime (seconds), mode and link_target. A tar's current
+    catalog is read instead of the archive; zip is read from its central
+    directory.
+    """
+    ...
+
+def convert_archive(
+    input_path: str,
+    output_path: str,
+    format: str,
+    compression_level: int = ...,
+    threads: int = ...,
+    cancel: CancelToken | None = ...,
+) -> None:
+    """Re-pack an archive as `format` (e.g. "tar.gz" to "tar.zst") in one pass.
+
+    A codec change on the same archive type streams the decoded archive
+    straight into the new codec; other conversions copy entry by entry with
+    no extraction in between. threads != 1 compresses in parallel where the
+    codec can (0 = all CPUs).
+    """
+    ...
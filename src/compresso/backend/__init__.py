@@ -2,8 +2,8 @@
 
 from .benchmark import benchmark_file, print_results
 from .capabilities import list_capabilities
-from .file_inspect import InspectResult, inspect
-from .speeds import get_estimated_speeds
+from .file_inspect import InspectResult, VerifyResult, inspect, verify
+from .speeds import get_estimated_speeds, load_calibration, record_calibration
 
 __all__: list[str] = [
     "benchmark_file",
@@ -11,5 +11,9 @@ __all__: list[str] = [
     "list_capabilities",
     "inspect",
     "InspectResult",
+    "verify",
+    "VerifyResult",
     "get_estimated_speeds",
+    "load_calibration",
+    "record_calibration",
 ]
@@ -2,16 +2,13 @@
 
 from __future__ import annotations
 
-import os
-import tempfile
-import time
-from dataclasses import dataclass
+from dataclasses import dataclass, field
 from pathlib import Path
 from typing import Iterable
 
 from tabulate import tabulate
 
-from .._core import compress_file, decompress_file
+from .._core import benchmark, compress_file, decompress_file
 from .speeds import update_from_benchmarks
 
 
@@ -72,6 +69,11 @@ class BenchmarkResult:
         decompress_time: Time taken to decompress the file (in seconds)
         input_size: Size of the input file (in bytes)
         compressed_size: Size of the compressed file (in bytes)
+        compress_stats: The native engine's compression timings (min, median,
+            p99, mean, user and system CPU seconds per call, and wall time),
+            if the result came from it
+        decompress_stats: The same for decompression
+        threads: Number of workers the calls were timed on side by side
     """
 
     algo: str
@@ -81,6 +83,9 @@ class BenchmarkResult:
     decompress_time: float
     input_size: int
     compressed_size: int
+    compress_stats: dict[str, float] | None = field(default=None, repr=False)
+    decompress_stats: dict[str, float] | None = field(default=None, repr=False)
+    threads: int = 1
 
     @property
     def ratio(self) -> float:
@@ -118,19 +123,6 @@ class BenchmarkResult:
         )
 
 
-def _safe_unlink(path: Path) -> None:
-    """Remove a file if it exists
-
-    Args:
-        path: Path to the file to remove
-    """
-    try:
-        path.unlink()
-
-    except FileNotFoundError:
-        pass
-
-
 def benchmark_file(
     src: str | Path,
     *,
@@ -140,16 +132,25 @@ def benchmark_file(
     repeats: int = 1,
     temp_dir: str | Path | None = None,
     update_cache: bool = False,
+    warmup: int = 1,
+    threads: int = 1,
 ) -> list[BenchmarkResult]:
     """Benchmark compression and decompression on a single file
 
+    The file is read once and every combination is timed in memory by the
+    native benchmark engine (see ``_core.benchmark``), so the figures are the
+    codecs' own rather than the file system's. Times are the median per call.
+
     Args:
         src: Path to the source file to benchmark
         algos: List of algorithms to benchmark. If None, all available algorithms are used.
         strategies: List of strategies to benchmark. If None, all available strategies are used.
         levels: List of compression levels to benchmark. If None, default levels are used.
-        repeats: Number of times to repeat each benchmark for averaging
-        temp_dir: Directory to use for temporary files. If None, system temp directory is used.
+        repeats: Number of timed calls per direction and worker
+        temp_dir: Unused, as nothing is written to disk; kept for compatibility
+        update_cache: If True, update the speed estimates cache with the results
+        warmup: Number of untimed calls before the timed ones
+        threads: Number of workers timing calls side by side (0 = one per CPU)
 
     Returns:
         List of BenchmarkResult objects with the results
@@ -158,9 +159,6 @@ def benchmark_file(
     if not src.is_file():
         raise FileNotFoundError(f"Source file {src} does not exist or is not a file")
 
-    if temp_dir is None:
-        temp_dir = Path(os.getenv(key="TMPDIR", default="/tmp"))
-
     if algos is None:
         algos: list[str] = ["zlib", "bzip2", "lzma", "zstd", "lz4", "snappy"]
 
@@ -170,84 +168,34 @@ def benchmark_file(
     if levels is None:
         levels: list[int | None] = [None, 1, 3, 6, 9]
 
-    temp_base: Path = Path(temp_dir) if temp_dir else src.parent
-    input_size: int = src.stat().st_size
-
+    data: bytes = src.read_bytes()
     results: list[BenchmarkResult] = []
 
     for algo in algos:
         for strategy in strategies:
             for level in levels:
-                comp_times: list[float] = []
-                decomp_times: list[float] = []
-                compressed_size: int | None = None
-
-                for _ in range(repeats):
-                    with (
-                        tempfile.NamedTemporaryFile(
-                            suffix=".comp", dir=temp_base, delete=False
-                        ) as comp_file,
-                        tempfile.NamedTemporaryFile(
-                            suffix=".decomp", dir=temp_base, delete=False
-                        ) as decomp_file,
-                    ):
-                        comp_path = Path(comp_file.name)
-                        decomp_path = Path(decomp_file.name)
-
-                        # Compression
-                        start_time: float = time.perf_counter()
-                        compress(
-                            src_path=str(object=src),
-                            dest_path=str(object=comp_path),
-                            algo=algo,
-                            strategy=strategy,
-                            level=level,
-                        )
-                        comp_times.append(time.perf_counter() - start_time)
-
-                        if compressed_size is None:
-                            compressed_size: int = comp_path.stat().st_size
-
-                        else:
-                            sz: int = comp_path.stat().st_size
-                            if sz != compressed_size:
-                                print(
-                                    f"Warning: Compressed size changed between runs: {compressed_size} vs {sz}"
-                                )
-                                compressed_size: int = sz
-
-                        # Decompression
-                        start_time: float = time.perf_counter()
-                        decompress(
-                            src_path=str(object=comp_path),
-                            dest_path=str(object=decomp_path),
-                        )
-                        decomp_times.append(time.perf_counter() - start_time)
-
-                        # Verify
-                        if (
-                            not decomp_path.is_file()
-                            or decomp_path.stat().st_size != input_size
-                        ):
-                            print(
-                                f"Warning: Decompressed file size mismatch for {decomp_path}"
-                            )
-
-                        _safe_unlink(path=comp_path)
-                        _safe_unlink(path=decomp_path)
-
-                avg_comp_time: float = sum(comp_times) / repeats
-                avg_decomp_time: float = sum(decomp_times) / repeats
+                run: dict = benchmark(
+                    data,
+                    algo=algo or "",
+                    strategy=strategy or "",
+                    level=-1 if level is None else int(level),
+                    repeats=repeats,
+                    warmup=warmup,
+                    threads=threads,
+                )
 
                 results.append(
                     BenchmarkResult(
                         algo=algo,
                         strategy=strategy,
                         level=level,
-                        compress_time=avg_comp_time,
-                        decompress_time=avg_decomp_time,
-                        input_size=input_size,
-                        compressed_size=compressed_size or 0,
+                        compress_time=run["compress"]["median"],
+                        decompress_time=run["decompress"]["median"],
+                        input_size=run["input_size"],
+                        compressed_size=run["compressed_size"],
+                        compress_stats=run["compress"],
+                        decompress_stats=run["decompress"],
+                        threads=run["threads"],
                     )
                 )
 
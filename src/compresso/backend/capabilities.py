@@ -16,12 +16,15 @@ class BackendCapabilities:
         id: Algorithm ID.
         has_buffer: Whether the backend has a buffer.
         has_stream: Whether the backend supports streaming compression/decompression.
+        implementation: Library the buffer calls run on, picked at run time
+            (e.g. "libdeflate" for zlib when the system has it).
     """
 
     name: str
     id: int
     has_buffer: bool
     has_stream: bool
+    implementation: str = ""
 
     def is_available(self) -> bool:
         """Check if the backend is available for use
@@ -54,12 +57,14 @@ def _load_capabilities() -> None:
         cid = int(item.get("id", -1))
         has_buffer = bool(item.get("has_buffer", False))
         has_stream = bool(item.get("has_stream", False))
+        implementation = str(item.get("implementation", name))
 
         cap = BackendCapabilities(
             name=name,
             id=cid,
             has_buffer=has_buffer,
             has_stream=has_stream,
+            implementation=implementation,
         )
 
         caps.append(cap)
@@ -3,9 +3,12 @@
 from __future__ import annotations
 
 import struct
+import zlib
 from dataclasses import dataclass
 from pathlib import Path
+from typing import BinaryIO
 
+from .._core import BackendError, Dictionary, Error, HeaderError, verify_file
 from .capabilities import get_by_id
 from .speeds import get_estimated_speeds
 
@@ -13,7 +16,61 @@ COMP_HEADER_STRUCT = struct.Struct(
     "<4sBBBBQ"
 )  # magic, version, algo, level, flags, original_size
 
+COMP_DICT_ID_STRUCT = struct.Struct("<I")  # dictionary_id, when flagged
+
+COMP_CHECKSUM_STRUCT = struct.Struct("<Q")  # XXH64 of the data, when flagged
+
+COMP_WINDOW_LOG_STRUCT = struct.Struct("<B")  # log2 of the match window, when flagged
+
+COMP_INDEX_ENTRY_STRUCT = struct.Struct(
+    "<QQIIIB3x"
+)  # raw_offset, comp_offset, comp_size, raw_size, crc32, algo
+
+COMP_TRAILER_STRUCT = struct.Struct(
+    "<QIII4s"
+)  # index_offset, block_count, block_size, index_crc, magic
+
 _LEVEL_AUTO = 255  # Special value indicating 'auto' or 'unspecified' level
+_VERSION_STREAM = 1
+_VERSION_SEEKABLE = 2  # Block-indexed, supports random access
+_TRAILER_MAGIC = b"CIDX"
+_FLAG_DICTIONARY = 0x01  # A dictionary ID follows the header
+_FLAG_BLOCK_ALGO = 0x02  # Index entries name their blocks' algorithms
+_FLAG_CHECKSUM = 0x04  # An XXH64 of the original data follows
+_FLAG_WINDOW_LOG = 0x08  # The log2 of the payload's match window follows
+_FLAG_HOLES = 0x10  # Index entries with no payload are blocks of zeros
+_VERSION_FLAGS = {
+    _VERSION_STREAM: _FLAG_DICTIONARY | _FLAG_CHECKSUM | _FLAG_WINDOW_LOG,
+    _VERSION_SEEKABLE: _FLAG_DICTIONARY | _FLAG_BLOCK_ALGO | _FLAG_HOLES,
+}
+_ALGO_STORED = 0  # Block algorithm ID of a block stored raw
+
+
+@dataclass(frozen=True)
+class BlockInfo:
+    """One entry of a seekable file's block index.
+
+    Attributes:
+        raw_offset: Offset of the block in the original data.
+        comp_offset: Offset of the compressed block in the file.
+        comp_size: Compressed size of the block in bytes.
+        raw_size: Uncompressed size of the block in bytes.
+        checksum: CRC32 of the uncompressed block, 0 for a hole.
+        algo_id: Algorithm ID of the block (0 = stored raw), None when the
+            whole file uses the header's algorithm.
+    """
+
+    raw_offset: int
+    comp_offset: int
+    comp_size: int
+    raw_size: int
+    checksum: int
+    algo_id: int | None = None
+
+    @property
+    def is_hole(self) -> bool:
+        """Whether the block is all zeros and has no payload."""
+        return self.comp_size == 0
 
 
 @dataclass
@@ -35,6 +92,12 @@ class InspectResult:
         has_streaming: Whether the algorithm supports streaming.
         can_decompress: Whether the file can be decompressed with the available backends.
         estimated_decomp_s: Estimated decompression time in seconds.
+        block_size: Block size of a seekable file, None otherwise.
+        blocks: Block index of a seekable file, None otherwise.
+        dictionary_id: ID of the dictionary needed to decompress, None otherwise.
+        checksum: Stored XXH64 of the original data, None otherwise.
+        window_log: Log2 of the match window the payload was written with,
+            None when it is the level's.
     """
 
     path: Path
@@ -60,6 +123,34 @@ class InspectResult:
     can_decompress: bool
     estimated_decomp_s: float | None  # in seconds
 
+    # Block index (version 2 only)
+    block_size: int | None = None
+    blocks: list[BlockInfo] | None = None
+
+    # Dictionary (flags & _FLAG_DICTIONARY only)
+    dictionary_id: int | None = None
+
+    # Content checksum (flags & _FLAG_CHECKSUM only)
+    checksum: int | None = None
+
+    # Match window (flags & _FLAG_WINDOW_LOG only)
+    window_log: int | None = None
+
+
+@dataclass(frozen=True)
+class VerifyResult:
+    """Holds the result of verifying a compressed file.
+
+    Attributes:
+        path: The path to the compressed file.
+        ok: Whether the whole file decoded and matched its checksums.
+        reason: Why verification failed, None if it passed.
+    """
+
+    path: Path
+    ok: bool
+    reason: str | None = None
+
 
 def _failed_inspection(
     path: Path, reason: str, is_compresso: bool = False
@@ -92,6 +183,48 @@ def _failed_inspection(
     )
 
 
+def _read_block_index(
+    f: BinaryIO, file_size: int, per_block_algo: bool = False
+) -> tuple[int, list[BlockInfo]]:
+    """Read the trailer index of a seekable (version 2) file.
+
+    Args:
+        f: The open file object.
+        file_size: Size of the file in bytes.
+        per_block_algo: Whether entries carry their block's algorithm.
+
+    Returns:
+        tuple[int, list[BlockInfo]]: Block size and the block index entries.
+
+    Raises:
+        ValueError: If the trailer or index is missing or corrupt.
+    """
+    if file_size < COMP_HEADER_STRUCT.size + COMP_TRAILER_STRUCT.size:
+        raise ValueError("File too small for a block index")
+
+    f.seek(file_size - COMP_TRAILER_STRUCT.size)
+    index_offset, count, block_size, index_crc, magic = COMP_TRAILER_STRUCT.unpack(
+        f.read(COMP_TRAILER_STRUCT.size)
+    )
+    if magic != _TRAILER_MAGIC:
+        raise ValueError("Invalid block index trailer magic")
+
+    index_size: int = count * COMP_INDEX_ENTRY_STRUCT.size
+    if index_offset + index_size + COMP_TRAILER_STRUCT.size != file_size:
+        raise ValueError("Inconsistent block index trailer")
+
+    f.seek(index_offset)
+    raw: bytes = f.read(index_size)
+    if zlib.crc32(raw) != index_crc:
+        raise ValueError("Block index checksum mismatch")
+
+    blocks: list[BlockInfo] = [
+        BlockInfo(*fields[:5], algo_id=fields[5] if per_block_algo else None)
+        for fields in COMP_INDEX_ENTRY_STRUCT.iter_unpack(raw)
+    ]
+    return block_size, blocks
+
+
 def inspect(path: str | Path) -> InspectResult:
     """Inspect a compressed file and extract metadata
 
@@ -108,6 +241,11 @@ def inspect(path: str | Path) -> InspectResult:
     try:
         with path.open(mode="rb") as f:
             data: bytes = f.read(COMP_HEADER_STRUCT.size)
+            ext: bytes = f.read(
+                COMP_DICT_ID_STRUCT.size
+                + COMP_CHECKSUM_STRUCT.size
+                + COMP_WINDOW_LOG_STRUCT.size
+            )
 
     except OSError as e:
         return _failed_inspection(path, reason=f"Failed to read file: {e}")
@@ -124,9 +262,50 @@ def inspect(path: str | Path) -> InspectResult:
             path, reason="Invalid magic number", is_compresso=False
         )
 
-    if version != 1:
+    if version not in (_VERSION_STREAM, _VERSION_SEEKABLE):
         return _failed_inspection(path, reason=f"Unsupported header version: {version}")
 
+    if flags & ~_VERSION_FLAGS[version]:
+        return _failed_inspection(
+            path, reason=f"Unsupported header flags: {flags:#04x}", is_compresso=True
+        )
+
+    ext_size: int = (
+        (COMP_DICT_ID_STRUCT.size if flags & _FLAG_DICTIONARY else 0)
+        + (COMP_CHECKSUM_STRUCT.size if flags & _FLAG_CHECKSUM else 0)
+        + (COMP_WINDOW_LOG_STRUCT.size if flags & _FLAG_WINDOW_LOG else 0)
+    )
+    if len(ext) < ext_size:
+        return _failed_inspection(path, reason="Truncated header", is_compresso=True)
+
+    dictionary_id: int | None = None
+    if flags & _FLAG_DICTIONARY:
+        (dictionary_id,) = COMP_DICT_ID_STRUCT.unpack_from(ext)
+        ext = ext[COMP_DICT_ID_STRUCT.size :]
+
+    checksum: int | None = None
+    if flags & _FLAG_CHECKSUM:
+        (checksum,) = COMP_CHECKSUM_STRUCT.unpack_from(ext)
+        ext = ext[COMP_CHECKSUM_STRUCT.size :]
+
+    window_log: int | None = None
+    if flags & _FLAG_WINDOW_LOG:
+        (window_log,) = COMP_WINDOW_LOG_STRUCT.unpack_from(ext)
+
+    block_size: int | None = None
+    blocks: list[BlockInfo] | None = None
+    if version == _VERSION_SEEKABLE:
+        try:
+            with path.open(mode="rb") as f:
+                block_size, blocks = _read_block_index(
+                    f, path.stat().st_size, bool(flags & _FLAG_BLOCK_ALGO)
+                )
+
+        except (OSError, ValueError, struct.error) as e:
+            return _failed_inspection(
+                path, reason=f"Invalid block index: {e}", is_compresso=True
+            )
+
     _MAX_ORIG_SIZE = (1 << 63) - 1
 
     if orig_size > _MAX_ORIG_SIZE:
@@ -146,6 +325,16 @@ def inspect(path: str | Path) -> InspectResult:
     if not can_decompress:
         reason = "No available backend for this algorithm"
 
+    elif blocks is not None:
+        for block in blocks:
+            if block.algo_id in (None, _ALGO_STORED) or block.is_hole:
+                continue
+            block_cap = get_by_id(cid=block.algo_id)
+            if block_cap is None or not block_cap.is_available():
+                can_decompress = False
+                reason = f"No available backend for block algorithm {block.algo_id}"
+                break
+
     est_time = None
     if can_decompress and orig_size > 0:
         if algo_name is not None:
@@ -172,4 +361,36 @@ def inspect(path: str | Path) -> InspectResult:
         has_streaming=has_streaming,
         can_decompress=can_decompress,
         estimated_decomp_s=est_time,
+        block_size=block_size,
+        blocks=blocks,
+        dictionary_id=dictionary_id,
+        checksum=checksum,
+        window_log=window_log,
     )
+
+
+def verify(
+    path: str | Path, dictionary: Dictionary | None = None, threads: int = 1
+) -> VerifyResult:
+    """Check a compressed file's integrity without writing any output.
+
+    Every block of a seekable file is decoded and checked against its CRC32;
+    a single-stream file is decoded in one pass and checked against its
+    length and, when it has one, its stored checksum.
+
+    Args:
+        path: The path to the compressed file.
+        dictionary: The dictionary the file was compressed with, if any.
+        threads: Worker threads for seekable files, 0 for one per CPU.
+
+    Returns:
+        VerifyResult: The result of the verification.
+    """
+    path = Path(path)
+    try:
+        verify_file(str(object=path), threads=threads, dictionary=dictionary)
+
+    except (Error, HeaderError, BackendError, OSError, ValueError) as e:
+        return VerifyResult(path=path, ok=False, reason=str(object=e))
+
+    return VerifyResult(path=path, ok=True)
@@ -5,7 +5,9 @@ from __future__ import annotations
 import json
 from dataclasses import dataclass
 from pathlib import Path
-from typing import Iterable
+from typing import Any, Iterable
+
+from .._core import set_calibration
 
 _DEFAULT_COMP_MB_S = {
     "zlib": 200.0,
@@ -14,6 +16,7 @@ _DEFAULT_COMP_MB_S = {
     "zstd": 400.0,
     "lz4": 800.0,
     "snappy": 600.0,
+    "stored": 2000.0,
 }
 
 _DEFAULT_DECOMP_MB_S = {
@@ -23,10 +26,24 @@ _DEFAULT_DECOMP_MB_S = {
     "zstd": 500.0,
     "lz4": 900.0,
     "snappy": 700.0,
+    "stored": 2000.0,
+}
+
+# Typical compressed/original ratios on mixed data, for budget strategies
+# until a level has been measured
+_DEFAULT_RATIO = {
+    "zlib": 0.38,
+    "bzip2": 0.30,
+    "lzma": 0.27,
+    "zstd": 0.34,
+    "lz4": 0.50,
+    "snappy": 0.52,
 }
 
 _CONFIG_DIR = Path.home() / ".compresso"
 _SPEEDS_FILE = _CONFIG_DIR / "speeds.json"
+_CALIBRATION_FILE = _CONFIG_DIR / "calibration.json"
+_CALIBRATION_MAX = 256  # entries the native chooser holds
 
 
 @dataclass
@@ -158,6 +175,158 @@ def update_from_benchmarks(results: Iterable[object]) -> None:
             )
 
     _save_raw(entries=existing)
+    record_calibration(results)
+
+
+def _field(result: object, name: str, default: Any = None) -> Any:
+    """Read a field from a result object or a report's result dict."""
+    if isinstance(result, dict):
+        return result.get(name, default)
+
+    return getattr(result, name, default)
+
+
+def _load_calibration_raw() -> list[dict[str, Any]]:
+    """Load the per-level calibration entries from the calibration file.
+
+    Returns:
+        The stored entries, or an empty list if there are none.
+    """
+    if not _CALIBRATION_FILE.is_file():
+        return []
+
+    try:
+        data = json.loads(s=_CALIBRATION_FILE.read_text(encoding="utf-8"))
+
+    except (OSError, json.JSONDecodeError):
+        return []
+
+    return [entry for entry in data if isinstance(entry, dict)]
+
+
+def record_calibration(results: Iterable[object]) -> None:
+    """Merge per-level measurements into this host's calibration.
+
+    Results are benchmark results or the backend results of a suite report;
+    each is keyed by algorithm, level and thread count. Figures measured on
+    several threads at once are per stream, so the entry's throughput is
+    theirs times the thread count. The merged calibration is saved and
+    pushed into the native chooser (see load_calibration).
+
+    Args:
+        results: An iterable of benchmark results or suite result dicts.
+    """
+    merged: dict[tuple[str, int, int], dict[str, Any]] = {
+        (e["algo"], int(e["level"]), int(e["threads"])): e
+        for e in _load_calibration_raw()
+        if {"algo", "level", "threads"} <= e.keys()
+    }
+
+    changed = False
+    for result in results:
+        algo: str | None = _field(result, "algo") or _field(result, "target")
+        if not algo or _field(result, "kind", "backend") != "backend":
+            continue
+
+        level = _field(result, "level")
+        threads = int(_field(result, "threads", 1) or 1)
+        comp = float(_field(result, "comp_mb_s", 0.0) or 0.0) * threads
+        decomp = float(_field(result, "decomp_mb_s", 0.0) or 0.0) * threads
+        ratio = float(_field(result, "ratio", 0.0) or 0.0)
+        if comp <= 0.0 or ratio <= 0.0:
+            continue
+
+        key = (algo, -1 if level is None else int(level), threads)
+        old: dict[str, Any] = merged.get(key, {})
+        n = int(old.get("samples", 0))
+
+        def mean(name: str, value: float) -> float:
+            return (float(old.get(name, 0.0)) * n + value) / (n + 1)
+
+        merged[key] = {
+            "algo": algo,
+            "level": key[1],
+            "threads": threads,
+            "comp_mb_s": mean("comp_mb_s", comp),
+            "decomp_mb_s": mean("decomp_mb_s", decomp),
+            "ratio": mean("ratio", ratio),
+            "samples": n + 1,
+        }
+        changed = True
+
+    if not changed:
+        return
+
+    if not _CONFIG_DIR.exists():
+        _CONFIG_DIR.mkdir(parents=True, exist_ok=True)
+
+    entries = sorted(
+        merged.values(), key=lambda e: (e["algo"], e["level"], e["threads"])
+    )
+    _CALIBRATION_FILE.write_text(
+        data=json.dumps(obj=entries, indent=4), encoding="utf-8"
+    )
+    load_calibration()
+
+
+def load_calibration() -> list[dict[str, Any]]:
+    """Push this host's measured speeds into the native backend chooser.
+
+    Budget strategies ("target_mb_s=500", "max_ratio_within=2s") choose from
+    these. Each measured level and thread count is an entry; algorithms known
+    only from speeds.json get one at their default level with a typical
+    ratio. Without either file nothing is pushed, so the native chooser
+    keeps its built-in estimates (or a table given to set_calibration).
+
+    Returns:
+        The entries pushed, or an empty list if none were.
+    """
+    entries: list[dict[str, Any]] = []
+    for e in _load_calibration_raw():
+        try:
+            entries.append(
+                {
+                    "algo": str(e["algo"]),
+                    "level": int(e["level"]),
+                    "threads": int(e["threads"]),
+                    "comp_mb_s": float(e["comp_mb_s"]),
+                    "decomp_mb_s": float(e.get("decomp_mb_s", 0.0)),
+                    "ratio": float(e["ratio"]),
+                }
+            )
+
+        except (KeyError, TypeError, ValueError):
+            continue
+
+    measured = {e["algo"] for e in entries}
+    for algo, speeds in _load_raw().items():
+        if algo in measured or algo not in _DEFAULT_RATIO:
+            continue
+
+        if speeds.comp_mb_s <= 0.0:
+            continue
+
+        entries.append(
+            {
+                "algo": algo,
+                "level": -1,
+                "threads": 1,
+                "comp_mb_s": speeds.comp_mb_s,
+                "decomp_mb_s": speeds.decomp_mb_s,
+                "ratio": _DEFAULT_RATIO[algo],
+            }
+        )
+
+    if not entries:
+        return []
+
+    try:
+        set_calibration(entries[:_CALIBRATION_MAX])
+
+    except ValueError:
+        return []  # e.g. an algorithm this build does not know
+
+    return entries[:_CALIBRATION_MAX]
 
 
 def get_estimated_speeds(algo: str, *, operation: str = "decompress") -> float:
@@ -0,0 +1,668 @@
+"""Reproducible benchmark corpus suite with baseline comparison"""
+
+from __future__ import annotations
+
+import hashlib
+import json
+import os
+import platform
+import random
+import shutil
+import struct
+import tempfile
+import time
+import zlib
+from contextlib import contextmanager
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Any, Iterable, Iterator
+
+from .._core import (
+    benchmark,
+    compress_standalone,
+    create_archive,
+    decompress_standalone,
+    extract_archive,
+    get_capabilities,
+)
+
+SUITE_VERSION = 1
+
+# The synthetic sets, each one file except "small", a directory of objects
+CORPUS_SETS: tuple[str, ...] = (
+    "text",
+    "logs",
+    "json",
+    "binary",
+    "media",
+    "incompressible",
+    "small",
+)
+
+STANDALONE_FORMATS: tuple[str, ...] = ("gzip", "bzip2", "xz", "zstd", "lz4")
+ARCHIVE_FORMATS: tuple[str, ...] = (
+    "tar",
+    "tar.gz",
+    "tar.zst",
+    "tar.xz",
+    "zip",
+    "cdar",
+)
+
+_WORDS: tuple[str, ...] = tuple(
+    "the of and to in a is that for it as was with be by on not he she this are "
+    "or his from at which but have an had they you were their one all we can her "
+    "has there been if more when will would who so no rabbit queen garden little "
+    "curious remarked hurried door key time".split()
+)
+
+
+# ---- Corpus ----
+
+
+def _text(rng: random.Random, size: int) -> bytes:
+    """Word-frequency prose in wrapped lines"""
+    out: list[str] = []
+    total = 0
+    line: list[str] = []
+    while total < size:
+        words = [rng.choice(_WORDS) for _ in range(rng.randint(6, 18))]
+        sentence = " ".join(words).capitalize() + rng.choice(".!?,;")
+        line.append(sentence)
+        if sum(len(s) for s in line) > 60:
+            text = " ".join(line) + "\n"
+            out.append(text)
+            total += len(text)
+            line = []
+    return "".join(out).encode()[:size]
+
+
+def _logs(rng: random.Random, size: int) -> bytes:
+    """Access-log lines with timestamps, ids and latencies"""
+    services = ("api", "auth", "billing", "search", "storage")
+    paths = ("users", "orders", "items", "sessions", "reports")
+    levels = ("INFO", "INFO", "INFO", "WARN", "ERROR", "DEBUG")
+    out: list[bytes] = []
+    total = 0
+    t = 1_700_000_000_000
+    while total < size:
+        t += rng.randint(1, 250)
+        line = (
+            f"{time.strftime('%Y-%m-%dT%H:%M:%S', time.gmtime(t // 1000))}"
+            f".{t % 1000:03d}Z {rng.choice(levels)} [{rng.choice(services)}] "
+            f"request_id={rng.getrandbits(64):016x} "
+            f"path=/api/v1/{rng.choice(paths)}/{rng.randint(1, 99999)} "
+            f"status={rng.choice((200, 200, 200, 201, 204, 304, 404, 500))} "
+            f"duration_ms={rng.expovariate(1 / 40):.1f}\n"
+        ).encode()
+        out.append(line)
+        total += len(line)
+    return b"".join(out)[:size]
+
+
+def _json_record(rng: random.Random, n: int) -> dict[str, Any]:
+    """One JSON object with nested and repeated fields"""
+    return {
+        "id": n,
+        "name": " ".join(rng.choice(_WORDS) for _ in range(3)),
+        "active": rng.random() < 0.8,
+        "score": round(rng.gauss(50, 15), 3),
+        "tags": rng.sample(_WORDS, rng.randint(1, 5)),
+        "address": {"zip": f"{rng.randint(0, 99999):05d}", "country": "GB"},
+    }
+
+
+def _json(rng: random.Random, size: int) -> bytes:
+    """Newline-delimited JSON records"""
+    out: list[bytes] = []
+    total = 0
+    n = 0
+    while total < size:
+        line = (json.dumps(_json_record(rng, n), sort_keys=True) + "\n").encode()
+        out.append(line)
+        total += len(line)
+        n += 1
+    return b"".join(out)[:size]
+
+
+def _binary(rng: random.Random, size: int) -> bytes:
+    """Fixed-width records: counters, small enums, sensor floats and padding"""
+    out = bytearray()
+    counter = 0
+    while len(out) < size:
+        counter += rng.randint(1, 3)
+        out += struct.pack(
+            "<IHhdxxxx",
+            counter,
+            rng.choice((1, 2, 4, 8)),
+            rng.randint(-300, 300),
+            20.0 + rng.gauss(0, 2),
+        )
+    return bytes(out[:size])
+
+
+def _media(rng: random.Random, size: int) -> bytes:
+    """Already-compressed content: deflate streams of prose"""
+    out = bytearray()
+    while len(out) < size:
+        out += zlib.compress(_text(rng, 64 * 1024), 9)
+    return bytes(out[:size])
+
+
+def _incompressible(rng: random.Random, size: int) -> bytes:
+    """Uniform random bytes"""
+    return rng.randbytes(size)
+
+
+_GENERATORS = {
+    "text": _text,
+    "logs": _logs,
+    "json": _json,
+    "binary": _binary,
+    "media": _media,
+    "incompressible": _incompressible,
+}
+
+
+def generate_corpus(
+    dest: str | Path,
+    *,
+    size: int = 4 * 1024 * 1024,
+    small_count: int = 256,
+    seed: int = 29,
+) -> dict[str, Path]:
+    """Write the synthetic corpus into dest
+
+    The same size, small_count and seed always produce the same bytes, so
+    runs on different days and machines measure identical inputs.
+
+    Args:
+        dest: Directory to write into; created if missing
+        size: Size of each single-file set, in bytes
+        small_count: Number of objects (64 B to 4 KiB each) in the "small" set
+        seed: Seed for every generator
+
+    Returns:
+        Mapping of set name to its file, or to its directory for "small"
+    """
+    dest = Path(dest)
+    dest.mkdir(parents=True, exist_ok=True)
+
+    corpus: dict[str, Path] = {}
+    for i, (name, generate) in enumerate(_GENERATORS.items()):
+        path = dest / f"{name}.bin"
+        path.write_bytes(generate(random.Random(seed * 1000 + i), size))
+        corpus[name] = path
+
+    small = dest / "small"
+    small.mkdir(exist_ok=True)
+    rng = random.Random(seed * 1000 + len(_GENERATORS))
+    for n in range(small_count):
+        kind = rng.random()
+        if kind < 0.5:
+            data = json.dumps(_json_record(rng, n), sort_keys=True).encode()
+        elif kind < 0.8:
+            data = _text(rng, rng.randint(64, 4096))
+        else:
+            data = _logs(rng, rng.randint(64, 4096))
+        (small / f"{n:05d}.obj").write_bytes(data)
+    corpus["small"] = small
+    return corpus
+
+
+def load_corpus(root: str | Path) -> dict[str, Path]:
+    """Use an existing directory (e.g. an unpacked Silesia corpus) as the corpus
+
+    Every regular file is a set of its own, named after the file;
+    subdirectories become small-object sets.
+
+    Args:
+        root: Directory holding the corpus
+
+    Returns:
+        Mapping of set name to its file or directory
+    """
+    root = Path(root)
+    if not root.is_dir():
+        raise FileNotFoundError(f"Corpus directory {root} does not exist")
+    return {p.name: p for p in sorted(root.iterdir()) if p.is_file() or p.is_dir()}
+
+
+def _files(path: Path) -> list[Path]:
+    """The files of a set, sorted"""
+    if not path.is_dir():
+        return [path]
+    return sorted(p for p in path.rglob("*") if p.is_file())
+
+
+def corpus_manifest(corpus: dict[str, Path]) -> dict[str, dict[str, Any]]:
+    """Size, file count and SHA-256 of every set, to tell runs on other data apart
+
+    Args:
+        corpus: Mapping of set name to path
+
+    Returns:
+        Mapping of set name to its size, files and sha256
+    """
+    manifest: dict[str, dict[str, Any]] = {}
+    for name, path in corpus.items():
+        digest = hashlib.sha256()
+        size = 0
+        files = _files(path)
+        for f in files:
+            data = f.read_bytes()
+            digest.update(data)
+            size += len(data)
+        manifest[name] = {
+            "size": size,
+            "files": len(files),
+            "sha256": digest.hexdigest(),
+        }
+    return manifest
+
+
+# ---- Runs ----
+
+
+@dataclass
+class SuiteResult:
+    """One measured (kind, target, corpus set, level, threads) combination
+
+    Attributes:
+        kind: "backend" (in-memory codec), "standalone" (file format) or "archive"
+        target: Backend, standalone format or archive format name
+        corpus: Corpus set name ("all" for archives of the whole corpus)
+        level: Compression level (-1 = the target's default)
+        threads: Worker threads
+        input_size: Uncompressed bytes
+        output_size: Compressed bytes
+        compress_s: Median seconds to compress the set once
+        decompress_s: Median seconds to decompress it once
+    """
+
+    kind: str
+    target: str
+    corpus: str
+    level: int
+    threads: int
+    input_size: int
+    output_size: int
+    compress_s: float
+    decompress_s: float
+
+    @property
+    def key(self) -> str:
+        """Identity used to match results across runs"""
+        return f"{self.kind}/{self.target}/{self.corpus}/L{self.level}/T{self.threads}"
+
+    @property
+    def ratio(self) -> float:
+        """Compressed/original size - smaller is better"""
+        return self.output_size / self.input_size if self.input_size else 0.0
+
+    @property
+    def comp_mb_s(self) -> float:
+        """Compression throughput in MB/s"""
+        return (
+            self.input_size / (1024 * 1024) / self.compress_s
+            if self.compress_s
+            else 0.0
+        )
+
+    @property
+    def decomp_mb_s(self) -> float:
+        """Decompression throughput in MB/s"""
+        return (
+            self.input_size / (1024 * 1024) / self.decompress_s
+            if self.decompress_s
+            else 0.0
+        )
+
+    def to_dict(self) -> dict[str, Any]:
+        """Plain-JSON form, with the derived figures included"""
+        return {
+            "key": self.key,
+            "kind": self.kind,
+            "target": self.target,
+            "corpus": self.corpus,
+            "level": self.level,
+            "threads": self.threads,
+            "input_size": self.input_size,
+            "output_size": self.output_size,
+            "compress_s": self.compress_s,
+            "decompress_s": self.decompress_s,
+            "ratio": self.ratio,
+            "comp_mb_s": self.comp_mb_s,
+            "decomp_mb_s": self.decomp_mb_s,
+        }
+
+
+def _median(values: list[float]) -> float:
+    """Median of a non-empty list"""
+    ordered = sorted(values)
+    mid = len(ordered) // 2
+    return ordered[mid] if len(ordered) % 2 else (ordered[mid - 1] + ordered[mid]) / 2
+
+
+def _timed(repeats: int, call) -> float:
+    """Median wall time of `repeats` calls"""
+    times: list[float] = []
+    for _ in range(repeats):
+        start = time.perf_counter()
+        call()
+        times.append(time.perf_counter() - start)
+    return _median(times)
+
+
+@contextmanager
+def _chdir(path: Path) -> Iterator[None]:
+    """Run with path as the working directory (archives store relative names)"""
+    previous = os.getcwd()
+    os.chdir(path)
+    try:
+        yield
+    finally:
+        os.chdir(previous)
+
+
+def _run_backend(
+    algo: str, name: str, path: Path, level: int, threads: int, repeats: int
+) -> SuiteResult:
+    """In-memory codec timings; small-object sets are timed object by object"""
+    input_size = output_size = 0
+    compress_s = decompress_s = 0.0
+    for f in _files(path):
+        run = benchmark(
+            f.read_bytes(), algo, level=level, repeats=repeats, threads=threads
+        )
+        input_size += run["input_size"]
+        output_size += run["compressed_size"]
+        compress_s += run["compress"]["median"]
+        decompress_s += run["decompress"]["median"]
+    return SuiteResult(
+        kind="backend",
+        target=algo,
+        corpus=name,
+        level=level,
+        threads=threads,
+        input_size=input_size,
+        output_size=output_size,
+        compress_s=compress_s,
+        decompress_s=decompress_s,
+    )
+
+
+def _run_standalone(
+    fmt: str,
+    name: str,
+    path: Path,
+    level: int,
+    threads: int,
+    repeats: int,
+    work: Path,
+) -> SuiteResult:
+    """File-to-file timings for one standalone format"""
+    packed = work / f"{name}.{fmt}"
+    restored = work / f"{name}.out"
+
+    def pack() -> None:
+        compress_standalone(str(path), str(packed), fmt, level, threads=threads)
+
+    def unpack() -> None:
+        decompress_standalone(str(packed), str(restored), fmt, threads=threads)
+
+    compress_s = _timed(repeats, pack)
+    decompress_s = _timed(repeats, unpack)
+    result = SuiteResult(
+        kind="standalone",
+        target=fmt,
+        corpus=name,
+        level=level,
+        threads=threads,
+        input_size=path.stat().st_size,
+        output_size=packed.stat().st_size,
+        compress_s=compress_s,
+        decompress_s=decompress_s,
+    )
+    if restored.stat().st_size != result.input_size:
+        raise RuntimeError(f"{fmt} round trip of {name} changed its size")
+    packed.unlink()
+    restored.unlink()
+    return result
+
+
+def _run_archive(
+    fmt: str, root: Path, level: int, threads: int, repeats: int, work: Path
+) -> SuiteResult:
+    """Archive the whole corpus directory, then extract it"""
+    archive = work / f"corpus.{fmt}"
+    names = sorted(p.name for p in root.iterdir())
+    input_size = sum(f.stat().st_size for f in _files(root))
+
+    def pack() -> None:
+        archive.unlink(missing_ok=True)
+        with _chdir(root):
+            create_archive(str(archive), fmt, names, level, threads)
+
+    def unpack() -> None:
+        out = work / "extract"
+        shutil.rmtree(out, ignore_errors=True)
+        out.mkdir()
+        extract_archive(str(archive), str(out), threads=threads)
+
+    compress_s = _timed(repeats, pack)
+    decompress_s = _timed(repeats, unpack)
+    result = SuiteResult(
+        kind="archive",
+        target=fmt,
+        corpus="all",
+        level=level,
+        threads=threads,
+        input_size=input_size,
+        output_size=archive.stat().st_size,
+        compress_s=compress_s,
+        decompress_s=decompress_s,
+    )
+    archive.unlink()
+    shutil.rmtree(work / "extract", ignore_errors=True)
+    return result
+
+
+def run_suite(
+    corpus: dict[str, Path],
+    *,
+    levels: Iterable[int] = (1, 6, 9),
+    threads: Iterable[int] = (1, 4),
+    repeats: int = 3,
+    kinds: Iterable[str] = ("backend", "standalone", "archive"),
+    archive_root: str | Path | None = None,
+    work_dir: str | Path | None = None,
+    progress=None,
+) -> dict[str, Any]:
+    """Run every backend, standalone format and archive pipeline over the corpus
+
+    Backends are timed in memory; standalone formats on the single-file sets;
+    archive pipelines over archive_root (the corpus directory) as a whole.
+    Targets this build cannot run are listed under "skipped" with the reason.
+
+    Args:
+        corpus: Mapping of set name to path (see generate_corpus/load_corpus)
+        levels: Compression levels to run each target at
+        threads: Worker thread counts to run each target with
+        repeats: Timed repetitions; each figure is their median
+        kinds: Which of "backend", "standalone" and "archive" to run
+        archive_root: Directory holding the whole corpus; defaults to the
+            common parent of the sets
+        work_dir: Scratch directory for file outputs; a temporary one if None
+        progress: Optional callable receiving each finished key
+
+    Returns:
+        The JSON-ready report: suite version, platform, corpus manifest,
+        "results" and "skipped"
+    """
+    kinds = set(kinds)
+    levels = list(levels)
+    threads = list(threads)
+    results: list[SuiteResult] = []
+    skipped: list[dict[str, str]] = []
+
+    def record(make, kind: str, target: str) -> None:
+        try:
+            result = make()
+        except Exception as e:
+            entry = {"kind": kind, "target": target, "reason": str(e)}
+            if entry not in skipped:
+                skipped.append(entry)
+            return
+        results.append(result)
+        if progress:
+            progress(result.key)
+
+    with tempfile.TemporaryDirectory(dir=work_dir) as tmp:
+        work = Path(tmp)
+
+        if "backend" in kinds:
+            algos = [c["name"] for c in get_capabilities() if c["name"] != "stored"]
+            for algo in algos:
+                for name, path in corpus.items():
+                    for level in levels:
+                        for t in threads:
+                            record(
+                                lambda: _run_backend(
+                                    algo, name, path, level, t, repeats
+                                ),
+                                "backend",
+                                algo,
+                            )
+
+        if "standalone" in kinds:
+            for fmt in STANDALONE_FORMATS:
+                for name, path in corpus.items():
+                    if not path.is_file():
+                        continue
+                    for level in levels:
+                        for t in threads:
+                            record(
+                                lambda: _run_standalone(
+                                    fmt, name, path, level, t, repeats, work
+                                ),
+                                "standalone",
+                                fmt,
+                            )
+
+        if "archive" in kinds:
+            root = Path(
+                archive_root
+                or os.path.commonpath([str(p.parent) for p in corpus.values()])
+            )
+            for fmt in ARCHIVE_FORMATS:
+                for level in levels:
+                    for t in threads:
+                        record(
+                            lambda: _run_archive(fmt, root, level, t, repeats, work),
+                            "archive",
+                            fmt,
+                        )
+
+    return {
+        "suite_version": SUITE_VERSION,
+        "created": time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime()),
+        "platform": {
+            "python": platform.python_version(),
+            "machine": platform.machine(),
+            "system": platform.system(),
+            "cpus": os.cpu_count(),
+        },
+        "settings": {"levels": levels, "threads": threads, "repeats": repeats},
+        "corpus": corpus_manifest(corpus),
+        "results": [r.to_dict() for r in results],
+        "skipped": skipped,
+    }
+
+
+# ---- Baselines ----
+
+
+@dataclass
+class Regression:
+    """A result that got worse than its baseline by more than the threshold
+
+    Attributes:
+        key: The result's identity (see SuiteResult.key)
+        metric: "comp_mb_s", "decomp_mb_s" or "ratio"
+        baseline: The baseline's value
+        current: This run's value
+    """
+
+    key: str
+    metric: str
+    baseline: float
+    current: float
+
+    @property
+    def change(self) -> float:
+        """Relative change from the baseline (negative = slower, positive = larger)"""
+        return self.current / self.baseline - 1.0 if self.baseline else 0.0
+
+
+def save_report(report: dict[str, Any], path: str | Path) -> None:
+    """Write a report as JSON"""
+    path = Path(path)
+    path.parent.mkdir(parents=True, exist_ok=True)
+    text = json.dumps(report, indent=2, sort_keys=True) + "\n"
+    path.write_text(text, encoding="utf-8")
+
+
+def load_report(path: str | Path) -> dict[str, Any]:
+    """Read a report written by save_report"""
+    return json.loads(Path(path).read_text(encoding="utf-8"))
+
+
+def compare(
+    current: dict[str, Any],
+    baseline: dict[str, Any],
+    *,
+    threshold: float = 0.10,
+    ratio_threshold: float = 0.01,
+) -> list[Regression]:
+    """Flag results that regressed against the baseline
+
+    Only results present in both reports are compared. Throughput regresses
+    when it drops by more than threshold; the ratio when it grows by more
+    than ratio_threshold (ratios barely vary between runs, timings do).
+
+    Args:
+        current: This run's report
+        baseline: The stored baseline report
+        threshold: Allowed relative throughput drop (0.10 = 10%)
+        ratio_threshold: Allowed relative ratio growth
+
+    Returns:
+        The regressions, worst first
+    """
+    base = {r["key"]: r for r in baseline.get("results", [])}
+    regressions: list[Regression] = []
+    for r in current.get("results", []):
+        b = base.get(r["key"])
+        if b is None:
+            continue
+        for metric in ("comp_mb_s", "decomp_mb_s"):
+            if b[metric] and r[metric] < b[metric] * (1.0 - threshold):
+                regressions.append(
+                    Regression(r["key"], metric, b[metric], r[metric])
+                )
+        if b["ratio"] and r["ratio"] > b["ratio"] * (1.0 + ratio_threshold):
+            regressions.append(Regression(r["key"], "ratio", b["ratio"], r["ratio"]))
+    regressions.sort(key=lambda reg: -abs(reg.change))
+    return regressions
+
+
+def corpus_mismatches(current: dict[str, Any], baseline: dict[str, Any]) -> list[str]:
+    """Names of corpus sets whose contents differ between the two reports"""
+    cur = current.get("corpus", {})
+    base = baseline.get("corpus", {})
+    return sorted(
+        name
+        for name in cur.keys() & base.keys()
+        if cur[name]["sha256"] != base[name]["sha256"]
+    )
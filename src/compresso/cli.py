@@ -10,12 +10,16 @@ from typer_extensions import ExtendedTyper
 
 from ._core import (
     BackendError,
+    Dictionary,
     Error,
     HeaderError,
+    train_dictionary,
 )
 from .backend.benchmark import benchmark_file, print_results
 from .backend.capabilities import list_capabilities
 from .backend.file_inspect import inspect as inspect_file
+from .backend.file_inspect import verify as verify_file
+from .backend.speeds import record_calibration
 from .frontend.api import (
     CompressionJob,
     CompressionOptions,
@@ -70,11 +74,64 @@ def format_time(seconds: float) -> str:
         return f"{mins}m {secs:.1f}s"
 
 
+def _compress_batch(
+    files: list[Path], options: CompressionOptions, jobs: int, quiet: bool
+) -> None:
+    """Compress several files side by side, each to <file>.comp.
+
+    Args:
+        files: The paths of the files to compress.
+        options: Compression options shared by every file.
+        jobs: Files in flight at once, 0 for one per CPU.
+        quiet: If True, only report failures.
+    """
+    batch: list[CompressionJob] = [
+        CompressionJob.from_file(src=file, options=options) for file in files
+    ]
+
+    start_time: float = time.time()
+    results = CompressionJob.run_many(batch, threads=jobs)
+    elapsed: float = time.time() - start_time
+
+    failed: int = 0
+    input_size: int = 0
+    for result in results:
+        if not result.ok:
+            failed += 1
+            app.echo(
+                message=app.style(
+                    text=f"✗ {result.plan.src}: {result.error}", fg="red"
+                ),
+                err=True,
+            )
+
+        else:
+            input_size += result.plan.input_size
+            if not quiet:
+                app.echo(message=f"✓ {result.plan.src} -> {result.plan.dest}")
+
+    if not quiet:
+        speed_mbs: int | float = (
+            (input_size / (1024 * 1024)) / elapsed if elapsed > 0 else 0
+        )
+        app.echo()
+        app.echo(
+            message=f"Compressed {len(results) - failed} of {len(results)} files "
+            f"in {format_time(seconds=elapsed)} ({speed_mbs:.2f} MB/s)"
+        )
+
+    if failed:
+        sys.exit(1)
+
+
 @app.command(aliases=["c", "comp"])
 def compress(
-    file: Path = app.Argument(default=..., help="File to compress"),
+    files: list[Path] = app.Argument(default=..., help="File(s) to compress"),
     output: Path | None = app.Option(
-        None, "--output", "-o", help="Output file path (default: input.comp)"
+        None,
+        "--output",
+        "-o",
+        help="Output file path (default: input.comp; single file only)",
     ),
     algo: str | None = app.Option(
         "auto",
@@ -88,21 +145,65 @@ def compress(
         "--strategy",
         "-s",
         case_sensitive=False,
-        help="Compression strategy to use (fast/balanced/max_ratio)",
+        help="Compression strategy to use (fast/balanced/max_ratio/auto), or a "
+        "budget: target_mb_s=N or max_ratio_within=SECONDS",
     ),
     level: int | None = app.Option(
         None, "--level", "-l", min=0, max=9, help="Compression level (0-9)"
     ),
+    threads: int = app.Option(
+        1,
+        "--threads",
+        "-T",
+        min=0,
+        help="Worker threads for block-parallel compression (0 = all CPUs)",
+    ),
+    jobs: int = app.Option(
+        1,
+        "--jobs",
+        "-j",
+        min=0,
+        help="Files to compress side by side (0 = all CPUs)",
+    ),
+    seekable: bool = app.Option(
+        False, "--seekable", help="Write a block index for random access"
+    ),
+    dictionary: Path | None = app.Option(
+        None, "--dict", "-D", help="Trained dictionary file (see 'train')"
+    ),
+    checksum: bool = app.Option(
+        False, "--checksum", help="Store a checksum that decompression verifies"
+    ),
+    long_distance: bool = app.Option(
+        False, "--long", help="Long-distance matching for large inputs (zstd)"
+    ),
+    window_log: int = app.Option(
+        0,
+        "--window-log",
+        min=0,
+        max=31,
+        help="Log2 of the zstd match window (0 = the level's)",
+    ),
     quiet: bool = app.Option(False, "--quiet", "-q", help="Suppress all output"),
 ) -> None:
-    """Compress a file using the specified algorithm and strategy.
+    """Compress files using the specified algorithm and strategy.
+
+    With several files (or -j), they are compressed side by side on native
+    workers, each single-threaded and written to <file>.comp.
 
     Args:
-        file: The path to the file to compress.
-        output: The path to the output file (default: None).
+        files: The paths of the files to compress.
+        output: The path to the output file, for a single file (default: None).
         algo: The compression algorithm to use (default: None).
         strategy: The compression strategy to use (default: "balanced").
         level: The compression level to use (default: None).
+        threads: Number of worker threads, 0 for all CPUs (default: 1).
+        jobs: Number of files in flight at once, 0 for all CPUs (default: 1).
+        seekable: If True, write a block-indexed file (default: False).
+        dictionary: Path to a trained dictionary file (default: None).
+        checksum: If True, store a checksum of the data (default: False).
+        long_distance: If True, enable zstd long-distance matching (default: False).
+        window_log: Log2 of the zstd match window, 0 for the level's (default: 0).
         quiet: If True, suppress all output (default: False).
     """
     try:
@@ -111,9 +212,29 @@ def compress(
             algo=None if algo_lower == "auto" else algo_lower,
             strategy=strategy.lower(),
             level=level,
+            threads=threads,
+            seekable=seekable,
+            dictionary=dictionary,
+            checksum=checksum,
+            long_distance=long_distance,
+            window_log=window_log,
         )
 
-        job = CompressionJob.from_file(src=file, dest=output, options=options)
+        if len(files) > 1 or jobs != 1:
+            if output is not None:
+                app.echo(
+                    message=app.style(
+                        text="✗ Error: --output takes a single input file",
+                        fg="red",
+                    ),
+                    err=True,
+                )
+                sys.exit(1)
+
+            _compress_batch(files=files, options=options, jobs=jobs, quiet=quiet)
+            return
+
+        job = CompressionJob.from_file(src=files[0], dest=output, options=options)
         plan = job.plan
 
         if not plan.can_compress:
@@ -132,6 +253,10 @@ def compress(
             app.echo(message=f"Strategy:    {strategy}")
             if level is not None:
                 app.echo(message=f"Level:       {level}")
+            if threads != 1:
+                app.echo(message=f"Threads:     {threads or 'auto'}")
+            if dictionary is not None:
+                app.echo(message=f"Dictionary:  {dictionary}")
             app.echo()
 
         start_time: float = time.time()
@@ -207,6 +332,16 @@ def decompress(
         "-o",
         help="Output file path (default: remove .comp extension)",
     ),
+    threads: int = app.Option(
+        1,
+        "--threads",
+        "-T",
+        min=0,
+        help="Worker threads for seekable files (0 = all CPUs)",
+    ),
+    dictionary: Path | None = app.Option(
+        None, "--dict", "-D", help="Dictionary the file was compressed with"
+    ),
     quiet: bool = app.Option(False, "--quiet", "-q", help="Suppress progress output"),
 ) -> None:
     """Decompress a Compresso compressed file.
@@ -214,10 +349,14 @@ def decompress(
     Args:
         file: The path to the compressed file.
         output: The path to the output file (default: remove .comp extension).
+        threads: Number of worker threads, 0 for all CPUs (default: 1).
+        dictionary: Path to the dictionary used to compress (default: None).
         quiet: If True, suppress progress output.
     """
     try:
-        job = DecompressionJob.from_file(src=file, dest=output)
+        job = DecompressionJob.from_file(
+            src=file, dest=output, threads=threads, dictionary=dictionary
+        )
         plan = job.plan
         insp = plan.inspection
 
@@ -255,6 +394,8 @@ def decompress(
             app.echo(message=f"Decompressing: {plan.src}")
             app.echo(message=f"Output:        {plan.dest}")
             app.echo(message=f"Algorithm:     {insp.algo_name}")
+            if insp.dictionary_id is not None:
+                app.echo(message=f"Dictionary:    {insp.dictionary_id:#010x}")
             if insp.orig_size:
                 app.echo(
                     message=f"Original size: {format_size(size_bytes=insp.orig_size)}"
@@ -265,7 +406,7 @@ def decompress(
 
         if not quiet and insp.orig_size and insp.orig_size > 1024 * 1024:
             with app.progressbar(
-                length=insp.orig_size,
+                length=plan.src.stat().st_size,
                 label="Decompressing",
                 show_eta=True,
                 show_percent=True,
@@ -319,6 +460,61 @@ def decompress(
         sys.exit(1)
 
 
+@app.command(aliases=["t"])
+def train(
+    samples: list[Path] = app.Argument(
+        ..., help="Sample files, or directories to take every file from"
+    ),
+    output: Path = app.Option(..., "--output", "-o", help="Dictionary file to write"),
+    algo: str = app.Option(
+        "zstd", "--algo", "-a", case_sensitive=False, help="Backend to train for"
+    ),
+    size: int = app.Option(
+        112640, "--size", min=256, help="Maximum dictionary size in bytes"
+    ),
+    quiet: bool = app.Option(False, "--quiet", "-q", help="Suppress all output"),
+) -> None:
+    """Train a compression dictionary from sample files.
+
+    Args:
+        samples: Sample files or directories of sample files.
+        output: The path to write the dictionary to.
+        algo: The backend to train the dictionary for (default: "zstd").
+        size: The maximum dictionary size in bytes (default: 112640).
+        quiet: If True, suppress all output (default: False).
+    """
+    try:
+        files: list[Path] = []
+        for sample in samples:
+            if sample.is_dir():
+                files.extend(sorted(p for p in sample.rglob("*") if p.is_file()))
+
+            else:
+                files.append(sample)
+
+        data: list[bytes] = [path.read_bytes() for path in files]
+        dictionary = train_dictionary(data, size=size, algo=algo.lower())
+        output.write_bytes(dictionary.data)
+
+        if not quiet:
+            app.echo(message=app.style(text="✓ Dictionary trained!", fg="green"))
+            app.echo(message=f"  Samples:    {len(files)}")
+            app.echo(message=f"  Size:       {format_size(size_bytes=len(dictionary.data))}")
+            app.echo(message=f"  ID:         {dictionary.id:#010x}")
+            app.echo(message=f"  Output:     {output}")
+            app.echo()
+
+    except (Error, HeaderError, BackendError, ValueError) as e:
+        app.echo(
+            message=app.style(text=f"✗ Training error: {e}", fg="red"), err=True
+        )
+        sys.exit(1)
+
+    except Exception as e:
+        app.echo(message=app.style(text=f"✗ Unexpected error: {e}", fg="red"), err=True)
+        sys.exit(1)
+
+
 @app.command(aliases=["a", "ar"])
 def archive(
     output: Path = app.Argument(default=..., help="Output archive path"),
@@ -330,11 +526,29 @@ def archive(
         "--format",
         "-f",
         case_sensitive=False,
-        help="Archive format (e.g. tar.zst, tar.gz, tar)",
+        help="Archive format (e.g. tar.zst, tar.gz, tar, cdar)",
     ),
     level: int | None = app.Option(
         None, "--level", "-l", min=0, max=9, help="Compression level (0-9)"
     ),
+    threads: int = app.Option(
+        1,
+        "--threads",
+        "-T",
+        min=0,
+        help="Compression worker threads (0 = all CPUs)",
+    ),
+    base: Path | None = app.Option(
+        None,
+        "--base",
+        "-b",
+        help="Earlier cdar archive to store only new chunks against",
+    ),
+    catalog: bool = app.Option(
+        False,
+        "--catalog",
+        help="Also write <output>.catalog so tar listings skip decoding",
+    ),
     quiet: bool = app.Option(False, "--quiet", "-q", help="Suppress all output"),
 ) -> None:
     """Create an archive from multiple files and directories.
@@ -344,10 +558,19 @@ def archive(
         sources: The files and directories to include in the archive.
         format: The archive format (default: "tar.zst").
         level: The compression level to use (default: None).
+        threads: Number of worker threads, 0 for all CPUs (default: 1).
+        base: Earlier cdar archive for an incremental archive (default: None).
+        catalog: If True, write a catalog sidecar for tar (default: False).
         quiet: If True, suppress all output (default: False).
     """
     try:
-        options = ArchiveOptions(format=format.lower(), compression_level=level)
+        options = ArchiveOptions(
+            format=format.lower(),
+            compression_level=level,
+            threads=threads,
+            base=base,
+            catalog=catalog,
+        )
         job = ArchiveJob.from_paths(sources=sources, output=output, options=options)
         plan = job.plan
 
@@ -364,6 +587,10 @@ def archive(
             app.echo(message=f"Archiving:   {plan.entry_count} source(s)")
             app.echo(message=f"Output:      {plan.output}")
             app.echo(message=f"Format:      {plan.options.format}")
+            if threads != 1:
+                app.echo(message=f"Threads:     {threads or 'auto'}")
+            if base is not None:
+                app.echo(message=f"Base:        {base}")
             app.echo(
                 message=f"Input size:  {format_size(size_bytes=plan.total_input_size)}"
             )
@@ -428,6 +655,13 @@ def extract(
     list_only: bool = app.Option(
         False, "--list", help="List archive contents without extracting"
     ),
+    threads: int = app.Option(
+        1,
+        "--threads",
+        "-T",
+        min=0,
+        help="Worker threads for writing files (0 = all CPUs)",
+    ),
     quiet: bool = app.Option(False, "--quiet", "-q", help="Suppress all output"),
 ) -> None:
     """Extract an archive, or list its contents.
@@ -436,10 +670,13 @@ def extract(
         archive: The path to the archive file.
         output_dir: Directory to extract into (default: current directory).
         list_only: If True, list contents without extracting.
+        threads: Number of worker threads, 0 for all CPUs (default: 1).
         quiet: If True, suppress all output (default: False).
     """
     try:
-        job = ExtractJob.from_archive(archive=archive, output_dir=output_dir)
+        job = ExtractJob.from_archive(
+            archive=archive, output_dir=output_dir, threads=threads
+        )
         plan = job.plan
 
         if not plan.can_run:
@@ -506,8 +743,9 @@ def inspect(
 
         if output_json:
             import json
+            from dataclasses import asdict
 
-            data: dict[str, str | int | None | float] = {
+            data: dict[str, object] = {
                 "path": str(object=result.path),
                 "is_compresso": result.is_compresso,
                 "header_ok": result.header_ok,
@@ -522,6 +760,15 @@ def inspect(
                 "can_decompress": result.can_decompress,
                 "estimated_decomp_s": result.estimated_decomp_s,
                 "reason": result.reason,
+                "block_size": result.block_size,
+                "dictionary_id": result.dictionary_id,
+                "checksum": result.checksum,
+                "window_log": result.window_log,
+                "blocks": (
+                    [asdict(obj=block) for block in result.blocks]
+                    if result.blocks is not None
+                    else None
+                ),
             }
             app.echo(message=json.dumps(obj=data, indent=2))
             return
@@ -548,6 +795,23 @@ def inspect(
             message=f"Algorithm:       {result.algo_name or 'Unknown'} (ID: {result.algo_id})"
         )
         app.echo(message=f"Version:         {result.version}")
+        if result.blocks is not None and result.block_size:
+            app.echo(
+                message=f"Blocks:          {len(result.blocks)} x "
+                f"{format_size(size_bytes=result.block_size)} (seekable)"
+            )
+            holes: int = sum(block.is_hole for block in result.blocks)
+            if holes:
+                app.echo(message=f"Holes:           {holes} blocks of zeros (sparse)")
+        if result.dictionary_id is not None:
+            app.echo(message=f"Dictionary:      {result.dictionary_id:#010x}")
+        if result.checksum is not None:
+            app.echo(message=f"Checksum:        xxh64 {result.checksum:016x}")
+        if result.window_log is not None:
+            app.echo(
+                message=f"Window:          "
+                f"{format_size(size_bytes=1 << result.window_log)} (log {result.window_log})"
+            )
         app.echo()
 
         if result.level is not None:
@@ -595,9 +859,158 @@ def inspect(
         sys.exit(1)
 
 
+@app.command(aliases=["v"])
+def verify(
+    file: Path = app.Argument(..., help="File to verify"),
+    threads: int = app.Option(
+        1,
+        "--threads",
+        "-T",
+        min=0,
+        help="Worker threads for seekable files (0 = all CPUs)",
+    ),
+    dictionary: Path | None = app.Option(
+        None, "--dict", "-D", help="Dictionary the file was compressed with"
+    ),
+    quiet: bool = app.Option(False, "--quiet", "-q", help="Suppress all output"),
+) -> None:
+    """Check a compressed file's integrity without writing any output.
+
+    Args:
+        file: The path to the compressed file.
+        threads: Number of worker threads, 0 for all CPUs (default: 1).
+        dictionary: Path to the dictionary used to compress (default: None).
+        quiet: If True, suppress all output (default: False).
+    """
+    try:
+        start_time: float = time.time()
+        result = verify_file(
+            path=file,
+            dictionary=(
+                Dictionary(dictionary.read_bytes()) if dictionary is not None else None
+            ),
+            threads=threads,
+        )
+        elapsed: float = time.time() - start_time
+
+        if not result.ok:
+            if not quiet:
+                app.echo(
+                    message=app.style(
+                        text=f"✗ Verification failed: {result.reason}", fg="red"
+                    ),
+                    err=True,
+                )
+            sys.exit(1)
+
+        if not quiet:
+            app.echo(message=app.style(text=f"✓ {file}: OK", fg="green"))
+            app.echo(message=f"  Time: {format_time(seconds=elapsed)}")
+
+    except (OSError, ValueError) as e:
+        app.echo(
+            message=app.style(text=f"✗ Error verifying file: {e}", fg="red"), err=True
+        )
+        sys.exit(1)
+
+
+def _run_suite(
+    corpus_dir: Path | None,
+    output: Path | None,
+    baseline: Path | None,
+    threshold: float,
+    quick: bool,
+    update_cache: bool,
+) -> None:
+    """Run the corpus suite, write its report and compare it with a baseline.
+
+    Args:
+        corpus_dir: Existing corpus directory, or None to generate the synthetic one.
+        output: Where to write the JSON report (default: none).
+        baseline: Stored report to compare against (default: none).
+        threshold: Allowed relative throughput drop before flagging a regression.
+        quick: If True, run a small corpus at one level and thread count.
+        update_cache: If True, calibrate budget strategies from the backend results.
+    """
+    import tempfile
+
+    from .backend import suite
+
+    with tempfile.TemporaryDirectory() as tmp:
+        if corpus_dir:
+            corpus = suite.load_corpus(corpus_dir)
+            app.echo(message=f"Corpus: {corpus_dir} ({len(corpus)} sets)")
+        else:
+            size = 512 * 1024 if quick else 4 * 1024 * 1024
+            corpus = suite.generate_corpus(
+                Path(tmp) / "corpus", size=size, small_count=64 if quick else 256
+            )
+            app.echo(message=f"Corpus: synthetic, {format_size(size_bytes=size)} per set")
+
+        report = suite.run_suite(
+            corpus,
+            levels=(1,) if quick else (1, 6, 9),
+            threads=(1,) if quick else (1, 4),
+            repeats=1 if quick else 3,
+            work_dir=tmp,
+        )
+
+    app.echo(message=f"Results: {len(report['results'])}")
+    for entry in report["skipped"]:
+        app.echo(
+            message=app.style(
+                text=f"  skipped {entry['kind']} {entry['target']}: {entry['reason']}",
+                fg="yellow",
+            )
+        )
+
+    if output:
+        suite.save_report(report, output)
+        app.echo(message=f"Report written to: {output}")
+
+    if update_cache:
+        record_calibration(report["results"])
+        app.echo(message="Calibration updated")
+
+    if not baseline:
+        return
+    if not baseline.is_file():
+        app.echo(message=f"No baseline at {baseline}; nothing to compare")
+        return
+
+    base = suite.load_report(baseline)
+    for name in suite.corpus_mismatches(report, base):
+        app.echo(
+            message=app.style(
+                text=f"  corpus set {name} differs from the baseline", fg="yellow"
+            )
+        )
+
+    regressions = suite.compare(report, base, threshold=threshold)
+    if not regressions:
+        app.echo(
+            message=app.style(text="✓ No regressions against baseline", fg="green")
+        )
+        return
+
+    app.echo(
+        message=app.style(
+            text=f"✗ {len(regressions)} regressions against baseline", fg="red"
+        ),
+        err=True,
+    )
+    for reg in regressions:
+        app.echo(
+            message=f"  {reg.key} {reg.metric}: {reg.baseline:.3f} -> "
+            f"{reg.current:.3f} ({reg.change:+.1%})",
+            err=True,
+        )
+    sys.exit(1)
+
+
 @app.command(aliases=["b", "bench"])
 def benchmark(
-    file: Path = app.Argument(..., help="File to benchmark"),
+    file: Path | None = app.Argument(None, help="File to benchmark"),
     algos: str | None = app.Option(
         "all", "--algos", help="Comma-separated list of algorithms"
     ),
@@ -611,15 +1024,33 @@ def benchmark(
         1, "--repeats", help="Number of times to repeat each benchmark"
     ),
     temp_dir: Path | None = app.Option(
-        None, "--temp-dir", help="Temporary directory for benchmark files"
+        None, "--temp-dir", help="Unused: benchmarks now run in memory"
     ),
     update_cache: bool = app.Option(
         False,
         "--update-cache",
         help="Update speed estimates cache with benchmark results",
     ),
+    suite: bool = app.Option(
+        False, "--suite", help="Run the corpus suite instead of a single file"
+    ),
+    corpus_dir: Path | None = app.Option(
+        None, "--corpus-dir", help="Suite corpus directory (default: synthetic)"
+    ),
+    output: Path | None = app.Option(
+        None, "--output", help="Write the suite report as JSON to this path"
+    ),
+    baseline: Path | None = app.Option(
+        None, "--baseline", help="Suite report to compare against"
+    ),
+    threshold: float = app.Option(
+        0.10, "--threshold", help="Throughput drop flagged as a regression"
+    ),
+    quick: bool = app.Option(
+        False, "--quick", help="Suite on a small corpus, one level and thread count"
+    ),
 ) -> None:
-    """Run compression benchmarks on a file.
+    """Run compression benchmarks on a file, or the corpus suite.
 
     Args:
         file: The path to the file to benchmark.
@@ -627,10 +1058,29 @@ def benchmark(
         strategies: Comma-separated list of strategies to use (default: all).
         levels: Comma-separated list of levels to use (default: all).
         repeats: Number of times to repeat each benchmark (default: 1).
-        temp_dir: Temporary directory for benchmark files (default: None).
+        temp_dir: Unused, as benchmarks run in memory (default: None).
         update_cache: If True, update the speed estimates cache with benchmark results (default: False).
+        suite: If True, run every target over the corpus suite (default: False).
+        corpus_dir: Corpus directory for the suite (default: generated).
+        output: Path to write the suite's JSON report to (default: None).
+        baseline: Stored suite report to flag regressions against (default: None).
+        threshold: Relative throughput drop flagged as a regression (default: 0.10).
+        quick: If True, run the suite on a small corpus (default: False).
     """
     try:
+        if suite:
+            _run_suite(corpus_dir, output, baseline, threshold, quick, update_cache)
+            return
+
+        if file is None:
+            app.echo(
+                message=app.style(
+                    text="✗ A file is required without --suite", fg="red"
+                ),
+                err=True,
+            )
+            sys.exit(1)
+
         algo_list: list[str] = []
         if algos and algos.lower() != "all":
             algo_list = [a.strip() for a in algos.split(",") if a.strip()]
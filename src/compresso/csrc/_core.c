@@ -1,32 +1,147 @@
 #define PY_SSIZE_T_CLEAN
+#include "aio.h"
+#include "cancel.h"
 #include "common.h"
+#include "context.h"
+#include "dictionary.h"
+#include "fileio.h"
+#include "progress.h"
+#include "stats.h"
+#include "threadpool.h"
 #include "validate.h"
 #include <Python.h>
+#include <sys/stat.h>
 
 // Error Objects
 PyObject *comp_Error;
 PyObject *comp_HeaderError;
 PyObject *comp_BackendError;
+PyObject *comp_CancelledError;
 
 // ---- Module Methods ----
 
+// O& converter for io_chunk_size: 0 keeps the default, anything else must
+// lie in [IO_CHUNK_MIN, IO_CHUNK_MAX]
+static int io_chunk_converter(PyObject *obj, void *out) {
+  size_t size = PyLong_AsSize_t(obj);
+  if (size == (size_t)-1 && PyErr_Occurred()) {
+    if (PyErr_ExceptionMatches(PyExc_OverflowError)) {
+      PyErr_Clear();
+      size = (size_t)-1; // negative or huge: rejected below
+    } else {
+      return 0;
+    }
+  }
+  if (size != 0 && (size < IO_CHUNK_MIN || size > IO_CHUNK_MAX)) {
+    PyErr_Format(PyExc_ValueError,
+                 "io_chunk_size must be 0 (default) or between %u and %u",
+                 IO_CHUNK_MIN, IO_CHUNK_MAX);
+    return 0;
+  }
+  *(size_t *)out = size;
+  return 1;
+}
+
+// O& converter for io_engine: "stdio", "uring" or "threads" (None = stdio)
+static int io_engine_converter(PyObject *obj, void *out) {
+  const char *name = NULL;
+  if (obj != Py_None) {
+    name = PyUnicode_AsUTF8(obj);
+    if (!name)
+      return 0;
+  }
+  if (io_engine_from_name(name, (IOEngine *)out) != 0) {
+    PyErr_Format(PyExc_ValueError,
+                 "Unknown io_engine: %s (expected 'stdio', 'uring' or "
+                 "'threads')",
+                 name);
+    return 0;
+  }
+  return 1;
+}
+
+// O& converter for stats: None leaves *(PyObject **)out NULL, a dict is
+// stored (borrowed) to be filled with the call's timings
+static int stats_dict_converter(PyObject *obj, void *out) {
+  if (obj != Py_None && !PyDict_Check(obj)) {
+    PyErr_Format(PyExc_TypeError, "stats must be a dict or None, not %.200s",
+                 Py_TYPE(obj)->tp_name);
+    return 0;
+  }
+  *(PyObject **)out = obj == Py_None ? NULL : obj;
+  return 1;
+}
+
+// A budget strategy picks the backend, and unless the caller set them the
+// level and thread count, for an input of `size` bytes; *threads is the
+// allowance on entry (0 = one per CPU). An explicit algorithm leaves the
+// choice to the caller. Returns -1 with ValueError set on a malformed
+// budget, else 0.
+static int resolve_budget(const char *strategy_name, uint64_t size,
+                          AlgoID *algo, int *level, int *threads) {
+  Budget budget;
+  int rc = parse_budget(strategy_name, &budget);
+  if (rc < 0) {
+    PyErr_Format(PyExc_ValueError, "Invalid budget strategy: %s",
+                 strategy_name);
+    return -1;
+  }
+  if (rc == 0 || *algo != ALGO_NONE)
+    return 0;
+
+  init_backends();
+  Calibration choice;
+  if (choose_for_budget(&budget, size, threadpool_resolve_threads(*threads),
+                        &choice) < 0) {
+    return 0; // nothing calibrated is available: the strategy's fallback
+  }
+  *algo = choice.algo;
+  if (*level == -1)
+    *level = choice.level;
+  *threads = choice.threads;
+  return 0;
+}
+
 static PyObject *py_compress_file(PyObject *self __attribute__((unused)),
                                   PyObject *args, PyObject *kwargs) {
   static char *kwlist[] = {"src_path", "dst_path", "algo",
-                           "strategy", "level",    NULL};
+                           "strategy", "level",    "threads",
+                           "seekable", "block_size", "dictionary",
+                           "checksum", "io_chunk_size", "io_engine",
+                           "progress", "cancel", "long_distance",
+                           "window_log", "match_strategy", "stats", NULL};
 
   PyObject *src_path_obj;
   PyObject *dst_path_obj;
   const char *algo_name = NULL;
   const char *strategy_name = NULL;
   int level = -1;
-
-  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|ssi", kwlist,
-                                   &src_path_obj, &dst_path_obj, &algo_name,
-                                   &strategy_name, &level)) {
+  CompressOptions opts = COMPRESS_OPTIONS_INIT;
+  unsigned int block_size = 0;
+  size_t io_chunk = 0;
+  IOEngine engine = IO_ENGINE_STDIO;
+  IOProgress *progress = NULL;
+  IOCancel *cancel = NULL;
+  PyObject *stats = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(
+          args, kwargs, "OO|ssiipIO&pO&O&O&O&piiO&", kwlist, &src_path_obj,
+          &dst_path_obj, &algo_name, &strategy_name, &level, &opts.threads,
+          &opts.seekable, &block_size, dictionary_converter, &opts.dictionary,
+          &opts.checksum, io_chunk_converter, &io_chunk, io_engine_converter,
+          &engine, progress_converter, &progress, cancel_converter, &cancel,
+          &opts.params.long_distance, &opts.params.window_log,
+          &opts.params.match_strategy, stats_dict_converter, &stats)) {
     return NULL; // Error already set
   }
 
+  if (opts.threads < 0) {
+    PyErr_SetString(PyExc_ValueError,
+                    "threads must be >= 0 (0 = one per CPU)");
+    return NULL;
+  }
+  opts.block_size = (uint32_t)block_size;
+
   PyObject *src_path_bytes = PyUnicode_EncodeFSDefault(src_path_obj);
   PyObject *dst_path_bytes = PyUnicode_EncodeFSDefault(dst_path_obj);
   if (!src_path_bytes || !dst_path_bytes) {
@@ -49,13 +164,38 @@ static PyObject *py_compress_file(PyObject *self __attribute__((unused)),
     return NULL;
   }
 
+  struct stat st;
+  uint64_t src_size = stat(src_path, &st) == 0 ? (uint64_t)st.st_size : 0;
+  if (resolve_budget(strategy_name, src_size, &algo, &level, &opts.threads) !=
+      0) {
+    Py_DECREF(src_path_bytes);
+    Py_DECREF(dst_path_bytes);
+    return NULL;
+  }
+
   if (validate_compression_request(algo, strat, level, NULL) != 0) {
     Py_DECREF(src_path_bytes);
     Py_DECREF(dst_path_bytes);
     return NULL;
   }
 
-  if (compress_file(src_path, dst_path, algo, strat, level) != 0) {
+  size_t prev_chunk = io_set_chunk_size(io_chunk);
+  IOEngine prev_engine = io_set_engine(engine);
+  IOProgress *prev_progress = io_set_progress(progress);
+  IOCancel *prev_cancel = io_set_cancel(cancel);
+  StatsSpan span;
+  stats_span_begin(&span);
+  int rc = compress_file(src_path, dst_path, algo, strat, level, &opts);
+  stats_span_end(&span);
+  if (rc != 0)
+    cancel_check_failure(dst_path);
+  io_set_cancel(prev_cancel);
+  io_set_progress(prev_progress);
+  io_set_engine(prev_engine);
+  io_set_chunk_size(prev_chunk);
+  if (rc == 0 && stats)
+    rc = stats_fill_dict(stats, &span, src_path, dst_path);
+  if (rc != 0) {
     Py_DECREF(src_path_bytes);
     Py_DECREF(dst_path_bytes);
     return NULL; // Error already set
@@ -68,17 +208,37 @@ static PyObject *py_compress_file(PyObject *self __attribute__((unused)),
 
 static PyObject *py_decompress_file(PyObject *self __attribute__((unused)),
                                     PyObject *args, PyObject *kwargs) {
-  static char *kwlist[] = {"src_path", "dst_path", "algo", NULL};
+  static char *kwlist[] = {"src_path",      "dst_path",  "algo",
+                           "threads",       "dictionary", "io_chunk_size",
+                           "io_engine",     "progress",  "cancel",
+                           "stats",         NULL};
 
   PyObject *src_path_obj;
   PyObject *dst_path_obj;
   const char *algo_name = NULL;
-
-  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|s", kwlist, &src_path_obj,
-                                   &dst_path_obj, &algo_name)) {
+  int threads = 1;
+  CDictionary *dict = NULL;
+  size_t io_chunk = 0;
+  IOEngine engine = IO_ENGINE_STDIO;
+  IOProgress *progress = NULL;
+  IOCancel *cancel = NULL;
+  PyObject *stats = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(
+          args, kwargs, "OO|siO&O&O&O&O&O&", kwlist, &src_path_obj,
+          &dst_path_obj, &algo_name, &threads, dictionary_converter, &dict,
+          io_chunk_converter, &io_chunk, io_engine_converter, &engine,
+          progress_converter, &progress, cancel_converter, &cancel,
+          stats_dict_converter, &stats)) {
     return NULL; // Error already set
   }
 
+  if (threads < 0) {
+    PyErr_SetString(PyExc_ValueError,
+                    "threads must be >= 0 (0 = one per CPU)");
+    return NULL;
+  }
+
   PyObject *src_path_bytes = PyUnicode_EncodeFSDefault(src_path_obj);
   PyObject *dst_path_bytes = PyUnicode_EncodeFSDefault(dst_path_obj);
   if (!src_path_bytes || !dst_path_bytes) {
@@ -100,7 +260,23 @@ static PyObject *py_decompress_file(PyObject *self __attribute__((unused)),
     return NULL;
   }
 
-  if (decompress_file(src_path, dst_path, algo) != 0) {
+  size_t prev_chunk = io_set_chunk_size(io_chunk);
+  IOEngine prev_engine = io_set_engine(engine);
+  IOProgress *prev_progress = io_set_progress(progress);
+  IOCancel *prev_cancel = io_set_cancel(cancel);
+  StatsSpan span;
+  stats_span_begin(&span);
+  int rc = decompress_file(src_path, dst_path, algo, threads, dict);
+  stats_span_end(&span);
+  if (rc != 0)
+    cancel_check_failure(dst_path);
+  io_set_cancel(prev_cancel);
+  io_set_progress(prev_progress);
+  io_set_engine(prev_engine);
+  io_set_chunk_size(prev_chunk);
+  if (rc == 0 && stats)
+    rc = stats_fill_dict(stats, &span, src_path, dst_path);
+  if (rc != 0) {
     Py_DECREF(src_path_bytes);
     Py_DECREF(dst_path_bytes);
     return NULL; // Error already set
@@ -111,29 +287,770 @@ static PyObject *py_decompress_file(PyObject *self __attribute__((unused)),
   return PyLong_FromLong(0);
 }
 
+static PyObject *py_decompress_range(PyObject *self __attribute__((unused)),
+                                     PyObject *args, PyObject *kwargs) {
+  static char *kwlist[] = {"path", "offset", "length", "threads", "dictionary",
+                           NULL};
+
+  PyObject *path_obj;
+  long long offset;
+  long long length;
+  int threads = 1;
+  CDictionary *dict = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OLL|iO&", kwlist, &path_obj,
+                                   &offset, &length, &threads,
+                                   dictionary_converter, &dict)) {
+    return NULL; // Error already set
+  }
+
+  if (offset < 0 || length < 0) {
+    PyErr_SetString(PyExc_ValueError, "offset and length must be >= 0");
+    return NULL;
+  }
+
+  if (threads < 0) {
+    PyErr_SetString(PyExc_ValueError,
+                    "threads must be >= 0 (0 = one per CPU)");
+    return NULL;
+  }
+
+  PyObject *path_bytes = PyUnicode_EncodeFSDefault(path_obj);
+  if (!path_bytes) {
+    return NULL; // Error already set
+  }
+
+  PyObject *result =
+      decompress_range(PyBytes_AsString(path_bytes), (uint64_t)offset,
+                       (uint64_t)length, threads, dict);
+  Py_DECREF(path_bytes);
+  return result;
+}
+
+static PyObject *py_verify_file(PyObject *self __attribute__((unused)),
+                                PyObject *args, PyObject *kwargs) {
+  static char *kwlist[] = {"path",          "threads",   "dictionary",
+                           "io_chunk_size", "io_engine", "progress",
+                           "cancel",        NULL};
+
+  PyObject *path_obj;
+  int threads = 1;
+  CDictionary *dict = NULL;
+  size_t io_chunk = 0;
+  IOEngine engine = IO_ENGINE_STDIO;
+  IOProgress *progress = NULL;
+  IOCancel *cancel = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(
+          args, kwargs, "O|iO&O&O&O&O&", kwlist, &path_obj, &threads,
+          dictionary_converter, &dict, io_chunk_converter, &io_chunk,
+          io_engine_converter, &engine, progress_converter, &progress,
+          cancel_converter, &cancel)) {
+    return NULL; // Error already set
+  }
+
+  if (threads < 0) {
+    PyErr_SetString(PyExc_ValueError,
+                    "threads must be >= 0 (0 = one per CPU)");
+    return NULL;
+  }
+
+  PyObject *path_bytes = PyUnicode_EncodeFSDefault(path_obj);
+  if (!path_bytes) {
+    return NULL; // Error already set
+  }
+
+  size_t prev_chunk = io_set_chunk_size(io_chunk);
+  IOEngine prev_engine = io_set_engine(engine);
+  IOProgress *prev_progress = io_set_progress(progress);
+  IOCancel *prev_cancel = io_set_cancel(cancel);
+  int rc = verify_file(PyBytes_AsString(path_bytes), threads, dict);
+  if (rc != 0)
+    cancel_check_failure(NULL);
+  io_set_cancel(prev_cancel);
+  io_set_progress(prev_progress);
+  io_set_engine(prev_engine);
+  io_set_chunk_size(prev_chunk);
+  Py_DECREF(path_bytes);
+  if (rc != 0) {
+    return NULL; // Error already set
+  }
+  Py_RETURN_NONE;
+}
+
+// ---- Batch Methods ----
+
+// Turn a sequence of (src_path, dst_path) pairs into batch items; the
+// encoded paths live in *keep, which the caller releases after the run
+static BatchItem *batch_items_from_pairs(PyObject *pairs, PyObject **keep,
+                                         Py_ssize_t *count) {
+  PyObject *seq = PySequence_Fast(
+      pairs, "pairs must be a sequence of (src_path, dst_path) tuples");
+  if (!seq) {
+    return NULL; // Error already set
+  }
+
+  Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+  PyObject *paths = PyList_New(0);
+  BatchItem *items = PyMem_Calloc(n > 0 ? (size_t)n : 1, sizeof(BatchItem));
+  if (!paths || !items) {
+    if (!items)
+      PyErr_NoMemory();
+    goto fail;
+  }
+
+  for (Py_ssize_t i = 0; i < n; i++) {
+    PyObject *pair = PySequence_Fast_GET_ITEM(seq, i);
+    PyObject *src = NULL;
+    PyObject *dst = NULL;
+    if (!PyTuple_Check(pair) || PyTuple_GET_SIZE(pair) != 2) {
+      PyErr_Format(PyExc_TypeError,
+                   "pairs[%zd] must be a (src_path, dst_path) tuple", i);
+      goto fail;
+    }
+    if (!PyArg_ParseTuple(pair, "O&O&", PyUnicode_FSConverter, &src,
+                          PyUnicode_FSConverter, &dst)) {
+      Py_XDECREF(src);
+      goto fail;
+    }
+    int appended = PyList_Append(paths, src) == 0 &&
+                   PyList_Append(paths, dst) == 0;
+    items[i].src_path = PyBytes_AS_STRING(src);
+    items[i].dst_path = PyBytes_AS_STRING(dst);
+    Py_DECREF(src);
+    Py_DECREF(dst);
+    if (!appended) {
+      goto fail;
+    }
+  }
+
+  Py_DECREF(seq);
+  *keep = paths;
+  *count = n;
+  return items;
+
+fail:
+  Py_DECREF(seq);
+  Py_XDECREF(paths);
+  PyMem_Free(items);
+  return NULL;
+}
+
+// One entry per item: None, or the exception that file raised
+static PyObject *batch_results(BatchItem *items, Py_ssize_t count) {
+  PyObject *results = PyList_New(count);
+  for (Py_ssize_t i = 0; i < count; i++) {
+    PyObject *entry = items[i].error ? items[i].error : Py_NewRef(Py_None);
+    items[i].error = NULL;
+    if (results) {
+      PyList_SET_ITEM(results, i, entry);
+    } else {
+      Py_DECREF(entry);
+    }
+  }
+  return results;
+}
+
+static PyObject *py_compress_many(PyObject *self __attribute__((unused)),
+                                  PyObject *args, PyObject *kwargs) {
+  static char *kwlist[] = {"pairs",      "algo",          "strategy",
+                           "level",      "threads",       "seekable",
+                           "block_size", "dictionary",    "checksum",
+                           "io_chunk_size", "io_engine", "progress",
+                           "cancel",     "long_distance", "window_log",
+                           "match_strategy", NULL};
+
+  PyObject *pairs;
+  const char *algo_name = NULL;
+  const char *strategy_name = NULL;
+  int level = -1;
+  int threads = 0;
+  CompressOptions opts = COMPRESS_OPTIONS_INIT;
+  unsigned int block_size = 0;
+  size_t io_chunk = 0;
+  IOEngine engine = IO_ENGINE_STDIO;
+  IOProgress *progress = NULL;
+  IOCancel *cancel = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(
+          args, kwargs, "O|ssiipIO&pO&O&O&O&pii", kwlist, &pairs, &algo_name,
+          &strategy_name, &level, &threads, &opts.seekable, &block_size,
+          dictionary_converter, &opts.dictionary, &opts.checksum,
+          io_chunk_converter, &io_chunk, io_engine_converter, &engine,
+          progress_converter, &progress, cancel_converter, &cancel,
+          &opts.params.long_distance, &opts.params.window_log,
+          &opts.params.match_strategy)) {
+    return NULL; // Error already set
+  }
+
+  if (threads < 0) {
+    PyErr_SetString(PyExc_ValueError,
+                    "threads must be >= 0 (0 = one per CPU)");
+    return NULL;
+  }
+  opts.block_size = (uint32_t)block_size;
+
+  AlgoID algo = algo_from_string(algo_name);
+  Strategy strat = strategy_from_string(strategy_name);
+
+  if (algo_name && algo_name[0] != '\0' && algo == ALGO_NONE) {
+    PyErr_Format(PyExc_ValueError, "Unknown compression algorithm: %s",
+                 algo_name);
+    return NULL;
+  }
+
+  PyObject *keep;
+  Py_ssize_t count;
+  BatchItem *items = batch_items_from_pairs(pairs, &keep, &count);
+  if (!items) {
+    return NULL; // Error already set
+  }
+
+  // Files compress side by side, one stream each: a budget holds per file,
+  // so the largest decides
+  uint64_t largest = 0;
+  for (Py_ssize_t i = 0; i < count; i++) {
+    struct stat st;
+    if (stat(items[i].src_path, &st) == 0 && (uint64_t)st.st_size > largest)
+      largest = (uint64_t)st.st_size;
+  }
+  int stream_threads = 1;
+  if (resolve_budget(strategy_name, largest, &algo, &level,
+                     &stream_threads) != 0 ||
+      validate_compression_request(algo, strat, level, NULL) != 0) {
+    PyMem_Free(items);
+    Py_DECREF(keep);
+    return NULL;
+  }
+
+  size_t prev_chunk = io_set_chunk_size(io_chunk);
+  IOEngine prev_engine = io_set_engine(engine);
+  IOProgress *prev_progress = io_set_progress(progress);
+  IOCancel *prev_cancel = io_set_cancel(cancel);
+  compress_many(items, (size_t)count, algo, strat, level, &opts, threads);
+  io_set_cancel(prev_cancel);
+  io_set_progress(prev_progress);
+  io_set_engine(prev_engine);
+  io_set_chunk_size(prev_chunk);
+
+  PyObject *results = batch_results(items, count);
+  PyMem_Free(items);
+  Py_DECREF(keep);
+  return results;
+}
+
+static PyObject *py_decompress_many(PyObject *self __attribute__((unused)),
+                                    PyObject *args, PyObject *kwargs) {
+  static char *kwlist[] = {"pairs",      "algo",          "threads",
+                           "dictionary", "io_chunk_size", "io_engine",
+                           "progress",   "cancel",        NULL};
+
+  PyObject *pairs;
+  const char *algo_name = NULL;
+  int threads = 0;
+  CDictionary *dict = NULL;
+  size_t io_chunk = 0;
+  IOEngine engine = IO_ENGINE_STDIO;
+  IOProgress *progress = NULL;
+  IOCancel *cancel = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(
+          args, kwargs, "O|siO&O&O&O&O&", kwlist, &pairs, &algo_name,
+          &threads, dictionary_converter, &dict, io_chunk_converter,
+          &io_chunk, io_engine_converter, &engine, progress_converter,
+          &progress, cancel_converter, &cancel)) {
+    return NULL; // Error already set
+  }
+
+  if (threads < 0) {
+    PyErr_SetString(PyExc_ValueError,
+                    "threads must be >= 0 (0 = one per CPU)");
+    return NULL;
+  }
+
+  AlgoID algo = algo_from_string(algo_name);
+
+  if (algo_name && algo_name[0] != '\0' && algo == ALGO_NONE) {
+    PyErr_Format(PyExc_ValueError, "Unknown decompression algorithm: %s",
+                 algo_name);
+    return NULL;
+  }
+
+  PyObject *keep;
+  Py_ssize_t count;
+  BatchItem *items = batch_items_from_pairs(pairs, &keep, &count);
+  if (!items) {
+    return NULL; // Error already set
+  }
+
+  size_t prev_chunk = io_set_chunk_size(io_chunk);
+  IOEngine prev_engine = io_set_engine(engine);
+  IOProgress *prev_progress = io_set_progress(progress);
+  IOCancel *prev_cancel = io_set_cancel(cancel);
+  decompress_many(items, (size_t)count, algo, dict, threads);
+  io_set_cancel(prev_cancel);
+  io_set_progress(prev_progress);
+  io_set_engine(prev_engine);
+  io_set_chunk_size(prev_chunk);
+
+  PyObject *results = batch_results(items, count);
+  PyMem_Free(items);
+  Py_DECREF(keep);
+  return results;
+}
+
+// ---- In-Memory Methods ----
+
+// Shared by the bytes/into methods: an empty or missing name means "from
+// the strategy" (compression) or "from the header" (decompression)
+static int parse_algo_name(const char *algo_name, const char *op,
+                           AlgoID *algo) {
+  *algo = algo_from_string(algo_name);
+  if (algo_name && algo_name[0] != '\0' && *algo == ALGO_NONE) {
+    PyErr_Format(PyExc_ValueError, "Unknown %s algorithm: %s", op, algo_name);
+    return -1;
+  }
+  return 0;
+}
+
+static PyObject *py_compress_bytes(PyObject *self __attribute__((unused)),
+                                   PyObject *args, PyObject *kwargs) {
+  static char *kwlist[] = {"data", "algo", "strategy", "level", "dictionary",
+                           NULL};
+
+  Py_buffer data;
+  const char *algo_name = NULL;
+  const char *strategy_name = NULL;
+  int level = -1;
+  CDictionary *dict = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y*|ssiO&", kwlist, &data,
+                                   &algo_name, &strategy_name, &level,
+                                   dictionary_converter, &dict)) {
+    return NULL; // Error already set
+  }
+
+  AlgoID algo;
+  Strategy strat = strategy_from_string(strategy_name);
+  int threads = 1; // one buffer, one stream
+  PyObject *result = NULL;
+
+  if (parse_algo_name(algo_name, "compression", &algo) == 0 &&
+      resolve_budget(strategy_name, (uint64_t)data.len, &algo, &level,
+                     &threads) == 0 &&
+      validate_compression_request(algo, strat, level, NULL) == 0) {
+    result = compress_bytes((const unsigned char *)data.buf, (size_t)data.len,
+                            algo, strat, level, dict, NULL);
+  }
+
+  PyBuffer_Release(&data);
+  return result;
+}
+
+static PyObject *py_compress_bound(PyObject *self __attribute__((unused)),
+                                   PyObject *args, PyObject *kwargs) {
+  static char *kwlist[] = {"size", "algo", "strategy", NULL};
+
+  Py_ssize_t size;
+  const char *algo_name = NULL;
+  const char *strategy_name = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "n|ss", kwlist, &size,
+                                   &algo_name, &strategy_name)) {
+    return NULL; // Error already set
+  }
+
+  if (size < 0) {
+    PyErr_SetString(PyExc_ValueError, "size must be >= 0");
+    return NULL;
+  }
+
+  AlgoID algo;
+  if (parse_algo_name(algo_name, "compression", &algo) != 0) {
+    return NULL;
+  }
+
+  size_t bound = compress_bound((size_t)size, algo,
+                                strategy_from_string(strategy_name));
+  return bound == 0 ? NULL : PyLong_FromSize_t(bound);
+}
+
+static PyObject *py_compress_into(PyObject *self __attribute__((unused)),
+                                  PyObject *args, PyObject *kwargs) {
+  static char *kwlist[] = {"data",  "out",        "algo", "strategy",
+                           "level", "dictionary", NULL};
+
+  Py_buffer data;
+  Py_buffer out;
+  const char *algo_name = NULL;
+  const char *strategy_name = NULL;
+  int level = -1;
+  CDictionary *dict = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y*w*|ssiO&", kwlist, &data,
+                                   &out, &algo_name, &strategy_name, &level,
+                                   dictionary_converter, &dict)) {
+    return NULL; // Error already set
+  }
+
+  AlgoID algo;
+  Strategy strat = strategy_from_string(strategy_name);
+  Py_ssize_t written = -1;
+
+  if (parse_algo_name(algo_name, "compression", &algo) == 0 &&
+      validate_compression_request(algo, strat, level, NULL) == 0) {
+    written = compress_into((const unsigned char *)data.buf, (size_t)data.len,
+                            (unsigned char *)out.buf, (size_t)out.len, algo,
+                            strat, level, dict, NULL);
+  }
+
+  PyBuffer_Release(&data);
+  PyBuffer_Release(&out);
+  return written < 0 ? NULL : PyLong_FromSsize_t(written);
+}
+
+static PyObject *py_decompress_bytes(PyObject *self __attribute__((unused)),
+                                     PyObject *args, PyObject *kwargs) {
+  static char *kwlist[] = {"data", "algo", "dictionary", NULL};
+
+  Py_buffer data;
+  const char *algo_name = NULL;
+  CDictionary *dict = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y*|sO&", kwlist, &data,
+                                   &algo_name, dictionary_converter, &dict)) {
+    return NULL; // Error already set
+  }
+
+  AlgoID algo;
+  PyObject *result = NULL;
+
+  if (parse_algo_name(algo_name, "decompression", &algo) == 0) {
+    result =
+        decompress_bytes((const unsigned char *)data.buf, (size_t)data.len, algo,
+                         dict, NULL);
+  }
+
+  PyBuffer_Release(&data);
+  return result;
+}
+
+static PyObject *py_decompress_into(PyObject *self __attribute__((unused)),
+                                    PyObject *args, PyObject *kwargs) {
+  static char *kwlist[] = {"data", "out", "algo", "dictionary", NULL};
+
+  Py_buffer data;
+  Py_buffer out;
+  const char *algo_name = NULL;
+  CDictionary *dict = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y*w*|sO&", kwlist, &data,
+                                   &out, &algo_name, dictionary_converter,
+                                   &dict)) {
+    return NULL; // Error already set
+  }
+
+  AlgoID algo;
+  Py_ssize_t written = -1;
+
+  if (parse_algo_name(algo_name, "decompression", &algo) == 0) {
+    written = decompress_into((const unsigned char *)data.buf,
+                              (size_t)data.len, (unsigned char *)out.buf,
+                              (size_t)out.len, algo, dict, NULL);
+  }
+
+  PyBuffer_Release(&data);
+  PyBuffer_Release(&out);
+  return written < 0 ? NULL : PyLong_FromSsize_t(written);
+}
+
+// ---- Benchmark ----
+
+static PyObject *py_benchmark(PyObject *self __attribute__((unused)),
+                              PyObject *args, PyObject *kwargs) {
+  static char *kwlist[] = {"data",   "algo",    "strategy", "level",
+                           "repeats", "warmup", "threads",  NULL};
+
+  Py_buffer data;
+  const char *algo_name = NULL;
+  const char *strategy_name = NULL;
+  int level = -1;
+  int repeats = 5;
+  int warmup = 1;
+  int threads = 1;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y*|ssiiii", kwlist, &data,
+                                   &algo_name, &strategy_name, &level,
+                                   &repeats, &warmup, &threads)) {
+    return NULL; // Error already set
+  }
+
+  AlgoID algo;
+  Strategy strat = strategy_from_string(strategy_name);
+  PyObject *result = NULL;
+
+  if (repeats < 1) {
+    PyErr_SetString(PyExc_ValueError, "repeats must be >= 1");
+  } else if (warmup < 0) {
+    PyErr_SetString(PyExc_ValueError, "warmup must be >= 0");
+  } else if (threads < 0) {
+    PyErr_SetString(PyExc_ValueError,
+                    "threads must be >= 0 (0 = one per CPU)");
+  } else if (parse_algo_name(algo_name, "compression", &algo) == 0 &&
+             validate_compression_request(algo, strat, level, NULL) == 0) {
+    result = run_benchmark((const unsigned char *)data.buf, (size_t)data.len,
+                           algo, strat, level, repeats, warmup, threads);
+  }
+
+  PyBuffer_Release(&data);
+  return result;
+}
+
+// ---- Calibration ----
+
+static PyObject *calibration_to_dict(const Calibration *c) {
+  const CBackend *backend = find_backend_by_id(c->algo);
+  return Py_BuildValue("{s:s,s:i,s:i,s:d,s:d,s:d}", "algo",
+                       backend ? backend->name : "unknown", "level", c->level,
+                       "threads", c->threads, "comp_mb_s", c->comp_mb_s,
+                       "decomp_mb_s", c->decomp_mb_s, "ratio", c->ratio);
+}
+
+// One mapping of set_calibration's list; -1 with an exception set
+static int calibration_from_dict(PyObject *item, Calibration *c) {
+  static char *kwlist[] = {"algo",      "level",       "threads",
+                           "comp_mb_s", "decomp_mb_s", "ratio",
+                           NULL};
+  const char *algo_name = NULL;
+  c->level = -1;
+  c->threads = 1;
+  c->comp_mb_s = 0.0;
+  c->decomp_mb_s = 0.0;
+  c->ratio = 0.0;
+
+  if (!PyDict_Check(item)) {
+    PyErr_SetString(PyExc_TypeError, "calibration entries must be dicts");
+    return -1;
+  }
+  PyObject *empty = PyTuple_New(0);
+  if (!empty)
+    return -1;
+  int ok = PyArg_ParseTupleAndKeywords(empty, item, "s|iiddd:set_calibration",
+                                       kwlist, &algo_name, &c->level,
+                                       &c->threads, &c->comp_mb_s,
+                                       &c->decomp_mb_s, &c->ratio);
+  Py_DECREF(empty);
+  if (!ok)
+    return -1;
+
+  c->algo = algo_from_string(algo_name);
+  if (c->algo == ALGO_NONE) {
+    PyErr_Format(PyExc_ValueError, "Unknown compression algorithm: %s",
+                 algo_name);
+    return -1;
+  }
+  if (c->threads < 1 || !(c->comp_mb_s > 0.0) || !(c->ratio > 0.0)) {
+    PyErr_Format(PyExc_ValueError,
+                 "calibration for %s needs threads >= 1 and positive "
+                 "comp_mb_s and ratio",
+                 algo_name);
+    return -1;
+  }
+  return 0;
+}
+
+static PyObject *py_set_calibration(PyObject *self __attribute__((unused)),
+                                    PyObject *args) {
+  PyObject *entries;
+
+  if (!PyArg_ParseTuple(args, "O", &entries)) {
+    return NULL; // Error already set
+  }
+
+  PyObject *seq = PySequence_Fast(entries, "calibration must be a sequence");
+  if (!seq)
+    return NULL;
+
+  Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+  if (count > CALIBRATION_MAX) {
+    PyErr_Format(PyExc_ValueError, "at most %d calibration entries",
+                 CALIBRATION_MAX);
+    Py_DECREF(seq);
+    return NULL;
+  }
+
+  Calibration table[CALIBRATION_MAX];
+  for (Py_ssize_t i = 0; i < count; i++) {
+    if (calibration_from_dict(PySequence_Fast_GET_ITEM(seq, i), &table[i]) !=
+        0) {
+      Py_DECREF(seq);
+      return NULL;
+    }
+  }
+  Py_DECREF(seq);
+
+  set_calibration(table, (size_t)count);
+  Py_RETURN_NONE;
+}
+
+static PyObject *py_get_calibration(PyObject *self __attribute__((unused)),
+                                    PyObject *args __attribute__((unused))) {
+  Calibration table[CALIBRATION_MAX];
+  size_t count = get_calibration(table, CALIBRATION_MAX);
+
+  PyObject *list = PyList_New((Py_ssize_t)count);
+  if (!list)
+    return NULL;
+  for (size_t i = 0; i < count; i++) {
+    PyObject *entry = calibration_to_dict(&table[i]);
+    if (!entry) {
+      Py_DECREF(list);
+      return NULL;
+    }
+    PyList_SET_ITEM(list, (Py_ssize_t)i, entry);
+  }
+  return list;
+}
+
+static PyObject *py_choose_for_budget(PyObject *self __attribute__((unused)),
+                                      PyObject *args, PyObject *kwargs) {
+  static char *kwlist[] = {"strategy", "size", "threads", NULL};
+
+  const char *strategy_name;
+  unsigned long long size;
+  int threads = 0;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sK|i", kwlist,
+                                   &strategy_name, &size, &threads)) {
+    return NULL; // Error already set
+  }
+
+  if (threads < 0) {
+    PyErr_SetString(PyExc_ValueError,
+                    "threads must be >= 0 (0 = one per CPU)");
+    return NULL;
+  }
+
+  Budget budget;
+  if (parse_budget(strategy_name, &budget) != 1) {
+    PyErr_Format(PyExc_ValueError, "Invalid budget strategy: %s",
+                 strategy_name);
+    return NULL;
+  }
+
+  init_backends();
+  Calibration choice;
+  int met = choose_for_budget(&budget, (uint64_t)size,
+                              threadpool_resolve_threads(threads), &choice);
+  if (met < 0) {
+    PyErr_SetString(PyExc_ValueError,
+                    "No available compression backend found");
+    return NULL;
+  }
+
+  const CBackend *backend = find_backend_by_id(choice.algo);
+  return Py_BuildValue(
+      "{s:s,s:i,s:i,s:d,s:d,s:d,s:d,s:O}", "algo", backend->name, "level",
+      choice.level, "threads", choice.threads, "comp_mb_s", choice.comp_mb_s,
+      "decomp_mb_s", choice.decomp_mb_s, "ratio", choice.ratio,
+      "estimated_seconds", (double)size / (1024.0 * 1024.0) / choice.comp_mb_s,
+      "meets_budget", met ? Py_True : Py_False);
+}
+
+// ---- Statistics ----
+
+static PyObject *py_get_stats(PyObject *self __attribute__((unused)),
+                              PyObject *args __attribute__((unused))) {
+  return stats_snapshot();
+}
+
+static PyObject *py_reset_stats(PyObject *self __attribute__((unused)),
+                                PyObject *args __attribute__((unused))) {
+  stats_reset();
+  Py_RETURN_NONE;
+}
+
+// ---- Dictionaries ----
+
+static PyObject *py_train_dictionary(PyObject *self __attribute__((unused)),
+                                     PyObject *args, PyObject *kwargs) {
+  static char *kwlist[] = {"samples", "size", "algo", NULL};
+
+  PyObject *samples;
+  Py_ssize_t size = 112640; // zstd's default: 110 KiB
+  const char *algo_name = "zstd";
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|ns", kwlist, &samples,
+                                   &size, &algo_name)) {
+    return NULL; // Error already set
+  }
+
+  if (size < 256) {
+    PyErr_SetString(PyExc_ValueError, "size must be at least 256 bytes");
+    return NULL;
+  }
+
+  AlgoID algo;
+  if (parse_algo_name(algo_name, "compression", &algo) != 0) {
+    return NULL;
+  }
+
+  init_backends();
+  const CBackend *backend = find_backend_by_id(algo);
+  if (!backend) {
+    PyErr_SetString(PyExc_ValueError,
+                    "Specified compression algorithm not available");
+    return NULL;
+  }
+
+  return dictionary_train(samples, (size_t)size, backend);
+}
+
 // ---- Archive Operations ----
 
 static PyObject *py_create_archive(PyObject *self __attribute__((unused)),
                                    PyObject *args, PyObject *kwargs) {
   static char *kwlist[] = {"output_path", "format", "input_paths",
-                           "compression_level", NULL};
+                           "compression_level", "threads", "base",
+                           "cancel", "catalog", NULL};
 
   const char *output_path = NULL;
   const char *format_name = NULL;
   PyObject *input_paths_obj = NULL;
   int compression_level = -1;
+  int threads = 1;
+  const char *base = NULL;
+  IOCancel *cancel = NULL;
+  int catalog = 0;
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ssO|i", kwlist, &output_path,
-                                   &format_name, &input_paths_obj,
-                                   &compression_level)) {
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ssO|iizO&p", kwlist,
+                                   &output_path, &format_name,
+                                   &input_paths_obj, &compression_level,
+                                   &threads, &base, cancel_converter, &cancel,
+                                   &catalog)) {
     return NULL; // Error already set
   }
 
+  if (threads < 0) {
+    PyErr_SetString(PyExc_ValueError,
+                    "threads must be >= 0 (0 = one per CPU)");
+    return NULL;
+  }
+
   CompressionPipeline pipe = pipeline_from_name(format_name, compression_level);
   if (pipe.archive == ARCHIVE_NONE && pipe.codec == FORMAT_UNKNOWN) {
     PyErr_Format(PyExc_ValueError, "Unknown archive format: %s", format_name);
     return NULL;
   }
+  pipe.threads = threads;
+  pipe.base = base;
+  pipe.catalog = catalog;
+
+  if (base && pipe.archive != ARCHIVE_CDAR) {
+    PyErr_SetString(PyExc_ValueError,
+                    "base is only supported by the cdar archive format");
+    return NULL;
+  }
 
   if (validate_compression_request(ALGO_NONE, STRAT_BALANCED, compression_level,
                                    &pipe) != 0) {
@@ -161,8 +1078,12 @@ static PyObject *py_create_archive(PyObject *self __attribute__((unused)),
     input_paths[i] = PyUnicode_AsUTF8(item);
   }
 
+  IOCancel *prev_cancel = io_set_cancel(cancel);
   int result =
       create_archive(output_path, &pipe, input_paths, (size_t)num_paths);
+  if (result != 0)
+    cancel_check_failure(output_path);
+  io_set_cancel(prev_cancel);
   free(input_paths);
   if (result != 0) {
     return NULL; // Error already set
@@ -173,17 +1094,27 @@ static PyObject *py_create_archive(PyObject *self __attribute__((unused)),
 
 static PyObject *py_extract_archive(PyObject *self __attribute__((unused)),
                                     PyObject *args, PyObject *kwargs) {
-  static char *kwlist[] = {"archive_path", "output_dir", "files", NULL};
+  static char *kwlist[] = {"archive_path", "output_dir", "files", "threads",
+                           "cancel", NULL};
 
   const char *archive_path = NULL;
   const char *output_dir = NULL;
   PyObject *files_obj = NULL;
+  int threads = 1;
+  IOCancel *cancel = NULL;
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ssO", kwlist, &archive_path,
-                                   &output_dir, &files_obj)) {
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ss|OiO&", kwlist,
+                                   &archive_path, &output_dir, &files_obj,
+                                   &threads, cancel_converter, &cancel)) {
     return NULL; // Error already set
   }
 
+  if (threads < 0) {
+    PyErr_SetString(PyExc_ValueError,
+                    "threads must be >= 0 (0 = one per CPU)");
+    return NULL;
+  }
+
   const char **files = NULL;
   size_t num_files = 0;
 
@@ -202,7 +1133,13 @@ static PyObject *py_extract_archive(PyObject *self __attribute__((unused)),
     }
   }
 
-  int result = extract_archive(archive_path, output_dir, files, num_files);
+  // Entries already written stay; the one cut short is removed
+  IOCancel *prev_cancel = io_set_cancel(cancel);
+  int result =
+      extract_archive(archive_path, output_dir, files, num_files, threads);
+  if (result != 0)
+    cancel_check_failure(NULL);
+  io_set_cancel(prev_cancel);
   if (files)
     free(files);
   if (result != 0) {
@@ -229,24 +1166,108 @@ static PyObject *py_list_archive_contents(PyObject *self
   return file_list;
 }
 
+static PyObject *py_list_archive_entries(PyObject *self
+                                         __attribute__((unused)),
+                                         PyObject *args) {
+  const char *archive_path = NULL;
+
+  if (!PyArg_ParseTuple(args, "s", &archive_path)) {
+    return NULL; // Error already set
+  }
+
+  PyObject *entries = list_archive_entries(archive_path);
+  if (!entries) {
+    return NULL; // Error already set
+  }
+
+  return entries;
+}
+
+static PyObject *py_convert_archive(PyObject *self __attribute__((unused)),
+                                    PyObject *args, PyObject *kwargs) {
+  static char *kwlist[] = {"input_path",        "output_path", "format",
+                           "compression_level", "threads",     "cancel",
+                           NULL};
+
+  const char *input_path = NULL;
+  const char *output_path = NULL;
+  const char *format_name = NULL;
+  int compression_level = -1;
+  int threads = 1;
+  IOCancel *cancel = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sss|iiO&", kwlist,
+                                   &input_path, &output_path, &format_name,
+                                   &compression_level, &threads,
+                                   cancel_converter, &cancel)) {
+    return NULL; // Error already set
+  }
+
+  if (threads < 0) {
+    PyErr_SetString(PyExc_ValueError,
+                    "threads must be >= 0 (0 = one per CPU)");
+    return NULL;
+  }
+
+  CompressionPipeline pipe = pipeline_from_name(format_name, compression_level);
+  if (pipe.archive == ARCHIVE_NONE) {
+    PyErr_Format(PyExc_ValueError, "Unknown archive format: %s", format_name);
+    return NULL;
+  }
+  pipe.threads = threads;
+
+  if (validate_compression_request(ALGO_NONE, STRAT_BALANCED, compression_level,
+                                   &pipe) != 0) {
+    return NULL;
+  }
+
+  IOCancel *prev_cancel = io_set_cancel(cancel);
+  int result = convert_archive_format(input_path, output_path, &pipe);
+  if (result != 0)
+    cancel_check_failure(output_path);
+  io_set_cancel(prev_cancel);
+  if (result != 0) {
+    return NULL; // Error already set
+  }
+
+  Py_RETURN_NONE;
+}
+
 // ---- Standalone Methods ----
 
 static PyObject *py_compress_standalone(PyObject *self __attribute__((unused)),
                                         PyObject *args, PyObject *kwargs) {
   static char *kwlist[] = {"input_path", "output_path", "format",
-                           "compression_level", NULL};
+                           "compression_level", "io_chunk_size", "io_engine",
+                           "progress", "cancel", "threads", "long_distance",
+                           "window_log", "match_strategy", NULL};
 
   const char *input_path = NULL;
   const char *output_path = NULL;
   const char *format_name = NULL;
   int compression_level = -1;
-
-  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sss|i", kwlist, &input_path,
-                                   &output_path, &format_name,
-                                   &compression_level)) {
+  int threads = 1;
+  CodecParams params = CODEC_PARAMS_INIT;
+  size_t io_chunk = 0;
+  IOEngine engine = IO_ENGINE_STDIO;
+  IOProgress *progress = NULL;
+  IOCancel *cancel = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(
+          args, kwargs, "sss|iO&O&O&O&ipii", kwlist, &input_path,
+          &output_path, &format_name, &compression_level, io_chunk_converter,
+          &io_chunk, io_engine_converter, &engine, progress_converter,
+          &progress, cancel_converter, &cancel, &threads,
+          &params.long_distance, &params.window_log, &params.match_strategy)) {
     return NULL; // Error already set
   }
 
+  if (threads < 0) {
+    PyErr_SetString(PyExc_ValueError,
+                    "threads must be >= 0 (0 = one per CPU)");
+    return NULL;
+  }
+
   Format format = format_from_name(format_name);
   if (format == FORMAT_UNKNOWN) {
     PyErr_Format(PyExc_ValueError, "Unknown standalone format: %s",
@@ -256,11 +1277,43 @@ static PyObject *py_compress_standalone(PyObject *self __attribute__((unused)),
 
   const StandaloneFormat *fmt = find_standalone_format(format);
   if (!fmt) {
-    PyErr_Format(PyExc_ValueError, "Format not supported: %s", format);
+    PyErr_Format(PyExc_ValueError, "Format not supported: %s", format_name);
+    return NULL;
+  }
+
+  int tuned = codec_params_set(&params);
+  if (tuned && !fmt->compress_file_params) {
+    PyErr_Format(PyExc_ValueError,
+                 "Format '%s' takes no long_distance, window_log or "
+                 "match_strategy",
+                 fmt->name);
     return NULL;
   }
 
-  if (fmt->compress_file(input_path, output_path, compression_level) != 0) {
+  size_t prev_chunk = io_set_chunk_size(io_chunk);
+  IOEngine prev_engine = io_set_engine(engine);
+  IOProgress *prev_progress = io_set_progress(progress);
+  IOCancel *prev_cancel = io_set_cancel(cancel);
+  // Formats without a parallel writer stay on one thread
+  StatsSpan span;
+  stats_span_begin(&span);
+  int rc;
+  if (tuned)
+    rc = fmt->compress_file_params(input_path, output_path, compression_level,
+                                   threads, &params);
+  else if (threads != 1 && fmt->compress_file_mt)
+    rc = fmt->compress_file_mt(input_path, output_path, compression_level,
+                               threads);
+  else
+    rc = fmt->compress_file(input_path, output_path, compression_level);
+  stats_file_span(&span, format, 1, input_path, output_path, rc != 0);
+  if (rc != 0)
+    cancel_check_failure(output_path);
+  io_set_cancel(prev_cancel);
+  io_set_progress(prev_progress);
+  io_set_engine(prev_engine);
+  io_set_chunk_size(prev_chunk);
+  if (rc != 0) {
     return NULL; // Error already set
   }
 
@@ -270,19 +1323,36 @@ static PyObject *py_compress_standalone(PyObject *self __attribute__((unused)),
 static PyObject *py_decompress_standalone(PyObject *self
                                           __attribute__((unused)),
                                           PyObject *args, PyObject *kwargs) {
-  static char *kwlist[] = {"input_path", "output_path", "format", NULL};
+  static char *kwlist[] = {"input_path", "output_path", "format",
+                           "io_chunk_size", "io_engine", "progress", "cancel",
+                           "threads",       NULL};
 
   const char *input_path = NULL;
   const char *output_path = NULL;
   const char *format_name = NULL;
+  int threads = 1;
+  size_t io_chunk = 0;
+  IOEngine engine = IO_ENGINE_STDIO;
+  IOProgress *progress = NULL;
+  IOCancel *cancel = NULL;
 
   Format format = FORMAT_UNKNOWN;
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ss|s", kwlist, &input_path,
-                                   &output_path, &format_name)) {
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ss|sO&O&O&O&i", kwlist,
+                                   &input_path, &output_path, &format_name,
+                                   io_chunk_converter, &io_chunk,
+                                   io_engine_converter, &engine,
+                                   progress_converter, &progress,
+                                   cancel_converter, &cancel, &threads)) {
     return NULL; // Error already set
   }
 
+  if (threads < 0) {
+    PyErr_SetString(PyExc_ValueError,
+                    "threads must be >= 0 (0 = one per CPU)");
+    return NULL;
+  }
+
   if (format_name) {
     format = format_from_name(format_name);
 
@@ -303,11 +1373,29 @@ static PyObject *py_decompress_standalone(PyObject *self
   const StandaloneFormat *fmt = find_standalone_format(format);
 
   if (!fmt) {
-    PyErr_Format(PyExc_ValueError, "Unsupported format: %s", format);
+    PyErr_Format(PyExc_ValueError, "Unsupported format: %s",
+                 format_name_string(format));
     return NULL;
   }
 
-  if (fmt->decompress_file(input_path, output_path) != 0) {
+  size_t prev_chunk = io_set_chunk_size(io_chunk);
+  IOEngine prev_engine = io_set_engine(engine);
+  IOProgress *prev_progress = io_set_progress(progress);
+  IOCancel *prev_cancel = io_set_cancel(cancel);
+  // Formats without a parallel reader stay on one thread
+  StatsSpan span;
+  stats_span_begin(&span);
+  int rc = threads != 1 && fmt->decompress_file_mt
+               ? fmt->decompress_file_mt(input_path, output_path, threads)
+               : fmt->decompress_file(input_path, output_path);
+  stats_file_span(&span, format, 0, input_path, output_path, rc != 0);
+  if (rc != 0)
+    cancel_check_failure(output_path);
+  io_set_cancel(prev_cancel);
+  io_set_progress(prev_progress);
+  io_set_engine(prev_engine);
+  io_set_chunk_size(prev_chunk);
+  if (rc != 0) {
     return NULL; // Error already set
   }
 
@@ -361,6 +1449,13 @@ static PyObject *py_get_archive_capabilities(PyObject *self
   return get_archive_capabilities();
 }
 
+static PyObject *py_io_engines(PyObject *self __attribute__((unused)),
+                               PyObject *Py_UNUSED(ignored)) {
+  if (io_uring_available())
+    return Py_BuildValue("[sss]", "stdio", "threads", "uring");
+  return Py_BuildValue("[ss]", "stdio", "threads");
+}
+
 static PyObject *py_get_default_backend_for_strategy(PyObject *self
                                                      __attribute__((unused)),
                                                      PyObject *args) {
@@ -392,6 +1487,53 @@ static PyMethodDef CoreMethods[] = {
     {"decompress_file", (PyCFunction)py_decompress_file,
      METH_VARARGS | METH_KEYWORDS,
      "Decompress a file using the specified algorithm."},
+    {"decompress_range", (PyCFunction)py_decompress_range,
+     METH_VARARGS | METH_KEYWORDS,
+     "Decompress a byte range of a seekable (block-indexed) file."},
+    {"verify_file", (PyCFunction)py_verify_file, METH_VARARGS | METH_KEYWORDS,
+     "Check a compressed file's integrity without writing any output."},
+    {"compress_many", (PyCFunction)py_compress_many,
+     METH_VARARGS | METH_KEYWORDS,
+     "Compress many files side by side on a native worker pool."},
+    {"decompress_many", (PyCFunction)py_decompress_many,
+     METH_VARARGS | METH_KEYWORDS,
+     "Decompress many files side by side on a native worker pool."},
+
+    {"compress_bytes", (PyCFunction)py_compress_bytes,
+     METH_VARARGS | METH_KEYWORDS,
+     "Compress a bytes-like object and return the compressed frame."},
+    {"compress_bound", (PyCFunction)py_compress_bound,
+     METH_VARARGS | METH_KEYWORDS,
+     "Get the output size that always suffices for compress_into."},
+    {"compress_into", (PyCFunction)py_compress_into,
+     METH_VARARGS | METH_KEYWORDS,
+     "Compress a bytes-like object into a writable buffer."},
+    {"decompress_bytes", (PyCFunction)py_decompress_bytes,
+     METH_VARARGS | METH_KEYWORDS,
+     "Decompress a compressed frame and return the original bytes."},
+    {"decompress_into", (PyCFunction)py_decompress_into,
+     METH_VARARGS | METH_KEYWORDS,
+     "Decompress a compressed frame into a writable buffer."},
+
+    {"benchmark", (PyCFunction)py_benchmark, METH_VARARGS | METH_KEYWORDS,
+     "Time in-memory compression and decompression of a buffer."},
+
+    {"set_calibration", (PyCFunction)py_set_calibration, METH_VARARGS,
+     "Replace the measured speeds budget strategies choose from."},
+    {"get_calibration", (PyCFunction)py_get_calibration, METH_NOARGS,
+     "Return the speeds budget strategies choose from."},
+    {"choose_for_budget", (PyCFunction)py_choose_for_budget,
+     METH_VARARGS | METH_KEYWORDS,
+     "Return the backend, level and threads a budget strategy picks."},
+
+    {"get_stats", (PyCFunction)py_get_stats, METH_NOARGS,
+     "Return the per-backend, per-format and I/O counters."},
+    {"reset_stats", (PyCFunction)py_reset_stats, METH_NOARGS,
+     "Zero the counters returned by get_stats."},
+
+    {"train_dictionary", (PyCFunction)py_train_dictionary,
+     METH_VARARGS | METH_KEYWORDS,
+     "Train a compression dictionary from a sequence of sample buffers."},
 
     {"create_archive", (PyCFunction)py_create_archive,
      METH_VARARGS | METH_KEYWORDS,
@@ -401,6 +1543,12 @@ static PyMethodDef CoreMethods[] = {
      "Extract an archive file to a specified directory."},
     {"list_archive_contents", (PyCFunction)py_list_archive_contents,
      METH_VARARGS | METH_KEYWORDS, "List the contents of an archive file."},
+    {"list_archive_entries", (PyCFunction)py_list_archive_entries,
+     METH_VARARGS,
+     "List an archive's entries with their type, size, mtime and mode."},
+    {"convert_archive", (PyCFunction)py_convert_archive,
+     METH_VARARGS | METH_KEYWORDS,
+     "Re-pack an archive in another archive format or codec in one pass."},
 
     {"compress_standalone", (PyCFunction)py_compress_standalone,
      METH_VARARGS | METH_KEYWORDS,
@@ -417,6 +1565,8 @@ static PyMethodDef CoreMethods[] = {
      "Get the capabilities of available compression backends."},
     {"archive_capabilities", (PyCFunction)py_get_archive_capabilities,
      METH_NOARGS, "Get the capabilities of available archive backends."},
+    {"io_engines", (PyCFunction)py_io_engines, METH_NOARGS,
+     "List the I/O engines this system can run."},
     {"get_default_backend_for_strategy",
      (PyCFunction)py_get_default_backend_for_strategy, METH_VARARGS,
      "Get the default backend for a given strategy, None if no backend is "
@@ -470,11 +1620,22 @@ PyMODINIT_FUNC PyInit__core(void) {
     return NULL;
   }
 
+  comp_CancelledError =
+      PyErr_NewException("compresso.CancelledError", comp_Error, NULL);
+  if (!comp_CancelledError) {
+    Py_DECREF(comp_BackendError);
+    Py_DECREF(comp_HeaderError);
+    Py_DECREF(comp_Error);
+    Py_DECREF(module);
+    return NULL;
+  }
+
   Py_INCREF(comp_Error);
   if (PyModule_AddObject(module, "Error", comp_Error) < 0) {
     Py_DECREF(comp_Error);
     Py_DECREF(comp_HeaderError);
     Py_DECREF(comp_BackendError);
+    Py_DECREF(comp_CancelledError);
     Py_DECREF(module);
     return NULL;
   }
@@ -484,6 +1645,7 @@ PyMODINIT_FUNC PyInit__core(void) {
     Py_DECREF(comp_Error);
     Py_DECREF(comp_HeaderError);
     Py_DECREF(comp_BackendError);
+    Py_DECREF(comp_CancelledError);
     Py_DECREF(module);
     return NULL;
   }
@@ -493,9 +1655,37 @@ PyMODINIT_FUNC PyInit__core(void) {
     Py_DECREF(comp_Error);
     Py_DECREF(comp_HeaderError);
     Py_DECREF(comp_BackendError);
+    Py_DECREF(comp_CancelledError);
+    Py_DECREF(module);
+    return NULL;
+  }
+
+  Py_INCREF(comp_CancelledError);
+  if (PyModule_AddObject(module, "CancelledError", comp_CancelledError) < 0) {
+    Py_DECREF(comp_Error);
+    Py_DECREF(comp_HeaderError);
+    Py_DECREF(comp_BackendError);
+    Py_DECREF(comp_CancelledError);
+    Py_DECREF(module);
+    return NULL;
+  }
+
+  if (context_types_init(module) < 0 || dictionary_type_init(module) < 0 ||
+      progress_type_init(module) < 0 || cancel_type_init(module) < 0 ||
+      aio_type_init(module) < 0) {
+    Py_DECREF(module);
+    return NULL;
+  }
+
+#ifdef Py_GIL_DISABLED
+  // Safe without the GIL: process-wide tables are filled once under
+  // pthread_once, settings and codec caches are per thread, the shared
+  // counters are atomic, and every object holding codec state locks itself
+  if (PyUnstable_Module_SetGIL(module, Py_MOD_GIL_NOT_USED) < 0) {
     Py_DECREF(module);
     return NULL;
   }
+#endif
 
   return module;
 }
@@ -0,0 +1,387 @@
+#include "aio.h"
+#include "common.h"
+#include "threadpool.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#define AIO_EVENTFD 1
+#endif
+#endif
+
+// ---- Jobs ----
+
+// One submitted call. The worker running it owns it until it files the
+// outcome on the queue's done list, after which it is completed()'s. What
+// the queue shares between threads sits under its lock rather than the
+// GIL, which excludes nothing on free-threaded builds (the module declares
+// Py_MOD_GIL_NOT_USED there).
+
+typedef struct AioJob {
+  struct AioJob *next;
+  struct AsyncQueueObject *queue;
+  unsigned long long ticket;
+  PyObject *call;
+  PyObject *args;
+  PyObject *kwargs;
+  PyObject *result; // the call's return value, or NULL
+  PyObject *error;  // the exception it raised, or NULL
+} AioJob;
+
+typedef struct AsyncQueueObject {
+  PyObject_HEAD pthread_mutex_t lock; // pool, closed, done and the counts
+  ThreadPool *pool;                   // started by the first submit
+  int threads;
+  int closed;
+  int read_fd;  // what the event loop watches
+  int write_fd; // the same eventfd on Linux
+  AioJob *done; // finished and not yet collected, newest first
+  unsigned long long next_ticket;
+  Py_ssize_t pending; // submitted and not yet collected
+} AsyncQueueObject;
+
+static void aio_job_free(AioJob *job) {
+  Py_XDECREF(job->call);
+  Py_XDECREF(job->args);
+  Py_XDECREF(job->kwargs);
+  Py_XDECREF(job->result);
+  Py_XDECREF(job->error);
+  free(job);
+}
+
+// Wake the loop. A full pipe already holds a wakeup, so a short write is
+// fine; the eventfd counter cannot fill here.
+static void aio_signal(AsyncQueueObject *q) {
+#if defined(AIO_EVENTFD)
+  uint64_t one = 1;
+  ssize_t n = write(q->write_fd, &one, sizeof(one));
+#elif !defined(_WIN32) && !defined(_WIN64)
+  char one = 1;
+  ssize_t n = write(q->write_fd, &one, 1);
+#else
+  int n = 0;
+  (void)q;
+#endif
+  (void)n;
+}
+
+// Consume every pending wakeup so the descriptor reads as idle again
+static void aio_drain(AsyncQueueObject *q) {
+#if !defined(_WIN32) && !defined(_WIN64)
+  char buf[64];
+  while (read(q->read_fd, buf, sizeof(buf)) > 0)
+    ;
+#else
+  (void)q;
+#endif
+}
+
+static void aio_job_task(void *arg) {
+  AioJob *job = (AioJob *)arg;
+  AsyncQueueObject *q = job->queue;
+
+  PyGILState_STATE gil = PyGILState_Ensure();
+  job->result = PyObject_Call(job->call, job->args, job->kwargs);
+  if (!job->result) {
+    job->error = take_raised_exception();
+    if (!job->error) // failed without raising
+      job->error = PyObject_CallFunction(comp_Error, "s", "unknown error");
+    PyErr_Clear();
+  }
+  Py_CLEAR(job->call);
+  Py_CLEAR(job->args);
+  Py_CLEAR(job->kwargs);
+  PyGILState_Release(gil);
+
+  pthread_mutex_lock(&q->lock);
+  job->next = q->done;
+  q->done = job;
+  aio_signal(q);
+  pthread_mutex_unlock(&q->lock);
+}
+
+// ---- Async Queue Type ----
+
+static int aio_open_fds(AsyncQueueObject *self) {
+#if defined(AIO_EVENTFD)
+  int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  self->read_fd = self->write_fd = fd;
+  return 0;
+#elif !defined(_WIN32) && !defined(_WIN64)
+  int fds[2];
+  if (pipe(fds) != 0)
+    return -1;
+  for (int i = 0; i < 2; i++) {
+    if (fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK) != 0 ||
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC) != 0) {
+      close(fds[0]);
+      close(fds[1]);
+      return -1;
+    }
+  }
+  self->read_fd = fds[0];
+  self->write_fd = fds[1];
+  return 0;
+#else
+  (void)self;
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+static void aio_close_fds(AsyncQueueObject *self) {
+#if !defined(_WIN32) && !defined(_WIN64)
+  if (self->read_fd >= 0)
+    close(self->read_fd);
+  if (self->write_fd >= 0 && self->write_fd != self->read_fd)
+    close(self->write_fd);
+#endif
+  self->read_fd = self->write_fd = -1;
+}
+
+// Stop taking calls and wait for the ones in flight; their workers need
+// the GIL to finish, so it is dropped meanwhile
+static void aio_shutdown(AsyncQueueObject *self) {
+  pthread_mutex_lock(&self->lock);
+  self->closed = 1;
+  ThreadPool *pool = self->pool;
+  self->pool = NULL;
+  pthread_mutex_unlock(&self->lock);
+  if (pool) {
+    Py_BEGIN_ALLOW_THREADS threadpool_destroy(pool);
+    Py_END_ALLOW_THREADS
+  }
+}
+
+static PyObject *aio_object_new(PyTypeObject *type,
+                                PyObject *args __attribute__((unused)),
+                                PyObject *kwargs __attribute__((unused))) {
+  AsyncQueueObject *self = (AsyncQueueObject *)type->tp_alloc(type, 0);
+  if (self) {
+    pthread_mutex_init(&self->lock, NULL);
+    self->read_fd = self->write_fd = -1;
+  }
+  return (PyObject *)self;
+}
+
+static int aio_object_init(AsyncQueueObject *self, PyObject *args,
+                           PyObject *kwargs) {
+  static char *kwlist[] = {"threads", NULL};
+  int threads = 0;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|i", kwlist, &threads)) {
+    return -1; // Error already set
+  }
+
+  if (threads < 0) {
+    PyErr_SetString(PyExc_ValueError,
+                    "threads must be >= 0 (0 = one per CPU)");
+    return -1;
+  }
+
+  if (self->read_fd >= 0 || self->pool) {
+    PyErr_SetString(PyExc_RuntimeError, "AsyncQueue is already initialised");
+    return -1;
+  }
+
+  if (aio_open_fds(self) != 0) {
+    if (errno == ENOSYS) {
+      PyErr_SetString(PyExc_NotImplementedError,
+                      "AsyncQueue needs eventfd or pipes");
+    } else {
+      PyErr_SetFromErrno(PyExc_OSError);
+    }
+    return -1;
+  }
+  self->threads = threads;
+  return 0;
+}
+
+static void aio_object_dealloc(AsyncQueueObject *self) {
+  aio_shutdown(self);
+  while (self->done) {
+    AioJob *job = self->done;
+    self->done = job->next;
+    aio_job_free(job);
+  }
+  aio_close_fds(self);
+  pthread_mutex_destroy(&self->lock);
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *aio_object_submit(AsyncQueueObject *self, PyObject *args,
+                                   PyObject *kwargs) {
+  if (self->read_fd < 0) {
+    PyErr_SetString(PyExc_RuntimeError, "AsyncQueue is closed");
+    return NULL;
+  }
+
+  if (PyTuple_GET_SIZE(args) < 1 ||
+      !PyCallable_Check(PyTuple_GET_ITEM(args, 0))) {
+    PyErr_SetString(PyExc_TypeError,
+                    "submit() takes a callable and its arguments");
+    return NULL;
+  }
+
+  AioJob *job = (AioJob *)calloc(1, sizeof(AioJob));
+  if (!job) {
+    return PyErr_NoMemory();
+  }
+  job->queue = self;
+  job->call = PyTuple_GET_ITEM(args, 0);
+  Py_INCREF(job->call);
+  job->args = PyTuple_GetSlice(args, 1, PyTuple_GET_SIZE(args));
+  job->kwargs = kwargs ? PyDict_Copy(kwargs) : NULL;
+  if (!job->args || (kwargs && !job->kwargs)) {
+    aio_job_free(job);
+    return NULL; // Error already set
+  }
+
+  // The ticket is taken before the job is queued, as the worker may file
+  // it straight away
+  const char *error = NULL;
+  int no_memory = 0;
+  pthread_mutex_lock(&self->lock);
+  unsigned long long ticket = job->ticket = self->next_ticket;
+  if (!self->closed && !self->pool)
+    self->pool = threadpool_create(threadpool_resolve_threads(self->threads));
+  if (self->closed)
+    error = "AsyncQueue is closed";
+  else if (!self->pool)
+    error = "Failed to start worker threads";
+  else if (threadpool_submit(self->pool, aio_job_task, job) != 0)
+    no_memory = 1;
+  else {
+    self->next_ticket++;
+    self->pending++;
+  }
+  pthread_mutex_unlock(&self->lock);
+
+  if (error || no_memory) {
+    aio_job_free(job);
+    if (no_memory)
+      return PyErr_NoMemory();
+    PyErr_SetString(PyExc_RuntimeError, error);
+    return NULL;
+  }
+  return PyLong_FromUnsignedLongLong(ticket);
+}
+
+static PyObject *aio_object_completed(AsyncQueueObject *self,
+                                      PyObject *args __attribute__((unused))) {
+  if (self->read_fd >= 0)
+    aio_drain(self);
+
+  // Oldest first
+  AioJob *jobs = NULL;
+  pthread_mutex_lock(&self->lock);
+  while (self->done) {
+    AioJob *job = self->done;
+    self->done = job->next;
+    job->next = jobs;
+    jobs = job;
+    self->pending--;
+  }
+  pthread_mutex_unlock(&self->lock);
+
+  PyObject *list = PyList_New(0);
+  while (jobs) {
+    AioJob *job = jobs;
+    jobs = job->next;
+
+    PyObject *item =
+        list ? Py_BuildValue("(KOO)", job->ticket,
+                             job->result ? job->result : Py_None,
+                             job->error ? job->error : Py_None)
+             : NULL;
+    if (!item || PyList_Append(list, item) < 0)
+      Py_CLEAR(list); // the remaining outcomes are dropped with it
+    Py_XDECREF(item);
+    aio_job_free(job);
+  }
+  return list;
+}
+
+static PyObject *aio_object_fileno(AsyncQueueObject *self,
+                                   PyObject *args __attribute__((unused))) {
+  if (self->read_fd < 0) {
+    PyErr_SetString(PyExc_RuntimeError, "AsyncQueue is not initialised");
+    return NULL;
+  }
+  return PyLong_FromLong(self->read_fd);
+}
+
+static PyObject *aio_object_close(AsyncQueueObject *self,
+                                  PyObject *args __attribute__((unused))) {
+  aio_shutdown(self);
+  Py_RETURN_NONE;
+}
+
+static PyObject *aio_object_get_pending(AsyncQueueObject *self,
+                                        void *closure
+                                        __attribute__((unused))) {
+  pthread_mutex_lock(&self->lock);
+  Py_ssize_t pending = self->pending;
+  pthread_mutex_unlock(&self->lock);
+  return PyLong_FromSsize_t(pending);
+}
+
+static PyGetSetDef aio_object_getset[] = {
+    {"pending", (getter)aio_object_get_pending, NULL,
+     "Calls submitted whose outcome completed() has not returned yet.", NULL},
+    {NULL, NULL, NULL, NULL, NULL} // Sentinel
+};
+
+static PyMethodDef aio_object_methods[] = {
+    {"submit", (PyCFunction)(void (*)(void))aio_object_submit,
+     METH_VARARGS | METH_KEYWORDS,
+     "submit(call, *args, **kwargs) -> int\n\n"
+     "Run call(*args, **kwargs) on a native worker and return its ticket. "
+     "Meant for the native entry points, which drop the GIL while they "
+     "work."},
+    {"completed", (PyCFunction)aio_object_completed, METH_NOARGS,
+     "List the (ticket, result, error) of every call finished since the "
+     "last call, oldest first, and reset fileno()."},
+    {"fileno", (PyCFunction)aio_object_fileno, METH_NOARGS,
+     "Descriptor that turns readable when a call finishes."},
+    {"close", (PyCFunction)aio_object_close, METH_NOARGS,
+     "Stop taking calls and wait for the ones in flight."},
+    {NULL, NULL, 0, NULL} // Sentinel
+};
+
+static PyTypeObject AsyncQueueType = {
+    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "compresso._core.AsyncQueue",
+    .tp_doc = "Native worker pool whose completions wake an event loop.",
+    .tp_basicsize = sizeof(AsyncQueueObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = aio_object_new,
+    .tp_init = (initproc)aio_object_init,
+    .tp_dealloc = (destructor)aio_object_dealloc,
+    .tp_getset = aio_object_getset,
+    .tp_methods = aio_object_methods,
+};
+
+// ---- Registration ----
+
+int aio_type_init(PyObject *module) {
+  if (PyType_Ready(&AsyncQueueType) < 0) {
+    return -1;
+  }
+
+  Py_INCREF(&AsyncQueueType);
+  if (PyModule_AddObject(module, "AsyncQueue", (PyObject *)&AsyncQueueType) <
+      0) {
+    Py_DECREF(&AsyncQueueType);
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,17 @@
+#ifndef AIO_H
+#define AIO_H
+
+#include <Python.h>
+
+// ---- Python Type ----
+
+// AsyncQueue runs native calls on a pool of native workers and signals
+// each completion through a file descriptor an event loop can watch (an
+// eventfd on Linux, a pipe elsewhere), so no Python thread waits on a call
+// while it runs. Outcomes are collected with completed() on the loop's
+// thread; see frontend/_job.py run_native.
+
+// Adds AsyncQueue to the module; returns -1 on error
+int aio_type_init(PyObject *module);
+
+#endif // AIO_H
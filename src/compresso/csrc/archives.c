@@ -1,6 +1,8 @@
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -8,10 +10,19 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
 #define PY_SSIZE_T_CLEAN
 #include "archives.h"
+#include "cancel.h"
+#include "catalog.h"
 #include "common.h"
+#include "fileio.h"
 #include "standalone.h"
+#include "stats.h"
+#include "threadpool.h"
 #include <Python.h>
 
 // ---- Default Extraction Policies ----
@@ -31,30 +42,6 @@ ExtractionPolicy extraction_policy_default(void) {
   return EXTRACTION_POLICY_DEFAULT;
 }
 
-// ---- ArchiveEntry Helpers ----
-
-static ArchiveEntry *entry_alloc(void) {
-  ArchiveEntry *e = safe_malloc(sizeof(ArchiveEntry));
-  if (!e)
-    return NULL;
-  e->path = NULL;
-  e->type = ENTRY_FILE;
-  e->size = 0;
-  e->mtime = 0;
-  e->mode = 0;
-  e->symlink_target = NULL;
-  e->internal_data = NULL;
-  return e;
-}
-
-static void entry_free(ArchiveEntry *e) {
-  if (!e)
-    return;
-  free(e->path);
-  free(e->symlink_target);
-  free(e);
-}
-
 // ---- Helpers ----
 
 // Create a directory and any missing parents (like `mkdir -p`).
@@ -81,105 +68,251 @@ static int mkdir_p(const char *path, mode_t mode) {
   return 0;
 }
 
-static ArchiveEntry *create_entry_from_path(const char *path,
-                                            const char *base_path) {
-  struct stat st;
-  if (stat(path, &st) != 0) {
-    PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
-    return NULL;
-  }
-
-  ArchiveEntry *entry = entry_alloc();
-  if (!entry)
-    return NULL;
+// ---- Tree Walk ----
+
+// Archive creation walks its inputs relative to open directory handles:
+// every name is stat'ed and opened with fstatat/openat against its
+// directory, never re-resolved from the root. Entries live on the stack
+// and their paths in the walk's one path buffer (backends copy what they
+// keep), so a tree of many small files costs no allocation per file. On
+// Linux each directory level reads its names in getdents64 batches into a
+// buffer that is kept for the rest of the walk and freed with it.
+
+#if defined(__linux__) && defined(SYS_getdents64)
+#define WALK_GETDENTS 1
+#define WALK_BATCH (64 * 1024)
+
+// The kernel's record layout; glibc only declares it from 2.30 on
+struct walk_dirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+#endif
+
+typedef struct {
+  const CArchive *archive;
+  void *writer;
+  char path[PATH_MAX]; // the entry being added, as given plus its names
+  size_t len;          // strlen(path)
+  size_t name_start;   // where the archive's name for the entry begins
+  char link[PATH_MAX]; // the current symlink's target
+#if defined(WALK_GETDENTS)
+  unsigned char **batches; // one per directory level, grown on demand
+  size_t depth_max;
+#endif
+} TreeWalk;
+
+static void walk_free(TreeWalk *w) {
+#if defined(WALK_GETDENTS)
+  for (size_t i = 0; i < w->depth_max; i++)
+    free(w->batches[i]);
+  free(w->batches);
+  w->batches = NULL;
+  w->depth_max = 0;
+#else
+  (void)w;
+#endif
+}
 
-  const char *rel_path = path;
-  if (base_path && strncmp(path, base_path, strlen(base_path)) == 0) {
-    rel_path = path + strlen(base_path);
-    if (*rel_path == '/')
-      rel_path++;
+// Names of one open directory, without "." and ".."
+typedef struct {
+#if defined(WALK_GETDENTS)
+  int fd;
+  unsigned char *batch;
+  size_t filled, pos;
+#else
+  DIR *dir;
+#endif
+} DirNames;
+
+// Takes ownership of fd, closed again by dir_names_close; returns errno
+static int dir_names_open(TreeWalk *w, size_t depth, int fd, DirNames *d) {
+#if defined(WALK_GETDENTS)
+  if (depth >= w->depth_max) {
+    unsigned char **grown = (unsigned char **)realloc(
+        w->batches, (depth + 1) * sizeof(*grown));
+    if (!grown) {
+      close(fd);
+      return ENOMEM;
+    }
+    w->batches = grown;
+    for (; w->depth_max <= depth; w->depth_max++)
+      w->batches[w->depth_max] = NULL;
   }
-  entry->path = strdup(rel_path);
-  if (!entry->path) {
-    entry_free(entry);
-    PyErr_NoMemory();
-    return NULL;
+  if (!w->batches[depth]) {
+    w->batches[depth] = (unsigned char *)malloc(WALK_BATCH);
+    if (!w->batches[depth]) {
+      close(fd);
+      return ENOMEM;
+    }
+  }
+  d->fd = fd;
+  d->batch = w->batches[depth];
+  d->filled = d->pos = 0;
+#else
+  (void)w;
+  (void)depth;
+  d->dir = fdopendir(fd);
+  if (!d->dir) {
+    int error = errno;
+    close(fd);
+    return error;
   }
+#endif
+  return 0;
+}
+
+// The next name, or NULL at the end (*error = 0) or on failure (errno)
+static const char *dir_names_next(DirNames *d, int *error) {
+  *error = 0;
+  for (;;) {
+    const char *name;
+#if defined(WALK_GETDENTS)
+    if (d->pos >= d->filled) {
+      long n = syscall(SYS_getdents64, d->fd, d->batch, WALK_BATCH);
+      if (n <= 0) {
+        *error = n < 0 ? errno : 0;
+        return NULL;
+      }
+      d->filled = (size_t)n;
+      d->pos = 0;
+    }
+    struct walk_dirent64 *de = (struct walk_dirent64 *)(d->batch + d->pos);
+    d->pos += de->d_reclen;
+    name = de->d_name;
+#else
+    errno = 0;
+    struct dirent *de = readdir(d->dir);
+    if (!de) {
+      *error = errno;
+      return NULL;
+    }
+    name = de->d_name;
+#endif
+    if (strcmp(name, ".") != 0 && strcmp(name, "..") != 0)
+      return name;
+  }
+}
 
-  entry->size = (uint64_t)st.st_size;
-  entry->mtime = st.st_mtime;
-  entry->mode = st.st_mode & 0777;
+static void dir_names_close(DirNames *d) {
+#if defined(WALK_GETDENTS)
+  close(d->fd);
+#else
+  closedir(d->dir);
+#endif
+}
 
-  if (S_ISDIR(st.st_mode)) {
+// Fill entry from st for the walk's current path, reading a symlink's
+// target relative to dirfd
+static void fill_entry(TreeWalk *w, ArchiveEntry *entry,
+                       const struct stat *st, int dirfd, const char *name) {
+  memset(entry, 0, sizeof(*entry));
+  entry->path = w->path + w->name_start;
+  entry->size = (uint64_t)st->st_size;
+  entry->mtime = st->st_mtime;
+  entry->mode = st->st_mode & 0777;
+
+  if (S_ISDIR(st->st_mode)) {
     entry->type = ENTRY_DIR;
-  } else if (S_ISLNK(st.st_mode)) {
+  } else if (S_ISLNK(st->st_mode)) {
     entry->type = ENTRY_SYMLINK;
-    char target[PATH_MAX];
-    ssize_t len = readlink(path, target, sizeof(target) - 1);
+    ssize_t len = readlinkat(dirfd, name, w->link, sizeof(w->link) - 1);
     if (len > 0) {
-      target[len] = '\0';
-      entry->symlink_target = strdup(target);
+      w->link[len] = '\0';
+      entry->symlink_target = w->link;
     }
   } else {
     entry->type = ENTRY_FILE;
   }
+}
 
-  return entry;
+// Add one regular file, by path when the backend schedules its own reads
+static int add_file_to_writer(TreeWalk *w, const ArchiveEntry *entry,
+                              int dirfd, const char *name) {
+  if (w->archive->add_file)
+    return w->archive->add_file(w->writer, entry, w->path);
+
+  int fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+  FILE *f = fd >= 0 ? fdopen(fd, "rb") : NULL;
+  if (!f) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, w->path);
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+  int ret = w->archive->add_entry(w->writer, entry, f);
+  fclose(f);
+  return ret;
 }
 
-static int add_directory_recursive(void *writer, const CArchive *archive,
-                                   const char *dir_path,
-                                   const char *base_path) {
-  DIR *dir = opendir(dir_path);
-  if (!dir) {
-    PyErr_SetFromErrnoWithFilename(PyExc_OSError, dir_path);
+// Add everything below the directory open as fd (which this closes), the
+// walk's path naming it
+static int add_directory_recursive(TreeWalk *w, int fd, size_t depth) {
+  DirNames names;
+  int error = dir_names_open(w, depth, fd, &names);
+  if (error) {
+    errno = error;
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, w->path);
     return -1;
   }
 
-  struct dirent *dent;
-  while ((dent = readdir(dir)) != NULL) {
-    if (strcmp(dent->d_name, ".") == 0 || strcmp(dent->d_name, "..") == 0)
-      continue;
+  size_t dir_len = w->len;
+  int ret = 0;
+  const char *name;
+  while (ret == 0 && (name = dir_names_next(&names, &error)) != NULL) {
+    if (io_cancelled() != IO_CANCEL_NONE) {
+      ret = cancel_raise();
+      break;
+    }
 
-    char full_path[PATH_MAX];
-    snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, dent->d_name);
+    size_t name_len = strlen(name);
+    if (dir_len + 1 + name_len >= sizeof(w->path)) {
+      errno = ENAMETOOLONG;
+      PyErr_SetFromErrnoWithFilename(PyExc_OSError, name);
+      ret = -1;
+      break;
+    }
+    w->path[dir_len] = '/';
+    memcpy(w->path + dir_len + 1, name, name_len + 1);
+    w->len = dir_len + 1 + name_len;
 
-    ArchiveEntry *ae = create_entry_from_path(full_path, base_path);
-    if (!ae) {
-      closedir(dir);
-      return -1;
+    struct stat st;
+    if (fstatat(fd, name, &st, 0) != 0) {
+      PyErr_SetFromErrnoWithFilename(PyExc_OSError, w->path);
+      ret = -1;
+      break;
     }
 
-    if (ae->type == ENTRY_FILE) {
-      FILE *f = fopen(full_path, "rb");
-      if (!f) {
-        entry_free(ae);
-        closedir(dir);
-        PyErr_SetFromErrnoWithFilename(PyExc_OSError, full_path);
-        return -1;
-      }
-      int ret = archive->add_entry(writer, ae, f);
-      fclose(f);
-      entry_free(ae);
-      if (ret != 0) {
-        closedir(dir);
-        return -1;
-      }
-    } else if (ae->type == ENTRY_DIR) {
-      archive->add_entry(writer, ae, NULL);
-      entry_free(ae);
-      if (add_directory_recursive(writer, archive, full_path, base_path) != 0) {
-        closedir(dir);
-        return -1;
+    ArchiveEntry entry;
+    fill_entry(w, &entry, &st, fd, name);
+    if (entry.type == ENTRY_FILE) {
+      ret = add_file_to_writer(w, &entry, fd, name);
+    } else if (entry.type == ENTRY_DIR) {
+      w->archive->add_entry(w->writer, &entry, NULL);
+      int sub = openat(fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+      if (sub < 0) {
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, w->path);
+        ret = -1;
+      } else {
+        ret = add_directory_recursive(w, sub, depth + 1);
       }
     } else {
-      archive->add_entry(writer, ae, NULL);
-      entry_free(ae);
+      w->archive->add_entry(w->writer, &entry, NULL);
     }
+    w->len = dir_len;
+    w->path[dir_len] = '\0';
+  }
+  if (ret == 0 && error) {
+    errno = error;
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, w->path);
+    ret = -1;
   }
 
-  closedir(dir);
-  return 0;
+  dir_names_close(&names);
+  return ret;
 }
 
 static int validate_entry_path(const char *output_dir, const char *entry_path,
@@ -262,6 +395,8 @@ const CArchive *find_archive_by_id(uint8_t id) {
     return get_tar_archive();
   case ARCHIVE_ZIP:
     return get_zip_archive();
+  case ARCHIVE_CDAR:
+    return get_cdar_archive();
   default:
     return NULL;
   }
@@ -293,247 +428,902 @@ static char *make_temp_path(const char *final_path) {
   return tmpl;
 }
 
-// Write every input path into an already-open writer
-static int add_paths_to_writer(const CArchive *archive, void *writer,
-                               const char **input_paths, size_t num_paths) {
-  for (size_t i = 0; i < num_paths; i++) {
-    struct stat st;
-    if (stat(input_paths[i], &st) != 0) {
-      PyErr_SetFromErrnoWithFilename(PyExc_OSError, input_paths[i]);
-      return -1;
-    }
+// Add one input path, walking it when it is a directory
+static int add_input_path(TreeWalk *w, const char *input_path) {
+  size_t len = strlen(input_path);
+  if (len >= sizeof(w->path)) {
+    PyErr_SetString(PyExc_ValueError, "Source path too long");
+    return -1;
+  }
+  memcpy(w->path, input_path, len + 1);
+  w->len = len;
 
-    if (S_ISDIR(st.st_mode)) {
-      // Strip only the source's *parent* so the source directory's own name is
-      // preserved in stored entry paths (e.g. "sub/nested.txt", not
-      // "nested.txt"). Passing the source as its own base would flatten it.
-      char base[PATH_MAX];
-      const char *slash = strrchr(input_paths[i], '/');
-      if (slash) {
-        size_t base_len = (size_t)(slash - input_paths[i]);
-        if (base_len >= sizeof(base)) {
-          PyErr_SetString(PyExc_ValueError, "Source path too long");
-          return -1;
-        }
-        memcpy(base, input_paths[i], base_len);
-        base[base_len] = '\0';
-      } else {
-        base[0] = '\0';
-      }
+  struct stat st;
+  if (stat(input_path, &st) != 0) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, input_path);
+    return -1;
+  }
 
-      // Record the directory itself so empty directories are preserved.
-      ArchiveEntry *dir_entry = create_entry_from_path(input_paths[i], base);
-      if (!dir_entry)
-        return -1;
-      int dir_ret = archive->add_entry(writer, dir_entry, NULL);
-      entry_free(dir_entry);
-      if (dir_ret != 0)
-        return -1;
+  ArchiveEntry entry;
+  if (!S_ISDIR(st.st_mode)) {
+    w->name_start = 0;
+    fill_entry(w, &entry, &st, AT_FDCWD, input_path);
+    return add_file_to_writer(w, &entry, AT_FDCWD, input_path);
+  }
 
-      if (add_directory_recursive(writer, archive, input_paths[i], base) != 0)
-        return -1;
-    } else {
-      ArchiveEntry *entry = create_entry_from_path(input_paths[i], NULL);
-      if (!entry)
-        return -1;
+  // Strip only the source's *parent* so the source directory's own name is
+  // preserved in stored entry paths (e.g. "sub/nested.txt", not
+  // "nested.txt"). Passing the source as its own base would flatten it.
+  const char *slash = strrchr(input_path, '/');
+  w->name_start = slash ? (size_t)(slash - input_path) + 1 : 0;
 
-      FILE *f = fopen(input_paths[i], "rb");
-      if (!f) {
-        entry_free(entry);
-        PyErr_SetFromErrnoWithFilename(PyExc_OSError, input_paths[i]);
-        return -1;
-      }
+  // Record the directory itself so empty directories are preserved.
+  fill_entry(w, &entry, &st, AT_FDCWD, input_path);
+  if (w->archive->add_entry(w->writer, &entry, NULL) != 0)
+    return -1;
 
-      int ret = archive->add_entry(writer, entry, f);
-      fclose(f);
-      entry_free(entry);
+  int fd = open(input_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, input_path);
+    return -1;
+  }
+  return add_directory_recursive(w, fd, 0);
+}
 
-      if (ret != 0)
-        return -1;
-    }
+// Write every input path into an already-open writer
+static int add_paths_to_writer(const CArchive *archive, void *writer,
+                               const char **input_paths, size_t num_paths) {
+  TreeWalk *w = (TreeWalk *)calloc(1, sizeof(TreeWalk));
+  if (!w) {
+    PyErr_NoMemory();
+    return -1;
+  }
+  w->archive = archive;
+  w->writer = writer;
+
+  int ret = 0;
+  for (size_t i = 0; ret == 0 && i < num_paths; i++) {
+    if (io_cancelled() != IO_CANCEL_NONE)
+      ret = cancel_raise();
+    else
+      ret = add_input_path(w, input_paths[i]);
   }
 
-  return 0;
+  walk_free(w);
+  free(w);
+  return ret;
 }
 
 // ---- Archive Operations ----
 
-int create_archive(const char *output_path, const CompressionPipeline *pipeline,
-                   const char **input_paths, size_t num_paths) {
+// The format an archive backend's operations are counted under
+static Format archive_stats_format(uint8_t id) {
+  switch (id) {
+  case ARCHIVE_TAR:
+    return FORMAT_TAR;
+  case ARCHIVE_ZIP:
+    return FORMAT_ZIP;
+  case ARCHIVE_7Z:
+    return FORMAT_7Z;
+  case ARCHIVE_CDAR:
+    return FORMAT_CDAR;
+  default:
+    return FORMAT_UNKNOWN;
+  }
+}
+
+// A writer for pipeline on output_path. When the backend cannot stream
+// through the codec, it writes the bare archive to a temp file instead,
+// which close_archive_output then compresses into output_path. With
+// pipeline->catalog set, the writer's entries are collected for a catalog
+// sidecar, saved once output_path is final.
+typedef struct {
+  const CArchive *archive;
+  void *writer;
+  char *tmp_path;
+  int cataloged;
+  ArchiveCatalog catalog;
+} ArchiveOutput;
+
+// The backend that writes pipeline's archives, or NULL with an error set
+static const CArchive *output_archive(const CompressionPipeline *pipeline) {
   if (!pipeline_is_valid(pipeline) || pipeline->archive == ARCHIVE_NONE) {
     char name[32];
     pipeline_display_name(pipeline, name, sizeof(name));
     PyErr_Format(PyExc_ValueError, "Format does not support archives: %s",
                  name);
-    return -1;
+    return NULL;
   }
 
-  int level = pipeline->compression_level;
-
   const CArchive *archive = find_archive_by_id(pipeline->archive);
   if (!archive || !archive->is_available()) {
     PyErr_SetString(comp_Error, "Archive backend not available");
-    return -1;
+    return NULL;
   }
+  return archive;
+}
 
-  // Write archive to a temp file, then compress via the standalone codec
-  char *tmp_path = NULL;
+static int open_archive_output(ArchiveOutput *out, const char *output_path,
+                               const CompressionPipeline *pipeline) {
+  memset(out, 0, sizeof(*out));
+  const CArchive *archive = output_archive(pipeline);
+  if (!archive)
+    return -1;
+
+  CompressionPipeline stage = *pipeline;
   const char *write_path = output_path;
-  if (pipeline->codec != FORMAT_UNKNOWN) {
-    tmp_path = make_temp_path(output_path);
-    if (!tmp_path)
+  if (pipeline->codec != FORMAT_UNKNOWN &&
+      !(archive->supports_codec && archive->supports_codec(pipeline))) {
+    stage.codec = FORMAT_UNKNOWN;
+    out->tmp_path = make_temp_path(output_path);
+    if (!out->tmp_path)
       return -1;
-    write_path = tmp_path;
+    write_path = out->tmp_path;
   }
 
-  void *writer = archive->create_writer(write_path, level);
-  if (!writer) {
-    if (tmp_path) {
-      unlink(tmp_path);
-      free(tmp_path);
+  out->writer = archive->create_writer(write_path, &stage);
+  if (!out->writer) {
+    if (out->tmp_path) {
+      unlink(out->tmp_path);
+      free(out->tmp_path);
+      out->tmp_path = NULL;
     }
     return -1;
   }
+  out->archive = archive;
+
+  // Other backends carry their own index: zip its central directory, cdar
+  // its entry table
+  if (pipeline->catalog && archive->set_catalog) {
+    catalog_init(&out->catalog);
+    archive->set_catalog(out->writer, &out->catalog);
+    out->cataloged = 1;
+  }
+  return 0;
+}
 
-  int ret = add_paths_to_writer(archive, writer, input_paths, num_paths);
-  if (archive->close_writer(writer) != 0)
+// Close the writer and run the codec pass if there is one; ret is the
+// result so far, and the codec pass is skipped unless it is 0
+static int close_archive_output(ArchiveOutput *out, const char *output_path,
+                                const CompressionPipeline *pipeline, int ret) {
+  if (out->archive->close_writer(out->writer) != 0)
     ret = -1;
 
-  if (ret == 0 && pipeline->codec != FORMAT_UNKNOWN) {
+  if (ret == 0 && out->tmp_path) {
     const StandaloneFormat *codec = find_standalone_format(pipeline->codec);
-    ret = codec->compress_file(tmp_path, output_path, level);
+    ret = pipeline->threads != 1 && codec->compress_file_mt
+              ? codec->compress_file_mt(out->tmp_path, output_path,
+                                        pipeline->compression_level,
+                                        pipeline->threads)
+              : codec->compress_file(out->tmp_path, output_path,
+                                     pipeline->compression_level);
   }
 
-  if (tmp_path) {
-    unlink(tmp_path);
-    free(tmp_path);
+  if (out->tmp_path) {
+    unlink(out->tmp_path);
+    free(out->tmp_path);
+  }
+
+  if (out->cataloged) {
+    int error = ret == 0 ? catalog_save(&out->catalog, output_path) : 0;
+    if (error != 0) {
+      errno = error;
+      PyErr_SetFromErrnoWithFilename(PyExc_OSError, output_path);
+      ret = -1;
+    }
+    catalog_free(&out->catalog);
   }
   return ret;
 }
 
-// Read and write each entry from an already-open reader
-static int extract_entries(const CArchive *archive, void *reader,
-                           const char *output_dir, const char **files,
-                           size_t num_files, const ExtractionPolicy *policy) {
-  ArchiveEntry entry = {0};
-  int ret;
+static int create_archive_with(const char *output_path,
+                               const CompressionPipeline *pipeline,
+                               const char **input_paths, size_t num_paths) {
+  ArchiveOutput out;
+  if (open_archive_output(&out, output_path, pipeline) != 0)
+    return -1;
 
-  while ((ret = archive->get_next_entry(reader, &entry)) == 1) {
-    if (!entry.path) {
-      archive->skip_entry_data(reader);
+  int ret = add_paths_to_writer(out.archive, out.writer, input_paths,
+                                num_paths);
+  return close_archive_output(&out, output_path, pipeline, ret);
+}
+
+int create_archive(const char *output_path, const CompressionPipeline *pipeline,
+                   const char **input_paths, size_t num_paths) {
+  StatsSpan span;
+  stats_span_begin(&span);
+  int ret = create_archive_with(output_path, pipeline, input_paths, num_paths);
+  Format format =
+      pipeline ? archive_stats_format(pipeline->archive) : FORMAT_UNKNOWN;
+  stats_file_span(&span, format, 1, NULL, output_path, ret != 0);
+  return ret;
+}
+
+// Open archive_path for reading. The backend decompresses the codec stage on
+// the fly when it can; otherwise it is decoded to a temp file first, whose
+// path is returned in *tmp_path for the caller to remove. That decode runs
+// on `threads` workers when the codec has a parallel reader.
+static void *open_archive_reader(const char *archive_path, int threads,
+                                 const CArchive **archive_out,
+                                 char **tmp_path) {
+  *tmp_path = NULL;
+
+  CompressionPipeline pipe = detect_pipeline_from_path(archive_path);
+  if (!pipeline_is_valid(&pipe) || pipe.archive == ARCHIVE_NONE) {
+    PyErr_SetString(PyExc_ValueError, "Not an archive format");
+    return NULL;
+  }
+
+  const CArchive *archive = find_archive_by_id(pipe.archive);
+  if (!archive || !archive->is_available()) {
+    PyErr_SetString(comp_Error, "Archive backend not available");
+    return NULL;
+  }
+
+  const char *read_path = archive_path;
+  if (pipe.codec != FORMAT_UNKNOWN &&
+      !(archive->supports_codec && archive->supports_codec(&pipe))) {
+    const StandaloneFormat *codec = find_standalone_format(pipe.codec);
+    *tmp_path = make_temp_path(archive_path);
+    if (!*tmp_path)
+      return NULL;
+    int rc = threads != 1 && codec->decompress_file_mt
+                 ? codec->decompress_file_mt(archive_path, *tmp_path, threads)
+                 : codec->decompress_file(archive_path, *tmp_path);
+    if (rc != 0) {
+      unlink(*tmp_path);
+      free(*tmp_path);
+      *tmp_path = NULL;
+      return NULL;
+    }
+    read_path = *tmp_path;
+  }
+
+  void *reader = archive->create_reader(read_path);
+  if (!reader && *tmp_path) {
+    unlink(*tmp_path);
+    free(*tmp_path);
+    *tmp_path = NULL;
+  }
+  *archive_out = archive;
+  return reader;
+}
+
+// ---- Parallel Extraction ----
+
+// Tar entries up to this size are decoded into memory and written by the
+// pool; bigger ones are streamed straight to disk by the reading thread
+#define EXTRACT_ASYNC_MAX_ENTRY ((uint64_t)1 << 20)
+
+// Decoded bytes allowed to wait for a writer before the reader blocks
+#define EXTRACT_MAX_BUFFERED ((size_t)64 << 20)
+
+// Shared by the reading thread and the pool; the first failure wins
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  size_t buffered;
+  int error;
+  char *error_path;
+} ExtractSink;
+
+typedef struct {
+  ExtractSink *sink;
+  char *path;
+  uint32_t mode;
+  char *data;
+  size_t size;
+} WriteJob;
+
+// A file for a shard worker to decode straight from the archive
+typedef struct {
+  int64_t index; // -1 once a later entry of the same name replaces it
+  char *path;
+  uint32_t mode;
+} ExtractTarget;
+
+typedef struct {
+  const CArchive *archive;
+  void *reader;
+  ExtractSink *sink;
+  ExtractTarget *targets;
+  size_t count;
+  size_t first;
+  size_t stride;
+  IOCancel *cancel; // the caller's; workers have none of their own
+} ExtractShard;
+
+static void sink_fail(ExtractSink *sink, int error, const char *path) {
+  pthread_mutex_lock(&sink->lock);
+  if (!sink->error) {
+    sink->error = error;
+    sink->error_path = strdup(path);
+  }
+  pthread_mutex_unlock(&sink->lock);
+}
+
+static int sink_failed(ExtractSink *sink) {
+  pthread_mutex_lock(&sink->lock);
+  int error = sink->error;
+  pthread_mutex_unlock(&sink->lock);
+  return error;
+}
+
+static int open_output_file(const char *path) {
+  return open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+}
+
+static void write_job_task(void *arg) {
+  WriteJob *job = (WriteJob *)arg;
+  int error = 0;
+
+  int fd = open_output_file(job->path);
+  if (fd < 0) {
+    error = errno;
+  } else {
+    error = io_write_sparse_fd(fd, (const unsigned char *)job->data,
+                               job->size);
+    if (!error)
+      error = io_sparse_finish_fd(fd);
+    fchmod(fd, job->mode);
+    if (close(fd) != 0 && !error)
+      error = errno;
+  }
+  if (error)
+    sink_fail(job->sink, error, job->path);
+
+  pthread_mutex_lock(&job->sink->lock);
+  job->sink->buffered -= job->size;
+  pthread_cond_broadcast(&job->sink->cond);
+  pthread_mutex_unlock(&job->sink->lock);
+
+  free(job->path);
+  free(job->data);
+  free(job);
+}
+
+static void shard_task(void *arg) {
+  ExtractShard *shard = (ExtractShard *)arg;
+  void *handle = shard->archive->open_shard(shard->reader);
+  if (!handle) {
+    sink_fail(shard->sink, EIO, shard->targets[shard->first].path);
+    return;
+  }
+
+  for (size_t i = shard->first; i < shard->count; i += shard->stride) {
+    const ExtractTarget *target = &shard->targets[i];
+    if (target->index < 0)
       continue;
+    if (sink_failed(shard->sink))
+      break;
+    if (io_cancel_state(shard->cancel) != IO_CANCEL_NONE) {
+      sink_fail(shard->sink, ECANCELED, target->path);
+      break;
     }
 
-    if (validate_entry_path(output_dir, entry.path, 0, policy) != 0 ||
-        check_entry_policy(&entry, policy) != 0) {
-      free(entry.path);
-      free(entry.symlink_target);
+    int fd = open_output_file(target->path);
+    if (fd < 0) {
+      sink_fail(shard->sink, errno, target->path);
+      break;
+    }
+    int error = shard->archive->extract_index(handle, target->index, fd);
+    if (!error)
+      error = io_sparse_finish_fd(fd);
+    fchmod(fd, target->mode);
+    if (close(fd) != 0 && !error)
+      error = errno;
+    if (error) {
+      sink_fail(shard->sink, error, target->path);
+      break;
+    }
+  }
+
+  shard->archive->close_shard(handle);
+}
+
+// Hand a decoded file to the pool, first waiting for the buffer budget
+static int queue_write(ThreadPool *pool, ExtractSink *sink, const char *path,
+                       uint32_t mode, char *data, size_t size) {
+  WriteJob *job = safe_malloc(sizeof(WriteJob));
+  if (!job) {
+    free(data);
+    return -1;
+  }
+  job->sink = sink;
+  job->path = strdup(path);
+  job->mode = mode;
+  job->data = data;
+  job->size = size;
+  if (!job->path) {
+    free(data);
+    free(job);
+    PyErr_NoMemory();
+    return -1;
+  }
+
+  COMP_BEGIN_ALLOW_THREADS pthread_mutex_lock(&sink->lock);
+  while (sink->buffered > 0 && sink->buffered + size > EXTRACT_MAX_BUFFERED)
+    pthread_cond_wait(&sink->cond, &sink->lock);
+  sink->buffered += size;
+  pthread_mutex_unlock(&sink->lock);
+  COMP_END_ALLOW_THREADS
+
+      if (threadpool_submit(pool, write_job_task, job) != 0) {
+    write_job_task(job); // Queue could not grow; write inline
+  }
+  return 0;
+}
+
+// Decode the current entry into memory through the backend's stdio path
+static int read_entry_to_memory(const CArchive *archive, void *reader,
+                                char **data, size_t *size) {
+  *data = NULL;
+  *size = 0;
+  FILE *mem = open_memstream(data, size);
+  if (!mem) {
+    PyErr_NoMemory();
+    return -1;
+  }
+  int ret = archive->extract_entry_data(reader, mem);
+  if (fclose(mem) != 0 && ret == 0) {
+    PyErr_NoMemory();
+    ret = -1;
+  }
+  if (ret != 0) {
+    free(*data);
+    *data = NULL;
+  }
+  return ret;
+}
+
+// mkdir -p the parent of path, skipping it when it matches the last one made
+static void ensure_parent_dir(char *path, char *last_parent) {
+  char *last_slash = strrchr(path, '/');
+  if (!last_slash)
+    return;
+  *last_slash = '\0';
+  if (strcmp(path, last_parent) != 0 && mkdir_p(path, 0755) == 0)
+    snprintf(last_parent, PATH_MAX, "%s", path);
+  *last_slash = '/';
+}
+
+static int run_shards(const CArchive *archive, void *reader, ThreadPool *pool,
+                      ExtractSink *sink, ExtractTarget *targets,
+                      size_t count) {
+  size_t nshards = (size_t)threadpool_size(pool);
+  if (nshards > count)
+    nshards = count;
+
+  ExtractShard *shards = safe_malloc(nshards * sizeof(ExtractShard));
+  if (!shards)
+    return -1;
+
+  for (size_t i = 0; i < nshards; i++) {
+    shards[i] = (ExtractShard){archive, reader, sink,    targets,
+                               count,   i,      nshards, io_cancel()};
+    if (threadpool_submit(pool, shard_task, &shards[i]) != 0)
+      shard_task(&shards[i]);
+  }
+
+  COMP_BEGIN_ALLOW_THREADS threadpool_wait(pool);
+  COMP_END_ALLOW_THREADS
+
+      free(shards);
+  return 0;
+}
+
+// ---- Entry Name Set ----
+
+// Open-addressing set of requested entry names, so filtering a scan costs
+// one hash per entry rather than a pass over the whole request list
+typedef struct {
+  const char **slots;
+  size_t mask;
+} NameSet;
+
+static uint64_t name_hash(const char *name) {
+  uint64_t h = 0xcbf29ce484222325ULL; // FNV-1a
+  for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+    h ^= *p;
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+static int name_set_init(NameSet *set, size_t count) {
+  size_t capacity = 16;
+  while (capacity < count * 2)
+    capacity <<= 1;
+  set->slots = (const char **)calloc(capacity, sizeof(const char *));
+  set->mask = capacity - 1;
+  if (!set->slots) {
+    PyErr_NoMemory();
+    return -1;
+  }
+  return 0;
+}
+
+static void name_set_free(NameSet *set) { free((void *)set->slots); }
+
+// Returns 1 if name was added, 0 if it was already present. The set borrows
+// the string.
+static int name_set_add(NameSet *set, const char *name) {
+  size_t i = (size_t)name_hash(name) & set->mask;
+  while (set->slots[i]) {
+    if (strcmp(set->slots[i], name) == 0)
+      return 0;
+    i = (i + 1) & set->mask;
+  }
+  set->slots[i] = name;
+  return 1;
+}
+
+static int name_set_contains(const NameSet *set, const char *name) {
+  size_t i = (size_t)name_hash(name) & set->mask;
+  while (set->slots[i]) {
+    if (strcmp(set->slots[i], name) == 0)
+      return 1;
+    i = (i + 1) & set->mask;
+  }
+  return 0;
+}
+
+// ---- Entry Extraction ----
+
+// State shared by every entry of one extraction
+typedef struct {
+  const CArchive *archive;
+  void *reader;
+  const char *output_dir;
+  const ExtractionPolicy *policy;
+  ThreadPool *pool;
+  ExtractSink *sink;
+  int use_shards;
+  ExtractTarget *targets;
+  size_t target_count;
+  size_t target_capacity;
+  NameSet queued; // output paths of the writes handed to the pool
+  char **queued_paths;
+  size_t queued_count;
+  char last_parent[PATH_MAX];
+} ExtractContext;
+
+// Pool writes tracked at once; past this the pool is drained and the
+// tracking starts over
+#define EXTRACT_MAX_QUEUED 4096
+
+// Wait for every write handed to the pool and forget their paths
+static void drain_writes(ExtractContext *ctx) {
+  for (size_t i = 0; i < ctx->queued_count; i++)
+    free(ctx->queued_paths[i]);
+  ctx->queued_count = 0;
+  if (ctx->queued.slots)
+    memset((void *)ctx->queued.slots, 0,
+           (ctx->queued.mask + 1) * sizeof(const char *));
+
+  COMP_BEGIN_ALLOW_THREADS threadpool_wait(ctx->pool);
+  COMP_END_ALLOW_THREADS
+}
+
+// Note a write of out_path about to be queued. Two writes of one path on
+// different workers may land in either order, so a repeat (tar keeps the
+// last of duplicate names) first waits for the earlier one.
+static int track_write(ExtractContext *ctx, const char *out_path) {
+  if (!ctx->queued_paths) {
+    if (name_set_init(&ctx->queued, EXTRACT_MAX_QUEUED) != 0)
+      return -1;
+    ctx->queued_paths = calloc(EXTRACT_MAX_QUEUED, sizeof(char *));
+    if (!ctx->queued_paths) {
+      PyErr_NoMemory();
       return -1;
     }
+  }
+  if (ctx->queued_count == EXTRACT_MAX_QUEUED ||
+      name_set_contains(&ctx->queued, out_path))
+    drain_writes(ctx);
 
-    if (num_files > 0) {
-      int should_extract = 0;
-      for (size_t i = 0; i < num_files; i++) {
-        if (strcmp(entry.path, files[i]) == 0) {
-          should_extract = 1;
-          break;
-        }
-      }
-      if (!should_extract) {
-        free(entry.path);
-        free(entry.symlink_target);
-        archive->skip_entry_data(reader);
-        continue;
-      }
+  char *path = strdup(out_path);
+  if (!path) {
+    PyErr_NoMemory();
+    return -1;
+  }
+  ctx->queued_paths[ctx->queued_count++] = path;
+  name_set_add(&ctx->queued, path);
+  return 0;
+}
+
+// Keep only the last target of each path: shards decode their targets in
+// parallel, so earlier ones of the same name would race it
+static int drop_replaced_targets(ExtractContext *ctx) {
+  NameSet seen;
+  if (name_set_init(&seen, ctx->target_count) != 0)
+    return -1;
+  for (size_t i = ctx->target_count; i-- > 0;) {
+    if (!name_set_add(&seen, ctx->targets[i].path))
+      ctx->targets[i].index = -1;
+  }
+  name_set_free(&seen);
+  return 0;
+}
+
+static int add_target(ExtractContext *ctx, int64_t index, const char *path,
+                      uint32_t mode) {
+  if (ctx->target_count == ctx->target_capacity) {
+    size_t capacity = ctx->target_capacity ? ctx->target_capacity * 2 : 256;
+    ExtractTarget *grown =
+        realloc(ctx->targets, capacity * sizeof(ExtractTarget));
+    if (!grown) {
+      PyErr_NoMemory();
+      return -1;
     }
+    ctx->targets = grown;
+    ctx->target_capacity = capacity;
+  }
 
-    char out_path[PATH_MAX];
-    snprintf(out_path, sizeof(out_path), "%s/%s", output_dir, entry.path);
+  ExtractTarget *target = &ctx->targets[ctx->target_count];
+  target->index = index;
+  target->mode = mode;
+  target->path = strdup(path);
+  if (!target->path) {
+    PyErr_NoMemory();
+    return -1;
+  }
+  ctx->target_count++;
+  return 0;
+}
 
-    if (entry.type == ENTRY_DIR) {
-      mkdir_p(out_path, entry.mode);
-    } else if (entry.type == ENTRY_FILE) {
-      char *last_slash = strrchr(out_path, '/');
-      if (last_slash) {
-        *last_slash = '\0';
-        mkdir_p(out_path, 0755);
-        *last_slash = '/';
-      }
+// Write one entry the reader is positioned on. With a pool, tar entries are
+// decoded here and written by the workers; backends with shards have their
+// files decoded by the workers too.
+static int extract_one(ExtractContext *ctx, const ArchiveEntry *entry,
+                       int64_t index) {
+  const CArchive *archive = ctx->archive;
 
-      FILE *f = fopen(out_path, "wb");
-      if (!f) {
-        free(entry.path);
-        free(entry.symlink_target);
-        PyErr_SetFromErrnoWithFilename(PyExc_OSError, out_path);
-        return -1;
-      }
+  if (validate_entry_path(ctx->output_dir, entry->path, 0, ctx->policy) != 0 ||
+      check_entry_policy(entry, ctx->policy) != 0) {
+    return -1;
+  }
 
-      if (archive->extract_entry_data(reader, f) != 0) {
-        fclose(f);
-        free(entry.path);
-        free(entry.symlink_target);
-        return -1;
-      }
+  char out_path[PATH_MAX];
+  snprintf(out_path, sizeof(out_path), "%s/%s", ctx->output_dir, entry->path);
 
-      int file_fd = fileno(f);
-      if (file_fd >= 0) {
-        fchmod(file_fd, entry.mode);
-      }
-      fclose(f);
+  if (entry->type == ENTRY_DIR) {
+    mkdir_p(out_path, entry->mode);
+    return 0;
+  }
+  if (entry->type != ENTRY_FILE) {
+    return 0;
+  }
+
+  ensure_parent_dir(out_path, ctx->last_parent);
+
+  if (ctx->use_shards) {
+    if (add_target(ctx, index, out_path, entry->mode) != 0)
+      return -1;
+    archive->skip_entry_data(ctx->reader);
+    return 0;
+  }
+
+  if (ctx->pool && entry->size <= EXTRACT_ASYNC_MAX_ENTRY) {
+    char *data;
+    size_t size;
+    if (track_write(ctx, out_path) != 0)
+      return -1;
+    if (read_entry_to_memory(archive, ctx->reader, &data, &size) != 0)
+      return -1;
+    return queue_write(ctx->pool, ctx->sink, out_path, entry->mode, data, size);
+  }
+
+  // Let queued writes land first, in case this entry replaces one
+  if (ctx->pool)
+    drain_writes(ctx);
+
+  FILE *f = fopen(out_path, "wb");
+  if (!f) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, out_path);
+    return -1;
+  }
+
+  int ret = archive->extract_entry_data(ctx->reader, f);
+  if (ret == 0 && io_sparse_finish(f) != 0) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, out_path);
+    ret = -1;
+  }
+  int file_fd = fileno(f);
+  if (ret == 0 && file_fd >= 0) {
+    fchmod(file_fd, entry->mode);
+  }
+  fclose(f);
+  if (ret != 0 && io_cancelled() != IO_CANCEL_NONE)
+    unlink(out_path); // cut short: drop the partial entry
+  return ret;
+}
+
+// Walk every entry, extracting those in the request set (all when NULL)
+static int extract_scan(ExtractContext *ctx, const NameSet *wanted) {
+  const CArchive *archive = ctx->archive;
+  ArchiveEntry entry = {0};
+  int64_t index = -1;
+  int ret;
+
+  while ((ret = archive->get_next_entry(ctx->reader, &entry)) == 1) {
+    if (io_cancelled() != IO_CANCEL_NONE) {
+      free(entry.path);
+      free(entry.symlink_target);
+      return cancel_raise();
     }
+    index++;
+    int skip = !entry.path || (wanted && !name_set_contains(wanted, entry.path));
+    int failed = !skip && extract_one(ctx, &entry, index) != 0;
+    if (skip)
+      archive->skip_entry_data(ctx->reader);
 
     free(entry.path);
     free(entry.symlink_target);
+    if (failed)
+      return -1;
+    if (ctx->sink && sink_failed(ctx->sink))
+      return 0;
   }
-
   return ret < 0 ? -1 : 0;
 }
 
-int extract_archive(const char *archive_path, const char *output_dir,
-                    const char **files, size_t num_files) {
-  const ExtractionPolicy *policy = &EXTRACTION_POLICY_DEFAULT;
+// Returned by extract_located when the reader cannot look names up
+#define EXTRACT_UNLOCATED 1
 
-  CompressionPipeline pipe = detect_pipeline_from_path(archive_path);
-  if (!pipeline_is_valid(&pipe) || pipe.archive == ARCHIVE_NONE) {
-    PyErr_SetString(PyExc_ValueError, "Not an archive format");
+// Look each requested name up directly; names not in the archive are skipped
+static int extract_located(ExtractContext *ctx, const char **files,
+                           size_t num_files) {
+  const CArchive *archive = ctx->archive;
+  NameSet seen;
+  if (name_set_init(&seen, num_files) != 0)
     return -1;
+
+  int ret = 0;
+  for (size_t i = 0; i < num_files && ret == 0; i++) {
+    if (io_cancelled() != IO_CANCEL_NONE) {
+      ret = cancel_raise();
+      break;
+    }
+    if (!name_set_add(&seen, files[i]))
+      continue; // Requested twice
+
+    int64_t index = archive->locate_entry(ctx->reader, files[i]);
+    if (index == -3) {
+      ret = EXTRACT_UNLOCATED; // on the first name, so nothing is written
+      break;
+    }
+    if (index == -2) {
+      ret = -1;
+      break;
+    }
+    if (index < 0)
+      continue;
+
+    ArchiveEntry entry = {0};
+    int got = archive->get_next_entry(ctx->reader, &entry);
+    if (got == 1 && entry.path)
+      ret = extract_one(ctx, &entry, index);
+    else if (got < 0)
+      ret = -1;
+
+    free(entry.path);
+    free(entry.symlink_target);
+    if (ctx->sink && sink_failed(ctx->sink))
+      break;
   }
 
-  const CArchive *archive = find_archive_by_id(pipe.archive);
-  if (!archive || !archive->is_available()) {
-    PyErr_SetString(comp_Error, "Archive backend not available");
-    return -1;
+  name_set_free(&seen);
+  return ret;
+}
+
+static int extract_entries(const CArchive *archive, void *reader,
+                           const char *output_dir, const char **files,
+                           size_t num_files, const ExtractionPolicy *policy,
+                           ThreadPool *pool, ExtractSink *sink) {
+  ExtractContext ctx = {
+      .archive = archive,
+      .reader = reader,
+      .output_dir = output_dir,
+      .policy = policy,
+      .pool = pool,
+      .sink = sink,
+      .use_shards = pool && archive->open_shard && archive->extract_index &&
+                    archive->close_shard,
+      .targets = NULL,
+      .target_count = 0,
+      .target_capacity = 0,
+      .queued = {NULL, 0},
+      .queued_paths = NULL,
+      .queued_count = 0,
+  };
+  ctx.last_parent[0] = '\0';
+
+  int ret = EXTRACT_UNLOCATED;
+  if (num_files > 0 && archive->locate_entry)
+    ret = extract_located(&ctx, files, num_files);
+
+  if (ret == EXTRACT_UNLOCATED && num_files > 0) {
+    NameSet wanted;
+    ret = name_set_init(&wanted, num_files);
+    if (ret == 0) {
+      for (size_t i = 0; i < num_files; i++)
+        name_set_add(&wanted, files[i]);
+      ret = extract_scan(&ctx, &wanted);
+      name_set_free(&wanted);
+    }
+  } else if (ret == EXTRACT_UNLOCATED) {
+    ret = extract_scan(&ctx, NULL);
   }
 
-  // Decode the codec stage to a temporary archive first, if present
+  if (ret == 0 && ctx.target_count > 0 && !sink_failed(sink))
+    ret = drop_replaced_targets(&ctx);
+  if (ret == 0 && ctx.target_count > 0 && !sink_failed(sink))
+    ret = run_shards(archive, reader, pool, sink, ctx.targets,
+                     ctx.target_count);
+
+  for (size_t i = 0; i < ctx.target_count; i++)
+    free(ctx.targets[i].path);
+  free(ctx.targets);
+  // The pool is destroyed after this, which finishes their writes
+  for (size_t i = 0; i < ctx.queued_count; i++)
+    free(ctx.queued_paths[i]);
+  free(ctx.queued_paths);
+  name_set_free(&ctx.queued);
+  return ret;
+}
+
+// extract_archive; *format is the archive's once it opened
+static int extract_archive_as(const char *archive_path, const char *output_dir,
+                              const char **files, size_t num_files,
+                              int threads, Format *format) {
+  const ExtractionPolicy *policy = &EXTRACTION_POLICY_DEFAULT;
+
+  const CArchive *archive = NULL;
   char *tmp_path = NULL;
-  const char *read_path = archive_path;
-  if (pipe.codec != FORMAT_UNKNOWN) {
-    const StandaloneFormat *codec = find_standalone_format(pipe.codec);
-    tmp_path = make_temp_path(archive_path);
-    if (!tmp_path)
-      return -1;
-    if (codec->decompress_file(archive_path, tmp_path) != 0) {
-      unlink(tmp_path);
-      free(tmp_path);
+  void *reader =
+      open_archive_reader(archive_path, threads, &archive, &tmp_path);
+  if (!reader)
+    return -1;
+  *format = archive_stats_format(archive->id);
+
+  mkdir(output_dir, 0755);
+
+  ThreadPool *pool = NULL;
+  ExtractSink sink = {.buffered = 0, .error = 0, .error_path = NULL};
+  int nthreads = threadpool_resolve_threads(threads);
+  if (nthreads > 1) {
+    pool = threadpool_create(nthreads);
+    if (!pool) {
+      archive->close_reader(reader);
+      if (tmp_path) {
+        unlink(tmp_path);
+        free(tmp_path);
+      }
+      PyErr_SetString(PyExc_RuntimeError, "Failed to start worker threads");
       return -1;
     }
-    read_path = tmp_path;
+    pthread_mutex_init(&sink.lock, NULL);
+    pthread_cond_init(&sink.cond, NULL);
   }
 
-  void *reader = archive->create_reader(read_path);
-  if (!reader) {
-    if (tmp_path) {
-      unlink(tmp_path);
-      free(tmp_path);
+  int ret = extract_entries(archive, reader, output_dir, files, num_files,
+                            policy, pool, pool ? &sink : NULL);
+
+  if (pool) {
+    COMP_BEGIN_ALLOW_THREADS threadpool_destroy(pool);
+    COMP_END_ALLOW_THREADS
+
+        if (sink.error && ret == 0) {
+      errno = sink.error;
+      PyErr_SetFromErrnoWithFilename(PyExc_OSError, sink.error_path);
+      ret = -1;
     }
-    return -1;
+    free(sink.error_path);
+    pthread_mutex_destroy(&sink.lock);
+    pthread_cond_destroy(&sink.cond);
   }
 
-  mkdir(output_dir, 0755);
-
-  int ret =
-      extract_entries(archive, reader, output_dir, files, num_files, policy);
   if (archive->close_reader(reader) != 0)
     ret = -1;
 
@@ -544,8 +1334,68 @@ int extract_archive(const char *archive_path, const char *output_dir,
   return ret;
 }
 
-// Collect entry paths from an already-open reader into a new Python list
-static PyObject *read_archive_names(const CArchive *archive, void *reader) {
+int extract_archive(const char *archive_path, const char *output_dir,
+                    const char **files, size_t num_files, int threads) {
+  Format format = FORMAT_UNKNOWN;
+  StatsSpan span;
+  stats_span_begin(&span);
+  int ret = extract_archive_as(archive_path, output_dir, files, num_files,
+                               threads, &format);
+  stats_file_span(&span, format, 0, archive_path, NULL, ret != 0);
+  return ret;
+}
+
+// ---- Archive Listing ----
+
+static const char *const ENTRY_TYPE_NAMES[] = {"file", "dir", "symlink",
+                                               "special"};
+
+// One row of a listing: the entry's path, or with details its dict
+static PyObject *listing_item(int details, const char *path, EntryType type,
+                              uint64_t size, int64_t mtime, uint32_t mode,
+                              const char *symlink_target) {
+  if (!path)
+    path = "";
+  if (!details)
+    return PyUnicode_FromString(path);
+  return Py_BuildValue("{s:s,s:s,s:K,s:L,s:I,s:z}", "path", path, "type",
+                       ENTRY_TYPE_NAMES[type], "size",
+                       (unsigned long long)size, "mtime", (long long)mtime,
+                       "mode", (unsigned int)mode, "link_target",
+                       symlink_target);
+}
+
+// Append item to list, taking the reference; returns -1 on error
+static int listing_append(PyObject *list, PyObject *item) {
+  if (!item)
+    return -1;
+  int ret = PyList_Append(list, item);
+  Py_DECREF(item);
+  return ret;
+}
+
+// A listing straight from a catalog, without opening the archive
+static PyObject *read_catalog_listing(const ArchiveCatalog *catalog,
+                                      int details) {
+  PyObject *list = PyList_New(0);
+  if (!list)
+    return NULL;
+
+  for (size_t i = 0; i < catalog->count; i++) {
+    const CatalogEntry *e = &catalog->entries[i];
+    if (listing_append(list, listing_item(details, e->path, e->type, e->size,
+                                          e->mtime, e->mode,
+                                          e->symlink_target)) < 0) {
+      Py_DECREF(list);
+      return NULL;
+    }
+  }
+  return list;
+}
+
+// Collect entries from an already-open reader into a new Python list
+static PyObject *read_archive_listing(const CArchive *archive, void *reader,
+                                      int details) {
   PyObject *list = PyList_New(0);
   if (!list)
     return NULL;
@@ -554,20 +1404,16 @@ static PyObject *read_archive_names(const CArchive *archive, void *reader) {
   int ret;
 
   while ((ret = archive->get_next_entry(reader, &entry)) == 1) {
-    PyObject *item = PyUnicode_FromString(entry.path ? entry.path : "");
+    PyObject *item = listing_item(details, entry.path, entry.type, entry.size,
+                                  (int64_t)entry.mtime, entry.mode,
+                                  entry.symlink_target);
     free(entry.path);
     free(entry.symlink_target);
 
-    if (!item) {
+    if (listing_append(list, item) < 0) {
       Py_DECREF(list);
       return NULL;
     }
-    if (PyList_Append(list, item) < 0) {
-      Py_DECREF(item);
-      Py_DECREF(list);
-      return NULL;
-    }
-    Py_DECREF(item);
     archive->skip_entry_data(reader);
   }
 
@@ -579,52 +1425,212 @@ static PyObject *read_archive_names(const CArchive *archive, void *reader) {
   return list;
 }
 
-PyObject *list_archive_contents(const char *archive_path) {
-  CompressionPipeline pipe = detect_pipeline_from_path(archive_path);
-  if (!pipeline_is_valid(&pipe) || pipe.archive == ARCHIVE_NONE) {
-    PyErr_SetString(PyExc_ValueError, "Not an archive format");
-    return NULL;
+static PyObject *list_archive(const char *archive_path, int details) {
+  ArchiveCatalog catalog;
+  catalog_init(&catalog);
+  if (catalog_load(&catalog, archive_path) == 0) {
+    PyObject *list = read_catalog_listing(&catalog, details);
+    catalog_free(&catalog);
+    return list;
   }
 
-  const CArchive *archive = find_archive_by_id(pipe.archive);
-  if (!archive || !archive->is_available()) {
-    PyErr_SetString(comp_Error, "Archive backend not available");
+  const CArchive *archive = NULL;
+  char *tmp_path = NULL;
+  void *reader = open_archive_reader(archive_path, 1, &archive, &tmp_path);
+  if (!reader)
     return NULL;
+
+  PyObject *list = read_archive_listing(archive, reader, details);
+  archive->close_reader(reader);
+
+  if (tmp_path) {
+    unlink(tmp_path);
+    free(tmp_path);
   }
+  return list;
+}
 
-  // Decode the codec stage to a temporary archive first, if present
-  char *tmp_path = NULL;
-  const char *read_path = archive_path;
-  if (pipe.codec != FORMAT_UNKNOWN) {
-    const StandaloneFormat *codec = find_standalone_format(pipe.codec);
-    tmp_path = make_temp_path(archive_path);
-    if (!tmp_path)
-      return NULL;
-    if (codec->decompress_file(archive_path, tmp_path) != 0) {
-      unlink(tmp_path);
-      free(tmp_path);
-      return NULL;
-    }
-    read_path = tmp_path;
+PyObject *list_archive_contents(const char *archive_path) {
+  return list_archive(archive_path, 0);
+}
+
+PyObject *list_archive_entries(const char *archive_path) {
+  return list_archive(archive_path, 1);
+}
+
+// ---- Archive Conversion ----
+
+// Conversion never lands on disk in between. A codec change on the same
+// archive is one decode-encode pass over the archive's bytes (the backend's
+// transcode hook); anything else re-packs entry by entry, each file's data
+// decoded from the source as the target writer reads it. Only a writer that
+// needs a descriptor (zip) has each file spooled to an unlinked temp file.
+
+// The source reader's current entry, as pulled through a read stream
+typedef struct {
+  const CArchive *archive;
+  void *reader;
+  int error; // the first read error
+} EntrySource;
+
+static int entry_source_read(void *ctx, void *buf, size_t size, size_t *got) {
+  EntrySource *src = (EntrySource *)ctx;
+  int error = src->archive->read_entry_data(src->reader, buf, size, got);
+  if (error && !src->error)
+    src->error = error;
+  return error;
+}
+
+typedef struct {
+  const char *input_path;
+  const char *output_path;
+  const CArchive *source;
+  void *reader;
+  const CArchive *target;
+  void *writer;
+  int streams; // entries can go straight from reader to writer
+} ConvertContext;
+
+// Hand the writer a decoded copy of the current entry, for when it cannot
+// take a stream
+static int convert_spooled(ConvertContext *ctx, const ArchiveEntry *entry) {
+  char *tmp_path = make_temp_path(ctx->output_path);
+  if (!tmp_path)
+    return -1;
+  FILE *spool = fopen(tmp_path, "w+b");
+  if (!spool) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, tmp_path);
+    unlink(tmp_path);
+    free(tmp_path);
+    return -1;
   }
+  unlink(tmp_path); // gone once the writer is done with it
+  free(tmp_path);
 
-  void *reader = archive->create_reader(read_path);
-  if (!reader) {
-    if (tmp_path) {
-      unlink(tmp_path);
-      free(tmp_path);
+  int ret = ctx->source->extract_entry_data(ctx->reader, spool);
+  if (ret == 0 &&
+      (io_sparse_finish(spool) != 0 || fseeko(spool, 0, SEEK_SET) != 0)) {
+    PyErr_SetFromErrno(PyExc_OSError);
+    ret = -1;
+  }
+  if (ret == 0)
+    ret = ctx->target->add_entry(ctx->writer, entry, spool);
+  fclose(spool);
+  return ret;
+}
+
+static int convert_entry(ConvertContext *ctx, ArchiveEntry *entry) {
+  if (entry->type != ENTRY_FILE) {
+    // zip names directories with a trailing slash; writers add their own
+    size_t len = strlen(entry->path);
+    while (entry->type == ENTRY_DIR && len > 1 && entry->path[len - 1] == '/')
+      entry->path[--len] = '\0';
+    ctx->source->skip_entry_data(ctx->reader);
+    return ctx->target->add_entry(ctx->writer, entry, NULL);
+  }
+
+  EntrySource src = {ctx->source, ctx->reader, 0};
+  FILE *data =
+      ctx->streams ? io_open_read_stream(entry_source_read, &src) : NULL;
+  if (!data)
+    return convert_spooled(ctx, entry);
+
+  int ret = ctx->target->add_entry(ctx->writer, entry, data);
+  fclose(data);
+  if (ret != 0 && src.error && io_cancelled() == IO_CANCEL_NONE) {
+    // The writer only saw a short read; name the archive it came from
+    PyErr_Clear();
+    errno = src.error;
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, ctx->input_path);
+  }
+  return ret;
+}
+
+static int convert_entries(ConvertContext *ctx) {
+  ArchiveEntry entry = {0};
+  int ret;
+
+  while ((ret = ctx->source->get_next_entry(ctx->reader, &entry)) == 1) {
+    int failed;
+    if (io_cancelled() != IO_CANCEL_NONE) {
+      failed = cancel_raise();
+    } else if (!entry.path) {
+      PyErr_NoMemory();
+      failed = -1;
+    } else {
+      failed = convert_entry(ctx, &entry);
     }
-    return NULL;
+    free(entry.path);
+    free(entry.symlink_target);
+    if (failed)
+      return -1;
   }
+  return ret < 0 ? -1 : 0;
+}
 
-  PyObject *list = read_archive_names(archive, reader);
-  archive->close_reader(reader);
+// Non-zero if archive reads and writes pipe's codec itself
+static int codec_in_place(const CArchive *archive,
+                          const CompressionPipeline *pipe) {
+  return pipe->codec == FORMAT_UNKNOWN ||
+         (archive->supports_codec && archive->supports_codec(pipe));
+}
+
+static int convert_archive_with(const char *input_path,
+                                const char *output_path,
+                                const CompressionPipeline *pipeline) {
+  struct stat in_st, out_st;
+  if (stat(input_path, &in_st) == 0 && stat(output_path, &out_st) == 0 &&
+      in_st.st_dev == out_st.st_dev && in_st.st_ino == out_st.st_ino) {
+    PyErr_SetString(PyExc_ValueError,
+                    "Cannot convert an archive onto itself");
+    return -1;
+  }
+
+  const CArchive *target = output_archive(pipeline);
+  if (!target)
+    return -1;
+
+  CompressionPipeline from = detect_pipeline_from_path(input_path);
+  if (target->transcode && from.archive == pipeline->archive &&
+      codec_in_place(target, &from) && codec_in_place(target, pipeline)) {
+    return target->transcode(input_path, output_path, pipeline);
+  }
 
+  ConvertContext ctx = {.input_path = input_path, .output_path = output_path};
+  char *tmp_path = NULL;
+  ctx.reader = open_archive_reader(input_path, pipeline->threads, &ctx.source,
+                                   &tmp_path);
+  if (!ctx.reader)
+    return -1;
+
+  ArchiveOutput out;
+  int ret = open_archive_output(&out, output_path, pipeline);
+  if (ret == 0) {
+    ctx.target = out.archive;
+    ctx.writer = out.writer;
+    ctx.streams = ctx.source->read_entry_data &&
+                  out.archive->add_entry_streams &&
+                  out.archive->add_entry_streams();
+    ret = convert_entries(&ctx);
+    ret = close_archive_output(&out, output_path, pipeline, ret);
+  }
+
+  ctx.source->close_reader(ctx.reader);
   if (tmp_path) {
     unlink(tmp_path);
     free(tmp_path);
   }
-  return list;
+  return ret;
+}
+
+int convert_archive_format(const char *input_path, const char *output_path,
+                           const CompressionPipeline *pipeline) {
+  StatsSpan span;
+  stats_span_begin(&span);
+  int ret = convert_archive_with(input_path, output_path, pipeline);
+  stats_file_span(&span, archive_stats_format(pipeline->archive), 1,
+                  input_path, output_path, ret != 0);
+  return ret;
 }
 
 // ---- Archive Capabilities ----
@@ -634,7 +1640,8 @@ PyObject *get_archive_capabilities(void) {
   if (!list)
     return NULL;
 
-  const CArchive *backends[] = {get_tar_archive(), get_zip_archive()};
+  const CArchive *backends[] = {get_tar_archive(), get_zip_archive(),
+                                get_cdar_archive()};
   size_t n = sizeof(backends) / sizeof(backends[0]);
 
   for (size_t i = 0; i < n; i++) {
@@ -31,6 +31,9 @@ typedef struct {
 
 // ---- Archive Backend Interface ----
 
+struct ArchiveCatalog;
+struct CompressionPipeline;
+
 typedef struct CArchive {
   const char *name;
   uint8_t id;
@@ -41,11 +44,31 @@ typedef struct CArchive {
   int (*requires_external_compression)(void);
   int (*supports_streaming)(void);
 
-  // Writing (Creating Archives)
-  void *(*create_writer)(const char *output_path, int compression_level);
+  // Writing (Creating Archives). The writer takes the pipeline's level and
+  // thread count, and applies its codec itself when supports_codec says so.
+  void *(*create_writer)(const char *output_path,
+                         const struct CompressionPipeline *pipeline);
   int (*add_entry)(void *writer, const ArchiveEntry *entry, FILE *data);
   int (*close_writer)(void *writer);
 
+  // Optional: non-zero if the writer and reader can stream through
+  // pipeline->codec themselves, with no temp-file pass
+  int (*supports_codec)(const struct CompressionPipeline *pipeline);
+
+  // Optional: add a regular file by path, so the writer can schedule its own
+  // reads (e.g. on worker threads); preferred over add_entry for files
+  int (*add_file)(void *writer, const ArchiveEntry *entry,
+                  const char *source_path);
+
+  // Optional: non-zero if add_entry only reads a file's data front to back
+  // with fread, so it can be handed a stream decoded as it goes
+  int (*add_entry_streams)(void);
+
+  // Optional: record every entry the writer adds, with the offset of its
+  // header in the uncompressed stream, into catalog (see catalog.h), which
+  // the caller keeps and saves once the archive is complete
+  void (*set_catalog)(void *writer, struct ArchiveCatalog *catalog);
+
   // Reading (Extracting Archives)
   void *(*create_reader)(const char *input_path);
   int (*get_entry_count)(void *reader);
@@ -54,6 +77,32 @@ typedef struct CArchive {
   int (*skip_entry_data)(void *reader);
   int (*reset_reader)(void *reader);
   int (*close_reader)(void *reader);
+
+  // Optional: read the current entry's data front to back, up to size
+  // bytes into buf, for piping it into another archive's writer; *got is 0
+  // at the end of the entry. Runs without the GIL and never touches the
+  // Python API: returns 0 or an errno value.
+  int (*read_entry_data)(void *reader, void *buf, size_t size, size_t *got);
+
+  // Optional: rewrite the archive at input_path, read back through its own
+  // codec, to output_path through pipeline's codec in one streaming pass,
+  // leaving the archive's bytes as they are; for changing only the codec
+  int (*transcode)(const char *input_path, const char *output_path,
+                   const struct CompressionPipeline *pipeline);
+
+  // Optional: position the reader on path so the next get_next_entry
+  // returns it. Returns the entry's index, -1 if absent, -2 on error, or -3
+  // when this reader has nothing to look names up in, so the caller scans.
+  int64_t (*locate_entry)(void *reader, const char *path);
+
+  // Optional random access for parallel extraction. A shard is an
+  // independent handle on the reader's archive; entries are addressed by
+  // their position in get_next_entry order. These run on worker threads
+  // without the GIL: they never touch the Python API and return 0 or an
+  // errno value.
+  void *(*open_shard)(void *reader);
+  int (*extract_index)(void *shard, int64_t index, int fd);
+  void (*close_shard)(void *shard);
 } CArchive;
 
 // ---- Extraction Policy ----
@@ -84,6 +133,7 @@ PyObject *get_archive_capabilities(void);
 
 const CArchive *get_tar_archive(void);
 const CArchive *get_zip_archive(void);
+const CArchive *get_cdar_archive(void);
 
 // ---- Archive IDs ----
 
@@ -91,7 +141,8 @@ typedef enum {
   ARCHIVE_NONE = 0,
   ARCHIVE_TAR = 1,
   ARCHIVE_ZIP = 2,
-  ARCHIVE_7Z = 3
+  ARCHIVE_7Z = 3,
+  ARCHIVE_CDAR = 4
 } ArchiveID;
 
 // ---- Format Detection ----
@@ -110,12 +161,22 @@ typedef enum {
   // Multi-file formats with built-in compression
   FORMAT_ZIP = 10,
   FORMAT_7Z = 11,
+  FORMAT_CDAR = 12, // compresso deduplicating archive
 
   // Multi-file formats without built-in compression
   FORMAT_TAR = 20
 } Format;
 
+// How much of a file's start detection looks at: enough for a tar header
+#define FORMAT_HEAD_SIZE 512
+
 Format detect_format_from_magic_bytes(const unsigned char *magic, size_t size);
+// Magic bytes, then the tar header, in the first bytes of a file; for
+// callers that already hold them
+Format detect_format_from_head(const unsigned char *head, size_t size);
+// Reads the file's first bytes without moving fd's offset; no extension
+// fallback, as there is no name to go by
+Format detect_format_from_fd(int fd);
 Format detect_format_from_path(const char *path);
 Format detect_format_from_extension(const char *path);
 
@@ -132,11 +193,15 @@ OperationMode get_operation_mode(Format format);
 
 // ---- Compression Pipeline ----
 
-typedef struct {
+typedef struct CompressionPipeline {
   ArchiveID archive;     // ARCHIVE_NONE for standalone compression
   Format codec;          // FORMAT_UNKNOWN = no codec (plain tar / zip's
                          // built-in); otherwise a standalone codec Format
   int compression_level; // -1 for default
+  int threads;           // Worker threads for writing, 0 = one per CPU
+  const char *base;      // cdar: earlier archive whose chunks new ones may
+                         // reference instead of storing again, or NULL
+  int catalog;           // tar: also write a <output>.catalog sidecar
 } CompressionPipeline;
 
 // Map an archive Format to its ArchiveID
@@ -160,12 +225,24 @@ int pipeline_is_valid(const CompressionPipeline *p);
 int create_archive(const char *output_path, const CompressionPipeline *pipeline,
                    const char **input_paths, size_t num_paths);
 
+// threads: file writers (and, for random-access backends, decoders) to run;
+// 0 = one per CPU
 int extract_archive(const char *archive_path, const char *output_dir,
-                    const char **files, size_t num_files);
+                    const char **files, size_t num_files, int threads);
 
 PyObject *list_archive_contents(const char *archive_path);
 
+// One dict per entry, in archive order: path, type ("file", "dir",
+// "symlink" or "special"), size, mtime, mode and link_target. This and
+// list_archive_contents read a tar's catalog sidecar instead of the archive
+// while it is current; zip is listed from its central directory.
+PyObject *list_archive_entries(const char *archive_path);
+
+// Re-pack the archive at input_path as pipeline in one pass, with no temp
+// archive or extraction when both backends can stream: a codec change on
+// the same archive is a single decode-encode pass, anything else is copied
+// entry by entry
 int convert_archive_format(const char *input_path, const char *output_path,
-                           Format new_format, int compression_level);
+                           const CompressionPipeline *pipeline);
 
 #endif // ARCHIVE_H
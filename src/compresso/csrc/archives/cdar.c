@@ -0,0 +1,1530 @@
+#define PY_SSIZE_T_CLEAN
+#include "../archives.h"
+#include "../checksum.h"
+#include "../common.h"
+#include "../context.h"
+#include "../fileio.h"
+#include <Python.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
+
+// ---- CDAR Format ----
+
+// Deduplicating archive. Inputs are cut into chunks at content-defined
+// boundaries, each distinct chunk is compressed and stored once, and every
+// file is a list of chunk ids. Chunks may also live in earlier archives
+// ("stores"), so an incremental archive only holds what changed.
+//
+// Layout, all integers little-endian:
+//   header   "CDAR", u8 version, u8 catalog algo, u16 reserved, u64 id
+//   chunks   compressed chunks back to back
+//   catalog  compressed with the catalog algo (see cdar_encode_catalog)
+//   trailer  u64 catalog offset, u64 compressed size, u64 raw size,
+//            u32 crc32 of the raw catalog, "CDAX"
+//
+// Store 0 is the archive itself. Other stores are named relative to the
+// archive's directory (or absolute) and checked against their header id.
+
+#define CDAR_MAGIC "CDAR"
+#define CDAR_TRAILER_MAGIC "CDAX"
+#define CDAR_VERSION 1
+#define CDAR_HEADER_SIZE 16
+#define CDAR_TRAILER_SIZE 32
+
+// Chunk sizes. The chunker's output must never change for a given input,
+// or new archives would stop deduplicating against old ones.
+#define CDAR_MIN_CHUNK (2U * 1024)
+#define CDAR_AVG_CHUNK (8U * 1024)
+#define CDAR_MAX_CHUNK (64U * 1024)
+
+// Normalised chunking: cut points are harder to hit before the average size
+// and easier after it, which narrows the spread of chunk sizes. The gear
+// hash shifts left, so its high bits carry the most history.
+#define CDAR_MASK_STRICT 0xFFFE000000000000ULL // 15 bits
+#define CDAR_MASK_LOOSE 0xFFE0000000000000ULL  // 11 bits
+
+// Bytes read from an input per refill of the chunking window
+#define CDAR_READ_SIZE (1U << 20)
+
+// Chunk key: two independently seeded XXH64 digests
+#define CDAR_HASH_SEED_HI 0x9E3779B97F4A7C15ULL
+
+// On-disk record sizes, used to bound counts before allocating
+#define CDAR_STORE_MIN_RECORD 10
+#define CDAR_CHUNK_RECORD 37
+#define CDAR_ENTRY_MIN_RECORD 30
+
+typedef struct {
+  uint64_t lo;
+  uint64_t hi;
+} CdarHash;
+
+typedef struct {
+  uint32_t store;
+  uint8_t algo; // ALGO_NONE = stored raw
+  uint64_t offset;
+  uint32_t comp_size;
+  uint32_t raw_size;
+  CdarHash hash;
+} CdarChunk;
+
+typedef struct {
+  uint64_t id;
+  char *name; // "" for the archive itself
+} CdarStore;
+
+typedef struct {
+  EntryType type;
+  uint32_t mode;
+  int64_t mtime;
+  uint64_t size;
+  char *path;
+  char *link; // NULL unless a symlink
+  uint32_t *chunks;
+  uint32_t chunk_count;
+  uint32_t chunk_capacity;
+} CdarEntry;
+
+typedef struct {
+  CdarStore *stores;
+  uint32_t store_count;
+  CdarChunk *chunks;
+  uint32_t chunk_count;
+  uint32_t chunk_capacity;
+  CdarEntry *entries;
+  uint32_t entry_count;
+  uint32_t entry_capacity;
+} CdarCatalog;
+
+// ---- Byte Helpers ----
+
+static inline void put_le16(unsigned char *p, uint16_t v) {
+  p[0] = (unsigned char)(v & 0xFF);
+  p[1] = (unsigned char)(v >> 8);
+}
+
+static inline void put_le32(unsigned char *p, uint32_t v) {
+  put_le16(p, (uint16_t)(v & 0xFFFF));
+  put_le16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline void put_le64(unsigned char *p, uint64_t v) {
+  put_le32(p, (uint32_t)(v & 0xFFFFFFFFu));
+  put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+static inline uint16_t get_le16(const unsigned char *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_le32(const unsigned char *p) {
+  return (uint32_t)get_le16(p) | ((uint32_t)get_le16(p + 2) << 16);
+}
+
+static inline uint64_t get_le64(const unsigned char *p) {
+  return (uint64_t)get_le32(p) | ((uint64_t)get_le32(p + 4) << 32);
+}
+
+static int write_full(int fd, const void *data, size_t size) {
+  const unsigned char *p = (const unsigned char *)data;
+  while (size > 0) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return errno;
+    }
+    p += n;
+    size -= (size_t)n;
+  }
+  return 0;
+}
+
+static int pread_full(int fd, void *data, size_t size, uint64_t offset) {
+  unsigned char *p = (unsigned char *)data;
+  while (size > 0) {
+    ssize_t n = pread(fd, p, size, (off_t)offset);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return errno;
+    }
+    if (n == 0)
+      return EBADMSG; // Truncated
+    p += n;
+    size -= (size_t)n;
+    offset += (uint64_t)n;
+  }
+  return 0;
+}
+
+static CdarHash cdar_hash(const unsigned char *data, size_t size) {
+  CdarHash h = {xxh64(data, size, 0), xxh64(data, size, CDAR_HASH_SEED_HI)};
+  return h;
+}
+
+// ---- Chunker ----
+
+// Gear table from a fixed splitmix64 sequence, so cut points are stable
+// across builds and platforms
+static uint64_t gear[256];
+static pthread_once_t gear_once = PTHREAD_ONCE_INIT;
+
+static void gear_init(void) {
+  uint64_t x = 0x4344415247454152ULL; // "CDARGEAR"
+  for (int i = 0; i < 256; i++) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    gear[i] = z ^ (z >> 31);
+  }
+}
+
+// Length of the chunk starting at data. Callers pass at least
+// CDAR_MAX_CHUNK bytes unless the input ends sooner, so a cut never
+// depends on where reads happened to stop.
+static size_t cdar_cut(const unsigned char *data, size_t size) {
+  if (size <= CDAR_MIN_CHUNK)
+    return size;
+
+  size_t limit = size < CDAR_MAX_CHUNK ? size : CDAR_MAX_CHUNK;
+  size_t normal = limit < CDAR_AVG_CHUNK ? limit : CDAR_AVG_CHUNK;
+  uint64_t h = 0;
+  size_t i = CDAR_MIN_CHUNK;
+
+  for (; i < normal; i++) {
+    h = (h << 1) + gear[data[i]];
+    if (!(h & CDAR_MASK_STRICT))
+      return i + 1;
+  }
+  for (; i < limit; i++) {
+    h = (h << 1) + gear[data[i]];
+    if (!(h & CDAR_MASK_LOOSE))
+      return i + 1;
+  }
+  return limit;
+}
+
+// ---- Catalog ----
+
+static void catalog_free(CdarCatalog *cat) {
+  for (uint32_t i = 0; i < cat->store_count; i++)
+    free(cat->stores[i].name);
+  for (uint32_t i = 0; i < cat->entry_count; i++) {
+    free(cat->entries[i].path);
+    free(cat->entries[i].link);
+    free(cat->entries[i].chunks);
+  }
+  free(cat->stores);
+  free(cat->chunks);
+  free(cat->entries);
+  memset(cat, 0, sizeof(*cat));
+}
+
+// Returns 0 or ENOMEM; takes ownership of name
+static int catalog_add_store(CdarCatalog *cat, uint64_t id, char *name) {
+  CdarStore *grown =
+      realloc(cat->stores, (cat->store_count + 1) * sizeof(CdarStore));
+  if (!grown) {
+    free(name);
+    return ENOMEM;
+  }
+  cat->stores = grown;
+  cat->stores[cat->store_count].id = id;
+  cat->stores[cat->store_count].name = name;
+  cat->store_count++;
+  return 0;
+}
+
+static int catalog_add_chunk(CdarCatalog *cat, const CdarChunk *chunk) {
+  if (cat->chunk_count == UINT32_MAX)
+    return EOVERFLOW;
+  if (cat->chunk_count == cat->chunk_capacity) {
+    uint32_t capacity = cat->chunk_capacity ? cat->chunk_capacity * 2 : 1024;
+    CdarChunk *grown = realloc(cat->chunks, capacity * sizeof(CdarChunk));
+    if (!grown)
+      return ENOMEM;
+    cat->chunks = grown;
+    cat->chunk_capacity = capacity;
+  }
+  cat->chunks[cat->chunk_count++] = *chunk;
+  return 0;
+}
+
+static int entry_add_chunk(CdarEntry *entry, uint32_t id) {
+  if (entry->chunk_count == entry->chunk_capacity) {
+    uint32_t capacity = entry->chunk_capacity ? entry->chunk_capacity * 2 : 16;
+    uint32_t *grown = realloc(entry->chunks, capacity * sizeof(uint32_t));
+    if (!grown)
+      return ENOMEM;
+    entry->chunks = grown;
+    entry->chunk_capacity = capacity;
+  }
+  entry->chunks[entry->chunk_count++] = id;
+  return 0;
+}
+
+// Growable byte buffer; a failed append latches ok = 0
+typedef struct {
+  unsigned char *data;
+  size_t size;
+  size_t capacity;
+  int ok;
+} ByteBuf;
+
+static unsigned char *buf_reserve(ByteBuf *b, size_t n) {
+  if (!b->ok)
+    return NULL;
+  if (b->size + n > b->capacity) {
+    size_t capacity = b->capacity ? b->capacity : 4096;
+    while (capacity < b->size + n)
+      capacity *= 2;
+    unsigned char *grown = realloc(b->data, capacity);
+    if (!grown) {
+      b->ok = 0;
+      return NULL;
+    }
+    b->data = grown;
+    b->capacity = capacity;
+  }
+  unsigned char *p = b->data + b->size;
+  b->size += n;
+  return p;
+}
+
+static void buf_u8(ByteBuf *b, uint8_t v) {
+  unsigned char *p = buf_reserve(b, 1);
+  if (p)
+    *p = v;
+}
+
+static void buf_u16(ByteBuf *b, uint16_t v) {
+  unsigned char *p = buf_reserve(b, 2);
+  if (p)
+    put_le16(p, v);
+}
+
+static void buf_u32(ByteBuf *b, uint32_t v) {
+  unsigned char *p = buf_reserve(b, 4);
+  if (p)
+    put_le32(p, v);
+}
+
+static void buf_u64(ByteBuf *b, uint64_t v) {
+  unsigned char *p = buf_reserve(b, 8);
+  if (p)
+    put_le64(p, v);
+}
+
+// Strings are u16-length prefixed; longer ones would have failed PATH_MAX
+static void buf_str(ByteBuf *b, const char *s) {
+  size_t len = s ? strlen(s) : 0;
+  if (len > UINT16_MAX) {
+    b->ok = 0;
+    return;
+  }
+  buf_u16(b, (uint16_t)len);
+  unsigned char *p = buf_reserve(b, len);
+  if (p && len)
+    memcpy(p, s, len);
+}
+
+// Catalog body:
+//   u32 store count, then per store: u64 id, string name
+//   u32 chunk count, then per chunk: u32 store, u8 algo, u64 offset,
+//       u32 compressed size, u32 raw size, u64 hash lo, u64 hash hi
+//   u32 entry count, then per entry: u8 type, u32 mode, i64 mtime,
+//       u64 size, string path, string link, u32 chunk count, u32 ids
+static int cdar_encode_catalog(const CdarCatalog *cat, ByteBuf *b) {
+  buf_u32(b, cat->store_count);
+  for (uint32_t i = 0; i < cat->store_count; i++) {
+    buf_u64(b, cat->stores[i].id);
+    buf_str(b, cat->stores[i].name);
+  }
+
+  buf_u32(b, cat->chunk_count);
+  for (uint32_t i = 0; i < cat->chunk_count; i++) {
+    const CdarChunk *c = &cat->chunks[i];
+    buf_u32(b, c->store);
+    buf_u8(b, c->algo);
+    buf_u64(b, c->offset);
+    buf_u32(b, c->comp_size);
+    buf_u32(b, c->raw_size);
+    buf_u64(b, c->hash.lo);
+    buf_u64(b, c->hash.hi);
+  }
+
+  buf_u32(b, cat->entry_count);
+  for (uint32_t i = 0; i < cat->entry_count; i++) {
+    const CdarEntry *e = &cat->entries[i];
+    buf_u8(b, (uint8_t)e->type);
+    buf_u32(b, e->mode);
+    buf_u64(b, (uint64_t)e->mtime);
+    buf_u64(b, e->size);
+    buf_str(b, e->path);
+    buf_str(b, e->link);
+    buf_u32(b, e->chunk_count);
+    for (uint32_t j = 0; j < e->chunk_count; j++)
+      buf_u32(b, e->chunks[j]);
+  }
+  return b->ok ? 0 : ENOMEM;
+}
+
+// Bounds-checked reads over the raw catalog; a short read latches ok = 0
+typedef struct {
+  const unsigned char *p;
+  const unsigned char *end;
+  int ok;
+} Cursor;
+
+static const unsigned char *cur_take(Cursor *c, size_t n) {
+  if (!c->ok || (size_t)(c->end - c->p) < n) {
+    c->ok = 0;
+    return NULL;
+  }
+  const unsigned char *p = c->p;
+  c->p += n;
+  return p;
+}
+
+static uint8_t cur_u8(Cursor *c) {
+  const unsigned char *p = cur_take(c, 1);
+  return p ? *p : 0;
+}
+
+static uint16_t cur_u16(Cursor *c) {
+  const unsigned char *p = cur_take(c, 2);
+  return p ? get_le16(p) : 0;
+}
+
+static uint32_t cur_u32(Cursor *c) {
+  const unsigned char *p = cur_take(c, 4);
+  return p ? get_le32(p) : 0;
+}
+
+static uint64_t cur_u64(Cursor *c) {
+  const unsigned char *p = cur_take(c, 8);
+  return p ? get_le64(p) : 0;
+}
+
+// A count whose records cannot fit in what is left is corrupt
+static uint32_t cur_count(Cursor *c, size_t min_record) {
+  uint32_t n = cur_u32(c);
+  if (c->ok && (uint64_t)n * min_record > (uint64_t)(c->end - c->p))
+    c->ok = 0;
+  return c->ok ? n : 0;
+}
+
+// NULL for an empty string when allow_empty; strings never hold NULs
+static char *cur_str(Cursor *c, int allow_empty) {
+  uint16_t len = cur_u16(c);
+  const unsigned char *p = cur_take(c, len);
+  if (!p || (len == 0 && !allow_empty) || memchr(p, 0, len)) {
+    c->ok = 0;
+    return NULL;
+  }
+  if (len == 0)
+    return NULL;
+  char *s = malloc((size_t)len + 1);
+  if (!s) {
+    c->ok = 0;
+    return NULL;
+  }
+  memcpy(s, p, len);
+  s[len] = '\0';
+  return s;
+}
+
+// Parse and validate a raw catalog; sets an exception on failure
+static int cdar_decode_catalog(const unsigned char *data, size_t size,
+                               CdarCatalog *cat) {
+  Cursor c = {data, data + size, 1};
+  memset(cat, 0, sizeof(*cat));
+
+  uint32_t stores = cur_count(&c, CDAR_STORE_MIN_RECORD);
+  if (c.ok && stores == 0)
+    c.ok = 0;
+  for (uint32_t i = 0; i < stores && c.ok; i++) {
+    uint64_t id = cur_u64(&c);
+    char *name = cur_str(&c, i == 0);
+    if (!c.ok)
+      break;
+    if (!name)
+      name = strdup("");
+    if (!name || catalog_add_store(cat, id, name) != 0)
+      c.ok = 0;
+  }
+
+  uint32_t chunks = cur_count(&c, CDAR_CHUNK_RECORD);
+  for (uint32_t i = 0; i < chunks && c.ok; i++) {
+    CdarChunk chunk;
+    chunk.store = cur_u32(&c);
+    chunk.algo = cur_u8(&c);
+    chunk.offset = cur_u64(&c);
+    chunk.comp_size = cur_u32(&c);
+    chunk.raw_size = cur_u32(&c);
+    chunk.hash.lo = cur_u64(&c);
+    chunk.hash.hi = cur_u64(&c);
+    if (!c.ok || chunk.store >= cat->store_count || chunk.raw_size == 0 ||
+        chunk.raw_size > CDAR_MAX_CHUNK ||
+        chunk.comp_size > chunk.raw_size ||
+        (chunk.algo == ALGO_NONE && chunk.comp_size != chunk.raw_size) ||
+        catalog_add_chunk(cat, &chunk) != 0)
+      c.ok = 0;
+  }
+
+  uint32_t entries = cur_count(&c, CDAR_ENTRY_MIN_RECORD);
+  if (c.ok && entries > 0) {
+    cat->entries = calloc(entries, sizeof(CdarEntry));
+    if (!cat->entries)
+      c.ok = 0;
+    cat->entry_capacity = entries;
+  }
+  for (uint32_t i = 0; i < entries && c.ok; i++) {
+    CdarEntry *e = &cat->entries[i];
+    cat->entry_count++; // Owns whatever gets parsed, even on failure
+    uint8_t type = cur_u8(&c);
+    e->mode = cur_u32(&c);
+    e->mtime = (int64_t)cur_u64(&c);
+    e->size = cur_u64(&c);
+    e->path = cur_str(&c, 0);
+    e->link = cur_str(&c, 1);
+    uint32_t count = cur_count(&c, 4);
+    if (!c.ok || type > ENTRY_SPECIAL) {
+      c.ok = 0;
+      break;
+    }
+    e->type = (EntryType)type;
+
+    uint64_t total = 0;
+    for (uint32_t j = 0; j < count && c.ok; j++) {
+      uint32_t id = cur_u32(&c);
+      if (id >= cat->chunk_count || entry_add_chunk(e, id) != 0) {
+        c.ok = 0;
+        break;
+      }
+      total += cat->chunks[id].raw_size;
+    }
+    if (c.ok && total != e->size)
+      c.ok = 0;
+  }
+
+  if (!c.ok || c.p != c.end) {
+    catalog_free(cat);
+    PyErr_SetString(comp_HeaderError, "Corrupt cdar catalog");
+    return -1;
+  }
+  return 0;
+}
+
+static AlgoID algo_from_codec(Format codec) {
+  switch (codec) {
+  case FORMAT_GZIP:
+    return ALGO_ZLIB;
+  case FORMAT_BZIP2:
+    return ALGO_BZIP2;
+  case FORMAT_XZ:
+    return ALGO_LZMA;
+  case FORMAT_LZ4:
+    return ALGO_LZ4;
+  case FORMAT_UNKNOWN: // Plain "cdar"
+  case FORMAT_ZSTD:
+    return ALGO_ZSTD;
+  default:
+    return ALGO_NONE;
+  }
+}
+
+// ---- Archive Files ----
+
+// Open path and load its catalog; *fd_out stays open for chunk reads
+static int cdar_open_file(const char *path, int *fd_out, uint64_t *id_out,
+                          CdarCatalog *cat) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+    return -1;
+  }
+
+  unsigned char header[CDAR_HEADER_SIZE];
+  unsigned char trailer[CDAR_TRAILER_SIZE];
+  struct stat st;
+  int error = fstat(fd, &st) != 0 ? errno : 0;
+  if (!error && (uint64_t)st.st_size < CDAR_HEADER_SIZE + CDAR_TRAILER_SIZE) {
+    close(fd);
+    PyErr_SetString(comp_HeaderError, "File too small for a cdar archive");
+    return -1;
+  }
+  if (!error)
+    error = pread_full(fd, header, sizeof(header), 0);
+  if (!error)
+    error = pread_full(fd, trailer, sizeof(trailer),
+                       (uint64_t)st.st_size - CDAR_TRAILER_SIZE);
+  if (error) {
+    close(fd);
+    errno = error;
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+    return -1;
+  }
+
+  if (memcmp(header, CDAR_MAGIC, 4) != 0 || header[4] != CDAR_VERSION ||
+      memcmp(trailer + 28, CDAR_TRAILER_MAGIC, 4) != 0) {
+    close(fd);
+    PyErr_SetString(comp_HeaderError, "Invalid cdar header or trailer");
+    return -1;
+  }
+
+  uint64_t offset = get_le64(trailer);
+  uint64_t comp_size = get_le64(trailer + 8);
+  uint64_t raw_size = get_le64(trailer + 16);
+  uint32_t crc = get_le32(trailer + 24);
+  if (offset < CDAR_HEADER_SIZE ||
+      offset + comp_size + CDAR_TRAILER_SIZE != (uint64_t)st.st_size ||
+      comp_size == 0 || raw_size == 0 || raw_size > MAX_DECOMPRESSED_SIZE) {
+    close(fd);
+    PyErr_SetString(comp_HeaderError, "Inconsistent cdar trailer");
+    return -1;
+  }
+
+  const CBackend *backend = find_backend_by_id(header[5]);
+  if (!backend) {
+    close(fd);
+    PyErr_Format(comp_BackendError, "Backend %u for cdar catalog unavailable",
+                 header[5]);
+    return -1;
+  }
+
+  unsigned char *comp = safe_malloc((size_t)comp_size);
+  unsigned char *raw = comp ? safe_malloc((size_t)raw_size) : NULL;
+  if (!raw) {
+    free(comp);
+    close(fd);
+    return -1;
+  }
+
+  size_t capacity = (size_t)raw_size;
+  size_t produced = 0;
+  int status;
+  Py_BEGIN_ALLOW_THREADS error = pread_full(fd, comp, (size_t)comp_size, offset);
+  status = error ? -1
+                 : codec_decompress_buffer(backend, NULL, NULL, comp,
+                                           (size_t)comp_size, raw, &capacity,
+                                           &produced);
+  Py_END_ALLOW_THREADS
+  free(comp);
+
+  int ret = -1;
+  if (error) {
+    errno = error;
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+  } else if (status != 0 || produced != raw_size) {
+    set_backend_error(backend, "decompression", "cdar catalog");
+  } else if (crc32_fast(0, raw, produced) != crc) {
+    PyErr_SetString(comp_HeaderError, "cdar catalog checksum mismatch");
+  } else {
+    ret = cdar_decode_catalog(raw, produced, cat);
+  }
+  free(raw);
+
+  if (ret != 0) {
+    close(fd);
+    return -1;
+  }
+  *fd_out = fd;
+  *id_out = get_le64(header + 8);
+  return 0;
+}
+
+// Directory holding path, resolved; "." when path has no directory part
+static char *cdar_dir_of(const char *path) {
+  char dir[PATH_MAX];
+  const char *slash = strrchr(path, '/');
+  if (!slash) {
+    snprintf(dir, sizeof(dir), ".");
+  } else if (slash == path) {
+    snprintf(dir, sizeof(dir), "/");
+  } else {
+    snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+  }
+
+  char resolved[PATH_MAX];
+  if (!realpath(dir, resolved)) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, dir);
+    return NULL;
+  }
+  char *copy = strdup(resolved);
+  if (!copy)
+    PyErr_NoMemory();
+  return copy;
+}
+
+// Absolute path of a store, given the directory of the referring archive
+static void cdar_store_path(const char *name, const char *dir, char *out,
+                            size_t outlen) {
+  if (name[0] == '/')
+    snprintf(out, outlen, "%s", name);
+  else
+    snprintf(out, outlen, "%s/%s", dir, name);
+}
+
+// Name to record for the store at abs_path, from the directory dir: just
+// the file name when it sits in dir, so sets of archives can move together
+static char *cdar_store_name(const char *abs_path, const char *dir) {
+  size_t len = strlen(dir);
+  const char *name = abs_path;
+  if (strncmp(abs_path, dir, len) == 0 && abs_path[len] == '/' &&
+      !strchr(abs_path + len + 1, '/'))
+    name = abs_path + len + 1;
+  return strdup(name);
+}
+
+// ---- CDAR Writer ----
+
+// Dedup table: open addressing over chunk id + 1 (0 = empty)
+typedef struct {
+  uint32_t *slots;
+  size_t mask;
+  size_t used;
+} ChunkTable;
+
+typedef struct {
+  int fd;
+  const char *output_path;
+  const CBackend *backend;
+  int level;
+  uint64_t id;
+  uint64_t offset; // Next chunk's position in the file
+  CdarCatalog cat;
+  ChunkTable table;
+  unsigned char *window; // Chunking window, CDAR_READ_SIZE + CDAR_MAX_CHUNK
+  unsigned char *comp;
+  size_t comp_capacity;
+} CdarWriter;
+
+static int table_grow(ChunkTable *t, const CdarCatalog *cat) {
+  size_t capacity = t->slots ? (t->mask + 1) * 2 : 4096;
+  uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+  if (!slots)
+    return ENOMEM;
+  size_t mask = capacity - 1;
+  for (size_t i = 0; t->slots && i <= t->mask; i++) {
+    uint32_t id = t->slots[i];
+    if (!id)
+      continue;
+    size_t j = (size_t)cat->chunks[id - 1].hash.lo & mask;
+    while (slots[j])
+      j = (j + 1) & mask;
+    slots[j] = id;
+  }
+  free(t->slots);
+  t->slots = slots;
+  t->mask = mask;
+  return 0;
+}
+
+// Chunk id of an identical chunk already stored, or -1
+static int64_t table_find(const ChunkTable *t, const CdarCatalog *cat,
+                          CdarHash hash, uint32_t size) {
+  if (!t->slots)
+    return -1;
+  size_t i = (size_t)hash.lo & t->mask;
+  while (t->slots[i]) {
+    const CdarChunk *c = &cat->chunks[t->slots[i] - 1];
+    if (c->hash.lo == hash.lo && c->hash.hi == hash.hi && c->raw_size == size)
+      return (int64_t)t->slots[i] - 1;
+    i = (i + 1) & t->mask;
+  }
+  return -1;
+}
+
+static int table_insert(ChunkTable *t, const CdarCatalog *cat, uint32_t id) {
+  if (!t->slots || (t->used + 1) * 2 > t->mask + 1) {
+    int error = table_grow(t, cat);
+    if (error)
+      return error;
+  }
+  size_t i = (size_t)cat->chunks[id].hash.lo & t->mask;
+  while (t->slots[i])
+    i = (i + 1) & t->mask;
+  t->slots[i] = id + 1;
+  t->used++;
+  return 0;
+}
+
+// Store one chunk unless an identical one exists; runs without the GIL
+static int cdar_put_chunk(CdarWriter *w, const unsigned char *data,
+                          size_t size, uint32_t *id_out) {
+  CdarHash hash = cdar_hash(data, size);
+  int64_t found = table_find(&w->table, &w->cat, hash, (uint32_t)size);
+  if (found >= 0) {
+    *id_out = (uint32_t)found;
+    return 0;
+  }
+
+  size_t capacity = w->comp_capacity;
+  size_t comp_size = 0;
+  if (codec_compress_buffer(w->backend, NULL, NULL, data, size, w->comp,
+                            &capacity, w->level, &comp_size) != 0)
+    return EIO;
+
+  CdarChunk chunk = {0, (uint8_t)w->backend->id, w->offset,
+                     (uint32_t)comp_size, (uint32_t)size, hash};
+  const unsigned char *payload = w->comp;
+  if (comp_size >= size) { // Incompressible: keep it raw
+    chunk.algo = ALGO_NONE;
+    chunk.comp_size = (uint32_t)size;
+    payload = data;
+  }
+
+  int error = write_full(w->fd, payload, chunk.comp_size);
+  if (!error)
+    error = catalog_add_chunk(&w->cat, &chunk);
+  if (!error)
+    error = table_insert(&w->table, &w->cat, w->cat.chunk_count - 1);
+  if (error)
+    return error;
+
+  w->offset += chunk.comp_size;
+  *id_out = w->cat.chunk_count - 1;
+  return 0;
+}
+
+// Cut a file into chunks and list them on entry; runs without the GIL
+static int cdar_chunk_file(CdarWriter *w, CdarEntry *entry, FILE *data) {
+  const size_t window = CDAR_READ_SIZE + CDAR_MAX_CHUNK;
+  size_t have = 0;
+  int eof = 0;
+
+  while (!eof || have > 0) {
+    if (io_cancelled() != IO_CANCEL_NONE)
+      return ECANCELED;
+    if (!eof) {
+      have += io_fread(w->window + have, window - have, data);
+      if (have < window) {
+        if (ferror(data))
+          return EIO;
+        eof = 1;
+      }
+    }
+
+    size_t pos = 0;
+    while (have - pos >= CDAR_MAX_CHUNK || (eof && pos < have)) {
+      size_t n = cdar_cut(w->window + pos, have - pos);
+      uint32_t id;
+      int error = cdar_put_chunk(w, w->window + pos, n, &id);
+      if (!error)
+        error = entry_add_chunk(entry, id);
+      if (error)
+        return error;
+      entry->size += n;
+      pos += n;
+    }
+    memmove(w->window, w->window + pos, have - pos);
+    have -= pos;
+  }
+  return 0;
+}
+
+static uint64_t cdar_new_id(const void *salt) {
+  uint64_t id = 0;
+  int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+  if (fd >= 0) {
+    if (read(fd, &id, sizeof(id)) != (ssize_t)sizeof(id))
+      id = 0;
+    close(fd);
+  }
+  if (id == 0) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t seed[4] = {(uint64_t)ts.tv_sec, (uint64_t)ts.tv_nsec,
+                        (uint64_t)getpid(), (uint64_t)(uintptr_t)salt};
+    id = xxh64(seed, sizeof(seed), 0);
+  }
+  return id;
+}
+
+static int same_file(const char *a, const struct stat *b) {
+  struct stat st;
+  return stat(a, &st) == 0 && st.st_dev == b->st_dev && st.st_ino == b->st_ino;
+}
+
+// Take over a base archive's chunks, so matching data becomes a reference.
+// Its stores are re-rooted at the new archive's directory and flattened, so
+// every chunk points straight at the file holding it.
+static int cdar_load_base(CdarWriter *w, const char *base_path,
+                          const char *output_path) {
+  int fd;
+  uint64_t base_id;
+  CdarCatalog base;
+  if (cdar_open_file(base_path, &fd, &base_id, &base) != 0)
+    return -1;
+  close(fd);
+
+  char *base_dir = cdar_dir_of(base_path);
+  char *out_dir = base_dir ? cdar_dir_of(output_path) : NULL;
+  uint32_t *store_map =
+      out_dir ? safe_malloc(base.store_count * sizeof(uint32_t)) : NULL;
+  int ret = store_map ? 0 : -1;
+
+  struct stat out_st;
+  int out_exists = stat(output_path, &out_st) == 0;
+
+  for (uint32_t i = 0; i < base.store_count && ret == 0; i++) {
+    char path[PATH_MAX];
+    if (i == 0) {
+      char *slash = strrchr(base_path, '/');
+      cdar_store_path(slash ? slash + 1 : base_path, base_dir, path,
+                      sizeof(path));
+    } else {
+      cdar_store_path(base.stores[i].name, base_dir, path, sizeof(path));
+    }
+
+    if (out_exists && same_file(path, &out_st)) {
+      PyErr_Format(PyExc_ValueError,
+                   "Cannot overwrite %s: the new archive refers to it",
+                   output_path);
+      ret = -1;
+      break;
+    }
+
+    uint64_t id = i == 0 ? base_id : base.stores[i].id;
+    char *name = cdar_store_name(path, out_dir);
+    store_map[i] = w->cat.store_count;
+    if (!name || catalog_add_store(&w->cat, id, name) != 0) {
+      PyErr_NoMemory();
+      ret = -1;
+    }
+  }
+
+  for (uint32_t i = 0; i < base.chunk_count && ret == 0; i++) {
+    CdarChunk chunk = base.chunks[i];
+    chunk.store = store_map[chunk.store];
+    if (catalog_add_chunk(&w->cat, &chunk) != 0 ||
+        table_insert(&w->table, &w->cat, w->cat.chunk_count - 1) != 0) {
+      PyErr_NoMemory();
+      ret = -1;
+    }
+  }
+
+  free(store_map);
+  free(out_dir);
+  free(base_dir);
+  catalog_free(&base);
+  return ret;
+}
+
+static void cdar_writer_free(CdarWriter *w) {
+  if (w->fd >= 0)
+    close(w->fd);
+  catalog_free(&w->cat);
+  free(w->table.slots);
+  free(w->window);
+  free(w->comp);
+  free(w);
+}
+
+static void *cdar_create_writer(const char *output_path,
+                                const CompressionPipeline *pipeline) {
+  AlgoID algo = algo_from_codec(pipeline->codec);
+  const CBackend *backend = find_backend_by_id((uint8_t)algo);
+  if (!backend) {
+    PyErr_Format(comp_BackendError, "No backend available for cdar.%s",
+                 format_name_string(pipeline->codec));
+    return NULL;
+  }
+
+  pthread_once(&gear_once, gear_init);
+
+  CdarWriter *w = safe_malloc(sizeof(CdarWriter));
+  if (!w)
+    return NULL;
+  memset(w, 0, sizeof(*w));
+  w->fd = -1;
+  w->output_path = output_path;
+  w->backend = backend;
+  w->level = pipeline->compression_level;
+  w->id = cdar_new_id(w);
+  w->offset = CDAR_HEADER_SIZE;
+  w->comp_capacity = backend->max_compressed_size(CDAR_MAX_CHUNK);
+  w->window = safe_malloc(CDAR_READ_SIZE + CDAR_MAX_CHUNK);
+  w->comp = w->window ? safe_malloc(w->comp_capacity) : NULL;
+  char *self = w->comp ? strdup("") : NULL;
+  if (!self || catalog_add_store(&w->cat, w->id, self) != 0) {
+    if (!PyErr_Occurred())
+      PyErr_NoMemory();
+    cdar_writer_free(w);
+    return NULL;
+  }
+
+  if (pipeline->base && cdar_load_base(w, pipeline->base, output_path) != 0) {
+    cdar_writer_free(w);
+    return NULL;
+  }
+
+  w->fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (w->fd < 0) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, output_path);
+    cdar_writer_free(w);
+    return NULL;
+  }
+
+  unsigned char header[CDAR_HEADER_SIZE] = {'C', 'D', 'A', 'R', CDAR_VERSION,
+                                            (unsigned char)backend->id};
+  put_le64(header + 8, w->id);
+  int error = write_full(w->fd, header, sizeof(header));
+  if (error) {
+    errno = error;
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, output_path);
+    cdar_writer_free(w);
+    return NULL;
+  }
+  return w;
+}
+
+static int cdar_add_entry(void *writer_ptr, const ArchiveEntry *entry,
+                          FILE *data) {
+  CdarWriter *w = (CdarWriter *)writer_ptr;
+
+  if (w->cat.entry_count == w->cat.entry_capacity) {
+    uint32_t capacity = w->cat.entry_capacity ? w->cat.entry_capacity * 2 : 64;
+    CdarEntry *grown = realloc(w->cat.entries, capacity * sizeof(CdarEntry));
+    if (!grown) {
+      PyErr_NoMemory();
+      return -1;
+    }
+    w->cat.entries = grown;
+    w->cat.entry_capacity = capacity;
+  }
+
+  CdarEntry *e = &w->cat.entries[w->cat.entry_count];
+  memset(e, 0, sizeof(*e));
+  e->type = entry->type;
+  e->mode = entry->mode;
+  e->mtime = (int64_t)entry->mtime;
+  e->path = strdup(entry->path);
+  if (entry->type == ENTRY_SYMLINK && entry->symlink_target)
+    e->link = strdup(entry->symlink_target);
+  if (!e->path ||
+      (entry->type == ENTRY_SYMLINK && entry->symlink_target && !e->link)) {
+    free(e->path);
+    free(e->link);
+    PyErr_NoMemory();
+    return -1;
+  }
+
+  if (entry->type == ENTRY_FILE && data) {
+    int error;
+    Py_BEGIN_ALLOW_THREADS error = cdar_chunk_file(w, e, data);
+    Py_END_ALLOW_THREADS
+
+        if (error) {
+      free(e->path);
+      free(e->link);
+      free(e->chunks);
+      errno = error;
+      PyErr_SetFromErrnoWithFilename(PyExc_OSError, entry->path);
+      return -1;
+    }
+  }
+
+  w->cat.entry_count++;
+  return 0;
+}
+
+// Drop chunks no entry uses, and stores left without chunks, so each
+// archive only depends on what it needs and the next one's base is just
+// the latest snapshot. Store 0 stays first.
+static int cdar_prune(CdarCatalog *cat) {
+  uint32_t *chunk_map = malloc((cat->chunk_count + 1) * sizeof(uint32_t));
+  uint32_t *store_map = malloc(cat->store_count * sizeof(uint32_t));
+  if (!chunk_map || !store_map) {
+    free(chunk_map);
+    free(store_map);
+    return ENOMEM;
+  }
+
+  for (uint32_t i = 0; i < cat->chunk_count; i++)
+    chunk_map[i] = UINT32_MAX;
+  for (uint32_t i = 0; i < cat->entry_count; i++)
+    for (uint32_t j = 0; j < cat->entries[i].chunk_count; j++)
+      chunk_map[cat->entries[i].chunks[j]] = 0;
+
+  for (uint32_t i = 0; i < cat->store_count; i++)
+    store_map[i] = i == 0 ? 0 : UINT32_MAX;
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < cat->chunk_count; i++) {
+    if (chunk_map[i] == UINT32_MAX)
+      continue;
+    chunk_map[i] = kept;
+    cat->chunks[kept++] = cat->chunks[i];
+    store_map[cat->chunks[i].store] = 0;
+  }
+  cat->chunk_count = kept;
+
+  kept = 0;
+  for (uint32_t i = 0; i < cat->store_count; i++) {
+    if (store_map[i] == UINT32_MAX) {
+      free(cat->stores[i].name);
+      continue;
+    }
+    store_map[i] = kept;
+    cat->stores[kept++] = cat->stores[i];
+  }
+  cat->store_count = kept;
+
+  for (uint32_t i = 0; i < cat->chunk_count; i++)
+    cat->chunks[i].store = store_map[cat->chunks[i].store];
+  for (uint32_t i = 0; i < cat->entry_count; i++)
+    for (uint32_t j = 0; j < cat->entries[i].chunk_count; j++)
+      cat->entries[i].chunks[j] = chunk_map[cat->entries[i].chunks[j]];
+
+  free(chunk_map);
+  free(store_map);
+  return 0;
+}
+
+// Write the catalog and trailer; runs without the GIL
+static int cdar_finish(CdarWriter *w) {
+  ByteBuf raw = {NULL, 0, 0, 1};
+  int error = cdar_prune(&w->cat);
+  if (!error)
+    error = cdar_encode_catalog(&w->cat, &raw);
+
+  unsigned char *comp = NULL;
+  size_t comp_size = 0;
+  if (!error) {
+    size_t capacity = w->backend->max_compressed_size(raw.size);
+    comp = malloc(capacity);
+    if (!comp)
+      error = ENOMEM;
+    else if (codec_compress_buffer(w->backend, NULL, NULL, raw.data, raw.size,
+                                   comp, &capacity, w->level,
+                                   &comp_size) != 0)
+      error = EIO;
+  }
+
+  if (!error)
+    error = write_full(w->fd, comp, comp_size);
+  if (!error) {
+    unsigned char trailer[CDAR_TRAILER_SIZE];
+    put_le64(trailer, w->offset);
+    put_le64(trailer + 8, comp_size);
+    put_le64(trailer + 16, raw.size);
+    put_le32(trailer + 24, crc32_fast(0, raw.data, raw.size));
+    memcpy(trailer + 28, CDAR_TRAILER_MAGIC, 4);
+    error = write_full(w->fd, trailer, sizeof(trailer));
+  }
+
+  free(comp);
+  free(raw.data);
+  return error;
+}
+
+static int cdar_close_writer(void *writer_ptr) {
+  CdarWriter *w = (CdarWriter *)writer_ptr;
+  int error;
+
+  Py_BEGIN_ALLOW_THREADS error = cdar_finish(w);
+  if (close(w->fd) != 0 && !error)
+    error = errno;
+  Py_END_ALLOW_THREADS
+  w->fd = -1;
+
+  if (error) {
+    errno = error;
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, w->output_path);
+  }
+  cdar_writer_free(w);
+  return error ? -1 : 0;
+}
+
+// ---- CDAR Reader ----
+
+typedef struct {
+  CdarCatalog cat;
+  char **store_paths; // Resolved at open; opened on first use
+  int *store_fds;     // -1 until opened
+  pthread_mutex_t lock;
+  uint32_t max_comp; // Largest chunk, compressed and raw
+  uint32_t max_raw;
+  uint32_t next;    // Entry get_next_entry returns next
+  int64_t current; // Entry last returned, -1 before the first
+
+  // Where read_entry_data is: the entry, its next chunk, and what is left of
+  // the last one decoded into raw. Buffers come on first use.
+  int64_t read_entry;
+  uint32_t read_chunk;
+  uint32_t read_pos, read_len;
+  unsigned char *read_comp, *read_raw;
+} CdarReader;
+
+// fd for a store, opening and checking it on first use; returns 0 or errno.
+// Safe on worker threads.
+static int cdar_store_fd(CdarReader *r, uint32_t store, int *fd_out) {
+  int error = 0;
+  pthread_mutex_lock(&r->lock);
+  if (r->store_fds[store] < 0) {
+    unsigned char header[CDAR_HEADER_SIZE];
+    int fd = open(r->store_paths[store], O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      error = errno;
+    } else if ((error = pread_full(fd, header, sizeof(header), 0)) == 0 &&
+               (memcmp(header, CDAR_MAGIC, 4) != 0 ||
+                get_le64(header + 8) != r->cat.stores[store].id)) {
+      error = EBADMSG; // Replaced by a different archive
+    }
+    if (error && fd >= 0)
+      close(fd);
+    else if (!error)
+      r->store_fds[store] = fd;
+  }
+  *fd_out = r->store_fds[store];
+  pthread_mutex_unlock(&r->lock);
+  return error;
+}
+
+// Decode one chunk into raw (max_raw bytes) and check it; 0 or errno
+static int cdar_read_chunk(CdarReader *r, uint32_t id, unsigned char *comp,
+                           unsigned char *raw) {
+  const CdarChunk *c = &r->cat.chunks[id];
+  int fd;
+  int error = cdar_store_fd(r, c->store, &fd);
+  if (error)
+    return error;
+
+  if (c->algo == ALGO_NONE) {
+    error = pread_full(fd, raw, c->raw_size, c->offset);
+  } else {
+    const CBackend *backend = find_backend_by_id(c->algo);
+    if (!backend)
+      return ENOTSUP;
+    error = pread_full(fd, comp, c->comp_size, c->offset);
+    size_t capacity = r->max_raw;
+    size_t produced = 0;
+    if (!error && (codec_decompress_buffer(backend, NULL, NULL, comp,
+                                           c->comp_size, raw, &capacity,
+                                           &produced) != 0 ||
+                   produced != c->raw_size))
+      error = EBADMSG;
+  }
+  if (error)
+    return error;
+
+  CdarHash hash = cdar_hash(raw, c->raw_size);
+  return hash.lo == c->hash.lo && hash.hi == c->hash.hi ? 0 : EBADMSG;
+}
+
+typedef int (*ChunkSink)(void *target, const unsigned char *data,
+                         size_t size);
+
+// Both seek over zero runs, leaving holes where the entry had them
+static int sink_fd(void *target, const unsigned char *data, size_t size) {
+  return io_write_sparse_fd(*(int *)target, data, size);
+}
+
+static int sink_file(void *target, const unsigned char *data, size_t size) {
+  return io_write_sparse((FILE *)target, data, size) == 0 ? 0 : EIO;
+}
+
+// Decode an entry's chunks in order into sink; runs without the GIL.
+// *store_out names the store at fault when a chunk cannot be read.
+static int cdar_write_entry(CdarReader *r, uint32_t index, ChunkSink sink,
+                            void *target, uint32_t *store_out) {
+  const CdarEntry *e = &r->cat.entries[index];
+  if (e->chunk_count == 0)
+    return 0;
+
+  unsigned char *comp = malloc(r->max_comp ? r->max_comp : 1);
+  unsigned char *raw = malloc(r->max_raw);
+  int error = comp && raw ? 0 : ENOMEM;
+
+  for (uint32_t i = 0; i < e->chunk_count && !error; i++) {
+    uint32_t id = e->chunks[i];
+    error = cdar_read_chunk(r, id, comp, raw);
+    if (error)
+      *store_out = r->cat.chunks[id].store;
+    else
+      error = sink(target, raw, r->cat.chunks[id].raw_size);
+  }
+
+  free(comp);
+  free(raw);
+  return error;
+}
+
+static int cdar_close_reader(void *reader_ptr) {
+  CdarReader *r = (CdarReader *)reader_ptr;
+  for (uint32_t i = 0; i < r->cat.store_count; i++) {
+    if (r->store_fds && r->store_fds[i] >= 0)
+      close(r->store_fds[i]);
+    if (r->store_paths)
+      free(r->store_paths[i]);
+  }
+  free(r->store_fds);
+  free(r->store_paths);
+  free(r->read_comp);
+  free(r->read_raw);
+  catalog_free(&r->cat);
+  pthread_mutex_destroy(&r->lock);
+  free(r);
+  return 0;
+}
+
+static void *cdar_create_reader(const char *input_path) {
+  CdarReader *r = safe_malloc(sizeof(CdarReader));
+  if (!r)
+    return NULL;
+  memset(r, 0, sizeof(*r));
+  pthread_mutex_init(&r->lock, NULL);
+  r->current = -1;
+  r->read_entry = -1;
+
+  int fd;
+  uint64_t id;
+  if (cdar_open_file(input_path, &fd, &id, &r->cat) != 0) {
+    cdar_close_reader(r);
+    return NULL;
+  }
+
+  uint32_t n = r->cat.store_count;
+  r->store_fds = safe_malloc(n * sizeof(int));
+  if (!r->store_fds) {
+    close(fd);
+    cdar_close_reader(r);
+    return NULL;
+  }
+  r->store_fds[0] = fd;
+  for (uint32_t i = 1; i < n; i++)
+    r->store_fds[i] = -1;
+
+  char *dir = cdar_dir_of(input_path);
+  r->store_paths = dir ? calloc(n, sizeof(char *)) : NULL;
+  if (!r->store_paths) {
+    if (dir)
+      PyErr_NoMemory();
+    free(dir);
+    cdar_close_reader(r);
+    return NULL;
+  }
+
+  for (uint32_t i = 0; i < n; i++) {
+    char path[PATH_MAX];
+    if (i == 0)
+      snprintf(path, sizeof(path), "%s", input_path);
+    else
+      cdar_store_path(r->cat.stores[i].name, dir, path, sizeof(path));
+    r->store_paths[i] = strdup(path);
+    if (!r->store_paths[i]) {
+      free(dir);
+      cdar_close_reader(r);
+      PyErr_NoMemory();
+      return NULL;
+    }
+  }
+  free(dir);
+
+  for (uint32_t i = 0; i < r->cat.chunk_count; i++) {
+    const CdarChunk *c = &r->cat.chunks[i];
+    if (c->comp_size > r->max_comp)
+      r->max_comp = c->comp_size;
+    if (c->raw_size > r->max_raw)
+      r->max_raw = c->raw_size;
+  }
+  return r;
+}
+
+static int cdar_get_entry_count(void *reader_ptr) {
+  CdarReader *r = (CdarReader *)reader_ptr;
+  return r->cat.entry_count > INT_MAX ? -1 : (int)r->cat.entry_count;
+}
+
+static int cdar_get_next_entry(void *reader_ptr, ArchiveEntry *entry) {
+  CdarReader *r = (CdarReader *)reader_ptr;
+
+  memset(entry, 0, sizeof(*entry));
+  if (r->next >= r->cat.entry_count)
+    return 0;
+
+  const CdarEntry *e = &r->cat.entries[r->next];
+  entry->path = strdup(e->path);
+  if (e->link)
+    entry->symlink_target = strdup(e->link);
+  if (!entry->path || (e->link && !entry->symlink_target)) {
+    free(entry->path);
+    entry->path = NULL;
+    PyErr_NoMemory();
+    return -1;
+  }
+  entry->type = e->type;
+  entry->size = e->size;
+  entry->mtime = (time_t)e->mtime;
+  entry->mode = e->mode;
+
+  r->current = r->next++;
+  r->read_entry = -1; // read_entry_data starts it over
+  return 1;
+}
+
+static int cdar_extract_entry_data(void *reader_ptr, FILE *output) {
+  CdarReader *r = (CdarReader *)reader_ptr;
+  if (r->current < 0) {
+    PyErr_SetString(PyExc_RuntimeError, "No current entry to extract");
+    return -1;
+  }
+
+  uint32_t store = UINT32_MAX;
+  int error;
+  Py_BEGIN_ALLOW_THREADS error = cdar_write_entry(r, (uint32_t)r->current,
+                                                  sink_file, output, &store);
+  Py_END_ALLOW_THREADS
+
+      if (error && store == UINT32_MAX) {
+    PyErr_SetString(PyExc_IOError, "Error writing output file");
+    return -1;
+  }
+  if (error) {
+    errno = error;
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, r->store_paths[store]);
+    return -1;
+  }
+  return 0;
+}
+
+static int cdar_read_entry_data(void *reader_ptr, void *buf, size_t size,
+                                size_t *got) {
+  CdarReader *r = (CdarReader *)reader_ptr;
+  *got = 0;
+  if (r->current < 0)
+    return EINVAL;
+  if (r->read_entry != r->current) {
+    r->read_entry = r->current;
+    r->read_chunk = 0;
+    r->read_pos = r->read_len = 0;
+  }
+
+  const CdarEntry *e = &r->cat.entries[r->read_entry];
+  if (r->read_pos == r->read_len) {
+    if (r->read_chunk >= e->chunk_count)
+      return 0;
+    if (!r->read_comp)
+      r->read_comp = malloc(r->max_comp ? r->max_comp : 1);
+    if (!r->read_raw)
+      r->read_raw = malloc(r->max_raw ? r->max_raw : 1);
+    if (!r->read_comp || !r->read_raw)
+      return ENOMEM;
+    uint32_t id = e->chunks[r->read_chunk];
+    int error = cdar_read_chunk(r, id, r->read_comp, r->read_raw);
+    if (error)
+      return error;
+    r->read_chunk++;
+    r->read_pos = 0;
+    r->read_len = r->cat.chunks[id].raw_size;
+  }
+
+  size_t n = r->read_len - r->read_pos;
+  if (n > size)
+    n = size;
+  memcpy(buf, r->read_raw + r->read_pos, n);
+  r->read_pos += (uint32_t)n;
+  *got = n;
+  return 0;
+}
+
+static int cdar_skip_entry(void *reader_ptr) {
+  (void)reader_ptr; // Entries are addressed through the catalog
+  return 0;
+}
+
+static int cdar_reset_reader(void *reader_ptr) {
+  CdarReader *r = (CdarReader *)reader_ptr;
+  r->next = 0;
+  r->current = -1;
+  return 0;
+}
+
+static int64_t cdar_locate_entry(void *reader_ptr, const char *path) {
+  CdarReader *r = (CdarReader *)reader_ptr;
+  for (uint32_t i = 0; i < r->cat.entry_count; i++) {
+    if (strcmp(r->cat.entries[i].path, path) == 0) {
+      r->next = i;
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Shards share the reader: chunk reads are positioned, and stores open
+// under the reader's lock
+static void *cdar_open_shard(void *reader_ptr) { return reader_ptr; }
+
+static int cdar_extract_index(void *shard, int64_t index, int fd) {
+  CdarReader *r = (CdarReader *)shard;
+  uint32_t store;
+  if (index < 0 || (uint64_t)index >= r->cat.entry_count)
+    return EINVAL;
+  return cdar_write_entry(r, (uint32_t)index, sink_fd, &fd, &store);
+}
+
+static void cdar_close_shard(void *shard) { (void)shard; }
+
+// ---- Capability Functions ----
+
+static int cdar_is_available(void) { return 1; }
+
+static int cdar_supports_compression(void) {
+  return 1; // Chunks are compressed by a CBackend
+}
+
+static int cdar_requires_external_compression(void) { return 0; }
+
+static int cdar_supports_streaming(void) {
+  return 0; // The catalog sits at the end
+}
+
+static int cdar_add_entry_streams(void) {
+  return 1; // Files are chunked as they are read
+}
+
+// The codec names the chunk backend, so it is always applied in place
+static int cdar_supports_codec(const CompressionPipeline *pipeline) {
+  (void)pipeline;
+  return 1;
+}
+
+// ---- Backend Definition ----
+
+static const CArchive cdar_archive = {
+    .name = "cdar",
+    .id = ARCHIVE_CDAR,
+    .is_available = cdar_is_available,
+    .supports_compression = cdar_supports_compression,
+    .requires_external_compression = cdar_requires_external_compression,
+    .supports_streaming = cdar_supports_streaming,
+    .create_writer = cdar_create_writer,
+    .add_entry = cdar_add_entry,
+    .close_writer = cdar_close_writer,
+    .supports_codec = cdar_supports_codec,
+    .add_entry_streams = cdar_add_entry_streams,
+    .create_reader = cdar_create_reader,
+    .get_entry_count = cdar_get_entry_count,
+    .get_next_entry = cdar_get_next_entry,
+    .extract_entry_data = cdar_extract_entry_data,
+    .skip_entry_data = cdar_skip_entry,
+    .reset_reader = cdar_reset_reader,
+    .close_reader = cdar_close_reader,
+    .read_entry_data = cdar_read_entry_data,
+    .locate_entry = cdar_locate_entry,
+    .open_shard = cdar_open_shard,
+    .extract_index = cdar_extract_index,
+    .close_shard = cdar_close_shard,
+};
+
+const CArchive *get_cdar_archive(void) { return &cdar_archive; }
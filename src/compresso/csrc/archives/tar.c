@@ -1,23 +1,85 @@
 #define PY_SSIZE_T_CLEAN
 #include "../archives.h"
+#include "../cancel.h"
+#include "../catalog.h"
 #include "../common.h"
+#include "../fileio.h"
+#include "../threadpool.h"
 #include <Python.h>
 #include <archive.h>
 #include <archive_entry.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 // ---- TAR Writer ----
 
 typedef struct {
   struct archive *archive;
   const char *output_path;
+  ArchiveCatalog *catalog; // entries written, when a catalog is kept
 } TarWriter;
 
-static void *tar_create_writer(const char *output_path, int compression_level) {
-  (void)compression_level; // TAR doesn't have compression
+// libarchive write filters for the pipeline codecs, so the tar stream is
+// compressed as it is written rather than in a second pass over a temp file
+static int tar_add_codec_filter(struct archive *a, Format codec) {
+  switch (codec) {
+  case FORMAT_GZIP:
+    return archive_write_add_filter_gzip(a);
+  case FORMAT_BZIP2:
+    return archive_write_add_filter_bzip2(a);
+  case FORMAT_XZ:
+    return archive_write_add_filter_xz(a);
+  case FORMAT_ZSTD:
+    return archive_write_add_filter_zstd(a);
+  case FORMAT_LZ4:
+    return archive_write_add_filter_lz4(a);
+  default:
+    return ARCHIVE_FATAL;
+  }
+}
+
+// Generic 0-9 levels onto each filter's accepted range
+static int tar_filter_level(Format codec, int level) {
+  if (level > 9)
+    level = 9;
+  if ((codec == FORMAT_BZIP2 || codec == FORMAT_LZ4) && level < 1)
+    level = 1;
+  return level;
+}
+
+static int tar_configure_filter(struct archive *a,
+                                const CompressionPipeline *pipeline) {
+  Format codec = pipeline->codec;
+  char value[16];
+
+  if (tar_add_codec_filter(a, codec) != ARCHIVE_OK)
+    return -1;
+
+  if (pipeline->compression_level >= 0) {
+    snprintf(value, sizeof(value), "%d",
+             tar_filter_level(codec, pipeline->compression_level));
+    if (archive_write_set_filter_option(a, NULL, "compression-level", value) !=
+        ARCHIVE_OK)
+      return -1;
+  }
+
+  // zstd and xz compress on their own worker threads; the other filters
+  // ignore the option, so a failure here is not an error
+  if (codec == FORMAT_ZSTD || codec == FORMAT_XZ) {
+    int threads = threadpool_resolve_threads(pipeline->threads);
+    if (threads > 1) {
+      snprintf(value, sizeof(value), "%d", threads);
+      archive_write_set_filter_option(a, NULL, "threads", value);
+    }
+  }
+  return 0;
+}
 
+static void *tar_create_writer(const char *output_path,
+                               const CompressionPipeline *pipeline) {
   TarWriter *writer = safe_malloc(sizeof(TarWriter));
   if (!writer) {
     return NULL;
@@ -33,6 +95,16 @@ static void *tar_create_writer(const char *output_path, int compression_level) {
   // Use PAX format
   archive_write_set_format_pax_restricted(writer->archive);
 
+  if (pipeline->codec != FORMAT_UNKNOWN &&
+      tar_configure_filter(writer->archive, pipeline) != 0) {
+    PyErr_Format(PyExc_IOError, "Failed to set up %s compression: %s",
+                 format_name_string(pipeline->codec),
+                 archive_error_string(writer->archive));
+    archive_write_free(writer->archive);
+    free(writer);
+    return NULL;
+  }
+
   // Open file for writing
   int r = archive_write_open_filename(writer->archive, output_path);
   if (r != ARCHIVE_OK) {
@@ -44,9 +116,40 @@ static void *tar_create_writer(const char *output_path, int compression_level) {
   }
 
   writer->output_path = output_path;
+  writer->catalog = NULL;
   return writer;
 }
 
+static void tar_set_catalog(void *writer_ptr, ArchiveCatalog *catalog) {
+  ((TarWriter *)writer_ptr)->catalog = catalog;
+}
+
+// Give a file with holes a sparse map of its data extents; the pax writer
+// then stores only those and drops the hole bytes it is handed. Returns
+// non-zero if the file is sparse.
+static int tar_add_sparse_map(struct archive_entry *ae, FILE *data,
+                              uint64_t size) {
+  if (size == 0 || io_next_hole(data, 0, size) >= size)
+    return 0;
+
+  uint64_t pos = 0;
+  while (pos < size) {
+    uint64_t start = io_next_data(data, pos, size);
+    if (start >= size)
+      break;
+    uint64_t end = io_next_hole(data, start, size);
+    archive_entry_sparse_add_entry(ae, (la_int64_t)start,
+                                   (la_int64_t)(end - start));
+    pos = end;
+  }
+  // Nothing but a hole: an empty last extent still marks the file sparse
+  if (archive_entry_sparse_count(ae) == 0)
+    archive_entry_sparse_add_entry(ae, (la_int64_t)size, 0);
+  return 1;
+}
+
+static const unsigned char tar_zeros[65536];
+
 static int tar_add_entry(void *writer_ptr, const ArchiveEntry *entry,
                          FILE *data) {
   TarWriter *writer = (TarWriter *)writer_ptr;
@@ -82,6 +185,18 @@ static int tar_add_entry(void *writer_ptr, const ArchiveEntry *entry,
     break;
   }
 
+  int sparse = entry->type == ENTRY_FILE && data &&
+               tar_add_sparse_map(ae, data, entry->size);
+
+  // Where this entry's headers start in the tar stream: the previous
+  // entry's padding goes out first, and filter 0 counts bytes before any
+  // compression
+  uint64_t offset = 0;
+  if (writer->catalog) {
+    archive_write_finish_entry(writer->archive);
+    offset = (uint64_t)archive_filter_bytes(writer->archive, 0);
+  }
+
   // Write header
   int r = archive_write_header(writer->archive, ae);
   if (r != ARCHIVE_OK) {
@@ -91,16 +206,57 @@ static int tar_add_entry(void *writer_ptr, const ArchiveEntry *entry,
     return -1;
   }
 
-  // Write data for files
+  if (writer->catalog && catalog_add(writer->catalog, entry, offset) != 0) {
+    PyErr_NoMemory();
+    archive_entry_free(ae);
+    return -1;
+  }
+
+  // Write data for files. Holes are not read: the writer is handed zeros
+  // for them, which it drops.
   if (entry->type == ENTRY_FILE && data) {
     char buffer[65536];
     size_t bytes_read;
+    uint64_t pos = 0;
+    uint64_t data_start = 0; // the data extent being read, or next
+    uint64_t data_end = sparse ? 0 : UINT64_MAX;
 
     Py_BEGIN_ALLOW_THREADS
 
-        while ((bytes_read = fread(buffer, 1, sizeof(buffer), data)) > 0) {
+        for (;;) {
+      const void *chunk = buffer;
+      if (pos < data_start) {
+        bytes_read = data_start - pos < sizeof(tar_zeros)
+                         ? (size_t)(data_start - pos)
+                         : sizeof(tar_zeros);
+        chunk = tar_zeros;
+      } else if (pos >= data_end && pos < entry->size) {
+        data_start = io_next_data(data, pos, entry->size);
+        data_end = io_next_hole(data, data_start, entry->size);
+        if (fseeko(data, (off_t)data_start, SEEK_SET) != 0) {
+          Py_BLOCK_THREADS PyErr_SetString(PyExc_IOError,
+                                           "Error reading input file");
+          archive_entry_free(ae);
+          return -1;
+        }
+        continue;
+      } else {
+        size_t want = sizeof(buffer);
+        if (data_end - pos < want)
+          want = (size_t)(data_end - pos);
+        bytes_read = io_fread(buffer, want, data);
+      }
+      if (bytes_read == 0)
+        break;
+      pos += bytes_read;
+
+      if (io_cancelled() != IO_CANCEL_NONE) {
+        Py_BLOCK_THREADS cancel_raise();
+        archive_entry_free(ae);
+        return -1;
+      }
       ssize_t bytes_written =
-          archive_write_data(writer->archive, buffer, bytes_read);
+          archive_write_data(writer->archive, chunk, bytes_read);
       if (bytes_written < 0) {
         Py_BLOCK_THREADS PyErr_Format(PyExc_IOError, "Failed to write data: %s",
                                       archive_error_string(writer->archive));
@@ -124,8 +280,11 @@ static int tar_add_entry(void *writer_ptr, const ArchiveEntry *entry,
 
 static int tar_close_writer(void *writer_ptr) {
   TarWriter *writer = (TarWriter *)writer_ptr;
+  int r;
 
-  int r = archive_write_close(writer->archive);
+  // Flushes the filter, which may wait on its compression threads
+  Py_BEGIN_ALLOW_THREADS r = archive_write_close(writer->archive);
+  Py_END_ALLOW_THREADS
   archive_write_free(writer->archive);
   free(writer);
 
@@ -142,6 +301,9 @@ static int tar_close_writer(void *writer_ptr) {
 typedef struct {
   struct archive *archive;
   struct archive_entry *current_entry;
+  char *path;             // set when the catalog can be used to seek
+  ArchiveCatalog catalog; // the archive's sidecar, if current
+  int fd;                 // the descriptor a located read runs on, or -1
 } TarReader;
 
 static void *tar_create_reader(const char *input_path) {
@@ -161,7 +323,7 @@ static void *tar_create_reader(const char *input_path) {
   archive_read_support_format_tar(reader->archive);
   archive_read_support_filter_all(reader->archive);
 
-  int r = archive_read_open_filename(reader->archive, input_path, 10240);
+  int r = archive_read_open_filename(reader->archive, input_path, 65536);
   if (r != ARCHIVE_OK) {
     PyErr_Format(PyExc_IOError, "Failed to open archive: %s",
                  archive_error_string(reader->archive));
@@ -171,6 +333,18 @@ static void *tar_create_reader(const char *input_path) {
   }
 
   reader->current_entry = NULL;
+  reader->path = NULL;
+  reader->fd = -1;
+
+  // Catalog offsets are into the uncompressed stream, so only a plain tar
+  // can be sought in
+  catalog_init(&reader->catalog);
+  if (archive_filter_code(reader->archive, 0) == ARCHIVE_FILTER_NONE &&
+      catalog_load(&reader->catalog, input_path) == 0) {
+    reader->path = strdup(input_path);
+    if (!reader->path)
+      catalog_free(&reader->catalog);
+  }
   return reader;
 }
 
@@ -238,24 +412,42 @@ static int tar_extract_entry_data(void *reader_ptr, FILE *output) {
     return -1;
   }
 
-  char buffer[65536];
-  ssize_t bytes_read;
+  // Blocks come with their offsets: the gaps a sparse entry leaves between
+  // them, and any zero runs inside them, become holes in the output
+  const void *block;
+  size_t size;
+  la_int64_t offset;
+  uint64_t pos = 0;
+  uint64_t entry_size = (uint64_t)archive_entry_size(reader->current_entry);
+  int r;
 
   Py_BEGIN_ALLOW_THREADS
 
-      while ((bytes_read = archive_read_data(reader->archive, buffer,
-                                             sizeof(buffer))) > 0) {
-    size_t bytes_written = fwrite(buffer, 1, bytes_read, output);
-    if (bytes_written != (size_t)bytes_read || ferror(output)) {
+      while ((r = archive_read_data_block(reader->archive, &block, &size,
+                                          &offset)) == ARCHIVE_OK) {
+    if (io_cancelled() != IO_CANCEL_NONE) {
+      Py_BLOCK_THREADS return cancel_raise();
+    }
+    if (offset < 0 || (uint64_t)offset < pos ||
+        io_write_hole(output, (uint64_t)offset - pos) != 0 ||
+        io_write_sparse(output, (const unsigned char *)block, size) != 0 ||
+        ferror(output)) {
       Py_BLOCK_THREADS PyErr_SetString(PyExc_IOError,
                                        "Error writing output file");
       return -1;
     }
+    pos = (uint64_t)offset + size;
+  }
+  if (r == ARCHIVE_EOF && pos < entry_size &&
+      io_write_hole(output, entry_size - pos) != 0) {
+    Py_BLOCK_THREADS PyErr_SetString(PyExc_IOError,
+                                     "Error writing output file");
+    return -1;
   }
 
   Py_END_ALLOW_THREADS
 
-      if (bytes_read < 0) {
+      if (r != ARCHIVE_EOF) {
     PyErr_Format(PyExc_IOError, "Error reading archive data: %s",
                  archive_error_string(reader->archive));
     return -1;
@@ -264,6 +456,65 @@ static int tar_extract_entry_data(void *reader_ptr, FILE *output) {
   return 0;
 }
 
+static int tar_read_entry_data(void *reader_ptr, void *buf, size_t size,
+                               size_t *got) {
+  TarReader *reader = (TarReader *)reader_ptr;
+  if (!reader->current_entry)
+    return EINVAL;
+
+  // Sparse entries come back with their holes as zeros
+  la_ssize_t n = archive_read_data(reader->archive, buf, size);
+  if (n < 0) {
+    int error = archive_errno(reader->archive);
+    return error > 0 ? error : EIO;
+  }
+  *got = (size_t)n;
+  return 0;
+}
+
+// Seek to the entry's headers through the catalog and read on from there
+// with a fresh reader, instead of decoding every entry before it
+static int64_t tar_locate_entry(void *reader_ptr, const char *path) {
+  TarReader *reader = (TarReader *)reader_ptr;
+  if (!reader->path)
+    return -3;
+  int64_t index = catalog_find(&reader->catalog, path);
+  if (index < 0)
+    return -1;
+
+  int fd = open(reader->path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0 ||
+      lseek(fd, (off_t)reader->catalog.entries[index].offset, SEEK_SET) < 0) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, reader->path);
+    if (fd >= 0)
+      close(fd);
+    return -2;
+  }
+
+  struct archive *a = archive_read_new();
+  if (!a) {
+    close(fd);
+    PyErr_NoMemory();
+    return -2;
+  }
+  archive_read_support_format_tar(a);
+  if (archive_read_open_fd(a, fd, 65536) != ARCHIVE_OK) {
+    PyErr_Format(PyExc_IOError, "Failed to open archive: %s",
+                 archive_error_string(a));
+    archive_read_free(a);
+    close(fd);
+    return -2;
+  }
+
+  archive_read_free(reader->archive);
+  if (reader->fd >= 0)
+    close(reader->fd);
+  reader->archive = a;
+  reader->fd = fd;
+  reader->current_entry = NULL;
+  return index;
+}
+
 static int tar_skip_entry(void *reader_ptr) {
   (void)reader_ptr; // Unused - libarchive automatically skips entry data
   return 0;
@@ -280,6 +531,10 @@ static int tar_close_reader(void *reader_ptr) {
 
   int r = archive_read_close(reader->archive);
   archive_read_free(reader->archive);
+  if (reader->fd >= 0)
+    close(reader->fd);
+  catalog_free(&reader->catalog);
+  free(reader->path);
   free(reader);
 
   if (r != ARCHIVE_OK) {
@@ -290,6 +545,93 @@ static int tar_close_reader(void *reader_ptr) {
   return 0;
 }
 
+// ---- TAR Transcoding ----
+
+// Reads the archive as one raw stream through whatever filter it has and
+// writes it back through the pipeline's, so the tar headers and data pass
+// through untouched; the filter's own threads do the compression
+static int tar_transcode(const char *input_path, const char *output_path,
+                         const CompressionPipeline *pipeline) {
+  struct archive *in = archive_read_new();
+  struct archive *out = archive_write_new();
+  struct archive_entry *ae = archive_entry_new();
+  struct archive *failed = NULL;
+  const char *what = NULL;
+  int ret = -1;
+
+  if (!in || !out || !ae) {
+    PyErr_NoMemory();
+    goto done;
+  }
+
+  archive_read_support_format_raw(in);
+  archive_read_support_filter_all(in);
+  struct archive_entry *raw;
+  if (archive_read_open_filename(in, input_path, 65536) != ARCHIVE_OK ||
+      archive_read_next_header(in, &raw) != ARCHIVE_OK) {
+    failed = in;
+    what = "open archive";
+    goto done;
+  }
+
+  archive_write_set_format_raw(out);
+  if (pipeline->codec != FORMAT_UNKNOWN &&
+      tar_configure_filter(out, pipeline) != 0) {
+    PyErr_Format(PyExc_IOError, "Failed to set up %s compression: %s",
+                 format_name_string(pipeline->codec),
+                 archive_error_string(out));
+    goto done;
+  }
+  archive_entry_set_filetype(ae, AE_IFREG);
+  if (archive_write_open_filename(out, output_path) != ARCHIVE_OK ||
+      archive_write_header(out, ae) != ARCHIVE_OK) {
+    failed = out;
+    what = "open archive";
+    goto done;
+  }
+
+  int cancelled = 0;
+  Py_BEGIN_ALLOW_THREADS
+
+      char buffer[65536];
+  la_ssize_t n;
+  while ((n = archive_read_data(in, buffer, sizeof(buffer))) > 0) {
+    if (io_cancelled() != IO_CANCEL_NONE) {
+      cancelled = 1;
+      break;
+    }
+    if (archive_write_data(out, buffer, (size_t)n) != n) {
+      failed = out;
+      break;
+    }
+  }
+  if (n < 0)
+    failed = in;
+  if (!failed && !cancelled && archive_write_close(out) != ARCHIVE_OK)
+    failed = out;
+
+  Py_END_ALLOW_THREADS
+
+      if (cancelled) {
+    cancel_raise();
+    goto done;
+  }
+  what = failed == in ? "read archive" : "write archive";
+  ret = failed ? -1 : 0;
+
+done:
+  if (failed)
+    PyErr_Format(PyExc_IOError, "Failed to %s: %s", what,
+                 archive_error_string(failed));
+  if (ae)
+    archive_entry_free(ae);
+  if (out)
+    archive_write_free(out);
+  if (in)
+    archive_read_free(in);
+  return ret;
+}
+
 // ---- Capability Functions ----
 
 static int tar_is_available(void) {
@@ -308,6 +650,42 @@ static int tar_supports_streaming(void) {
   return 1; // TAR supports streaming
 }
 
+static int tar_add_entry_streams(void) {
+  return 1; // Holes are only looked for through the descriptor
+}
+
+static int tar_support_codec_filter(struct archive *a, Format codec) {
+  switch (codec) {
+  case FORMAT_GZIP:
+    return archive_read_support_filter_gzip(a);
+  case FORMAT_BZIP2:
+    return archive_read_support_filter_bzip2(a);
+  case FORMAT_XZ:
+    return archive_read_support_filter_xz(a);
+  case FORMAT_ZSTD:
+    return archive_read_support_filter_zstd(a);
+  case FORMAT_LZ4:
+    return archive_read_support_filter_lz4(a);
+  default:
+    return ARCHIVE_FATAL;
+  }
+}
+
+// Only filters libarchive implements natively in both directions; ones it
+// would hand to an external program are left to the standalone codecs
+static int tar_supports_codec(const CompressionPipeline *pipeline) {
+  struct archive *w = archive_write_new();
+  struct archive *r = archive_read_new();
+  int ok = w && r &&
+           tar_add_codec_filter(w, pipeline->codec) == ARCHIVE_OK &&
+           tar_support_codec_filter(r, pipeline->codec) == ARCHIVE_OK;
+  if (w)
+    archive_write_free(w);
+  if (r)
+    archive_read_free(r);
+  return ok;
+}
+
 // ---- Backend Definition ----
 
 static const CArchive tar_archive = {
@@ -320,6 +698,9 @@ static const CArchive tar_archive = {
     .create_writer = tar_create_writer,
     .add_entry = tar_add_entry,
     .close_writer = tar_close_writer,
+    .supports_codec = tar_supports_codec,
+    .add_entry_streams = tar_add_entry_streams,
+    .set_catalog = tar_set_catalog,
     .create_reader = tar_create_reader,
     .get_entry_count = tar_get_entry_count,
     .get_next_entry = tar_get_next_entry,
@@ -327,6 +708,9 @@ static const CArchive tar_archive = {
     .skip_entry_data = tar_skip_entry,
     .reset_reader = tar_reset_reader,
     .close_reader = tar_close_reader,
+    .read_entry_data = tar_read_entry_data,
+    .transcode = tar_transcode,
+    .locate_entry = tar_locate_entry,
 };
 
 const CArchive *get_tar_archive(void) { return &tar_archive; }
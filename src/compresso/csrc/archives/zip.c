@@ -3,21 +3,273 @@
 #include <string.h>
 #define PY_SSIZE_T_CLEAN
 #include "../archives.h"
+#include "../cancel.h"
+#include "../checksum.h"
 #include "../common.h"
+#include "../fileio.h"
+#include "../threadpool.h"
 #include <Python.h>
+#include <errno.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <time.h>
+#include <unistd.h>
 #include <zip.h>
+#include <zlib.h>
 
 // ---- ZIP Writer ----
 
+// Files up to this size are deflated on the writer's worker pool; larger
+// ones go through libzip, which compresses them itself at close
+#define ZIP_PARALLEL_MAX_ENTRY ((uint64_t)32 << 20)
+
+// Entries deflated ahead of the one libzip is copying, per worker
+#define ZIP_WINDOW_PER_THREAD 4
+
+#define ZIP_READ_CHUNK 65536
+
+struct ZipWriter;
+
+// One file deflated off the main thread. libzip copies the finished raw
+// deflate stream as-is because the source reports it as already compressed.
 typedef struct {
+  struct ZipWriter *writer;
+  char *source_path;
+  time_t mtime;
+  int submitted; // queued on the pool (main thread only)
+  int done;      // guarded by writer->lock
+  int error;     // errno of a failed read, or ENOMEM / EIO
+  unsigned char *data;
+  size_t data_size;
+  size_t read_pos;
+  uint64_t size; // uncompressed
+  uint32_t crc;
+  zip_error_t zerr;
+} ZipJob;
+
+typedef struct ZipWriter {
   zip_t *archive;
   const char *output_path;
   int compression_level;
+
+  // Parallel deflate, NULL pool when running single-threaded
+  ThreadPool *pool;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  ZipJob **jobs;
+  size_t job_count;
+  size_t job_capacity;
+  size_t next_job;  // first job not yet queued by zip_pump_jobs
+  size_t in_flight; // queued jobs whose output is still held
+  size_t window;
 } ZipWriter;
 
-static void *zip_create_writer(const char *output_path, int compression_level) {
+static void zip_job_free(ZipJob *job) {
+  free(job->source_path);
+  free(job->data);
+  zip_error_fini(&job->zerr);
+  free(job);
+}
+
+// Deflate one file into memory, reading it in chunks; runs on a pool worker
+// without the GIL, so failures are only recorded in the job
+static int zip_deflate_file(ZipJob *job, int level) {
+  FILE *f = fopen(job->source_path, "rb");
+  if (!f)
+    return errno;
+
+  struct stat st;
+  if (fstat(fileno(f), &st) != 0) {
+    int err = errno;
+    fclose(f);
+    return err;
+  }
+
+  z_stream strm;
+  memset(&strm, 0, sizeof(strm));
+  if (deflateInit2(&strm, level, Z_DEFLATED, -MAX_WBITS, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    fclose(f);
+    return ENOMEM;
+  }
+
+  // Sized for the file as stat saw it; grown if it is appended to meanwhile
+  size_t capacity = deflateBound(&strm, (uLong)st.st_size);
+  unsigned char *input = malloc(ZIP_READ_CHUNK);
+  job->data = malloc(capacity);
+  if (!input || !job->data) {
+    free(input);
+    deflateEnd(&strm);
+    fclose(f);
+    return ENOMEM;
+  }
+
+  uint32_t crc = 0;
+  uint64_t total = 0;
+  int err = 0;
+  int zret = Z_OK;
+  int flush = Z_NO_FLUSH;
+
+  while (zret != Z_STREAM_END && !err) {
+    if (strm.avail_in == 0 && flush == Z_NO_FLUSH) {
+      size_t n = fread(input, 1, ZIP_READ_CHUNK, f);
+      if (ferror(f)) {
+        err = EIO;
+        break;
+      }
+      crc = crc32_fast(crc, input, n);
+      total += n;
+      strm.next_in = input;
+      strm.avail_in = (uInt)n;
+      if (n < ZIP_READ_CHUNK)
+        flush = Z_FINISH;
+    }
+
+    if (job->data_size == capacity) {
+      unsigned char *grown = realloc(job->data, capacity * 2);
+      if (!grown) {
+        err = ENOMEM;
+        break;
+      }
+      job->data = grown;
+      capacity *= 2;
+    }
+
+    size_t room = capacity - job->data_size;
+    if (room > UINT32_MAX)
+      room = UINT32_MAX;
+    strm.next_out = job->data + job->data_size;
+    strm.avail_out = (uInt)room;
+    zret = deflate(&strm, flush);
+    job->data_size += room - strm.avail_out;
+    if (zret == Z_STREAM_ERROR)
+      err = EIO;
+  }
+
+  job->size = total;
+  job->crc = crc;
+  deflateEnd(&strm);
+  free(input);
+  fclose(f);
+  return err;
+}
+
+static void zip_job_task(void *arg) {
+  ZipJob *job = (ZipJob *)arg;
+  int err = zip_deflate_file(job, job->writer->compression_level);
+
+  pthread_mutex_lock(&job->writer->lock);
+  job->error = err;
+  job->done = 1;
+  pthread_cond_broadcast(&job->writer->cond);
+  pthread_mutex_unlock(&job->writer->lock);
+}
+
+// Queue jobs in archive order while the window has room. Main thread only.
+static void zip_submit_job(ZipWriter *writer, ZipJob *job) {
+  job->submitted = 1;
+  writer->in_flight++;
+  if (threadpool_submit(writer->pool, zip_job_task, job) != 0)
+    zip_job_task(job); // Queue could not grow; deflate inline
+}
+
+static void zip_pump_jobs(ZipWriter *writer) {
+  while (writer->next_job < writer->job_count &&
+         writer->in_flight < writer->window) {
+    ZipJob *job = writer->jobs[writer->next_job++];
+    if (!job->submitted)
+      zip_submit_job(writer, job);
+  }
+}
+
+static int zip_wait_job(ZipJob *job) {
+  if (!job->submitted)
+    zip_submit_job(job->writer, job); // libzip asked out of order
+  pthread_mutex_lock(&job->writer->lock);
+  while (!job->done)
+    pthread_cond_wait(&job->writer->cond, &job->writer->lock);
+  pthread_mutex_unlock(&job->writer->lock);
+
+  if (job->error) {
+    zip_error_set(&job->zerr, job->error == ENOMEM ? ZIP_ER_MEMORY : ZIP_ER_READ,
+                  job->error);
+    return -1;
+  }
+  return 0;
+}
+
+// libzip source callback; called from zip_close, which runs without the GIL
+static zip_int64_t zip_job_source(void *userdata, void *data, zip_uint64_t len,
+                                  zip_source_cmd_t cmd) {
+  ZipJob *job = (ZipJob *)userdata;
+
+  switch (cmd) {
+  case ZIP_SOURCE_OPEN:
+    if (zip_wait_job(job) != 0)
+      return -1;
+    if (!job->data) {
+      zip_error_set(&job->zerr, ZIP_ER_OPNOTSUPP, 0); // Already copied once
+      return -1;
+    }
+    job->read_pos = 0;
+    return 0;
+
+  case ZIP_SOURCE_READ: {
+    size_t n = job->data_size - job->read_pos;
+    if (n > len)
+      n = (size_t)len;
+    memcpy(data, job->data + job->read_pos, n);
+    job->read_pos += n;
+    return (zip_int64_t)n;
+  }
+
+  case ZIP_SOURCE_CLOSE:
+    // Its bytes are written; release them and let the next job in
+    free(job->data);
+    job->data = NULL;
+    job->writer->in_flight--;
+    zip_pump_jobs(job->writer);
+    return 0;
+
+  case ZIP_SOURCE_STAT: {
+    if (len < sizeof(zip_stat_t)) {
+      zip_error_set(&job->zerr, ZIP_ER_INVAL, 0);
+      return -1;
+    }
+    if (zip_wait_job(job) != 0)
+      return -1;
+    zip_stat_t *st = (zip_stat_t *)data;
+    zip_stat_init(st);
+    st->size = job->size;
+    st->comp_size = job->data_size;
+    st->comp_method = ZIP_CM_DEFLATE;
+    st->crc = job->crc;
+    st->mtime = job->mtime;
+    st->valid |= ZIP_STAT_SIZE | ZIP_STAT_COMP_SIZE | ZIP_STAT_COMP_METHOD |
+                 ZIP_STAT_CRC | ZIP_STAT_MTIME;
+    return sizeof(zip_stat_t);
+  }
+
+  case ZIP_SOURCE_ERROR:
+    return zip_error_to_data(&job->zerr, data, len);
+
+  case ZIP_SOURCE_FREE:
+    return 0; // Jobs belong to the writer, which may still be deflating
+
+  case ZIP_SOURCE_SUPPORTS:
+    return zip_source_make_command_bitmap(
+        ZIP_SOURCE_OPEN, ZIP_SOURCE_READ, ZIP_SOURCE_CLOSE, ZIP_SOURCE_STAT,
+        ZIP_SOURCE_ERROR, ZIP_SOURCE_FREE, -1);
+
+  default:
+    zip_error_set(&job->zerr, ZIP_ER_OPNOTSUPP, 0);
+    return -1;
+  }
+}
+
+static void *zip_create_writer(const char *output_path,
+                               const CompressionPipeline *pipeline) {
+  int compression_level = pipeline->compression_level;
   int err;
   zip_t *za = zip_open(output_path, ZIP_CREATE | ZIP_TRUNCATE, &err);
   if (!za) {
@@ -31,9 +283,10 @@ static void *zip_create_writer(const char *output_path, int compression_level) {
 
   ZipWriter *writer = safe_malloc(sizeof(ZipWriter));
   if (!writer) {
-    zip_close(za);
+    zip_discard(za);
     return NULL;
   }
+  memset(writer, 0, sizeof(*writer));
 
   writer->archive = za;
   writer->output_path = output_path;
@@ -41,9 +294,64 @@ static void *zip_create_writer(const char *output_path, int compression_level) {
                                   ? compression_level
                                   : 6; // Default
 
+  int nthreads = threadpool_resolve_threads(pipeline->threads);
+  if (nthreads > 1) {
+    writer->pool = threadpool_create(nthreads);
+    if (!writer->pool) {
+      zip_discard(za);
+      free(writer);
+      PyErr_SetString(PyExc_RuntimeError, "Failed to start worker threads");
+      return NULL;
+    }
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->cond, NULL);
+    writer->window = (size_t)nthreads * ZIP_WINDOW_PER_THREAD;
+  }
+
   return writer;
 }
 
+// Keep an entry's Unix mode in its external attributes, as Info-ZIP does,
+// so listings and extraction see real permissions; best effort
+static void zip_set_unix_mode(zip_t *za, zip_int64_t idx, uint32_t type,
+                              uint32_t mode) {
+  if (mode != 0)
+    zip_file_set_external_attributes(za, (zip_uint64_t)idx, 0,
+                                     ZIP_OPSYS_UNIX,
+                                     (type | (mode & 07777)) << 16);
+}
+
+// Add a file whose data libzip streams through deflate itself at zip_close,
+// a chunk at a time. Takes ownership of source.
+static int zip_add_file_source(ZipWriter *writer, const ArchiveEntry *entry,
+                               zip_source_t *source) {
+  zip_int64_t idx = zip_file_add(writer->archive, entry->path, source,
+                                 ZIP_FL_ENC_UTF_8 | ZIP_FL_OVERWRITE);
+  if (idx < 0) {
+    zip_source_free(source);
+    PyErr_Format(PyExc_IOError, "Failed to add file: %s",
+                 zip_strerror(writer->archive));
+    return -1;
+  }
+
+  zip_set_unix_mode(writer->archive, idx, S_IFREG, entry->mode);
+
+  // Set compression method and level
+  if (zip_set_file_compression(writer->archive, idx, ZIP_CM_DEFLATE,
+                               writer->compression_level) < 0) {
+    PyErr_Format(PyExc_IOError, "Failed to set compression: %s",
+                 zip_strerror(writer->archive));
+    return -1;
+  }
+
+  // Set modification time
+  if (entry->mtime > 0) {
+    zip_file_set_mtime(writer->archive, (zip_uint64_t)idx, entry->mtime, 0);
+  }
+
+  return 0;
+}
+
 static int zip_add_entry(void *writer_ptr, const ArchiveEntry *entry,
                          FILE *data) {
   ZipWriter *writer = (ZipWriter *)writer_ptr;
@@ -63,73 +371,38 @@ static int zip_add_entry(void *writer_ptr, const ArchiveEntry *entry,
                    zip_strerror(writer->archive));
       return -1;
     }
+    zip_set_unix_mode(writer->archive, idx, S_IFDIR, entry->mode);
 
     return 0;
   }
 
   if (entry->type == ENTRY_FILE) {
-    // Create source from FILE*
     if (!data) {
       PyErr_SetString(PyExc_ValueError, "FILE data required for file entry");
       return -1;
     }
 
-    // Read file contents into memory (libzip requires seekable sources)
-    fseek(data, 0, SEEK_END);
-    long file_size = ftell(data);
-    fseek(data, 0, SEEK_SET);
-
-    if (file_size < 0) {
-      PyErr_SetString(PyExc_IOError, "Failed to get file size");
-      return -1;
-    }
-
-    char *buffer = safe_malloc(file_size);
-    if (!buffer) {
+    // libzip reads the source at zip_close and closes its own stream, so
+    // give it a duplicate of the caller's descriptor
+    int fd = dup(fileno(data));
+    FILE *own = fd >= 0 ? fdopen(fd, "rb") : NULL;
+    if (!own) {
+      if (fd >= 0)
+        close(fd);
+      PyErr_SetFromErrno(PyExc_OSError);
       return -1;
     }
 
-    size_t read = fread(buffer, 1, file_size, data);
-    if (read != (size_t)file_size) {
-      free(buffer);
-      PyErr_SetString(PyExc_IOError, "Failed to read file data");
-      return -1;
-    }
-
-    // Create ZIP source from buffer
-    zip_source_t *source = zip_source_buffer(
-        writer->archive, buffer, (zip_uint64_t)file_size, 1); // 1 = free buffer
+    zip_source_t *source =
+        zip_source_filep(writer->archive, own, 0, ZIP_LENGTH_TO_END);
     if (!source) {
-      free(buffer);
+      fclose(own);
       PyErr_Format(PyExc_IOError, "Failed to create ZIP source: %s",
                    zip_strerror(writer->archive));
       return -1;
     }
 
-    // Add file to archive
-    zip_int64_t idx = zip_file_add(writer->archive, entry->path, source,
-                                   ZIP_FL_ENC_UTF_8 | ZIP_FL_OVERWRITE);
-    if (idx < 0) {
-      zip_source_free(source);
-      PyErr_Format(PyExc_IOError, "Failed to add file: %s",
-                   zip_strerror(writer->archive));
-      return -1;
-    }
-
-    // Set compression method and level
-    if (zip_set_file_compression(writer->archive, idx, ZIP_CM_DEFLATE,
-                                 writer->compression_level) < 0) {
-      PyErr_Format(PyExc_IOError, "Failed to set compression: %s",
-                   zip_strerror(writer->archive));
-      return -1;
-    }
-
-    // Set modification time
-    if (entry->mtime > 0) {
-      zip_file_set_mtime(writer->archive, (zip_uint64_t)idx, entry->mtime, 0);
-    }
-
-    return 0;
+    return zip_add_file_source(writer, entry, source);
   }
 
   if (entry->type == ENTRY_SYMLINK) {
@@ -164,29 +437,122 @@ static int zip_add_entry(void *writer_ptr, const ArchiveEntry *entry,
   return -1;
 }
 
-static int zip_close_writer(void *writer_ptr) {
+static int zip_add_file(void *writer_ptr, const ArchiveEntry *entry,
+                        const char *source_path) {
   ZipWriter *writer = (ZipWriter *)writer_ptr;
 
-  int ret = zip_close(writer->archive);
-  free(writer);
+  if (!writer->pool || entry->size > ZIP_PARALLEL_MAX_ENTRY) {
+    // Opened by libzip only when zip_close copies it, so no descriptor is
+    // held per pending entry
+    zip_source_t *source =
+        zip_source_file(writer->archive, source_path, 0, ZIP_LENGTH_TO_END);
+    if (!source) {
+      PyErr_Format(PyExc_IOError, "Failed to open %s: %s", source_path,
+                   zip_strerror(writer->archive));
+      return -1;
+    }
+    return zip_add_file_source(writer, entry, source);
+  }
 
-  if (ret < 0) {
-    PyErr_SetString(PyExc_IOError, "Failed to close ZIP archive");
+  if (writer->job_count == writer->job_capacity) {
+    size_t capacity = writer->job_capacity ? writer->job_capacity * 2 : 64;
+    ZipJob **jobs = realloc(writer->jobs, capacity * sizeof(ZipJob *));
+    if (!jobs) {
+      PyErr_NoMemory();
+      return -1;
+    }
+    writer->jobs = jobs;
+    writer->job_capacity = capacity;
+  }
+
+  ZipJob *job = safe_malloc(sizeof(ZipJob));
+  if (!job)
+    return -1;
+  memset(job, 0, sizeof(*job));
+  zip_error_init(&job->zerr);
+  job->writer = writer;
+  job->mtime = entry->mtime > 0 ? entry->mtime : time(NULL);
+  job->source_path = strdup(source_path);
+  if (!job->source_path) {
+    zip_job_free(job);
+    PyErr_NoMemory();
+    return -1;
+  }
+
+  zip_source_t *source =
+      zip_source_function(writer->archive, zip_job_source, job);
+  if (!source) {
+    zip_job_free(job);
+    PyErr_Format(PyExc_IOError, "Failed to create ZIP source: %s",
+                 zip_strerror(writer->archive));
+    return -1;
+  }
+
+  zip_int64_t idx = zip_file_add(writer->archive, entry->path, source,
+                                 ZIP_FL_ENC_UTF_8 | ZIP_FL_OVERWRITE);
+  if (idx < 0) {
+    zip_source_free(source);
+    zip_job_free(job);
+    PyErr_Format(PyExc_IOError, "Failed to add file: %s",
+                 zip_strerror(writer->archive));
     return -1;
   }
+  zip_set_unix_mode(writer->archive, idx, S_IFREG, entry->mode);
 
+  writer->jobs[writer->job_count++] = job;
+  zip_pump_jobs(writer); // Start deflating while the tree is still walked
   return 0;
 }
 
+static int zip_close_writer(void *writer_ptr) {
+  ZipWriter *writer = (ZipWriter *)writer_ptr;
+  int ret;
+
+  char message[256] = "";
+
+  // Sources block on their jobs from inside zip_close
+  Py_BEGIN_ALLOW_THREADS ret = zip_close(writer->archive);
+  if (ret < 0) {
+    snprintf(message, sizeof(message), "%s", zip_strerror(writer->archive));
+    zip_discard(writer->archive);
+  }
+  if (writer->pool)
+    threadpool_destroy(writer->pool);
+  Py_END_ALLOW_THREADS
+
+      if (ret < 0) {
+    PyErr_Format(PyExc_IOError, "Failed to close ZIP archive: %s", message);
+  }
+
+  for (size_t i = 0; i < writer->job_count; i++)
+    zip_job_free(writer->jobs[i]);
+  free(writer->jobs);
+  if (writer->pool) {
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->cond);
+  }
+  free(writer);
+
+  return ret < 0 ? -1 : 0;
+}
+
 // ---- ZIP Reader ----
 
 typedef struct {
   zip_t *archive;
+  char *path; // Reopened by each extraction shard
   zip_int64_t num_entries;
   zip_int64_t current_index;
-  zip_file_t *current_file;
+  zip_file_t *current_file; // read_entry_data's, opened on first read
 } ZipReader;
 
+static void zip_drop_current_file(ZipReader *reader) {
+  if (reader->current_file) {
+    zip_fclose(reader->current_file);
+    reader->current_file = NULL;
+  }
+}
+
 static void *zip_create_reader(const char *input_path) {
   int err;
   zip_t *za = zip_open(input_path, ZIP_RDONLY, &err);
@@ -205,6 +571,14 @@ static void *zip_create_reader(const char *input_path) {
     return NULL;
   }
 
+  reader->path = strdup(input_path);
+  if (!reader->path) {
+    zip_discard(za);
+    free(reader);
+    PyErr_NoMemory();
+    return NULL;
+  }
+
   reader->archive = za;
   reader->num_entries = zip_get_num_entries(za, 0);
   reader->current_index = 0;
@@ -221,6 +595,7 @@ static int zip_get_entry_count(void *reader_ptr) {
 static int zip_get_next_entry(void *reader_ptr, ArchiveEntry *entry) {
   ZipReader *reader = (ZipReader *)reader_ptr;
 
+  zip_drop_current_file(reader);
   if (reader->current_index >= reader->num_entries) {
     return 0; // No more entries
   }
@@ -257,8 +632,15 @@ static int zip_get_next_entry(void *reader_ptr, ArchiveEntry *entry) {
     entry->mtime = st.mtime;
   }
 
-  // ZIP doesn't store Unix permissions by default
+  // Read from the central directory like the rest: a Unix mode when the
+  // archiver kept one, the usual defaults otherwise
+  zip_uint8_t opsys;
+  zip_uint32_t attributes;
   entry->mode = (entry->type == ENTRY_DIR) ? 0755 : 0644;
+  if (zip_file_get_external_attributes(reader->archive, reader->current_index,
+                                       0, &opsys, &attributes) == 0 &&
+      opsys == ZIP_OPSYS_UNIX && (attributes >> 16) != 0)
+    entry->mode = (attributes >> 16) & 07777;
 
   reader->current_index++;
 
@@ -284,8 +666,13 @@ static int zip_extract_entry_data(void *reader_ptr, FILE *output) {
   Py_BEGIN_ALLOW_THREADS
 
       while ((bytes_read = zip_fread(zf, buffer, sizeof(buffer))) > 0) {
-    size_t written = fwrite(buffer, 1, bytes_read, output);
-    if (written != (size_t)bytes_read || ferror(output)) {
+    if (io_cancelled() != IO_CANCEL_NONE) {
+      Py_BLOCK_THREADS zip_fclose(zf);
+      return cancel_raise();
+    }
+    if (io_write_sparse(output, (const unsigned char *)buffer,
+                        (size_t)bytes_read) != 0 ||
+        ferror(output)) {
       Py_BLOCK_THREADS zip_fclose(zf);
       PyErr_SetString(PyExc_IOError, "Error writing output");
       return -1;
@@ -305,6 +692,34 @@ static int zip_extract_entry_data(void *reader_ptr, FILE *output) {
   return 0;
 }
 
+static int zip_read_entry_data(void *reader_ptr, void *buf, size_t size,
+                               size_t *got) {
+  ZipReader *reader = (ZipReader *)reader_ptr;
+  if (!reader->current_file) {
+    reader->current_file =
+        zip_fopen_index(reader->archive, reader->current_index - 1, 0);
+    if (!reader->current_file)
+      return EIO;
+  }
+
+  zip_int64_t n = zip_fread(reader->current_file, buf, size);
+  if (n < 0)
+    return EIO;
+  *got = (size_t)n;
+  return 0;
+}
+
+// Central-directory lookup instead of a walk over every entry
+static int64_t zip_locate_entry(void *reader_ptr, const char *path) {
+  ZipReader *reader = (ZipReader *)reader_ptr;
+  zip_drop_current_file(reader);
+  zip_int64_t idx = zip_name_locate(reader->archive, path, 0);
+  if (idx < 0)
+    return -1;
+  reader->current_index = idx;
+  return (int64_t)idx;
+}
+
 static int zip_skip_entry(void *reader_ptr) {
   // ZIP reader moves to next entry by default
   return 0;
@@ -312,6 +727,7 @@ static int zip_skip_entry(void *reader_ptr) {
 
 static int zip_reset_reader(void *reader_ptr) {
   ZipReader *reader = (ZipReader *)reader_ptr;
+  zip_drop_current_file(reader);
   reader->current_index = 0;
   return 0;
 }
@@ -319,7 +735,9 @@ static int zip_reset_reader(void *reader_ptr) {
 static int zip_close_reader(void *reader_ptr) {
   ZipReader *reader = (ZipReader *)reader_ptr;
 
+  zip_drop_current_file(reader);
   int ret = zip_close(reader->archive);
+  free(reader->path);
   free(reader);
 
   if (ret < 0) {
@@ -330,6 +748,38 @@ static int zip_close_reader(void *reader_ptr) {
   return 0;
 }
 
+// ---- ZIP Extraction Shards ----
+
+// zip_t handles are not thread-safe, so every shard opens its own; entries
+// decode independently from the central directory offsets
+static void *zip_open_shard(void *reader_ptr) {
+  ZipReader *reader = (ZipReader *)reader_ptr;
+  int err;
+  return zip_open(reader->path, ZIP_RDONLY, &err);
+}
+
+static int zip_extract_index(void *shard, int64_t index, int fd) {
+  zip_file_t *zf = zip_fopen_index((zip_t *)shard, (zip_uint64_t)index, 0);
+  if (!zf)
+    return EIO;
+
+  char buffer[65536];
+  zip_int64_t bytes_read;
+  int error = 0;
+
+  while (!error && (bytes_read = zip_fread(zf, buffer, sizeof(buffer))) > 0) {
+    error = io_write_sparse_fd(fd, (const unsigned char *)buffer,
+                               (size_t)bytes_read);
+  }
+  if (!error && bytes_read < 0)
+    error = EIO;
+
+  zip_fclose(zf);
+  return error;
+}
+
+static void zip_close_shard(void *shard) { zip_discard((zip_t *)shard); }
+
 // ---- Capability Functions ----
 
 static int zip_is_available(void) { return 1; }
@@ -356,6 +806,7 @@ static const CArchive zip_archive = {
     .create_writer = zip_create_writer,
     .add_entry = zip_add_entry,
     .close_writer = zip_close_writer,
+    .add_file = zip_add_file,
     .create_reader = zip_create_reader,
     .get_entry_count = zip_get_entry_count,
     .get_next_entry = zip_get_next_entry,
@@ -363,6 +814,11 @@ static const CArchive zip_archive = {
     .skip_entry_data = zip_skip_entry,
     .reset_reader = zip_reset_reader,
     .close_reader = zip_close_reader,
+    .read_entry_data = zip_read_entry_data,
+    .locate_entry = zip_locate_entry,
+    .open_shard = zip_open_shard,
+    .extract_index = zip_extract_index,
+    .close_shard = zip_close_shard,
 };
 
 const CArchive *get_zip_archive(void) { return &zip_archive; }
@@ -0,0 +1,153 @@
+#include "cancel.h"
+#include "common.h"
+#include "fileio.h"
+#include "threadpool.h"
+#include <Python.h>
+#include <stdlib.h>
+
+// ---- Batch Runs ----
+
+// Every pool worker drains the shared item list, running the single-file
+// entry points one file at a time. Those take the GIL only around their
+// setup and error paths and drop it for the codec and I/O, so N workers
+// keep N files in flight; the per-file exception is captured while the
+// worker holds the GIL. Once the caller's token trips, the file in flight
+// fails with CancelledError and loses its partial output, and every file
+// not yet started fails with CancelledError without being touched.
+
+typedef struct {
+  BatchItem *items;
+  size_t count;
+  size_t next; // index of the next unclaimed item, advanced atomically
+
+  int compress;
+  AlgoID algo;
+  Strategy strategy;
+  int level;
+  CompressOptions opts;
+  struct CDictionary *dict;
+
+  // The caller's streaming settings, applied on every worker; the progress
+  // counter is shared, so it sums the whole batch, and so is the token
+  size_t io_chunk;
+  IOEngine engine;
+  IOProgress *progress;
+  IOCancel *cancel;
+} Batch;
+
+PyObject *take_raised_exception(void) {
+#if PY_VERSION_HEX >= 0x030C0000
+  return PyErr_GetRaisedException();
+#else
+  PyObject *type, *value, *traceback;
+  PyErr_Fetch(&type, &value, &traceback);
+  PyErr_NormalizeException(&type, &value, &traceback);
+  if (value && traceback)
+    PyException_SetTraceback(value, traceback);
+  Py_XDECREF(type);
+  Py_XDECREF(traceback);
+  return value;
+#endif
+}
+
+static void batch_worker_task(void *arg) {
+  Batch *batch = (Batch *)arg;
+
+  PyGILState_STATE gil = PyGILState_Ensure();
+  size_t prev_chunk = io_set_chunk_size(batch->io_chunk);
+  IOEngine prev_engine = io_set_engine(batch->engine);
+  IOProgress *prev_progress = io_set_progress(batch->progress);
+  IOCancel *prev_cancel = io_set_cancel(batch->cancel);
+
+  for (;;) {
+    size_t i = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED);
+    if (i >= batch->count)
+      break;
+
+    BatchItem *item = &batch->items[i];
+    if (io_cancelled() != IO_CANCEL_NONE) {
+      cancel_raise();
+      item->error = take_raised_exception();
+      continue;
+    }
+
+    int rc = batch->compress
+                 ? compress_file(item->src_path, item->dst_path, batch->algo,
+                                 batch->strategy, batch->level, &batch->opts)
+                 : decompress_file(item->src_path, item->dst_path,
+                                   batch->algo, 1, batch->dict);
+    if (rc != 0) {
+      cancel_check_failure(item->dst_path);
+      item->error = take_raised_exception();
+      if (!item->error) // failed without raising
+        item->error = PyObject_CallFunction(comp_Error, "s", "unknown error");
+      PyErr_Clear();
+    }
+  }
+
+  io_set_cancel(prev_cancel);
+  io_set_progress(prev_progress);
+  io_set_engine(prev_engine);
+  io_set_chunk_size(prev_chunk);
+  PyGILState_Release(gil);
+}
+
+static int run_batch(Batch *batch, int threads) {
+  int nworkers = threadpool_resolve_threads(threads);
+  if ((size_t)nworkers > batch->count)
+    nworkers = batch->count > 0 ? (int)batch->count : 1;
+  batch->next = 0;
+  batch->io_chunk = io_chunk_size();
+  batch->engine = io_engine();
+  batch->progress = io_progress();
+  batch->cancel = io_cancel();
+
+  ThreadPool *pool = nworkers > 1 ? threadpool_create(nworkers) : NULL;
+  if (!pool) {
+    batch_worker_task(batch); // Run inline on the calling thread
+    return 0;
+  }
+
+  for (int i = 0; i < nworkers; i++) {
+    if (threadpool_submit(pool, batch_worker_task, batch) != 0)
+      break; // The workers already queued drain the rest
+  }
+
+  COMP_BEGIN_ALLOW_THREADS threadpool_wait(pool);
+  COMP_END_ALLOW_THREADS
+
+      threadpool_destroy(pool);
+
+  // Nothing was queued at all: finish on this thread
+  if (batch->next < batch->count)
+    batch_worker_task(batch);
+  return 0;
+}
+
+int compress_many(BatchItem *items, size_t count, AlgoID algo,
+                  Strategy strategy, int level, const CompressOptions *opts,
+                  int threads) {
+  Batch batch = {0};
+  batch.items = items;
+  batch.count = count;
+  batch.compress = 1;
+  batch.algo = algo;
+  batch.strategy = strategy;
+  batch.level = level;
+  if (opts)
+    batch.opts = *opts;
+  else
+    batch.opts = (CompressOptions)COMPRESS_OPTIONS_INIT;
+  batch.opts.threads = 1; // parallelism comes from running files side by side
+  return run_batch(&batch, threads);
+}
+
+int decompress_many(BatchItem *items, size_t count, AlgoID algo,
+                    struct CDictionary *dict, int threads) {
+  Batch batch = {0};
+  batch.items = items;
+  batch.count = count;
+  batch.algo = algo;
+  batch.dict = dict;
+  return run_batch(&batch, threads);
+}
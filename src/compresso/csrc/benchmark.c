@@ -0,0 +1,316 @@
+#define PY_SSIZE_T_CLEAN
+#include "common.h"
+#include "fileio.h"
+#include "threadpool.h"
+#include <Python.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// ---- Benchmark Runs ----
+
+// A run times the backend's buffer calls on data already in memory, so no
+// file system, page cache or frame header is in the numbers. Every phase
+// (compress, then decompress) first runs its warm-up calls untimed, then
+// `repeats` timed calls on each of `threads` workers side by side; each
+// call is one sample on the monotonic clock. The process CPU time is read
+// around the timed calls only, split into user and system.
+
+typedef struct {
+  const CBackend *backend;
+  int level;
+  int compress;
+  const unsigned char *src;
+  size_t src_size;
+  size_t out_capacity;
+  int iterations;
+} BenchPhase;
+
+typedef struct {
+  const BenchPhase *phase;
+  unsigned char *out;
+  uint64_t *samples; // phase->iterations entries, or NULL when untimed
+  int failed;
+} BenchWorker;
+
+typedef struct {
+  uint64_t user_ns;
+  uint64_t system_ns;
+} BenchCpuTimes;
+
+static void bench_cpu_times(BenchCpuTimes *t) {
+#if defined(_WIN32) || defined(_WIN64)
+  FILETIME created, exited, kernel, user;
+  memset(t, 0, sizeof(*t));
+  if (GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel,
+                      &user)) {
+    // FILETIMEs count 100 ns ticks
+    t->user_ns = (((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime) *
+                 100;
+    t->system_ns =
+        (((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) * 100;
+  }
+#else
+  struct rusage ru;
+  memset(t, 0, sizeof(*t));
+  if (getrusage(RUSAGE_SELF, &ru) == 0) {
+    t->user_ns = (uint64_t)ru.ru_utime.tv_sec * 1000000000ULL +
+                 (uint64_t)ru.ru_utime.tv_usec * 1000ULL;
+    t->system_ns = (uint64_t)ru.ru_stime.tv_sec * 1000000000ULL +
+                   (uint64_t)ru.ru_stime.tv_usec * 1000ULL;
+  }
+#endif
+}
+
+static int bench_call(const BenchPhase *phase, unsigned char *out) {
+  size_t capacity = phase->out_capacity;
+  size_t produced = 0;
+  if (phase->compress) {
+    return phase->backend->compress_buffer(phase->src, phase->src_size, out,
+                                           &capacity, phase->level, &produced);
+  }
+  return phase->backend->decompress_buffer(phase->src, phase->src_size, out,
+                                           &capacity, &produced);
+}
+
+static void bench_worker_task(void *arg) {
+  BenchWorker *worker = (BenchWorker *)arg;
+  const BenchPhase *phase = worker->phase;
+
+  for (int i = 0; i < phase->iterations; i++) {
+    uint64_t start = io_monotonic_ns();
+    if (bench_call(phase, worker->out) != 0) {
+      worker->failed = 1;
+      return;
+    }
+    if (worker->samples)
+      worker->samples[i] = io_monotonic_ns() - start;
+  }
+}
+
+// Runs the phase on every worker (on the pool when there is one); returns
+// 0, or -1 if any call failed
+static int bench_run_workers(BenchWorker *workers, int nworkers,
+                             ThreadPool *pool) {
+  int submitted = 0;
+  if (pool) {
+    for (; submitted < nworkers; submitted++) {
+      if (threadpool_submit(pool, bench_worker_task, &workers[submitted]) != 0)
+        break;
+    }
+  }
+  for (int i = submitted; i < nworkers; i++)
+    bench_worker_task(&workers[i]); // inline when the pool cannot take it
+  if (pool)
+    threadpool_wait(pool);
+
+  for (int i = 0; i < nworkers; i++) {
+    if (workers[i].failed)
+      return -1;
+  }
+  return 0;
+}
+
+typedef struct {
+  uint64_t *samples; // nworkers * repeats, in ns
+  BenchCpuTimes cpu_before;
+  BenchCpuTimes cpu_after;
+  uint64_t wall_ns;
+} BenchTimings;
+
+static int bench_phase(BenchPhase *phase, BenchWorker *workers, int nworkers,
+                       ThreadPool *pool, int warmup, int repeats,
+                       BenchTimings *timings) {
+  for (int i = 0; i < nworkers; i++) {
+    workers[i].phase = phase;
+    workers[i].samples = NULL;
+    workers[i].failed = 0;
+  }
+  phase->iterations = warmup;
+  if (warmup > 0 && bench_run_workers(workers, nworkers, pool) != 0)
+    return -1;
+
+  for (int i = 0; i < nworkers; i++)
+    workers[i].samples = timings->samples + (size_t)i * (size_t)repeats;
+  phase->iterations = repeats;
+
+  bench_cpu_times(&timings->cpu_before);
+  uint64_t start = io_monotonic_ns();
+  int rc = bench_run_workers(workers, nworkers, pool);
+  timings->wall_ns = io_monotonic_ns() - start;
+  bench_cpu_times(&timings->cpu_after);
+  return rc;
+}
+
+static int compare_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static int set_seconds(PyObject *dict, const char *key, double ns) {
+  PyObject *value = PyFloat_FromDouble(ns / 1e9);
+  if (!value)
+    return -1;
+  int rc = PyDict_SetItemString(dict, key, value);
+  Py_DECREF(value);
+  return rc;
+}
+
+// min/median/p99/mean per call, CPU seconds per call and the phase's wall
+// time, all in seconds; p99 is the nearest-rank percentile
+static PyObject *bench_stats(BenchTimings *timings, size_t count) {
+  uint64_t *s = timings->samples;
+  qsort(s, count, sizeof(*s), compare_u64);
+
+  double total = 0.0;
+  for (size_t i = 0; i < count; i++)
+    total += (double)s[i];
+  double median = count % 2 ? (double)s[count / 2]
+                            : ((double)s[count / 2 - 1] + s[count / 2]) / 2.0;
+  size_t p99 = (count * 99 + 99) / 100; // ceil(0.99 * count)
+
+  double user = (double)(timings->cpu_after.user_ns -
+                         timings->cpu_before.user_ns);
+  double system = (double)(timings->cpu_after.system_ns -
+                           timings->cpu_before.system_ns);
+
+  PyObject *dict = PyDict_New();
+  if (!dict)
+    return NULL;
+  if (set_seconds(dict, "min", (double)s[0]) < 0 ||
+      set_seconds(dict, "median", median) < 0 ||
+      set_seconds(dict, "p99", (double)s[p99 - 1]) < 0 ||
+      set_seconds(dict, "mean", total / (double)count) < 0 ||
+      set_seconds(dict, "user", user / (double)count) < 0 ||
+      set_seconds(dict, "system", system / (double)count) < 0 ||
+      set_seconds(dict, "wall", (double)timings->wall_ns) < 0) {
+    Py_DECREF(dict);
+    return NULL;
+  }
+  return dict;
+}
+
+PyObject *run_benchmark(const unsigned char *data, size_t size, AlgoID algo,
+                        Strategy strategy, int level, int repeats, int warmup,
+                        int threads) {
+  init_backends();
+
+  const CBackend *backend = algo != ALGO_NONE ? find_backend_by_id(algo)
+                                              : choose_backend(strategy);
+  if (!backend) {
+    PyErr_SetString(PyExc_ValueError,
+                    algo != ALGO_NONE
+                        ? "Specified compression algorithm not available"
+                        : "No available compression backend found");
+    return NULL;
+  }
+
+  int nworkers = threadpool_resolve_threads(threads);
+  size_t samples = (size_t)nworkers * (size_t)repeats;
+  size_t bound = backend->max_compressed_size(size);
+  size_t out_capacity = bound > size ? bound : size;
+
+  BenchWorker *workers = (BenchWorker *)calloc((size_t)nworkers,
+                                               sizeof(BenchWorker));
+  BenchTimings comp_times = {0}, decomp_times = {0};
+  comp_times.samples = (uint64_t *)malloc(samples * sizeof(uint64_t));
+  decomp_times.samples = (uint64_t *)malloc(samples * sizeof(uint64_t));
+  unsigned char *packed = (unsigned char *)malloc(bound ? bound : 1);
+  int ok = workers && comp_times.samples && decomp_times.samples && packed;
+  for (int i = 0; ok && i < nworkers; i++) {
+    workers[i].out = (unsigned char *)malloc(out_capacity ? out_capacity : 1);
+    ok = workers[i].out != NULL;
+  }
+
+  PyObject *result = NULL;
+  if (!ok) {
+    PyErr_NoMemory();
+    goto done;
+  }
+
+  const char *failure = NULL;
+  size_t packed_size = 0;
+
+  COMP_BEGIN_ALLOW_THREADS
+
+      // The reference frame the decompress phase decodes, checked once
+      size_t capacity = bound;
+  if (backend->compress_buffer(data, size, packed, &capacity, level,
+                               &packed_size) != 0) {
+    failure = "compression";
+  } else {
+    size_t out_size = 0;
+    capacity = out_capacity;
+    if (backend->decompress_buffer(packed, packed_size, workers[0].out,
+                                   &capacity, &out_size) != 0 ||
+        out_size != size ||
+        (size > 0 && memcmp(workers[0].out, data, size) != 0)) {
+      failure = "round trip";
+    }
+  }
+
+  ThreadPool *pool = NULL;
+  if (!failure && nworkers > 1)
+    pool = threadpool_create(nworkers); // NULL: the workers run inline
+
+  BenchPhase comp = {.backend = backend,
+                     .level = level,
+                     .compress = 1,
+                     .src = data,
+                     .src_size = size,
+                     .out_capacity = bound};
+  if (!failure && bench_phase(&comp, workers, nworkers, pool, warmup, repeats,
+                              &comp_times) != 0) {
+    failure = "compression";
+  }
+  BenchPhase decomp = {.backend = backend,
+                       .level = level,
+                       .src = packed,
+                       .src_size = packed_size,
+                       .out_capacity = out_capacity};
+  if (!failure && bench_phase(&decomp, workers, nworkers, pool, warmup,
+                              repeats, &decomp_times) != 0) {
+    failure = "decompression";
+  }
+  if (pool)
+    threadpool_destroy(pool);
+
+  COMP_END_ALLOW_THREADS
+
+      if (failure) {
+    PyErr_Format(comp_BackendError, "%s benchmark failed during %s",
+                 backend->name, failure);
+    goto done;
+  }
+
+  PyObject *comp_stats = bench_stats(&comp_times, samples);
+  PyObject *decomp_stats =
+      comp_stats ? bench_stats(&decomp_times, samples) : NULL;
+  if (decomp_stats) {
+    result = Py_BuildValue(
+        "{s:s,s:i,s:n,s:n,s:i,s:i,s:i,s:N,s:N}", "algo", backend->name,
+        "level", level, "input_size", (Py_ssize_t)size, "compressed_size",
+        (Py_ssize_t)packed_size, "repeats", repeats, "warmup", warmup,
+        "threads", nworkers, "compress", comp_stats, "decompress",
+        decomp_stats);
+  } else {
+    Py_XDECREF(comp_stats);
+  }
+
+done:
+  if (workers) {
+    for (int i = 0; i < nworkers; i++)
+      free(workers[i].out);
+  }
+  free(workers);
+  free(comp_times.samples);
+  free(decomp_times.samples);
+  free(packed);
+  return result;
+}
@@ -0,0 +1,174 @@
+#include "cancel.h"
+#include "common.h"
+#include <string.h>
+#include <unistd.h>
+
+// ---- Cancel Token Type ----
+
+typedef struct {
+  PyObject_HEAD IOCancel cancel;
+} CancelTokenObject;
+
+// None clears the deadline; seconds put it that far from now
+static int cancel_object_set_deadline(CancelTokenObject *self,
+                                      PyObject *timeout) {
+  uint64_t deadline = 0;
+
+  if (timeout != Py_None) {
+    double seconds = PyFloat_AsDouble(timeout);
+    if (seconds == -1.0 && PyErr_Occurred()) {
+      return -1; // Error already set
+    }
+    if (!(seconds >= 0.0)) {
+      PyErr_SetString(PyExc_ValueError, "timeout must be >= 0 or None");
+      return -1;
+    }
+    deadline = io_monotonic_ns() + (uint64_t)(seconds * 1e9);
+    if (deadline == 0)
+      deadline = 1; // 0 means none
+  }
+
+  __atomic_store_n(&self->cancel.deadline_ns, deadline, __ATOMIC_RELAXED);
+  return 0;
+}
+
+static int cancel_object_init(CancelTokenObject *self, PyObject *args,
+                              PyObject *kwargs) {
+  static char *kwlist[] = {"timeout", NULL};
+  PyObject *timeout = Py_None;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist, &timeout)) {
+    return -1; // Error already set
+  }
+
+  memset(&self->cancel, 0, sizeof(self->cancel));
+  return cancel_object_set_deadline(self, timeout);
+}
+
+static const char *cancel_state_name(int state) {
+  switch (state) {
+  case IO_CANCEL_REQUESTED:
+    return "cancelled";
+  case IO_CANCEL_DEADLINE:
+    return "expired";
+  default:
+    return "active";
+  }
+}
+
+static PyObject *cancel_object_repr(CancelTokenObject *self) {
+  return PyUnicode_FromFormat(
+      "<CancelToken %s>", cancel_state_name(io_cancel_state(&self->cancel)));
+}
+
+static PyObject *cancel_object_get_cancelled(CancelTokenObject *self,
+                                             void *closure
+                                             __attribute__((unused))) {
+  return PyBool_FromLong(io_cancel_state(&self->cancel) != IO_CANCEL_NONE);
+}
+
+static PyObject *cancel_object_get_expired(CancelTokenObject *self,
+                                           void *closure
+                                           __attribute__((unused))) {
+  return PyBool_FromLong(io_cancel_state(&self->cancel) ==
+                         IO_CANCEL_DEADLINE);
+}
+
+static PyObject *cancel_object_cancel(CancelTokenObject *self,
+                                      PyObject *args __attribute__((unused))) {
+  io_cancel_request(&self->cancel);
+  Py_RETURN_NONE;
+}
+
+static PyObject *cancel_object_set_timeout(CancelTokenObject *self,
+                                           PyObject *timeout) {
+  if (cancel_object_set_deadline(self, timeout) != 0) {
+    return NULL; // Error already set
+  }
+  Py_RETURN_NONE;
+}
+
+static PyGetSetDef cancel_object_getset[] = {
+    {"cancelled", (getter)cancel_object_get_cancelled, NULL,
+     "True once cancel() was called or the deadline passed.", NULL},
+    {"expired", (getter)cancel_object_get_expired, NULL,
+     "True once the deadline passed (and cancel() was not called).", NULL},
+    {NULL, NULL, NULL, NULL, NULL} // Sentinel
+};
+
+static PyMethodDef cancel_object_methods[] = {
+    {"cancel", (PyCFunction)cancel_object_cancel, METH_NOARGS,
+     "Stop the calls using this token at their next chunk; safe from any "
+     "thread."},
+    {"set_timeout", (PyCFunction)cancel_object_set_timeout, METH_O,
+     "Move the deadline to timeout seconds from now (None = no deadline)."},
+    {NULL, NULL, 0, NULL} // Sentinel
+};
+
+static PyTypeObject CancelTokenType = {
+    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "compresso._core.CancelToken",
+    .tp_doc = "Cancellation flag and deadline checked by native calls while "
+              "they stream.",
+    .tp_basicsize = sizeof(CancelTokenObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)cancel_object_init,
+    .tp_repr = (reprfunc)cancel_object_repr,
+    .tp_getset = cancel_object_getset,
+    .tp_methods = cancel_object_methods,
+};
+
+int cancel_converter(PyObject *obj, void *out) {
+  IOCancel **cancel = (IOCancel **)out;
+
+  if (obj == Py_None) {
+    *cancel = NULL;
+    return 1;
+  }
+
+  if (!PyObject_TypeCheck(obj, &CancelTokenType)) {
+    PyErr_Format(PyExc_TypeError,
+                 "cancel must be a CancelToken or None, not %.100s",
+                 Py_TYPE(obj)->tp_name);
+    return 0;
+  }
+
+  *cancel = &((CancelTokenObject *)obj)->cancel;
+  return 1;
+}
+
+// ---- Errors ----
+
+int cancel_raise(void) {
+  PyErr_SetString(comp_CancelledError, io_cancelled() == IO_CANCEL_DEADLINE
+                                           ? "Deadline exceeded"
+                                           : "Operation cancelled");
+  return -1;
+}
+
+int cancel_check_failure(const char *partial_path) {
+  if (io_cancelled() == IO_CANCEL_NONE)
+    return 0;
+
+  PyErr_Clear();
+  if (partial_path)
+    (void)unlink(partial_path);
+  cancel_raise();
+  return 1;
+}
+
+// ---- Registration ----
+
+int cancel_type_init(PyObject *module) {
+  if (PyType_Ready(&CancelTokenType) < 0) {
+    return -1;
+  }
+
+  Py_INCREF(&CancelTokenType);
+  if (PyModule_AddObject(module, "CancelToken", (PyObject *)&CancelTokenType) <
+      0) {
+    Py_DECREF(&CancelTokenType);
+    return -1;
+  }
+  return 0;
+}
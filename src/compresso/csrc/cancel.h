@@ -0,0 +1,31 @@
+#ifndef CANCEL_H
+#define CANCEL_H
+
+#include "fileio.h"
+#include <Python.h>
+
+// ---- Python Type ----
+
+// CancelToken wraps an IOCancel that native calls check between chunks
+// while another Python thread may cancel it; see io_set_cancel.
+
+// "O&" converter: None leaves *(IOCancel **)out NULL, a CancelToken stores
+// its token (borrowed from the argument)
+int cancel_converter(PyObject *obj, void *out);
+
+// Adds CancelToken to the module; returns -1 on error
+int cancel_type_init(PyObject *module);
+
+// ---- Errors ----
+
+// Set CancelledError for the calling thread's token and return -1; for
+// loops that notice the token themselves. Needs the GIL.
+int cancel_raise(void);
+
+// After a native call failed: if the calling thread's token has tripped,
+// replace the pending error with CancelledError, remove partial_path (the
+// call's unfinished output, or NULL) and return 1; otherwise return 0 and
+// leave the error alone. Needs the GIL, and the token still set.
+int cancel_check_failure(const char *partial_path);
+
+#endif // CANCEL_H
@@ -0,0 +1,303 @@
+#include "catalog.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#define CATALOG_MTIME_NSEC(st) ((st)->st_mtimespec.tv_nsec)
+#else
+#define CATALOG_MTIME_NSEC(st) ((st)->st_mtim.tv_nsec)
+#endif
+
+// ---- On-Disk Layout ----
+
+// Little-endian throughout:
+//   magic[8] archive_size:u64 archive_mtime:i64 archive_mtime_nsec:u32
+//   count:u64, then per entry
+//   type:u8 mode:u32 mtime:i64 size:u64 offset:u64 path_len:u32
+//   link_len:u32 path[path_len] link[link_len]
+
+static const unsigned char CATALOG_MAGIC[8] = {'C', 'M', 'P', 'C',
+                                               'A', 'T', '0', '1'};
+
+#define CATALOG_HEADER_SIZE (8 + 8 + 8 + 4 + 8)
+#define CATALOG_ENTRY_FIXED (1 + 4 + 8 + 8 + 8 + 4 + 4)
+
+static const char CATALOG_SUFFIX[] = ".catalog";
+
+static char *catalog_path_for(const char *archive_path) {
+  size_t len = strlen(archive_path);
+  char *path = malloc(len + sizeof(CATALOG_SUFFIX));
+  if (path) {
+    memcpy(path, archive_path, len);
+    memcpy(path + len, CATALOG_SUFFIX, sizeof(CATALOG_SUFFIX));
+  }
+  return path;
+}
+
+static void put_le(unsigned char *p, uint64_t v, int bytes) {
+  for (int i = 0; i < bytes; i++)
+    p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint64_t get_le(const unsigned char *p, int bytes) {
+  uint64_t v = 0;
+  for (int i = 0; i < bytes; i++)
+    v |= (uint64_t)p[i] << (8 * i);
+  return v;
+}
+
+// The archive as the catalog stamps it
+static void archive_stamp(const struct stat *st, unsigned char *out) {
+  put_le(out, (uint64_t)st->st_size, 8);
+  put_le(out + 8, (uint64_t)(int64_t)st->st_mtime, 8);
+  put_le(out + 16, (uint64_t)CATALOG_MTIME_NSEC(st), 4);
+}
+
+// ---- Building ----
+
+void catalog_init(ArchiveCatalog *catalog) {
+  memset(catalog, 0, sizeof(*catalog));
+}
+
+void catalog_free(ArchiveCatalog *catalog) {
+  for (size_t i = 0; i < catalog->count; i++) {
+    free(catalog->entries[i].path);
+    free(catalog->entries[i].symlink_target);
+  }
+  free(catalog->entries);
+  catalog_init(catalog);
+}
+
+static CatalogEntry *catalog_push(ArchiveCatalog *catalog) {
+  if (catalog->count == catalog->capacity) {
+    size_t capacity = catalog->capacity ? catalog->capacity * 2 : 64;
+    CatalogEntry *entries =
+        realloc(catalog->entries, capacity * sizeof(CatalogEntry));
+    if (!entries)
+      return NULL;
+    catalog->entries = entries;
+    catalog->capacity = capacity;
+  }
+  CatalogEntry *e = &catalog->entries[catalog->count];
+  memset(e, 0, sizeof(*e));
+  return e;
+}
+
+int catalog_add(ArchiveCatalog *catalog, const ArchiveEntry *entry,
+                uint64_t offset) {
+  CatalogEntry *e = catalog_push(catalog);
+  if (!e)
+    return ENOMEM;
+
+  const char *path = entry->path ? entry->path : "";
+  size_t len = strlen(path);
+  int slash = entry->type == ENTRY_DIR && (len == 0 || path[len - 1] != '/');
+  e->path = malloc(len + slash + 1);
+  if (!e->path)
+    return ENOMEM;
+  memcpy(e->path, path, len);
+  if (slash)
+    e->path[len++] = '/';
+  e->path[len] = '\0';
+
+  if (entry->type == ENTRY_SYMLINK && entry->symlink_target) {
+    e->symlink_target = strdup(entry->symlink_target);
+    if (!e->symlink_target) {
+      free(e->path);
+      return ENOMEM;
+    }
+  }
+
+  e->type = entry->type;
+  e->mode = entry->mode & 07777;
+  e->mtime = (int64_t)entry->mtime;
+  e->size = entry->type == ENTRY_FILE ? entry->size : 0;
+  e->offset = offset;
+  catalog->count++;
+  return 0;
+}
+
+int64_t catalog_find(const ArchiveCatalog *catalog, const char *path) {
+  for (size_t i = catalog->count; i-- > 0;) {
+    if (strcmp(catalog->entries[i].path, path) == 0)
+      return (int64_t)i;
+  }
+  return -1;
+}
+
+// ---- Saving ----
+
+static int write_entry(FILE *f, const CatalogEntry *e) {
+  size_t path_len = strlen(e->path);
+  size_t link_len = e->symlink_target ? strlen(e->symlink_target) : 0;
+  if (path_len > UINT32_MAX || link_len > UINT32_MAX)
+    return EOVERFLOW;
+
+  unsigned char fixed[CATALOG_ENTRY_FIXED];
+  fixed[0] = (unsigned char)e->type;
+  put_le(fixed + 1, e->mode, 4);
+  put_le(fixed + 5, (uint64_t)e->mtime, 8);
+  put_le(fixed + 13, e->size, 8);
+  put_le(fixed + 21, e->offset, 8);
+  put_le(fixed + 29, path_len, 4);
+  put_le(fixed + 33, link_len, 4);
+
+  if (fwrite(fixed, 1, sizeof(fixed), f) != sizeof(fixed) ||
+      fwrite(e->path, 1, path_len, f) != path_len ||
+      (link_len && fwrite(e->symlink_target, 1, link_len, f) != link_len))
+    return EIO;
+  return 0;
+}
+
+int catalog_save(const ArchiveCatalog *catalog, const char *archive_path) {
+  struct stat st;
+  if (stat(archive_path, &st) != 0)
+    return errno;
+
+  char *path = catalog_path_for(archive_path);
+  if (!path)
+    return ENOMEM;
+  size_t len = strlen(path);
+  char *tmp = malloc(len + sizeof(".XXXXXX"));
+  if (!tmp) {
+    free(path);
+    return ENOMEM;
+  }
+  memcpy(tmp, path, len);
+  memcpy(tmp + len, ".XXXXXX", sizeof(".XXXXXX"));
+
+  // Written aside and renamed over, so readers never see half a catalog
+  int fd = mkstemp(tmp);
+  FILE *f = fd >= 0 ? fdopen(fd, "wb") : NULL;
+  if (!f) {
+    int error = errno;
+    if (fd >= 0) {
+      close(fd);
+      unlink(tmp);
+    }
+    free(tmp);
+    free(path);
+    return error;
+  }
+  // mkstemp makes it private; it lists what the archive holds, so it gets
+  // the archive's read permissions
+  (void)fchmod(fd, st.st_mode & 0666);
+
+  unsigned char header[CATALOG_HEADER_SIZE];
+  memcpy(header, CATALOG_MAGIC, sizeof(CATALOG_MAGIC));
+  archive_stamp(&st, header + 8);
+  put_le(header + 28, catalog->count, 8);
+
+  int error = fwrite(header, 1, sizeof(header), f) == sizeof(header) ? 0 : EIO;
+  for (size_t i = 0; error == 0 && i < catalog->count; i++)
+    error = write_entry(f, &catalog->entries[i]);
+  if (fclose(f) != 0 && error == 0)
+    error = errno;
+  if (error == 0 && rename(tmp, path) != 0)
+    error = errno;
+  if (error != 0)
+    unlink(tmp);
+
+  free(tmp);
+  free(path);
+  return error;
+}
+
+// ---- Loading ----
+
+static int read_string(const unsigned char **p, const unsigned char *end,
+                       size_t len, char **out) {
+  if ((size_t)(end - *p) < len)
+    return EINVAL;
+  *out = malloc(len + 1);
+  if (!*out)
+    return ENOMEM;
+  memcpy(*out, *p, len);
+  (*out)[len] = '\0';
+  *p += len;
+  return 0;
+}
+
+static int parse_entries(ArchiveCatalog *catalog, const unsigned char *p,
+                         const unsigned char *end, uint64_t count) {
+  // Every entry takes its fixed part at least, so a count the file cannot
+  // hold is refused before anything is allocated for it
+  if (count > (uint64_t)(end - p) / CATALOG_ENTRY_FIXED)
+    return EINVAL;
+
+  for (uint64_t i = 0; i < count; i++) {
+    if ((size_t)(end - p) < CATALOG_ENTRY_FIXED || p[0] > ENTRY_SPECIAL)
+      return EINVAL;
+    CatalogEntry *e = catalog_push(catalog);
+    if (!e)
+      return ENOMEM;
+    e->type = (EntryType)p[0];
+    e->mode = (uint32_t)get_le(p + 1, 4);
+    e->mtime = (int64_t)get_le(p + 5, 8);
+    e->size = get_le(p + 13, 8);
+    e->offset = get_le(p + 21, 8);
+    size_t path_len = (size_t)get_le(p + 29, 4);
+    size_t link_len = (size_t)get_le(p + 33, 4);
+    p += CATALOG_ENTRY_FIXED;
+
+    catalog->count++; // owns whatever the reads below allocate
+    int error = read_string(&p, end, path_len, &e->path);
+    if (error == 0 && link_len)
+      error = read_string(&p, end, link_len, &e->symlink_target);
+    if (error != 0)
+      return error;
+  }
+  return p == end ? 0 : EINVAL;
+}
+
+int catalog_load(ArchiveCatalog *catalog, const char *archive_path) {
+  struct stat st;
+  if (stat(archive_path, &st) != 0)
+    return errno;
+
+  char *path = catalog_path_for(archive_path);
+  if (!path)
+    return ENOMEM;
+  FILE *f = fopen(path, "rb");
+  free(path);
+  if (!f)
+    return errno;
+
+  unsigned char *data = NULL;
+  size_t size = 0;
+  struct stat cst;
+  int error = fstat(fileno(f), &cst) != 0 ? errno : 0;
+  if (error == 0 && (cst.st_size < CATALOG_HEADER_SIZE ||
+                     (uint64_t)cst.st_size > SIZE_MAX))
+    error = EINVAL;
+  if (error == 0) {
+    size = (size_t)cst.st_size;
+    data = malloc(size);
+    if (!data)
+      error = ENOMEM;
+    else if (fread(data, 1, size, f) != size)
+      error = EIO;
+  }
+  fclose(f);
+
+  if (error == 0) {
+    unsigned char stamp[20];
+    archive_stamp(&st, stamp);
+    if (memcmp(data, CATALOG_MAGIC, sizeof(CATALOG_MAGIC)) != 0)
+      error = EINVAL;
+    else if (memcmp(data + 8, stamp, sizeof(stamp)) != 0)
+      error = ENOENT; // the archive was rewritten since
+    else
+      error = parse_entries(catalog, data + CATALOG_HEADER_SIZE, data + size,
+                            get_le(data + 28, 8));
+  }
+
+  free(data);
+  if (error != 0)
+    catalog_free(catalog);
+  return error;
+}
@@ -0,0 +1,58 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include "archives.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// ---- Archive Catalog ----
+
+// A sidecar listing of a tar archive, written next to it as
+// "<archive>.catalog" when the archive is created with one. It holds each
+// entry's metadata and the offset of its header in the uncompressed tar
+// stream, so listings read one small file instead of decoding the whole
+// archive, and entries of a plain tar can be read by seeking straight to
+// them. The catalog records the archive's size and mtime as it was saved;
+// once the archive changes, loading reports no catalog and callers walk the
+// archive as before.
+//
+// Pure C: safe on any thread, never touches Python. Calls return 0 or an
+// errno value.
+
+typedef struct {
+  char *path;
+  char *symlink_target; // NULL unless a symlink
+  EntryType type;
+  uint32_t mode;
+  int64_t mtime;
+  uint64_t size;   // 0 unless a regular file
+  uint64_t offset; // the entry's first header byte in the tar stream
+} CatalogEntry;
+
+typedef struct ArchiveCatalog {
+  CatalogEntry *entries; // in archive order
+  size_t count;
+  size_t capacity;
+} ArchiveCatalog;
+
+void catalog_init(ArchiveCatalog *catalog);
+void catalog_free(ArchiveCatalog *catalog);
+
+// Record entry as the reader will report it; directories get the trailing
+// '/' tar stores them with
+int catalog_add(ArchiveCatalog *catalog, const ArchiveEntry *entry,
+                uint64_t offset);
+
+// Write the catalog for the archive now at archive_path, replacing any
+// earlier one; call once the archive is complete
+int catalog_save(const ArchiveCatalog *catalog, const char *archive_path);
+
+// Read archive_path's catalog into an initialised catalog. ENOENT when there
+// is none, or it no longer matches the archive; EINVAL if it is damaged.
+int catalog_load(ArchiveCatalog *catalog, const char *archive_path);
+
+// Index of the last entry named path (tar keeps the last of duplicates), or
+// -1 if there is none
+int64_t catalog_find(const ArchiveCatalog *catalog, const char *path);
+
+#endif // CATALOG_H
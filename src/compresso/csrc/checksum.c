@@ -0,0 +1,317 @@
+#include "checksum.h"
+#include <string.h>
+#include <zlib.h>
+
+// ---- XXH64 ----
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+// Little-endian loads, whatever the host byte order
+static inline uint64_t read64(const unsigned char *p) {
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--)
+    v = (v << 8) | p[i];
+  return v;
+}
+
+static inline uint32_t read32(const unsigned char *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+  acc += input * XXH_PRIME64_2;
+  acc = rotl64(acc, 31);
+  return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t xxh64_merge(uint64_t acc, uint64_t val) {
+  acc ^= xxh64_round(0, val);
+  return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+void xxh64_init(XXH64State *state, uint64_t seed) {
+  state->v[0] = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+  state->v[1] = seed + XXH_PRIME64_2;
+  state->v[2] = seed;
+  state->v[3] = seed - XXH_PRIME64_1;
+  state->seed = seed;
+  state->total = 0;
+  state->buffered = 0;
+}
+
+// Fold whole 32-byte stripes into the accumulators; returns the bytes used
+static size_t xxh64_stripes(uint64_t v[4], const unsigned char *p,
+                            size_t size) {
+  const unsigned char *start = p;
+  const unsigned char *end = p + (size & ~(size_t)31);
+  while (p < end) {
+    v[0] = xxh64_round(v[0], read64(p));
+    v[1] = xxh64_round(v[1], read64(p + 8));
+    v[2] = xxh64_round(v[2], read64(p + 16));
+    v[3] = xxh64_round(v[3], read64(p + 24));
+    p += 32;
+  }
+  return (size_t)(p - start);
+}
+
+void xxh64_update(XXH64State *state, const void *data, size_t size) {
+  const unsigned char *p = (const unsigned char *)data;
+  state->total += size;
+
+  if (state->buffered > 0) {
+    size_t take = 32 - state->buffered;
+    if (take > size)
+      take = size;
+    memcpy(state->buf + state->buffered, p, take);
+    state->buffered += take;
+    p += take;
+    size -= take;
+    if (state->buffered < 32)
+      return;
+    xxh64_stripes(state->v, state->buf, 32);
+    state->buffered = 0;
+  }
+
+  size_t used = xxh64_stripes(state->v, p, size);
+  if (used < size) {
+    memcpy(state->buf, p + used, size - used);
+    state->buffered = size - used;
+  }
+}
+
+uint64_t xxh64_digest(const XXH64State *state) {
+  const unsigned char *p = state->buf;
+  const unsigned char *end = p + state->buffered;
+  const uint64_t *v = state->v;
+  uint64_t h;
+
+  if (state->total >= 32) {
+    h = rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12) +
+        rotl64(v[3], 18);
+    h = xxh64_merge(h, v[0]);
+    h = xxh64_merge(h, v[1]);
+    h = xxh64_merge(h, v[2]);
+    h = xxh64_merge(h, v[3]);
+  } else {
+    h = state->seed + XXH_PRIME64_5;
+  }
+
+  h += state->total;
+
+  while (p + 8 <= end) {
+    h ^= xxh64_round(0, read64(p));
+    h = rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    p += 8;
+  }
+  if (p + 4 <= end) {
+    h ^= (uint64_t)read32(p) * XXH_PRIME64_1;
+    h = rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+    p += 4;
+  }
+  while (p < end) {
+    h ^= (uint64_t)(*p) * XXH_PRIME64_5;
+    h = rotl64(h, 11) * XXH_PRIME64_1;
+    p++;
+  }
+
+  h ^= h >> 33;
+  h *= XXH_PRIME64_2;
+  h ^= h >> 29;
+  h *= XXH_PRIME64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+uint64_t xxh64(const void *data, size_t size, uint64_t seed) {
+  // The tail never exceeds 31 bytes, so one pass through the state is exact
+  XXH64State state;
+  xxh64_init(&state, seed);
+  xxh64_update(&state, data, size);
+  return xxh64_digest(&state);
+}
+
+// ---- CRC-32 ----
+
+// The zlib/gzip CRC (reflected polynomial 0xEDB88320). x86-64 folds 64-byte
+// stripes with carry-less multiplies (Gopal et al., "Fast CRC Computation for
+// Generic Polynomials Using PCLMULQDQ", Intel 2009); AArch64 uses the ARMv8
+// CRC32 instructions. Either way the CPU is probed once at run time and whatever
+// the fast path leaves over goes through zlib.
+
+#define CRC32_FOLD_MIN 64 // shortest input worth the folding setup
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32_HAVE_PCLMUL 1
+#include <immintrin.h>
+
+// Fold len bytes (a multiple of 16, at least 64) into the pre-inverted crc
+__attribute__((target("pclmul,sse4.1"))) static uint32_t
+crc32_pclmul(uint32_t crc, const unsigned char *buf, size_t len) {
+  const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+  const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+  const __m128i k5k0 = _mm_set_epi64x(0x0000000000, 0x0163cd6124);
+  const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+  x1 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+  x2 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+  x3 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+  x4 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+  buf += 64;
+  len -= 64;
+
+  while (len >= 64) {
+    x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+    y5 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+    y6 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+    y7 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+    y8 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+    buf += 64;
+    len -= 64;
+  }
+
+  // Fold the four lanes into one
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  // Then any remaining 16-byte blocks
+  while (len >= 16) {
+    x2 = _mm_loadu_si128((const __m128i *)buf);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    buf += 16;
+    len -= 16;
+  }
+
+  // Reduce 128 bits to 64, then Barrett-reduce to 32
+  x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+  x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x1 = _mm_srli_si128(x1, 8);
+  x1 = _mm_xor_si128(x1, x2);
+
+  x0 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, x3);
+  x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+  x1 = _mm_xor_si128(x1, x0);
+
+  x2 = _mm_and_si128(x1, x3);
+  x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+  x2 = _mm_and_si128(x2, x3);
+  x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+static int crc32_cpu_has_fold(void) {
+  // Probed once per process; -1 until then
+  static int cached = -1;
+  int has = __atomic_load_n(&cached, __ATOMIC_RELAXED);
+  if (has < 0) {
+    __builtin_cpu_init();
+    has = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+    __atomic_store_n(&cached, has, __ATOMIC_RELAXED);
+  }
+  return has;
+}
+
+#elif defined(__aarch64__) && defined(__linux__) &&                            \
+    (defined(__GNUC__) || defined(__clang__))
+#define CRC32_HAVE_ARMV8 1
+#include <arm_acle.h>
+#include <sys/auxv.h>
+
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+
+// Run len bytes (a multiple of 8) through the pre-inverted crc
+__attribute__((target("+crc"))) static uint32_t
+crc32_armv8(uint32_t crc, const unsigned char *buf, size_t len) {
+  while (len >= 8) {
+    uint64_t word;
+    memcpy(&word, buf, sizeof(word)); // the instruction reads little-endian
+    crc = __crc32d(crc, word);
+    buf += 8;
+    len -= 8;
+  }
+  return crc;
+}
+
+static int crc32_cpu_has_fold(void) {
+  static int cached = -1; // as above
+  int has = __atomic_load_n(&cached, __ATOMIC_RELAXED);
+  if (has < 0) {
+    has = (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+    __atomic_store_n(&cached, has, __ATOMIC_RELAXED);
+  }
+  return has;
+}
+#endif
+
+// zlib's own routine, fed in uInt-sized pieces on builds without crc32_z
+static uint32_t crc32_zlib(uint32_t crc, const unsigned char *buf,
+                           size_t len) {
+#if ZLIB_VERNUM >= 0x1290
+  return (uint32_t)crc32_z(crc, buf, len);
+#else
+  while (len > 0) {
+    uInt n = len > 0x40000000 ? 0x40000000 : (uInt)len;
+    crc = (uint32_t)crc32(crc, buf, n);
+    buf += n;
+    len -= n;
+  }
+  return crc;
+#endif
+}
+
+uint32_t crc32_fast(uint32_t crc, const void *data, size_t size) {
+  const unsigned char *buf = (const unsigned char *)data;
+
+#if defined(CRC32_HAVE_PCLMUL)
+  if (size >= CRC32_FOLD_MIN && crc32_cpu_has_fold()) {
+    size_t chunk = size & ~(size_t)15;
+    crc = ~crc32_pclmul(~crc, buf, chunk);
+    buf += chunk;
+    size -= chunk;
+  }
+#elif defined(CRC32_HAVE_ARMV8)
+  if (size >= CRC32_FOLD_MIN && crc32_cpu_has_fold()) {
+    size_t chunk = size & ~(size_t)7;
+    crc = ~crc32_armv8(~crc, buf, chunk);
+    buf += chunk;
+    size -= chunk;
+  }
+#endif
+
+  return size > 0 ? crc32_zlib(crc, buf, size) : crc;
+}
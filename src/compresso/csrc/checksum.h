@@ -0,0 +1,35 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ---- Checksums ----
+
+// Non-cryptographic content hashes. Pure C: safe on any thread, never
+// touches Python.
+
+// XXH64 (as specified by the xxHash project); the output is stable across
+// platforms and versions, so it may be stored on disk
+uint64_t xxh64(const void *data, size_t size, uint64_t seed);
+
+// Incremental XXH64: init, update any number of times, then digest. Yields
+// exactly what xxh64() gives for the concatenated input.
+typedef struct {
+  uint64_t v[4];         // stripe accumulators
+  uint64_t total;        // bytes seen so far
+  uint64_t seed;         // for inputs shorter than a stripe
+  unsigned char buf[32]; // partial stripe awaiting more input
+  size_t buffered;
+} XXH64State;
+
+void xxh64_init(XXH64State *state, uint64_t seed);
+void xxh64_update(XXH64State *state, const void *data, size_t size);
+uint64_t xxh64_digest(const XXH64State *state);
+
+// CRC-32 as zlib's crc32() computes it (start from 0, feed the previous
+// result back in to continue), using the CPU's carry-less multiply or CRC
+// instructions when it has them and size_t lengths throughout
+uint32_t crc32_fast(uint32_t crc, const void *data, size_t size);
+
+#endif // CHECKSUM_H
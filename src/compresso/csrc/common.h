@@ -28,6 +28,73 @@ _Static_assert(sizeof(CHeader) == 16,
                "CHeader must be exactly 16 bytes with no padding");
 #endif
 
+// Header versions
+#define C_VERSION_STREAM 1   // one opaque backend payload
+#define C_VERSION_SEEKABLE 2 // independent blocks plus a trailer index
+
+// Header flags. Extension fields follow the header in flag-bit order, so
+// the payload (or the first block) starts at c_header_size(flags).
+#define C_FLAG_DICTIONARY 0x01 // u32 LE dictionary ID; payload needs it
+#define C_FLAG_BLOCK_ALGO 0x02 // version 2: index entries name their blocks'
+                               // algorithms; the header's is nominal
+#define C_FLAG_CHECKSUM 0x04 // version 1: u64 LE XXH64 (seed 0) of the
+                             // original data, checked on decompression
+#define C_FLAG_WINDOW_LOG 0x08 // version 1: u8 log2 of the match window the
+                               // payload was written with; the decoder
+                               // raises its window limit to it
+#define C_FLAG_HOLES 0x10 // version 2: index entries with a comp_size of 0
+                          // are blocks of zeros with no payload (holes)
+#define C_KNOWN_FLAGS                                                          \
+  (C_FLAG_DICTIONARY | C_FLAG_BLOCK_ALGO | C_FLAG_CHECKSUM |                   \
+   C_FLAG_WINDOW_LOG | C_FLAG_HOLES)
+
+#define C_DICT_ID_SIZE 4
+#define C_CHECKSUM_SIZE 8
+#define C_WINDOW_LOG_SIZE 1
+#define C_MAX_HEADER_SIZE                                                      \
+  (sizeof(CHeader) + C_DICT_ID_SIZE + C_CHECKSUM_SIZE + C_WINDOW_LOG_SIZE)
+
+static inline size_t c_header_size(uint8_t flags) {
+  return sizeof(CHeader) + ((flags & C_FLAG_DICTIONARY) ? C_DICT_ID_SIZE : 0) +
+         ((flags & C_FLAG_CHECKSUM) ? C_CHECKSUM_SIZE : 0) +
+         ((flags & C_FLAG_WINDOW_LOG) ? C_WINDOW_LOG_SIZE : 0);
+}
+
+// Seekable (version 2) layout, all trailer integers little-endian:
+//   CHeader (+ extension fields named by its flags)
+//   block[0] .. block[n-1]       back-to-back compressed blocks
+//   index entry[0] .. entry[n-1] CBlockIndexEntry, C_INDEX_ENTRY_SIZE each
+//   trailer                      CTrailer, C_TRAILER_SIZE bytes at EOF
+// Every block except the last decompresses to exactly block_size bytes.
+// With C_FLAG_HOLES, a block of zeros may be a hole instead: an entry with
+// comp_size 0, checksum 0 and algo ALGO_NONE, and nothing in the payload.
+
+#define C_TRAILER_MAGIC "CIDX"
+#define C_INDEX_ENTRY_SIZE 32
+#define C_TRAILER_SIZE 24
+
+typedef struct {
+  uint64_t raw_offset;  // offset of the block in the original data
+  uint64_t comp_offset; // offset of the compressed block in the file
+  uint32_t comp_size;
+  uint32_t raw_size;
+  uint32_t checksum; // crc32 of the uncompressed block
+  uint8_t algo;      // AlgoID of the block (ALGO_NONE = stored raw); on disk
+                     // only with C_FLAG_BLOCK_ALGO, else the header's
+} CBlockIndexEntry;  // algo byte + 3 reserved bytes on disk
+
+typedef struct {
+  uint64_t index_offset;
+  uint32_t block_count;
+  uint32_t block_size;
+  uint32_t index_crc; // crc32 of the serialised index entries
+  uint8_t magic[4];
+} CTrailer;
+
+#define C_DEFAULT_BLOCK_SIZE (4U * 1024 * 1024) // 4 MB
+#define C_MIN_BLOCK_SIZE (64U * 1024)           // 64 KB
+#define C_MAX_BLOCK_SIZE (256U * 1024 * 1024)   // 256 MB
+
 // ---- Algorithms ----
 
 typedef enum {
@@ -41,8 +108,88 @@ typedef enum {
   ALGO_ZIP = 7
 } AlgoID;
 
+// ---- Memory Streaming ----
+
+// Push-style streaming over caller buffers. A step consumes from in and
+// appends to out, advancing both positions, and never touches Python.
+
+typedef struct {
+  const unsigned char *src;
+  size_t size;
+  size_t pos;
+} CStreamIn;
+
+typedef struct {
+  unsigned char *dst;
+  size_t size;
+  size_t pos;
+} CStreamOut;
+
+typedef enum {
+  C_STREAM_RUN = 0,    // consume input, emit what is ready
+  C_STREAM_FLUSH = 1,  // also make everything fed so far decodable
+  C_STREAM_FINISH = 2, // end the stream; no input may follow
+} CStreamOp;
+
+// Step results
+#define C_STREAM_ERROR (-1)
+#define C_STREAM_OK 0   // input consumed; for FLUSH/FINISH all output is out
+#define C_STREAM_MORE 1 // out is full: drain it and call again
+#define C_STREAM_END 2  // decompression: input ends on a complete stream
+
+typedef int (*CStreamCompressFn)(void *state, CStreamIn *in, CStreamOut *out,
+                                 CStreamOp op);
+typedef int (*CStreamDecompressFn)(void *state, CStreamIn *in,
+                                   CStreamOut *out);
+
+// stdio drivers for the steps; every backend's compress_stream and
+// decompress_stream is one of these over its own state
+int stream_compress_fp(CStreamCompressFn step, void *state, FILE *src,
+                       FILE *dst);
+int stream_decompress_fp(CStreamDecompressFn step, void *state, FILE *src,
+                         FILE *dst);
+
+// Like stream_decompress_fp, but hands each piece of output to sink instead
+// of a file; a non-zero return from sink stops with an error. The sink runs
+// without the GIL.
+typedef int (*CStreamSinkFn)(void *ctx, const unsigned char *data,
+                             size_t size);
+int stream_decompress_sink(CStreamDecompressFn step, void *state, FILE *src,
+                           CStreamSinkFn sink, void *ctx);
+
+// Growable-buffer drivers: run one feed through a step and return the
+// produced bytes in *dst (malloc'd, caller frees, may be NULL when empty).
+// Release the GIL while running. Return -1 on error; the decompress
+// driver returns C_STREAM_END or C_STREAM_OK from its last step.
+int stream_compress_mem(CStreamCompressFn step, void *state,
+                        const unsigned char *src, size_t size, CStreamOp op,
+                        unsigned char **dst, size_t *dst_size);
+int stream_decompress_mem(CStreamDecompressFn step, void *state,
+                          const unsigned char *src, size_t size,
+                          unsigned char **dst, size_t *dst_size);
+
 // ---- Backend Interface ----
 
+#define C_SIZE_UNKNOWN UINT64_MAX // no size to pledge to an encoder
+
+// one_shot_max for codecs fast enough to decode it in tens of milliseconds
+#define C_ONE_SHOT_MAX (64ULL * 1024 * 1024) // 64 MB
+
+// Codec tuning beyond the level, for single-stream files; zero fields keep
+// what the level implies. Only backends with stream_new_params take them.
+typedef struct CodecParams {
+  int long_distance;  // long-distance matching over the whole window
+  int window_log;     // log2 of the match window; recorded in the header
+  int match_strategy; // the library's match finder (zstd: 1 fast .. 9 btultra2)
+} CodecParams;
+
+#define CODEC_PARAMS_INIT {0, 0, 0}
+
+static inline int codec_params_set(const CodecParams *params) {
+  return params->long_distance || params->window_log ||
+         params->match_strategy;
+}
+
 typedef struct CBackend {
   const char *name;
   uint8_t id;
@@ -58,8 +205,79 @@ typedef struct CBackend {
                            unsigned char *output, size_t *output_capacity,
                            size_t *output_size);
 
-  int (*compress_stream)(FILE *src, FILE *dst, int level);
+  // size is exactly what src holds from its position on, or C_SIZE_UNKNOWN;
+  // formats with a content-size field record it (and their decoders check
+  // it), and encoders may fit their parameters to it
+  int (*compress_stream)(FILE *src, FILE *dst, int level, uint64_t size);
   int (*decompress_stream)(FILE *src, FILE *dst, uint64_t orig_size);
+
+  // Optional: library-native multi-threaded stream compression whose output
+  // is readable by decompress_stream. Backends without one are block-split.
+  int (*compress_stream_mt)(FILE *src, FILE *dst, int level, int threads,
+                            uint64_t size);
+
+  // Payloads decoding to at most this many bytes are read with
+  // decompress_buffer straight into an output of exactly the header's size
+  // (mapped where possible) rather than streamed; 0 = always stream. The
+  // call cannot stop part way, so this bounds how long cancellation waits.
+  uint64_t one_shot_max;
+
+  // Optional: a reusable native context so repeated buffer calls skip
+  // per-call setup. context_new returns NULL on failure; the *_ctx calls
+  // otherwise behave exactly like compress_buffer/decompress_buffer.
+  void *(*context_new)(int compress);
+  void (*context_free)(void *ctx, int compress);
+  int (*compress_buffer_ctx)(void *ctx, const unsigned char *input,
+                             size_t input_size, unsigned char *output,
+                             size_t *output_capacity, int level,
+                             size_t *output_size);
+  int (*decompress_buffer_ctx)(void *ctx, const unsigned char *input,
+                               size_t input_size, unsigned char *output,
+                               size_t *output_capacity, size_t *output_size);
+
+  // Memory streaming (see CStreamOp). A state is one stream in one
+  // direction; level is ignored for decompression. NULL on failure.
+  void *(*stream_new)(int compress, int level);
+  void (*stream_free)(void *state, int compress);
+  CStreamCompressFn stream_compress_step;
+  CStreamDecompressFn stream_decompress_step;
+
+  // Optional: trained dictionaries. dict_new digests raw dictionary bytes
+  // for one direction (and level, when compressing); NULL on failure. The
+  // *_dict calls take a context_new handle (NULL if the backend has none)
+  // and write payloads only the same dictionary decodes. stream_new_dict is
+  // optional even then; files fall back to independent blocks without it.
+  void *(*dict_new)(const unsigned char *data, size_t size, int compress,
+                    int level);
+  void (*dict_free)(void *dict, int compress);
+  int (*compress_buffer_dict)(void *ctx, const void *dict,
+                              const unsigned char *input, size_t input_size,
+                              unsigned char *output, size_t *output_capacity,
+                              size_t *output_size);
+  int (*decompress_buffer_dict)(void *ctx, const void *dict,
+                                const unsigned char *input,
+                                size_t input_size, unsigned char *output,
+                                size_t *output_capacity, size_t *output_size);
+  void *(*stream_new_dict)(int compress, int level, const void *dict);
+
+  // Optional: build a dictionary of at most *dict_size bytes from `count`
+  // samples stored back to back in `samples`; sets *dict_size
+  int (*dict_train)(const unsigned char *samples, const size_t *sample_sizes,
+                    unsigned count, unsigned char *dict, size_t *dict_size);
+
+  // Optional: CodecParams. check_params raises ValueError for settings the
+  // library rejects. stream_new_params opens a compressing state with them,
+  // on `workers` library threads when > 1. stream_new_window opens a
+  // decompressing state that accepts windows of up to 2^window_log bytes.
+  int (*check_params)(const CodecParams *params);
+  void *(*stream_new_params)(int level, const CodecParams *params,
+                             int workers, uint64_t size);
+  void *(*stream_new_window)(unsigned window_log);
+
+  // Optional: the library the buffer calls run on when it is picked at run
+  // time, e.g. "libdeflate" for zlib; get_capabilities() reports the
+  // backend's name for backends without one.
+  const char *(*implementation)(void);
 } CBackend;
 
 // ---- Strategy ----
@@ -68,6 +286,7 @@ typedef enum {
   STRAT_BALANCED = 0,
   STRAT_FAST = 1,
   STRAT_MAX_RATIO = 2,
+  STRAT_AUTO = 3, // per block, from a sample of the data (files only)
 } Strategy;
 
 // ---- Backend Registry ----
@@ -83,6 +302,7 @@ const CBackend *get_lzma_backend(void);
 const CBackend *get_zstd_backend(void);
 const CBackend *get_lz4_backend(void);
 const CBackend *get_snappy_backend(void);
+const CBackend *get_stored_backend(void); // ALGO_NONE: the raw data
 
 // ---- Snappy Helper ----
 
@@ -97,12 +317,84 @@ const CBackend *choose_backend(Strategy strat);
 extern PyObject *comp_Error;
 extern PyObject *comp_HeaderError;
 extern PyObject *comp_BackendError;
+extern PyObject *comp_CancelledError;
+
+// ---- Name Tables ----
+
+// Fixed name -> value maps for the string lookups on every call (backend,
+// algorithm, strategy and format names). name_table_build picks a hash
+// seed under which no two names share a slot, so a lookup is one hash and
+// one strcmp; it still probes on, should no such seed turn up. Tables are
+// built once and are read-only afterwards.
+#define NAME_TABLE_SLOTS 64
+
+typedef struct {
+  const char *name;
+  int value;
+} NameEntry;
+
+typedef struct {
+  uint32_t seed;
+  NameEntry slots[NAME_TABLE_SLOTS];
+} NameTable;
+
+void name_table_build(NameTable *table, const NameEntry *entries,
+                      size_t count);
+// The value stored for name, or fallback when there is none
+int name_table_find(const NameTable *table, const char *name, int fallback);
 
 // ---- Helpers ----
 
 Strategy strategy_from_string(const char *str);
 AlgoID algo_from_string(const char *str);
 
+// ---- Budget Strategies ----
+
+// A budget strategy ("target_mb_s=500", "max_ratio_within=2s") asks for the
+// best ratio that still meets a throughput or latency budget. The choice is
+// made from per-host calibration (measured MB/s and ratio per backend, level
+// and thread count) pushed in by the Python layer; until then built-in
+// estimates stand in.
+#define CALIBRATION_MAX 256
+
+typedef struct {
+  AlgoID algo;
+  int level;   // -1 = the backend's default
+  int threads; // worker threads the figures were measured with
+  double comp_mb_s;
+  double decomp_mb_s;
+  double ratio; // compressed / raw
+} Calibration;
+
+typedef enum {
+  BUDGET_THROUGHPUT = 1, // value: minimum compression MB/s
+  BUDGET_LATENCY = 2,    // value: maximum seconds for the whole input
+} BudgetKind;
+
+typedef struct {
+  BudgetKind kind;
+  double value;
+} Budget;
+
+// 1 when str is a budget strategy (filling *budget), 0 when it is not, -1
+// when it is one but malformed
+int parse_budget(const char *str, Budget *budget);
+// Replace the calibration table; count 0 restores the built-in estimates
+int set_calibration(const Calibration *entries, size_t count);
+// Copy up to max entries of the table into out; returns the table's size
+size_t get_calibration(Calibration *out, size_t max);
+// Pick the entry with the best ratio meeting the budget for an input of
+// `size` bytes on up to `cpus` threads, its comp_mb_s scaled to that input.
+// Returns 1 when the budget is met, 0 when *choice is only the fastest
+// option, -1 when nothing is available.
+int choose_for_budget(const Budget *budget, uint64_t size, int cpus,
+                      Calibration *choice);
+
+// STRAT_AUTO's per-block choice: samples the block's magic, byte entropy
+// and a quick lz4 trial. Returns NULL when the block should be stored raw.
+// Pure C, for worker threads; init_backends must have run.
+const CBackend *choose_block_backend(const unsigned char *data, size_t size);
+
 const CBackend *find_backend_by_name(const char *name);
 const CBackend *find_backend_by_id(uint8_t id);
 
@@ -145,6 +437,18 @@ static inline void *safe_malloc(size_t size) {
   return ptr;
 }
 
+// ---- GIL Helpers ----
+
+// Backend code may run on native worker threads that never held the GIL, so
+// only release it when the calling thread actually owns it.
+#define COMP_BEGIN_ALLOW_THREADS                                               \
+  {                                                                            \
+    PyThreadState *_comp_save = PyGILState_Check() ? PyEval_SaveThread() : NULL;
+#define COMP_END_ALLOW_THREADS                                                 \
+  if (_comp_save)                                                              \
+    PyEval_RestoreThread(_comp_save);                                          \
+  }
+
 // ---- Backend Error Helper ----
 
 static inline void set_backend_error(const CBackend *backend, const char *op,
@@ -156,10 +460,94 @@ static inline void set_backend_error(const CBackend *backend, const char *op,
 
 // ---- Public API ----
 
+struct CDictionary; // dictionary.h
+
+typedef struct {
+  int threads;         // 1 = single stream, 0 = one per CPU, N > 1 = N workers
+  int seekable;        // always write a block-indexed (version 2) file
+  uint32_t block_size; // 0 = C_DEFAULT_BLOCK_SIZE
+  struct CDictionary *dictionary; // NULL = none
+  int checksum; // store an XXH64 of the input (version 1 files; block-split
+                // ones already carry a CRC-32 per block)
+  CodecParams params; // single-stream files only
+} CompressOptions;
+
+#define COMPRESS_OPTIONS_INIT {1, 0, 0, NULL, 0, CODEC_PARAMS_INIT}
+
+// opts may be NULL for the defaults
 int compress_file(const char *src_path, const char *dst_path, AlgoID algo,
-                  Strategy strategy, int level);
+                  Strategy strategy, int level, const CompressOptions *opts);
+
+// dict is required for (and only used by) files written with one
+int decompress_file(const char *src_path, const char *dst_path, AlgoID algo,
+                    int threads, struct CDictionary *dict);
 
-int decompress_file(const char *src_path, const char *dst_path, AlgoID algo);
+// Returns a new bytes object with up to `length` bytes starting at `offset`
+// of the original data; only the blocks covering the range are decoded
+PyObject *decompress_range(const char *src_path, uint64_t offset,
+                           uint64_t length, int threads,
+                           struct CDictionary *dict);
+
+// Decodes the whole file without writing anything, checking its block
+// CRCs or stored checksum and its length; 0 if intact, else -1 with an
+// exception set
+int verify_file(const char *src_path, int threads, struct CDictionary *dict);
+
+// One file of a compress_many/decompress_many run
+typedef struct {
+  const char *src_path;
+  const char *dst_path;
+  PyObject *error; // the exception this file raised, or NULL on success
+} BatchItem;
+
+// Run compress_file/decompress_file over every item on `threads` workers
+// (0 = one per CPU), each file single-threaded. Per-file failures land in
+// item->error rather than stopping the run; returns 0.
+int compress_many(BatchItem *items, size_t count, AlgoID algo,
+                  Strategy strategy, int level, const CompressOptions *opts,
+                  int threads);
+int decompress_many(BatchItem *items, size_t count, AlgoID algo,
+                    struct CDictionary *dict, int threads);
+
+// Take the pending exception as one object (NULL if none), clearing it; for
+// workers handing a failure to the thread that raises it. Needs the GIL.
+PyObject *take_raised_exception(void);
+
+struct CodecContext; // context.h
+
+// In-memory counterparts of compress_file/decompress_file. The data is a
+// version 1 frame (CHeader + payload), identical to a non-seekable file.
+// dict may be NULL. ctx is a caller-owned context to reuse, or NULL for the
+// per-thread cache.
+PyObject *compress_bytes(const unsigned char *input, size_t input_size,
+                         AlgoID algo, Strategy strategy, int level,
+                         struct CDictionary *dict, struct CodecContext *ctx);
+PyObject *decompress_bytes(const unsigned char *input, size_t input_size,
+                           AlgoID algo, struct CDictionary *dict,
+                           struct CodecContext *ctx);
+
+// Largest frame compress_into can produce for input_size bytes; some codecs
+// (lz4, snappy) need this much room. Returns 0 with an exception on error.
+size_t compress_bound(size_t input_size, AlgoID algo, Strategy strategy);
+
+// Write into a caller-owned buffer; return the bytes written, or -1
+Py_ssize_t compress_into(const unsigned char *input, size_t input_size,
+                         unsigned char *output, size_t output_capacity,
+                         AlgoID algo, Strategy strategy, int level,
+                         struct CDictionary *dict, struct CodecContext *ctx);
+Py_ssize_t decompress_into(const unsigned char *input, size_t input_size,
+                           unsigned char *output, size_t output_capacity,
+                           AlgoID algo, struct CDictionary *dict,
+                           struct CodecContext *ctx);
+
+// Time the backend's buffer calls on data in memory: `warmup` untimed then
+// `repeats` timed compress calls on each of `threads` workers (0 = one per
+// CPU), then the same for decompressing the result. Returns a dict of
+// per-call min/median/p99/mean and user/system CPU seconds plus the phase's
+// wall time, for each direction; NULL with an exception on failure.
+PyObject *run_benchmark(const unsigned char *data, size_t size, AlgoID algo,
+                        Strategy strategy, int level, int repeats, int warmup,
+                        int threads);
 
 const char *get_default_backend_for_strategy(Strategy strat);
 
@@ -1,146 +1,1352 @@
 #define PY_SSIZE_T_CLEAN
 #include "archives.h"
+#include "cancel.h"
+#include "checksum.h"
 #include "common.h"
+#include "context.h"
+#include "dictionary.h"
+#include "fileio.h"
+#include "stats.h"
+#include "threadpool.h"
 #include <Python.h>
 #include <string.h>
+#include <zlib.h>
 
-static int decompress_compresso_file(const char *src_path, const char *dst_path,
-                                     AlgoID algo);
+#if defined(_WIN32) || defined(_WIN64)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static int decompress_compresso_file(FILE *src, const char *src_path,
+                                     const char *dst_path, AlgoID algo,
+                                     int threads, CDictionary *dict);
+
+// ---- Mapped I/O ----
+
+// A whole-file view used by the buffer and block paths. It is mmap'd when
+// the platform and file allow it, so backends read and write the page cache
+// directly; otherwise callers fall back to heap buffers and stdio.
+typedef struct {
+  unsigned char *data;
+  size_t size;
+  int mapped; // 1 = mmap'd, 0 = heap
+} IOBuffer;
+
+// Map [0, size) of src read-only. Returns -1 without setting an exception
+// when mapping is unavailable so the caller can fall back to fread.
+static int iobuf_map_input(FILE *src, size_t size, IOBuffer *buf) {
+  memset(buf, 0, sizeof(*buf));
+
+#if defined(_WIN32) || defined(_WIN64)
+  (void)src;
+  (void)size;
+  return -1;
+#else
+  if (size == 0)
+    return -1;
+
+  void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(src), 0);
+  if (p == MAP_FAILED)
+    return -1;
+
+  (void)posix_madvise(p, size, POSIX_MADV_SEQUENTIAL);
+  buf->data = (unsigned char *)p;
+  buf->size = size;
+  buf->mapped = 1;
+  return 0;
+#endif
+}
+
+// Grow dst to exactly size bytes and map it read-write; the file must have
+// been opened for update ("w+b"). Pending stdio output is flushed first.
+//
+// A store into a page the filesystem cannot back raises SIGBUS rather than
+// failing a write, so the blocks are reserved with posix_fallocate before
+// anything is mapped. Where that fails (a full disk, or a filesystem or
+// platform without it) the caller takes the heap and stdio path, which
+// reports a full disk as an IOError.
+static int iobuf_map_output(FILE *dst, size_t size, IOBuffer *buf) {
+  memset(buf, 0, sizeof(*buf));
+
+#if defined(_WIN32) || defined(_WIN64) || defined(__APPLE__)
+  (void)dst;
+  (void)size;
+  return -1;
+#else
+  if (size == 0 || fflush(dst) != 0)
+    return -1;
+
+  int fd = fileno(dst);
+  off_t written = ftello(dst);
+  if (written < 0)
+    return -1;
+  if (posix_fallocate(fd, 0, (off_t)size) != 0) {
+    // It may have grown the file before giving up
+    (void)ftruncate(fd, written);
+    return -1;
+  }
+
+  void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    // Undo the growth so the stdio fallback appends where it left off
+    (void)ftruncate(fd, written);
+    return -1;
+  }
+
+  buf->data = (unsigned char *)p;
+  buf->size = size;
+  buf->mapped = 1;
+  return 0;
+#endif
+}
+
+static void iobuf_release(IOBuffer *buf) {
+  if (!buf->data)
+    return;
+
+#if !defined(_WIN32) && !defined(_WIN64)
+  if (buf->mapped) {
+    munmap(buf->data, buf->size);
+  } else
+#endif
+  {
+    free(buf->data);
+  }
+  memset(buf, 0, sizeof(*buf));
+}
+
+// Finish a mapped output: unmap, then cut the file back to its real length
+// and leave the stdio position at EOF
+static int iobuf_commit_output(FILE *dst, IOBuffer *buf, size_t final_size) {
+  iobuf_release(buf);
+
+#if defined(_WIN32) || defined(_WIN64)
+  (void)dst;
+  (void)final_size;
+  return -1;
+#else
+  if (ftruncate(fileno(dst), (off_t)final_size) != 0)
+    return -1;
+  return fseeko(dst, 0, SEEK_END);
+#endif
+}
+
+// Cut dst back to size bytes and leave the stdio position there
+static int truncate_output(FILE *dst, uint64_t size) {
+  if (fflush(dst) != 0)
+    return -1;
+#if defined(_WIN32) || defined(_WIN64)
+  if (_chsize_s(_fileno(dst), (__int64)size) != 0)
+    return -1;
+#else
+  if (ftruncate(fileno(dst), (off_t)size) != 0)
+    return -1;
+#endif
+  return fseeko(dst, (off_t)size, SEEK_SET);
+}
+
+// ---- Block Helpers ----
+
+static inline void put_le32(unsigned char *p, uint32_t v) {
+  p[0] = (unsigned char)(v & 0xFF);
+  p[1] = (unsigned char)((v >> 8) & 0xFF);
+  p[2] = (unsigned char)((v >> 16) & 0xFF);
+  p[3] = (unsigned char)((v >> 24) & 0xFF);
+}
+
+static inline uint32_t get_le32(const unsigned char *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static inline void put_le64(unsigned char *p, uint64_t v) {
+  put_le32(p, (uint32_t)(v & 0xFFFFFFFFu));
+  put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+static inline uint64_t get_le64(const unsigned char *p) {
+  return (uint64_t)get_le32(p) | ((uint64_t)get_le32(p + 4) << 32);
+}
+
+static inline uint32_t block_crc32(const unsigned char *data, size_t size) {
+  return crc32_fast(0, data, size);
+}
+
+typedef enum {
+  BLOCK_OK = 0,
+  BLOCK_ERR_READ,
+  BLOCK_ERR_WRITE,
+  BLOCK_ERR_CODEC,
+  BLOCK_ERR_CHECKSUM,
+  BLOCK_ERR_CANCELLED,
+} BlockStatus;
+
+typedef struct {
+  const CBackend *backend; // compression: NULL = choose per block (auto);
+                           // decompression: the block's, NULL = stored
+  const CBackend *chosen;  // compression: what the block was written
+                           // with, NULL = stored raw
+  int level;
+  const void *dict;              // dictionary digest, or NULL
+  const CBlockIndexEntry *entry; // decompression only
+  unsigned char *input;          // NULL when blocks come from a mapping
+  const unsigned char *source;   // input, or the block inside the mapping
+  size_t input_size;
+  unsigned char *output;
+  size_t output_capacity;
+  size_t output_size;
+  uint32_t checksum;
+  int hole; // a block of zeros: an index entry with no payload
+  BlockStatus status;
+} BlockJob;
+
+static void free_block_jobs(BlockJob *jobs, int count) {
+  if (!jobs)
+    return;
+  for (int i = 0; i < count; i++) {
+    io_free(jobs[i].input);
+    io_free(jobs[i].output);
+  }
+  free(jobs);
+}
+
+// Allocates `count` jobs with fixed-size input/output buffers, counted with
+// the other I/O buffers; an input_capacity of 0 skips the input buffers
+// (the input is mapped)
+static BlockJob *alloc_block_jobs(int count, const CBackend *backend,
+                                  int level, const void *dict,
+                                  size_t input_capacity,
+                                  size_t output_capacity) {
+  BlockJob *jobs = (BlockJob *)calloc((size_t)count, sizeof(BlockJob));
+  if (!jobs) {
+    PyErr_NoMemory();
+    return NULL;
+  }
+
+  for (int i = 0; i < count; i++) {
+    jobs[i].backend = backend;
+    jobs[i].level = level;
+    jobs[i].dict = dict;
+    jobs[i].output_capacity = output_capacity;
+    if (input_capacity > 0) {
+      jobs[i].input = (unsigned char *)io_alloc(input_capacity);
+      if (!jobs[i].input) {
+        PyErr_NoMemory();
+        free_block_jobs(jobs, count);
+        return NULL;
+      }
+    }
+    jobs[i].output = (unsigned char *)io_alloc(output_capacity);
+    if (!jobs[i].output) {
+      PyErr_NoMemory();
+      free_block_jobs(jobs, count);
+      return NULL;
+    }
+  }
+
+  return jobs;
+}
+
+// Both tasks run on pool workers without the GIL
+
+static void compress_block_task(void *arg) {
+  BlockJob *job = (BlockJob *)arg;
+  size_t capacity = job->output_capacity;
+
+  // Found in a hole of the input, or zeros written out
+  if (job->hole || io_is_zero(job->source, job->input_size)) {
+    job->hole = 1;
+    job->chosen = NULL;
+    job->checksum = 0;
+    job->output_size = 0;
+    job->status = BLOCK_OK;
+    return;
+  }
+
+  job->checksum = block_crc32(job->source, job->input_size);
+  job->chosen = job->backend ? job->backend
+                             : choose_block_backend(job->source,
+                                                    job->input_size);
+
+  if (job->chosen) {
+    if (codec_compress_buffer(job->chosen, NULL, job->dict, job->source,
+                              job->input_size, job->output, &capacity,
+                              job->level, &job->output_size) != 0) {
+      job->status = BLOCK_ERR_CODEC;
+      return;
+    }
+    if (job->output_size < job->input_size) {
+      job->status = BLOCK_OK;
+      return;
+    }
+    job->chosen = NULL; // it did not shrink: store the block instead
+  }
+
+  memcpy(job->output, job->source, job->input_size);
+  job->output_size = job->input_size;
+  job->status = BLOCK_OK;
+}
+
+static void decompress_block_task(void *arg) {
+  BlockJob *job = (BlockJob *)arg;
+  size_t capacity = job->entry->raw_size;
+
+  if (job->entry->comp_size == 0) { // a hole: nothing to decode
+    job->status = BLOCK_OK;
+    return;
+  }
+  if (!job->backend) { // stored: the index guarantees comp_size == raw_size
+    memcpy(job->output, job->source, job->input_size);
+    job->output_size = job->input_size;
+  } else if (codec_decompress_buffer(job->backend, NULL, job->dict,
+                                     job->source, job->input_size,
+                                     job->output, &capacity,
+                                     &job->output_size) != 0 ||
+             job->output_size != job->entry->raw_size) {
+    job->status = BLOCK_ERR_CODEC;
+    return;
+  }
+
+  job->status = block_crc32(job->output, job->output_size) ==
+                        job->entry->checksum
+                    ? BLOCK_OK
+                    : BLOCK_ERR_CHECKSUM;
+}
+
+static void set_block_error(BlockStatus status, const CBackend *backend,
+                            const char *op) {
+  switch (status) {
+  case BLOCK_OK:
+    break;
+  case BLOCK_ERR_READ:
+    PyErr_SetString(PyExc_IOError, "Failed to read input file");
+    break;
+  case BLOCK_ERR_WRITE:
+    PyErr_SetString(PyExc_IOError, "Failed to write output file");
+    break;
+  case BLOCK_ERR_CODEC:
+    set_backend_error(backend, op, "block");
+    break;
+  case BLOCK_ERR_CHECKSUM:
+    PyErr_SetString(comp_Error, "Block checksum mismatch: data is corrupt");
+    break;
+  case BLOCK_ERR_CANCELLED:
+    cancel_raise();
+    break;
+  }
+}
+
+// ---- Block Index I/O ----
+
+// block_algos: record each entry's algo (for C_FLAG_BLOCK_ALGO files)
+static int write_block_index(FILE *dst, const CBlockIndexEntry *entries,
+                             uint32_t count, uint64_t index_offset,
+                             uint32_t block_size, int block_algos) {
+  size_t index_bytes = (size_t)count * C_INDEX_ENTRY_SIZE;
+  unsigned char *buf = (unsigned char *)safe_malloc(index_bytes);
+  if (!buf)
+    return -1;
+
+  memset(buf, 0, index_bytes);
+  for (uint32_t i = 0; i < count; i++) {
+    unsigned char *p = buf + (size_t)i * C_INDEX_ENTRY_SIZE;
+    put_le64(p, entries[i].raw_offset);
+    put_le64(p + 8, entries[i].comp_offset);
+    put_le32(p + 16, entries[i].comp_size);
+    put_le32(p + 20, entries[i].raw_size);
+    put_le32(p + 24, entries[i].checksum);
+    p[28] = block_algos ? entries[i].algo : 0;
+  }
+
+  unsigned char trailer[C_TRAILER_SIZE];
+  put_le64(trailer, index_offset);
+  put_le32(trailer + 8, count);
+  put_le32(trailer + 12, block_size);
+  put_le32(trailer + 16, block_crc32(buf, index_bytes));
+  memcpy(trailer + 20, C_TRAILER_MAGIC, 4);
+
+  int ok = fwrite(buf, 1, index_bytes, dst) == index_bytes &&
+           fwrite(trailer, 1, sizeof(trailer), dst) == sizeof(trailer) &&
+           !ferror(dst);
+  free(buf);
+
+  if (!ok) {
+    PyErr_SetString(PyExc_IOError, "Failed to write block index");
+    return -1;
+  }
+  return 0;
+}
+
+// Reads and validates the trailer index of a version 2 file. Blocks must be
+// contiguous, ordered and add up to orig_size. Caller frees *out_entries.
+// payload_start is where the first block must begin (the header size).
+// Entries carry their block's algorithm: backend's id, or with
+// C_FLAG_BLOCK_ALGO in flags their own, which must be available.
+static int read_block_index(FILE *src, const char *src_path,
+                            const CBackend *backend, uint8_t flags,
+                            uint64_t orig_size, uint64_t payload_start,
+                            CBlockIndexEntry **out_entries,
+                            CTrailer *out_trailer) {
+  *out_entries = NULL;
+
+  if (fseeko(src, 0, SEEK_END) != 0) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, src_path);
+    return -1;
+  }
+
+  off_t file_size = ftello(src);
+  if (file_size < 0) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, src_path);
+    return -1;
+  }
+
+  if ((uint64_t)file_size < payload_start + C_TRAILER_SIZE) {
+    PyErr_SetString(comp_HeaderError, "File too small for a block index");
+    return -1;
+  }
+
+  unsigned char raw[C_TRAILER_SIZE];
+  if (fseeko(src, file_size - C_TRAILER_SIZE, SEEK_SET) != 0 ||
+      fread(raw, 1, sizeof(raw), src) != sizeof(raw)) {
+    PyErr_SetString(comp_HeaderError, "Failed to read block index trailer");
+    return -1;
+  }
+
+  CTrailer trailer;
+  trailer.index_offset = get_le64(raw);
+  trailer.block_count = get_le32(raw + 8);
+  trailer.block_size = get_le32(raw + 12);
+  trailer.index_crc = get_le32(raw + 16);
+  memcpy(trailer.magic, raw + 20, 4);
+
+  if (memcmp(trailer.magic, C_TRAILER_MAGIC, 4) != 0) {
+    PyErr_SetString(comp_HeaderError, "Invalid block index trailer magic");
+    return -1;
+  }
+
+  uint64_t block_size = trailer.block_size;
+  uint64_t count = trailer.block_count;
+  if (block_size < C_MIN_BLOCK_SIZE || block_size > C_MAX_BLOCK_SIZE ||
+      count != (orig_size + block_size - 1) / block_size ||
+      trailer.index_offset + count * C_INDEX_ENTRY_SIZE + C_TRAILER_SIZE !=
+          (uint64_t)file_size) {
+    PyErr_SetString(comp_HeaderError, "Inconsistent block index trailer");
+    return -1;
+  }
+
+  size_t index_bytes = (size_t)count * C_INDEX_ENTRY_SIZE;
+  unsigned char *buf = (unsigned char *)safe_malloc(index_bytes);
+  if (!buf)
+    return -1;
+
+  if (fseeko(src, (off_t)trailer.index_offset, SEEK_SET) != 0 ||
+      fread(buf, 1, index_bytes, src) != index_bytes) {
+    free(buf);
+    PyErr_SetString(comp_HeaderError, "Failed to read block index");
+    return -1;
+  }
+
+  if (block_crc32(buf, index_bytes) != trailer.index_crc) {
+    free(buf);
+    PyErr_SetString(comp_HeaderError, "Block index checksum mismatch");
+    return -1;
+  }
+
+  CBlockIndexEntry *entries =
+      (CBlockIndexEntry *)calloc((size_t)count, sizeof(CBlockIndexEntry));
+  if (!entries) {
+    free(buf);
+    PyErr_NoMemory();
+    return -1;
+  }
+
+  uint64_t expect_comp = payload_start;
+
+  for (uint64_t i = 0; i < count; i++) {
+    const unsigned char *p = buf + i * C_INDEX_ENTRY_SIZE;
+    CBlockIndexEntry *e = &entries[i];
+    e->raw_offset = get_le64(p);
+    e->comp_offset = get_le64(p + 8);
+    e->comp_size = get_le32(p + 16);
+    e->raw_size = get_le32(p + 20);
+    e->checksum = get_le32(p + 24);
+    e->algo = (flags & C_FLAG_BLOCK_ALGO) ? p[28] : backend->id;
+
+    int hole = e->comp_size == 0 && (flags & C_FLAG_HOLES);
+    if (hole)
+      e->algo = ALGO_NONE;
+
+    const CBackend *block_backend =
+        e->algo == ALGO_NONE ? NULL : find_backend_by_id(e->algo);
+    if (e->algo != ALGO_NONE && !block_backend) {
+      free(buf);
+      free(entries);
+      PyErr_Format(comp_HeaderError,
+                   "Compression algorithm of block %llu not available",
+                   (unsigned long long)i);
+      return -1;
+    }
+
+    uint64_t raw_left = orig_size - i * block_size;
+    uint64_t expect_raw = raw_left < block_size ? raw_left : block_size;
+    size_t max_comp = block_backend ? block_backend->max_compressed_size(
+                                          (size_t)block_size)
+                                    : (size_t)e->raw_size;
+
+    if (e->raw_offset != i * block_size || e->raw_size != expect_raw ||
+        e->comp_offset != expect_comp || (e->comp_size == 0 && !hole) ||
+        (hole && e->checksum != 0) || e->comp_size > max_comp ||
+        (!block_backend && !hole && e->comp_size != e->raw_size)) {
+      free(buf);
+      free(entries);
+      PyErr_Format(comp_HeaderError, "Corrupt block index entry %llu",
+                   (unsigned long long)i);
+      return -1;
+    }
+    expect_comp += e->comp_size;
+  }
+  free(buf);
+
+  if (expect_comp != trailer.index_offset) {
+    free(entries);
+    PyErr_SetString(comp_HeaderError, "Block index does not cover payload");
+    return -1;
+  }
+
+  *out_entries = entries;
+  *out_trailer = trailer;
+  return 0;
+}
+
+// ---- Block-Parallel Compression ----
+
+// Cut the input into block_size blocks, compress a batch of them concurrently
+// (one block per worker), write the batch out in order, then append the index.
+// adaptive lets each block pick its own backend; either way a block that does
+// not shrink is stored raw, and a block of zeros becomes a hole. sparse says
+// src has holes of its own, which are skipped rather than read. *block_flags
+// gets the header flags the index then needs: C_FLAG_BLOCK_ALGO when it
+// records stored blocks or per-block choices, C_FLAG_HOLES when it has holes.
+static int compress_blocks_parallel(FILE *src, FILE *dst,
+                                    const CBackend *backend, int adaptive,
+                                    int level, const void *dict,
+                                    uint64_t payload_start,
+                                    uint64_t total_size, uint32_t block_size,
+                                    int nthreads, int sparse,
+                                    uint8_t *block_flags) {
+  *block_flags = adaptive ? C_FLAG_BLOCK_ALGO : 0;
+
+  size_t max_block_out = backend->max_compressed_size(block_size);
+  if (adaptive) {
+    const CBackend *fast = choose_backend(STRAT_FAST);
+    size_t fast_out = fast ? fast->max_compressed_size(block_size) : 0;
+    if (fast_out > max_block_out)
+      max_block_out = fast_out;
+  }
+  if (max_block_out < block_size) // room for a stored block
+    max_block_out = block_size;
+  if (max_block_out == SIZE_MAX || max_block_out > UINT32_MAX) {
+    PyErr_SetString(PyExc_OverflowError,
+                    "Compressed block size calculation overflow");
+    return -1;
+  }
+
+  uint64_t nblocks = (total_size + block_size - 1) / block_size;
+  if (nblocks > UINT32_MAX) {
+    PyErr_SetString(PyExc_OverflowError, "Too many blocks for block index");
+    return -1;
+  }
+  int nworkers = (uint64_t)nthreads < nblocks ? nthreads : (int)nblocks;
+
+  CBlockIndexEntry *entries =
+      (CBlockIndexEntry *)calloc((size_t)nblocks, sizeof(CBlockIndexEntry));
+  if (!entries) {
+    PyErr_NoMemory();
+    return -1;
+  }
+
+  // Workers read their blocks straight out of a mapping when possible
+  IOBuffer in;
+  int mapped = total_size <= SIZE_MAX &&
+               iobuf_map_input(src, (size_t)total_size, &in) == 0;
+
+  int return_code = 0;
+  ThreadPool *pool = NULL;
+  BlockJob *jobs = alloc_block_jobs(nworkers, backend, level, dict,
+                                    mapped ? 0 : block_size, max_block_out);
+  if (!jobs) {
+    return_code = -1;
+    goto done;
+  }
+  if (adaptive) {
+    for (int i = 0; i < nworkers; i++) {
+      jobs[i].backend = NULL;
+    }
+  }
+
+  pool = threadpool_create(nworkers);
+  if (!pool) {
+    PyErr_SetString(comp_Error, "Failed to start compression worker threads");
+    return_code = -1;
+    goto done;
+  }
+
+  uint64_t comp_offset = payload_start;
+  BlockStatus status = BLOCK_OK;
+  const CBackend *failed = backend;
+  COMP_BEGIN_ALLOW_THREADS
+
+      uint64_t next_block = 0;
+  while (next_block < nblocks && status == BLOCK_OK) {
+    if (io_cancelled() != IO_CANCEL_NONE) {
+      status = BLOCK_ERR_CANCELLED;
+      break;
+    }
+
+    int batch = 0;
+    for (; batch < nworkers && next_block + batch < nblocks; batch++) {
+      BlockJob *job = &jobs[batch];
+      uint64_t raw_start = (next_block + batch) * block_size;
+      size_t want = total_size - raw_start < block_size
+                        ? (size_t)(total_size - raw_start)
+                        : block_size;
+      job->hole = sparse && io_next_data(src, raw_start, raw_start + want) ==
+                                raw_start + want;
+      if (job->hole) {
+        job->source = NULL;
+        if (!mapped && fseeko(src, (off_t)(raw_start + want), SEEK_SET) != 0) {
+          status = BLOCK_ERR_READ;
+          break;
+        }
+      } else if (mapped) {
+        job->source = in.data + raw_start;
+      } else if (io_fread(job->input, want, src) != want) {
+        status = BLOCK_ERR_READ;
+        break;
+      } else {
+        job->source = job->input;
+      }
+      job->input_size = want;
+
+      if (threadpool_submit(pool, compress_block_task, job) != 0) {
+        compress_block_task(job); // queue full: do it on this thread
+      }
+    }
+
+    threadpool_wait(pool);
+
+    for (int i = 0; i < batch && status == BLOCK_OK; i++) {
+      BlockJob *job = &jobs[i];
+      if (job->status != BLOCK_OK) {
+        status = job->status;
+        failed = job->chosen;
+        break;
+      }
+      if (io_fwrite(job->output, job->output_size, dst) != job->output_size) {
+        status = BLOCK_ERR_WRITE;
+        break;
+      }
+
+      CBlockIndexEntry *e = &entries[next_block + i];
+      e->raw_offset = (next_block + i) * block_size;
+      e->comp_offset = comp_offset;
+      e->comp_size = (uint32_t)job->output_size;
+      e->raw_size = (uint32_t)job->input_size;
+      e->checksum = job->checksum;
+      e->algo = job->chosen ? job->chosen->id : ALGO_NONE;
+      if (job->hole)
+        *block_flags |= C_FLAG_HOLES;
+      else if (!job->chosen)
+        *block_flags |= C_FLAG_BLOCK_ALGO;
+      comp_offset += job->output_size;
+      io_progress_advance(job->input_size);
+    }
+    next_block += batch;
+  }
+
+  if (status == BLOCK_OK && ferror(dst)) {
+    status = BLOCK_ERR_WRITE;
+  }
+
+  COMP_END_ALLOW_THREADS
+
+      if (status != BLOCK_OK) {
+    set_block_error(status, failed, "compression");
+    return_code = -1;
+    goto done;
+  }
+
+  return_code = write_block_index(dst, entries, (uint32_t)nblocks, comp_offset,
+                                  block_size,
+                                  (*block_flags & C_FLAG_BLOCK_ALGO) != 0);
+
+done:
+  threadpool_destroy(pool);
+  free_block_jobs(jobs, nworkers);
+  free(entries);
+  if (mapped)
+    iobuf_release(&in);
+  return return_code;
+}
+
+// ---- Block-Parallel Decompression ----
+
+// Called in block order for each decoded block, with NULL data for a hole;
+// returns 0 to continue
+typedef int (*BlockSink)(void *ctx, const CBlockIndexEntry *entry,
+                         const unsigned char *data);
+
+// Decode blocks [first, end) of a version 2 file, a batch per worker at a
+// time, each with its entry's algorithm. The index is contiguous, so the
+// compressed data is read sequentially.
+static int decode_blocks(FILE *src, const void *dict,
+                         const CBlockIndexEntry *entries,
+                         const CTrailer *trailer, uint64_t first, uint64_t end,
+                         int nthreads, BlockSink sink, void *sink_ctx) {
+  uint64_t nblocks = end - first;
+  if (nblocks == 0)
+    return 0;
+
+  int nworkers = (uint64_t)nthreads < nblocks ? nthreads : (int)nblocks;
+  size_t max_comp = 0;
+  for (uint64_t i = first; i < end; i++) {
+    if (entries[i].comp_size > max_comp)
+      max_comp = entries[i].comp_size;
+  }
+
+  // Block data ends where the index starts; map that much of the file
+  IOBuffer in;
+  int mapped = trailer->index_offset <= SIZE_MAX &&
+               iobuf_map_input(src, (size_t)trailer->index_offset, &in) == 0;
+
+  BlockJob *jobs = alloc_block_jobs(nworkers, NULL, -1, dict,
+                                    mapped ? 0 : max_comp,
+                                    trailer->block_size);
+  if (!jobs) {
+    if (mapped)
+      iobuf_release(&in);
+    return -1;
+  }
+
+  ThreadPool *pool = NULL;
+  if (nworkers > 1) {
+    pool = threadpool_create(nworkers);
+    if (!pool) {
+      free_block_jobs(jobs, nworkers);
+      if (mapped)
+        iobuf_release(&in);
+      PyErr_SetString(comp_Error,
+                      "Failed to start decompression worker threads");
+      return -1;
+    }
+  }
+
+  BlockStatus status = BLOCK_OK;
+  const CBackend *failed = NULL;
+  COMP_BEGIN_ALLOW_THREADS
+
+      if (!mapped &&
+          fseeko(src, (off_t)entries[first].comp_offset, SEEK_SET) != 0) {
+    status = BLOCK_ERR_READ;
+  }
+
+  uint64_t next_block = first;
+  while (next_block < end && status == BLOCK_OK) {
+    if (io_cancelled() != IO_CANCEL_NONE) {
+      status = BLOCK_ERR_CANCELLED;
+      break;
+    }
+
+    int batch = 0;
+    for (; batch < nworkers && next_block + batch < end; batch++) {
+      BlockJob *job = &jobs[batch];
+      job->entry = &entries[next_block + batch];
+      job->backend = job->entry->algo == ALGO_NONE
+                         ? NULL
+                         : find_backend_by_id(job->entry->algo);
+      job->input_size = job->entry->comp_size;
+      if (mapped) {
+        job->source = in.data + job->entry->comp_offset;
+      } else if (io_fread(job->input, job->input_size, src) !=
+                 job->input_size) {
+        status = BLOCK_ERR_READ;
+        break;
+      } else {
+        job->source = job->input;
+      }
+
+      if (!pool || threadpool_submit(pool, decompress_block_task, job) != 0) {
+        decompress_block_task(job);
+      }
+    }
+
+    threadpool_wait(pool);
+
+    for (int i = 0; i < batch && status == BLOCK_OK; i++) {
+      if (jobs[i].status != BLOCK_OK) {
+        status = jobs[i].status;
+        failed = jobs[i].backend;
+      } else if (sink(sink_ctx, jobs[i].entry,
+                      jobs[i].entry->comp_size ? jobs[i].output : NULL) != 0) {
+        status = BLOCK_ERR_WRITE;
+      } else {
+        io_progress_advance(jobs[i].input_size);
+      }
+    }
+    next_block += batch;
+  }
+
+  COMP_END_ALLOW_THREADS
+
+      threadpool_destroy(pool);
+  free_block_jobs(jobs, nworkers);
+  if (mapped)
+    iobuf_release(&in);
+
+  if (status != BLOCK_OK) {
+    set_block_error(status, failed, "decompression");
+    return -1;
+  }
+  return 0;
+}
+
+// Holes and zero runs are seeked over, so a sparse original comes back
+// sparse; the caller ends with io_sparse_finish
+static int file_block_sink(void *ctx, const CBlockIndexEntry *entry,
+                           const unsigned char *data) {
+  FILE *dst = (FILE *)ctx;
+  return data ? io_write_sparse(dst, data, entry->raw_size)
+              : io_write_hole(dst, entry->raw_size);
+}
+
+// verify_file: the workers have already checked each block's CRC
+static int discard_block_sink(void *ctx, const CBlockIndexEntry *entry,
+                              const unsigned char *data) {
+  (void)ctx;
+  (void)entry;
+  (void)data;
+  return 0;
+}
+
+typedef struct {
+  unsigned char *out;
+  uint64_t offset; // requested range start in the original data
+  uint64_t end;    // requested range end (exclusive)
+} RangeSink;
+
+static int range_block_sink(void *ctx, const CBlockIndexEntry *entry,
+                            const unsigned char *data) {
+  RangeSink *range = (RangeSink *)ctx;
+  uint64_t block_end = entry->raw_offset + entry->raw_size;
+  uint64_t lo = range->offset > entry->raw_offset ? range->offset
+                                                  : entry->raw_offset;
+  uint64_t hi = range->end < block_end ? range->end : block_end;
+
+  if (hi > lo && data) {
+    memcpy(range->out + (lo - range->offset), data + (lo - entry->raw_offset),
+           (size_t)(hi - lo));
+  } else if (hi > lo) {
+    memset(range->out + (lo - range->offset), 0, (size_t)(hi - lo));
+  }
+  return 0;
+}
+
+// ---- Whole-Buffer Paths ----
+
+// For backends without a streaming interface: the input is mapped rather
+// than copied, and the output is written straight into a mapping of dst
+// (sized to the worst case, then truncated). Heap buffers are the fallback.
+// header_size bytes of header are already in dst.
+static int compress_whole_buffer(FILE *src, FILE *dst, const CBackend *backend,
+                                 int level, const void *dict,
+                                 size_t header_size, uint64_t total_size) {
+  if (total_size > SIZE_MAX) {
+    PyErr_SetString(PyExc_MemoryError, "File is too large to fit in memory");
+    return -1;
+  }
+
+  // The codec call below cannot stop part way, so this is the last check
+  if (io_cancelled() != IO_CANCEL_NONE)
+    return cancel_raise();
+
+  size_t input_size = (size_t)total_size;
+  size_t max_payload = backend->max_compressed_size(input_size);
+  if (max_payload == SIZE_MAX || max_payload > SIZE_MAX - header_size) {
+    PyErr_SetString(PyExc_OverflowError, "Compressed size calculation overflow");
+    return -1;
+  }
+
+  int return_code = 0;
+  IOBuffer in;
+  IOBuffer out;
+  memset(&out, 0, sizeof(out));
+
+  if (iobuf_map_input(src, input_size, &in) != 0) {
+    in.data = (unsigned char *)safe_malloc(input_size);
+    if (!in.data)
+      return -1;
+    in.size = input_size;
+
+    if (io_fread(in.data, input_size, src) != input_size || ferror(src)) {
+      PyErr_SetString(PyExc_IOError, "Failed to read input file");
+      return_code = -1;
+      goto done;
+    }
+  }
+
+  // The header is already in dst, so a mapping starts just past it
+  unsigned char *payload = NULL;
+  if (iobuf_map_output(dst, header_size + max_payload, &out) == 0) {
+    payload = out.data + header_size;
+  } else {
+    out.data = (unsigned char *)safe_malloc(max_payload);
+    if (!out.data) {
+      return_code = -1;
+      goto done;
+    }
+    out.size = max_payload;
+    payload = out.data;
+  }
+
+  size_t output_size = 0;
+  if (codec_compress_buffer(backend, NULL, dict, in.data, input_size, payload,
+                            &max_payload, level, &output_size) != 0) {
+    set_backend_error(backend, "compression", "buffer compression");
+    return_code = -1;
+    goto done;
+  }
+  io_progress_advance(input_size);
+
+  if (out.mapped) {
+    if (iobuf_commit_output(dst, &out, header_size + output_size) != 0) {
+      PyErr_SetString(PyExc_IOError,
+                      "Failed to write compressed data to output file");
+      return_code = -1;
+    }
+  } else if (io_fwrite(payload, output_size, dst) != output_size ||
+             ferror(dst)) {
+    PyErr_SetString(PyExc_IOError,
+                    "Failed to write compressed data to output file");
+    return_code = -1;
+  }
+
+done:
+  iobuf_release(&in);
+  iobuf_release(&out);
+  return return_code;
+}
 
-// ---- I/O Helpers ----
+// file_size covers the header; the payload is everything after its
+// header_size bytes. The output is mapped at exactly orig_size, which the
+// header promises.
+static int decompress_whole_buffer(FILE *src, FILE *dst,
+                                   const CBackend *backend, const void *dict,
+                                   size_t file_size, size_t header_size,
+                                   uint64_t orig_size) {
+  if (validate_size(orig_size, SIZE_MAX, "Original size") != 0) {
+    return -1;
+  }
+  if (io_cancelled() != IO_CANCEL_NONE)
+    return cancel_raise(); // as when compressing: one uninterruptible call
 
-static unsigned char *__attribute__((unused))
-read_file_to_memory(const char *path, size_t *out_size) {
-  FILE *f = fopen(path, "rb");
-  if (!f) {
-    PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
-    return NULL;
+  size_t comp_size = file_size - header_size;
+  int return_code = 0;
+  IOBuffer in;
+  IOBuffer out;
+  memset(&out, 0, sizeof(out));
+
+  const unsigned char *comp_data = NULL;
+  if (iobuf_map_input(src, file_size, &in) == 0) {
+    comp_data = in.data + header_size;
+  } else {
+    in.data = (unsigned char *)safe_malloc(comp_size);
+    if (!in.data)
+      return -1;
+    in.size = comp_size;
+
+    if (io_fread(in.data, comp_size, src) != comp_size || ferror(src)) {
+      PyErr_SetString(PyExc_IOError,
+                      "Failed to read compressed data from input file");
+      return_code = -1;
+      goto done;
+    }
+    comp_data = in.data;
   }
 
-#if defined(_WIN32) || defined(_WIN64)
+  if (backend->id == ALGO_SNAPPY &&
+      snappy_decompressed_size(comp_data, comp_size) != (size_t)orig_size) {
+    PyErr_SetString(PyExc_RuntimeError,
+                    "Failed to determine decompressed size for Snappy");
+    return_code = -1;
+    goto done;
+  }
 
-  if (_fseeki64(f, 0, SEEK_END) != 0) {
-    PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
-    fclose(f);
-    return NULL;
+  size_t output_capacity = (size_t)orig_size;
+  if (iobuf_map_output(dst, output_capacity, &out) != 0) {
+    out.data = (unsigned char *)safe_malloc(output_capacity);
+    if (!out.data) {
+      return_code = -1;
+      goto done;
+    }
+    out.size = output_capacity;
   }
 
-  __int64 len = _ftelli64(f);
-  if (len < 0) {
-    PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
-    fclose(f);
-    return NULL;
+  size_t output_size = 0;
+  if (codec_decompress_buffer(backend, NULL, dict, comp_data, comp_size,
+                              out.data, &output_capacity, &output_size) != 0 ||
+      output_size != (size_t)orig_size) {
+    set_backend_error(backend, "decompression", "buffer decompression");
+    return_code = -1;
+    goto done;
   }
+  io_progress_advance(comp_size);
 
-  if (len > (size_t)-1) {
-    PyErr_SetString(PyExc_MemoryError, "File is too large to fit in memory");
-    fclose(f);
-    return NULL;
+  if (out.mapped) {
+    io_punch_zeros(fileno(dst), out.data, output_size);
+    if (iobuf_commit_output(dst, &out, output_size) != 0) {
+      PyErr_SetString(PyExc_IOError,
+                      "Failed to write decompressed data to output file");
+      return_code = -1;
+    }
+  } else if (io_fwrite(out.data, output_size, dst) != output_size ||
+             ferror(dst)) {
+    PyErr_SetString(PyExc_IOError,
+                    "Failed to write decompressed data to output file");
+    return_code = -1;
   }
 
-  if (_fseeki64(f, 0, SEEK_SET) != 0) {
-    PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
-    fclose(f);
-    return NULL;
+done:
+  iobuf_release(&in);
+  iobuf_release(&out);
+  return return_code;
+}
+
+// ---- Shared Helpers ----
+
+// An explicit algorithm wins over the strategy
+static const CBackend *resolve_compress_backend(AlgoID algo,
+                                                Strategy strategy) {
+  const CBackend *backend = NULL;
+
+  if (algo != ALGO_NONE) {
+    backend = find_backend_by_id(algo);
+    if (!backend) {
+      PyErr_SetString(PyExc_ValueError,
+                      "Specified compression algorithm not available");
+    }
+  } else {
+    backend = choose_backend(strategy);
+    if (!backend) {
+      PyErr_SetString(comp_Error, "No available compression backend found");
+    }
   }
 
-#else
+  return backend;
+}
 
-  if (fseeko(f, 0, SEEK_END) != 0) {
-    PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
-    fclose(f);
-    return NULL;
+static void init_header(CHeader *header, uint8_t version,
+                        const CBackend *backend, int level,
+                        uint64_t orig_size) {
+  memcpy(header->magic, C_MAGIC, C_MAGIC_LEN);
+  header->version = version;
+  header->algo = backend->id;
+  header->level = (uint8_t)((level >= 0 && level <= 254) ? level : 255);
+  header->flags = 0;
+  header->orig_size = orig_size;
+}
+
+// Values of the extension fields; each is only on disk when its flag is set
+typedef struct {
+  uint32_t dict_id;   // C_FLAG_DICTIONARY
+  uint64_t checksum;  // C_FLAG_CHECKSUM
+  uint8_t window_log; // C_FLAG_WINDOW_LOG
+} CHeaderExt;
+
+// Header followed by the extension fields its flags name; returns the
+// number of bytes packed (c_header_size(header->flags))
+static size_t pack_header(const CHeader *header, const CHeaderExt *ext,
+                          unsigned char *buf) {
+  memcpy(buf, header, sizeof(*header));
+  unsigned char *p = buf + sizeof(*header);
+  if (header->flags & C_FLAG_DICTIONARY) {
+    put_le32(p, ext->dict_id);
+    p += C_DICT_ID_SIZE;
   }
+  if (header->flags & C_FLAG_CHECKSUM) {
+    put_le64(p, ext->checksum);
+    p += C_CHECKSUM_SIZE;
+  }
+  if (header->flags & C_FLAG_WINDOW_LOG)
+    *p = ext->window_log;
+  return c_header_size(header->flags);
+}
 
-  off_t len = ftello(f);
-  if (len < 0) {
-    PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
-    fclose(f);
-    return NULL;
+// Overwrite the header at the start of a finished dst with one of the same
+// size, leaving the stdio position at EOF
+static int rewrite_header(FILE *dst, const CHeader *header,
+                          const CHeaderExt *ext) {
+  unsigned char buf[C_MAX_HEADER_SIZE];
+  size_t size = pack_header(header, ext, buf);
+
+  if (fseeko(dst, 0, SEEK_SET) != 0 || fwrite(buf, 1, size, dst) != size ||
+      fseeko(dst, 0, SEEK_END) != 0 || ferror(dst)) {
+    PyErr_SetString(comp_HeaderError, "Failed to write header to output file");
+    return -1;
+  }
+  return 0;
+}
+
+// Replace a finished version 1 output whose payload did not shrink with the
+// input itself: the same header, but naming the stored backend and no
+// dictionary, so reading it back is a plain copy
+static int store_file_raw(FILE *src, FILE *dst, CHeader *header,
+                          const CHeaderExt *ext) {
+  const CBackend *stored = find_backend_by_id(ALGO_NONE);
+  header->algo = ALGO_NONE;
+  header->flags &= C_FLAG_CHECKSUM;
+
+  if (truncate_output(dst, 0) != 0 || rewrite_header(dst, header, ext) != 0 ||
+      fseeko(src, 0, SEEK_SET) != 0) {
+    PyErr_SetString(PyExc_IOError, "Failed to rewrite output file");
+    return -1;
   }
 
-  if ((uintmax_t)len > SIZE_MAX) {
-    PyErr_SetString(PyExc_MemoryError, "File is too large to fit in memory");
-    fclose(f);
-    return NULL;
+  if (stored->compress_stream(src, dst, -1, C_SIZE_UNKNOWN) != 0) {
+    PyErr_SetString(PyExc_IOError, "Failed to write output file");
+    return -1;
   }
+  return 0;
+}
 
-  if (fseeko(f, 0, SEEK_SET) != 0) {
-    PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
-    fclose(f);
-    return NULL;
+// Flags a header of the given version may carry
+static uint8_t header_flags_allowed(uint8_t version) {
+  return version == C_VERSION_SEEKABLE
+             ? C_KNOWN_FLAGS & ~(C_FLAG_CHECKSUM | C_FLAG_WINDOW_LOG)
+             : C_KNOWN_FLAGS & ~(C_FLAG_BLOCK_ALGO | C_FLAG_HOLES);
+}
+
+// Reads the extension fields after a header already read from src
+static int read_header_fields(FILE *src, const CHeader *header,
+                              CHeaderExt *ext) {
+  memset(ext, 0, sizeof(*ext));
+  if (header->flags & ~header_flags_allowed(header->version)) {
+    PyErr_Format(comp_HeaderError, "Unsupported header flags: 0x%02x",
+                 header->flags);
+    return -1;
   }
 
-#endif
+  unsigned char buf[C_MAX_HEADER_SIZE];
+  size_t size = c_header_size(header->flags) - sizeof(CHeader);
+  if (size > 0 && fread(buf, 1, size, src) != size) {
+    PyErr_SetString(comp_HeaderError, "Truncated header");
+    return -1;
+  }
 
-  if (validate_size((uint64_t)len, MAX_FILE_SIZE, "Input file size") != 0) {
-    fclose(f);
-    return NULL;
+  const unsigned char *p = buf;
+  if (header->flags & C_FLAG_DICTIONARY) {
+    ext->dict_id = get_le32(p);
+    p += C_DICT_ID_SIZE;
   }
+  if (header->flags & C_FLAG_CHECKSUM) {
+    ext->checksum = get_le64(p);
+    p += C_CHECKSUM_SIZE;
+  }
+  if (header->flags & C_FLAG_WINDOW_LOG)
+    ext->window_log = *p;
+  return 0;
+}
 
-  unsigned char *buffer = (unsigned char *)safe_malloc((size_t)len);
-  if (!buffer) {
-    fclose(f);
-    return NULL;
+// XXH64 of [0, size) of f, through a mapping when possible; pending output
+// on f must already be flushed. Leaves the stdio position unspecified.
+static int hash_file(FILE *f, uint64_t size, uint64_t *hash) {
+  XXH64State state;
+  xxh64_init(&state, 0);
+
+  IOBuffer in;
+  if (size <= SIZE_MAX && iobuf_map_input(f, (size_t)size, &in) == 0) {
+    COMP_BEGIN_ALLOW_THREADS
+
+        xxh64_update(&state, in.data, in.size);
+
+    COMP_END_ALLOW_THREADS
+
+        iobuf_release(&in);
+    *hash = xxh64_digest(&state);
+    return 0;
+  }
+
+  size_t chunk = io_chunk_size(); // reads when f cannot be mapped
+  unsigned char *buf = (unsigned char *)io_alloc(chunk);
+  if (!buf) {
+    PyErr_NoMemory();
+    return -1;
   }
 
-  size_t read = fread(buffer, 1, (size_t)len, f);
-  fclose(f);
+  uint64_t total = 0;
+  int err = fseeko(f, 0, SEEK_SET) != 0 ? -1 : 0;
+  COMP_BEGIN_ALLOW_THREADS
 
-  if (read != (size_t)len) {
-    free(buffer);
-    PyErr_SetString(PyExc_IOError, "Failed to read entire file");
-    return NULL;
+      while (!err && total < size) {
+    if (io_cancelled() != IO_CANCEL_NONE) {
+      err = -1;
+      break;
+    }
+    uint64_t left = size - total;
+    size_t want = left < chunk ? (size_t)left : chunk;
+    size_t nread = io_fread(buf, want, f);
+    xxh64_update(&state, buf, nread);
+    total += nread;
+    if (nread < want)
+      err = -1;
   }
 
-  *out_size = (size_t)len;
-  return buffer;
+  COMP_END_ALLOW_THREADS
+
+      io_free(buf);
+  if (err) {
+    PyErr_SetString(PyExc_IOError, "Failed to read file for checksum");
+    return -1;
+  }
+  *hash = xxh64_digest(&state);
+  return 0;
 }
 
-static int __attribute__((unused))
-write_memory_to_file(const char *path, const unsigned char *data, size_t size) {
-  FILE *f = fopen(path, "wb");
-  if (!f) {
-    PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+static int check_checksum(uint64_t actual, uint64_t expected) {
+  if (actual != expected) {
+    PyErr_SetString(comp_Error, "Checksum mismatch: data is corrupt");
     return -1;
   }
+  return 0;
+}
+
+// Streaming through a dictionary-bound stream state; only backends with
+// stream_new_dict get here
+static int compress_stream_dict(FILE *src, FILE *dst, const CBackend *backend,
+                                int level, const void *dict) {
+  void *state = backend->stream_new_dict(1, level, dict);
+  if (!state)
+    return -1;
 
-  size_t written = fwrite(data, 1, size, f);
-  int err = ferror(f);
-  fclose(f);
+  int err = stream_compress_fp(backend->stream_compress_step, state, src, dst);
+  backend->stream_free(state, 1);
+  return err;
+}
 
-  if (err || written != size) {
-    PyErr_SetString(PyExc_IOError, "Failed to write entire file");
+static int decompress_stream_dict(FILE *src, FILE *dst,
+                                  const CBackend *backend, const void *dict) {
+  void *state = backend->stream_new_dict(0, -1, dict);
+  if (!state)
     return -1;
-  }
 
-  return 0;
+  int err =
+      stream_decompress_fp(backend->stream_decompress_step, state, src, dst);
+  backend->stream_free(state, 0);
+  return err;
+}
+
+// Streaming with CodecParams applied, and back through a decoder whose
+// window limit is the header's; only backends with the params hooks get here
+static int compress_stream_params(FILE *src, FILE *dst,
+                                  const CBackend *backend, int level,
+                                  const CodecParams *params, int workers,
+                                  uint64_t size) {
+  void *state = backend->stream_new_params(level, params, workers, size);
+  if (!state)
+    return -1;
+
+  int err = stream_compress_fp(backend->stream_compress_step, state, src, dst);
+  backend->stream_free(state, 1);
+  return err;
+}
+
+static int decompress_stream_window(FILE *src, FILE *dst,
+                                    const CBackend *backend,
+                                    unsigned window_log) {
+  void *state = backend->stream_new_window(window_log);
+  if (!state)
+    return -1;
+
+  int err =
+      stream_decompress_fp(backend->stream_decompress_step, state, src, dst);
+  backend->stream_free(state, 0);
+  return err;
 }
 
 // ---- Public API ----
 
-int compress_file(const char *src_path, const char *dst_path, AlgoID algo,
-                  Strategy strategy, int level) {
+static int compress_file_to(const char *src_path, const char *dst_path,
+                            AlgoID algo, Strategy strategy, int level,
+                            const CompressOptions *opts) {
   init_backends();
 
-  const CBackend *backend = NULL;
+  static const CompressOptions default_opts = COMPRESS_OPTIONS_INIT;
+  if (!opts)
+    opts = &default_opts;
+
+  uint32_t block_size = opts->block_size ? opts->block_size
+                                         : C_DEFAULT_BLOCK_SIZE;
+  if (block_size < C_MIN_BLOCK_SIZE || block_size > C_MAX_BLOCK_SIZE) {
+    PyErr_Format(PyExc_ValueError,
+                 "block_size must be between %u and %u bytes",
+                 C_MIN_BLOCK_SIZE, C_MAX_BLOCK_SIZE);
+    return -1;
+  }
 
   int return_code = 0;
   FILE *src = NULL;
   FILE *dst = NULL;
+  StatsSpan stream_span = {0}; // a single stream's codec time
 
-  if (algo != ALGO_NONE) {
-    backend = find_backend_by_id(algo);
-    if (!backend) {
+  const CBackend *backend = resolve_compress_backend(algo, strategy);
+  if (!backend) {
+    return_code = -1;
+    goto done;
+  }
+
+  // STRAT_AUTO decides per block, so it always writes an indexed file; a
+  // dictionary is tied to one backend and cannot follow those choices
+  int adaptive = algo == ALGO_NONE && strategy == STRAT_AUTO;
+  if (adaptive && opts->dictionary) {
+    PyErr_SetString(PyExc_ValueError,
+                    "A dictionary needs an explicit algorithm or a fixed "
+                    "strategy, not 'auto'");
+    return_code = -1;
+    goto done;
+  }
+
+  // The tuning targets one long stream; blocks and dictionaries have their
+  // own fixed windows
+  int tuned = codec_params_set(&opts->params);
+  if (tuned) {
+    if (!backend->stream_new_params) {
+      PyErr_Format(PyExc_ValueError,
+                   "Backend '%s' takes no long_distance, window_log or "
+                   "match_strategy",
+                   backend->name);
+      return_code = -1;
+      goto done;
+    }
+    if (opts->seekable || adaptive || opts->dictionary) {
       PyErr_SetString(PyExc_ValueError,
-                      "Specified compression algorithm not available");
+                      "long_distance, window_log and match_strategy apply to "
+                      "single-stream files, not seekable, 'auto' or "
+                      "dictionary ones");
       return_code = -1;
       goto done;
     }
-  } else {
-    backend = choose_backend(strategy);
-    if (!backend) {
-      PyErr_SetString(comp_Error, "No available compression backend found");
+    if (backend->check_params(&opts->params) != 0) {
+      return_code = -1;
+      goto done;
+    }
+  }
+
+  const void *digest = NULL;
+  if (opts->dictionary) {
+    digest = dictionary_digest(opts->dictionary, backend, 1, level);
+    if (!digest) {
       return_code = -1;
       goto done;
     }
@@ -152,8 +1358,9 @@ int compress_file(const char *src_path, const char *dst_path, AlgoID algo,
     return_code = -1;
     goto done;
   }
+  io_advise_sequential(src);
 
-  dst = fopen(dst_path, "wb");
+  dst = fopen(dst_path, "w+b"); // update mode so the output can be mapped
   if (!dst) {
     PyErr_SetFromErrnoWithFilename(PyExc_OSError, dst_path);
     return_code = -1;
@@ -214,84 +1421,122 @@ int compress_file(const char *src_path, const char *dst_path, AlgoID algo,
 
 #endif
 
+  // Libraries with their own worker pool keep a single stream unless random
+  // access was asked for; everything else is block-split once there is more
+  // than one block's worth of input. The native pools take no dictionary,
+  // and a dictionary without a dictionary stream goes through blocks too. A
+  // sparse input is block-split as well, so its holes become index entries
+  // rather than compressed zeros.
+  int sparse = len > 0 && !tuned &&
+               io_next_hole(src, 0, (uint64_t)len) < (uint64_t)len;
+  int nthreads = threadpool_resolve_threads(opts->threads);
+  int use_native_mt = !opts->seekable && !adaptive && !digest && !sparse &&
+                      nthreads > 1 && backend->compress_stream_mt != NULL;
+  int use_blocks = opts->seekable || adaptive || sparse ||
+                   (digest && !backend->stream_new_dict) ||
+                   (nthreads > 1 && !use_native_mt && !tuned &&
+                    (uint64_t)len > block_size);
+
   CHeader header;
-  memcpy(header.magic, C_MAGIC, C_MAGIC_LEN);
-  header.version = 1;
-  header.algo = backend->id;
-  header.level = (uint8_t)((level >= 0 && level <= 254) ? level : 255);
-  header.flags = 0;
-  header.orig_size = (uint64_t)len;
-
-  if (fwrite(&header, 1, sizeof(header), dst) != sizeof(header) ||
-      ferror(dst)) {
+  init_header(&header, use_blocks ? C_VERSION_SEEKABLE : C_VERSION_STREAM,
+              backend, level, (uint64_t)len);
+  CHeaderExt ext = {digest ? opts->dictionary->id : 0, 0, 0};
+  if (digest)
+    header.flags |= C_FLAG_DICTIONARY;
+  if (opts->params.window_log) {
+    header.flags |= C_FLAG_WINDOW_LOG;
+    ext.window_log = (uint8_t)opts->params.window_log;
+  }
+  if (adaptive)
+    header.flags |= C_FLAG_BLOCK_ALGO;
+
+  // Blocks carry their own CRCs, so only a single stream needs the hash
+  if (opts->checksum && !use_blocks) {
+    if (hash_file(src, (uint64_t)len, &ext.checksum) != 0 ||
+        fseeko(src, 0, SEEK_SET) != 0) {
+      if (!PyErr_Occurred())
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, src_path);
+      return_code = -1;
+      goto done;
+    }
+    header.flags |= C_FLAG_CHECKSUM;
+  }
+
+  unsigned char header_buf[C_MAX_HEADER_SIZE];
+  size_t header_size = pack_header(&header, &ext, header_buf);
+
+  if (fwrite(header_buf, 1, header_size, dst) != header_size || ferror(dst)) {
     PyErr_SetString(comp_HeaderError, "Failed to write header to output file");
     return_code = -1;
     goto done;
   }
 
-  if (backend->compress_stream) {
-    return_code = backend->compress_stream(src, dst, level);
+  // Block and whole-buffer runs are timed per buffer call
+  uint8_t block_flags = 0;
+  if (!use_blocks && (digest || tuned || use_native_mt ||
+                      backend->compress_stream))
+    stats_span_begin(&stream_span);
+  if (use_blocks) {
+    return_code = compress_blocks_parallel(
+        src, dst, backend, adaptive, level, digest, header_size, (uint64_t)len,
+        block_size, nthreads, sparse, &block_flags);
+  } else if (digest) {
+    return_code = compress_stream_dict(src, dst, backend, level, digest);
     if (return_code != 0) {
-      set_backend_error(backend, "compression", "streaming compression");
-      goto done;
-    }
-  } else {
-    size_t input_size = (size_t)len;
-    unsigned char *input_buffer = (unsigned char *)safe_malloc(input_size);
-    if (!input_buffer) {
-      return_code = -1;
-      goto done;
-    }
-
-    size_t read = fread(input_buffer, 1, input_size, src);
-    if (read != input_size || ferror(src)) {
-      free(input_buffer);
-      PyErr_SetString(PyExc_IOError, "Failed to read input file");
-      return_code = -1;
+      set_backend_error(backend, "compression", "dictionary compression");
       goto done;
     }
-
-    size_t max_payload = backend->max_compressed_size(input_size);
-    if (max_payload == SIZE_MAX) {
-      free(input_buffer);
-      PyErr_SetString(PyExc_OverflowError,
-                      "Compressed size calculation overflow");
-      return_code = -1;
+  } else if (tuned) {
+    return_code = compress_stream_params(src, dst, backend, level,
+                                         &opts->params,
+                                         use_native_mt ? nthreads : 0,
+                                         (uint64_t)len);
+    if (return_code != 0) {
+      set_backend_error(backend, "compression", "tuned streaming compression");
       goto done;
     }
-
-    unsigned char *output_buffer = (unsigned char *)safe_malloc(max_payload);
-    if (!output_buffer) {
-      free(input_buffer);
-      return_code = -1;
+  } else if (use_native_mt) {
+    return_code =
+        backend->compress_stream_mt(src, dst, level, nthreads, (uint64_t)len);
+    if (return_code != 0) {
+      set_backend_error(backend, "compression",
+                        "multi-threaded streaming compression");
       goto done;
     }
-
-    size_t output_size = 0;
-    if (backend->compress_buffer(input_buffer, input_size, output_buffer,
-                                 &max_payload, level, &output_size) != 0) {
-      free(input_buffer);
-      free(output_buffer);
-      set_backend_error(backend, "compression", "buffer compression");
-      return_code = -1;
+  } else if (backend->compress_stream) {
+    return_code = backend->compress_stream(src, dst, level, (uint64_t)len);
+    if (return_code != 0) {
+      set_backend_error(backend, "compression", "streaming compression");
       goto done;
     }
+  } else {
+    return_code = compress_whole_buffer(src, dst, backend, level, NULL,
+                                        header_size, (uint64_t)len);
+  }
+  if (stream_span.active) {
+    off_t end = ftello(dst);
+    stats_codec_span(&stream_span, backend->id, 1, (uint64_t)len,
+                     end > (off_t)header_size ? (uint64_t)end - header_size
+                                              : 0);
+  }
 
-    free(input_buffer);
-
-    if (fwrite(output_buffer, 1, output_size, dst) != output_size ||
-        ferror(dst)) {
-      free(output_buffer);
-      PyErr_SetString(PyExc_IOError,
-                      "Failed to write compressed data to output file");
+  // Stored blocks and holes need flags the header must announce; a whole
+  // payload that did not shrink is replaced by the input
+  if (return_code == 0 && use_blocks && (block_flags & ~header.flags)) {
+    header.flags |= block_flags;
+    return_code = rewrite_header(dst, &header, &ext);
+  } else if (return_code == 0 && !use_blocks) {
+    off_t end = fseeko(dst, 0, SEEK_END) == 0 ? ftello(dst) : -1;
+    if (end < 0) {
+      PyErr_SetFromErrnoWithFilename(PyExc_OSError, dst_path);
       return_code = -1;
-      goto done;
+    } else if ((uint64_t)end - header_size >= (uint64_t)len) {
+      return_code = store_file_raw(src, dst, &header, &ext);
     }
-
-    free(output_buffer);
   }
 
 done:
+  stats_span_end(&stream_span); // a failed stream is not counted
   if (src)
     fclose(src);
   if (dst)
@@ -299,44 +1544,46 @@ done:
   return return_code;
 }
 
-int decompress_file(const char *src_path, const char *dst_path, AlgoID algo) {
+int compress_file(const char *src_path, const char *dst_path, AlgoID algo,
+                  Strategy strategy, int level, const CompressOptions *opts) {
+  StatsSpan span;
+  stats_span_begin(&span);
+  int rc = compress_file_to(src_path, dst_path, algo, strategy, level, opts);
+  stats_file_span(&span, FORMAT_COMPRESSO, 1, src_path, dst_path, rc != 0);
+  return rc;
+}
+
+// decompress_file once the format is known; *format is left as detected
+static int decompress_file_as(const char *src_path, const char *dst_path,
+                              AlgoID algo, int threads, CDictionary *dict,
+                              Format *format_out) {
   init_backends();
 
-  Format format = detect_format_from_path(src_path);
-  if (format == FORMAT_UNKNOWN) {
-    PyErr_SetString(comp_Error, "Unknown or unsupported format");
+  // The magic is read through the handle that then decodes a compresso
+  // file, so the common case opens the input once
+  FILE *src = fopen(src_path, "rb");
+  if (!src) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, src_path);
     return -1;
   }
 
-  if (format == FORMAT_GZIP || format == FORMAT_BZIP2 || format == FORMAT_XZ ||
-      format == FORMAT_ZSTD || format == FORMAT_LZ4) {
-    const StandaloneFormat *standalone = NULL;
-
-    switch (format) {
-    case FORMAT_GZIP:
-      standalone = get_gzip_format();
-      break;
-    case FORMAT_BZIP2:
-      standalone = get_bzip2_format();
-      break;
-    case FORMAT_XZ:
-      standalone = get_xz_format();
-      break;
-    case FORMAT_ZSTD:
-      standalone = get_zstd_format();
-      break;
-    case FORMAT_LZ4:
-      standalone = get_lz4_format();
-      break;
-    default:
-      break;
-    }
+  Format format = detect_format_from_fd(fileno(src));
+  if (format == FORMAT_UNKNOWN)
+    format = detect_format_from_extension(src_path);
+  *format_out = format;
+  if (format == FORMAT_COMPRESSO) {
+    return decompress_compresso_file(src, src_path, dst_path, algo, threads,
+                                     dict);
+  }
+  fclose(src);
 
-    if (!standalone) {
-      PyErr_SetString(comp_Error, "Standalone format backend not available");
-      return -1;
-    }
+  if (format == FORMAT_UNKNOWN) {
+    PyErr_SetString(comp_Error, "Unknown or unsupported format");
+    return -1;
+  }
 
+  const StandaloneFormat *standalone = find_standalone_format(format);
+  if (standalone) {
     return standalone->decompress_file(src_path, dst_path);
   }
 
@@ -346,83 +1593,154 @@ int decompress_file(const char *src_path, const char *dst_path, AlgoID algo) {
     return -1;
   }
 
-  if (format == FORMAT_COMPRESSO) {
-    return decompress_compresso_file(src_path, dst_path, algo);
-  }
-
   PyErr_Format(comp_Error, "Unknown or unsupported format: %s",
                format_name_string(format));
   return -1;
 }
 
-static int decompress_compresso_file(const char *src_path, const char *dst_path,
-                                     AlgoID algo) {
-  init_backends();
+int decompress_file(const char *src_path, const char *dst_path, AlgoID algo,
+                    int threads, CDictionary *dict) {
+  Format format = FORMAT_UNKNOWN;
+  StatsSpan span;
+  stats_span_begin(&span);
+  int rc =
+      decompress_file_as(src_path, dst_path, algo, threads, dict, &format);
+  stats_file_span(&span, format, 0, src_path, dst_path, rc != 0);
+  return rc;
+}
 
-  int return_code = 0;
-  FILE *src = NULL;
-  FILE *dst = NULL;
+// Reads and validates a file's header and extension fields, leaving src at
+// the payload; returns the backend to decode with (algo overrides the
+// header's unless the payload is stored) and its dictionary in *digest
+static const CBackend *read_file_header(FILE *src, AlgoID algo,
+                                        CDictionary *dict, CHeader *header,
+                                        CHeaderExt *ext, const void **digest) {
+  if (fread(header, 1, sizeof(*header), src) != sizeof(*header)) {
+    PyErr_SetString(comp_HeaderError, "Failed to read header from input file");
+    return NULL;
+  }
 
-  src = fopen(src_path, "rb");
-  if (!src) {
-    PyErr_SetFromErrnoWithFilename(PyExc_OSError, src_path);
-    return_code = -1;
-    goto done;
+  if (memcmp(header->magic, C_MAGIC, C_MAGIC_LEN) != 0) {
+    PyErr_SetString(comp_HeaderError, "Invalid file magic number");
+    return NULL;
   }
 
-  dst = fopen(dst_path, "wb");
-  if (!dst) {
-    PyErr_SetFromErrnoWithFilename(PyExc_OSError, dst_path);
-    return_code = -1;
-    goto done;
+  if (header->version != C_VERSION_STREAM &&
+      header->version != C_VERSION_SEEKABLE) {
+    PyErr_SetString(comp_HeaderError, "Unsupported file version");
+    return NULL;
   }
 
-  CHeader header;
-  if (fread(&header, 1, sizeof(header), src) != sizeof(header)) {
-    PyErr_SetString(comp_HeaderError, "Failed to read header from input file");
-    return_code = -1;
-    goto done;
+  if (read_header_fields(src, header, ext) != 0) {
+    return NULL;
+  }
+
+  const CBackend *backend = NULL;
+
+  // A stored payload is raw whatever the caller expects
+  if (algo != ALGO_NONE && header->algo != ALGO_NONE) {
+    backend = find_backend_by_id(algo);
+    if (!backend) {
+      PyErr_SetString(comp_BackendError,
+                      "Specified compression algorithm not available");
+      return NULL;
+    }
+  } else {
+    backend = find_backend_by_id(header->algo);
+    if (!backend) {
+      PyErr_SetString(comp_HeaderError,
+                      "Compression algorithm from file not available");
+      return NULL;
+    }
+  }
+
+  if (validate_size(header->orig_size, MAX_DECOMPRESSED_SIZE,
+                    "Original file size in header") != 0) {
+    return NULL;
+  }
+
+  if (dictionary_for_header(dict, backend, header->flags, ext->dict_id,
+                            digest) != 0) {
+    return NULL;
   }
+  return backend;
+}
+
+// Decodes from src, which is at the start of the file and is closed here;
+// src_path names it in errors
+static int decompress_compresso_file(FILE *src, const char *src_path,
+                                     const char *dst_path, AlgoID algo,
+                                     int threads, CDictionary *dict) {
+  init_backends();
 
-  if (memcmp(header.magic, C_MAGIC, C_MAGIC_LEN) != 0) {
-    PyErr_SetString(comp_HeaderError, "Invalid file magic number");
+  int return_code = 0;
+  FILE *dst = NULL;
+  StatsSpan stream_span = {0}; // a single stream's codec time
+
+  io_advise_sequential(src);
+
+  dst = fopen(dst_path, "w+b"); // update mode so the output can be mapped
+  if (!dst) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, dst_path);
     return_code = -1;
     goto done;
   }
 
-  if (header.version != 1) {
-    PyErr_SetString(comp_HeaderError, "Unsupported file version");
+  CHeader header;
+  CHeaderExt ext;
+  const void *digest = NULL;
+  const CBackend *backend =
+      read_file_header(src, algo, dict, &header, &ext, &digest);
+  if (!backend) {
     return_code = -1;
     goto done;
   }
+  size_t header_size = c_header_size(header.flags);
+  uint64_t orig_size = header.orig_size;
 
-  const CBackend *backend = NULL;
-
-  if (algo != ALGO_NONE) {
-    backend = find_backend_by_id(algo);
-    if (!backend) {
-      PyErr_SetString(comp_BackendError,
-                      "Specified compression algorithm not available");
+  // A payload small enough for the backend is decoded in one call into an
+  // output of exactly orig_size; the whole-buffer path below does that
+  int one_shot = !digest && orig_size > 0 && orig_size <= backend->one_shot_max;
+
+  // Block and whole-buffer runs are timed per buffer call
+  if (header.version != C_VERSION_SEEKABLE &&
+      (((header.flags & C_FLAG_WINDOW_LOG) && !one_shot) ||
+       (digest && backend->stream_new_dict) ||
+       (backend->decompress_stream && !digest && !one_shot)))
+    stats_span_begin(&stream_span);
+  if (header.version == C_VERSION_SEEKABLE) {
+    CBlockIndexEntry *entries = NULL;
+    CTrailer trailer;
+    if (read_block_index(src, src_path, backend, header.flags, orig_size,
+                         header_size, &entries, &trailer) != 0) {
       return_code = -1;
       goto done;
     }
-  } else {
-    backend = find_backend_by_id(header.algo);
-    if (!backend) {
-      PyErr_SetString(comp_HeaderError,
-                      "Compression algorithm from file not available");
+    return_code = decode_blocks(src, digest, entries, &trailer, 0,
+                                trailer.block_count,
+                                threadpool_resolve_threads(threads),
+                                file_block_sink, dst);
+    free(entries);
+    if (return_code == 0 && io_sparse_finish(dst) != 0) {
+      PyErr_SetFromErrnoWithFilename(PyExc_OSError, dst_path);
       return_code = -1;
+    }
+  } else if ((header.flags & C_FLAG_WINDOW_LOG) && !one_shot) {
+    return_code = backend->stream_new_window && !digest
+                      ? decompress_stream_window(src, dst, backend,
+                                                 ext.window_log)
+                      : -1;
+    if (return_code != 0) {
+      set_backend_error(backend, "decompression", "windowed decompression");
       goto done;
     }
-  }
-  uint64_t orig_size = header.orig_size;
-  if (validate_size(orig_size, MAX_DECOMPRESSED_SIZE,
-                    "Original file size in header") != 0) {
-    return_code = -1;
-    goto done;
-  }
-
-  if (backend->decompress_stream) {
+  } else if (digest && backend->stream_new_dict) {
+    return_code = decompress_stream_dict(src, dst, backend, digest);
+    if (return_code != 0) {
+      set_backend_error(backend, "decompression", "dictionary decompression");
+      goto done;
+    }
+  } else if (backend->decompress_stream && !digest && !one_shot) {
     return_code = backend->decompress_stream(src, dst, orig_size);
     if (return_code != 0) {
       set_backend_error(backend, "decompression", "streaming decompression");
@@ -445,7 +1763,7 @@ static int decompress_compresso_file(const char *src_path, const char *dst_path,
       goto done;
     }
 
-    __int64 payload_start = (__int64)sizeof(CHeader);
+    __int64 payload_start = (__int64)header_size;
     __int64 payload_len = end_pos - payload_start;
     if (payload_len <= 0) {
       PyErr_SetString(PyExc_ValueError, "No compressed data found in file");
@@ -480,7 +1798,7 @@ static int decompress_compresso_file(const char *src_path, const char *dst_path,
       goto done;
     }
 
-    off_t payload_start = (off_t)sizeof(CHeader);
+    off_t payload_start = (off_t)header_size;
     off_t payload_len = end_pos - payload_start;
     if (payload_len <= 0) {
       PyErr_SetString(PyExc_ValueError, "No compressed data found in file");
@@ -502,83 +1820,586 @@ static int decompress_compresso_file(const char *src_path, const char *dst_path,
 
 #endif
 
-    if (payload_len > (long)SIZE_MAX) {
+    if ((uint64_t)payload_len > SIZE_MAX) {
       PyErr_SetString(PyExc_MemoryError,
                       "Compressed data too large to fit in memory");
       return_code = -1;
       goto done;
     }
 
-    size_t comp_size = (size_t)payload_len;
-    unsigned char *comp_buffer = (unsigned char *)safe_malloc(comp_size);
-    if (!comp_buffer) {
+    return_code = decompress_whole_buffer(src, dst, backend, digest,
+                                          (size_t)end_pos, header_size,
+                                          orig_size);
+  }
+  if (stream_span.active) {
+    off_t consumed = ftello(src);
+    off_t produced = ftello(dst);
+    stats_codec_span(&stream_span, backend->id, 0,
+                     consumed > (off_t)header_size
+                         ? (uint64_t)consumed - header_size
+                         : 0,
+                     produced > 0 ? (uint64_t)produced : 0);
+  }
+
+  // Stream decoders stop where the payload does; the header says where
+  // that must be
+  if (return_code == 0 && header.version == C_VERSION_STREAM) {
+    off_t end = fflush(dst) == 0 ? ftello(dst) : -1;
+    if (end < 0) {
+      PyErr_SetFromErrnoWithFilename(PyExc_OSError, dst_path);
       return_code = -1;
-      goto done;
-    }
-    size_t read = fread(comp_buffer, 1, comp_size, src);
-    if (read != comp_size || ferror(src)) {
-      free(comp_buffer);
-      PyErr_SetString(PyExc_IOError,
-                      "Failed to read compressed data from input file");
+    } else if ((uint64_t)end != orig_size) {
+      PyErr_Format(comp_Error,
+                   "Size mismatch: %llu bytes decoded, header says %llu",
+                   (unsigned long long)end, (unsigned long long)orig_size);
       return_code = -1;
-      goto done;
     }
+  }
 
-    size_t output_capacity;
-    if (backend->id == ALGO_SNAPPY) {
-      output_capacity = snappy_decompressed_size(comp_buffer, comp_size);
-      if (output_capacity == 0) {
-        free(comp_buffer);
-        PyErr_SetString(PyExc_RuntimeError,
-                        "Failed to determine decompressed size for Snappy");
-        return_code = -1;
-        goto done;
-      }
-    } else {
-      if (validate_size(orig_size, SIZE_MAX, "Original size") != 0) {
-        free(comp_buffer);
-        return_code = -1;
-        goto done;
-      }
-      output_capacity = (size_t)orig_size;
-    }
-    unsigned char *output_buffer =
-        (unsigned char *)safe_malloc(output_capacity);
-    if (!output_buffer) {
-      free(comp_buffer);
+  if (return_code == 0 && (header.flags & C_FLAG_CHECKSUM)) {
+    uint64_t actual = 0;
+    if (fflush(dst) != 0 || hash_file(dst, orig_size, &actual) != 0 ||
+        fseeko(dst, 0, SEEK_END) != 0) {
+      if (!PyErr_Occurred())
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, dst_path);
       return_code = -1;
-      goto done;
+    } else {
+      return_code = check_checksum(actual, ext.checksum);
     }
+  }
 
-    size_t output_size = 0;
-    if (backend->decompress_buffer(comp_buffer, comp_size, output_buffer,
-                                   &output_capacity, &output_size) != 0 ||
-        output_size != (size_t)orig_size) {
-      free(comp_buffer);
-      free(output_buffer);
-      set_backend_error(backend, "decompression", "buffer decompression");
-      return_code = -1;
-      goto done;
-    }
+done:
+  stats_span_end(&stream_span); // a failed stream is not counted
+  if (src)
+    fclose(src);
+  if (dst)
+    fclose(dst);
+  return return_code;
+}
 
-    free(comp_buffer);
+PyObject *decompress_range(const char *src_path, uint64_t offset,
+                           uint64_t length, int threads, CDictionary *dict) {
+  init_backends();
 
-    if (fwrite(output_buffer, 1, output_size, dst) != output_size ||
-        ferror(dst)) {
-      free(output_buffer);
-      PyErr_SetString(PyExc_IOError,
-                      "Failed to write decompressed data to output file");
-      return_code = -1;
+  PyObject *result = NULL;
+  CBlockIndexEntry *entries = NULL;
+
+  FILE *src = fopen(src_path, "rb");
+  if (!src) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, src_path);
+    return NULL;
+  }
+
+  CHeader header;
+  if (fread(&header, 1, sizeof(header), src) != sizeof(header) ||
+      memcmp(header.magic, C_MAGIC, C_MAGIC_LEN) != 0) {
+    PyErr_SetString(comp_HeaderError, "Not a Compresso file");
+    goto done;
+  }
+
+  if (header.version != C_VERSION_SEEKABLE) {
+    PyErr_SetString(comp_Error, "File has no block index; recompress it with "
+                                "seekable=True for random access");
+    goto done;
+  }
+
+  CHeaderExt ext;
+  if (read_header_fields(src, &header, &ext) != 0) {
+    goto done;
+  }
+
+  const CBackend *backend = find_backend_by_id(header.algo);
+  if (!backend) {
+    PyErr_SetString(comp_HeaderError,
+                    "Compression algorithm from file not available");
+    goto done;
+  }
+
+  if (validate_size(header.orig_size, MAX_DECOMPRESSED_SIZE,
+                    "Original file size in header") != 0) {
+    goto done;
+  }
+
+  const void *digest = NULL;
+  if (dictionary_for_header(dict, backend, header.flags, ext.dict_id,
+                            &digest) != 0) {
+    goto done;
+  }
+
+  CTrailer trailer;
+  if (read_block_index(src, src_path, backend, header.flags,
+                       header.orig_size, c_header_size(header.flags),
+                       &entries, &trailer) != 0) {
+    goto done;
+  }
+
+  // Clamp like a slice: data[offset:offset + length]
+  uint64_t start = offset < header.orig_size ? offset : header.orig_size;
+  uint64_t end = length < header.orig_size - start ? start + length
+                                                   : header.orig_size;
+
+  result = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)(end - start));
+  if (!result || end == start) {
+    goto done;
+  }
+
+  RangeSink range = {(unsigned char *)PyBytes_AS_STRING(result), start, end};
+  uint64_t first = start / trailer.block_size;
+  uint64_t last = (end - 1) / trailer.block_size + 1;
+
+  if (decode_blocks(src, digest, entries, &trailer, first, last,
+                    threadpool_resolve_threads(threads), range_block_sink,
+                    &range) != 0) {
+    Py_CLEAR(result);
+  }
+
+done:
+  free(entries);
+  fclose(src);
+  return result;
+}
+
+// Output side of verify_file's single-stream pass
+typedef struct {
+  uint64_t size;
+  XXH64State hash;
+  int hashed; // only files with C_FLAG_CHECKSUM pay for the hash
+} VerifySink;
+
+static int verify_stream_sink(void *ctx, const unsigned char *data,
+                              size_t size) {
+  VerifySink *v = (VerifySink *)ctx;
+  v->size += size;
+  if (v->hashed)
+    xxh64_update(&v->hash, data, size);
+  return 0;
+}
+
+int verify_file(const char *src_path, int threads, CDictionary *dict) {
+  init_backends();
+
+  FILE *src = fopen(src_path, "rb");
+  if (!src) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, src_path);
+    return -1;
+  }
+  io_advise_sequential(src);
+
+  int return_code = -1;
+  CHeader header;
+  CHeaderExt ext;
+  const void *digest = NULL;
+  const CBackend *backend =
+      read_file_header(src, ALGO_NONE, dict, &header, &ext, &digest);
+  if (!backend) {
+    goto done;
+  }
+
+  if (header.version == C_VERSION_SEEKABLE) {
+    CBlockIndexEntry *entries = NULL;
+    CTrailer trailer;
+    if (read_block_index(src, src_path, backend, header.flags,
+                         header.orig_size, c_header_size(header.flags),
+                         &entries, &trailer) != 0) {
       goto done;
     }
+    return_code = decode_blocks(src, digest, entries, &trailer, 0,
+                                trailer.block_count,
+                                threadpool_resolve_threads(threads),
+                                discard_block_sink, NULL);
+    free(entries);
+    goto done;
+  }
+
+  // Every backend's stream format is its steps' format, so one pass over
+  // them checks any version 1 payload
+  void *state = NULL;
+  if (header.flags & C_FLAG_WINDOW_LOG)
+    state = backend->stream_new_window && !digest
+                ? backend->stream_new_window(ext.window_log)
+                : NULL;
+  else if (digest)
+    state = backend->stream_new_dict ? backend->stream_new_dict(0, -1, digest)
+                                     : NULL;
+  else
+    state = backend->stream_new(0, -1);
+  if (!state) {
+    set_backend_error(backend, "decompression", "verification stream");
+    goto done;
+  }
 
-    free(output_buffer);
+  VerifySink sink = {0};
+  sink.hashed = (header.flags & C_FLAG_CHECKSUM) != 0;
+  xxh64_init(&sink.hash, 0);
+  int err = stream_decompress_sink(backend->stream_decompress_step, state, src,
+                                   verify_stream_sink, &sink);
+  backend->stream_free(state, 0);
+
+  if (err != 0) {
+    set_backend_error(backend, "decompression", "streaming decompression");
+  } else if (sink.size != header.orig_size) {
+    PyErr_Format(comp_Error,
+                 "Size mismatch: %llu bytes decoded, header says %llu",
+                 (unsigned long long)sink.size,
+                 (unsigned long long)header.orig_size);
+  } else if (!sink.hashed ||
+             check_checksum(xxh64_digest(&sink.hash), ext.checksum) == 0) {
+    return_code = 0;
   }
 
 done:
-  if (src)
-    fclose(src);
-  if (dst)
-    fclose(dst);
+  fclose(src);
   return return_code;
 }
+
+// ---- In-Memory API ----
+
+// compress_bytes/compress_into produce the same bytes a version 1 file
+// would hold, so frames and files are interchangeable. The backends release
+// the GIL around the codec calls; callers keep the Py_buffer exports alive.
+// A NULL ctx uses the calling thread's cached context.
+
+// The bound leaves room for a dictionary ID whether or not one is written
+static size_t frame_bound(const CBackend *backend, size_t input_size) {
+  size_t header_max = sizeof(CHeader) + C_DICT_ID_SIZE;
+  size_t max_payload = backend->max_compressed_size(input_size);
+  if (max_payload == SIZE_MAX || max_payload > SIZE_MAX - header_max) {
+    PyErr_SetString(PyExc_OverflowError, "Compressed size calculation overflow");
+    return 0;
+  }
+  return header_max + max_payload;
+}
+
+// Writes header + payload into output; returns the frame size, or 0 with an
+// exception set
+static size_t compress_frame(const CBackend *backend, CodecContext *ctx,
+                             int level, CDictionary *dict,
+                             const unsigned char *input, size_t input_size,
+                             unsigned char *output, size_t output_capacity) {
+  const void *digest = NULL;
+  if (dict) {
+    digest = dictionary_digest(dict, backend, 1, level);
+    if (!digest)
+      return 0;
+  }
+
+  CHeader header;
+  init_header(&header, C_VERSION_STREAM, backend, level, (uint64_t)input_size);
+  if (digest)
+    header.flags |= C_FLAG_DICTIONARY;
+
+  size_t header_size = c_header_size(header.flags);
+  if (output_capacity < header_size) {
+    PyErr_Format(PyExc_ValueError,
+                 "Output buffer too small (need at least %zu bytes)",
+                 header_size);
+    return 0;
+  }
+  CHeaderExt ext = {digest ? dict->id : 0, 0, 0};
+  pack_header(&header, &ext, output);
+
+  size_t capacity = output_capacity - header_size;
+  size_t payload_size = 0;
+  if (codec_compress_buffer(backend, ctx, digest, input, input_size,
+                            output + header_size, &capacity, level,
+                            &payload_size) != 0) {
+    set_backend_error(backend, "compression", "buffer compression");
+    return 0;
+  }
+
+  if (payload_size >= input_size) { // did not shrink: store the input
+    init_header(&header, C_VERSION_STREAM, find_backend_by_id(ALGO_NONE),
+                level, (uint64_t)input_size);
+    pack_header(&header, &ext, output);
+    memcpy(output + sizeof(CHeader), input, input_size);
+    return sizeof(CHeader) + input_size;
+  }
+
+  return header_size + payload_size;
+}
+
+// Validates a frame and picks its backend; *payload/*payload_size describe
+// the compressed data after the header, *digest the dictionary it needs and
+// *checksum the stored XXH64 of the original data (NULL without one)
+static const CBackend *parse_frame(const unsigned char *input,
+                                   size_t input_size, AlgoID algo,
+                                   CDictionary *dict, uint64_t *orig_size,
+                                   const void **digest,
+                                   const unsigned char **checksum,
+                                   const unsigned char **payload,
+                                   size_t *payload_size) {
+  CHeader header;
+  if (input_size < sizeof(header)) {
+    PyErr_SetString(comp_HeaderError, "Input is too short for a header");
+    return NULL;
+  }
+  memcpy(&header, input, sizeof(header));
+
+  if (memcmp(header.magic, C_MAGIC, C_MAGIC_LEN) != 0) {
+    PyErr_SetString(comp_HeaderError, "Invalid file magic number");
+    return NULL;
+  }
+
+  if (header.version == C_VERSION_SEEKABLE) {
+    PyErr_SetString(comp_Error, "Seekable data must be decompressed from a "
+                                "file with decompress_file");
+    return NULL;
+  }
+
+  if (header.version != C_VERSION_STREAM) {
+    PyErr_SetString(comp_HeaderError, "Unsupported file version");
+    return NULL;
+  }
+
+  if (header.flags & ~header_flags_allowed(C_VERSION_STREAM)) {
+    PyErr_Format(comp_HeaderError, "Unsupported header flags: 0x%02x",
+                 header.flags);
+    return NULL;
+  }
+
+  size_t header_size = c_header_size(header.flags);
+  if (input_size < header_size) {
+    PyErr_SetString(comp_HeaderError, "Truncated header");
+    return NULL;
+  }
+  uint32_t dict_id = (header.flags & C_FLAG_DICTIONARY)
+                         ? get_le32(input + sizeof(CHeader))
+                         : 0;
+  *checksum = (header.flags & C_FLAG_CHECKSUM)
+                  ? input + sizeof(CHeader) +
+                        ((header.flags & C_FLAG_DICTIONARY) ? C_DICT_ID_SIZE
+                                                            : 0)
+                  : NULL;
+
+  // A stored payload is raw whatever the caller expects
+  if (header.algo == ALGO_NONE)
+    algo = ALGO_NONE;
+  const CBackend *backend =
+      find_backend_by_id(algo != ALGO_NONE ? (uint8_t)algo : header.algo);
+  if (!backend) {
+    PyErr_SetString(algo != ALGO_NONE ? comp_BackendError : comp_HeaderError,
+                    algo != ALGO_NONE
+                        ? "Specified compression algorithm not available"
+                        : "Compression algorithm from file not available");
+    return NULL;
+  }
+
+  if (validate_size(header.orig_size, MAX_DECOMPRESSED_SIZE,
+                    "Original size in header") != 0 ||
+      validate_size(header.orig_size, SIZE_MAX, "Original size") != 0) {
+    return NULL;
+  }
+
+  if (dictionary_for_header(dict, backend, header.flags, dict_id, digest) !=
+      0) {
+    return NULL;
+  }
+
+  *orig_size = header.orig_size;
+  *payload = input + header_size;
+  *payload_size = input_size - header_size;
+  return backend;
+}
+
+static int decode_frame_payload(const CBackend *backend, CodecContext *ctx,
+                                const void *digest,
+                                const unsigned char *payload,
+                                size_t payload_size, uint64_t orig_size,
+                                unsigned char *output) {
+  if (backend->id == ALGO_SNAPPY &&
+      snappy_decompressed_size(payload, payload_size) != (size_t)orig_size) {
+    PyErr_SetString(PyExc_RuntimeError,
+                    "Failed to determine decompressed size for Snappy");
+    return -1;
+  }
+
+  if (backend->id == ALGO_NONE) { // copied as-is; ctx stays bound
+    if (payload_size != (size_t)orig_size) {
+      set_backend_error(backend, "decompression", "stored size mismatch");
+      return -1;
+    }
+    memcpy(output, payload, payload_size);
+    return 0;
+  }
+
+  size_t capacity = (size_t)orig_size;
+  size_t output_size = 0;
+  if (codec_decompress_buffer(backend, ctx, digest, payload, payload_size,
+                              output, &capacity, &output_size) != 0 ||
+      output_size != (size_t)orig_size) {
+    set_backend_error(backend, "decompression", "buffer decompression");
+    return -1;
+  }
+  return 0;
+}
+
+// Decodes the payload into output (orig_size bytes), then checks it
+// against the frame's checksum if it has one
+static int decompress_frame_payload(const CBackend *backend,
+                                    CodecContext *ctx, const void *digest,
+                                    const unsigned char *checksum,
+                                    const unsigned char *payload,
+                                    size_t payload_size, uint64_t orig_size,
+                                    unsigned char *output) {
+  if (decode_frame_payload(backend, ctx, digest, payload, payload_size,
+                           orig_size, output) != 0) {
+    return -1;
+  }
+  if (!checksum)
+    return 0;
+
+  uint64_t actual;
+  COMP_BEGIN_ALLOW_THREADS
+
+      actual = xxh64(output, (size_t)orig_size, 0);
+
+  COMP_END_ALLOW_THREADS
+
+      return check_checksum(actual, get_le64(checksum));
+}
+
+PyObject *compress_bytes(const unsigned char *input, size_t input_size,
+                         AlgoID algo, Strategy strategy, int level,
+                         CDictionary *dict, CodecContext *ctx) {
+  init_backends();
+
+  if (validate_size((uint64_t)input_size, MAX_FILE_SIZE, "Input size") != 0) {
+    return NULL;
+  }
+
+  const CBackend *backend = resolve_compress_backend(algo, strategy);
+  if (!backend) {
+    return NULL;
+  }
+
+  size_t bound = frame_bound(backend, input_size);
+  if (bound == 0 || bound > PY_SSIZE_T_MAX) {
+    if (!PyErr_Occurred())
+      PyErr_SetString(PyExc_OverflowError, "Compressed output is too large");
+    return NULL;
+  }
+
+  PyObject *result = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)bound);
+  if (!result) {
+    return NULL;
+  }
+
+  size_t frame_size =
+      compress_frame(backend, ctx, level, dict, input, input_size,
+                     (unsigned char *)PyBytes_AS_STRING(result), bound);
+  if (frame_size == 0 || _PyBytes_Resize(&result, (Py_ssize_t)frame_size) != 0) {
+    Py_XDECREF(result);
+    return NULL;
+  }
+  return result;
+}
+
+size_t compress_bound(size_t input_size, AlgoID algo, Strategy strategy) {
+  init_backends();
+
+  const CBackend *backend = resolve_compress_backend(algo, strategy);
+  if (!backend) {
+    return 0;
+  }
+  return frame_bound(backend, input_size);
+}
+
+Py_ssize_t compress_into(const unsigned char *input, size_t input_size,
+                         unsigned char *output, size_t output_capacity,
+                         AlgoID algo, Strategy strategy, int level,
+                         CDictionary *dict, CodecContext *ctx) {
+  init_backends();
+
+  if (validate_size((uint64_t)input_size, MAX_FILE_SIZE, "Input size") != 0) {
+    return -1;
+  }
+
+  const CBackend *backend = resolve_compress_backend(algo, strategy);
+  if (!backend) {
+    return -1;
+  }
+
+  size_t frame_size =
+      compress_frame(backend, ctx, level, dict, input, input_size, output,
+                     output_capacity);
+  if (frame_size == 0) {
+    // A full buffer looks like a codec failure; report the size that works
+    size_t bound = frame_bound(backend, input_size);
+    if (bound != 0 && output_capacity < bound && !PyErr_Occurred()) {
+      PyErr_Format(PyExc_ValueError,
+                   "Output buffer too small (%zu bytes; %zu bytes always "
+                   "suffice)",
+                   output_capacity, bound);
+    }
+    return -1;
+  }
+  return (Py_ssize_t)frame_size;
+}
+
+PyObject *decompress_bytes(const unsigned char *input, size_t input_size,
+                           AlgoID algo, CDictionary *dict, CodecContext *ctx) {
+  init_backends();
+
+  uint64_t orig_size = 0;
+  const unsigned char *payload = NULL;
+  size_t payload_size = 0;
+  const void *digest = NULL;
+  const unsigned char *checksum = NULL;
+  const CBackend *backend =
+      parse_frame(input, input_size, algo, dict, &orig_size, &digest,
+                  &checksum, &payload, &payload_size);
+  if (!backend) {
+    return NULL;
+  }
+
+  if (orig_size > PY_SSIZE_T_MAX) {
+    PyErr_SetString(PyExc_OverflowError, "Decompressed output is too large");
+    return NULL;
+  }
+
+  PyObject *result = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)orig_size);
+  if (!result) {
+    return NULL;
+  }
+
+  if (decompress_frame_payload(backend, ctx, digest, checksum, payload,
+                               payload_size, orig_size,
+                               (unsigned char *)PyBytes_AS_STRING(result)) !=
+      0) {
+    Py_DECREF(result);
+    return NULL;
+  }
+  return result;
+}
+
+Py_ssize_t decompress_into(const unsigned char *input, size_t input_size,
+                           unsigned char *output, size_t output_capacity,
+                           AlgoID algo, CDictionary *dict,
+                           CodecContext *ctx) {
+  init_backends();
+
+  uint64_t orig_size = 0;
+  const unsigned char *payload = NULL;
+  size_t payload_size = 0;
+  const void *digest = NULL;
+  const unsigned char *checksum = NULL;
+  const CBackend *backend =
+      parse_frame(input, input_size, algo, dict, &orig_size, &digest,
+                  &checksum, &payload, &payload_size);
+  if (!backend) {
+    return -1;
+  }
+
+  if (orig_size > output_capacity) {
+    PyErr_Format(PyExc_ValueError,
+                 "Output buffer too small (%zu bytes; need %llu bytes)",
+                 output_capacity, (unsigned long long)orig_size);
+    return -1;
+  }
+
+  if (decompress_frame_payload(backend, ctx, digest, checksum, payload,
+                               payload_size, orig_size, output) != 0) {
+    return -1;
+  }
+  return (Py_ssize_t)orig_size;
+}
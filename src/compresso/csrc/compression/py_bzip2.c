@@ -1,8 +1,9 @@
 #define PY_SSIZE_T_CLEAN
-#define BZIP2_CHUNK 65536 // 64KB
 #include "../common.h"
 #include <Python.h>
 #include <bzlib.h>
+#include <limits.h>
+#include <stdlib.h>
 
 static int bzip2_is_available(void) {
   return 1; // bzip2 is always available if this code is compiled
@@ -43,11 +44,11 @@ static int bzip2_compress_buffer(const unsigned char *input, size_t input_size,
   unsigned int dest_len = (unsigned int)(*output_capacity);
   int ret;
 
-  Py_BEGIN_ALLOW_THREADS ret = BZ2_bzBuffToBuffCompress(
+  COMP_BEGIN_ALLOW_THREADS ret = BZ2_bzBuffToBuffCompress(
       (char *)output, &dest_len, (char *)input, (unsigned int)input_size,
       blockSize100k, 0, 30 // verbosity and workFactor (recommended default)
   );
-  Py_END_ALLOW_THREADS
+  COMP_END_ALLOW_THREADS
 
       if (ret != BZ_OK) {
     return -1; // compression failed
@@ -64,11 +65,11 @@ static int bzip2_decompress_buffer(const unsigned char *input,
   unsigned int dest_len = (unsigned int)(*output_capacity);
   int ret;
 
-  Py_BEGIN_ALLOW_THREADS ret = BZ2_bzBuffToBuffDecompress(
+  COMP_BEGIN_ALLOW_THREADS ret = BZ2_bzBuffToBuffDecompress(
       (char *)output, &dest_len, (char *)input, (unsigned int)input_size, 0,
       0 // small and verbosity flags
   );
-  Py_END_ALLOW_THREADS
+  COMP_END_ALLOW_THREADS
 
       if (ret != BZ_OK) {
     return -1; // decompression failed
@@ -78,93 +79,135 @@ static int bzip2_decompress_buffer(const unsigned char *input,
   return 0; // success
 }
 
-// ---- Stream Compression/Decompression ----
+// ---- Memory Streaming ----
+
+typedef struct {
+  bz_stream strm;
+  int ended; // decompression: stream end seen, trailing data is ignored
+} Bzip2Stream;
+
+static void *bzip2_stream_new(int compress, int level) {
+  Bzip2Stream *bs = (Bzip2Stream *)calloc(1, sizeof(Bzip2Stream));
+  if (!bs)
+    return NULL;
+
+  int ret = compress ? BZ2_bzCompressInit(&bs->strm,
+                                          bzip2_block_size_from_level(level),
+                                          0, 30) // verbosity and workFactor
+                     : BZ2_bzDecompressInit(&bs->strm, 0, 0);
+  if (ret != BZ_OK) {
+    free(bs);
+    return NULL;
+  }
+  return bs;
+}
 
-static int bzip2_compress_stream(FILE *src, FILE *dst, int level) {
-  int bzerr;
-  int blockSize100k = bzip2_block_size_from_level(level);
+static void bzip2_stream_free(void *state, int compress) {
+  Bzip2Stream *bs = (Bzip2Stream *)state;
+  if (compress)
+    BZ2_bzCompressEnd(&bs->strm);
+  else
+    BZ2_bzDecompressEnd(&bs->strm);
+  free(bs);
+}
 
-  BZFILE *bzf =
-      BZ2_bzWriteOpen(&bzerr, dst, blockSize100k, 0,
-                      30 // verbosity and workFactor (recommended default)
-      );
-  if (bzerr != BZ_OK || bzf == NULL) {
-    return -1; // failed to open bzip2 stream
-  }
+// avail_in/avail_out are 32-bit, so large buffers go through in slices
+static void bzip2_stream_load(bz_stream *strm, CStreamIn *in,
+                              CStreamOut *out) {
+  size_t in_left = in->size - in->pos;
+  size_t out_left = out->size - out->pos;
+  strm->next_in = (char *)(in->src + in->pos);
+  strm->avail_in = (unsigned int)(in_left > UINT_MAX ? UINT_MAX : in_left);
+  strm->next_out = (char *)(out->dst + out->pos);
+  strm->avail_out = (unsigned int)(out_left > UINT_MAX ? UINT_MAX : out_left);
+}
 
-  unsigned char buffer[BZIP2_CHUNK];
-  int ret = 0;
+static void bzip2_stream_store(bz_stream *strm, CStreamIn *in,
+                               CStreamOut *out) {
+  in->pos = (size_t)((const unsigned char *)strm->next_in - in->src);
+  out->pos = (size_t)((unsigned char *)strm->next_out - out->dst);
+}
 
-  Py_BEGIN_ALLOW_THREADS
+static int bzip2_stream_compress_step(void *state, CStreamIn *in,
+                                      CStreamOut *out, CStreamOp op) {
+  bz_stream *strm = &((Bzip2Stream *)state)->strm;
+  int action = op == C_STREAM_FINISH  ? BZ_FINISH
+               : op == C_STREAM_FLUSH ? BZ_FLUSH
+                                      : BZ_RUN;
+
+  for (;;) {
+    bzip2_stream_load(strm, in, out);
+    int ret = BZ2_bzCompress(strm, action);
+    int out_full = strm->avail_out == 0;
+    bzip2_stream_store(strm, in, out);
+
+    if (ret < 0)
+      return C_STREAM_ERROR;
+    if (ret == BZ_STREAM_END)
+      return C_STREAM_OK; // finished
+    if (ret == BZ_RUN_OK && in->pos == in->size)
+      return C_STREAM_OK; // input taken (and, for BZ_FLUSH, flushed)
+    if (out_full)
+      return C_STREAM_MORE;
+  }
+}
 
-      for (;;) {
-    size_t nread = fread(buffer, 1, BZIP2_CHUNK, src);
-    if (ferror(src)) {
-      ret = -1; // read error
-      break;
-    }
+static int bzip2_stream_decompress_step(void *state, CStreamIn *in,
+                                        CStreamOut *out) {
+  Bzip2Stream *bs = (Bzip2Stream *)state;
+  bz_stream *strm = &bs->strm;
 
-    if (nread > 0) {
-      BZ2_bzWrite(&bzerr, bzf, buffer, (int)nread);
-      if (bzerr != BZ_OK) {
-        ret = -1; // write error
-        break;
-      }
+  for (;;) {
+    if (bs->ended) {
+      in->pos = in->size;
+      return C_STREAM_END;
     }
 
-    if (feof(src)) {
-      break; // end of file
+    bzip2_stream_load(strm, in, out);
+    int ret = BZ2_bzDecompress(strm);
+    int out_full = strm->avail_out == 0;
+    bzip2_stream_store(strm, in, out);
+
+    if (ret == BZ_STREAM_END) {
+      bs->ended = 1;
+      continue;
     }
+    if (ret != BZ_OK)
+      return C_STREAM_ERROR;
+    if (out_full)
+      return C_STREAM_MORE;
+    if (in->pos == in->size)
+      return C_STREAM_OK;
   }
+}
 
-  BZ2_bzWriteClose(&bzerr, bzf, 0, NULL, NULL);
-  if (bzerr != BZ_OK) {
-    ret = -1; // error closing bzip2 stream
-  }
+// ---- Stream Compression/Decompression ----
 
-  Py_END_ALLOW_THREADS
+static int bzip2_compress_stream(FILE *src, FILE *dst, int level,
+                                 uint64_t size) {
+  (void)size; // the format has no field for it
+  void *state = bzip2_stream_new(1, level);
+  if (!state) {
+    return -1; // failed to open bzip2 stream
+  }
 
-      return ret;
+  int ret = stream_compress_fp(bzip2_stream_compress_step, state, src, dst);
+  bzip2_stream_free(state, 1);
+  return ret;
 }
 
 static int bzip2_decompress_stream(FILE *src, FILE *dst, uint64_t orig_size) {
   (void)orig_size; // unused
 
-  int bzerr;
-  BZFILE *bzf = BZ2_bzReadOpen(&bzerr, src, 0, 0, // small and verbosity flags
-                               NULL, 0);
-  if (bzerr != BZ_OK || bzf == NULL) {
+  void *state = bzip2_stream_new(0, -1);
+  if (!state) {
     return -1; // failed to open bzip2 stream
   }
 
-  unsigned char buffer[BZIP2_CHUNK];
-  int ret = 0;
-
-  Py_BEGIN_ALLOW_THREADS
-
-      for (;;) {
-    int nread = BZ2_bzRead(&bzerr, bzf, buffer, BZIP2_CHUNK);
-    if (bzerr == BZ_OK || bzerr == BZ_STREAM_END) {
-      if (nread > 0) {
-        if (fwrite(buffer, 1, nread, dst) != (size_t)nread || ferror(dst)) {
-          ret = -1; // write error
-          break;
-        }
-      }
-      if (bzerr == BZ_STREAM_END) {
-        break; // end of stream
-      }
-    } else {
-      ret = -1; // read error
-      break;
-    }
-  }
-
-  BZ2_bzReadClose(&bzerr, bzf);
-
-  Py_END_ALLOW_THREADS
-
-      return ret;
+  int ret =
+      stream_decompress_fp(bzip2_stream_decompress_step, state, src, dst);
+  bzip2_stream_free(state, 0);
+  return ret;
 }
 
 // ---- Backend Definition ----
@@ -178,6 +221,10 @@ static const CBackend bzip2_backend = {
     .decompress_buffer = bzip2_decompress_buffer,
     .compress_stream = bzip2_compress_stream,
     .decompress_stream = bzip2_decompress_stream,
+    .stream_new = bzip2_stream_new,
+    .stream_free = bzip2_stream_free,
+    .stream_compress_step = bzip2_stream_compress_step,
+    .stream_decompress_step = bzip2_stream_decompress_step,
 };
 
 const CBackend *get_bzip2_backend(void) { return &bzip2_backend; }
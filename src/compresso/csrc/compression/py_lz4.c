@@ -1,10 +1,12 @@
 #define PY_SSIZE_T_CLEAN
 #define LZ4_CHUNK 65536 // 64KB
-#define LZ4_OUT_CHUNK                                                          \
-  (LZ4_CHUNK + LZ4_CHUNK / 255 + 16) // worst-case output size for LZ4 frame
 #include "../common.h"
 #include <Python.h>
+#include <limits.h>
+#include <lz4.h>
 #include <lz4frame.h>
+#include <stdlib.h>
+#include <string.h>
 
 static int lz4_is_available(void) {
   return 1; // lz4 is always available if this code is compiled
@@ -32,9 +34,9 @@ static int lz4_compress_buffer(const unsigned char *input, size_t input_size,
   prefs.compressionLevel = LZ4_level_from_generic(level);
 
   size_t ret;
-  Py_BEGIN_ALLOW_THREADS ret =
+  COMP_BEGIN_ALLOW_THREADS ret =
       LZ4F_compressFrame(output, *output_capacity, input, input_size, &prefs);
-  Py_END_ALLOW_THREADS
+  COMP_END_ALLOW_THREADS
 
       if (LZ4F_isError(ret)) {
     return -1; // compression failed
@@ -44,23 +46,19 @@ static int lz4_compress_buffer(const unsigned char *input, size_t input_size,
   return 0; // success
 }
 
-static int lz4_decompress_buffer(const unsigned char *input, size_t input_size,
-                                 unsigned char *output, size_t *output_capacity,
-                                 size_t *output_size) {
-  LZ4F_decompressionContext_t dctx;
-  size_t ret = LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
-  if (LZ4F_isError(ret)) {
-    return -1; // failed to create decompression context
-  }
-
+// Decode one frame with dctx, which must be fresh or reset
+static int lz4_decompress_with(LZ4F_dctx *dctx, const unsigned char *input,
+                               size_t input_size, unsigned char *output,
+                               size_t *output_capacity, size_t *output_size) {
   size_t src_size = input_size;
   size_t dst_size = *output_capacity;
 
   size_t input_pos = 0;
   size_t output_pos = 0;
+  size_t ret;
   int err = 0;
 
-  Py_BEGIN_ALLOW_THREADS
+  COMP_BEGIN_ALLOW_THREADS
 
       while (input_pos < src_size && output_pos < dst_size) {
     size_t input_chunk = src_size - input_pos;
@@ -85,11 +83,9 @@ static int lz4_decompress_buffer(const unsigned char *input, size_t input_size,
     }
   }
 
-  Py_END_ALLOW_THREADS
-
-      LZ4F_freeDecompressionContext(dctx);
+  COMP_END_ALLOW_THREADS
 
-  if (err) {
+      if (err) {
     return -1; // decompression failed
   }
 
@@ -97,145 +93,387 @@ static int lz4_decompress_buffer(const unsigned char *input, size_t input_size,
   return 0; // success
 }
 
-// ---- Stream Compression/Decompression ----
-
-static int lz4_compress_stream(FILE *src, FILE *dst, int level) {
-  LZ4F_compressionContext_t cctx;
-  size_t ret = LZ4F_createCompressionContext(&cctx, LZ4F_VERSION);
+static int lz4_decompress_buffer(const unsigned char *input, size_t input_size,
+                                 unsigned char *output, size_t *output_capacity,
+                                 size_t *output_size) {
+  LZ4F_decompressionContext_t dctx;
+  size_t ret = LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
   if (LZ4F_isError(ret)) {
-    return -1; // failed to create compression context
+    return -1; // failed to create decompression context
   }
 
+  int err = lz4_decompress_with(dctx, input, input_size, output,
+                                output_capacity, output_size);
+  LZ4F_freeDecompressionContext(dctx);
+  return err;
+}
+
+// ---- Reusable Contexts ----
+
+static void *lz4_context_new(int compress) {
+  if (compress) {
+    LZ4F_cctx *cctx = NULL;
+    return LZ4F_isError(LZ4F_createCompressionContext(&cctx, LZ4F_VERSION))
+               ? NULL
+               : cctx;
+  }
+
+  LZ4F_dctx *dctx = NULL;
+  return LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION))
+             ? NULL
+             : dctx;
+}
+
+static void lz4_context_free(void *ctx, int compress) {
+  if (compress)
+    LZ4F_freeCompressionContext((LZ4F_cctx *)ctx);
+  else
+    LZ4F_freeDecompressionContext((LZ4F_dctx *)ctx);
+}
+
+// Begin/update/end on a kept cctx produces an ordinary frame without the
+// per-call context allocation LZ4F_compressFrame does
+static int lz4_compress_buffer_ctx(void *ctx, const unsigned char *input,
+                                   size_t input_size, unsigned char *output,
+                                   size_t *output_capacity, int level,
+                                   size_t *output_size) {
+  LZ4F_cctx *cctx = (LZ4F_cctx *)ctx;
   LZ4F_preferences_t prefs;
   memset(&prefs, 0, sizeof(prefs));
   prefs.compressionLevel = LZ4_level_from_generic(level);
+  prefs.frameInfo.contentSize = (unsigned long long)input_size;
+  // Whole-buffer input: independent blocks and autoFlush let the cctx skip
+  // the dictionary carry-over and staging copy, which dominate small calls
+  prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+  prefs.autoFlush = 1;
+
+  size_t capacity = *output_capacity;
+  size_t pos = 0;
+  int err = 0;
 
-  unsigned char input[LZ4_CHUNK];
-  unsigned char output[LZ4_OUT_CHUNK];
+  COMP_BEGIN_ALLOW_THREADS
 
-  int return_code = 0;
+      size_t ret = LZ4F_compressBegin(cctx, output, capacity, &prefs);
+  if (LZ4F_isError(ret)) {
+    err = -1;
+  } else {
+    pos = ret;
+    ret = LZ4F_compressUpdate(cctx, output + pos, capacity - pos, input,
+                              input_size, NULL);
+    if (LZ4F_isError(ret)) {
+      err = -1;
+    } else {
+      pos += ret;
+      ret = LZ4F_compressEnd(cctx, output + pos, capacity - pos, NULL);
+      if (LZ4F_isError(ret))
+        err = -1;
+      else
+        pos += ret;
+    }
+  }
 
-  Py_BEGIN_ALLOW_THREADS
+  COMP_END_ALLOW_THREADS
 
-      size_t header_size =
-          LZ4F_compressBegin(cctx, output, LZ4_OUT_CHUNK, &prefs);
-  if (LZ4F_isError(header_size)) {
-    return_code = -1; // compression error
-    goto done_stream;
+      if (err) {
+    return -1; // compression failed
   }
-  if (fwrite(output, 1, header_size, dst) != header_size || ferror(dst)) {
-    return_code = -1; // write error
-    goto done_stream;
+
+  *output_size = pos;
+  return 0; // success
+}
+
+static int lz4_decompress_buffer_ctx(void *ctx, const unsigned char *input,
+                                     size_t input_size, unsigned char *output,
+                                     size_t *output_capacity,
+                                     size_t *output_size) {
+  // A failed call can leave the context mid-frame
+  LZ4F_resetDecompressionContext((LZ4F_dctx *)ctx);
+  return lz4_decompress_with((LZ4F_dctx *)ctx, input, input_size, output,
+                             output_capacity, output_size);
+}
+
+// ---- Memory Streaming ----
+
+// LZ4F_compressUpdate needs worst-case room, so compression stages each
+// chunk's output in an owned buffer and drains it into the caller's
+typedef struct {
+  LZ4F_cctx *cctx;
+  LZ4F_preferences_t prefs;
+  unsigned char *staged;
+  size_t staged_capacity;
+  size_t staged_pos;
+  size_t staged_len;
+  int started;
+  int finished;
+} Lz4EncodeStream;
+
+typedef struct {
+  LZ4F_dctx *dctx;
+  int at_boundary; // the last input consumed completed a frame
+} Lz4DecodeStream;
+
+static void *lz4_stream_new(int compress, int level) {
+  if (!compress) {
+    Lz4DecodeStream *ds = (Lz4DecodeStream *)calloc(1, sizeof(*ds));
+    if (ds && LZ4F_isError(
+                  LZ4F_createDecompressionContext(&ds->dctx, LZ4F_VERSION))) {
+      free(ds);
+      ds = NULL;
+    }
+    return ds;
   }
 
+  Lz4EncodeStream *es = (Lz4EncodeStream *)calloc(1, sizeof(*es));
+  if (!es)
+    return NULL;
+
+  es->prefs.compressionLevel = LZ4_level_from_generic(level);
+  es->staged_capacity = LZ4F_compressBound(LZ4_CHUNK, &es->prefs);
+  if (es->staged_capacity < LZ4F_HEADER_SIZE_MAX)
+    es->staged_capacity = LZ4F_HEADER_SIZE_MAX;
+
+  es->staged = (unsigned char *)malloc(es->staged_capacity);
+  if (!es->staged ||
+      LZ4F_isError(LZ4F_createCompressionContext(&es->cctx, LZ4F_VERSION))) {
+    free(es->staged);
+    free(es);
+    return NULL;
+  }
+  return es;
+}
+
+static void lz4_stream_free(void *state, int compress) {
+  if (compress) {
+    Lz4EncodeStream *es = (Lz4EncodeStream *)state;
+    LZ4F_freeCompressionContext(es->cctx);
+    free(es->staged);
+    free(es);
+  } else {
+    Lz4DecodeStream *ds = (Lz4DecodeStream *)state;
+    LZ4F_freeDecompressionContext(ds->dctx);
+    free(ds);
+  }
+}
+
+// Returns 1 while staged output is left over
+static int lz4_stream_drain(Lz4EncodeStream *es, CStreamOut *out) {
+  size_t pending = es->staged_len - es->staged_pos;
+  size_t room = out->size - out->pos;
+  size_t n = pending < room ? pending : room;
+
+  memcpy(out->dst + out->pos, es->staged + es->staged_pos, n);
+  out->pos += n;
+  es->staged_pos += n;
+  return es->staged_pos < es->staged_len;
+}
+
+static int lz4_stream_compress_step(void *state, CStreamIn *in,
+                                    CStreamOut *out, CStreamOp op) {
+  Lz4EncodeStream *es = (Lz4EncodeStream *)state;
+
   for (;;) {
-    size_t nread = fread(input, 1, LZ4_CHUNK, src);
-    if (ferror(src)) {
-      return_code = -1; // read error
-      break;
+    if (lz4_stream_drain(es, out))
+      return C_STREAM_MORE;
+
+    size_t ret;
+    if (es->finished) {
+      return in->pos == in->size ? C_STREAM_OK : C_STREAM_ERROR;
+    } else if (!es->started) {
+      ret = LZ4F_compressBegin(es->cctx, es->staged, es->staged_capacity,
+                               &es->prefs);
+      es->started = 1;
+    } else if (in->pos < in->size) {
+      size_t n = in->size - in->pos;
+      if (n > LZ4_CHUNK)
+        n = LZ4_CHUNK;
+      ret = LZ4F_compressUpdate(es->cctx, es->staged, es->staged_capacity,
+                                in->src + in->pos, n, NULL);
+      in->pos += n;
+    } else if (op == C_STREAM_RUN) {
+      return C_STREAM_OK;
+    } else if (op == C_STREAM_FLUSH) {
+      ret = LZ4F_flush(es->cctx, es->staged, es->staged_capacity, NULL);
+      if (!LZ4F_isError(ret) && ret == 0)
+        return C_STREAM_OK; // nothing (more) buffered
+    } else {
+      ret = LZ4F_compressEnd(es->cctx, es->staged, es->staged_capacity, NULL);
+      es->finished = 1;
     }
 
-    if (nread == 0) {
-      size_t end_size = LZ4F_compressEnd(cctx, output, LZ4_OUT_CHUNK, NULL);
-      if (LZ4F_isError(end_size)) {
-        return_code = -1; // compression error
-        break;
-      }
-      if (end_size > 0) {
-        if (fwrite(output, 1, end_size, dst) != end_size || ferror(dst)) {
-          return_code = -1; // write error
-        }
-      }
-      break; // end of file
-    }
+    if (LZ4F_isError(ret))
+      return C_STREAM_ERROR;
+    es->staged_pos = 0;
+    es->staged_len = ret;
+  }
+}
 
-    size_t src_size = nread;
-    size_t dst_size = LZ4_OUT_CHUNK;
+// Concatenated frames decode back to back; END means the input stopped on
+// a frame boundary
+static int lz4_stream_decompress_step(void *state, CStreamIn *in,
+                                      CStreamOut *out) {
+  Lz4DecodeStream *ds = (Lz4DecodeStream *)state;
 
-    size_t bytes =
-        LZ4F_compressUpdate(cctx, output, dst_size, input, src_size, NULL);
-    if (LZ4F_isError(bytes)) {
-      return_code = -1; // compression error
-      break;
-    }
+  for (;;) {
+    if (in->pos == in->size && ds->at_boundary)
+      return C_STREAM_END;
 
-    if (bytes > 0) {
-      if (fwrite(output, 1, bytes, dst) != bytes || ferror(dst)) {
-        return_code = -1; // write error
-        break;
-      }
+    size_t src_size = in->size - in->pos;
+    size_t dst_size = out->size - out->pos;
+    size_t ret = LZ4F_decompress(ds->dctx, out->dst + out->pos, &dst_size,
+                                 in->src + in->pos, &src_size, NULL);
+    if (LZ4F_isError(ret))
+      return C_STREAM_ERROR;
+
+    if (src_size > 0)
+      ds->at_boundary = 0;
+    in->pos += src_size;
+    out->pos += dst_size;
+
+    if (ret == 0) {
+      ds->at_boundary = 1; // frame complete and fully flushed
+      continue;
     }
+    if (out->pos == out->size)
+      return C_STREAM_MORE;
+    if (in->pos == in->size)
+      return C_STREAM_OK;
   }
+}
 
-done_stream:
-  Py_END_ALLOW_THREADS
+// ---- Stream Compression/Decompression ----
 
-      LZ4F_freeCompressionContext(cctx);
+// A known size lands in the frame header, and the decoder checks it
+static int lz4_compress_stream(FILE *src, FILE *dst, int level,
+                               uint64_t size) {
+  Lz4EncodeStream *state = (Lz4EncodeStream *)lz4_stream_new(1, level);
+  if (!state) {
+    return -1; // failed to create compression context
+  }
+  if (size != C_SIZE_UNKNOWN)
+    state->prefs.frameInfo.contentSize = (unsigned long long)size;
+
+  int return_code =
+      stream_compress_fp(lz4_stream_compress_step, state, src, dst);
+  lz4_stream_free(state, 1);
   return return_code;
 }
 
 static int lz4_decompress_stream(FILE *src, FILE *dst, uint64_t orig_size) {
   (void)orig_size; // unused parameter
 
-  LZ4F_decompressionContext_t dctx;
-  size_t ret = LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
-  if (LZ4F_isError(ret)) {
+  void *state = lz4_stream_new(0, -1);
+  if (!state) {
     return -1; // failed to create decompression context
   }
 
-  unsigned char input[LZ4_CHUNK];
-  unsigned char output[LZ4_OUT_CHUNK];
+  int return_code =
+      stream_decompress_fp(lz4_stream_decompress_step, state, src, dst);
+  lz4_stream_free(state, 0);
+  return return_code;
+}
 
-  int return_code = 0;
+// ---- Dictionaries ----
 
-  Py_BEGIN_ALLOW_THREADS
+// The frame-level dictionary API is not exported by shared liblz4 builds,
+// so dictionary payloads are single raw LZ4 blocks. LZ4 only looks back
+// 64KB, so only the tail of a dictionary matters. Compression digests keep
+// a stream with it loaded and each call starts from a copy of that stream,
+// since loading is what costs time on small inputs. Levels are ignored.
+#define LZ4_DICT_WINDOW (64 * 1024)
 
-      size_t input_size = 0;
-  size_t input_pos = 0;
+typedef struct {
+  LZ4_stream_t stream; // compression only; references data
+  int size;
+  char data[];
+} Lz4Dict;
 
-  for (;;) {
-    if (input_pos == input_size) {
-      input_size = fread(input, 1, LZ4_CHUNK, src);
-      if (ferror(src)) {
-        return_code = -1; // read error
-        break;
-      }
-      input_pos = 0;
-
-      if (input_size == 0) {
-        break; // end of file
-      }
-    }
+static void *lz4_dict_new(const unsigned char *data, size_t size,
+                          int compress, int level) {
+  (void)level; // raw blocks use the default acceleration
 
-    size_t src_size = input_size - input_pos;
-    size_t dst_size = LZ4_OUT_CHUNK;
+  if (size > LZ4_DICT_WINDOW) {
+    data += size - LZ4_DICT_WINDOW;
+    size = LZ4_DICT_WINDOW;
+  }
 
-    ret = LZ4F_decompress(dctx, output, &dst_size, input + input_pos, &src_size,
-                          NULL);
+  Lz4Dict *dict = (Lz4Dict *)malloc(sizeof(Lz4Dict) + size);
+  if (!dict)
+    return NULL;
 
-    if (LZ4F_isError(ret)) {
-      return_code = -1; // decompression error
-      break;
-    }
+  memcpy(dict->data, data, size);
+  dict->size = (int)size;
+  if (compress) {
+    LZ4_initStream(&dict->stream, sizeof(dict->stream));
+    LZ4_loadDict(&dict->stream, dict->data, dict->size);
+  }
+  return dict;
+}
 
-    input_pos += src_size;
+static void lz4_dict_free(void *dict, int compress) {
+  (void)compress; // one layout for both directions
+  free(dict);
+}
 
-    if (dst_size > 0) {
-      if (fwrite(output, 1, dst_size, dst) != dst_size || ferror(dst)) {
-        return_code = -1; // write error
-        break;
-      }
-    }
+static int lz4_compress_buffer_dict(void *ctx, const void *dict,
+                                    const unsigned char *input,
+                                    size_t input_size, unsigned char *output,
+                                    size_t *output_capacity,
+                                    size_t *output_size) {
+  (void)ctx; // the frame context is not used for raw blocks
 
-    if (ret == 0) {
-      break; // decompression completed
-    }
+  if (input_size > LZ4_MAX_INPUT_SIZE) {
+    return -1; // too large for one block
   }
 
-  Py_END_ALLOW_THREADS
+  const Lz4Dict *d = (const Lz4Dict *)dict;
+  int capacity = *output_capacity > INT_MAX ? INT_MAX : (int)*output_capacity;
+  int ret;
 
-      LZ4F_freeDecompressionContext(dctx);
-  return return_code;
+  COMP_BEGIN_ALLOW_THREADS
+
+      LZ4_stream_t stream;
+  memcpy(&stream, &d->stream, sizeof(stream));
+  ret = LZ4_compress_fast_continue(&stream, (const char *)input,
+                                   (char *)output, (int)input_size, capacity,
+                                   1);
+
+  COMP_END_ALLOW_THREADS
+
+      if (ret <= 0) {
+    return -1; // compression failed
+  }
+
+  *output_size = (size_t)ret;
+  return 0; // success
+}
+
+static int lz4_decompress_buffer_dict(void *ctx, const void *dict,
+                                      const unsigned char *input,
+                                      size_t input_size,
+                                      unsigned char *output,
+                                      size_t *output_capacity,
+                                      size_t *output_size) {
+  (void)ctx; // the frame context is not used for raw blocks
+
+  if (input_size > INT_MAX) {
+    return -1; // not a single block
+  }
+
+  const Lz4Dict *d = (const Lz4Dict *)dict;
+  int capacity = *output_capacity > INT_MAX ? INT_MAX : (int)*output_capacity;
+  int ret;
+
+  COMP_BEGIN_ALLOW_THREADS ret = LZ4_decompress_safe_usingDict(
+      (const char *)input, (char *)output, (int)input_size, capacity, d->data,
+      d->size);
+  COMP_END_ALLOW_THREADS
+
+      if (ret < 0) {
+    return -1; // decompression failed
+  }
+
+  *output_size = (size_t)ret;
+  return 0; // success
 }
 
 // ---- Backend Definition ----
@@ -249,6 +487,19 @@ static const CBackend lz4_backend = {
     .decompress_buffer = lz4_decompress_buffer,
     .compress_stream = lz4_compress_stream,
     .decompress_stream = lz4_decompress_stream,
+    .one_shot_max = C_ONE_SHOT_MAX,
+    .context_new = lz4_context_new,
+    .context_free = lz4_context_free,
+    .compress_buffer_ctx = lz4_compress_buffer_ctx,
+    .decompress_buffer_ctx = lz4_decompress_buffer_ctx,
+    .stream_new = lz4_stream_new,
+    .stream_free = lz4_stream_free,
+    .stream_compress_step = lz4_stream_compress_step,
+    .stream_decompress_step = lz4_stream_decompress_step,
+    .dict_new = lz4_dict_new,
+    .dict_free = lz4_dict_free,
+    .compress_buffer_dict = lz4_compress_buffer_dict,
+    .decompress_buffer_dict = lz4_decompress_buffer_dict,
 };
 
 const CBackend *get_lz4_backend(void) { return &lz4_backend; }
@@ -1,9 +1,9 @@
 #define PY_SSIZE_T_CLEAN
-#define LZMA_CHUNK 65536                                // 64KB
 #define LZMA_DECOMPRESS_MEMLIMIT (512ULL * 1024 * 1024) // 512MB
 #include "../common.h"
 #include <Python.h>
 #include <lzma.h>
+#include <stdlib.h>
 
 static int lzma_is_available(void) {
   return 1; // lzma is always available if this code is compiled
@@ -38,10 +38,10 @@ static int lzma_compress_buffer(const unsigned char *input, size_t input_size,
   lzma_ret ret;
   size_t output_pos = 0;
 
-  Py_BEGIN_ALLOW_THREADS ret =
+  COMP_BEGIN_ALLOW_THREADS ret =
       lzma_easy_buffer_encode(preset, LZMA_CHECK_CRC64, NULL, input, input_size,
                               output, &output_pos, *output_capacity);
-  Py_END_ALLOW_THREADS
+  COMP_END_ALLOW_THREADS
 
       if (ret != LZMA_OK) {
     return -1; // compression failed
@@ -61,12 +61,15 @@ static int lzma_decompress_buffer(const unsigned char *input, size_t input_size,
   size_t input_pos = 0;
   size_t output_pos = 0;
 
-  Py_BEGIN_ALLOW_THREADS ret = lzma_stream_buffer_decode(
+  COMP_BEGIN_ALLOW_THREADS ret = lzma_stream_buffer_decode(
       &memlimit, flags, NULL, input, &input_pos, input_size, output,
       &output_pos, *output_capacity);
-  Py_END_ALLOW_THREADS
+  COMP_END_ALLOW_THREADS
 
       if (ret != LZMA_OK) {
+    if (!PyGILState_Check()) {
+      return -1; // worker thread without the GIL: caller reports the error
+    }
     if (ret == LZMA_MEMLIMIT_ERROR) {
       PyErr_Format(comp_BackendError,
                    "LZMA decompression exceeded memory limit: %llu",
@@ -87,137 +90,136 @@ static int lzma_decompress_buffer(const unsigned char *input, size_t input_size,
   return 0; // success
 }
 
-// ---- Stream Compression/Decompression ----
+// ---- Memory Streaming ----
 
-static int lzma_compress_stream(FILE *src, FILE *dst, int level) {
-  uint32_t preset = lzma_level_to_preset(level);
+typedef struct {
+  lzma_stream strm;
+  lzma_ret last; // last lzma_code result, kept for error reporting
+  int ended;     // decompression: stream end seen, trailing data is ignored
+} LzmaStream;
 
-  lzma_stream strm = LZMA_STREAM_INIT;
-  lzma_ret ret = lzma_easy_encoder(&strm, preset, LZMA_CHECK_CRC64);
-  if (ret != LZMA_OK) {
-    return -1; // initialisation failed
-  }
+static void *lzma_stream_new(int compress, int level) {
+  LzmaStream *ls = (LzmaStream *)calloc(1, sizeof(LzmaStream));
+  if (!ls)
+    return NULL;
 
-  unsigned char input[LZMA_CHUNK];
-  unsigned char output[LZMA_CHUNK];
+  lzma_stream init = LZMA_STREAM_INIT;
+  ls->strm = init;
 
-  int return_code = 0;
-
-  Py_BEGIN_ALLOW_THREADS
+  lzma_ret ret =
+      compress ? lzma_easy_encoder(&ls->strm, lzma_level_to_preset(level),
+                                   LZMA_CHECK_CRC64)
+               : lzma_stream_decoder(&ls->strm, LZMA_DECOMPRESS_MEMLIMIT, 0);
+  if (ret != LZMA_OK) {
+    free(ls);
+    return NULL;
+  }
+  ls->last = LZMA_OK;
+  return ls;
+}
 
-      lzma_action action = LZMA_RUN;
+static void lzma_stream_free(void *state, int compress) {
+  (void)compress; // lzma_end covers both directions
+  LzmaStream *ls = (LzmaStream *)state;
+  lzma_end(&ls->strm);
+  free(ls);
+}
 
-  while (1) {
-    if (strm.avail_in == 0) {
-      size_t nread = fread(input, 1, LZMA_CHUNK, src);
-      if (ferror(src)) {
-        return_code = -1; // read error
-        break;
-      }
+static lzma_ret lzma_stream_code(LzmaStream *ls, CStreamIn *in,
+                                 CStreamOut *out, lzma_action action) {
+  lzma_stream *strm = &ls->strm;
+  strm->next_in = in->src + in->pos;
+  strm->avail_in = in->size - in->pos;
+  strm->next_out = out->dst + out->pos;
+  strm->avail_out = out->size - out->pos;
 
-      strm.next_in = input;
-      strm.avail_in = nread;
+  ls->last = lzma_code(strm, action);
 
-      if (feof(src)) {
-        action = LZMA_FINISH;
-      }
-    }
+  in->pos = in->size - strm->avail_in;
+  out->pos = out->size - strm->avail_out;
+  return ls->last;
+}
 
-    strm.next_out = output;
-    strm.avail_out = LZMA_CHUNK;
+static int lzma_stream_compress_step(void *state, CStreamIn *in,
+                                     CStreamOut *out, CStreamOp op) {
+  LzmaStream *ls = (LzmaStream *)state;
+  lzma_action action = op == C_STREAM_FINISH  ? LZMA_FINISH
+                       : op == C_STREAM_FLUSH ? LZMA_SYNC_FLUSH
+                                              : LZMA_RUN;
+
+  for (;;) {
+    lzma_ret ret = lzma_stream_code(ls, in, out, action);
+
+    // LZMA_STREAM_END also marks a completed sync flush
+    if (ret == LZMA_STREAM_END)
+      return C_STREAM_OK;
+    if (ret != LZMA_OK && ret != LZMA_BUF_ERROR)
+      return C_STREAM_ERROR;
+    if (out->pos == out->size)
+      return C_STREAM_MORE;
+    if (action == LZMA_RUN && in->pos == in->size)
+      return C_STREAM_OK;
+  }
+}
 
-    ret = lzma_code(&strm, action);
+static int lzma_stream_decompress_step(void *state, CStreamIn *in,
+                                       CStreamOut *out) {
+  LzmaStream *ls = (LzmaStream *)state;
 
-    size_t write_size = LZMA_CHUNK - strm.avail_out;
-    if (write_size > 0) {
-      if (fwrite(output, 1, write_size, dst) != write_size || ferror(dst)) {
-        return_code = -1; // write error
-        break;
-      }
+  for (;;) {
+    if (ls->ended) {
+      in->pos = in->size;
+      return C_STREAM_END;
     }
 
+    lzma_ret ret = lzma_stream_code(ls, in, out, LZMA_RUN);
     if (ret == LZMA_STREAM_END) {
-      break; // finished
-    }
-
-    if (ret != LZMA_OK) {
-      return_code = -1; // compression error
-      break;
+      ls->ended = 1;
+      continue;
     }
+    if (ret != LZMA_OK && ret != LZMA_BUF_ERROR)
+      return C_STREAM_ERROR;
+    if (out->pos == out->size)
+      return C_STREAM_MORE;
+    if (in->pos == in->size)
+      return C_STREAM_OK;
   }
+}
 
-  Py_END_ALLOW_THREADS
+// ---- Stream Compression/Decompression ----
+
+static int lzma_compress_stream(FILE *src, FILE *dst, int level,
+                                uint64_t size) {
+  (void)size; // the format has no field for it
+  void *state = lzma_stream_new(1, level);
+  if (!state) {
+    return -1; // initialisation failed
+  }
 
-      lzma_end(&strm);
+  int return_code =
+      stream_compress_fp(lzma_stream_compress_step, state, src, dst);
+  lzma_stream_free(state, 1);
   return return_code;
 }
 
 static int lzma_decompress_stream(FILE *src, FILE *dst, uint64_t orig_size) {
   (void)orig_size; // unused parameter
 
-  lzma_stream strm = LZMA_STREAM_INIT;
-
-  uint64_t memlimit = LZMA_DECOMPRESS_MEMLIMIT;
-  uint32_t flags = 0;
-  lzma_ret ret = lzma_stream_decoder(&strm, memlimit, flags);
-  if (ret != LZMA_OK) {
+  LzmaStream *state = (LzmaStream *)lzma_stream_new(0, -1);
+  if (!state) {
     return -1; // initialisation failed
   }
 
-  unsigned char input[LZMA_CHUNK];
-  unsigned char output[LZMA_CHUNK];
-
-  int return_code = 0;
+  int return_code =
+      stream_decompress_fp(lzma_stream_decompress_step, state, src, dst);
 
-  Py_BEGIN_ALLOW_THREADS
-
-      while (1) {
-    if (strm.avail_in == 0) {
-      size_t nread = fread(input, 1, LZMA_CHUNK, src);
-      if (ferror(src)) {
-        return_code = -1; // read error
-        break;
-      }
-
-      strm.next_in = input;
-      strm.avail_in = nread;
-    }
-
-    if (strm.avail_in == 0 && feof(src)) {
-      break; // end of file
-    }
-
-    strm.next_out = output;
-    strm.avail_out = LZMA_CHUNK;
-
-    ret = lzma_code(&strm, LZMA_RUN);
-
-    size_t write_size = LZMA_CHUNK - strm.avail_out;
-    if (write_size > 0) {
-      if (fwrite(output, 1, write_size, dst) != write_size || ferror(dst)) {
-        return_code = -1; // write error
-        break;
-      }
-    }
-
-    if (ret == LZMA_STREAM_END) {
-      break; // finished
-    }
-
-    if (ret != LZMA_OK) {
-      if (ret == LZMA_MEMLIMIT_ERROR) {
-        PyErr_Format(comp_BackendError,
-                     "LZMA decompression exceeded memory limit: %llu",
-                     (unsigned long long)LZMA_DECOMPRESS_MEMLIMIT);
-      }
-      return_code = -1; // decompression error
-      break;
-    }
+  if (state->last == LZMA_MEMLIMIT_ERROR && PyGILState_Check()) {
+    PyErr_Format(comp_BackendError,
+                 "LZMA decompression exceeded memory limit: %llu",
+                 (unsigned long long)LZMA_DECOMPRESS_MEMLIMIT);
   }
 
-  Py_END_ALLOW_THREADS
-
-      lzma_end(&strm);
+  lzma_stream_free(state, 0);
   return return_code;
 }
 
@@ -232,6 +234,10 @@ static const CBackend lzma_backend = {
     .decompress_buffer = lzma_decompress_buffer,
     .compress_stream = lzma_compress_stream,
     .decompress_stream = lzma_decompress_stream,
+    .stream_new = lzma_stream_new,
+    .stream_free = lzma_stream_free,
+    .stream_compress_step = lzma_stream_compress_step,
+    .stream_decompress_step = lzma_stream_decompress_step,
 };
 
 const CBackend *get_lzma_backend(void) { return &lzma_backend; }
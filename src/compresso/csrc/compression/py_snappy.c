@@ -3,6 +3,8 @@
 #include "../common.h"
 #include <Python.h>
 #include <snappy-c.h>
+#include <stdlib.h>
+#include <string.h>
 
 static int snappy_is_available(void) {
   return 1; // snappy is always available if this code is compiled
@@ -23,9 +25,9 @@ static int snappy_compress_buffer(const unsigned char *input, size_t input_size,
   size_t dest_len = *output_capacity;
   snappy_status status;
 
-  Py_BEGIN_ALLOW_THREADS status = snappy_compress(
+  COMP_BEGIN_ALLOW_THREADS status = snappy_compress(
       (const char *)input, input_size, (char *)output, &dest_len);
-  Py_END_ALLOW_THREADS
+  COMP_END_ALLOW_THREADS
 
       if (status != SNAPPY_OK) {
     return -1; // compression failed
@@ -42,9 +44,9 @@ static int snappy_decompress_buffer(const unsigned char *input,
   size_t dest_len = *output_capacity;
   snappy_status status;
 
-  Py_BEGIN_ALLOW_THREADS status = snappy_uncompress(
+  COMP_BEGIN_ALLOW_THREADS status = snappy_uncompress(
       (const char *)input, input_size, (char *)output, &dest_len);
-  Py_END_ALLOW_THREADS
+  COMP_END_ALLOW_THREADS
 
       if (status != SNAPPY_OK) {
     return -1; // decompression failed
@@ -75,148 +77,208 @@ static uint32_t read_u32_le(const unsigned char buffer[4]) {
          ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
 }
 
-// ---- Stream Compression/Decompression ----
+// ---- Memory Streaming ----
+
+// Stream layout: chunks of at most SNAPPY_CHUNK input bytes, each written
+// as an 8-byte header (original size, compressed size; u32 LE) followed by
+// the snappy block. A 0/0 header terminates the stream early.
+
+#define SNAPPY_CHUNK_HEADER 8
+
+typedef struct {
+  int compress;
+  unsigned char header[SNAPPY_CHUNK_HEADER];
+  size_t header_len;  // decompression: header bytes collected so far
+  char *input;        // compression: pending raw bytes
+  size_t input_len;
+  char *comp;         // compressed chunk (with header when compressing)
+  size_t comp_len;    // decompression: compressed bytes collected
+  size_t comp_need;   // decompression: compressed size of current chunk
+  char *output;       // staged output waiting for room in the caller's buffer
+  size_t output_pos;
+  size_t output_len;
+  int ended;          // decompression: terminator seen
+} SnappyStream;
+
+static size_t snappy_stream_comp_capacity(void) {
+  return SNAPPY_CHUNK_HEADER + snappy_max_compressed_length(SNAPPY_CHUNK);
+}
 
-static int snappy_compress_stream(FILE *src, FILE *dst, int level) {
-  (void)level; // snappy ignores compression level
+static void snappy_stream_free(void *state, int compress) {
+  (void)compress; // one layout for both directions
+  SnappyStream *ss = (SnappyStream *)state;
+  free(ss->input);
+  free(ss->comp);
+  if (!ss->compress)
+    free(ss->output); // compression drains straight from comp
+  free(ss);
+}
 
-  size_t max_comp_len = snappy_max_compressed_length(SNAPPY_CHUNK);
+static void *snappy_stream_new(int compress, int level) {
+  (void)level; // snappy ignores compression level
 
-  char *input_buffer = (char *)safe_malloc(SNAPPY_CHUNK);
-  char *comp_buffer = (char *)safe_malloc(max_comp_len);
-  if (!input_buffer || !comp_buffer) {
-    free(input_buffer);
-    free(comp_buffer);
-    return -1; // memory allocation failure
+  SnappyStream *ss = (SnappyStream *)calloc(1, sizeof(SnappyStream));
+  if (!ss)
+    return NULL;
+
+  ss->compress = compress;
+  ss->comp = (char *)malloc(snappy_stream_comp_capacity());
+  if (compress) {
+    ss->input = (char *)malloc(SNAPPY_CHUNK);
+    ss->output = ss->comp;
+  } else {
+    ss->output = (char *)malloc(SNAPPY_CHUNK);
   }
 
-  int return_code = 0;
-
-  Py_BEGIN_ALLOW_THREADS
-
-      for (;;) {
-    size_t nread = fread(input_buffer, 1, SNAPPY_CHUNK, src);
-    if (ferror(src)) {
-      return_code = -1; // read error
-      break;
-    }
+  if (!ss->comp || !ss->output || (compress && !ss->input)) {
+    snappy_stream_free(ss, compress);
+    return NULL;
+  }
+  return ss;
+}
 
-    if (nread == 0) {
-      break; // end of file
-    }
+// Returns 1 while staged output is left over
+static int snappy_stream_drain(SnappyStream *ss, CStreamOut *out) {
+  size_t pending = ss->output_len - ss->output_pos;
+  size_t room = out->size - out->pos;
+  size_t n = pending < room ? pending : room;
 
-    if (nread > UINT32_MAX) {
-      return_code = -1; // chunk size overflow
-      break;
-    }
+  memcpy(out->dst + out->pos, ss->output + ss->output_pos, n);
+  out->pos += n;
+  ss->output_pos += n;
+  return ss->output_pos < ss->output_len;
+}
 
-    size_t comp_len = max_comp_len;
-    snappy_status status =
-        snappy_compress(input_buffer, nread, comp_buffer, &comp_len);
-    if (status != SNAPPY_OK) {
-      return_code = -1; // compression error
-      break;
-    }
+static int snappy_stream_compress_step(void *state, CStreamIn *in,
+                                       CStreamOut *out, CStreamOp op) {
+  SnappyStream *ss = (SnappyStream *)state;
+
+  for (;;) {
+    if (snappy_stream_drain(ss, out))
+      return C_STREAM_MORE;
+
+    int input_left = in->pos < in->size;
+    if (ss->input_len == SNAPPY_CHUNK ||
+        (!input_left && op != C_STREAM_RUN && ss->input_len > 0)) {
+      size_t comp_len = snappy_stream_comp_capacity() - SNAPPY_CHUNK_HEADER;
+      if (snappy_compress(ss->input, ss->input_len,
+                          ss->comp + SNAPPY_CHUNK_HEADER,
+                          &comp_len) != SNAPPY_OK) {
+        return C_STREAM_ERROR;
+      }
 
-    if (comp_len > UINT32_MAX) {
-      return_code = -1; // size overflow
-      break;
+      write_u32_le((uint32_t)ss->input_len, (unsigned char *)ss->comp);
+      write_u32_le((uint32_t)comp_len, (unsigned char *)ss->comp + 4);
+      ss->output_pos = 0;
+      ss->output_len = SNAPPY_CHUNK_HEADER + comp_len;
+      ss->input_len = 0;
+      continue;
     }
 
-    unsigned char header[8];
-    write_u32_le((uint32_t)nread, header);        // original size
-    write_u32_le((uint32_t)comp_len, header + 4); // compressed size
+    if (!input_left)
+      return C_STREAM_OK;
 
-    if (fwrite(header, 1, 8, dst) != 8 || ferror(dst)) {
-      return_code = -1; // write error
-      break;
-    }
-
-    if (fwrite(comp_buffer, 1, comp_len, dst) != comp_len || ferror(dst)) {
-      return_code = -1; // write error
-      break;
-    }
+    size_t n = in->size - in->pos;
+    if (n > SNAPPY_CHUNK - ss->input_len)
+      n = SNAPPY_CHUNK - ss->input_len;
+    memcpy(ss->input + ss->input_len, in->src + in->pos, n);
+    ss->input_len += n;
+    in->pos += n;
   }
-
-  Py_END_ALLOW_THREADS
-
-      free(input_buffer);
-  free(comp_buffer);
-  return return_code;
 }
 
-static int snappy_decompress_stream(FILE *src, FILE *dst, uint64_t orig_size) {
-  (void)orig_size; // unused parameter
-
+static int snappy_stream_decompress_step(void *state, CStreamIn *in,
+                                         CStreamOut *out) {
+  SnappyStream *ss = (SnappyStream *)state;
   size_t max_comp_len = snappy_max_compressed_length(SNAPPY_CHUNK);
 
-  char *comp_buffer = (char *)safe_malloc(max_comp_len);
-  char *output_buffer = (char *)safe_malloc(SNAPPY_CHUNK);
-  if (!comp_buffer || !output_buffer) {
-    free(comp_buffer);
-    free(output_buffer);
-    return -1; // memory allocation failure
-  }
-
-  int return_code = 0;
-
-  Py_BEGIN_ALLOW_THREADS
+  for (;;) {
+    if (snappy_stream_drain(ss, out))
+      return C_STREAM_MORE;
 
-      for (;;) {
-    unsigned char header[8];
-    size_t got = fread(header, 1, 8, src);
-
-    if (got == 0) {
-      if (feof(src)) {
-        break; // end of file
-      }
-      return_code = -1; // read error
-      break;
+    if (ss->ended) {
+      in->pos = in->size;
+      return C_STREAM_END;
     }
 
-    if (got != 8) {
-      return_code = -1; // incomplete header
-      break;
+    if (in->pos == in->size) {
+      // A stream may stop after any whole chunk
+      return ss->header_len == 0 ? C_STREAM_END : C_STREAM_OK;
     }
 
-    uint32_t orig_len = read_u32_le(header);
-    uint32_t comp_len = read_u32_le(header + 4);
-
-    if (orig_len == 0 && comp_len == 0) {
-      break;
+    if (ss->header_len < SNAPPY_CHUNK_HEADER) {
+      size_t n = SNAPPY_CHUNK_HEADER - ss->header_len;
+      if (n > in->size - in->pos)
+        n = in->size - in->pos;
+      memcpy(ss->header + ss->header_len, in->src + in->pos, n);
+      ss->header_len += n;
+      in->pos += n;
+      if (ss->header_len < SNAPPY_CHUNK_HEADER)
+        continue;
+
+      uint32_t orig_len = read_u32_le(ss->header);
+      uint32_t comp_len = read_u32_le(ss->header + 4);
+      if (orig_len == 0 && comp_len == 0) {
+        ss->ended = 1;
+        continue;
+      }
+      if (orig_len > SNAPPY_CHUNK || comp_len > max_comp_len) {
+        return C_STREAM_ERROR; // size too large
+      }
+      ss->comp_need = comp_len;
+      ss->comp_len = 0;
     }
 
-    if (orig_len > SNAPPY_CHUNK || comp_len > max_comp_len) {
-      return_code = -1; // size too large
-      break;
-    }
+    size_t n = ss->comp_need - ss->comp_len;
+    if (n > in->size - in->pos)
+      n = in->size - in->pos;
+    memcpy(ss->comp + ss->comp_len, in->src + in->pos, n);
+    ss->comp_len += n;
+    in->pos += n;
+    if (ss->comp_len < ss->comp_need)
+      continue;
 
-    size_t read_bytes = fread(comp_buffer, 1, comp_len, src);
-    if (read_bytes != comp_len || ferror(src)) {
-      return_code = -1; // read error
-      break;
+    size_t orig_len = read_u32_le(ss->header);
+    size_t output_len = orig_len;
+    if (snappy_uncompress(ss->comp, ss->comp_len, ss->output, &output_len) !=
+            SNAPPY_OK ||
+        output_len != orig_len) {
+      return C_STREAM_ERROR;
     }
 
-    size_t output_len = orig_len;
-    snappy_status status =
-        snappy_uncompress(comp_buffer, comp_len, output_buffer, &output_len);
+    ss->output_pos = 0;
+    ss->output_len = output_len;
+    ss->header_len = 0;
+  }
+}
 
-    if (status != SNAPPY_OK || output_len != orig_len) {
-      return_code = -1; // decompression error
-      break;
-    }
+// ---- Stream Compression/Decompression ----
 
-    if (fwrite(output_buffer, 1, output_len, dst) != output_len ||
-        ferror(dst)) {
-      return_code = -1; // write error
-      break;
-    }
+static int snappy_compress_stream(FILE *src, FILE *dst, int level,
+                                  uint64_t size) {
+  (void)size; // the format has no field for it
+  void *state = snappy_stream_new(1, level);
+  if (!state) {
+    return -1; // memory allocation failure
   }
 
-  Py_END_ALLOW_THREADS
+  int return_code =
+      stream_compress_fp(snappy_stream_compress_step, state, src, dst);
+  snappy_stream_free(state, 1);
+  return return_code;
+}
+
+static int snappy_decompress_stream(FILE *src, FILE *dst, uint64_t orig_size) {
+  (void)orig_size; // unused parameter
+
+  void *state = snappy_stream_new(0, -1);
+  if (!state) {
+    return -1; // memory allocation failure
+  }
 
-      free(comp_buffer);
-  free(output_buffer);
+  int return_code =
+      stream_decompress_fp(snappy_stream_decompress_step, state, src, dst);
+  snappy_stream_free(state, 0);
   return return_code;
 }
 
@@ -231,6 +293,10 @@ static const CBackend snappy_backend = {
     .decompress_buffer = snappy_decompress_buffer,
     .compress_stream = snappy_compress_stream,
     .decompress_stream = snappy_decompress_stream,
+    .stream_new = snappy_stream_new,
+    .stream_free = snappy_stream_free,
+    .stream_compress_step = snappy_stream_compress_step,
+    .stream_decompress_step = snappy_stream_decompress_step,
 };
 
 const CBackend *get_snappy_backend(void) { return &snappy_backend; }
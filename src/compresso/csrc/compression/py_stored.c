@@ -0,0 +1,263 @@
+#define PY_SSIZE_T_CLEAN
+#include "../common.h"
+#include "../fileio.h"
+#include <Python.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#include <unistd.h>
+#if defined(__GLIBC__) &&                                                      \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define STORED_HAVE_COPY_FILE_RANGE 1
+#endif
+#endif
+
+// The stored backend is the identity codec behind ALGO_NONE: payloads are
+// the raw data. compress_file falls back to it when a backend fails to
+// shrink the input, so reading such a file is a plain copy.
+
+#define STORED_KERNEL_CHUNK (1UL << 30) // per kernel copy call
+
+static int stored_is_available(void) {
+  return 1; // always compiled in
+}
+
+static size_t stored_max_compressed_size(size_t input_size) {
+  return input_size;
+}
+
+// ---- Buffer Compression/Decompression ----
+
+static int stored_copy_buffer(const unsigned char *input, size_t input_size,
+                              unsigned char *output, size_t *output_capacity,
+                              size_t *output_size) {
+  if (*output_capacity < input_size) {
+    return -1; // output buffer too small
+  }
+
+  if (input_size > 0) {
+    memcpy(output, input, input_size);
+  }
+  *output_size = input_size;
+  return 0;
+}
+
+static int stored_compress_buffer(const unsigned char *input,
+                                  size_t input_size, unsigned char *output,
+                                  size_t *output_capacity, int level,
+                                  size_t *output_size) {
+  (void)level; // nothing to tune
+  return stored_copy_buffer(input, input_size, output, output_capacity,
+                            output_size);
+}
+
+static int stored_decompress_buffer(const unsigned char *input,
+                                    size_t input_size, unsigned char *output,
+                                    size_t *output_capacity,
+                                    size_t *output_size) {
+  return stored_copy_buffer(input, input_size, output, output_capacity,
+                            output_size);
+}
+
+// ---- Memory Streaming ----
+
+// Stateless: every step just moves what fits
+static char stored_stream_state;
+
+static void *stored_stream_new(int compress, int level) {
+  (void)compress;
+  (void)level;
+  return &stored_stream_state;
+}
+
+static void stored_stream_free(void *state, int compress) {
+  (void)state;
+  (void)compress;
+}
+
+static int stored_stream_move(CStreamIn *in, CStreamOut *out) {
+  size_t n = in->size - in->pos;
+  if (n > out->size - out->pos)
+    n = out->size - out->pos;
+
+  if (n > 0) {
+    memcpy(out->dst + out->pos, in->src + in->pos, n);
+    in->pos += n;
+    out->pos += n;
+  }
+  return in->pos < in->size ? C_STREAM_MORE : C_STREAM_OK;
+}
+
+static int stored_stream_compress_step(void *state, CStreamIn *in,
+                                       CStreamOut *out, CStreamOp op) {
+  (void)state;
+  (void)op; // nothing is ever held back
+  return stored_stream_move(in, out);
+}
+
+static int stored_stream_decompress_step(void *state, CStreamIn *in,
+                                         CStreamOut *out) {
+  (void)state;
+  // Raw data has no end marker: it is complete wherever the input stops
+  int r = stored_stream_move(in, out);
+  return r == C_STREAM_OK ? C_STREAM_END : r;
+}
+
+// ---- Stream Compression/Decompression ----
+
+#if defined(__linux__)
+// Let the kernel move up to `limit` bytes from in_fd to out_fd at the given
+// offsets: copy_file_range, then sendfile. Stops early (returning 0) once
+// neither applies to these files; the caller copies the rest.
+static int stored_kernel_copy(int in_fd, off_t *in_off, int out_fd,
+                              off_t *out_off, uint64_t limit,
+                              uint64_t *copied) {
+  int use_sendfile = 0;
+#if !defined(STORED_HAVE_COPY_FILE_RANGE)
+  use_sendfile = 1;
+#endif
+
+  while (*copied < limit) {
+    if (io_cancelled() != IO_CANCEL_NONE)
+      return -1;
+    uint64_t left = limit - *copied;
+    size_t want = left < STORED_KERNEL_CHUNK ? (size_t)left
+                                             : STORED_KERNEL_CHUNK;
+    ssize_t n;
+#if defined(STORED_HAVE_COPY_FILE_RANGE)
+    if (!use_sendfile) {
+      n = copy_file_range(in_fd, in_off, out_fd, out_off, want, 0);
+      if (n < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL ||
+                    errno == EOPNOTSUPP || errno == EBADF)) {
+        use_sendfile = 1; // e.g. across filesystems or on older kernels
+        continue;
+      }
+    } else
+#endif
+    {
+      if (lseek(out_fd, *out_off, SEEK_SET) < 0)
+        return -1;
+      n = sendfile(out_fd, in_fd, in_off, want);
+      if (n < 0 && (errno == ENOSYS || errno == EINVAL))
+        return 0;
+      if (n > 0)
+        *out_off += n;
+    }
+
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return -1;
+    if (n == 0)
+      return 0; // end of input
+    *copied += (uint64_t)n;
+    io_progress_advance((uint64_t)n);
+  }
+  return 0;
+}
+#endif
+
+// Copy up to `limit` bytes from src's position to dst's, advancing both;
+// *copied says how many were. The kernel moves the data when it can, else
+// it goes through a stdio buffer.
+static int stored_copy_fp(FILE *src, FILE *dst, uint64_t limit,
+                          uint64_t *copied) {
+  *copied = 0;
+  if (fflush(dst) != 0)
+    return -1;
+
+  int err = 0;
+  COMP_BEGIN_ALLOW_THREADS
+
+#if defined(__linux__)
+      off_t in_off = ftello(src);
+  off_t out_off = ftello(dst);
+  // The stdio positions then pick up where the kernel left off; the
+  // copy counts as one wait on writing
+  uint64_t start = io_monotonic_ns();
+  if (in_off < 0 || out_off < 0 ||
+      stored_kernel_copy(fileno(src), &in_off, fileno(dst), &out_off, limit,
+                         copied) != 0 ||
+      fseeko(src, in_off, SEEK_SET) != 0 ||
+      fseeko(dst, out_off, SEEK_SET) != 0) {
+    err = -1;
+  }
+  io_wait_add(1, *copied, io_monotonic_ns() - start);
+#endif
+
+  unsigned char *buf = NULL;
+  size_t chunk = io_chunk_size();
+  if (!err && *copied < limit) {
+    buf = (unsigned char *)io_alloc(chunk);
+    if (!buf)
+      err = -1;
+  }
+  while (buf && *copied < limit) {
+    if (io_cancelled() != IO_CANCEL_NONE) {
+      err = -1;
+      break;
+    }
+    uint64_t left = limit - *copied;
+    size_t want = left < chunk ? (size_t)left : chunk;
+    size_t nread = io_fread(buf, want, src);
+    if (nread > 0 && io_fwrite(buf, nread, dst) != nread) {
+      err = -1;
+      break;
+    }
+    *copied += nread;
+    io_progress_advance(nread);
+    if (nread < want) {
+      if (ferror(src))
+        err = -1;
+      break;
+    }
+  }
+  io_free(buf);
+
+  if (!err && ferror(dst)) {
+    err = -1;
+  }
+
+  COMP_END_ALLOW_THREADS
+
+      return err;
+}
+
+static int stored_compress_stream(FILE *src, FILE *dst, int level,
+                                  uint64_t size) {
+  (void)level;
+  (void)size; // copies to EOF either way
+  uint64_t copied = 0;
+  return stored_copy_fp(src, dst, UINT64_MAX, &copied);
+}
+
+static int stored_decompress_stream(FILE *src, FILE *dst, uint64_t orig_size) {
+  uint64_t copied = 0;
+  if (stored_copy_fp(src, dst, orig_size, &copied) != 0 ||
+      copied != orig_size) {
+    return -1; // truncated payload
+  }
+  return fgetc(src) == EOF && !ferror(src) ? 0 : -1; // trailing data
+}
+
+// ---- Backend Definition ----
+
+static const CBackend stored_backend = {
+    .name = "stored",
+    .id = ALGO_NONE,
+    .is_available = stored_is_available,
+    .max_compressed_size = stored_max_compressed_size,
+    .compress_buffer = stored_compress_buffer,
+    .decompress_buffer = stored_decompress_buffer,
+    .compress_stream = stored_compress_stream,
+    .decompress_stream = stored_decompress_stream,
+    .stream_new = stored_stream_new,
+    .stream_free = stored_stream_free,
+    .stream_compress_step = stored_stream_compress_step,
+    .stream_decompress_step = stored_stream_decompress_step,
+};
+
+const CBackend *get_stored_backend(void) { return &stored_backend; }
@@ -1,7 +1,8 @@
 #define PY_SSIZE_T_CLEAN
-#define ZLIB_CHUNK 65536 // 64KB
 #include "../common.h"
+#include "../deflate_accel.h"
 #include <Python.h>
+#include <limits.h>
 #include <zlib.h>
 
 static int zlib_is_available(void) {
@@ -14,18 +15,29 @@ static size_t zlib_max_compressed_size(size_t input_size) {
 
 // ---- Buffer Compression/Decompression ----
 
+// Whole buffers go through libdeflate when it is loaded (deflate_accel.h);
+// it writes and reads the same zlib streams as compress2/uncompress, which
+// take over whenever it declines
+
 static int zlib_compress_buffer(const unsigned char *input, size_t input_size,
                                 unsigned char *output, size_t *output_capacity,
                                 int level, size_t *output_size) {
   uLongf dest_len = (uLongf)(*output_capacity);
-  int ret;
-
-  Py_BEGIN_ALLOW_THREADS ret =
-      compress2(output, &dest_len, input, (uLongf)input_size,
-                (level >= 0 && level <= 9) ? level : Z_DEFAULT_COMPRESSION);
-  Py_END_ALLOW_THREADS
-
-      if (ret != Z_OK) {
+  int ret = Z_OK;
+  int accel;
+
+  COMP_BEGIN_ALLOW_THREADS accel =
+      deflate_accel_compress(NULL, level, DEFLATE_ZLIB, input, input_size,
+                             output, *output_capacity, output_size);
+  if (accel != 0)
+    ret = compress2(output, &dest_len, input, (uLongf)input_size,
+                    (level >= 0 && level <= 9) ? level : Z_DEFAULT_COMPRESSION);
+  COMP_END_ALLOW_THREADS
+
+      if (accel == 0) {
+    return 0;
+  }
+  if (ret != Z_OK) {
     return -1; // compression failed
   }
 
@@ -38,13 +50,20 @@ static int zlib_decompress_buffer(const unsigned char *input, size_t input_size,
                                   size_t *output_capacity,
                                   size_t *output_size) {
   uLongf dest_len = (uLongf)(*output_capacity);
-  int ret;
-
-  Py_BEGIN_ALLOW_THREADS ret =
-      uncompress(output, &dest_len, input, (uLongf)input_size);
-  Py_END_ALLOW_THREADS
-
-      if (ret != Z_OK) {
+  int ret = Z_OK;
+  int accel;
+
+  COMP_BEGIN_ALLOW_THREADS accel =
+      deflate_accel_decompress(NULL, DEFLATE_ZLIB, input, input_size, output,
+                               *output_capacity, output_size, NULL);
+  if (accel != 0)
+    ret = uncompress(output, &dest_len, input, (uLongf)input_size);
+  COMP_END_ALLOW_THREADS
+
+      if (accel == 0) {
+    return 0;
+  }
+  if (ret != Z_OK) {
     return -1; // decompression failed
   }
 
@@ -52,133 +71,282 @@ static int zlib_decompress_buffer(const unsigned char *input, size_t input_size,
   return 0; // success
 }
 
-// ---- Stream Compression/Decompression ----
+// ---- Reusable Contexts ----
 
-static int zlib_compress_stream(FILE *src, FILE *dst, int level) {
-  int ret;
-  int flush;
-  unsigned char input[ZLIB_CHUNK];
-  unsigned char output[ZLIB_CHUNK];
+// A z_stream kept initialised between calls and rewound with
+// deflateReset/inflateReset instead of being torn down, beside a libdeflate
+// (de)compressor when the library is loaded
+typedef struct {
   z_stream strm;
+  int level; // level the deflate state was last configured for
+  void *accel;
+  int accel_level; // level accel was made for
+} ZlibContext;
 
-  memset(&strm, 0, sizeof(strm));
+static int zlib_level(int level) {
+  return (level >= 0 && level <= 9) ? level : Z_DEFAULT_COMPRESSION;
+}
 
-  int zlevel = (level >= 0 && level <= 9) ? level : Z_DEFAULT_COMPRESSION;
+static void *zlib_context_new(int compress) {
+  ZlibContext *zctx = (ZlibContext *)calloc(1, sizeof(ZlibContext));
+  if (!zctx)
+    return NULL;
 
-  ret = deflateInit(&strm, zlevel);
+  zctx->level = Z_DEFAULT_COMPRESSION;
+  int ret = compress ? deflateInit(&zctx->strm, zctx->level)
+                     : inflateInit(&zctx->strm);
   if (ret != Z_OK) {
-    return -1; // initialisation failed
+    free(zctx);
+    return NULL;
   }
+  zctx->accel_level = zctx->level;
+  zctx->accel = compress ? deflate_accel_compressor_new(zctx->level)
+                         : deflate_accel_decompressor_new();
+  return zctx;
+}
 
-  Py_BEGIN_ALLOW_THREADS
+static void zlib_context_free(void *ctx, int compress) {
+  ZlibContext *zctx = (ZlibContext *)ctx;
+  if (compress) {
+    deflateEnd(&zctx->strm);
+    deflate_accel_compressor_free(zctx->accel);
+  } else {
+    inflateEnd(&zctx->strm);
+    deflate_accel_decompressor_free(zctx->accel);
+  }
+  free(zctx);
+}
 
-      do {
-    strm.avail_in = (uInt)fread(input, 1, ZLIB_CHUNK, src);
-    if (ferror(src)) {
-      ret = Z_ERRNO;
-      break;
+static int zlib_compress_buffer_ctx(void *ctx, const unsigned char *input,
+                                    size_t input_size, unsigned char *output,
+                                    size_t *output_capacity, int level,
+                                    size_t *output_size) {
+  ZlibContext *zctx = (ZlibContext *)ctx;
+
+  if (zctx->accel && zlib_level(level) != zctx->accel_level) {
+    deflate_accel_compressor_free(zctx->accel);
+    zctx->accel_level = zlib_level(level);
+    zctx->accel = deflate_accel_compressor_new(zctx->accel_level);
+  }
+  if (zctx->accel) {
+    int accel;
+    COMP_BEGIN_ALLOW_THREADS accel = deflate_accel_compress(
+        zctx->accel, level, DEFLATE_ZLIB, input, input_size, output,
+        *output_capacity, output_size);
+    COMP_END_ALLOW_THREADS
+
+        if (accel == 0) {
+      return 0;
     }
-    flush = feof(src) ? Z_FINISH : Z_NO_FLUSH;
+  }
 
-    strm.next_in = input;
+  // avail_in/avail_out are 32-bit; very large buffers take the one-shot path
+  if (input_size > UINT_MAX || *output_capacity > UINT_MAX) {
+    return zlib_compress_buffer(input, input_size, output, output_capacity,
+                                level, output_size);
+  }
 
-    do {
-      strm.avail_out = ZLIB_CHUNK;
-      strm.next_out = output;
+  z_stream *strm = &zctx->strm;
+  if (deflateReset(strm) != Z_OK)
+    return -1;
 
-      ret = deflate(&strm, flush);
-      if (ret == Z_STREAM_ERROR) {
-        break;
-      }
+  int zlevel = zlib_level(level);
+  if (zlevel != zctx->level) {
+    if (deflateParams(strm, zlevel, Z_DEFAULT_STRATEGY) != Z_OK)
+      return -1;
+    zctx->level = zlevel;
+  }
 
-      size_t have = ZLIB_CHUNK - strm.avail_out;
-      if (fwrite(output, 1, have, dst) != have || ferror(dst)) {
-        ret = Z_ERRNO;
-        break;
-      }
-    } while (strm.avail_out == 0);
+  strm->next_in = (Bytef *)input;
+  strm->avail_in = (uInt)input_size;
+  strm->next_out = output;
+  strm->avail_out = (uInt)*output_capacity;
 
-    if (ret == Z_ERRNO || ret == Z_STREAM_ERROR) {
-      break;
+  int ret;
+  COMP_BEGIN_ALLOW_THREADS ret = deflate(strm, Z_FINISH);
+  COMP_END_ALLOW_THREADS
+
+      if (ret != Z_STREAM_END) {
+    return -1; // compression failed or output buffer too small
+  }
+
+  *output_size = (size_t)strm->total_out;
+  return 0; // success
+}
+
+static int zlib_decompress_buffer_ctx(void *ctx, const unsigned char *input,
+                                      size_t input_size, unsigned char *output,
+                                      size_t *output_capacity,
+                                      size_t *output_size) {
+  ZlibContext *zctx = (ZlibContext *)ctx;
+
+  if (zctx->accel) {
+    int accel;
+    COMP_BEGIN_ALLOW_THREADS accel = deflate_accel_decompress(
+        zctx->accel, DEFLATE_ZLIB, input, input_size, output, *output_capacity,
+        output_size, NULL);
+    COMP_END_ALLOW_THREADS
+
+        if (accel == 0) {
+      return 0;
     }
   }
-  while (flush != Z_FINISH)
-    ;
 
-  deflateEnd(&strm);
+  if (input_size > UINT_MAX || *output_capacity > UINT_MAX) {
+    return zlib_decompress_buffer(input, input_size, output, output_capacity,
+                                  output_size);
+  }
+
+  z_stream *strm = &zctx->strm;
+  if (inflateReset(strm) != Z_OK)
+    return -1;
 
-  Py_END_ALLOW_THREADS
+  strm->next_in = (Bytef *)input;
+  strm->avail_in = (uInt)input_size;
+  strm->next_out = output;
+  strm->avail_out = (uInt)*output_capacity;
+
+  int ret;
+  COMP_BEGIN_ALLOW_THREADS ret = inflate(strm, Z_FINISH);
+  COMP_END_ALLOW_THREADS
 
       if (ret != Z_STREAM_END) {
-    return -1; // compression failed
+    return -1; // corrupt, truncated, or output buffer too small
   }
 
+  *output_size = (size_t)strm->total_out;
   return 0; // success
 }
 
-static int zlib_decompress_stream(FILE *src, FILE *dst, uint64_t orig_size) {
-  (void)orig_size; // unused parameter
+// ---- Memory Streaming ----
 
-  int ret;
-  unsigned char input[ZLIB_CHUNK];
-  unsigned char output[ZLIB_CHUNK];
+typedef struct {
   z_stream strm;
+  int ended; // decompression: stream end seen, trailing data is ignored
+} ZlibStream;
+
+static void *zlib_stream_new(int compress, int level) {
+  ZlibStream *zs = (ZlibStream *)calloc(1, sizeof(ZlibStream));
+  if (!zs)
+    return NULL;
 
-  memset(&strm, 0, sizeof(strm));
-  ret = inflateInit(&strm);
+  int ret = compress ? deflateInit(&zs->strm, zlib_level(level))
+                     : inflateInit(&zs->strm);
   if (ret != Z_OK) {
-    return -1; // initialisation failed
+    free(zs);
+    return NULL;
   }
+  return zs;
+}
 
-  Py_BEGIN_ALLOW_THREADS
+static void zlib_stream_free(void *state, int compress) {
+  ZlibStream *zs = (ZlibStream *)state;
+  if (compress)
+    deflateEnd(&zs->strm);
+  else
+    inflateEnd(&zs->strm);
+  free(zs);
+}
 
-      do {
-    strm.avail_in = (uInt)fread(input, 1, ZLIB_CHUNK, src);
-    if (ferror(src)) {
-      ret = Z_ERRNO;
-      break;
+// avail_in/avail_out are 32-bit, so large buffers go through in slices
+static void zlib_stream_load(z_stream *strm, CStreamIn *in, CStreamOut *out) {
+  size_t in_left = in->size - in->pos;
+  size_t out_left = out->size - out->pos;
+  strm->next_in = (Bytef *)(in->src + in->pos);
+  strm->avail_in = (uInt)(in_left > UINT_MAX ? UINT_MAX : in_left);
+  strm->next_out = out->dst + out->pos;
+  strm->avail_out = (uInt)(out_left > UINT_MAX ? UINT_MAX : out_left);
+}
+
+static void zlib_stream_store(z_stream *strm, CStreamIn *in, CStreamOut *out) {
+  in->pos = (size_t)(strm->next_in - (const Bytef *)in->src);
+  out->pos = (size_t)(strm->next_out - out->dst);
+}
+
+static int zlib_stream_compress_step(void *state, CStreamIn *in,
+                                     CStreamOut *out, CStreamOp op) {
+  z_stream *strm = &((ZlibStream *)state)->strm;
+  int flush = op == C_STREAM_FINISH  ? Z_FINISH
+              : op == C_STREAM_FLUSH ? Z_SYNC_FLUSH
+                                     : Z_NO_FLUSH;
+
+  for (;;) {
+    zlib_stream_load(strm, in, out);
+    int ret = deflate(strm, flush);
+    int out_full = strm->avail_out == 0;
+    zlib_stream_store(strm, in, out);
+
+    if (ret == Z_STREAM_ERROR)
+      return C_STREAM_ERROR;
+    if (ret == Z_STREAM_END)
+      return C_STREAM_OK; // finished
+    if (out_full)
+      return C_STREAM_MORE;
+    if (in->pos == in->size && flush != Z_FINISH)
+      return C_STREAM_OK; // Z_BUF_ERROR here just means nothing to do
+  }
+}
+
+static int zlib_stream_decompress_step(void *state, CStreamIn *in,
+                                       CStreamOut *out) {
+  ZlibStream *zs = (ZlibStream *)state;
+  z_stream *strm = &zs->strm;
+
+  for (;;) {
+    if (zs->ended) {
+      in->pos = in->size;
+      return C_STREAM_END;
     }
-    if (strm.avail_in == 0) {
-      break; // end of file
+
+    zlib_stream_load(strm, in, out);
+    int ret = inflate(strm, Z_NO_FLUSH);
+    int out_full = strm->avail_out == 0;
+    zlib_stream_store(strm, in, out);
+
+    switch (ret) {
+    case Z_STREAM_END:
+      zs->ended = 1;
+      continue;
+    case Z_NEED_DICT:
+    case Z_DATA_ERROR:
+    case Z_MEM_ERROR:
+    case Z_STREAM_ERROR:
+      return C_STREAM_ERROR;
     }
-    strm.next_in = input;
-
-    do {
-      strm.avail_out = ZLIB_CHUNK;
-      strm.next_out = output;
-
-      ret = inflate(&strm, Z_NO_FLUSH);
-      if (ret == Z_STREAM_ERROR) {
-        ret = Z_DATA_ERROR;
-        break;
-      }
-      switch (ret) {
-      case Z_NEED_DICT:
-      case Z_DATA_ERROR:
-      case Z_MEM_ERROR:
-        goto done;
-      }
-
-      size_t have = ZLIB_CHUNK - strm.avail_out;
-      if (fwrite(output, 1, have, dst) != have || ferror(dst)) {
-        ret = Z_ERRNO;
-        goto done;
-      }
-    } while (strm.avail_out == 0);
-  }
-  while (ret != Z_STREAM_END)
-    ;
-
-done:
-  inflateEnd(&strm);
-
-  Py_END_ALLOW_THREADS
 
-      if (ret != Z_STREAM_END) {
-    return -1; // decompression failed
+    if (out_full)
+      return C_STREAM_MORE;
+    if (in->pos == in->size)
+      return C_STREAM_OK;
   }
+}
 
-  return 0; // success
+// ---- Stream Compression/Decompression ----
+
+static int zlib_compress_stream(FILE *src, FILE *dst, int level,
+                                uint64_t size) {
+  (void)size; // the format has no field for it
+  void *state = zlib_stream_new(1, level);
+  if (!state) {
+    return -1; // initialisation failed
+  }
+
+  int ret = stream_compress_fp(zlib_stream_compress_step, state, src, dst);
+  zlib_stream_free(state, 1);
+  return ret;
+}
+
+static int zlib_decompress_stream(FILE *src, FILE *dst, uint64_t orig_size) {
+  (void)orig_size; // unused parameter
+
+  void *state = zlib_stream_new(0, -1);
+  if (!state) {
+    return -1; // initialisation failed
+  }
+
+  int ret = stream_decompress_fp(zlib_stream_decompress_step, state, src, dst);
+  zlib_stream_free(state, 0);
+  return ret;
 }
 
 // ---- Backend Definition ----
@@ -192,6 +360,15 @@ static const CBackend zlib_backend = {
     .decompress_buffer = zlib_decompress_buffer,
     .compress_stream = zlib_compress_stream,
     .decompress_stream = zlib_decompress_stream,
+    .context_new = zlib_context_new,
+    .context_free = zlib_context_free,
+    .compress_buffer_ctx = zlib_compress_buffer_ctx,
+    .decompress_buffer_ctx = zlib_decompress_buffer_ctx,
+    .stream_new = zlib_stream_new,
+    .stream_free = zlib_stream_free,
+    .stream_compress_step = zlib_stream_compress_step,
+    .stream_decompress_step = zlib_stream_decompress_step,
+    .implementation = deflate_accel_name,
 };
 
 const CBackend *get_zlib_backend(void) { return &zlib_backend; }
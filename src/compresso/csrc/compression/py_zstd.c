@@ -1,7 +1,8 @@
 #define PY_SSIZE_T_CLEAN
-#define ZSTD_CHUNK 65536 // 64KB
 #include "../common.h"
 #include <Python.h>
+#include <stdlib.h>
+#include <zdict.h>
 #include <zstd.h>
 
 static int zstd_is_available(void) {
@@ -28,10 +29,10 @@ static int zstd_compress_buffer(const unsigned char *input, size_t input_size,
   int zlevel =
       (level >= 0) ? zstd_level_from_generic(level) : ZSTD_CLEVEL_DEFAULT;
 
-  int ret;
-  Py_BEGIN_ALLOW_THREADS ret =
+  size_t ret;
+  COMP_BEGIN_ALLOW_THREADS ret =
       ZSTD_compress(output, *output_capacity, input, input_size, zlevel);
-  Py_END_ALLOW_THREADS
+  COMP_END_ALLOW_THREADS
 
       if (ZSTD_isError(ret)) {
     return -1; // compression failed
@@ -45,10 +46,10 @@ static int zstd_decompress_buffer(const unsigned char *input, size_t input_size,
                                   unsigned char *output,
                                   size_t *output_capacity,
                                   size_t *output_size) {
-  int ret;
-  Py_BEGIN_ALLOW_THREADS ret =
+  size_t ret;
+  COMP_BEGIN_ALLOW_THREADS ret =
       ZSTD_decompress(output, *output_capacity, input, input_size);
-  Py_END_ALLOW_THREADS
+  COMP_END_ALLOW_THREADS
 
       if (ZSTD_isError(ret)) {
     return -1; // decompression failed
@@ -58,139 +59,378 @@ static int zstd_decompress_buffer(const unsigned char *input, size_t input_size,
   return 0; // success
 }
 
-// ---- Stream Compression/Decompression ----
+// ---- Reusable Contexts ----
+
+static void *zstd_context_new(int compress) {
+  return compress ? (void *)ZSTD_createCCtx() : (void *)ZSTD_createDCtx();
+}
 
-static int zstd_compress_stream(FILE *src, FILE *dst, int level) {
+static void zstd_context_free(void *ctx, int compress) {
+  if (compress)
+    ZSTD_freeCCtx((ZSTD_CCtx *)ctx);
+  else
+    ZSTD_freeDCtx((ZSTD_DCtx *)ctx);
+}
+
+static int zstd_compress_buffer_ctx(void *ctx, const unsigned char *input,
+                                    size_t input_size, unsigned char *output,
+                                    size_t *output_capacity, int level,
+                                    size_t *output_size) {
   int zlevel =
       (level >= 0) ? zstd_level_from_generic(level) : ZSTD_CLEVEL_DEFAULT;
 
-  ZSTD_CStream *cstream = ZSTD_createCStream();
-  if (!cstream)
-    return -1; // memory allocation failure
+  size_t ret;
+  COMP_BEGIN_ALLOW_THREADS ret = ZSTD_compressCCtx(
+      (ZSTD_CCtx *)ctx, output, *output_capacity, input, input_size, zlevel);
+  COMP_END_ALLOW_THREADS
 
-  size_t ret = ZSTD_initCStream(cstream, zlevel);
-  if (ZSTD_isError(ret)) {
-    ZSTD_freeCStream(cstream);
-    return -1; // initialisation failure
+      if (ZSTD_isError(ret)) {
+    return -1; // compression failed
   }
 
-  unsigned char input[ZSTD_CHUNK];
-  unsigned char output[ZSTD_CHUNK];
+  *output_size = ret;
+  return 0; // success
+}
+
+static int zstd_decompress_buffer_ctx(void *ctx, const unsigned char *input,
+                                      size_t input_size, unsigned char *output,
+                                      size_t *output_capacity,
+                                      size_t *output_size) {
+  size_t ret;
+  COMP_BEGIN_ALLOW_THREADS ret = ZSTD_decompressDCtx(
+      (ZSTD_DCtx *)ctx, output, *output_capacity, input, input_size);
+  COMP_END_ALLOW_THREADS
+
+      if (ZSTD_isError(ret)) {
+    return -1; // decompression failed
+  }
 
-  int err = 0;
-  Py_BEGIN_ALLOW_THREADS
+  *output_size = ret;
+  return 0; // success
+}
 
-      for (;;) {
-    size_t read = fread(input, 1, ZSTD_CHUNK, src);
-    if (ferror(src)) {
-      err = -1;
-      break;
+// ---- Memory Streaming ----
+
+// workers == 0 keeps compression on the calling thread; otherwise libzstd
+// spawns its own pool and the output stays a single standard frame
+typedef struct {
+  ZSTD_DStream *dstream;
+  int at_boundary; // the last input consumed completed a frame
+} ZstdDecodeStream;
+
+static void *zstd_stream_new_workers(int compress, int level, int workers) {
+  if (!compress) {
+    ZstdDecodeStream *zs =
+        (ZstdDecodeStream *)calloc(1, sizeof(ZstdDecodeStream));
+    if (zs && !(zs->dstream = ZSTD_createDStream())) {
+      free(zs);
+      zs = NULL;
     }
+    return zs;
+  }
 
-    int last_chunk = feof(src);
+  int zlevel =
+      (level >= 0) ? zstd_level_from_generic(level) : ZSTD_CLEVEL_DEFAULT;
 
-    ZSTD_inBuffer inbuf = {input, read, 0};
+  ZSTD_CStream *cstream = ZSTD_createCStream();
+  if (!cstream)
+    return NULL; // memory allocation failure
 
-    while (inbuf.pos < inbuf.size || last_chunk) {
-      ZSTD_outBuffer outbuf = {output, ZSTD_CHUNK, 0};
-      ZSTD_EndDirective mode = last_chunk ? ZSTD_e_end : ZSTD_e_continue;
+  if (ZSTD_isError(
+          ZSTD_CCtx_setParameter(cstream, ZSTD_c_compressionLevel, zlevel))) {
+    ZSTD_freeCStream(cstream);
+    return NULL; // initialisation failure
+  }
 
-      size_t r = ZSTD_compressStream2(cstream, &outbuf, &inbuf, mode);
-      if (ZSTD_isError(r)) {
-        err = -1;
-        break;
-      }
+  if (workers > 0) {
+    // A libzstd built without ZSTD_MULTITHREAD rejects this; fall back to
+    // single-threaded compression rather than failing the request
+    (void)ZSTD_CCtx_setParameter(cstream, ZSTD_c_nbWorkers, workers);
+  }
+  return cstream;
+}
 
-      if (outbuf.pos > 0) {
-        if (fwrite(output, 1, outbuf.pos, dst) != outbuf.pos || ferror(dst)) {
-          err = -1;
-          break;
-        }
-      }
+static void *zstd_stream_new(int compress, int level) {
+  return zstd_stream_new_workers(compress, level, 0);
+}
 
-      if (!last_chunk && inbuf.pos == inbuf.size && outbuf.pos == 0) {
-        break; // need more input
-      }
+static void zstd_stream_free(void *state, int compress) {
+  if (compress) {
+    ZSTD_freeCStream((ZSTD_CStream *)state);
+  } else {
+    ZSTD_freeDStream(((ZstdDecodeStream *)state)->dstream);
+    free(state);
+  }
+}
 
-      if (last_chunk && r == 0) {
-        break; // finished
-      }
-    }
+static int zstd_stream_compress_step(void *state, CStreamIn *in,
+                                     CStreamOut *out, CStreamOp op) {
+  ZSTD_EndDirective mode = op == C_STREAM_FINISH  ? ZSTD_e_end
+                           : op == C_STREAM_FLUSH ? ZSTD_e_flush
+                                                  : ZSTD_e_continue;
 
-    if (err || last_chunk) {
-      break;
+  for (;;) {
+    ZSTD_inBuffer inbuf = {in->src, in->size, in->pos};
+    ZSTD_outBuffer outbuf = {out->dst, out->size, out->pos};
+
+    size_t r =
+        ZSTD_compressStream2((ZSTD_CStream *)state, &outbuf, &inbuf, mode);
+    in->pos = inbuf.pos;
+    out->pos = outbuf.pos;
+
+    if (ZSTD_isError(r))
+      return C_STREAM_ERROR;
+    if (mode != ZSTD_e_continue && r == 0)
+      return C_STREAM_OK; // flushed or finished
+    if (out->pos == out->size)
+      return C_STREAM_MORE;
+    if (mode == ZSTD_e_continue && in->pos == in->size)
+      return C_STREAM_OK;
+  }
+}
+
+// Concatenated frames decode back to back; END means the input stopped on
+// a frame boundary
+static int zstd_stream_decompress_step(void *state, CStreamIn *in,
+                                       CStreamOut *out) {
+  ZstdDecodeStream *zs = (ZstdDecodeStream *)state;
+
+  for (;;) {
+    if (in->pos == in->size && zs->at_boundary)
+      return C_STREAM_END; // nothing buffered past the last frame
+
+    ZSTD_inBuffer inbuf = {in->src, in->size, in->pos};
+    ZSTD_outBuffer outbuf = {out->dst, out->size, out->pos};
+
+    size_t r = ZSTD_decompressStream(zs->dstream, &outbuf, &inbuf);
+    if (inbuf.pos != in->pos)
+      zs->at_boundary = 0;
+    in->pos = inbuf.pos;
+    out->pos = outbuf.pos;
+
+    if (ZSTD_isError(r))
+      return C_STREAM_ERROR;
+    if (r == 0) {
+      zs->at_boundary = 1; // frame complete and fully flushed
+      continue;
     }
+    if (out->pos == out->size)
+      return C_STREAM_MORE;
+    if (in->pos == in->size)
+      return C_STREAM_OK;
+  }
+}
+
+// ---- Stream Compression/Decompression ----
+
+// A pledged size lets libzstd fit its parameters (a small input gets a
+// small window) and write the frame content size, which the decoder checks
+static int zstd_compress_stream_workers(FILE *src, FILE *dst, int level,
+                                        int workers, uint64_t size) {
+  void *state = zstd_stream_new_workers(1, level, workers);
+  if (!state)
+    return -1; // initialisation failure
+  if (ZSTD_isError(ZSTD_CCtx_setPledgedSrcSize((ZSTD_CStream *)state, size))) {
+    zstd_stream_free(state, 1);
+    return -1;
   }
 
-  Py_END_ALLOW_THREADS
+  int err = stream_compress_fp(zstd_stream_compress_step, state, src, dst);
+  zstd_stream_free(state, 1);
+  return err;
+}
 
-      ZSTD_freeCStream(cstream);
+static int zstd_compress_stream(FILE *src, FILE *dst, int level,
+                                uint64_t size) {
+  return zstd_compress_stream_workers(src, dst, level, 0, size);
+}
 
-  return err ? -1 : 0; // success or failure
+static int zstd_compress_stream_mt(FILE *src, FILE *dst, int level,
+                                   int threads, uint64_t size) {
+  return zstd_compress_stream_workers(src, dst, level, threads, size);
 }
 
 static int zstd_decompress_stream(FILE *src, FILE *dst, uint64_t orig_size) {
   (void)orig_size; // unused
 
-  ZSTD_DStream *dstream = ZSTD_createDStream();
-  if (!dstream)
+  void *state = zstd_stream_new(0, -1);
+  if (!state)
+    return -1; // memory allocation failure
+
+  int err = stream_decompress_fp(zstd_stream_decompress_step, state, src, dst);
+  zstd_stream_free(state, 0);
+  return err;
+}
+
+// ---- Dictionaries ----
+
+static void *zstd_dict_new(const unsigned char *data, size_t size,
+                           int compress, int level) {
+  if (!compress)
+    return ZSTD_createDDict(data, size);
+
+  int zlevel =
+      (level >= 0) ? zstd_level_from_generic(level) : ZSTD_CLEVEL_DEFAULT;
+  return ZSTD_createCDict(data, size, zlevel);
+}
+
+static void zstd_dict_free(void *dict, int compress) {
+  if (compress)
+    ZSTD_freeCDict((ZSTD_CDict *)dict);
+  else
+    ZSTD_freeDDict((ZSTD_DDict *)dict);
+}
+
+static int zstd_compress_buffer_dict(void *ctx, const void *dict,
+                                     const unsigned char *input,
+                                     size_t input_size, unsigned char *output,
+                                     size_t *output_capacity,
+                                     size_t *output_size) {
+  ZSTD_CCtx *cctx = ctx ? (ZSTD_CCtx *)ctx : ZSTD_createCCtx();
+  if (!cctx)
     return -1; // memory allocation failure
 
-  size_t ret = ZSTD_initDStream(dstream);
+  size_t ret;
+  COMP_BEGIN_ALLOW_THREADS ret =
+      ZSTD_compress_usingCDict(cctx, output, *output_capacity, input,
+                               input_size, (const ZSTD_CDict *)dict);
+  COMP_END_ALLOW_THREADS
+
+      if (!ctx) {
+    ZSTD_freeCCtx(cctx);
+  }
+
   if (ZSTD_isError(ret)) {
-    ZSTD_freeDStream(dstream);
-    return -1; // initialisation failure
+    return -1; // compression failed
   }
 
-  unsigned char input[ZSTD_CHUNK];
-  unsigned char output[ZSTD_CHUNK];
+  *output_size = ret;
+  return 0; // success
+}
 
-  int err = 0;
-  Py_BEGIN_ALLOW_THREADS
+static int zstd_decompress_buffer_dict(void *ctx, const void *dict,
+                                       const unsigned char *input,
+                                       size_t input_size,
+                                       unsigned char *output,
+                                       size_t *output_capacity,
+                                       size_t *output_size) {
+  ZSTD_DCtx *dctx = ctx ? (ZSTD_DCtx *)ctx : ZSTD_createDCtx();
+  if (!dctx)
+    return -1; // memory allocation failure
 
-      size_t input_size = 0;
-  size_t input_pos = 0;
+  size_t ret;
+  COMP_BEGIN_ALLOW_THREADS ret =
+      ZSTD_decompress_usingDDict(dctx, output, *output_capacity, input,
+                                 input_size, (const ZSTD_DDict *)dict);
+  COMP_END_ALLOW_THREADS
 
-  for (;;) {
-    if (input_pos == input_size) {
-      input_size = fread(input, 1, ZSTD_CHUNK, src);
-      if (ferror(src)) {
-        err = -1;
-        break;
-      }
-      input_pos = 0;
-
-      if (input_size == 0) {
-        break; // end of input
-      }
-    }
+      if (!ctx) {
+    ZSTD_freeDCtx(dctx);
+  }
 
-    ZSTD_inBuffer inbuf = {input + input_pos, input_size - input_pos, 0};
-    ZSTD_outBuffer outbuf = {output, ZSTD_CHUNK, 0};
+  if (ZSTD_isError(ret)) {
+    return -1; // decompression failed
+  }
 
-    size_t r = ZSTD_decompressStream(dstream, &outbuf, &inbuf);
-    if (ZSTD_isError(r)) {
-      err = -1;
-      break;
-    }
+  *output_size = ret;
+  return 0; // success
+}
 
-    input_pos += inbuf.pos;
+// The stream references the digest, which outlives it
+static void *zstd_stream_new_dict(int compress, int level, const void *dict) {
+  void *state = zstd_stream_new(compress, level);
+  if (!state)
+    return NULL;
+
+  size_t ret =
+      compress
+          ? ZSTD_CCtx_refCDict((ZSTD_CStream *)state, (const ZSTD_CDict *)dict)
+          : ZSTD_DCtx_refDDict(((ZstdDecodeStream *)state)->dstream,
+                               (const ZSTD_DDict *)dict);
+  if (ZSTD_isError(ret)) {
+    zstd_stream_free(state, compress);
+    return NULL;
+  }
+  return state;
+}
 
-    if (outbuf.pos > 0) {
-      if (fwrite(output, 1, outbuf.pos, dst) != outbuf.pos || ferror(dst)) {
-        err = -1;
-        break;
-      }
-    }
+static int zstd_dict_train(const unsigned char *samples,
+                           const size_t *sample_sizes, unsigned count,
+                           unsigned char *dict, size_t *dict_size) {
+  size_t ret;
+  COMP_BEGIN_ALLOW_THREADS ret =
+      ZDICT_trainFromBuffer(dict, *dict_size, samples, sample_sizes, count);
+  COMP_END_ALLOW_THREADS
 
-    if (r == 0 && input_pos == input_size && feof(src)) {
-      break; // finished
-    }
+      if (ZDICT_isError(ret)) {
+    return -1; // training failed
   }
 
-  Py_END_ALLOW_THREADS ZSTD_freeDStream(dstream);
+  *dict_size = ret;
+  return 0; // success
+}
+
+// ---- Advanced Parameters ----
+
+static int zstd_check_param(ZSTD_cParameter param, int value,
+                            const char *name) {
+  ZSTD_bounds bounds = ZSTD_cParam_getBounds(param);
+  if (ZSTD_isError(bounds.error) || value < bounds.lowerBound ||
+      value > bounds.upperBound) {
+    PyErr_Format(PyExc_ValueError,
+                 "%s must be between %d and %d, or 0 for the level's", name,
+                 bounds.lowerBound, bounds.upperBound);
+    return -1;
+  }
+  return 0;
+}
+
+static int zstd_check_params(const CodecParams *params) {
+  if (params->window_log &&
+      zstd_check_param(ZSTD_c_windowLog, params->window_log, "window_log") !=
+          0)
+    return -1;
+  if (params->match_strategy &&
+      zstd_check_param(ZSTD_c_strategy, params->match_strategy,
+                       "match_strategy") != 0)
+    return -1;
+  return 0;
+}
 
-  return err ? -1 : 0; // success or failure
+// Long-distance matching on its own widens the window to 128 MB, which
+// the default decoder limit still covers; a larger window_log is recorded
+// in the file header for stream_new_window
+static void *zstd_stream_new_params(int level, const CodecParams *params,
+                                    int workers, uint64_t size) {
+  ZSTD_CStream *cstream =
+      (ZSTD_CStream *)zstd_stream_new_workers(1, level, workers);
+  if (!cstream)
+    return NULL;
+
+  if ((params->long_distance &&
+       ZSTD_isError(ZSTD_CCtx_setParameter(
+           cstream, ZSTD_c_enableLongDistanceMatching, 1))) ||
+      (params->window_log &&
+       ZSTD_isError(ZSTD_CCtx_setParameter(cstream, ZSTD_c_windowLog,
+                                           params->window_log))) ||
+      (params->match_strategy &&
+       ZSTD_isError(ZSTD_CCtx_setParameter(cstream, ZSTD_c_strategy,
+                                           params->match_strategy))) ||
+      ZSTD_isError(ZSTD_CCtx_setPledgedSrcSize(cstream, size))) {
+    ZSTD_freeCStream(cstream);
+    return NULL; // rejected after check_params passed
+  }
+  return cstream;
+}
+
+static void *zstd_stream_new_window(unsigned window_log) {
+  ZstdDecodeStream *zs = (ZstdDecodeStream *)zstd_stream_new(0, -1);
+  if (zs && ZSTD_isError(ZSTD_DCtx_setParameter(
+                zs->dstream, ZSTD_d_windowLogMax, (int)window_log))) {
+    zstd_stream_free(zs, 0);
+    return NULL; // beyond what this libzstd can decode
+  }
+  return zs;
 }
 
 // ---- Backend Definition ----
@@ -204,6 +444,25 @@ static const CBackend zstd_backend = {
     .decompress_buffer = zstd_decompress_buffer,
     .compress_stream = zstd_compress_stream,
     .decompress_stream = zstd_decompress_stream,
+    .compress_stream_mt = zstd_compress_stream_mt,
+    .one_shot_max = C_ONE_SHOT_MAX,
+    .context_new = zstd_context_new,
+    .context_free = zstd_context_free,
+    .compress_buffer_ctx = zstd_compress_buffer_ctx,
+    .decompress_buffer_ctx = zstd_decompress_buffer_ctx,
+    .stream_new = zstd_stream_new,
+    .stream_free = zstd_stream_free,
+    .stream_compress_step = zstd_stream_compress_step,
+    .stream_decompress_step = zstd_stream_decompress_step,
+    .dict_new = zstd_dict_new,
+    .dict_free = zstd_dict_free,
+    .compress_buffer_dict = zstd_compress_buffer_dict,
+    .decompress_buffer_dict = zstd_decompress_buffer_dict,
+    .stream_new_dict = zstd_stream_new_dict,
+    .dict_train = zstd_dict_train,
+    .check_params = zstd_check_params,
+    .stream_new_params = zstd_stream_new_params,
+    .stream_new_window = zstd_stream_new_window,
 };
 
 const CBackend *get_zstd_backend(void) { return &zstd_backend; }
@@ -0,0 +1,222 @@
+#define PY_SSIZE_T_CLEAN
+#define STREAM_MEM_CHUNK 65536 // 64KB growth step of the memory drivers
+#include "../common.h"
+#include "../fileio.h"
+#include <Python.h>
+#include <stdlib.h>
+
+// ---- stdio Drivers ----
+
+// Both drivers move io_chunk_size() pieces through an IOReader/IOWriter,
+// so under the io_uring engine the next reads and the last writes are in
+// flight while the codec runs
+
+int stream_compress_fp(CStreamCompressFn step, void *state, FILE *src,
+                       FILE *dst) {
+  IOReader *reader = io_reader_open(src);
+  IOWriter *writer = io_writer_open(dst);
+  int err = reader && writer ? 0 : -1;
+  COMP_BEGIN_ALLOW_THREADS
+
+      CStreamOp op = C_STREAM_RUN;
+  while (op != C_STREAM_FINISH && !err) {
+    const unsigned char *input;
+    size_t nread;
+    int at_end;
+    if (io_reader_next(reader, &input, &nread, &at_end) != 0) {
+      err = -1;
+      break;
+    }
+    if (at_end) {
+      op = C_STREAM_FINISH;
+    }
+
+    CStreamIn in = {input, nread, 0};
+    int r;
+    do {
+      size_t capacity;
+      unsigned char *output = io_writer_buffer(writer, &capacity);
+      if (!output) {
+        err = -1;
+        break;
+      }
+      CStreamOut out = {output, capacity, 0};
+      r = step(state, &in, &out, op);
+      if (r == C_STREAM_ERROR || io_writer_commit(writer, out.pos) != 0) {
+        err = -1;
+        break;
+      }
+    } while (r == C_STREAM_MORE);
+  }
+
+  COMP_END_ALLOW_THREADS
+
+      io_reader_close(reader);
+  if (writer && io_writer_close(writer) != 0)
+    err = -1;
+  return err;
+}
+
+// Output goes to the writer when there is one, else through sink from a
+// buffer of our own. Succeeds only if the input ends on a complete stream.
+static int stream_decompress_to(CStreamDecompressFn step, void *state,
+                                FILE *src, IOWriter *writer,
+                                CStreamSinkFn sink, void *ctx) {
+  IOReader *reader = io_reader_open(src);
+  unsigned char *own =
+      writer ? NULL : (unsigned char *)io_alloc(io_chunk_size());
+  int err = reader && (writer || own) ? 0 : -1;
+  int r = C_STREAM_OK;
+  COMP_BEGIN_ALLOW_THREADS
+
+      int at_eof = 0;
+  while (!at_eof && !err) {
+    // A final empty step lets the backend report whether it ended cleanly
+    const unsigned char *input;
+    size_t nread;
+    int at_end;
+    if (io_reader_next(reader, &input, &nread, &at_end) != 0) {
+      err = -1;
+      break;
+    }
+    at_eof = nread == 0;
+
+    CStreamIn in = {input, nread, 0};
+    do {
+      size_t capacity = io_chunk_size();
+      unsigned char *output =
+          writer ? io_writer_buffer(writer, &capacity) : own;
+      if (!output) {
+        err = -1;
+        break;
+      }
+      CStreamOut out = {output, capacity, 0};
+      r = step(state, &in, &out);
+      if (r == C_STREAM_ERROR) {
+        err = -1;
+        break;
+      }
+      int written = writer ? io_writer_commit(writer, out.pos)
+                           : out.pos > 0 ? sink(ctx, output, out.pos) : 0;
+      if (written != 0) {
+        err = -1;
+        break;
+      }
+    } while (r == C_STREAM_MORE || in.pos < in.size);
+  }
+
+  COMP_END_ALLOW_THREADS
+
+      io_reader_close(reader);
+  io_free(own);
+  if (!err && r != C_STREAM_END) {
+    err = -1; // truncated stream
+  }
+  return err;
+}
+
+int stream_decompress_sink(CStreamDecompressFn step, void *state, FILE *src,
+                           CStreamSinkFn sink, void *ctx) {
+  return stream_decompress_to(step, state, src, NULL, sink, ctx);
+}
+
+int stream_decompress_fp(CStreamDecompressFn step, void *state, FILE *src,
+                         FILE *dst) {
+  IOWriter *writer = io_writer_open(dst);
+  if (!writer)
+    return -1;
+
+  int err = stream_decompress_to(step, state, src, writer, NULL, NULL);
+  if (io_writer_close(writer) != 0)
+    err = -1;
+  return err;
+}
+
+// ---- Memory Drivers ----
+
+// Make room for at least STREAM_MEM_CHUNK more bytes in *buf
+static int stream_buffer_reserve(unsigned char **buf, size_t *capacity,
+                                 size_t used) {
+  if (*capacity - used >= STREAM_MEM_CHUNK)
+    return 0;
+
+  size_t grown = *capacity ? *capacity * 2 : STREAM_MEM_CHUNK;
+  if (grown - used < STREAM_MEM_CHUNK)
+    grown = used + STREAM_MEM_CHUNK;
+
+  unsigned char *p = (unsigned char *)realloc(*buf, grown);
+  if (!p)
+    return -1;
+  *buf = p;
+  *capacity = grown;
+  return 0;
+}
+
+int stream_compress_mem(CStreamCompressFn step, void *state,
+                        const unsigned char *src, size_t size, CStreamOp op,
+                        unsigned char **dst, size_t *dst_size) {
+  unsigned char *buf = NULL;
+  size_t capacity = 0;
+  size_t used = 0;
+
+  int err = 0;
+  COMP_BEGIN_ALLOW_THREADS
+
+      CStreamIn in = {src, size, 0};
+  int r;
+  do {
+    if (stream_buffer_reserve(&buf, &capacity, used) != 0) {
+      err = -1;
+      break;
+    }
+    CStreamOut out = {buf, capacity, used};
+    r = step(state, &in, &out, op);
+    used = out.pos;
+    if (r == C_STREAM_ERROR) {
+      err = -1;
+      break;
+    }
+  } while (r == C_STREAM_MORE);
+
+  COMP_END_ALLOW_THREADS
+
+      if (err) {
+    free(buf);
+    return -1;
+  }
+  *dst = buf;
+  *dst_size = used;
+  return 0;
+}
+
+int stream_decompress_mem(CStreamDecompressFn step, void *state,
+                          const unsigned char *src, size_t size,
+                          unsigned char **dst, size_t *dst_size) {
+  unsigned char *buf = NULL;
+  size_t capacity = 0;
+  size_t used = 0;
+
+  int r = C_STREAM_OK;
+  COMP_BEGIN_ALLOW_THREADS
+
+      CStreamIn in = {src, size, 0};
+  do {
+    if (stream_buffer_reserve(&buf, &capacity, used) != 0) {
+      r = C_STREAM_ERROR;
+      break;
+    }
+    CStreamOut out = {buf, capacity, used};
+    r = step(state, &in, &out);
+    used = out.pos;
+  } while (r != C_STREAM_ERROR && (r == C_STREAM_MORE || in.pos < in.size));
+
+  COMP_END_ALLOW_THREADS
+
+      if (r == C_STREAM_ERROR) {
+    free(buf);
+    return -1;
+  }
+  *dst = buf;
+  *dst_size = used;
+  return r;
+}
@@ -0,0 +1,164 @@
+#include "context.h"
+#include "stats.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+// ---- Binding ----
+
+int codec_context_bind(CodecContext *ctx, const CBackend *backend) {
+  if (ctx->backend == backend)
+    return 0;
+
+  codec_context_clear(ctx);
+  ctx->backend = backend;
+
+  if (backend->context_new) {
+    ctx->handle = backend->context_new(ctx->compress);
+    if (!ctx->handle) {
+      ctx->backend = NULL;
+      return -1;
+    }
+    stats_context_created(backend->id, ctx->compress);
+  }
+  return 0;
+}
+
+void codec_context_clear(CodecContext *ctx) {
+  if (ctx->handle && ctx->backend && ctx->backend->context_free) {
+    ctx->backend->context_free(ctx->handle, ctx->compress);
+  }
+  ctx->backend = NULL;
+  ctx->handle = NULL;
+}
+
+// ---- Per-Thread Cache ----
+
+// One context per (direction, algorithm) per thread, freed at thread exit
+#define CODEC_CACHE_SLOTS 8 // AlgoID values 0..ALGO_ZIP
+
+typedef struct {
+  CodecContext slots[2][CODEC_CACHE_SLOTS];
+} ThreadCache;
+
+static pthread_key_t cache_key;
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+static int cache_ready = 0;
+
+static void free_thread_cache(void *arg) {
+  ThreadCache *cache = (ThreadCache *)arg;
+  for (int dir = 0; dir < 2; dir++) {
+    for (int i = 0; i < CODEC_CACHE_SLOTS; i++) {
+      codec_context_clear(&cache->slots[dir][i]);
+    }
+  }
+  free(cache);
+}
+
+static void create_cache_key(void) {
+  cache_ready = pthread_key_create(&cache_key, free_thread_cache) == 0;
+}
+
+// Returns NULL when no cached context can be had; callers then go stateless
+static CodecContext *thread_context(const CBackend *backend, int compress) {
+  if (!backend->context_new || backend->id >= CODEC_CACHE_SLOTS)
+    return NULL;
+
+  pthread_once(&cache_once, create_cache_key);
+  if (!cache_ready)
+    return NULL;
+
+  ThreadCache *cache = (ThreadCache *)pthread_getspecific(cache_key);
+  if (!cache) {
+    cache = (ThreadCache *)calloc(1, sizeof(ThreadCache));
+    if (!cache)
+      return NULL;
+    for (int i = 0; i < CODEC_CACHE_SLOTS; i++) {
+      cache->slots[0][i].compress = 0;
+      cache->slots[1][i].compress = 1;
+    }
+    if (pthread_setspecific(cache_key, cache) != 0) {
+      free(cache);
+      return NULL;
+    }
+  }
+
+  CodecContext *ctx = &cache->slots[compress ? 1 : 0][backend->id];
+  return codec_context_bind(ctx, backend) == 0 ? ctx : NULL;
+}
+
+// ---- Buffer Calls ----
+
+static int compress_call(const CBackend *backend, CodecContext *ctx,
+                         const void *dict, const unsigned char *input,
+                         size_t input_size, unsigned char *output,
+                         size_t *output_capacity, int level,
+                         size_t *output_size) {
+  if (!ctx)
+    ctx = thread_context(backend, 1);
+  else if (codec_context_bind(ctx, backend) != 0)
+    return -1;
+
+  // The digest already carries the level
+  if (dict) {
+    return backend->compress_buffer_dict(ctx ? ctx->handle : NULL, dict,
+                                         input, input_size, output,
+                                         output_capacity, output_size);
+  }
+
+  if (ctx && ctx->handle && backend->compress_buffer_ctx) {
+    return backend->compress_buffer_ctx(ctx->handle, input, input_size, output,
+                                        output_capacity, level, output_size);
+  }
+  return backend->compress_buffer(input, input_size, output, output_capacity,
+                                  level, output_size);
+}
+
+static int decompress_call(const CBackend *backend, CodecContext *ctx,
+                           const void *dict, const unsigned char *input,
+                           size_t input_size, unsigned char *output,
+                           size_t *output_capacity, size_t *output_size) {
+  if (!ctx)
+    ctx = thread_context(backend, 0);
+  else if (codec_context_bind(ctx, backend) != 0)
+    return -1;
+
+  if (dict) {
+    return backend->decompress_buffer_dict(ctx ? ctx->handle : NULL, dict,
+                                           input, input_size, output,
+                                           output_capacity, output_size);
+  }
+
+  if (ctx && ctx->handle && backend->decompress_buffer_ctx) {
+    return backend->decompress_buffer_ctx(ctx->handle, input, input_size,
+                                          output, output_capacity,
+                                          output_size);
+  }
+  return backend->decompress_buffer(input, input_size, output,
+                                    output_capacity, output_size);
+}
+
+// Timed into the backend's counters, failures included
+int codec_compress_buffer(const CBackend *backend, CodecContext *ctx,
+                          const void *dict, const unsigned char *input,
+                          size_t input_size, unsigned char *output,
+                          size_t *output_capacity, int level,
+                          size_t *output_size) {
+  uint64_t start = io_monotonic_ns();
+  int rc = compress_call(backend, ctx, dict, input, input_size, output,
+                         output_capacity, level, output_size);
+  stats_codec(backend->id, 1, input_size, rc == 0 ? *output_size : 0,
+              io_monotonic_ns() - start);
+  return rc;
+}
+
+int codec_decompress_buffer(const CBackend *backend, CodecContext *ctx,
+                            const void *dict, const unsigned char *input,
+                            size_t input_size, unsigned char *output,
+                            size_t *output_capacity, size_t *output_size) {
+  uint64_t start = io_monotonic_ns();
+  int rc = decompress_call(backend, ctx, dict, input, input_size, output,
+                           output_capacity, output_size);
+  stats_codec(backend->id, 0, input_size, rc == 0 ? *output_size : 0,
+              io_monotonic_ns() - start);
+  return rc;
+}
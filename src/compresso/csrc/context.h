@@ -0,0 +1,47 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include "common.h"
+#include <Python.h>
+
+// ---- Codec Contexts ----
+
+// A native backend context (ZSTD_CCtx, LZ4F_dctx, z_stream, ...) kept alive
+// across buffer calls. handle stays NULL for backends without reusable
+// contexts; those fall through to the stateless buffer calls.
+typedef struct CodecContext {
+  const CBackend *backend; // NULL until first bound
+  void *handle;
+  int compress; // 1 = compression context, 0 = decompression
+} CodecContext;
+
+#define CODEC_CONTEXT_INIT(compress) {NULL, NULL, (compress)}
+
+// Point ctx at backend, replacing the native context if the backend
+// changed. Returns -1 (no exception set) if it cannot be created.
+int codec_context_bind(CodecContext *ctx, const CBackend *backend);
+
+void codec_context_clear(CodecContext *ctx);
+
+// One buffer (de)compression through ctx. A NULL ctx borrows the calling
+// thread's cached context for the backend, so repeated calls and pool
+// workers reuse one context per thread. dict is a digest from
+// dictionary_digest, or NULL. Never touches the Python API.
+int codec_compress_buffer(const CBackend *backend, CodecContext *ctx,
+                          const void *dict, const unsigned char *input,
+                          size_t input_size, unsigned char *output,
+                          size_t *output_capacity, int level,
+                          size_t *output_size);
+
+int codec_decompress_buffer(const CBackend *backend, CodecContext *ctx,
+                            const void *dict, const unsigned char *input,
+                            size_t input_size, unsigned char *output,
+                            size_t *output_capacity, size_t *output_size);
+
+// ---- Python Types ----
+
+// Adds Compressor, Decompressor and their streaming counterparts to the
+// module; returns -1 on error
+int context_types_init(PyObject *module);
+
+#endif // CONTEXT_H
@@ -0,0 +1,699 @@
+#define PY_SSIZE_T_CLEAN
+#include "common.h"
+#include "context.h"
+#include "dictionary.h"
+#include "stats.h"
+#include "validate.h"
+#include <Python.h>
+#include <pythread.h>
+
+// ---- Shared ----
+
+// Compressor/Decompressor each own one native context. The lock keeps two
+// Python threads from driving it at once while the GIL is released.
+typedef struct {
+  PyObject_HEAD CodecContext ctx;
+  PyThread_type_lock lock;
+  AlgoID algo; // forced backend, ALGO_NONE = from each frame's header
+  int level;   // compression only
+  PyObject *dictionary; // Dictionary kept alive for dict, or NULL
+  CDictionary *dict;
+} ContextObject;
+
+// Keeps a strong reference to a Dictionary argument (None clears it) so the
+// native dictionary outlives every call made with it
+static int set_dictionary(PyObject **slot, CDictionary **dict, PyObject *obj) {
+  CDictionary *native = NULL;
+  if (obj && !dictionary_converter(obj, &native)) {
+    return -1;
+  }
+
+  if (native)
+    Py_INCREF(obj);
+  Py_XSETREF(*slot, native ? obj : NULL);
+  *dict = native;
+  return 0;
+}
+
+static int context_object_prepare(ContextObject *self, int compress) {
+  codec_context_clear(&self->ctx);
+  self->ctx.compress = compress;
+
+  if (!self->lock) {
+    self->lock = PyThread_allocate_lock();
+    if (!self->lock) {
+      PyErr_SetString(PyExc_MemoryError, "Unable to allocate lock");
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static void context_object_dealloc(ContextObject *self) {
+  codec_context_clear(&self->ctx);
+  Py_CLEAR(self->dictionary);
+  if (self->lock)
+    PyThread_free_lock(self->lock);
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int context_object_lock(ContextObject *self) {
+  if (!self->lock) {
+    PyErr_SetString(PyExc_RuntimeError, "Object is not initialised");
+    return -1;
+  }
+  if (!PyThread_acquire_lock(self->lock, NOWAIT_LOCK)) {
+    Py_BEGIN_ALLOW_THREADS PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    Py_END_ALLOW_THREADS
+  }
+  return 0;
+}
+
+static PyObject *context_object_get_algo(ContextObject *self,
+                                         void *closure __attribute__((unused))) {
+  if (self->ctx.backend)
+    return PyUnicode_FromString(self->ctx.backend->name);
+  Py_RETURN_NONE;
+}
+
+static PyGetSetDef context_object_getset[] = {
+    {"algo", (getter)context_object_get_algo, NULL,
+     "Name of the bound backend (None until a Decompressor sees a frame).",
+     NULL},
+    {NULL, NULL, NULL, NULL, NULL} // Sentinel
+};
+
+// ---- Compressor ----
+
+static int compressor_init(ContextObject *self, PyObject *args,
+                           PyObject *kwargs) {
+  static char *kwlist[] = {"algo", "strategy", "level", "dictionary", NULL};
+
+  const char *algo_name = NULL;
+  const char *strategy_name = NULL;
+  int level = -1;
+  PyObject *dictionary = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|ssiO", kwlist, &algo_name,
+                                   &strategy_name, &level, &dictionary)) {
+    return -1; // Error already set
+  }
+
+  AlgoID algo = algo_from_string(algo_name);
+  Strategy strat = strategy_from_string(strategy_name);
+
+  if (algo_name && algo_name[0] != '\0' && algo == ALGO_NONE) {
+    PyErr_Format(PyExc_ValueError, "Unknown compression algorithm: %s",
+                 algo_name);
+    return -1;
+  }
+
+  if (validate_compression_request(algo, strat, level, NULL) != 0) {
+    return -1;
+  }
+
+  init_backends();
+  const CBackend *backend =
+      algo != ALGO_NONE ? find_backend_by_id(algo) : choose_backend(strat);
+  if (!backend) {
+    PyErr_SetString(PyExc_ValueError,
+                    "Specified compression algorithm not available");
+    return -1;
+  }
+
+  if (context_object_prepare(self, 1) != 0 ||
+      set_dictionary(&self->dictionary, &self->dict, dictionary) != 0) {
+    return -1;
+  }
+
+  if (codec_context_bind(&self->ctx, backend) != 0) {
+    PyErr_Format(comp_BackendError,
+                 "Backend '%s' failed to create a compression context",
+                 backend->name);
+    return -1;
+  }
+
+  self->algo = (AlgoID)backend->id;
+  self->level = level;
+  return 0;
+}
+
+static PyObject *compressor_compress(ContextObject *self, PyObject *args) {
+  Py_buffer data;
+
+  if (!PyArg_ParseTuple(args, "y*", &data)) {
+    return NULL; // Error already set
+  }
+
+  PyObject *result = NULL;
+  if (context_object_lock(self) == 0) {
+    result = compress_bytes((const unsigned char *)data.buf, (size_t)data.len,
+                            self->algo, STRAT_BALANCED, self->level,
+                            self->dict, &self->ctx);
+    PyThread_release_lock(self->lock);
+  }
+
+  PyBuffer_Release(&data);
+  return result;
+}
+
+static PyObject *compressor_compress_into(ContextObject *self,
+                                          PyObject *args) {
+  Py_buffer data;
+  Py_buffer out;
+
+  if (!PyArg_ParseTuple(args, "y*w*", &data, &out)) {
+    return NULL; // Error already set
+  }
+
+  Py_ssize_t written = -1;
+  if (context_object_lock(self) == 0) {
+    written = compress_into((const unsigned char *)data.buf, (size_t)data.len,
+                            (unsigned char *)out.buf, (size_t)out.len,
+                            self->algo, STRAT_BALANCED, self->level,
+                            self->dict, &self->ctx);
+    PyThread_release_lock(self->lock);
+  }
+
+  PyBuffer_Release(&data);
+  PyBuffer_Release(&out);
+  return written < 0 ? NULL : PyLong_FromSsize_t(written);
+}
+
+static PyMethodDef compressor_methods[] = {
+    {"compress", (PyCFunction)compressor_compress, METH_VARARGS,
+     "Compress a bytes-like object and return the compressed frame."},
+    {"compress_into", (PyCFunction)compressor_compress_into, METH_VARARGS,
+     "Compress a bytes-like object into a writable buffer."},
+    {NULL, NULL, 0, NULL} // Sentinel
+};
+
+static PyTypeObject CompressorType = {
+    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "compresso._core.Compressor",
+    .tp_doc = "Reusable compression context for one backend.",
+    .tp_basicsize = sizeof(ContextObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)compressor_init,
+    .tp_dealloc = (destructor)context_object_dealloc,
+    .tp_methods = compressor_methods,
+    .tp_getset = context_object_getset,
+};
+
+// ---- Decompressor ----
+
+static int decompressor_init(ContextObject *self, PyObject *args,
+                             PyObject *kwargs) {
+  static char *kwlist[] = {"algo", "dictionary", NULL};
+
+  const char *algo_name = NULL;
+  PyObject *dictionary = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|sO", kwlist, &algo_name,
+                                   &dictionary)) {
+    return -1; // Error already set
+  }
+
+  AlgoID algo = algo_from_string(algo_name);
+  if (algo_name && algo_name[0] != '\0' && algo == ALGO_NONE) {
+    PyErr_Format(PyExc_ValueError, "Unknown decompression algorithm: %s",
+                 algo_name);
+    return -1;
+  }
+
+  if (context_object_prepare(self, 0) != 0 ||
+      set_dictionary(&self->dictionary, &self->dict, dictionary) != 0) {
+    return -1;
+  }
+
+  // Without an explicit backend the context binds lazily to each frame's
+  // algorithm and is only rebuilt when that changes
+  if (algo != ALGO_NONE) {
+    init_backends();
+    const CBackend *backend = find_backend_by_id(algo);
+    if (!backend) {
+      PyErr_SetString(comp_BackendError,
+                      "Specified compression algorithm not available");
+      return -1;
+    }
+    if (codec_context_bind(&self->ctx, backend) != 0) {
+      PyErr_Format(comp_BackendError,
+                   "Backend '%s' failed to create a decompression context",
+                   backend->name);
+      return -1;
+    }
+  }
+
+  self->algo = algo;
+  return 0;
+}
+
+static PyObject *decompressor_decompress(ContextObject *self, PyObject *args) {
+  Py_buffer data;
+
+  if (!PyArg_ParseTuple(args, "y*", &data)) {
+    return NULL; // Error already set
+  }
+
+  PyObject *result = NULL;
+  if (context_object_lock(self) == 0) {
+    result = decompress_bytes((const unsigned char *)data.buf,
+                              (size_t)data.len, self->algo, self->dict,
+                              &self->ctx);
+    PyThread_release_lock(self->lock);
+  }
+
+  PyBuffer_Release(&data);
+  return result;
+}
+
+static PyObject *decompressor_decompress_into(ContextObject *self,
+                                              PyObject *args) {
+  Py_buffer data;
+  Py_buffer out;
+
+  if (!PyArg_ParseTuple(args, "y*w*", &data, &out)) {
+    return NULL; // Error already set
+  }
+
+  Py_ssize_t written = -1;
+  if (context_object_lock(self) == 0) {
+    written = decompress_into((const unsigned char *)data.buf,
+                              (size_t)data.len, (unsigned char *)out.buf,
+                              (size_t)out.len, self->algo, self->dict,
+                              &self->ctx);
+    PyThread_release_lock(self->lock);
+  }
+
+  PyBuffer_Release(&data);
+  PyBuffer_Release(&out);
+  return written < 0 ? NULL : PyLong_FromSsize_t(written);
+}
+
+static PyMethodDef decompressor_methods[] = {
+    {"decompress", (PyCFunction)decompressor_decompress, METH_VARARGS,
+     "Decompress a compressed frame and return the original bytes."},
+    {"decompress_into", (PyCFunction)decompressor_decompress_into,
+     METH_VARARGS, "Decompress a compressed frame into a writable buffer."},
+    {NULL, NULL, 0, NULL} // Sentinel
+};
+
+static PyTypeObject DecompressorType = {
+    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "compresso._core.Decompressor",
+    .tp_doc = "Reusable decompression context.",
+    .tp_basicsize = sizeof(ContextObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)decompressor_init,
+    .tp_dealloc = (destructor)context_object_dealloc,
+    .tp_methods = decompressor_methods,
+    .tp_getset = context_object_getset,
+};
+
+// ---- Streams ----
+
+// CompressorStream/DecompressorStream drive one backend's memory stream
+// state. Output is the raw backend stream, the same payload compress_file
+// writes after its header, so it needs no framing of its own.
+typedef struct {
+  PyObject_HEAD const CBackend *backend;
+  void *state;
+  PyThread_type_lock lock;
+  int level;
+  int done; // compressor: finished, decompressor: at a stream end
+  PyObject *dictionary; // Dictionary the state references, or NULL
+  CDictionary *dict;
+} StreamObject;
+
+static int stream_object_prepare(StreamObject *self, const CBackend *backend,
+                                 int compress, int level,
+                                 PyObject *dictionary) {
+  if (self->state) {
+    self->backend->stream_free(self->state, compress);
+    self->state = NULL;
+  }
+
+  if (!backend->stream_new) {
+    PyErr_Format(comp_BackendError, "Backend '%s' does not support streaming",
+                 backend->name);
+    return -1;
+  }
+
+  if (set_dictionary(&self->dictionary, &self->dict, dictionary) != 0) {
+    return -1;
+  }
+
+  // The state references the digest, which lives as long as the dictionary
+  const void *digest = NULL;
+  if (self->dict) {
+    if (!backend->stream_new_dict) {
+      PyErr_Format(PyExc_ValueError,
+                   "Backend '%s' does not support dictionary streams",
+                   backend->name);
+      return -1;
+    }
+    digest = dictionary_digest(self->dict, backend, compress, level);
+    if (!digest) {
+      return -1;
+    }
+  }
+
+  if (!self->lock) {
+    self->lock = PyThread_allocate_lock();
+    if (!self->lock) {
+      PyErr_SetString(PyExc_MemoryError, "Unable to allocate lock");
+      return -1;
+    }
+  }
+
+  self->state = digest ? backend->stream_new_dict(compress, level, digest)
+                       : backend->stream_new(compress, level);
+  if (!self->state) {
+    PyErr_Format(comp_BackendError, "Backend '%s' failed to create a stream",
+                 backend->name);
+    return -1;
+  }
+  stats_context_created(backend->id, compress);
+
+  self->backend = backend;
+  self->level = level;
+  self->done = 0;
+  return 0;
+}
+
+static int stream_object_lock(StreamObject *self) {
+  if (!self->state) {
+    PyErr_SetString(PyExc_RuntimeError, "Object is not initialised");
+    return -1;
+  }
+  if (!PyThread_acquire_lock(self->lock, NOWAIT_LOCK)) {
+    Py_BEGIN_ALLOW_THREADS PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    Py_END_ALLOW_THREADS
+  }
+  return 0;
+}
+
+static PyObject *stream_object_result(unsigned char *output, size_t size) {
+  PyObject *result = PyBytes_FromStringAndSize((const char *)output,
+                                               (Py_ssize_t)size);
+  free(output);
+  return result;
+}
+
+static PyObject *stream_object_get_algo(StreamObject *self,
+                                        void *closure __attribute__((unused))) {
+  if (self->backend)
+    return PyUnicode_FromString(self->backend->name);
+  Py_RETURN_NONE;
+}
+
+// ---- CompressorStream ----
+
+static void compressor_stream_dealloc(StreamObject *self) {
+  if (self->state)
+    self->backend->stream_free(self->state, 1);
+  Py_CLEAR(self->dictionary);
+  if (self->lock)
+    PyThread_free_lock(self->lock);
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int compressor_stream_init(StreamObject *self, PyObject *args,
+                                  PyObject *kwargs) {
+  static char *kwlist[] = {"algo", "strategy", "level", "dictionary", NULL};
+
+  const char *algo_name = NULL;
+  const char *strategy_name = NULL;
+  int level = -1;
+  PyObject *dictionary = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|ssiO", kwlist, &algo_name,
+                                   &strategy_name, &level, &dictionary)) {
+    return -1; // Error already set
+  }
+
+  AlgoID algo = algo_from_string(algo_name);
+  Strategy strat = strategy_from_string(strategy_name);
+
+  if (algo_name && algo_name[0] != '\0' && algo == ALGO_NONE) {
+    PyErr_Format(PyExc_ValueError, "Unknown compression algorithm: %s",
+                 algo_name);
+    return -1;
+  }
+
+  if (validate_compression_request(algo, strat, level, NULL) != 0) {
+    return -1;
+  }
+
+  init_backends();
+  const CBackend *backend =
+      algo != ALGO_NONE ? find_backend_by_id(algo) : choose_backend(strat);
+  if (!backend) {
+    PyErr_SetString(PyExc_ValueError,
+                    "Specified compression algorithm not available");
+    return -1;
+  }
+
+  return stream_object_prepare(self, backend, 1, level, dictionary);
+}
+
+static PyObject *compressor_stream_run(StreamObject *self, const void *data,
+                                       Py_ssize_t size, CStreamOp op) {
+  if (stream_object_lock(self) != 0) {
+    return NULL;
+  }
+
+  PyObject *result = NULL;
+  if (self->done) {
+    PyErr_SetString(comp_Error, "CompressorStream is already finished");
+  } else {
+    unsigned char *output = NULL;
+    size_t output_size = 0;
+    if (stream_compress_mem(self->backend->stream_compress_step, self->state,
+                            (const unsigned char *)data, (size_t)size, op,
+                            &output, &output_size) != 0) {
+      self->done = 1; // the native stream state is no longer usable
+      PyErr_Format(comp_BackendError, "Backend '%s' stream compression failed",
+                   self->backend->name);
+    } else {
+      self->done = op == C_STREAM_FINISH;
+      result = stream_object_result(output, output_size);
+    }
+  }
+
+  PyThread_release_lock(self->lock);
+  return result;
+}
+
+static PyObject *compressor_stream_feed(StreamObject *self, PyObject *args) {
+  Py_buffer data;
+
+  if (!PyArg_ParseTuple(args, "y*", &data)) {
+    return NULL; // Error already set
+  }
+
+  PyObject *result = compressor_stream_run(self, data.buf, data.len,
+                                           C_STREAM_RUN);
+  PyBuffer_Release(&data);
+  return result;
+}
+
+static PyObject *compressor_stream_flush(StreamObject *self,
+                                         PyObject *Py_UNUSED(ignored)) {
+  return compressor_stream_run(self, NULL, 0, C_STREAM_FLUSH);
+}
+
+static PyObject *compressor_stream_finish(StreamObject *self,
+                                          PyObject *Py_UNUSED(ignored)) {
+  return compressor_stream_run(self, NULL, 0, C_STREAM_FINISH);
+}
+
+static PyMethodDef compressor_stream_methods[] = {
+    {"feed", (PyCFunction)compressor_stream_feed, METH_VARARGS,
+     "Compress a chunk and return whatever output is ready."},
+    {"flush", (PyCFunction)compressor_stream_flush, METH_NOARGS,
+     "Return output that makes everything fed so far decodable."},
+    {"finish", (PyCFunction)compressor_stream_finish, METH_NOARGS,
+     "End the stream and return the remaining output."},
+    {NULL, NULL, 0, NULL} // Sentinel
+};
+
+static PyObject *compressor_stream_get_finished(
+    StreamObject *self, void *closure __attribute__((unused))) {
+  return PyBool_FromLong(self->done);
+}
+
+static PyGetSetDef compressor_stream_getset[] = {
+    {"algo", (getter)stream_object_get_algo, NULL, "Name of the backend.",
+     NULL},
+    {"finished", (getter)compressor_stream_get_finished, NULL,
+     "Whether finish() has ended the stream.", NULL},
+    {NULL, NULL, NULL, NULL, NULL} // Sentinel
+};
+
+static PyTypeObject CompressorStreamType = {
+    PyVarObject_HEAD_INIT(NULL, 0).tp_name =
+        "compresso._core.CompressorStream",
+    .tp_doc = "Incremental compressor producing a backend stream.",
+    .tp_basicsize = sizeof(StreamObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)compressor_stream_init,
+    .tp_dealloc = (destructor)compressor_stream_dealloc,
+    .tp_methods = compressor_stream_methods,
+    .tp_getset = compressor_stream_getset,
+};
+
+// ---- DecompressorStream ----
+
+static void decompressor_stream_dealloc(StreamObject *self) {
+  if (self->state)
+    self->backend->stream_free(self->state, 0);
+  Py_CLEAR(self->dictionary);
+  if (self->lock)
+    PyThread_free_lock(self->lock);
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int decompressor_stream_init(StreamObject *self, PyObject *args,
+                                    PyObject *kwargs) {
+  static char *kwlist[] = {"algo", "dictionary", NULL};
+
+  const char *algo_name = NULL;
+  PyObject *dictionary = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|O", kwlist, &algo_name,
+                                   &dictionary)) {
+    return -1; // Error already set
+  }
+
+  // A raw stream carries no header, so the backend must be named
+  AlgoID algo = algo_from_string(algo_name);
+  if (algo == ALGO_NONE) {
+    PyErr_Format(PyExc_ValueError, "Unknown decompression algorithm: %s",
+                 algo_name);
+    return -1;
+  }
+
+  init_backends();
+  const CBackend *backend = find_backend_by_id(algo);
+  if (!backend) {
+    PyErr_SetString(comp_BackendError,
+                    "Specified compression algorithm not available");
+    return -1;
+  }
+
+  return stream_object_prepare(self, backend, 0, -1, dictionary);
+}
+
+static PyObject *decompressor_stream_run(StreamObject *self, const void *data,
+                                         Py_ssize_t size, int finish) {
+  if (stream_object_lock(self) != 0) {
+    return NULL;
+  }
+
+  unsigned char *output = NULL;
+  size_t output_size = 0;
+  PyObject *result = NULL;
+
+  int r = stream_decompress_mem(self->backend->stream_decompress_step,
+                                self->state, (const unsigned char *)data,
+                                (size_t)size, &output, &output_size);
+  if (r < 0) {
+    PyErr_Format(comp_BackendError,
+                 "Backend '%s' stream decompression failed (corrupt data?)",
+                 self->backend->name);
+  } else {
+    self->done = r == C_STREAM_END;
+    if (finish && !self->done) {
+      free(output);
+      PyErr_SetString(comp_Error, "Compressed stream is truncated");
+    } else {
+      result = stream_object_result(output, output_size);
+    }
+  }
+
+  PyThread_release_lock(self->lock);
+  return result;
+}
+
+static PyObject *decompressor_stream_feed(StreamObject *self, PyObject *args) {
+  Py_buffer data;
+
+  if (!PyArg_ParseTuple(args, "y*", &data)) {
+    return NULL; // Error already set
+  }
+
+  PyObject *result = decompressor_stream_run(self, data.buf, data.len, 0);
+  PyBuffer_Release(&data);
+  return result;
+}
+
+static PyObject *decompressor_stream_finish(StreamObject *self,
+                                            PyObject *Py_UNUSED(ignored)) {
+  return decompressor_stream_run(self, NULL, 0, 1);
+}
+
+static PyMethodDef decompressor_stream_methods[] = {
+    {"feed", (PyCFunction)decompressor_stream_feed, METH_VARARGS,
+     "Decompress a chunk and return whatever output is ready."},
+    {"finish", (PyCFunction)decompressor_stream_finish, METH_NOARGS,
+     "Return the remaining output; fails if the stream is truncated."},
+    {NULL, NULL, 0, NULL} // Sentinel
+};
+
+static PyObject *decompressor_stream_get_eof(StreamObject *self,
+                                             void *closure
+                                             __attribute__((unused))) {
+  return PyBool_FromLong(self->done);
+}
+
+static PyGetSetDef decompressor_stream_getset[] = {
+    {"algo", (getter)stream_object_get_algo, NULL, "Name of the backend.",
+     NULL},
+    {"eof", (getter)decompressor_stream_get_eof, NULL,
+     "Whether the input fed so far ends on a complete stream.", NULL},
+    {NULL, NULL, NULL, NULL, NULL} // Sentinel
+};
+
+static PyTypeObject DecompressorStreamType = {
+    PyVarObject_HEAD_INIT(NULL, 0).tp_name =
+        "compresso._core.DecompressorStream",
+    .tp_doc = "Incremental decompressor for a backend stream.",
+    .tp_basicsize = sizeof(StreamObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)decompressor_stream_init,
+    .tp_dealloc = (destructor)decompressor_stream_dealloc,
+    .tp_methods = decompressor_stream_methods,
+    .tp_getset = decompressor_stream_getset,
+};
+
+// ---- Registration ----
+
+static int add_type(PyObject *module, const char *name, PyTypeObject *type) {
+  Py_INCREF(type);
+  if (PyModule_AddObject(module, name, (PyObject *)type) < 0) {
+    Py_DECREF(type);
+    return -1;
+  }
+  return 0;
+}
+
+int context_types_init(PyObject *module) {
+  if (PyType_Ready(&CompressorType) < 0 ||
+      PyType_Ready(&DecompressorType) < 0 ||
+      PyType_Ready(&CompressorStreamType) < 0 ||
+      PyType_Ready(&DecompressorStreamType) < 0) {
+    return -1;
+  }
+
+  if (add_type(module, "Compressor", &CompressorType) < 0 ||
+      add_type(module, "Decompressor", &DecompressorType) < 0 ||
+      add_type(module, "CompressorStream", &CompressorStreamType) < 0 ||
+      add_type(module, "DecompressorStream", &DecompressorStreamType) < 0) {
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,171 @@
+#include "deflate_accel.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <dlfcn.h>
+#define DEFLATE_ACCEL_DLOPEN 1
+#endif
+
+// ---- Library Loading ----
+
+// libdeflate's ABI, declared here so the build needs no header from it.
+// Results: 0 success, 1 bad data, 2 short output, 3 no space.
+typedef struct {
+  void *(*alloc_compressor)(int level);
+  void (*free_compressor)(void *c);
+  size_t (*compress[3])(void *c, const void *in, size_t in_size, void *out,
+                        size_t capacity);
+  void *(*alloc_decompressor)(void);
+  void (*free_decompressor)(void *d);
+  // Raw and gzip report the input they used; zlib only from 1.6 on
+  int (*decompress_ex[3])(void *d, const void *in, size_t in_size, void *out,
+                          size_t capacity, size_t *in_used, size_t *out_size);
+  int (*zlib_decompress)(void *d, const void *in, size_t in_size, void *out,
+                         size_t capacity, size_t *out_size);
+} LibDeflate;
+
+static LibDeflate libdeflate;
+static int libdeflate_loaded;
+static pthread_once_t libdeflate_once = PTHREAD_ONCE_INIT;
+
+#if defined(DEFLATE_ACCEL_DLOPEN)
+static void *load_symbol(void *lib, const char *name, int *missing) {
+  void *sym = dlsym(lib, name);
+  if (!sym)
+    *missing = 1;
+  return sym;
+}
+#endif
+
+static void libdeflate_load(void) {
+#if defined(DEFLATE_ACCEL_DLOPEN)
+  static const char *const names[] = {
+#if defined(__APPLE__)
+      "libdeflate.0.dylib", "libdeflate.dylib",
+#else
+      "libdeflate.so.0", "libdeflate.so",
+#endif
+  };
+  void *lib = NULL;
+  for (size_t i = 0; !lib && i < sizeof(names) / sizeof(names[0]); i++)
+    lib = dlopen(names[i], RTLD_NOW | RTLD_LOCAL);
+  if (!lib)
+    return;
+
+  LibDeflate l = {0};
+  int missing = 0;
+  *(void **)&l.alloc_compressor =
+      load_symbol(lib, "libdeflate_alloc_compressor", &missing);
+  *(void **)&l.free_compressor =
+      load_symbol(lib, "libdeflate_free_compressor", &missing);
+  *(void **)&l.compress[DEFLATE_RAW] =
+      load_symbol(lib, "libdeflate_deflate_compress", &missing);
+  *(void **)&l.compress[DEFLATE_ZLIB] =
+      load_symbol(lib, "libdeflate_zlib_compress", &missing);
+  *(void **)&l.compress[DEFLATE_GZIP] =
+      load_symbol(lib, "libdeflate_gzip_compress", &missing);
+  *(void **)&l.alloc_decompressor =
+      load_symbol(lib, "libdeflate_alloc_decompressor", &missing);
+  *(void **)&l.free_decompressor =
+      load_symbol(lib, "libdeflate_free_decompressor", &missing);
+  *(void **)&l.decompress_ex[DEFLATE_RAW] =
+      load_symbol(lib, "libdeflate_deflate_decompress_ex", &missing);
+  *(void **)&l.decompress_ex[DEFLATE_GZIP] =
+      load_symbol(lib, "libdeflate_gzip_decompress_ex", &missing);
+  *(void **)&l.zlib_decompress =
+      load_symbol(lib, "libdeflate_zlib_decompress", &missing);
+  *(void **)&l.decompress_ex[DEFLATE_ZLIB] =
+      dlsym(lib, "libdeflate_zlib_decompress_ex"); // optional
+
+  if (missing) {
+    dlclose(lib);
+    return;
+  }
+  libdeflate = l;
+  libdeflate_loaded = 1; // the library stays loaded for the process
+#endif
+}
+
+int deflate_accel_available(void) {
+  pthread_once(&libdeflate_once, libdeflate_load);
+  return libdeflate_loaded;
+}
+
+const char *deflate_accel_name(void) {
+  return deflate_accel_available() ? "libdeflate" : "zlib";
+}
+
+// ---- Buffer Calls ----
+
+// zlib's levels, with its default; libdeflate's run on to 12
+static int accel_level(int level) {
+  return level >= 0 && level <= 12 ? level : 6;
+}
+
+void *deflate_accel_compressor_new(int level) {
+  return deflate_accel_available()
+             ? libdeflate.alloc_compressor(accel_level(level))
+             : NULL;
+}
+
+void deflate_accel_compressor_free(void *compressor) {
+  if (compressor)
+    libdeflate.free_compressor(compressor);
+}
+
+void *deflate_accel_decompressor_new(void) {
+  return deflate_accel_available() ? libdeflate.alloc_decompressor() : NULL;
+}
+
+void deflate_accel_decompressor_free(void *decompressor) {
+  if (decompressor)
+    libdeflate.free_decompressor(decompressor);
+}
+
+int deflate_accel_compress(void *compressor, int level, DeflateFraming framing,
+                           const unsigned char *input, size_t input_size,
+                           unsigned char *output, size_t capacity,
+                           size_t *output_size) {
+  void *c = compressor ? compressor : deflate_accel_compressor_new(level);
+  if (!c)
+    return -1;
+  // 0 means it did not fit, which zlib's tighter bound may still manage
+  size_t n = libdeflate.compress[framing](c, input, input_size, output,
+                                          capacity);
+  if (!compressor)
+    libdeflate.free_compressor(c);
+  if (n == 0)
+    return -1;
+  *output_size = n;
+  return 0;
+}
+
+int deflate_accel_decompress(void *decompressor, DeflateFraming framing,
+                             const unsigned char *input, size_t input_size,
+                             unsigned char *output, size_t capacity,
+                             size_t *output_size, size_t *in_used) {
+  if (!deflate_accel_available() ||
+      (in_used && !libdeflate.decompress_ex[framing]))
+    return -1;
+  void *d = decompressor ? decompressor : libdeflate.alloc_decompressor();
+  if (!d)
+    return -1;
+
+  size_t used = 0, produced = 0;
+  int result = libdeflate.decompress_ex[framing]
+                   ? libdeflate.decompress_ex[framing](d, input, input_size,
+                                                       output, capacity, &used,
+                                                       &produced)
+                   : libdeflate.zlib_decompress(d, input, input_size, output,
+                                                capacity, &produced);
+  if (!decompressor)
+    libdeflate.free_decompressor(d);
+  if (result != 0)
+    return -1;
+  *output_size = produced;
+  if (in_used)
+    *in_used = used;
+  return 0;
+}
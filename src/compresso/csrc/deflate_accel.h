@@ -0,0 +1,53 @@
+#ifndef DEFLATE_ACCEL_H
+#define DEFLATE_ACCEL_H
+
+#include <stddef.h>
+
+// ---- Accelerated Deflate ----
+
+// Whole-buffer deflate through libdeflate when the system has it. The
+// library is loaded at run time, so builds need no extra dependency and
+// machines without it keep stock zlib; once loaded it picks its own
+// AVX2/PCLMUL/NEON kernels for the CPU. Streams stay on zlib, which
+// libdeflate cannot do. Output is plain deflate in every framing, so stock
+// zlib reads what this writes and the other way round.
+//
+// Every call returns 0, or -1 when the library is not loaded or the data
+// does not fit; callers then take the zlib path, which reports the error.
+// Pure C: safe on any thread, never touches Python.
+
+typedef enum {
+  DEFLATE_RAW = 0,  // bare deflate (the body of a gzip member)
+  DEFLATE_ZLIB = 1, // RFC 1950, as compress2/uncompress write and read
+  DEFLATE_GZIP = 2  // one RFC 1952 member
+} DeflateFraming;
+
+// Non-zero if libdeflate is loaded
+int deflate_accel_available(void);
+
+// "libdeflate" or "zlib": what whole-buffer deflate runs on
+const char *deflate_accel_name(void);
+
+// Compressors and decompressors keep their tables between calls; one may be
+// used by one thread at a time. NULL when the library is not loaded.
+void *deflate_accel_compressor_new(int level);
+void deflate_accel_compressor_free(void *compressor);
+void *deflate_accel_decompressor_new(void);
+void deflate_accel_decompressor_free(void *decompressor);
+
+// Compress into at most capacity bytes of output. compressor may be NULL
+// for a one-off call at level.
+int deflate_accel_compress(void *compressor, int level, DeflateFraming framing,
+                           const unsigned char *input, size_t input_size,
+                           unsigned char *output, size_t capacity,
+                           size_t *output_size);
+
+// Decompress one stream into at most capacity bytes of output; *in_used
+// (when not NULL) is how much of input the stream took, so concatenated
+// members can be walked. decompressor may be NULL for a one-off call.
+int deflate_accel_decompress(void *decompressor, DeflateFraming framing,
+                             const unsigned char *input, size_t input_size,
+                             unsigned char *output, size_t capacity,
+                             size_t *output_size, size_t *in_used);
+
+#endif // DEFLATE_ACCEL_H
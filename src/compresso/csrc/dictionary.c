@@ -0,0 +1,322 @@
+#define PY_SSIZE_T_CLEAN
+#include "dictionary.h"
+#include <Python.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+// ---- Native Dictionaries ----
+
+// Dictionaries in the zstd format (RFC 8878 section 5) carry their own ID,
+// which zstd also writes into each frame; raw-content dictionaries are
+// identified by their CRC32 instead
+#define ZSTD_DICT_MAGIC 0xEC30A437U
+
+static uint32_t dictionary_derive_id(const unsigned char *data, size_t size) {
+  if (size >= 8) {
+    uint32_t magic = (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+                     ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+    uint32_t id = (uint32_t)data[4] | ((uint32_t)data[5] << 8) |
+                  ((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
+    if (magic == ZSTD_DICT_MAGIC && id != 0)
+      return id;
+  }
+
+  uLong crc = crc32(0L, Z_NULL, 0);
+  while (size > 0) {
+    uInt n = size > UINT32_MAX ? UINT32_MAX : (uInt)size;
+    crc = crc32(crc, data, n);
+    data += n;
+    size -= n;
+  }
+  return (uint32_t)crc;
+}
+
+int dictionary_init(CDictionary *dict, const unsigned char *data,
+                    size_t size) {
+  memset(dict, 0, sizeof(*dict));
+
+  if (size == 0) {
+    PyErr_SetString(PyExc_ValueError, "Dictionary data is empty");
+    return -1;
+  }
+
+  dict->data = (unsigned char *)safe_malloc(size);
+  if (!dict->data)
+    return -1;
+
+  memcpy(dict->data, data, size);
+  dict->size = size;
+  dict->id = dictionary_derive_id(data, size);
+  return 0;
+}
+
+void dictionary_clear(CDictionary *dict) {
+  for (int b = 0; b < C_DICT_BACKENDS; b++) {
+    const CBackend *backend = find_backend_by_id((uint8_t)b);
+    for (int l = 0; l < C_DICT_LEVELS; l++) {
+      if (dict->cdicts[b][l] && backend)
+        backend->dict_free(dict->cdicts[b][l], 1);
+    }
+    if (dict->ddicts[b] && backend)
+      backend->dict_free(dict->ddicts[b], 0);
+  }
+
+  free(dict->data);
+  memset(dict, 0, sizeof(*dict));
+}
+
+const void *dictionary_digest(CDictionary *dict, const CBackend *backend,
+                              int compress, int level) {
+  if (!backend->dict_new || backend->id >= C_DICT_BACKENDS) {
+    PyErr_Format(PyExc_ValueError, "Backend '%s' does not support dictionaries",
+                 backend->name);
+    return NULL;
+  }
+
+  // Out-of-range levels were rejected at the boundary; treat them as default
+  int slot = (level >= -1 && level < C_DICT_LEVELS - 1) ? level + 1 : 0;
+  void **digest = compress ? &dict->cdicts[backend->id][slot]
+                           : &dict->ddicts[backend->id];
+
+  if (!*digest) {
+    *digest = backend->dict_new(dict->data, dict->size, compress, level);
+    if (!*digest) {
+      PyErr_Format(comp_BackendError,
+                   "Backend '%s' failed to load the dictionary",
+                   backend->name);
+      return NULL;
+    }
+  }
+  return *digest;
+}
+
+int dictionary_for_header(CDictionary *dict, const CBackend *backend,
+                          uint8_t flags, uint32_t id, const void **digest) {
+  *digest = NULL;
+  if (!(flags & C_FLAG_DICTIONARY))
+    return 0;
+
+  if (!dict) {
+    PyErr_Format(comp_HeaderError,
+                 "Data was compressed with dictionary 0x%08x; pass the "
+                 "matching dictionary",
+                 id);
+    return -1;
+  }
+
+  if (dict->id != id) {
+    PyErr_Format(comp_HeaderError,
+                 "Data needs dictionary 0x%08x, not 0x%08x", id, dict->id);
+    return -1;
+  }
+
+  *digest = dictionary_digest(dict, backend, 0, -1);
+  return *digest ? 0 : -1;
+}
+
+// ---- Dictionary Type ----
+
+typedef struct {
+  PyObject_HEAD CDictionary dict;
+} DictionaryObject;
+
+static int dictionary_object_init(DictionaryObject *self, PyObject *args,
+                                  PyObject *kwargs) {
+  static char *kwlist[] = {"data", NULL};
+
+  Py_buffer data;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y*", kwlist, &data)) {
+    return -1; // Error already set
+  }
+
+  dictionary_clear(&self->dict);
+  int return_code = dictionary_init(
+      &self->dict, (const unsigned char *)data.buf, (size_t)data.len);
+
+  PyBuffer_Release(&data);
+  return return_code;
+}
+
+static void dictionary_object_dealloc(DictionaryObject *self) {
+  dictionary_clear(&self->dict);
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *dictionary_object_repr(DictionaryObject *self) {
+  return PyUnicode_FromFormat("<Dictionary id=0x%08x size=%zu>",
+                              (unsigned int)self->dict.id, self->dict.size);
+}
+
+static PyObject *dictionary_object_get_id(DictionaryObject *self,
+                                          void *closure
+                                          __attribute__((unused))) {
+  return PyLong_FromUnsignedLong(self->dict.id);
+}
+
+static PyObject *dictionary_object_get_data(DictionaryObject *self,
+                                            void *closure
+                                            __attribute__((unused))) {
+  return PyBytes_FromStringAndSize((const char *)self->dict.data,
+                                   (Py_ssize_t)self->dict.size);
+}
+
+static PyGetSetDef dictionary_object_getset[] = {
+    {"id", (getter)dictionary_object_get_id, NULL,
+     "Dictionary ID recorded in the headers of data compressed with it.",
+     NULL},
+    {"data", (getter)dictionary_object_get_data, NULL,
+     "Raw dictionary bytes, suitable for saving and reloading.", NULL},
+    {NULL, NULL, NULL, NULL, NULL} // Sentinel
+};
+
+static PyTypeObject DictionaryType = {
+    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "compresso._core.Dictionary",
+    .tp_doc = "Compression dictionary shared by compression and decompression.",
+    .tp_basicsize = sizeof(DictionaryObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)dictionary_object_init,
+    .tp_dealloc = (destructor)dictionary_object_dealloc,
+    .tp_repr = (reprfunc)dictionary_object_repr,
+    .tp_getset = dictionary_object_getset,
+};
+
+CDictionary *dictionary_from_object(PyObject *obj) {
+  CDictionary *dict = &((DictionaryObject *)obj)->dict;
+  if (!dict->data) {
+    PyErr_SetString(PyExc_RuntimeError, "Dictionary is not initialised");
+    return NULL;
+  }
+  return dict;
+}
+
+int dictionary_converter(PyObject *obj, void *out) {
+  CDictionary **dict = (CDictionary **)out;
+
+  if (obj == Py_None) {
+    *dict = NULL;
+    return 1;
+  }
+
+  if (!PyObject_TypeCheck(obj, &DictionaryType)) {
+    PyErr_Format(PyExc_TypeError,
+                 "dictionary must be a Dictionary or None, not %.100s",
+                 Py_TYPE(obj)->tp_name);
+    return 0;
+  }
+
+  *dict = dictionary_from_object(obj);
+  return *dict != NULL;
+}
+
+// ---- Training ----
+
+PyObject *dictionary_train(PyObject *samples, size_t dict_size,
+                           const CBackend *backend) {
+  if (!backend->dict_train) {
+    PyErr_Format(PyExc_ValueError,
+                 "Backend '%s' cannot train dictionaries", backend->name);
+    return NULL;
+  }
+
+  PyObject *seq = PySequence_Fast(samples, "samples must be a sequence");
+  if (!seq) {
+    return NULL;
+  }
+
+  Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+  if (count == 0 || (size_t)count > UINT32_MAX) {
+    PyErr_SetString(PyExc_ValueError, "samples must hold 1 to 2**32-1 items");
+    Py_DECREF(seq);
+    return NULL;
+  }
+
+  PyObject *result = NULL;
+  unsigned char *buffer = NULL;
+  unsigned char *dict_buffer = NULL;
+  size_t *sizes = (size_t *)calloc((size_t)count, sizeof(size_t));
+  if (!sizes) {
+    PyErr_NoMemory();
+    goto done;
+  }
+
+  // Samples are trained on back to back, so copy them into one buffer
+  size_t total = 0;
+  for (Py_ssize_t i = 0; i < count; i++) {
+    Py_buffer view;
+    if (PyObject_GetBuffer(PySequence_Fast_GET_ITEM(seq, i), &view,
+                           PyBUF_SIMPLE) != 0) {
+      goto done;
+    }
+    sizes[i] = (size_t)view.len;
+    total += sizes[i];
+    PyBuffer_Release(&view);
+  }
+
+  if (total == 0) {
+    PyErr_SetString(PyExc_ValueError, "samples are all empty");
+    goto done;
+  }
+
+  buffer = (unsigned char *)safe_malloc(total);
+  dict_buffer = buffer ? (unsigned char *)safe_malloc(dict_size) : NULL;
+  if (!dict_buffer) {
+    goto done;
+  }
+
+  size_t pos = 0;
+  for (Py_ssize_t i = 0; i < count; i++) {
+    Py_buffer view;
+    if (PyObject_GetBuffer(PySequence_Fast_GET_ITEM(seq, i), &view,
+                           PyBUF_SIMPLE) != 0) {
+      goto done;
+    }
+    if ((size_t)view.len != sizes[i]) {
+      PyBuffer_Release(&view);
+      PyErr_SetString(PyExc_RuntimeError, "samples changed during training");
+      goto done;
+    }
+    memcpy(buffer + pos, view.buf, sizes[i]);
+    pos += sizes[i];
+    PyBuffer_Release(&view);
+  }
+
+  size_t trained_size = dict_size;
+  if (backend->dict_train(buffer, sizes, (unsigned)count, dict_buffer,
+                          &trained_size) != 0) {
+    PyErr_Format(comp_BackendError,
+                 "Backend '%s' dictionary training failed (too few or too "
+                 "small samples?)",
+                 backend->name);
+    goto done;
+  }
+
+  result = PyObject_CallFunction((PyObject *)&DictionaryType, "y#",
+                                 (const char *)dict_buffer,
+                                 (Py_ssize_t)trained_size);
+
+done:
+  free(sizes);
+  free(buffer);
+  free(dict_buffer);
+  Py_DECREF(seq);
+  return result;
+}
+
+// ---- Registration ----
+
+int dictionary_type_init(PyObject *module) {
+  if (PyType_Ready(&DictionaryType) < 0) {
+    return -1;
+  }
+
+  Py_INCREF(&DictionaryType);
+  if (PyModule_AddObject(module, "Dictionary", (PyObject *)&DictionaryType) <
+      0) {
+    Py_DECREF(&DictionaryType);
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef DICTIONARY_H
+#define DICTIONARY_H
+
+#include "common.h"
+#include <Python.h>
+
+// ---- Dictionaries ----
+
+// Raw dictionary bytes plus the backend-digested forms built from them
+// (ZSTD_CDict/ZSTD_DDict, a loaded LZ4 stream, ...). Digests are created on
+// first use and live as long as the dictionary, so worker threads can share
+// them without locking.
+#define C_DICT_BACKENDS 8 // AlgoID values 0..ALGO_ZIP
+#define C_DICT_LEVELS 24  // -1 (default) .. 22
+
+typedef struct CDictionary {
+  uint32_t id; // stored in headers written with C_FLAG_DICTIONARY
+  unsigned char *data;
+  size_t size;
+  void *cdicts[C_DICT_BACKENDS][C_DICT_LEVELS];
+  void *ddicts[C_DICT_BACKENDS];
+} CDictionary;
+
+// Copies data and derives the ID; returns -1 with an exception set
+int dictionary_init(CDictionary *dict, const unsigned char *data, size_t size);
+
+void dictionary_clear(CDictionary *dict);
+
+// Digested form for backend and direction, created if needed. Call with
+// the GIL held, before any worker uses it. NULL with an exception set.
+const void *dictionary_digest(CDictionary *dict, const CBackend *backend,
+                              int compress, int level);
+
+// Checks a header's dictionary fields against the caller's dictionary and
+// returns the digest to decode with: NULL with *digest unset when the data
+// needs none. Returns -1 with an exception set on mismatch.
+int dictionary_for_header(CDictionary *dict, const CBackend *backend,
+                          uint8_t flags, uint32_t id, const void **digest);
+
+// ---- Python Type ----
+
+// "O&" converter: None leaves *(CDictionary **)out NULL, a Dictionary
+// stores its native dictionary (borrowed from the argument)
+int dictionary_converter(PyObject *obj, void *out);
+
+// Returns the native dictionary of a Dictionary object (borrowed)
+CDictionary *dictionary_from_object(PyObject *obj);
+
+// Trains a dictionary of at most dict_size bytes; returns a new Dictionary
+PyObject *dictionary_train(PyObject *samples, size_t dict_size,
+                           const CBackend *backend);
+
+// Adds Dictionary to the module; returns -1 on error
+int dictionary_type_init(PyObject *module);
+
+#endif // DICTIONARY_H
@@ -0,0 +1,1349 @@
+// Python.h turns these on for every other translation unit; this one does
+// without it but needs the same syscall, pread/pwrite and fseeko
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "fileio.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <malloc.h>
+#else
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(__linux__)
+#include <malloc.h>
+#endif
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define FILEIO_HAVE_URING 1
+#endif
+#endif
+#endif
+
+// ---- Chunk Size ----
+
+// Per thread, so concurrent calls with different settings do not interfere;
+// the values are stored in the keys themselves (NULL = default)
+static pthread_key_t chunk_key;
+static pthread_key_t engine_key;
+static pthread_key_t progress_key;
+static pthread_key_t cancel_key;
+static pthread_key_t waits_key;
+static pthread_once_t settings_once = PTHREAD_ONCE_INIT;
+static int settings_ready = 0;
+
+static void create_settings_keys(void) {
+  if (pthread_key_create(&chunk_key, NULL) != 0)
+    return;
+  if (pthread_key_create(&engine_key, NULL) != 0) {
+    pthread_key_delete(chunk_key);
+    return;
+  }
+  if (pthread_key_create(&progress_key, NULL) != 0) {
+    pthread_key_delete(engine_key);
+    pthread_key_delete(chunk_key);
+    return;
+  }
+  if (pthread_key_create(&cancel_key, NULL) != 0) {
+    pthread_key_delete(progress_key);
+    pthread_key_delete(engine_key);
+    pthread_key_delete(chunk_key);
+    return;
+  }
+  if (pthread_key_create(&waits_key, NULL) != 0) {
+    pthread_key_delete(cancel_key);
+    pthread_key_delete(progress_key);
+    pthread_key_delete(engine_key);
+    pthread_key_delete(chunk_key);
+    return;
+  }
+  settings_ready = 1;
+}
+
+size_t io_chunk_size(void) {
+  pthread_once(&settings_once, create_settings_keys);
+  if (!settings_ready)
+    return IO_CHUNK_DEFAULT;
+
+  size_t size = (size_t)(uintptr_t)pthread_getspecific(chunk_key);
+  return size ? size : IO_CHUNK_DEFAULT;
+}
+
+size_t io_set_chunk_size(size_t size) {
+  size_t previous = io_chunk_size();
+  if (!settings_ready)
+    return previous;
+
+  if (size == 0)
+    size = IO_CHUNK_DEFAULT;
+  else if (size < IO_CHUNK_MIN)
+    size = IO_CHUNK_MIN;
+  else if (size > IO_CHUNK_MAX)
+    size = IO_CHUNK_MAX;
+
+  (void)pthread_setspecific(chunk_key, (void *)(uintptr_t)size);
+  return previous;
+}
+
+// ---- Buffers ----
+
+static size_t page_size(void) {
+#if defined(_WIN32) || defined(_WIN64)
+  return 4096;
+#else
+  // sysconf on every buffer adds up; the page size never changes, so racing
+  // threads store the same value and a relaxed store is enough
+  static size_t cached = 0;
+  size_t size = __atomic_load_n(&cached, __ATOMIC_RELAXED);
+  if (!size) {
+    long n = sysconf(_SC_PAGESIZE);
+    size = n > 0 ? (size_t)n : 4096;
+    __atomic_store_n(&cached, size, __ATOMIC_RELAXED);
+  }
+  return size;
+#endif
+}
+
+// Bytes the allocator reserved for buf, which io_free has to give back
+static size_t alloc_size(void *buf) {
+#if defined(_WIN32) || defined(_WIN64)
+  return _aligned_msize(buf, page_size(), 0);
+#elif defined(__APPLE__)
+  return malloc_size(buf);
+#elif defined(__linux__)
+  return malloc_usable_size(buf);
+#else
+  (void)buf;
+  return 0;
+#endif
+}
+
+static int64_t buffer_live;
+static int64_t buffer_peak;
+
+static void buffer_account(int64_t delta) {
+  int64_t live = __atomic_add_fetch(&buffer_live, delta, __ATOMIC_RELAXED);
+  int64_t peak = __atomic_load_n(&buffer_peak, __ATOMIC_RELAXED);
+  while (live > peak &&
+         !__atomic_compare_exchange_n(&buffer_peak, &peak, live, 1,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+}
+
+void *io_alloc(size_t size) {
+  if (size == 0)
+    size = 1;
+
+#if defined(_WIN32) || defined(_WIN64)
+  void *buf = _aligned_malloc(size, page_size());
+#else
+  void *buf = NULL;
+  if (posix_memalign(&buf, page_size(), size) != 0)
+    return NULL;
+#endif
+  if (buf)
+    buffer_account((int64_t)alloc_size(buf));
+  return buf;
+}
+
+void io_free(void *buf) {
+  if (!buf)
+    return;
+  buffer_account(-(int64_t)alloc_size(buf));
+#if defined(_WIN32) || defined(_WIN64)
+  _aligned_free(buf);
+#else
+  free(buf);
+#endif
+}
+
+void io_buffer_usage(int64_t *live, int64_t *peak) {
+  *live = __atomic_load_n(&buffer_live, __ATOMIC_RELAXED);
+  *peak = __atomic_load_n(&buffer_peak, __ATOMIC_RELAXED);
+}
+
+void io_buffer_peak_reset(void) {
+  int64_t live = __atomic_load_n(&buffer_live, __ATOMIC_RELAXED);
+  __atomic_store_n(&buffer_peak, live, __ATOMIC_RELAXED);
+}
+
+int io_chunks_alloc(IOChunks *chunks, size_t in_size, size_t out_size) {
+  chunks->in_size = in_size ? in_size : io_chunk_size();
+  chunks->out_size = out_size ? out_size : io_chunk_size();
+  chunks->in = (unsigned char *)io_alloc(chunks->in_size);
+  chunks->out = (unsigned char *)io_alloc(chunks->out_size);
+  return chunks->in && chunks->out ? 0 : -1;
+}
+
+void io_chunks_free(IOChunks *chunks) {
+  io_free(chunks->in);
+  io_free(chunks->out);
+  chunks->in = NULL;
+  chunks->out = NULL;
+}
+
+// ---- Access Hints ----
+
+void io_advise_sequential(FILE *f) {
+#if defined(POSIX_FADV_SEQUENTIAL)
+  (void)posix_fadvise(fileno(f), 0, 0, POSIX_FADV_SEQUENTIAL);
+#else
+  (void)f;
+#endif
+}
+
+// ---- I/O Engines ----
+
+IOEngine io_engine(void) {
+  pthread_once(&settings_once, create_settings_keys);
+  if (!settings_ready)
+    return IO_ENGINE_STDIO;
+  return (IOEngine)(uintptr_t)pthread_getspecific(engine_key);
+}
+
+IOEngine io_set_engine(IOEngine engine) {
+  IOEngine previous = io_engine();
+  if (settings_ready)
+    (void)pthread_setspecific(engine_key, (void *)(uintptr_t)engine);
+  return previous;
+}
+
+int io_engine_from_name(const char *name, IOEngine *engine) {
+  if (!name || name[0] == '\0' || strcmp(name, "stdio") == 0) {
+    *engine = IO_ENGINE_STDIO;
+  } else if (strcmp(name, "uring") == 0 || strcmp(name, "io_uring") == 0) {
+    *engine = IO_ENGINE_URING;
+  } else if (strcmp(name, "threads") == 0) {
+    *engine = IO_ENGINE_THREADS;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+// ---- Progress ----
+
+IOProgress *io_progress(void) {
+  pthread_once(&settings_once, create_settings_keys);
+  if (!settings_ready)
+    return NULL;
+  return (IOProgress *)pthread_getspecific(progress_key);
+}
+
+IOProgress *io_set_progress(IOProgress *progress) {
+  IOProgress *previous = io_progress();
+  if (settings_ready)
+    (void)pthread_setspecific(progress_key, progress);
+  return previous;
+}
+
+static void progress_add(IOProgress *progress, uint64_t n) {
+  if (!progress || n == 0)
+    return;
+  uint64_t done = __atomic_add_fetch(&progress->done, n, __ATOMIC_RELAXED);
+  if (progress->notify)
+    progress->notify(progress, done);
+}
+
+void io_progress_advance(uint64_t n) { progress_add(io_progress(), n); }
+
+uint64_t io_progress_done(const IOProgress *progress) {
+  return __atomic_load_n(&progress->done, __ATOMIC_RELAXED);
+}
+
+// ---- Cancellation ----
+
+IOCancel *io_cancel(void) {
+  pthread_once(&settings_once, create_settings_keys);
+  if (!settings_ready)
+    return NULL;
+  return (IOCancel *)pthread_getspecific(cancel_key);
+}
+
+IOCancel *io_set_cancel(IOCancel *cancel) {
+  IOCancel *previous = io_cancel();
+  if (settings_ready)
+    (void)pthread_setspecific(cancel_key, cancel);
+  return previous;
+}
+
+void io_cancel_request(IOCancel *cancel) {
+  __atomic_store_n(&cancel->cancelled, 1, __ATOMIC_RELAXED);
+}
+
+int io_cancel_state(const IOCancel *cancel) {
+  if (!cancel)
+    return IO_CANCEL_NONE;
+  if (__atomic_load_n(&cancel->cancelled, __ATOMIC_RELAXED))
+    return IO_CANCEL_REQUESTED;
+  uint64_t deadline = __atomic_load_n(&cancel->deadline_ns, __ATOMIC_RELAXED);
+  if (deadline && io_monotonic_ns() >= deadline)
+    return IO_CANCEL_DEADLINE;
+  return IO_CANCEL_NONE;
+}
+
+int io_cancelled(void) { return io_cancel_state(io_cancel()); }
+
+uint64_t io_monotonic_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// ---- Wait Accounting ----
+
+static IOWaits wait_totals;
+
+IOWaits *io_waits(void) {
+  pthread_once(&settings_once, create_settings_keys);
+  if (!settings_ready)
+    return NULL;
+  return (IOWaits *)pthread_getspecific(waits_key);
+}
+
+IOWaits *io_set_waits(IOWaits *waits) {
+  IOWaits *previous = io_waits();
+  if (settings_ready)
+    (void)pthread_setspecific(waits_key, waits);
+  return previous;
+}
+
+void io_wait_add(int write, uint64_t bytes, uint64_t ns) {
+  uint64_t calls = bytes > 0;
+  IOWaits *tally = io_waits();
+  if (write) {
+    __atomic_fetch_add(&wait_totals.writes, calls, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&wait_totals.write_bytes, bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&wait_totals.write_ns, ns, __ATOMIC_RELAXED);
+    if (tally) {
+      tally->writes += calls;
+      tally->write_bytes += bytes;
+      tally->write_ns += ns;
+    }
+  } else {
+    __atomic_fetch_add(&wait_totals.reads, calls, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&wait_totals.read_bytes, bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&wait_totals.read_ns, ns, __ATOMIC_RELAXED);
+    if (tally) {
+      tally->reads += calls;
+      tally->read_bytes += bytes;
+      tally->read_ns += ns;
+    }
+  }
+}
+
+void io_waits_total(IOWaits *out) {
+  const uint64_t *from = (const uint64_t *)&wait_totals;
+  uint64_t *to = (uint64_t *)out;
+  for (size_t i = 0; i < sizeof(IOWaits) / sizeof(uint64_t); i++)
+    to[i] = __atomic_load_n(&from[i], __ATOMIC_RELAXED);
+}
+
+void io_waits_reset(void) {
+  uint64_t *words = (uint64_t *)&wait_totals;
+  for (size_t i = 0; i < sizeof(IOWaits) / sizeof(uint64_t); i++)
+    __atomic_store_n(&words[i], 0, __ATOMIC_RELAXED);
+}
+
+size_t io_fread(void *buf, size_t size, FILE *f) {
+  uint64_t start = io_monotonic_ns();
+  size_t n = fread(buf, 1, size, f);
+  io_wait_add(0, n, io_monotonic_ns() - start);
+  return n;
+}
+
+size_t io_fwrite(const void *buf, size_t size, FILE *f) {
+  uint64_t start = io_monotonic_ns();
+  size_t n = fwrite(buf, 1, size, f);
+  io_wait_add(1, n, io_monotonic_ns() - start);
+  return n;
+}
+
+// One chunk of a stream: its buffer and, under io_uring, the request
+// currently using it
+typedef struct {
+  unsigned char *buf;
+  size_t len;      // bytes read into / to write from buf
+  uint64_t offset; // file offset of the request
+  int busy;        // submitted, completion not yet consumed
+  int done;        // completion reaped into res
+  int64_t res;     // bytes transferred, or -errno
+#if defined(FILEIO_HAVE_URING)
+  struct iovec iov; // must outlive the request
+#endif
+} IOSlot;
+
+#if defined(FILEIO_HAVE_URING)
+
+// A minimal ring over the raw syscalls, so no liburing is needed. Each
+// stream owns one and is its only user, so the only ordering that matters
+// is against the kernel: acquire on the tails it writes, release on ours.
+typedef struct {
+  int fd;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_map;
+  void *cq_map;
+  size_t sq_map_len;
+  size_t cq_map_len;
+  size_t sqes_len;
+} URing;
+
+static int uring_init(URing *r, unsigned entries) {
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  memset(r, 0, sizeof(*r));
+  r->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+  if (r->fd < 0)
+    return -1;
+
+  r->sq_map_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  r->cq_map_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (r->cq_map_len > r->sq_map_len)
+      r->sq_map_len = r->cq_map_len;
+    r->cq_map_len = 0; // shares sq_map
+  }
+
+  r->sq_map = mmap(NULL, r->sq_map_len, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+  if (r->sq_map == MAP_FAILED) {
+    close(r->fd);
+    return -1;
+  }
+  r->cq_map = r->sq_map;
+  if (r->cq_map_len) {
+    r->cq_map = mmap(NULL, r->cq_map_len, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+    if (r->cq_map == MAP_FAILED) {
+      munmap(r->sq_map, r->sq_map_len);
+      close(r->fd);
+      return -1;
+    }
+  }
+  r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+  r->sqes = (struct io_uring_sqe *)mmap(NULL, r->sqes_len,
+                                        PROT_READ | PROT_WRITE,
+                                        MAP_SHARED | MAP_POPULATE, r->fd,
+                                        IORING_OFF_SQES);
+  if (r->sqes == MAP_FAILED) {
+    if (r->cq_map_len)
+      munmap(r->cq_map, r->cq_map_len);
+    munmap(r->sq_map, r->sq_map_len);
+    close(r->fd);
+    return -1;
+  }
+
+  unsigned char *sq = (unsigned char *)r->sq_map;
+  unsigned char *cq = (unsigned char *)r->cq_map;
+  r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+  r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+  r->sq_array = (unsigned *)(sq + p.sq_off.array);
+  r->cq_head = (unsigned *)(cq + p.cq_off.head);
+  r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+  r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+  r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+  return 0;
+}
+
+static void uring_destroy(URing *r) {
+  munmap(r->sqes, r->sqes_len);
+  if (r->cq_map_len)
+    munmap(r->cq_map, r->cq_map_len);
+  munmap(r->sq_map, r->sq_map_len);
+  close(r->fd);
+}
+
+static int uring_enter(URing *r, unsigned to_submit, unsigned min_complete) {
+  unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+  for (;;) {
+    long n = syscall(__NR_io_uring_enter, r->fd, to_submit, min_complete,
+                     flags, NULL, 0);
+    if (n >= 0 || errno != EINTR)
+      return n < 0 ? -1 : 0;
+  }
+}
+
+// Queue and submit one whole-slot read or write; the slot's index in
+// slots comes back as the completion's user_data
+static int uring_submit(URing *r, int fd, IOSlot *slot, unsigned index,
+                        int write) {
+  unsigned tail = *r->sq_tail;
+  unsigned at = tail & *r->sq_mask;
+  struct io_uring_sqe *sqe = &r->sqes[at];
+  memset(sqe, 0, sizeof(*sqe));
+
+  slot->iov.iov_base = slot->buf;
+  slot->iov.iov_len = slot->len;
+  sqe->opcode = write ? IORING_OP_WRITEV : IORING_OP_READV;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(uintptr_t)&slot->iov;
+  sqe->len = 1;
+  sqe->off = slot->offset;
+  sqe->user_data = index;
+
+  r->sq_array[at] = at;
+  __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  if (uring_enter(r, 1, 0) != 0)
+    return -1;
+  slot->busy = 1;
+  slot->done = 0;
+  return 0;
+}
+
+// Block until slots[index] has completed, reaping whatever finishes first
+static int uring_wait(URing *r, IOSlot *slots, unsigned index) {
+  while (!slots[index].done) {
+    unsigned head = *r->cq_head;
+    if (head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+      if (uring_enter(r, 0, 1) != 0)
+        return -1;
+      continue;
+    }
+    struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+    IOSlot *slot = &slots[cqe->user_data];
+    slot->res = cqe->res;
+    slot->done = 1;
+    __atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+  }
+  return 0;
+}
+
+// Finish a completed request the kernel cut short (signals, quotas) with
+// plain pread/pwrite; a read may legitimately stop early at end of file.
+// Returns the bytes transferred in total, or -1.
+static int64_t slot_complete(int fd, IOSlot *slot, int write) {
+  if (slot->res < 0) {
+    errno = (int)-slot->res;
+    return -1;
+  }
+  size_t have = (size_t)slot->res;
+  while (have < slot->len) {
+    ssize_t n = write ? pwrite(fd, slot->buf + have, slot->len - have,
+                               (off_t)(slot->offset + have))
+                      : pread(fd, slot->buf + have, slot->len - have,
+                              (off_t)(slot->offset + have));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return -1;
+    if (n == 0) {
+      if (write)
+        return -1; // a regular file never takes zero bytes
+      break;
+    }
+    have += (size_t)n;
+  }
+  return (int64_t)have;
+}
+
+static pthread_once_t probe_once = PTHREAD_ONCE_INIT;
+static int uring_works = 0;
+
+// Containers and hardened kernels often refuse the syscall outright
+static void probe_uring(void) {
+  URing r;
+  if (uring_init(&r, 2) == 0) {
+    uring_works = 1;
+    uring_destroy(&r);
+  }
+}
+
+int io_uring_available(void) {
+  pthread_once(&probe_once, probe_uring);
+  return uring_works;
+}
+
+// The descriptor a ring should use for f, or -1 to fall back to stdio
+static int uring_fd_for(FILE *f) {
+  if (!io_uring_available())
+    return -1;
+  int fd = fileno(f);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    return -1; // pipes and devices have no offsets to read ahead at
+  return fd;
+}
+
+#else
+
+int io_uring_available(void) { return 0; }
+
+#endif
+
+// ---- Stage Threads ----
+
+// The threads engine moves the stdio calls onto a thread of their own per
+// stream. The stream's slots form a bounded ring between it and the codec:
+// `head` counts slots produced (read, or committed for writing) and `tail`
+// slots consumed (released by the codec, or written), both under lock.
+typedef struct {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond; // any change to head, tail or stop
+  unsigned head;
+  unsigned tail;
+  int stop;
+} IOStage;
+
+static int stage_start(IOStage *st, void *(*main)(void *), void *arg) {
+  if (pthread_mutex_init(&st->lock, NULL) != 0)
+    return -1;
+  if (pthread_cond_init(&st->cond, NULL) != 0) {
+    pthread_mutex_destroy(&st->lock);
+    return -1;
+  }
+  if (pthread_create(&st->thread, NULL, main, arg) != 0) {
+    pthread_cond_destroy(&st->cond);
+    pthread_mutex_destroy(&st->lock);
+    return -1;
+  }
+  return 0;
+}
+
+static void stage_join(IOStage *st) {
+  pthread_mutex_lock(&st->lock);
+  st->stop = 1;
+  pthread_cond_broadcast(&st->cond);
+  pthread_mutex_unlock(&st->lock);
+  pthread_join(st->thread, NULL);
+  pthread_cond_destroy(&st->cond);
+  pthread_mutex_destroy(&st->lock);
+}
+
+// ---- Streaming Reader ----
+
+struct IOReader {
+  FILE *f;
+  IOEngine engine; // the one actually in use
+  size_t chunk;
+  IOSlot slots[IO_RING_DEPTH];
+  int64_t start;     // f's position at open, or -1 if it has none
+  uint64_t consumed; // bytes handed out so far
+  IOProgress *progress;
+  IOCancel *cancel;
+  int failed;
+  int ended;
+  unsigned next; // slot handed out by the next call
+  int current;   // slot handed out by the last call, or -1
+  IOStage stage; // threads engine
+#if defined(FILEIO_HAVE_URING)
+  int fd;
+  URing ring;
+  uint64_t read_off; // offset of the next read to submit
+#endif
+};
+
+static IOReader *reader_alloc(FILE *f, IOEngine engine) {
+  IOReader *r = (IOReader *)calloc(1, sizeof(IOReader));
+  if (!r)
+    return NULL;
+  r->f = f;
+  r->engine = engine;
+  r->chunk = io_chunk_size();
+  r->progress = io_progress();
+  r->cancel = io_cancel();
+  r->current = -1;
+  int nslots = engine == IO_ENGINE_STDIO ? 1 : IO_RING_DEPTH;
+  for (int i = 0; i < nslots; i++) {
+    r->slots[i].buf = (unsigned char *)io_alloc(r->chunk);
+    if (!r->slots[i].buf) {
+      for (int j = 0; j < i; j++)
+        io_free(r->slots[j].buf);
+      free(r);
+      return NULL;
+    }
+  }
+  off_t pos = ftello(f);
+  r->start = pos >= 0 ? (int64_t)pos : -1;
+  return r;
+}
+
+static void reader_free(IOReader *r) {
+  for (int i = 0; i < IO_RING_DEPTH; i++)
+    io_free(r->slots[i].buf);
+  free(r);
+}
+
+// Fill slots in order until the file ends, fails, or the reader closes;
+// res carries the bytes read or -1, done marks the last slot
+static void *reader_main(void *arg) {
+  IOReader *r = (IOReader *)arg;
+  IOStage *st = &r->stage;
+  int last = 0;
+
+  pthread_mutex_lock(&st->lock);
+  while (!last) {
+    while (!st->stop && st->head - st->tail == IO_RING_DEPTH)
+      pthread_cond_wait(&st->cond, &st->lock);
+    if (st->stop)
+      break;
+    IOSlot *slot = &r->slots[st->head % IO_RING_DEPTH];
+    pthread_mutex_unlock(&st->lock);
+
+    size_t n = fread(slot->buf, 1, r->chunk, r->f);
+    slot->res = ferror(r->f) ? -1 : (int64_t)n;
+    last = slot->res < 0 || feof(r->f);
+    slot->done = last;
+
+    pthread_mutex_lock(&st->lock);
+    st->head++;
+    pthread_cond_broadcast(&st->cond);
+  }
+  pthread_mutex_unlock(&st->lock);
+  return NULL;
+}
+
+#if defined(FILEIO_HAVE_URING)
+static int reader_start_uring(IOReader *r) {
+  r->fd = uring_fd_for(r->f);
+  if (r->fd < 0 || r->start < 0 ||
+      uring_init(&r->ring, IO_RING_DEPTH * 2) != 0)
+    return -1;
+
+  r->read_off = (uint64_t)r->start;
+  for (unsigned i = 0; i < IO_RING_DEPTH && !r->failed; i++) {
+    r->slots[i].len = r->chunk;
+    r->slots[i].offset = r->read_off;
+    r->read_off += r->chunk;
+    if (uring_submit(&r->ring, r->fd, &r->slots[i], i, 0) != 0)
+      r->failed = 1;
+  }
+  return 0;
+}
+#endif
+
+IOReader *io_reader_open(FILE *f) {
+  IOEngine engine = io_engine();
+  if (engine != IO_ENGINE_STDIO) {
+    IOReader *r = reader_alloc(f, engine);
+    if (!r)
+      return NULL;
+    int started = -1;
+#if defined(FILEIO_HAVE_URING)
+    if (engine == IO_ENGINE_URING)
+      started = reader_start_uring(r);
+#endif
+    if (engine == IO_ENGINE_THREADS)
+      started = stage_start(&r->stage, reader_main, r);
+    if (started == 0)
+      return r;
+    reader_free(r);
+  }
+  return reader_alloc(f, IO_ENGINE_STDIO);
+}
+
+// The next slot as its engine fills it: bytes in it, or -1
+static int64_t reader_fill(IOReader *r, IOSlot *slot, int *last) {
+#if defined(FILEIO_HAVE_URING)
+  if (r->engine == IO_ENGINE_URING) {
+    // The chunk handed out last is free again: read further ahead into it
+    if (r->current >= 0) {
+      IOSlot *prev = &r->slots[r->current];
+      prev->busy = 0;
+      prev->offset = r->read_off;
+      r->read_off += r->chunk;
+      if (uring_submit(&r->ring, r->fd, prev, (unsigned)r->current, 0) != 0)
+        return -1;
+    }
+    if (uring_wait(&r->ring, r->slots, r->next) != 0)
+      return -1;
+    int64_t got = slot_complete(r->fd, slot, 0);
+    *last = got >= 0 && (size_t)got < r->chunk;
+    return got;
+  }
+#endif
+
+  if (r->engine == IO_ENGINE_THREADS) {
+    IOStage *st = &r->stage;
+    pthread_mutex_lock(&st->lock);
+    if (r->current >= 0) {
+      st->tail++;
+      pthread_cond_broadcast(&st->cond);
+    }
+    while (st->head == st->tail)
+      pthread_cond_wait(&st->cond, &st->lock);
+    pthread_mutex_unlock(&st->lock);
+    *last = slot->done;
+    return slot->res;
+  }
+
+  size_t n = fread(slot->buf, 1, r->chunk, r->f);
+  *last = feof(r->f) != 0;
+  return ferror(r->f) ? -1 : (int64_t)n;
+}
+
+static int reader_next(IOReader *r, const unsigned char **data, size_t *size,
+                       int *at_end) {
+  *size = 0;
+  *at_end = r->ended;
+  *data = r->slots[0].buf;
+  if (r->failed)
+    return -1;
+  if (r->ended)
+    return 0;
+  if (io_cancel_state(r->cancel) != IO_CANCEL_NONE) {
+    r->failed = 1;
+    return -1;
+  }
+
+  IOSlot *slot = &r->slots[r->next];
+  int last = 0;
+  int64_t got = reader_fill(r, slot, &last);
+  if (got < 0) {
+    r->failed = 1;
+    return -1;
+  }
+
+  *data = slot->buf;
+  *size = (size_t)got;
+  r->consumed += (uint64_t)got;
+  progress_add(r->progress, (uint64_t)got);
+  r->ended = last;
+  *at_end = last;
+  if (r->engine != IO_ENGINE_STDIO) {
+    r->current = (int)r->next;
+    r->next = (r->next + 1) % IO_RING_DEPTH;
+  }
+  return 0;
+}
+
+int io_reader_next(IOReader *r, const unsigned char **data, size_t *size,
+                   int *at_end) {
+  uint64_t start = io_monotonic_ns();
+  int rc = reader_next(r, data, size, at_end);
+  io_wait_add(0, *size, io_monotonic_ns() - start);
+  return rc;
+}
+
+void io_reader_close(IOReader *r) {
+  if (!r)
+    return;
+
+#if defined(FILEIO_HAVE_URING)
+  if (r->engine == IO_ENGINE_URING) {
+    // The kernel may still be filling the buffers of reads past the end
+    for (unsigned i = 0; i < IO_RING_DEPTH; i++) {
+      if (r->slots[i].busy && !r->slots[i].done)
+        (void)uring_wait(&r->ring, r->slots, i);
+    }
+    uring_destroy(&r->ring);
+  }
+#endif
+  if (r->engine == IO_ENGINE_THREADS)
+    stage_join(&r->stage);
+
+  // Both read past what was handed out; put f back where the caller is
+  if (r->engine != IO_ENGINE_STDIO && r->start >= 0)
+    (void)fseeko(r->f, (off_t)(r->start + (int64_t)r->consumed), SEEK_SET);
+  reader_free(r);
+}
+
+// ---- Streaming Writer ----
+
+struct IOWriter {
+  FILE *f;
+  IOEngine engine; // the one actually in use
+  size_t chunk;
+  IOSlot slots[IO_RING_DEPTH];
+  IOCancel *cancel;
+  int failed;    // under stage.lock for the threads engine
+  unsigned next; // slot the next buffer comes from
+  IOStage stage; // threads engine
+#if defined(FILEIO_HAVE_URING)
+  int fd;
+  URing ring;
+  uint64_t write_off; // offset of the next write
+#endif
+};
+
+static IOWriter *writer_alloc(FILE *f, IOEngine engine) {
+  IOWriter *w = (IOWriter *)calloc(1, sizeof(IOWriter));
+  if (!w)
+    return NULL;
+  w->f = f;
+  w->engine = engine;
+  w->chunk = io_chunk_size();
+  w->cancel = io_cancel();
+  int nslots = engine == IO_ENGINE_STDIO ? 1 : IO_RING_DEPTH;
+  for (int i = 0; i < nslots; i++) {
+    w->slots[i].buf = (unsigned char *)io_alloc(w->chunk);
+    if (!w->slots[i].buf) {
+      for (int j = 0; j < i; j++)
+        io_free(w->slots[j].buf);
+      free(w);
+      return NULL;
+    }
+  }
+  return w;
+}
+
+static void writer_free(IOWriter *w) {
+  for (int i = 0; i < IO_RING_DEPTH; i++)
+    io_free(w->slots[i].buf);
+  free(w);
+}
+
+// Write committed slots in order until the writer closes with none left.
+// After a failure the rest are dropped, so the codec never blocks on us.
+static void *writer_main(void *arg) {
+  IOWriter *w = (IOWriter *)arg;
+  IOStage *st = &w->stage;
+
+  pthread_mutex_lock(&st->lock);
+  for (;;) {
+    while (!st->stop && st->head == st->tail)
+      pthread_cond_wait(&st->cond, &st->lock);
+    if (st->head == st->tail)
+      break; // stopped and drained
+    IOSlot *slot = &w->slots[st->tail % IO_RING_DEPTH];
+    int failed = w->failed;
+    pthread_mutex_unlock(&st->lock);
+
+    if (!failed)
+      failed = fwrite(slot->buf, 1, slot->len, w->f) != slot->len ||
+               ferror(w->f);
+
+    pthread_mutex_lock(&st->lock);
+    w->failed = failed;
+    st->tail++;
+    pthread_cond_broadcast(&st->cond);
+  }
+  pthread_mutex_unlock(&st->lock);
+  return NULL;
+}
+
+#if defined(FILEIO_HAVE_URING)
+static int writer_start_uring(IOWriter *w) {
+  w->fd = uring_fd_for(w->f);
+  // Whatever f still buffers must land before the ring writes after it
+  off_t pos = w->fd >= 0 && fflush(w->f) == 0 ? ftello(w->f) : -1;
+  if (pos < 0 || uring_init(&w->ring, IO_RING_DEPTH * 2) != 0)
+    return -1;
+  w->write_off = (uint64_t)pos;
+  return 0;
+}
+
+// Retire slot index's write, if it has one
+static void writer_retire(IOWriter *w, unsigned index) {
+  IOSlot *slot = &w->slots[index];
+  if (!slot->busy)
+    return;
+  if (uring_wait(&w->ring, w->slots, index) != 0 ||
+      slot_complete(w->fd, slot, 1) != (int64_t)slot->len)
+    w->failed = 1;
+  slot->busy = 0;
+}
+#endif
+
+IOWriter *io_writer_open(FILE *f) {
+  IOEngine engine = io_engine();
+  if (engine != IO_ENGINE_STDIO) {
+    IOWriter *w = writer_alloc(f, engine);
+    if (!w)
+      return NULL;
+    int started = -1;
+#if defined(FILEIO_HAVE_URING)
+    if (engine == IO_ENGINE_URING)
+      started = writer_start_uring(w);
+#endif
+    if (engine == IO_ENGINE_THREADS)
+      started = stage_start(&w->stage, writer_main, w);
+    if (started == 0)
+      return w;
+    writer_free(w);
+  }
+  return writer_alloc(f, IO_ENGINE_STDIO);
+}
+
+static unsigned char *writer_buffer(IOWriter *w, size_t *capacity) {
+  *capacity = w->chunk;
+  if (io_cancel_state(w->cancel) != IO_CANCEL_NONE)
+    return NULL; // the caller abandons the stream, pending writes or not
+  IOSlot *slot = &w->slots[w->next];
+  int failed = w->failed;
+
+#if defined(FILEIO_HAVE_URING)
+  if (w->engine == IO_ENGINE_URING) {
+    writer_retire(w, w->next); // the oldest write, DEPTH commits ago
+    failed = w->failed;
+  }
+#endif
+  if (w->engine == IO_ENGINE_THREADS) {
+    IOStage *st = &w->stage;
+    pthread_mutex_lock(&st->lock);
+    while (st->head - st->tail == IO_RING_DEPTH)
+      pthread_cond_wait(&st->cond, &st->lock);
+    failed = w->failed;
+    pthread_mutex_unlock(&st->lock);
+  }
+  return failed ? NULL : slot->buf;
+}
+
+unsigned char *io_writer_buffer(IOWriter *w, size_t *capacity) {
+  uint64_t start = io_monotonic_ns();
+  unsigned char *buf = writer_buffer(w, capacity);
+  io_wait_add(1, 0, io_monotonic_ns() - start);
+  return buf;
+}
+
+static int writer_commit(IOWriter *w, size_t size) {
+  IOSlot *slot = &w->slots[w->next];
+  slot->len = size;
+
+#if defined(FILEIO_HAVE_URING)
+  if (w->engine == IO_ENGINE_URING) {
+    if (w->failed)
+      return -1;
+    if (size == 0)
+      return 0;
+    slot->offset = w->write_off;
+    if (uring_submit(&w->ring, w->fd, slot, w->next, 1) != 0) {
+      w->failed = 1;
+      return -1;
+    }
+    w->write_off += size;
+    w->next = (w->next + 1) % IO_RING_DEPTH;
+    return 0;
+  }
+#endif
+  if (w->engine == IO_ENGINE_THREADS) {
+    IOStage *st = &w->stage;
+    pthread_mutex_lock(&st->lock);
+    int failed = w->failed;
+    if (!failed && size > 0) {
+      st->head++;
+      pthread_cond_broadcast(&st->cond);
+      w->next = (w->next + 1) % IO_RING_DEPTH;
+    }
+    pthread_mutex_unlock(&st->lock);
+    return failed ? -1 : 0;
+  }
+
+  if (w->failed)
+    return -1;
+  if (size > 0 && (fwrite(slot->buf, 1, size, w->f) != size || ferror(w->f)))
+    w->failed = 1;
+  return w->failed ? -1 : 0;
+}
+
+int io_writer_commit(IOWriter *w, size_t size) {
+  uint64_t start = io_monotonic_ns();
+  int rc = writer_commit(w, size);
+  io_wait_add(1, rc == 0 ? size : 0, io_monotonic_ns() - start);
+  return rc;
+}
+
+int io_writer_close(IOWriter *w) {
+  if (!w)
+    return -1;
+  uint64_t start = io_monotonic_ns();
+
+#if defined(FILEIO_HAVE_URING)
+  if (w->engine == IO_ENGINE_URING) {
+    for (unsigned i = 0; i < IO_RING_DEPTH; i++)
+      writer_retire(w, i);
+    uring_destroy(&w->ring);
+    if (fseeko(w->f, (off_t)w->write_off, SEEK_SET) != 0)
+      w->failed = 1;
+  }
+#endif
+  if (w->engine == IO_ENGINE_THREADS)
+    stage_join(&w->stage); // writes whatever is still committed
+
+  int err = w->failed ? -1 : 0;
+  writer_free(w);
+  io_wait_add(1, 0, io_monotonic_ns() - start);
+  return err;
+}
+
+// ---- Read Streams ----
+
+#if defined(__GLIBC__) || defined(__APPLE__) || defined(__FreeBSD__)
+#define IO_READ_STREAMS 1
+
+typedef struct {
+  IOReadFn read;
+  void *ctx;
+} ReadStream;
+
+static ssize_t read_stream_read(void *cookie, char *buf, size_t size) {
+  ReadStream *s = (ReadStream *)cookie;
+  size_t got = 0;
+  int error = s->read(s->ctx, buf, size, &got);
+  if (error) {
+    errno = error;
+    return -1;
+  }
+  return (ssize_t)got;
+}
+
+#if !defined(__GLIBC__)
+// funopen's callbacks count in ints
+static int read_stream_read_int(void *cookie, char *buf, int size) {
+  return (int)read_stream_read(cookie, buf, (size_t)size);
+}
+#endif
+
+static int read_stream_close(void *cookie) {
+  free(cookie);
+  return 0;
+}
+#endif
+
+FILE *io_open_read_stream(IOReadFn read, void *ctx) {
+#if defined(IO_READ_STREAMS)
+  ReadStream *s = (ReadStream *)malloc(sizeof(ReadStream));
+  if (!s)
+    return NULL;
+  s->read = read;
+  s->ctx = ctx;
+#if defined(__GLIBC__)
+  cookie_io_functions_t fns = {.read = read_stream_read,
+                               .close = read_stream_close};
+  FILE *f = fopencookie(s, "rb", fns);
+#else
+  FILE *f = funopen(s, read_stream_read_int, NULL, NULL, read_stream_close);
+#endif
+  if (!f)
+    free(s);
+  return f;
+#else
+  (void)read;
+  (void)ctx;
+  errno = ENOTSUP;
+  return NULL;
+#endif
+}
+
+// ---- Sparse Files ----
+
+int io_is_zero(const unsigned char *data, size_t size) {
+  // Every byte equals the one before it, and the first is zero
+  return size == 0 || (data[0] == 0 && memcmp(data, data + 1, size - 1) == 0);
+}
+
+// Next run of whole zero grains counted from `from`: sets [*start, *end) and
+// returns 1, or returns 0 when none is left
+static int next_zero_run(const unsigned char *data, size_t size, size_t from,
+                         size_t *start, size_t *end) {
+  size_t pos = from;
+  while (pos + IO_SPARSE_GRAIN <= size &&
+         !io_is_zero(data + pos, IO_SPARSE_GRAIN))
+    pos += IO_SPARSE_GRAIN;
+  if (pos + IO_SPARSE_GRAIN > size)
+    return 0;
+
+  size_t run_end = pos + IO_SPARSE_GRAIN;
+  while (run_end + IO_SPARSE_GRAIN <= size &&
+         io_is_zero(data + run_end, IO_SPARSE_GRAIN))
+    run_end += IO_SPARSE_GRAIN;
+  *start = pos;
+  *end = run_end;
+  return 1;
+}
+
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+// lseek(whence) from offset on f's descriptor, then put the descriptor's
+// position back, which stdio keeps track of on its own
+static uint64_t seek_extent(FILE *f, uint64_t offset, uint64_t end,
+                            int whence) {
+  if (offset >= end)
+    return end;
+  int fd = fileno(f);
+  off_t saved = fd >= 0 ? lseek(fd, 0, SEEK_CUR) : -1;
+  if (saved < 0)
+    return whence == SEEK_DATA ? offset : end;
+
+  off_t found = lseek(fd, (off_t)offset, whence);
+  int err = errno;
+  (void)lseek(fd, saved, SEEK_SET);
+  if (found < 0) // ENXIO: only a hole is left; anything else: unsupported
+    return whence == SEEK_HOLE || err == ENXIO ? end : offset;
+  return (uint64_t)found < end ? (uint64_t)found : end;
+}
+#endif
+
+uint64_t io_next_data(FILE *f, uint64_t offset, uint64_t end) {
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+  return seek_extent(f, offset, end, SEEK_DATA);
+#else
+  (void)f;
+  (void)end;
+  return offset;
+#endif
+}
+
+uint64_t io_next_hole(FILE *f, uint64_t offset, uint64_t end) {
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+  return seek_extent(f, offset, end, SEEK_HOLE);
+#else
+  (void)f;
+  (void)offset;
+  return end;
+#endif
+}
+
+static const unsigned char zero_grain[IO_SPARSE_GRAIN];
+
+int io_write_hole(FILE *f, uint64_t size) {
+  if (size == 0)
+    return 0;
+#if !defined(_WIN32) && !defined(_WIN64)
+  if (fileno(f) >= 0 && fseeko(f, (off_t)size, SEEK_CUR) == 0)
+    return 0;
+#endif
+
+  // A memory stream or a pipe: spell the zeros out
+  while (size > 0) {
+    size_t n = size < sizeof(zero_grain) ? (size_t)size : sizeof(zero_grain);
+    if (fwrite(zero_grain, 1, n, f) != n)
+      return -1;
+    size -= n;
+  }
+  return 0;
+}
+
+// Bytes from position pos to the next grain boundary, capped at size
+static size_t grain_lead(uint64_t pos, size_t size) {
+  size_t lead = (size_t)((IO_SPARSE_GRAIN - pos % IO_SPARSE_GRAIN) %
+                         IO_SPARSE_GRAIN);
+  return lead < size ? lead : size;
+}
+
+static int write_sparse(FILE *f, const unsigned char *data, size_t size) {
+  if (fileno(f) < 0) // nowhere to leave a hole
+    return fwrite(data, 1, size, f) == size ? 0 : -1;
+
+  off_t pos = ftello(f);
+  size_t done = 0; // bytes written or skipped so far
+  size_t from = grain_lead(pos > 0 ? (uint64_t)pos : 0, size);
+  size_t start, end;
+  while (next_zero_run(data, size, from, &start, &end)) {
+    if (fwrite(data + done, 1, start - done, f) != start - done ||
+        io_write_hole(f, end - start) != 0)
+      return -1;
+    done = from = end;
+  }
+  return fwrite(data + done, 1, size - done, f) == size - done ? 0 : -1;
+}
+
+int io_write_sparse(FILE *f, const unsigned char *data, size_t size) {
+  uint64_t start = io_monotonic_ns();
+  int rc = write_sparse(f, data, size);
+  io_wait_add(1, rc == 0 ? size : 0, io_monotonic_ns() - start);
+  return rc;
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+// Extend a regular file to size if it is shorter
+static int grow_file(int fd, off_t size) {
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+    return errno;
+  if (S_ISREG(st.st_mode) && st.st_size < size && ftruncate(fd, size) != 0)
+    return errno;
+  return 0;
+}
+#endif
+
+int io_sparse_finish(FILE *f) {
+  if (fflush(f) != 0)
+    return -1;
+#if !defined(_WIN32) && !defined(_WIN64)
+  int fd = fileno(f);
+  if (fd < 0)
+    return 0;
+  off_t end = ftello(f);
+  if (end < 0 || grow_file(fd, end) != 0)
+    return -1;
+#endif
+  return 0;
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+static int write_full_fd(int fd, const unsigned char *data, size_t size) {
+  while (size > 0) {
+    ssize_t n = write(fd, data, size);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return errno;
+    }
+    data += n;
+    size -= (size_t)n;
+  }
+  return 0;
+}
+
+static int write_sparse_fd(int fd, const unsigned char *data, size_t size) {
+  off_t pos = lseek(fd, 0, SEEK_CUR);
+  if (pos < 0) // a pipe: nowhere to leave a hole
+    return write_full_fd(fd, data, size);
+
+  size_t done = 0;
+  size_t from = grain_lead((uint64_t)pos, size);
+  size_t start, end;
+  while (next_zero_run(data, size, from, &start, &end)) {
+    int error = write_full_fd(fd, data + done, start - done);
+    if (error)
+      return error;
+    if (lseek(fd, (off_t)(end - start), SEEK_CUR) < 0)
+      return errno;
+    done = from = end;
+  }
+  return write_full_fd(fd, data + done, size - done);
+}
+
+int io_write_sparse_fd(int fd, const unsigned char *data, size_t size) {
+  uint64_t start = io_monotonic_ns();
+  int error = write_sparse_fd(fd, data, size);
+  io_wait_add(1, error ? 0 : size, io_monotonic_ns() - start);
+  return error;
+}
+
+int io_sparse_finish_fd(int fd) {
+  off_t end = lseek(fd, 0, SEEK_CUR);
+  return end < 0 ? errno : grow_file(fd, end);
+}
+#endif
+
+void io_punch_zeros(int fd, const unsigned char *data, size_t size) {
+#if defined(FALLOC_FL_PUNCH_HOLE) && defined(FALLOC_FL_KEEP_SIZE)
+  size_t done = 0;
+  size_t start, end;
+  while (next_zero_run(data, size, done, &start, &end)) {
+    if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                  (off_t)start, (off_t)(end - start)) != 0)
+      return; // the filesystem keeps its blocks; the zeros stay
+    done = end;
+  }
+#else
+  (void)fd;
+  (void)data;
+  (void)size;
+#endif
+}
@@ -0,0 +1,251 @@
+#ifndef FILEIO_H
+#define FILEIO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// ---- Streaming I/O ----
+
+// Shared buffering for every chunked read/write loop. Chunks are
+// page-aligned heap buffers; a chunk at least as large as stdio's own buffer
+// goes straight to read/write without an intermediate copy. Pure C: safe on
+// any thread, never touches Python.
+
+#define IO_CHUNK_MIN (64U * 1024)          // 64KB
+#define IO_CHUNK_MAX (16U * 1024 * 1024)   // 16MB
+#define IO_CHUNK_DEFAULT IO_CHUNK_MIN
+
+// Chunk size for streaming loops on the calling thread
+size_t io_chunk_size(void);
+
+// Set the calling thread's chunk size (0 = IO_CHUNK_DEFAULT) and return the
+// previous one, so callers can restore it when done. Sizes outside
+// [IO_CHUNK_MIN, IO_CHUNK_MAX] are clamped.
+size_t io_set_chunk_size(size_t size);
+
+// Page-aligned buffer of size bytes, or NULL; release with io_free
+void *io_alloc(size_t size);
+void io_free(void *buf);
+
+// Bytes held in io_alloc buffers now and at most since the last
+// io_buffer_peak_reset; 0 where the platform cannot size an allocation
+void io_buffer_usage(int64_t *live, int64_t *peak);
+void io_buffer_peak_reset(void);
+
+// The input/output pair of a streaming loop
+typedef struct {
+  unsigned char *in;
+  unsigned char *out;
+  size_t in_size;
+  size_t out_size;
+} IOChunks;
+
+// Allocate both buffers (0 = io_chunk_size()); -1 if either failed, in
+// which case io_chunks_free is still safe to call
+int io_chunks_alloc(IOChunks *chunks, size_t in_size, size_t out_size);
+void io_chunks_free(IOChunks *chunks);
+
+// Hint that f (just opened) is about to be read front to back
+void io_advise_sequential(FILE *f);
+
+// ---- Progress ----
+
+// Byte counter the streaming loops advance once per chunk of input they
+// consume. done is only touched atomically, so another thread can poll it
+// with io_progress_done while a loop runs without the GIL. notify, if set,
+// is called on the loop's thread after every advance with the new total;
+// like the rest of this layer it must not touch Python.
+typedef struct IOProgress {
+  uint64_t done;
+  void (*notify)(struct IOProgress *progress, uint64_t done);
+  void *ctx;
+} IOProgress;
+
+// Counter advanced by loops on the calling thread (NULL = none); set
+// returns the previous one, like io_set_chunk_size. Streams pick it up
+// when they open.
+IOProgress *io_progress(void);
+IOProgress *io_set_progress(IOProgress *progress);
+
+// Add n consumed bytes to the calling thread's counter, if it has one; for
+// loops that read without an IOReader
+void io_progress_advance(uint64_t n);
+
+uint64_t io_progress_done(const IOProgress *progress);
+
+// ---- Cancellation ----
+
+// Token the streaming loops check between chunks, so a caller can stop a
+// call that runs without the GIL. cancelled is only touched atomically and
+// may be set from any thread; deadline_ns is a CLOCK_MONOTONIC time (see
+// io_monotonic_ns) past which the token counts as tripped too, 0 = none. A
+// loop that finds its token tripped fails the way a read error would.
+typedef struct IOCancel {
+  int cancelled;
+  uint64_t deadline_ns;
+} IOCancel;
+
+#define IO_CANCEL_NONE 0
+#define IO_CANCEL_REQUESTED 1
+#define IO_CANCEL_DEADLINE 2
+
+// Token checked by loops on the calling thread (NULL = none); set returns
+// the previous one, like io_set_chunk_size. Streams pick it up when they
+// open.
+IOCancel *io_cancel(void);
+IOCancel *io_set_cancel(IOCancel *cancel);
+
+void io_cancel_request(IOCancel *cancel);
+
+// IO_CANCEL_* for cancel (NONE for NULL); cancellation wins over the
+// deadline when both apply
+int io_cancel_state(const IOCancel *cancel);
+
+// io_cancel_state of the calling thread's token; for loops that read
+// without an IOReader
+int io_cancelled(void);
+
+uint64_t io_monotonic_ns(void);
+
+// ---- Wait Accounting ----
+
+// Time callers spent waiting on reads and writes: in the streaming readers
+// and writers below, in sparse writes, and in loops that go through
+// io_fread/io_fwrite. With the threads and io_uring engines this is the
+// wait for a ring slot, not the syscalls behind it. Waits that moved no
+// data (a full ring, a final flush) add time but no call.
+typedef struct {
+  uint64_t reads, read_bytes, read_ns;
+  uint64_t writes, write_bytes, write_ns;
+} IOWaits;
+
+// Tally the calling thread's waits are added to besides the process totals
+// (NULL = none); set returns the previous one, like io_set_chunk_size.
+// Unlike progress, a wait goes to whichever tally is set when it happens.
+IOWaits *io_waits(void);
+IOWaits *io_set_waits(IOWaits *waits);
+
+void io_wait_add(int write, uint64_t bytes, uint64_t ns);
+
+// Process totals since the last io_waits_reset
+void io_waits_total(IOWaits *out);
+void io_waits_reset(void);
+
+// fread/fwrite of size bytes, timed as a wait
+size_t io_fread(void *buf, size_t size, FILE *f);
+size_t io_fwrite(const void *buf, size_t size, FILE *f);
+
+// ---- I/O Engines ----
+
+// How the streaming readers and writers below move data. The stdio engine
+// does one blocking fread/fwrite per chunk on the caller's thread. The
+// others keep IO_RING_DEPTH chunks of reads ahead of and writes behind the
+// caller in flight, so codec work overlaps with storage latency:
+//   - threads: a reader and a writer thread per stream, doing the stdio
+//     calls; works on any file, pipes included
+//   - uring (Linux): the kernel's io_uring, no extra threads; falls back to
+//     stdio for non-regular files or when the kernel refuses a ring
+typedef enum {
+  IO_ENGINE_STDIO = 0,
+  IO_ENGINE_URING = 1,
+  IO_ENGINE_THREADS = 2
+} IOEngine;
+
+#define IO_RING_DEPTH 3 // chunks in flight per stream
+
+// Non-zero if this build and kernel can run the io_uring engine
+int io_uring_available(void);
+
+// Engine for streams opened on the calling thread; set returns the
+// previous one, like io_set_chunk_size
+IOEngine io_engine(void);
+IOEngine io_set_engine(IOEngine engine);
+
+// Parse "stdio" / "uring" / "threads" (NULL or "" = stdio); -1 if unknown
+int io_engine_from_name(const char *name, IOEngine *engine);
+
+// ---- Streaming Reader / Writer ----
+
+// Both take over f from its current position: nothing else may use f
+// until the stream is closed, which leaves f's position just past the last
+// byte handed out (reader) or written (writer). NULL if out of memory.
+
+typedef struct IOReader IOReader;
+
+IOReader *io_reader_open(FILE *f);
+
+// Next chunk of input, valid until the following call or close. *at_end is
+// set once the file is known to end after it (*size may then be 0).
+// Returns -1 on a read error or once the stream's IOCancel has tripped.
+int io_reader_next(IOReader *r, const unsigned char **data, size_t *size,
+                   int *at_end);
+void io_reader_close(IOReader *r);
+
+typedef struct IOWriter IOWriter;
+
+IOWriter *io_writer_open(FILE *f);
+
+// Buffer of *capacity bytes for the caller to fill, then hand to commit;
+// commit may return before the data is written. Both return an error
+// (NULL / -1) if an earlier write failed; buffer also fails once the
+// stream's IOCancel has tripped.
+unsigned char *io_writer_buffer(IOWriter *w, size_t *capacity);
+int io_writer_commit(IOWriter *w, size_t size);
+
+// Wait for pending writes; -1 if any of them failed
+int io_writer_close(IOWriter *w);
+
+// ---- Read Streams ----
+
+// Fills up to size bytes of buf, setting *got (0 at the end); returns 0 or
+// an errno value
+typedef int (*IOReadFn)(void *ctx, void *buf, size_t size, size_t *got);
+
+// A read-only FILE whose bytes come from read(ctx, ...), for handing data
+// produced on the fly to code that reads a FILE. It has no descriptor and
+// cannot seek; closing it leaves ctx alone. NULL, with errno set, where
+// stdio cannot be given callbacks.
+FILE *io_open_read_stream(IOReadFn read, void *ctx);
+
+// ---- Sparse Files ----
+
+// Runs of zeros need not be stored or written. On the way in, SEEK_DATA /
+// SEEK_HOLE find the holes of a sparse input without reading them; on the
+// way out, the sparse writers seek over every all-zero grain instead of
+// writing it, so filesystems that support holes leave one there. Grains are
+// aligned to the file offset. Streams that cannot seek (open_memstream,
+// pipes) get the zeros written out.
+
+#define IO_SPARSE_GRAIN 4096U
+
+// Non-zero if all size bytes of data are zero
+int io_is_zero(const unsigned char *data, size_t size);
+
+// First offset in [offset, end) that holds data, or end if the rest is a
+// hole; first hole in [offset, end), or end. Without SEEK_DATA support
+// everything is data. Neither disturbs f's position.
+uint64_t io_next_data(FILE *f, uint64_t offset, uint64_t end);
+uint64_t io_next_hole(FILE *f, uint64_t offset, uint64_t end);
+
+// Write data at f's position, seeking over zero grains; -1 on an error
+int io_write_sparse(FILE *f, const unsigned char *data, size_t size);
+
+// Advance f's position by size bytes of zeros without writing them
+int io_write_hole(FILE *f, uint64_t size);
+
+// After the last sparse write: grow f to its position, which a skipped
+// trailing run leaves past the end, and flush it
+int io_sparse_finish(FILE *f);
+
+// The same for a plain descriptor (POSIX only), for workers that write
+// without stdio; these return 0 or an errno value
+int io_write_sparse_fd(int fd, const unsigned char *data, size_t size);
+int io_sparse_finish_fd(int fd);
+
+// Punch holes over the zero grains of [0, size) of fd, whose contents are
+// mapped at data; for outputs already written through a mapping. Best
+// effort: a no-op where the filesystem cannot deallocate.
+void io_punch_zeros(int fd, const unsigned char *data, size_t size);
+
+#endif // FILEIO_H
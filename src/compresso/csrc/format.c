@@ -1,11 +1,20 @@
 #define PY_SSIZE_T_CLEAN
 #include "archives.h"
+#include "common.h"
 #include "standalone.h"
 #include <Python.h>
 #include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 
+#if defined(_WIN32) || defined(_WIN64)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 // ---- Magic Byte Constants ----
 
 // Compression formats
@@ -26,6 +35,7 @@ static const unsigned char MAGIC_LZ4[] = {0x04, 0x22, 0x4D, 0x18};
 #define MAGIC_ZIP_4 0x04
 
 static const unsigned char MAGIC_7Z[] = {'7', 'z', 0xBC, 0xAF, 0x27, 0x1C};
+static const unsigned char MAGIC_CDAR[] = {'C', 'D', 'A', 'R'};
 
 // Compresso format
 #define MAGIC_COMP_1 'C'
@@ -90,9 +100,60 @@ Format detect_format_from_magic_bytes(const unsigned char *magic, size_t size) {
     return FORMAT_7Z;
   }
 
+  // Compresso deduplicating archive
+  if (memcmp(magic, MAGIC_CDAR, 4) == 0) {
+    return FORMAT_CDAR;
+  }
+
+  return FORMAT_UNKNOWN;
+}
+
+Format detect_format_from_head(const unsigned char *head, size_t size) {
+  if (size < 4) {
+    return FORMAT_UNKNOWN;
+  }
+
+  Format format = detect_format_from_magic_bytes(head, size);
+  if (format != FORMAT_UNKNOWN) {
+    // Single/base format
+    return format;
+  }
+  // Check for TAR format
+  if (size >= TAR_MAGIC_OFFSET + 5) {
+    if (memcmp(head + TAR_MAGIC_OFFSET, TAR_MAGIC, 5) == 0) {
+      return FORMAT_TAR;
+    }
+  }
   return FORMAT_UNKNOWN;
 }
 
+Format detect_format_from_fd(int fd) {
+  unsigned char head[FORMAT_HEAD_SIZE];
+  size_t got = 0;
+
+#if defined(_WIN32) || defined(_WIN64)
+  __int64 pos = _lseeki64(fd, 0, SEEK_CUR);
+  if (pos < 0 || _lseeki64(fd, 0, SEEK_SET) < 0)
+    return FORMAT_UNKNOWN;
+  int n = _read(fd, head, sizeof(head));
+  _lseeki64(fd, pos, SEEK_SET);
+  if (n > 0)
+    got = (size_t)n;
+#else
+  // pread leaves the descriptor's offset where the caller had it
+  while (got < sizeof(head)) {
+    ssize_t n = pread(fd, head + got, sizeof(head) - got, (off_t)got);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    got += (size_t)n;
+  }
+#endif
+
+  return detect_format_from_head(head, got);
+}
+
 Format detect_format_from_path(const char *path) {
   if (!path) {
     return FORMAT_UNKNOWN;
@@ -104,27 +165,17 @@ Format detect_format_from_path(const char *path) {
   }
 
   // Magic bytes detection
-  unsigned char magic[512];
-  size_t bytes_read = fread(magic, 1, sizeof(magic), f);
+  unsigned char head[FORMAT_HEAD_SIZE];
+  size_t bytes_read = fread(head, 1, sizeof(head), f);
+  fclose(f);
   if (bytes_read < 4) {
-    fclose(f);
     return FORMAT_UNKNOWN;
   }
 
-  Format format = detect_format_from_magic_bytes(magic, bytes_read);
+  Format format = detect_format_from_head(head, bytes_read);
   if (format != FORMAT_UNKNOWN) {
-    fclose(f);
-    // Single/base format
     return format;
   }
-  // Check for TAR format
-  if (bytes_read >= TAR_MAGIC_OFFSET + 5) {
-    if (memcmp(magic + TAR_MAGIC_OFFSET, TAR_MAGIC, 5) == 0) {
-      fclose(f);
-      return FORMAT_TAR;
-    }
-  }
-  fclose(f);
 
   // If magic bytes detection fails, try extension-based detection
   return detect_format_from_extension(path);
@@ -168,6 +219,8 @@ Format detect_format_from_extension(const char *path) {
     return FORMAT_ZIP;
   if (strcmp(lower_ext, "7z") == 0)
     return FORMAT_7Z;
+  if (strcmp(lower_ext, "cdar") == 0)
+    return FORMAT_CDAR;
   if (strcmp(lower_ext, "tar") == 0)
     return FORMAT_TAR;
 
@@ -192,6 +245,7 @@ int format_is_archive(Format format) {
   switch (format) {
   case FORMAT_ZIP:
   case FORMAT_7Z:
+  case FORMAT_CDAR:
   case FORMAT_TAR:
     return 1;
   default:
@@ -209,6 +263,8 @@ ArchiveID archive_id_from_format(Format format) {
     return ARCHIVE_ZIP;
   case FORMAT_7Z:
     return ARCHIVE_7Z;
+  case FORMAT_CDAR:
+    return ARCHIVE_CDAR;
   default:
     return ARCHIVE_NONE;
   }
@@ -241,6 +297,8 @@ static const char *archive_token(ArchiveID archive) {
     return "zip";
   case ARCHIVE_7Z:
     return "7z";
+  case ARCHIVE_CDAR:
+    return "cdar";
   default:
     return NULL;
   }
@@ -281,6 +339,9 @@ CompressionPipeline pipeline_from_name(const char *name, int level) {
   p.archive = ARCHIVE_NONE;
   p.codec = FORMAT_UNKNOWN;
   p.compression_level = level;
+  p.threads = 1;
+  p.base = NULL;
+  p.catalog = 0;
 
   if (!name)
     return p;
@@ -345,6 +406,9 @@ CompressionPipeline detect_pipeline_from_path(const char *path) {
   p.archive = ARCHIVE_NONE;
   p.codec = FORMAT_UNKNOWN;
   p.compression_level = -1;
+  p.threads = 1;
+  p.base = NULL;
+  p.catalog = 0;
 
   if (!path)
     return p;
@@ -424,6 +488,8 @@ const char *format_name_string(Format format) {
     return "zip";
   case FORMAT_7Z:
     return "7z";
+  case FORMAT_CDAR:
+    return "cdar";
   case FORMAT_TAR:
     return "tar";
   default:
@@ -431,30 +497,35 @@ const char *format_name_string(Format format) {
   }
 }
 
-Format format_from_name(const char *name) {
-  if (!name)
-    return FORMAT_UNKNOWN;
-
-  if (strcmp(name, "compresso") == 0)
-    return FORMAT_COMPRESSO;
-  if (strcmp(name, "gzip") == 0 || strcmp(name, "gz") == 0)
-    return FORMAT_GZIP;
-  if (strcmp(name, "bzip2") == 0 || strcmp(name, "bz2") == 0)
-    return FORMAT_BZIP2;
-  if (strcmp(name, "xz") == 0 || strcmp(name, "lzma") == 0)
-    return FORMAT_XZ;
-  if (strcmp(name, "zstd") == 0 || strcmp(name, "zst") == 0)
-    return FORMAT_ZSTD;
-  if (strcmp(name, "lz4") == 0)
-    return FORMAT_LZ4;
-  if (strcmp(name, "zip") == 0)
-    return FORMAT_ZIP;
-  if (strcmp(name, "7z") == 0)
-    return FORMAT_7Z;
-  if (strcmp(name, "tar") == 0)
-    return FORMAT_TAR;
+// Names and their short aliases
+static const NameEntry format_entries[] = {
+    {"compresso", FORMAT_COMPRESSO},
+    {"gzip", FORMAT_GZIP},
+    {"gz", FORMAT_GZIP},
+    {"bzip2", FORMAT_BZIP2},
+    {"bz2", FORMAT_BZIP2},
+    {"xz", FORMAT_XZ},
+    {"lzma", FORMAT_XZ},
+    {"zstd", FORMAT_ZSTD},
+    {"zst", FORMAT_ZSTD},
+    {"lz4", FORMAT_LZ4},
+    {"zip", FORMAT_ZIP},
+    {"7z", FORMAT_7Z},
+    {"cdar", FORMAT_CDAR},
+    {"tar", FORMAT_TAR},
+};
+
+static NameTable format_names;
+static pthread_once_t format_names_once = PTHREAD_ONCE_INIT;
+
+static void build_format_names(void) {
+  name_table_build(&format_names, format_entries,
+                   sizeof(format_entries) / sizeof(format_entries[0]));
+}
 
-  return FORMAT_UNKNOWN;
+Format format_from_name(const char *name) {
+  pthread_once(&format_names_once, build_format_names);
+  return (Format)name_table_find(&format_names, name, FORMAT_UNKNOWN);
 }
 
 // ---- Operation Mode ----
@@ -0,0 +1,98 @@
+#include "progress.h"
+#include <string.h>
+
+// ---- Progress Type ----
+
+typedef struct {
+  PyObject_HEAD IOProgress progress;
+} ProgressObject;
+
+static int progress_object_init(ProgressObject *self, PyObject *args,
+                                PyObject *kwargs) {
+  static char *kwlist[] = {NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "", kwlist)) {
+    return -1; // Error already set
+  }
+
+  memset(&self->progress, 0, sizeof(self->progress));
+  return 0;
+}
+
+static PyObject *progress_object_repr(ProgressObject *self) {
+  return PyUnicode_FromFormat(
+      "<Progress done=%llu>",
+      (unsigned long long)io_progress_done(&self->progress));
+}
+
+static PyObject *progress_object_get_done(ProgressObject *self,
+                                          void *closure
+                                          __attribute__((unused))) {
+  return PyLong_FromUnsignedLongLong(io_progress_done(&self->progress));
+}
+
+static PyObject *progress_object_reset(ProgressObject *self,
+                                       PyObject *args
+                                       __attribute__((unused))) {
+  __atomic_store_n(&self->progress.done, 0, __ATOMIC_RELAXED);
+  Py_RETURN_NONE;
+}
+
+static PyGetSetDef progress_object_getset[] = {
+    {"done", (getter)progress_object_get_done, NULL,
+     "Input bytes consumed so far by the calls this counter was passed to.",
+     NULL},
+    {NULL, NULL, NULL, NULL, NULL} // Sentinel
+};
+
+static PyMethodDef progress_object_methods[] = {
+    {"reset", (PyCFunction)progress_object_reset, METH_NOARGS,
+     "Set the counter back to zero."},
+    {NULL, NULL, 0, NULL} // Sentinel
+};
+
+static PyTypeObject ProgressType = {
+    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "compresso._core.Progress",
+    .tp_doc = "Byte counter advanced by native calls while they stream.",
+    .tp_basicsize = sizeof(ProgressObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)progress_object_init,
+    .tp_repr = (reprfunc)progress_object_repr,
+    .tp_getset = progress_object_getset,
+    .tp_methods = progress_object_methods,
+};
+
+int progress_converter(PyObject *obj, void *out) {
+  IOProgress **progress = (IOProgress **)out;
+
+  if (obj == Py_None) {
+    *progress = NULL;
+    return 1;
+  }
+
+  if (!PyObject_TypeCheck(obj, &ProgressType)) {
+    PyErr_Format(PyExc_TypeError,
+                 "progress must be a Progress or None, not %.100s",
+                 Py_TYPE(obj)->tp_name);
+    return 0;
+  }
+
+  *progress = &((ProgressObject *)obj)->progress;
+  return 1;
+}
+
+// ---- Registration ----
+
+int progress_type_init(PyObject *module) {
+  if (PyType_Ready(&ProgressType) < 0) {
+    return -1;
+  }
+
+  Py_INCREF(&ProgressType);
+  if (PyModule_AddObject(module, "Progress", (PyObject *)&ProgressType) < 0) {
+    Py_DECREF(&ProgressType);
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include "fileio.h"
+#include <Python.h>
+
+// ---- Python Type ----
+
+// Progress wraps an IOProgress counter that native calls advance as they
+// stream while another Python thread polls it; see io_set_progress.
+
+// "O&" converter: None leaves *(IOProgress **)out NULL, a Progress stores
+// its counter (borrowed from the argument)
+int progress_converter(PyObject *obj, void *out);
+
+// Adds Progress to the module; returns -1 on error
+int progress_type_init(PyObject *module);
+
+#endif // PROGRESS_H
@@ -1,6 +1,7 @@
 #define PY_SSIZE_T_CLEAN
 #include "common.h"
 #include <Python.h>
+#include <pthread.h>
 #include <string.h>
 
 #define BACKEND_ID_MAX 32
@@ -8,6 +9,65 @@
 static const CBackend *backend_by_id[BACKEND_ID_MAX] = {NULL};
 static const CBackend *registered_backends[BACKEND_ID_MAX];
 static size_t num_registered_backends = 0;
+static NameTable backend_names; // name -> index into registered_backends
+
+// ---- Name Tables ----
+
+static uint32_t name_hash(const char *name, uint32_t seed) {
+  uint32_t h = 2166136261U ^ (seed * 0x9E3779B1U); // FNV-1a, seeded
+  for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+    h ^= *p;
+    h *= 16777619U;
+  }
+  return h ^ (h >> 15);
+}
+
+// Places every entry with linear probing; returns how many had to probe
+static size_t name_table_fill(NameTable *table, const NameEntry *entries,
+                              size_t count) {
+  size_t collisions = 0;
+  memset(table->slots, 0, sizeof(table->slots));
+  for (size_t i = 0; i < count; i++) {
+    uint32_t slot = name_hash(entries[i].name, table->seed);
+    for (;; slot++) {
+      NameEntry *e = &table->slots[slot % NAME_TABLE_SLOTS];
+      if (!e->name) {
+        *e = entries[i];
+        break;
+      }
+      if (strcmp(e->name, entries[i].name) == 0)
+        break; // first one wins
+      collisions++;
+    }
+  }
+  return collisions;
+}
+
+void name_table_build(NameTable *table, const NameEntry *entries,
+                      size_t count) {
+  if (count > NAME_TABLE_SLOTS / 2)
+    count = NAME_TABLE_SLOTS / 2; // keep the table sparse enough to probe
+  for (table->seed = 0; table->seed < 256; table->seed++) {
+    if (name_table_fill(table, entries, count) == 0)
+      return;
+  }
+  table->seed = 0; // no perfect seed: lookups probe past the collisions
+  name_table_fill(table, entries, count);
+}
+
+int name_table_find(const NameTable *table, const char *name, int fallback) {
+  if (!name)
+    return fallback;
+  uint32_t slot = name_hash(name, table->seed);
+  for (size_t n = 0; n < NAME_TABLE_SLOTS; n++, slot++) {
+    const NameEntry *e = &table->slots[slot % NAME_TABLE_SLOTS];
+    if (!e->name)
+      break;
+    if (strcmp(e->name, name) == 0)
+      return e->value;
+  }
+  return fallback;
+}
 
 static void register_backend(const CBackend *b) {
   if (!b) {
@@ -31,19 +91,31 @@ static void register_backend(const CBackend *b) {
 
 // ---- Backend Registry ----
 
-static int backends_init = 0;
-
-void init_backends(void) {
-  if (backends_init)
-    return;
-  backends_init = 1;
+// The tables are filled exactly once, by whichever thread gets here first;
+// pthread_once makes every other caller wait for it and see the result, so
+// afterwards they are read-only and lookups take no lock. That holds on
+// free-threaded builds too, where nothing else serializes the callers.
+static pthread_once_t backends_once = PTHREAD_ONCE_INIT;
 
+static void register_all_backends(void) {
   register_backend(get_zlib_backend());
   register_backend(get_bzip2_backend());
   register_backend(get_lzma_backend());
   register_backend(get_zstd_backend());
   register_backend(get_lz4_backend());
   register_backend(get_snappy_backend());
+  register_backend(get_stored_backend());
+
+  NameEntry names[BACKEND_ID_MAX];
+  for (size_t i = 0; i < num_registered_backends; i++) {
+    names[i].name = registered_backends[i]->name;
+    names[i].value = (int)i;
+  }
+  name_table_build(&backend_names, names, num_registered_backends);
+}
+
+void init_backends(void) {
+  pthread_once(&backends_once, register_all_backends);
 }
 
 // ---- Backend Lookup ----
@@ -52,12 +124,8 @@ const CBackend *find_backend_by_name(const char *name) {
   if (!name)
     return NULL;
   init_backends();
-  for (size_t i = 0; i < num_registered_backends; i++) {
-    if (strcmp(registered_backends[i]->name, name) == 0) {
-      return registered_backends[i];
-    }
-  }
-  return NULL;
+  int i = name_table_find(&backend_names, name, -1);
+  return i >= 0 ? registered_backends[i] : NULL;
 }
 
 const CBackend *find_backend_by_id(uint8_t id) {
@@ -108,6 +176,7 @@ const CBackend *choose_backend(Strategy strat) {
     if (lz4) return lz4;
     if (snappy) return snappy;
     break;
+  case STRAT_AUTO: // the nominal choice; blocks then pick their own
   case STRAT_BALANCED:
   default:
     if (zstd) return zstd;
@@ -150,12 +219,15 @@ PyObject *get_capabilities(void) {
     }
 
     PyObject *name = PyUnicode_FromString(b->name ? b->name : "");
+    PyObject *impl = PyUnicode_FromString(
+        b->implementation ? b->implementation() : (b->name ? b->name : ""));
     PyObject *id = PyLong_FromLong((long)b->id);
     PyObject *buffer = has_buffer ? Py_True : Py_False;
     PyObject *stream = has_stream ? Py_True : Py_False;
 
-    if (!name || !id) {
+    if (!name || !impl || !id) {
       Py_XDECREF(name);
+      Py_XDECREF(impl);
       Py_XDECREF(id);
       Py_DECREF(dict);
       Py_DECREF(list);
@@ -168,8 +240,10 @@ PyObject *get_capabilities(void) {
     if (PyDict_SetItemString(dict, "name", name) < 0 ||
         PyDict_SetItemString(dict, "id", id) < 0 ||
         PyDict_SetItemString(dict, "has_buffer", buffer) < 0 ||
-        PyDict_SetItemString(dict, "has_stream", stream) < 0) {
+        PyDict_SetItemString(dict, "has_stream", stream) < 0 ||
+        PyDict_SetItemString(dict, "implementation", impl) < 0) {
       Py_DECREF(name);
+      Py_DECREF(impl);
       Py_DECREF(id);
       Py_DECREF(buffer);
       Py_DECREF(stream);
@@ -179,6 +253,7 @@ PyObject *get_capabilities(void) {
     }
 
     Py_DECREF(name);
+    Py_DECREF(impl);
     Py_DECREF(id);
     Py_DECREF(buffer);
     Py_DECREF(stream);
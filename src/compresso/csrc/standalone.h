@@ -2,9 +2,12 @@
 #define STANDALONE_H
 
 #include "archives.h"
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 
+struct CodecParams; // common.h
+
 typedef struct {
   Format format;
   const char *name;
@@ -14,9 +17,25 @@ typedef struct {
   int (*compress_file)(const char *input_path, const char *output_path,
                        int level);
 
+  // Compress on `threads` workers (0 = one per CPU) into the same format,
+  // readable by any decoder of it; NULL if the format has no parallel writer
+  int (*compress_file_mt)(const char *input_path, const char *output_path,
+                          int level, int threads);
+
+  // Compress with CodecParams (common.h) beyond the level, on `threads`
+  // workers as compress_file_mt; NULL if the format takes none
+  int (*compress_file_params)(const char *input_path, const char *output_path,
+                              int level, int threads,
+                              const struct CodecParams *params);
+
   // Decompress a standalone format file
   int (*decompress_file)(const char *input_path, const char *output_path);
 
+  // Decompress on up to `threads` workers (0 = one per CPU); NULL if the
+  // format has no parallel reader
+  int (*decompress_file_mt)(const char *input_path, const char *output_path,
+                            int threads);
+
   // Get original filename from compressed file, or NULL if not stored
   char *(*get_original_name)(const char *compressed_path);
 
@@ -34,4 +53,43 @@ const StandaloneFormat *get_lz4_format(void);
 
 const StandaloneFormat *find_standalone_format(Format format);
 
+// ---- Frame-Parallel Decoding ----
+
+// Files made of independent frames (zstd and lz4 frames, gzip members, as
+// pzstd, `lz4 --content-size` and bgzip write them) decode one frame per
+// worker. Each frame's place in the output comes from the sizes its
+// header or trailer records, so the output is laid out up front and every
+// worker writes its own part.
+
+typedef struct {
+  size_t in_offset;
+  size_t in_size;
+  uint64_t out_offset;
+  uint64_t out_size;
+} FrameSpan;
+
+// Find the frames of data, in order, with in_offset, in_size and out_size
+// set (spans is malloc'd); -1 when the file cannot be cut up this way
+typedef int (*FrameScanFn)(const unsigned char *data, size_t size,
+                           FrameSpan **spans, size_t *count);
+
+// Append a zeroed span to *spans, growing it as needed; NULL when out of
+// memory. For scanners.
+FrameSpan *frame_span_push(FrameSpan **spans, size_t *count,
+                           size_t *capacity);
+
+// Decode one frame into exactly span->out_size bytes at out; 0 or -1.
+// Runs on a worker without the GIL.
+typedef int (*FrameDecodeFn)(const unsigned char *frame,
+                             const FrameSpan *span, unsigned char *out);
+
+// Decode input_path into output_path on up to `threads` workers. Returns 1
+// when done, or 0 when the caller should decode serially instead: too few
+// threads or frames, a frame too big to hold, or any frame that does not
+// decode, so the serial decoder reports the damage the way it always has.
+// -1 with an exception set for I/O errors and cancellation.
+int standalone_decompress_frames(const char *input_path,
+                                 const char *output_path, int threads,
+                                 FrameScanFn scan, FrameDecodeFn decode);
+
 #endif // STANDALONE_H
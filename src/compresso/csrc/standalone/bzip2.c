@@ -1,11 +1,11 @@
 #define PY_SSIZE_T_CLEAN
 #include "../common.h"
+#include "../fileio.h"
 #include "../standalone.h"
 #include <Python.h>
 #include <bzlib.h>
 #include <stdio.h>
-
-#define BZIP2_CHUNK 65536 // 64KB
+#include <string.h>
 
 static int bzip2_block_size_from_level(int level) {
   if (level <= 0)
@@ -30,14 +30,11 @@ static int bzip2_compress_file(const char *input_path, const char *output_path,
     return -1;
   }
 
-  int bzerr;
-  int blockSize100k = bzip2_block_size_from_level(level);
-
   // The .bz2 frame (BZh header + per-block CRC32s) is produced by libbz2
-  BZFILE *bzf = BZ2_bzWriteOpen(&bzerr, output, blockSize100k, 0,
-                                30 // Verbosity and workFactor (default)
-  );
-  if (bzerr != BZ_OK || bzf == NULL) {
+  bz_stream strm;
+  memset(&strm, 0, sizeof(strm));
+  if (BZ2_bzCompressInit(&strm, bzip2_block_size_from_level(level), 0,
+                         30) != BZ_OK) { // Verbosity and workFactor (default)
     PyErr_SetString(comp_BackendError,
                     "Failed to initialize bzip2 compression");
     fclose(input);
@@ -45,36 +42,52 @@ static int bzip2_compress_file(const char *input_path, const char *output_path,
     return -1;
   }
 
-  unsigned char buffer[BZIP2_CHUNK];
-  int ret = 0;
+  IOReader *reader = io_reader_open(input);
+  IOWriter *writer = io_writer_open(output);
+  int ret = reader && writer ? 0 : -1;
+  io_advise_sequential(input);
 
   Py_BEGIN_ALLOW_THREADS
 
-      for (;;) {
-    size_t nread = fread(buffer, 1, BZIP2_CHUNK, input);
-    if (ferror(input)) {
+      int action = BZ_RUN;
+  while (ret == 0 && action != BZ_FINISH) {
+    const unsigned char *in_buf;
+    size_t nread;
+    int at_end;
+    if (io_reader_next(reader, &in_buf, &nread, &at_end) != 0) {
       ret = -1; // Read error
       break;
     }
+    if (at_end) {
+      action = BZ_FINISH;
+    }
 
-    if (nread > 0) {
-      BZ2_bzWrite(&bzerr, bzf, buffer, (int)nread);
-      if (bzerr != BZ_OK) {
+    strm.next_in = (char *)in_buf;
+    strm.avail_in = (unsigned int)nread;
+    int r;
+    do {
+      size_t capacity;
+      unsigned char *out_buf = io_writer_buffer(writer, &capacity);
+      if (!out_buf) {
         ret = -1; // Write error
         break;
       }
-    }
+      strm.next_out = (char *)out_buf;
+      strm.avail_out = (unsigned int)capacity;
 
-    if (feof(input)) {
-      break; // End of file
-    }
+      r = BZ2_bzCompress(&strm, action);
+      if (r < 0 || io_writer_commit(writer, capacity - strm.avail_out) != 0) {
+        ret = -1;
+        break;
+      }
+    } while (action == BZ_FINISH ? r != BZ_STREAM_END : strm.avail_in > 0);
   }
 
   Py_END_ALLOW_THREADS
 
-      int close_err;
-  BZ2_bzWriteClose(&close_err, bzf, 0, NULL, NULL);
-  if (ret == 0 && close_err != BZ_OK) {
+      BZ2_bzCompressEnd(&strm);
+  io_reader_close(reader);
+  if (writer && io_writer_close(writer) != 0) {
     ret = -1; // Error finalising stream
   }
 
@@ -106,10 +119,9 @@ static int bzip2_decompress_file(const char *input_path,
     return -1;
   }
 
-  int bzerr;
-  BZFILE *bzf = BZ2_bzReadOpen(&bzerr, input, 0, 0, // Small and verbosity flags
-                               NULL, 0);
-  if (bzerr != BZ_OK || bzf == NULL) {
+  bz_stream strm;
+  memset(&strm, 0, sizeof(strm));
+  if (BZ2_bzDecompressInit(&strm, 0, 0) != BZ_OK) { // Verbosity and small
     PyErr_SetString(comp_BackendError,
                     "Failed to initialize bzip2 decompression");
     fclose(input);
@@ -117,38 +129,60 @@ static int bzip2_decompress_file(const char *input_path,
     return -1;
   }
 
-  unsigned char buffer[BZIP2_CHUNK];
-  int ret = 0;
+  IOReader *reader = io_reader_open(input);
+  IOWriter *writer = io_writer_open(output);
+  int ret = reader && writer ? 0 : -1;
   int saved_err = BZ_OK;
+  io_advise_sequential(input);
 
   Py_BEGIN_ALLOW_THREADS
 
-      for (;;) {
-    int nread = BZ2_bzRead(&bzerr, bzf, buffer, BZIP2_CHUNK);
-    if (bzerr == BZ_OK || bzerr == BZ_STREAM_END) {
-      // libbz2 verifies the per-block CRC32 as it reads
-      if (nread > 0) {
-        if (fwrite(buffer, 1, nread, output) != (size_t)nread ||
-            ferror(output)) {
-          ret = -1; // Write error
-          break;
-        }
-      }
-      if (bzerr == BZ_STREAM_END) {
-        break; // End of stream
-      }
-    } else {
-      ret = -1; // Read / CRC / Data error
+      int r = BZ_OK;
+  while (ret == 0 && r != BZ_STREAM_END) {
+    const unsigned char *in_buf;
+    size_t nread;
+    int at_end;
+    if (io_reader_next(reader, &in_buf, &nread, &at_end) != 0 ||
+        nread == 0) {
+      ret = -1; // Read error, or the input ends mid-stream
       break;
     }
-  }
 
-  saved_err = bzerr;
-  BZ2_bzReadClose(&bzerr, bzf);
+    strm.next_in = (char *)in_buf;
+    strm.avail_in = (unsigned int)nread;
+    do {
+      size_t capacity;
+      unsigned char *out_buf = io_writer_buffer(writer, &capacity);
+      if (!out_buf) {
+        ret = -1; // Write error
+        break;
+      }
+      strm.next_out = (char *)out_buf;
+      strm.avail_out = (unsigned int)capacity;
+
+      // libbz2 verifies the per-block CRC32 as it decodes
+      r = BZ2_bzDecompress(&strm);
+      if (r != BZ_OK && r != BZ_STREAM_END) {
+        saved_err = r;
+        ret = -1; // CRC / Data error
+        break;
+      }
+      if (io_writer_commit(writer, capacity - strm.avail_out) != 0) {
+        ret = -1;
+        break;
+      }
+    } while (r == BZ_OK && (strm.avail_in > 0 || strm.avail_out == 0));
+  }
 
   Py_END_ALLOW_THREADS
 
-      if (ret != 0) {
+      BZ2_bzDecompressEnd(&strm);
+  io_reader_close(reader);
+  if (writer && io_writer_close(writer) != 0) {
+    ret = -1;
+  }
+
+  if (ret != 0) {
     if (saved_err == BZ_DATA_ERROR || saved_err == BZ_DATA_ERROR_MAGIC) {
       PyErr_SetString(comp_BackendError,
                       "bzip2 data error: corrupted or invalid compressed data");
@@ -175,6 +209,7 @@ static int bzip2_is_format(const unsigned char *magic, size_t size) {
 }
 
 static const StandaloneFormat bzip2_format = {
+    .format = FORMAT_BZIP2,
     .name = "bzip2",
     .extension = ".bz2",
     .compress_file = bzip2_compress_file,
@@ -0,0 +1,244 @@
+#define PY_SSIZE_T_CLEAN
+#include "../common.h"
+#include "../fileio.h"
+#include "../standalone.h"
+#include "../threadpool.h"
+#include <Python.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FRAMES_MAP 1
+#endif
+
+// Smaller files are over before workers would pay for themselves
+#define FRAMES_MIN_INPUT ((size_t)1 << 20)
+// Largest frame held in memory at once; bigger ones stream serially
+#define FRAMES_MAX_OUTPUT ((uint64_t)256 << 20)
+#define FRAMES_PER_WORKER 2 // frames handed to each worker per batch
+
+#define FRAME_OK 0
+#define FRAME_DAMAGED 1
+#define FRAME_WRITE_FAILED 2
+#define FRAME_CANCELLED 3
+
+typedef struct {
+  const unsigned char *data; // the whole input
+  const FrameSpan *span;
+  FrameDecodeFn decode;
+  int fd;
+  IOCancel *cancel;
+  int result; // FRAME_*
+} FrameJob;
+
+FrameSpan *frame_span_push(FrameSpan **spans, size_t *count,
+                           size_t *capacity) {
+  if (*count == *capacity) {
+    size_t grown = *capacity ? *capacity * 2 : 64;
+    FrameSpan *more = (FrameSpan *)realloc(*spans, grown * sizeof(FrameSpan));
+    if (!more)
+      return NULL;
+    *spans = more;
+    *capacity = grown;
+  }
+  FrameSpan *span = &(*spans)[(*count)++];
+  memset(span, 0, sizeof(*span));
+  return span;
+}
+
+#if defined(FRAMES_MAP)
+
+static void frame_task(void *arg) {
+  FrameJob *job = (FrameJob *)arg;
+  const FrameSpan *span = job->span;
+
+  if (io_cancel_state(job->cancel) != IO_CANCEL_NONE) {
+    job->result = FRAME_CANCELLED;
+    return;
+  }
+
+  // One spare byte, so an empty frame still gets a buffer
+  unsigned char *out = (unsigned char *)malloc((size_t)span->out_size + 1);
+  if (!out || job->decode(job->data + span->in_offset, span, out) != 0) {
+    free(out);
+    job->result = FRAME_DAMAGED; // the serial rerun streams in less memory
+    return;
+  }
+
+  job->result = FRAME_OK;
+  size_t done = 0;
+  while (done < span->out_size) {
+    ssize_t n = pwrite(job->fd, out + done, (size_t)span->out_size - done,
+                       (off_t)(span->out_offset + done));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      job->result = FRAME_WRITE_FAILED;
+      break;
+    }
+    done += (size_t)n;
+  }
+  free(out);
+}
+
+// Fill in every out_offset; -1 if the output would not fit an off_t or a
+// frame is too big to decode in memory
+static int frames_layout(FrameSpan *spans, size_t count, uint64_t *total) {
+  uint64_t offset = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (spans[i].out_size > FRAMES_MAX_OUTPUT ||
+        offset + spans[i].out_size > (uint64_t)INT64_MAX)
+      return -1;
+    spans[i].out_offset = offset;
+    offset += spans[i].out_size;
+  }
+  *total = offset;
+  return 0;
+}
+
+int standalone_decompress_frames(const char *input_path,
+                                 const char *output_path, int threads,
+                                 FrameScanFn scan, FrameDecodeFn decode) {
+  int nworkers = threadpool_resolve_threads(threads);
+  if (nworkers <= 1 || io_cancelled() != IO_CANCEL_NONE)
+    return 0;
+
+  int in_fd = open(input_path, O_RDONLY);
+  if (in_fd < 0)
+    return 0; // the serial decoder names the error
+  struct stat st;
+  if (fstat(in_fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+      (uint64_t)st.st_size < FRAMES_MIN_INPUT ||
+      (uint64_t)st.st_size > SIZE_MAX) {
+    close(in_fd);
+    return 0;
+  }
+  size_t size = (size_t)st.st_size;
+  void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, in_fd, 0);
+  close(in_fd);
+  if (map == MAP_FAILED)
+    return 0;
+  const unsigned char *data = (const unsigned char *)map;
+
+  FrameSpan *spans = NULL;
+  size_t count = 0;
+  uint64_t total = 0;
+  int rc;
+  // One frame has nothing to run beside
+  Py_BEGIN_ALLOW_THREADS
+
+      rc = scan(data, size, &spans, &count) == 0 && count >= 2 &&
+           frames_layout(spans, count, &total) == 0;
+
+  Py_END_ALLOW_THREADS
+
+      if (!rc) {
+    free(spans);
+    munmap(map, size);
+    return 0;
+  }
+
+  size_t batch = (size_t)nworkers * FRAMES_PER_WORKER;
+  FrameJob *jobs = (FrameJob *)calloc(batch, sizeof(FrameJob));
+  ThreadPool *pool = jobs ? threadpool_create(nworkers) : NULL;
+  int out_fd = pool ? open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0666)
+                    : -1;
+  if (out_fd < 0) {
+    if (pool)
+      PyErr_SetFromErrnoWithFilename(PyExc_OSError, output_path);
+    else if (jobs)
+      PyErr_SetString(comp_Error,
+                      "Failed to start decompression worker threads");
+    else
+      PyErr_NoMemory();
+    if (pool)
+      threadpool_destroy(pool);
+    free(jobs);
+    free(spans);
+    munmap(map, size);
+    return -1;
+  }
+
+  IOCancel *cancel = io_cancel();
+  const char *error = NULL;
+
+  // Laid out up front, so each worker writes its frame in place
+  Py_BEGIN_ALLOW_THREADS
+
+      int sized = ftruncate(out_fd, (off_t)total);
+  if (sized != 0)
+    error = "Error writing output file";
+
+  for (size_t first = 0; first < count && rc == 1 && !error; first += batch) {
+    if (io_cancelled() != IO_CANCEL_NONE) {
+      error = "Decompression cancelled";
+      break;
+    }
+
+    size_t n = count - first < batch ? count - first : batch;
+    size_t consumed = 0;
+    for (size_t i = 0; i < n; i++) {
+      FrameJob *job = &jobs[i];
+      job->data = data;
+      job->span = &spans[first + i];
+      job->decode = decode;
+      job->fd = out_fd;
+      job->cancel = cancel;
+      job->result = FRAME_OK;
+      consumed += job->span->in_size;
+      if (threadpool_submit(pool, frame_task, job) != 0)
+        frame_task(job); // queue full: do it on this thread
+    }
+
+    threadpool_wait(pool);
+
+    for (size_t i = 0; i < n && rc == 1 && !error; i++) {
+      if (jobs[i].result == FRAME_DAMAGED)
+        rc = 0;
+      else if (jobs[i].result == FRAME_WRITE_FAILED)
+        error = "Error writing output file";
+      else if (jobs[i].result == FRAME_CANCELLED)
+        error = "Decompression cancelled";
+    }
+    // A serial rerun after a damaged frame counts its input again
+    io_progress_advance(consumed);
+  }
+
+  threadpool_destroy(pool);
+
+  Py_END_ALLOW_THREADS
+
+      int closed = close(out_fd);
+  if (closed != 0 && rc == 1 && !error)
+    error = "Error writing output file";
+
+  free(jobs);
+  free(spans);
+  munmap(map, size);
+
+  if (error) {
+    PyErr_SetString(PyExc_IOError, error);
+    return -1;
+  }
+  return rc;
+}
+
+#else
+
+int standalone_decompress_frames(const char *input_path,
+                                 const char *output_path, int threads,
+                                 FrameScanFn scan, FrameDecodeFn decode) {
+  (void)input_path;
+  (void)output_path;
+  (void)threads;
+  (void)scan;
+  (void)decode;
+  return 0;
+}
+
+#endif
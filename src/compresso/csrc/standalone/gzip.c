@@ -1,12 +1,27 @@
+// <stdio.h> comes in through common.h before Python.h could turn these on,
+// and the whole-file paths need fileno, fseeko and ftello
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #define PY_SSIZE_T_CLEAN
+#include "../checksum.h"
 #include "../common.h"
+#include "../deflate_accel.h"
+#include "../fileio.h"
 #include "../standalone.h"
+#include "../threadpool.h"
 #include <Python.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <zlib.h>
 
-#define GZIP_CHUNK 65536
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define GZIP_WHOLE_MAP 1
+#endif
 
 // GZIP header structure (RFC 1952)
 typedef struct {
@@ -39,18 +54,20 @@ static uint32_t read_le32(const uint8_t *buf) {
          ((uint32_t)buf[3] << 24);
 }
 
-static int gzip_compress_file(const char *input_path, const char *output_path,
-                              int level) {
-  FILE *input = fopen(input_path, "rb");
-  if (!input) {
+// Open both files and write the member header; -1 with an exception set
+static int gzip_open_for_compress(const char *input_path,
+                                  const char *output_path, FILE **input,
+                                  FILE **output) {
+  *input = fopen(input_path, "rb");
+  if (!*input) {
     PyErr_SetFromErrnoWithFilename(PyExc_OSError, input_path);
     return -1;
   }
 
-  FILE *output = fopen(output_path, "wb");
-  if (!output) {
+  *output = fopen(output_path, "wb");
+  if (!*output) {
     PyErr_SetFromErrnoWithFilename(PyExc_OSError, output_path);
-    fclose(input);
+    fclose(*input);
     return -1;
   }
 
@@ -64,12 +81,187 @@ static int gzip_compress_file(const char *input_path, const char *output_path,
   header.xfl = 0;
   header.os = 0x03; // Unix
 
-  if (fwrite(&header, sizeof(header), 1, output) != 1) {
+  if (fwrite(&header, sizeof(header), 1, *output) != 1) {
     PyErr_SetString(PyExc_IOError, "Failed to write GZIP header");
-    fclose(input);
-    fclose(output);
+    fclose(*input);
+    fclose(*output);
     return -1;
   }
+  return 0;
+}
+
+// Write the GZIP trailer (CRC32 + original size mod 2^32) and close both
+static int gzip_finish_compress(FILE *input, FILE *output, uint32_t crc,
+                                uint32_t total_in) {
+  uint8_t trailer[8];
+  write_le32(trailer, crc);
+  write_le32(trailer + 4, total_in);
+
+  int ok = fwrite(trailer, 8, 1, output) == 1;
+  fclose(input);
+  if (fclose(output) != 0)
+    ok = 0;
+  if (!ok) {
+    PyErr_SetString(PyExc_IOError, "Failed to write GZIP trailer");
+    return -1;
+  }
+  return 0;
+}
+
+// ---- Whole-File Paths ----
+
+// Regular files up to GZIP_WHOLE_MAX are mapped and run through libdeflate
+// in one call when it is loaded (see deflate_accel.h); anything else, and
+// any input it turns down, streams through zlib below. Output is the same
+// single-member format either way. Progress moves once, by the whole
+// input, and a cancelled call is left to the streaming loop to fail.
+
+#define GZIP_WHOLE_MAX ((size_t)64 << 20)
+
+// Map all of f read-only; NULL when it is empty, not a regular file,
+// bigger than GZIP_WHOLE_MAX, or cannot be mapped
+static const unsigned char *gzip_map_whole(FILE *f, size_t *size) {
+#if defined(GZIP_WHOLE_MAP)
+  struct stat st;
+  if (fstat(fileno(f), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 ||
+      (uint64_t)st.st_size > GZIP_WHOLE_MAX)
+    return NULL;
+  io_advise_sequential(f);
+  void *p =
+      mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+  if (p == MAP_FAILED)
+    return NULL;
+  *size = (size_t)st.st_size;
+  return (const unsigned char *)p;
+#else
+  (void)f;
+  (void)size;
+  return NULL;
+#endif
+}
+
+static void gzip_unmap_whole(const unsigned char *data, size_t size) {
+#if defined(GZIP_WHOLE_MAP)
+  munmap((void *)data, size);
+#else
+  (void)data;
+  (void)size;
+#endif
+}
+
+// Deflate all of input into output after its header. Returns 1 when done
+// (crc and total_in set), 0 to stream instead (input untouched), or -1
+// with an exception set.
+static int gzip_compress_whole(FILE *input, FILE *output, int level,
+                               uint32_t *crc, uint32_t *total_in) {
+  if (!deflate_accel_available() || io_cancelled() != IO_CANCEL_NONE)
+    return 0;
+  size_t size;
+  const unsigned char *data = gzip_map_whole(input, &size);
+  if (!data)
+    return 0;
+  // libdeflate's bound is at most 5 bytes per 5000 plus a block's end
+  size_t capacity = size + size / 512 + 64;
+  unsigned char *out = (unsigned char *)io_alloc(capacity);
+  if (!out) {
+    gzip_unmap_whole(data, size);
+    return 0;
+  }
+
+  size_t out_size = 0;
+  int rc;
+  Py_BEGIN_ALLOW_THREADS
+
+      rc = deflate_accel_compress(NULL, level, DEFLATE_RAW, data, size, out,
+                                  capacity, &out_size) == 0
+               ? 1
+               : 0;
+  if (rc == 1) {
+    *crc = crc32_fast(0, data, size);
+    *total_in = (uint32_t)size;
+    io_progress_advance(size);
+    if (io_fwrite(out, out_size, output) != out_size)
+      rc = -1;
+  }
+
+  Py_END_ALLOW_THREADS
+
+      io_free(out);
+  gzip_unmap_whole(data, size);
+  if (rc < 0)
+    PyErr_SetString(PyExc_IOError, "Error writing output file");
+  return rc;
+}
+
+// Inflate a whole single-member file whose header ended at body. Returns 1
+// when output holds the data and the trailer checked out, 0 to stream
+// instead (nothing written, input back at body), or -1 with an exception.
+// Streaming reports every kind of damage, so anything odd is left to it.
+static int gzip_decompress_whole(FILE *input, FILE *output, off_t body) {
+  if (!deflate_accel_available() || io_cancelled() != IO_CANCEL_NONE)
+    return 0;
+  size_t size;
+  const unsigned char *data = gzip_map_whole(input, &size);
+  if (!data)
+    return 0;
+  // ISIZE closes the file when it holds one member; a wrong guess only
+  // makes libdeflate turn the data down
+  uint32_t expected = size >= (size_t)body + 8 ? read_le32(data + size - 4) : 0;
+  const unsigned char *in = data + body;
+  size_t in_size = size - (size_t)body;
+  unsigned char *out = NULL;
+  if (expected == 0 || expected > GZIP_WHOLE_MAX ||
+      !(out = (unsigned char *)io_alloc(expected))) {
+    gzip_unmap_whole(data, size);
+    return 0;
+  }
+
+  size_t out_size = 0, used = 0;
+  int rc = 0;
+  Py_BEGIN_ALLOW_THREADS
+
+      if (deflate_accel_decompress(NULL, DEFLATE_RAW, in, in_size, out,
+                                   expected, &out_size, &used) == 0 &&
+          out_size == expected && in_size - used == 8 &&
+          read_le32(in + used) == crc32_fast(0, out, out_size) &&
+          read_le32(in + used + 4) == (uint32_t)out_size) {
+    io_progress_advance(in_size);
+    rc = io_fwrite(out, out_size, output) == out_size ? 1 : -1;
+  }
+
+  Py_END_ALLOW_THREADS
+
+      io_free(out);
+  gzip_unmap_whole(data, size);
+  if (rc < 0) {
+    PyErr_SetString(PyExc_IOError, "Error writing output file");
+  } else if (rc == 0 && fseeko(input, body, SEEK_SET) != 0) {
+    PyErr_SetFromErrno(PyExc_OSError);
+    rc = -1;
+  }
+  return rc;
+}
+
+// ---- Streaming Compression ----
+
+static int gzip_compress_file(const char *input_path, const char *output_path,
+                              int level) {
+  FILE *input;
+  FILE *output;
+  if (gzip_open_for_compress(input_path, output_path, &input, &output) != 0)
+    return -1;
+
+  uint32_t crc = 0;
+  uint32_t total_in = 0;
+  int whole = gzip_compress_whole(input, output, level, &crc, &total_in);
+  if (whole != 0) {
+    if (whole < 0) {
+      fclose(input);
+      fclose(output);
+      return -1;
+    }
+    return gzip_finish_compress(input, output, crc, total_in);
+  }
 
   // Initialise zlib for raw deflate
   z_stream strm;
@@ -87,77 +279,427 @@ static int gzip_compress_file(const char *input_path, const char *output_path,
     return -1;
   }
 
-  unsigned char in_buf[GZIP_CHUNK];
-  unsigned char out_buf[GZIP_CHUNK];
-  uint32_t crc = crc32(0L, Z_NULL, 0);
-  uint32_t total_in = 0;
-  int flush;
+  IOReader *reader = io_reader_open(input);
+  IOWriter *writer = io_writer_open(output);
+  if (!reader || !writer) {
+    io_reader_close(reader);
+    io_writer_close(writer);
+    deflateEnd(&strm);
+    fclose(input);
+    fclose(output);
+    PyErr_NoMemory();
+    return -1;
+  }
+  int flush = Z_NO_FLUSH;
+  PyObject *error_type = PyExc_IOError;
+  const char *error = NULL;
+  io_advise_sequential(input);
 
   Py_BEGIN_ALLOW_THREADS
 
-      do {
-    strm.avail_in = fread(in_buf, 1, GZIP_CHUNK, input);
-    if (ferror(input)) {
-      Py_BLOCK_THREADS deflateEnd(&strm);
-      fclose(input);
-      fclose(output);
-      PyErr_SetString(PyExc_IOError, "Error reading input file");
-      return -1;
+      while (flush != Z_FINISH && !error) {
+    const unsigned char *in_buf;
+    size_t nread;
+    int at_end;
+    if (io_reader_next(reader, &in_buf, &nread, &at_end) != 0) {
+      error = "Error reading input file";
+      break;
     }
 
-    total_in += strm.avail_in;
-    crc = crc32(crc, in_buf, strm.avail_in);
+    total_in += (uint32_t)nread;
+    crc = crc32_fast(crc, in_buf, nread);
 
-    flush = feof(input) ? Z_FINISH : Z_NO_FLUSH;
-    strm.next_in = in_buf;
+    flush = at_end ? Z_FINISH : Z_NO_FLUSH;
+    strm.next_in = (Bytef *)in_buf;
+    strm.avail_in = (uInt)nread;
 
     do {
-      strm.avail_out = GZIP_CHUNK;
+      size_t capacity;
+      unsigned char *out_buf = io_writer_buffer(writer, &capacity);
+      if (!out_buf) {
+        error = "Error writing output file";
+        break;
+      }
+      strm.avail_out = (uInt)capacity;
       strm.next_out = out_buf;
 
       ret = deflate(&strm, flush);
       if (ret == Z_STREAM_ERROR) {
-        Py_BLOCK_THREADS deflateEnd(&strm);
-        fclose(input);
-        fclose(output);
-        PyErr_SetString(comp_BackendError, "Compression stream error");
-        return -1;
+        error_type = comp_BackendError;
+        error = "Compression stream error";
+        break;
       }
 
-      size_t have = GZIP_CHUNK - strm.avail_out;
-      if (fwrite(out_buf, 1, have, output) != have || ferror(output)) {
-        Py_BLOCK_THREADS deflateEnd(&strm);
-        fclose(input);
-        fclose(output);
-        PyErr_SetString(PyExc_IOError, "Error writing output file");
-        return -1;
+      if (io_writer_commit(writer, capacity - strm.avail_out) != 0) {
+        error = "Error writing output file";
+        break;
       }
     } while (strm.avail_out == 0);
   }
-  while (flush != Z_FINISH)
-    ;
 
   Py_END_ALLOW_THREADS
 
       deflateEnd(&strm);
+  io_reader_close(reader);
+  if (io_writer_close(writer) != 0 && !error) {
+    error = "Error writing output file";
+  }
 
-  // Write GZIP trailer (CRC32 + original size)
-  uint8_t trailer[8];
-  write_le32(trailer, crc);
-  write_le32(trailer + 4, total_in);
-
-  if (fwrite(trailer, 8, 1, output) != 1) {
-    PyErr_SetString(PyExc_IOError, "Failed to write GZIP trailer");
+  if (error) {
+    PyErr_SetString(error_type, error);
     fclose(input);
     fclose(output);
     return -1;
   }
 
-  fclose(input);
-  fclose(output);
+  return gzip_finish_compress(input, output, crc, total_in);
+}
+
+// ---- Parallel Compression ----
+
+// pigz-style: the input is cut into GZIP_PAR_BLOCK blocks, each deflated on
+// a worker as its own raw stream primed with the GZIP_PAR_WINDOW bytes of
+// input before it. Every block but the last ends on a Z_SYNC_FLUSH (byte
+// aligned, not final), so the blocks concatenate into one deflate stream,
+// and their CRCs fold into the member's with crc32_combine. The result is
+// a plain single-member gzip file; only the ratio differs slightly, as no
+// match crosses a block's start by more than the window.
+
+#define GZIP_PAR_BLOCK (128U * 1024)
+#define GZIP_PAR_WINDOW (32U * 1024) // deflate's largest match distance
+#define GZIP_PAR_BLOCKS_PER_WORKER 2 // blocks read for each worker per batch
+
+typedef struct {
+  z_stream strm;
+  int ready; // strm initialised
+  const unsigned char *dict;
+  size_t dict_size;
+  const unsigned char *input;
+  size_t input_size;
+  int last;
+  unsigned char *output;
+  size_t output_capacity;
+  size_t output_size;
+  uint32_t crc;
+  int failed;
+} GzipBlockJob;
+
+static void gzip_block_task(void *arg) {
+  GzipBlockJob *job = (GzipBlockJob *)arg;
+  z_stream *strm = &job->strm;
+  job->failed = 1;
+
+  if (deflateReset(strm) != Z_OK)
+    return;
+  if (job->dict_size > 0 &&
+      deflateSetDictionary(strm, job->dict, (uInt)job->dict_size) != Z_OK)
+    return;
+
+  strm->next_in = (Bytef *)job->input;
+  strm->avail_in = (uInt)job->input_size;
+  strm->next_out = job->output;
+  strm->avail_out = (uInt)job->output_capacity;
+  int ret = deflate(strm, job->last ? Z_FINISH : Z_SYNC_FLUSH);
+
+  // The output buffer fits the bound, so one call always finishes; a full
+  // buffer after a sync flush would mean the marker was cut short
+  if (job->last ? ret != Z_STREAM_END
+                : ret != Z_OK || strm->avail_in != 0 || strm->avail_out == 0)
+    return;
+
+  job->output_size = job->output_capacity - strm->avail_out;
+  job->crc = crc32_fast(0, job->input, job->input_size);
+  job->failed = 0;
+}
+
+static void gzip_free_block_jobs(GzipBlockJob *jobs, size_t count) {
+  if (!jobs)
+    return;
+  for (size_t i = 0; i < count; i++) {
+    if (jobs[i].ready)
+      deflateEnd(&jobs[i].strm);
+    free(jobs[i].output);
+  }
+  free(jobs);
+}
+
+// Copy size bytes through the writer's buffers; -1 if a write failed
+static int gzip_write_block(IOWriter *writer, const unsigned char *data,
+                            size_t size) {
+  while (size > 0) {
+    size_t capacity;
+    unsigned char *out_buf = io_writer_buffer(writer, &capacity);
+    if (!out_buf)
+      return -1;
+    size_t n = size < capacity ? size : capacity;
+    memcpy(out_buf, data, n);
+    if (io_writer_commit(writer, n) != 0)
+      return -1;
+    data += n;
+    size -= n;
+  }
   return 0;
 }
 
+static int gzip_compress_file_mt(const char *input_path,
+                                 const char *output_path, int level,
+                                 int threads) {
+  int nworkers = threadpool_resolve_threads(threads);
+  if (nworkers <= 1)
+    return gzip_compress_file(input_path, output_path, level);
+
+  int zlevel = (level >= 0 && level <= 9) ? level : Z_DEFAULT_COMPRESSION;
+  size_t nblocks = (size_t)nworkers * GZIP_PAR_BLOCKS_PER_WORKER;
+
+  // The input batch sits just past the window, which holds the tail of the
+  // batch before it
+  unsigned char *in_buf =
+      (unsigned char *)io_alloc(GZIP_PAR_WINDOW + nblocks * GZIP_PAR_BLOCK);
+  GzipBlockJob *jobs = (GzipBlockJob *)calloc(nblocks, sizeof(GzipBlockJob));
+  if (!in_buf || !jobs) {
+    io_free(in_buf);
+    free(jobs);
+    PyErr_NoMemory();
+    return -1;
+  }
+
+  for (size_t i = 0; i < nblocks; i++) {
+    GzipBlockJob *job = &jobs[i];
+    if (deflateInit2(&job->strm, zlevel, Z_DEFLATED, -MAX_WBITS, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+      gzip_free_block_jobs(jobs, nblocks);
+      io_free(in_buf);
+      PyErr_SetString(comp_BackendError, "Failed to initialize compression");
+      return -1;
+    }
+    job->ready = 1;
+    // Room for a sync flush marker on top of the bound
+    job->output_capacity = deflateBound(&job->strm, GZIP_PAR_BLOCK) + 16;
+    job->output = (unsigned char *)malloc(job->output_capacity);
+    if (!job->output) {
+      gzip_free_block_jobs(jobs, nblocks);
+      io_free(in_buf);
+      PyErr_NoMemory();
+      return -1;
+    }
+  }
+
+  ThreadPool *pool = threadpool_create(nworkers);
+  if (!pool) {
+    gzip_free_block_jobs(jobs, nblocks);
+    io_free(in_buf);
+    PyErr_SetString(comp_Error, "Failed to start compression worker threads");
+    return -1;
+  }
+
+  FILE *input;
+  FILE *output;
+  if (gzip_open_for_compress(input_path, output_path, &input, &output) != 0) {
+    threadpool_destroy(pool);
+    gzip_free_block_jobs(jobs, nblocks);
+    io_free(in_buf);
+    return -1;
+  }
+  io_advise_sequential(input);
+
+  IOReader *reader = io_reader_open(input);
+  IOWriter *writer = io_writer_open(output);
+  if (!reader || !writer) {
+    io_reader_close(reader);
+    io_writer_close(writer);
+    threadpool_destroy(pool);
+    gzip_free_block_jobs(jobs, nblocks);
+    io_free(in_buf);
+    fclose(input);
+    fclose(output);
+    PyErr_NoMemory();
+    return -1;
+  }
+
+  uint32_t crc = 0;
+  uint32_t total_in = 0;
+  size_t window = 0; // bytes of the previous batch before the new one
+  const unsigned char *chunk = NULL; // reader chunk not yet in a batch
+  size_t chunk_size = 0;
+  int at_end = 0;
+  int eof = 0;
+  PyObject *error_type = PyExc_IOError;
+  const char *error = NULL;
+
+  Py_BEGIN_ALLOW_THREADS
+
+      while (!eof && !error) {
+    if (io_cancelled() != IO_CANCEL_NONE) {
+      error = "Compression cancelled";
+      break;
+    }
+
+    unsigned char *data = in_buf + GZIP_PAR_WINDOW;
+    size_t want = nblocks * GZIP_PAR_BLOCK;
+    size_t got = 0;
+    // A full batch may be the last: the chunk after it, if any, is held
+    // back for the next one, so the final block gets its flag
+    for (;;) {
+      if (chunk_size == 0) {
+        if (at_end)
+          break;
+        if (io_reader_next(reader, &chunk, &chunk_size, &at_end) != 0) {
+          error = "Error reading input file";
+          break;
+        }
+      } else if (got < want) {
+        size_t n = want - got < chunk_size ? want - got : chunk_size;
+        memcpy(data + got, chunk, n);
+        got += n;
+        chunk += n;
+        chunk_size -= n;
+      } else {
+        break;
+      }
+    }
+    if (error)
+      break;
+    eof = at_end && chunk_size == 0;
+
+    size_t count = got == 0 ? 1 : (got + GZIP_PAR_BLOCK - 1) / GZIP_PAR_BLOCK;
+    for (size_t i = 0; i < count; i++) {
+      GzipBlockJob *job = &jobs[i];
+      size_t offset = i * GZIP_PAR_BLOCK;
+      job->input = data + offset;
+      job->input_size =
+          got - offset < GZIP_PAR_BLOCK ? got - offset : GZIP_PAR_BLOCK;
+      job->dict_size = i == 0 ? window : GZIP_PAR_WINDOW;
+      job->dict = job->input - job->dict_size;
+      job->last = eof && i == count - 1;
+      if (threadpool_submit(pool, gzip_block_task, job) != 0)
+        gzip_block_task(job); // queue full: do it on this thread
+    }
+
+    threadpool_wait(pool);
+
+    for (size_t i = 0; i < count; i++) {
+      GzipBlockJob *job = &jobs[i];
+      if (job->failed) {
+        error_type = comp_BackendError;
+        error = "Compression stream error";
+        break;
+      }
+      if (gzip_write_block(writer, job->output, job->output_size) != 0) {
+        error = "Error writing output file";
+        break;
+      }
+      crc = crc32_combine(crc, job->crc, (z_off_t)job->input_size);
+    }
+    total_in += (uint32_t)got;
+    io_progress_advance(got);
+
+    // Blocks are larger than the window, so a full batch always covers it
+    if (!eof) {
+      memmove(in_buf, data + got - GZIP_PAR_WINDOW, GZIP_PAR_WINDOW);
+      window = GZIP_PAR_WINDOW;
+    }
+  }
+
+  threadpool_destroy(pool);
+
+  Py_END_ALLOW_THREADS
+
+      gzip_free_block_jobs(jobs, nblocks);
+  io_free(in_buf);
+  io_reader_close(reader);
+  if (io_writer_close(writer) != 0 && !error) {
+    error = "Error writing output file";
+  }
+
+  if (error) {
+    PyErr_SetString(error_type, error);
+    fclose(input);
+    fclose(output);
+    return -1;
+  }
+
+  return gzip_finish_compress(input, output, crc, total_in);
+}
+
+// ---- Streaming Decompression ----
+
+// gunzip reads concatenated members as one file. Once the first one has
+// checked out, the rest go through zlib's own gzip wrapper, which checks
+// each trailer; anything after the last member that is not another one is
+// ignored, as it always was. in holds what the reader had left after the
+// first trailer. Returns the error, or NULL.
+static const char *gzip_inflate_members(IOReader *reader, IOWriter *writer,
+                                        const unsigned char *in,
+                                        size_t in_size, int at_end,
+                                        PyObject **error_type) {
+  z_stream strm;
+  memset(&strm, 0, sizeof(strm));
+  if (inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK) {
+    *error_type = comp_BackendError;
+    return "Failed to initialize decompression";
+  }
+
+  const char *error = NULL;
+  int between = 1; // no byte of the next member taken yet
+  while (!error) {
+    if (in_size == 0) {
+      if (at_end)
+        break;
+      if (io_reader_next(reader, &in, &in_size, &at_end) != 0) {
+        error = "Error reading input file";
+        break;
+      }
+      if (in_size == 0)
+        break;
+    }
+    if (between) {
+      if (in[0] != 0x1f || (in_size > 1 && in[1] != 0x8b))
+        break; // Trailing data, not a member
+      between = 0;
+    }
+
+    strm.next_in = (Bytef *)in;
+    strm.avail_in = (uInt)in_size;
+    int ret;
+    do {
+      size_t capacity;
+      unsigned char *out_buf = io_writer_buffer(writer, &capacity);
+      if (!out_buf) {
+        error = "Error writing output file";
+        break;
+      }
+      strm.next_out = out_buf;
+      strm.avail_out = (uInt)capacity;
+      ret = inflate(&strm, Z_NO_FLUSH);
+      if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+        *error_type = comp_BackendError;
+        error = "Decompression error";
+        break;
+      }
+      if (io_writer_commit(writer, capacity - strm.avail_out) != 0) {
+        error = "Error writing output file";
+        break;
+      }
+    } while (ret != Z_STREAM_END && strm.avail_out == 0);
+    if (error)
+      break;
+
+    in = strm.next_in;
+    in_size = strm.avail_in;
+    if (ret == Z_STREAM_END) {
+      inflateReset(&strm);
+      between = 1;
+    }
+  }
+
+  inflateEnd(&strm);
+  if (!error && !between) {
+    *error_type = comp_BackendError;
+    error = "Truncated or incomplete GZIP stream";
+  }
+  return error;
+}
+
 static int gzip_decompress_file(const char *input_path,
                                 const char *output_path) {
   FILE *input = fopen(input_path, "rb");
@@ -223,6 +765,17 @@ static int gzip_decompress_file(const char *input_path,
     return -1;
   }
 
+  off_t body = ftello(input);
+  int whole = body > 0 ? gzip_decompress_whole(input, output, body) : 0;
+  if (whole != 0) {
+    fclose(input);
+    if (fclose(output) != 0 && whole > 0) {
+      PyErr_SetString(PyExc_IOError, "Error writing output file");
+      return -1;
+    }
+    return whole > 0 ? 0 : -1;
+  }
+
   // Initialise zlib for raw inflate
   z_stream strm;
   memset(&strm, 0, sizeof(strm));
@@ -235,80 +788,122 @@ static int gzip_decompress_file(const char *input_path,
     return -1;
   }
 
-  unsigned char in_buf[GZIP_CHUNK];
-  unsigned char out_buf[GZIP_CHUNK];
-  uint32_t crc = crc32(0L, Z_NULL, 0);
+  IOReader *reader = io_reader_open(input);
+  IOWriter *writer = io_writer_open(output);
+  if (!reader || !writer) {
+    io_reader_close(reader);
+    io_writer_close(writer);
+    inflateEnd(&strm);
+    fclose(input);
+    fclose(output);
+    PyErr_NoMemory();
+    return -1;
+  }
+  uint32_t crc = 0;
   uint32_t total_out = 0;
+  PyObject *error_type = PyExc_IOError;
+  const char *error = NULL;
+  io_advise_sequential(input);
 
   Py_BEGIN_ALLOW_THREADS
 
-      do {
-    strm.avail_in = fread(in_buf, 1, GZIP_CHUNK, input);
-    if (ferror(input)) {
-      Py_BLOCK_THREADS inflateEnd(&strm);
-      fclose(input);
-      fclose(output);
-      PyErr_SetString(PyExc_IOError, "Error reading input file");
-      return -1;
+      while (ret != Z_STREAM_END && !error) {
+    const unsigned char *in_buf;
+    size_t nread;
+    int at_end;
+    if (io_reader_next(reader, &in_buf, &nread, &at_end) != 0) {
+      error = "Error reading input file";
+      break;
     }
 
-    if (strm.avail_in == 0)
+    if (nread == 0)
       break;
 
-    strm.next_in = in_buf;
+    strm.next_in = (Bytef *)in_buf;
+    strm.avail_in = (uInt)nread;
 
     do {
-      strm.avail_out = GZIP_CHUNK;
+      size_t capacity;
+      unsigned char *out_buf = io_writer_buffer(writer, &capacity);
+      if (!out_buf) {
+        error = "Error writing output file";
+        break;
+      }
+      strm.avail_out = (uInt)capacity;
       strm.next_out = out_buf;
 
       ret = inflate(&strm, Z_NO_FLUSH);
       if (ret != Z_OK && ret != Z_STREAM_END) {
-        Py_BLOCK_THREADS inflateEnd(&strm);
-        fclose(input);
-        fclose(output);
-        PyErr_SetString(comp_BackendError, "Decompression error");
-        return -1;
+        error_type = comp_BackendError;
+        error = "Decompression error";
+        break;
       }
 
-      size_t have = GZIP_CHUNK - strm.avail_out;
-      total_out += have;
-      crc = crc32(crc, out_buf, have);
+      size_t have = capacity - strm.avail_out;
+      total_out += (uint32_t)have;
+      crc = crc32_fast(crc, out_buf, have);
 
-      if (fwrite(out_buf, 1, have, output) != have || ferror(output)) {
-        Py_BLOCK_THREADS inflateEnd(&strm);
-        fclose(input);
-        fclose(output);
-        PyErr_SetString(PyExc_IOError, "Error writing output file");
-        return -1;
+      if (io_writer_commit(writer, have) != 0) {
+        error = "Error writing output file";
+        break;
       }
     } while (strm.avail_out == 0);
   }
-  while (ret != Z_STREAM_END)
-    ;
 
   Py_END_ALLOW_THREADS
 
       // After the deflate stream ends, inflate leaves the 8-byte trailer
-      // (CRC32 + ISIZE) unconsumed in the input buffer. Capture it from there,
-      // topping up from the file if it was split across a read boundary.
+      // (CRC32 + ISIZE) unconsumed in the reader's chunk. Capture it from
+      // there, topping up from the next chunk if it was split across two.
       uint8_t trailer[8];
   size_t trailer_have = 0;
-  if (strm.avail_in > 0) {
-    trailer_have = strm.avail_in < 8 ? strm.avail_in : 8;
-    memcpy(trailer, strm.next_in, trailer_have);
+  const unsigned char *more = NULL;
+  size_t more_size = 0;
+  int more_at_end = 0;
+  if (!error && ret == Z_STREAM_END) {
+    more = strm.next_in;
+    more_size = strm.avail_in;
+    for (;;) {
+      size_t n = more_size < 8 - trailer_have ? more_size : 8 - trailer_have;
+      memcpy(trailer + trailer_have, more, n);
+      trailer_have += n;
+      more += n;
+      more_size -= n;
+      if (trailer_have == 8 || more_at_end ||
+          io_reader_next(reader, &more, &more_size, &more_at_end) != 0 ||
+          more_size == 0)
+        break;
+    }
+  }
+
+  if (trailer_have == 8 && crc == read_le32(trailer) &&
+      total_out == read_le32(trailer + 4)) {
+    Py_BEGIN_ALLOW_THREADS
+
+        error = gzip_inflate_members(reader, writer, more, more_size,
+                                     more_at_end, &error_type);
+
+    Py_END_ALLOW_THREADS
   }
 
   inflateEnd(&strm);
+  io_reader_close(reader);
+  if (io_writer_close(writer) != 0 && !error) {
+    error = "Error writing output file";
+  }
 
-  if (ret != Z_STREAM_END) {
-    PyErr_SetString(comp_BackendError, "Truncated or incomplete GZIP stream");
+  if (error) {
+    PyErr_SetString(error_type, error);
     fclose(input);
     fclose(output);
     return -1;
   }
 
-  if (trailer_have < 8) {
-    trailer_have += fread(trailer + trailer_have, 1, 8 - trailer_have, input);
+  if (ret != Z_STREAM_END) {
+    PyErr_SetString(comp_BackendError, "Truncated or incomplete GZIP stream");
+    fclose(input);
+    fclose(output);
+    return -1;
   }
 
   if (trailer_have != 8) {
@@ -342,6 +937,137 @@ static int gzip_decompress_file(const char *input_path,
   return 0;
 }
 
+// ---- Parallel Decompression ----
+
+// Each member of a multi-member file (bgzip, `pigz --independent` output
+// joined with cat, or any gzip files concatenated) decodes on its own.
+// BGZF records every member's length in a "BC" extra subfield; otherwise
+// the next member is the next place a plausible header starts, and a
+// false match inside the data only fails that member, which sends the
+// file to the serial decoder. The ISIZE ending each member gives its size.
+
+#define GZIP_MEMBER_MIN 20 // 10-byte header, an empty block, the trailer
+
+// Length of the member header at data, or 0 if none starts there; *bsize
+// is the member's length when it carries a BGZF size, else 0
+static size_t gzip_member_header(const unsigned char *data, size_t size,
+                                 size_t *bsize) {
+  *bsize = 0;
+  if (size < GZIP_MEMBER_MIN || data[0] != 0x1f || data[1] != 0x8b ||
+      data[2] != 0x08 || (data[3] & 0xE0) != 0 ||
+      (data[8] != 0 && data[8] != 2 && data[8] != 4) ||
+      (data[9] > 13 && data[9] != 255))
+    return 0;
+
+  uint8_t flags = data[3];
+  size_t pos = sizeof(GzipHeader);
+  if (flags & FEXTRA) {
+    size_t xlen = (size_t)data[pos] | ((size_t)data[pos + 1] << 8);
+    pos += 2;
+    if (size - pos < xlen)
+      return 0;
+    // Subfields: SI1 SI2 LEN[2] data[LEN]
+    for (size_t x = 0; x + 4 <= xlen;) {
+      const unsigned char *sub = data + pos + x;
+      size_t len = (size_t)sub[2] | ((size_t)sub[3] << 8);
+      if (sub[0] == 'B' && sub[1] == 'C' && len == 2 && x + 6 <= xlen)
+        *bsize = ((size_t)sub[4] | ((size_t)sub[5] << 8)) + 1;
+      x += 4 + len;
+    }
+    pos += xlen;
+  }
+  for (uint8_t field = FNAME; field <= FCOMMENT; field <<= 1) {
+    if (flags & field) {
+      const unsigned char *nul = memchr(data + pos, 0, size - pos);
+      if (!nul)
+        return 0;
+      pos = (size_t)(nul - data) + 1;
+    }
+  }
+  if (flags & FHCRC)
+    pos += 2;
+  return pos <= size && size - pos >= 8 + 2 ? pos : 0;
+}
+
+static int gzip_scan_members(const unsigned char *data, size_t size,
+                             FrameSpan **spans, size_t *count) {
+  size_t capacity = 0;
+  size_t pos = 0;
+  while (pos < size) {
+    size_t bsize;
+    size_t header = gzip_member_header(data + pos, size - pos, &bsize);
+    if (header == 0)
+      return -1; // trailing data is the serial decoder's to skip
+
+    size_t end;
+    if (bsize) {
+      if (bsize < header + 8 + 2 || bsize > size - pos)
+        return -1;
+      end = pos + bsize;
+    } else {
+      end = size;
+      size_t from = pos + header + 2 + 8;
+      while (from < size) {
+        const unsigned char *next = memchr(data + from, 0x1f, size - from);
+        if (!next)
+          break;
+        size_t at = (size_t)(next - data);
+        size_t unused;
+        if (gzip_member_header(next, size - at, &unused)) {
+          end = at;
+          break;
+        }
+        from = at + 1;
+      }
+    }
+
+    FrameSpan *span = frame_span_push(spans, count, &capacity);
+    if (!span)
+      return -1;
+    span->in_offset = pos;
+    span->in_size = end - pos;
+    span->out_size = read_le32(data + end - 4);
+    pos = end;
+  }
+  return 0;
+}
+
+// The member must end exactly where the scan said, trailer checked
+static int gzip_decode_member(const unsigned char *member,
+                              const FrameSpan *span, unsigned char *out) {
+  size_t out_size = 0, used = 0;
+  if (deflate_accel_decompress(NULL, DEFLATE_GZIP, member, span->in_size, out,
+                               (size_t)span->out_size, &out_size,
+                               &used) == 0)
+    return out_size == span->out_size && used == span->in_size ? 0 : -1;
+
+  // Frames are held in memory whole, so they fit zlib's counters
+  z_stream strm;
+  memset(&strm, 0, sizeof(strm));
+  if (inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK)
+    return -1;
+  strm.next_in = (Bytef *)member;
+  strm.avail_in = (uInt)span->in_size;
+  strm.next_out = out;
+  strm.avail_out = (uInt)span->out_size;
+  int ret = inflate(&strm, Z_FINISH);
+  int rc = ret == Z_STREAM_END && strm.avail_in == 0 && strm.avail_out == 0
+               ? 0
+               : -1;
+  inflateEnd(&strm);
+  return rc;
+}
+
+static int gzip_decompress_file_mt(const char *input_path,
+                                   const char *output_path, int threads) {
+  int rc = standalone_decompress_frames(input_path, output_path, threads,
+                                        gzip_scan_members,
+                                        gzip_decode_member);
+  if (rc != 0)
+    return rc > 0 ? 0 : -1;
+  return gzip_decompress_file(input_path, output_path);
+}
+
 static char *gzip_get_original_name(const char *compressed_path) {
   FILE *f = fopen(compressed_path, "rb");
   if (!f)
@@ -390,10 +1116,13 @@ static int gzip_is_format(const unsigned char *magic, size_t size) {
 }
 
 static const StandaloneFormat gzip_format = {
+    .format = FORMAT_GZIP,
     .name = "gzip",
     .extension = ".gz",
     .compress_file = gzip_compress_file,
+    .compress_file_mt = gzip_compress_file_mt,
     .decompress_file = gzip_decompress_file,
+    .decompress_file_mt = gzip_decompress_file_mt,
     .get_original_name = gzip_get_original_name,
     .is_format = gzip_is_format,
 };
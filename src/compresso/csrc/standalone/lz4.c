@@ -1,14 +1,11 @@
 #define PY_SSIZE_T_CLEAN
 #include "../common.h"
+#include "../fileio.h"
 #include "../standalone.h"
 #include <Python.h>
 #include <lz4frame.h>
 #include <string.h>
 
-#define LZ4_FILE_CHUNK 65536 // 64KB
-#define LZ4_OUT_CHUNK                                                          \
-  (LZ4_FILE_CHUNK + LZ4_FILE_CHUNK / 255 + 16) // Worst-case LZ4 frame output
-
 static int lz4_level_from_generic(int level) {
   if (level < 0)
     return 0; // Default
@@ -45,64 +42,79 @@ static int lz4_compress_file(const char *input_path, const char *output_path,
   // Embed an xxHash content checksum so decompression verifies integrity
   prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
 
-  unsigned char in_buf[LZ4_FILE_CHUNK];
-  unsigned char out_buf[LZ4_OUT_CHUNK];
-  int return_code = 0;
+  // Output chunks hold the worst case for one full input chunk plus the
+  // frame header, so every update and the final flush fit in one write.
+  // Past IO_CHUNK_MAX they cannot; reads are then fed in smaller pieces.
+  size_t in_chunk = io_chunk_size();
+  size_t out_chunk =
+      LZ4F_compressBound(in_chunk, &prefs) + LZ4F_HEADER_SIZE_MAX;
+  if (out_chunk > IO_CHUNK_MAX)
+    out_chunk = IO_CHUNK_MAX;
+  size_t piece = in_chunk;
+  while (LZ4F_compressBound(piece, &prefs) + LZ4F_HEADER_SIZE_MAX > out_chunk)
+    piece /= 2;
+
+  IOReader *reader = io_reader_open(input);
+  size_t prev_chunk = io_set_chunk_size(out_chunk);
+  IOWriter *writer = io_writer_open(output);
+  io_set_chunk_size(prev_chunk);
+  int return_code = reader && writer ? 0 : -1;
+  io_advise_sequential(input);
 
   Py_BEGIN_ALLOW_THREADS
 
-      size_t header_size =
-          LZ4F_compressBegin(cctx, out_buf, LZ4_OUT_CHUNK, &prefs);
-  if (LZ4F_isError(header_size)) {
-    return_code = -1;
-    goto done_stream;
-  }
-  if (fwrite(out_buf, 1, header_size, output) != header_size ||
-      ferror(output)) {
+      size_t capacity;
+  unsigned char *out_buf =
+      return_code ? NULL : io_writer_buffer(writer, &capacity);
+  size_t header_size =
+      out_buf ? LZ4F_compressBegin(cctx, out_buf, capacity, &prefs) : 0;
+  if (!out_buf || LZ4F_isError(header_size) ||
+      io_writer_commit(writer, header_size) != 0) {
     return_code = -1;
-    goto done_stream;
   }
 
-  for (;;) {
-    size_t nread = fread(in_buf, 1, LZ4_FILE_CHUNK, input);
-    if (ferror(input)) {
+  while (return_code == 0) {
+    const unsigned char *in_buf;
+    size_t nread;
+    int at_end;
+    if (io_reader_next(reader, &in_buf, &nread, &at_end) != 0) {
       return_code = -1; // Read error
       break;
     }
 
-    if (nread == 0) {
-      size_t end_size = LZ4F_compressEnd(cctx, out_buf, LZ4_OUT_CHUNK, NULL);
-      if (LZ4F_isError(end_size)) {
+    for (size_t done = 0; done < nread;) {
+      size_t n = nread - done < piece ? nread - done : piece;
+      out_buf = io_writer_buffer(writer, &capacity);
+      size_t bytes = out_buf ? LZ4F_compressUpdate(cctx, out_buf, capacity,
+                                                   in_buf + done, n, NULL)
+                             : 0;
+      if (!out_buf || LZ4F_isError(bytes) ||
+          io_writer_commit(writer, bytes) != 0) {
         return_code = -1;
         break;
       }
-      if (end_size > 0) {
-        if (fwrite(out_buf, 1, end_size, output) != end_size ||
-            ferror(output)) {
-          return_code = -1;
-        }
-      }
-      break; // End of file
+      done += n;
     }
 
-    size_t bytes =
-        LZ4F_compressUpdate(cctx, out_buf, LZ4_OUT_CHUNK, in_buf, nread, NULL);
-    if (LZ4F_isError(bytes)) {
-      return_code = -1;
-      break;
-    }
-    if (bytes > 0) {
-      if (fwrite(out_buf, 1, bytes, output) != bytes || ferror(output)) {
+    if (return_code == 0 && at_end) {
+      out_buf = io_writer_buffer(writer, &capacity);
+      size_t end_size =
+          out_buf ? LZ4F_compressEnd(cctx, out_buf, capacity, NULL) : 0;
+      if (!out_buf || LZ4F_isError(end_size) ||
+          io_writer_commit(writer, end_size) != 0) {
         return_code = -1;
-        break;
       }
+      break; // End of file
     }
   }
 
-done_stream:
   Py_END_ALLOW_THREADS
 
       LZ4F_freeCompressionContext(cctx);
+  io_reader_close(reader);
+  if (writer && io_writer_close(writer) != 0) {
+    return_code = -1;
+  }
 
   if (return_code != 0) {
     if (!PyErr_Occurred())
@@ -141,30 +153,37 @@ static int lz4_decompress_file(const char *input_path,
     return -1;
   }
 
-  unsigned char in_buf[LZ4_FILE_CHUNK];
-  unsigned char out_buf[LZ4_OUT_CHUNK];
-  int return_code = 0;
+  IOReader *reader = io_reader_open(input);
+  IOWriter *writer = io_writer_open(output);
+  int return_code = reader && writer ? 0 : -1;
+  io_advise_sequential(input);
 
   Py_BEGIN_ALLOW_THREADS
 
-      size_t input_size = 0;
+      const unsigned char *in_buf = NULL;
+  size_t input_size = 0;
   size_t input_pos = 0;
+  int at_end = 0;
+  int between_frames = 0;
 
-  for (;;) {
-    if (input_pos == input_size) {
-      input_size = fread(in_buf, 1, LZ4_FILE_CHUNK, input);
-      if (ferror(input)) {
+  while (return_code == 0) {
+    if (input_pos == input_size && !at_end) {
+      if (io_reader_next(reader, &in_buf, &input_size, &at_end) != 0) {
         return_code = -1; // Read error
         break;
       }
       input_pos = 0;
-      if (input_size == 0) {
-        break; // End of file
-      }
     }
+    if (between_frames && input_pos == input_size)
+      break; // The last frame ended with the input
 
+    size_t dst_size;
+    unsigned char *out_buf = io_writer_buffer(writer, &dst_size);
+    if (!out_buf) {
+      return_code = -1;
+      break;
+    }
     size_t src_size = input_size - input_pos;
-    size_t dst_size = LZ4_OUT_CHUNK;
 
     // The content checksum is verified as the frame is consumed
     ret = LZ4F_decompress(dctx, out_buf, &dst_size, in_buf + input_pos,
@@ -176,21 +195,28 @@ static int lz4_decompress_file(const char *input_path,
 
     input_pos += src_size;
 
-    if (dst_size > 0) {
-      if (fwrite(out_buf, 1, dst_size, output) != dst_size || ferror(output)) {
-        return_code = -1;
-        break;
-      }
+    if (io_writer_commit(writer, dst_size) != 0) {
+      return_code = -1;
+      break;
     }
 
-    if (ret == 0) {
-      break; // Frame fully decoded
+    // `lz4 -d` reads concatenated frames as one stream; the context
+    // starts over on its own once a frame ends
+    between_frames = ret == 0;
+    if (!between_frames && input_pos == input_size && at_end &&
+        dst_size == 0) {
+      return_code = -1; // Truncated frame
+      break;
     }
   }
 
   Py_END_ALLOW_THREADS
 
       LZ4F_freeDecompressionContext(dctx);
+  io_reader_close(reader);
+  if (writer && io_writer_close(writer) != 0) {
+    return_code = -1;
+  }
 
   if (return_code != 0) {
     if (!PyErr_Occurred())
@@ -206,6 +232,122 @@ static int lz4_decompress_file(const char *input_path,
   return 0;
 }
 
+// ---- Parallel Decompression ----
+
+#define LZ4_FRAME_MAGIC 0x184D2204U
+#define LZ4_SKIPPABLE_MAGIC 0x184D2A50U // the low 4 bits are free
+#define LZ4_FLG_BLOCK_CHECKSUM 0x10
+#define LZ4_FLG_CONTENT_SIZE 0x08
+#define LZ4_FLG_CONTENT_CHECKSUM 0x04
+#define LZ4_FLG_DICT_ID 0x01
+
+static uint32_t lz4_le32(const unsigned char *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+// Walk one frame's blocks from its header at data; its length, or 0 if it
+// does not record its content size (`lz4 --content-size`) or is cut short
+static size_t lz4_frame_length(const unsigned char *data, size_t size,
+                               uint64_t *content_size) {
+  if (size < 7)
+    return 0;
+  unsigned flg = data[4];
+  if ((flg >> 6) != 1 || !(flg & LZ4_FLG_CONTENT_SIZE))
+    return 0;
+  size_t pos = 4 + 2 + 8 + (flg & LZ4_FLG_DICT_ID ? 4 : 0) + 1;
+  if (size < pos)
+    return 0;
+  *content_size = (uint64_t)lz4_le32(data + 6) |
+                  ((uint64_t)lz4_le32(data + 10) << 32);
+
+  size_t block_extra = flg & LZ4_FLG_BLOCK_CHECKSUM ? 4 : 0;
+  for (;;) {
+    if (size - pos < 4)
+      return 0;
+    uint32_t word = lz4_le32(data + pos);
+    pos += 4;
+    if (word == 0)
+      break; // EndMark
+    size_t block = word & 0x7FFFFFFFU; // the top bit flags a stored block
+    if (size - pos < block + block_extra)
+      return 0;
+    pos += block + block_extra;
+  }
+  if (flg & LZ4_FLG_CONTENT_CHECKSUM) {
+    if (size - pos < 4)
+      return 0;
+    pos += 4;
+  }
+  return pos;
+}
+
+static int lz4_scan_frames(const unsigned char *data, size_t size,
+                           FrameSpan **spans, size_t *count) {
+  size_t capacity = 0;
+  size_t pos = 0;
+  while (pos < size) {
+    if (size - pos < 8)
+      return -1;
+    uint32_t magic = lz4_le32(data + pos);
+    if ((magic & 0xFFFFFFF0U) == LZ4_SKIPPABLE_MAGIC) {
+      uint32_t skip = lz4_le32(data + pos + 4);
+      if (size - pos - 8 < skip)
+        return -1;
+      pos += 8 + (size_t)skip;
+      continue;
+    }
+    if (magic != LZ4_FRAME_MAGIC)
+      return -1; // legacy frames carry no sizes
+
+    uint64_t out_size = 0;
+    size_t n = lz4_frame_length(data + pos, size - pos, &out_size);
+    if (n == 0)
+      return -1;
+    FrameSpan *span = frame_span_push(spans, count, &capacity);
+    if (!span)
+      return -1;
+    span->in_offset = pos;
+    span->in_size = n;
+    span->out_size = out_size;
+    pos += n;
+  }
+  return 0;
+}
+
+static int lz4_decode_frame(const unsigned char *frame, const FrameSpan *span,
+                            unsigned char *out) {
+  LZ4F_decompressionContext_t dctx;
+  if (LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION)))
+    return -1;
+
+  size_t in_pos = 0, out_pos = 0;
+  size_t ret = 1;
+  while (ret != 0) {
+    size_t src_size = span->in_size - in_pos;
+    size_t dst_size = (size_t)span->out_size - out_pos;
+    ret = LZ4F_decompress(dctx, out + out_pos, &dst_size, frame + in_pos,
+                          &src_size, NULL);
+    if (LZ4F_isError(ret) || (src_size == 0 && dst_size == 0 && ret != 0))
+      break; // Damaged, or no progress
+    in_pos += src_size;
+    out_pos += dst_size;
+  }
+  LZ4F_freeDecompressionContext(dctx);
+  return ret == 0 && in_pos == span->in_size && out_pos == span->out_size
+             ? 0
+             : -1;
+}
+
+static int lz4_decompress_file_mt(const char *input_path,
+                                  const char *output_path, int threads) {
+  int rc = standalone_decompress_frames(input_path, output_path, threads,
+                                        lz4_scan_frames, lz4_decode_frame);
+  if (rc != 0)
+    return rc > 0 ? 0 : -1;
+  return lz4_decompress_file(input_path, output_path);
+}
+
 static char *lz4_get_original_name(const char *compressed_path) {
   (void)compressed_path; // .lz4 does not store the original filename
   return NULL;
@@ -217,10 +359,12 @@ static int lz4_is_format(const unsigned char *magic, size_t size) {
 }
 
 static const StandaloneFormat lz4_format = {
+    .format = FORMAT_LZ4,
     .name = "lz4",
     .extension = ".lz4",
     .compress_file = lz4_compress_file,
     .decompress_file = lz4_decompress_file,
+    .decompress_file_mt = lz4_decompress_file_mt,
     .get_original_name = lz4_get_original_name,
     .is_format = lz4_is_format,
 };
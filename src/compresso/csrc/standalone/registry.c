@@ -2,20 +2,29 @@
 #include "../archives.h"
 #include "../standalone.h"
 #include <Python.h>
+#include <pthread.h>
+
+// FORMAT_TAR is the largest Format value
+#define STANDALONE_FORMAT_SLOTS (FORMAT_TAR + 1)
+
+// Format -> handler, filled once from each format's own .format so the
+// lookup on every call is a bounds check and a load
+static const StandaloneFormat *formats_by_id[STANDALONE_FORMAT_SLOTS];
+static pthread_once_t formats_once = PTHREAD_ONCE_INIT;
+
+static void register_all_formats(void) {
+  const StandaloneFormat *all[] = {get_gzip_format(), get_bzip2_format(),
+                                   get_xz_format(), get_zstd_format(),
+                                   get_lz4_format()};
+  for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) {
+    if (all[i] && (unsigned)all[i]->format < STANDALONE_FORMAT_SLOTS)
+      formats_by_id[all[i]->format] = all[i];
+  }
+}
 
 const StandaloneFormat *find_standalone_format(Format format) {
-  switch (format) {
-  case FORMAT_GZIP:
-    return get_gzip_format();
-  case FORMAT_BZIP2:
-    return get_bzip2_format();
-  case FORMAT_XZ:
-    return get_xz_format();
-  case FORMAT_ZSTD:
-    return get_zstd_format();
-  case FORMAT_LZ4:
-    return get_lz4_format();
-  default:
+  pthread_once(&formats_once, register_all_formats);
+  if ((unsigned)format >= STANDALONE_FORMAT_SLOTS)
     return NULL;
-  }
+  return formats_by_id[format];
 }
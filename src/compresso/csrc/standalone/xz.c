@@ -1,14 +1,19 @@
 #define PY_SSIZE_T_CLEAN
 #include "../common.h"
+#include "../fileio.h"
 #include "../standalone.h"
+#include "../threadpool.h"
 #include <Python.h>
 #include <lzma.h>
 #include <stdio.h>
 #include <string.h>
 
-#define XZ_CHUNK 65536                                // 64KB
 #define XZ_DECOMPRESS_MEMLIMIT (512ULL * 1024 * 1024) // 512MB
 
+// lzma_stream_encoder_mt is stable from 5.2.0, the threaded decoder from 5.4.0
+#define XZ_HAVE_MT_ENCODER (LZMA_VERSION >= 50020002)
+#define XZ_HAVE_MT_DECODER (LZMA_VERSION >= 50040002)
+
 static uint32_t xz_level_to_preset(int level) {
   if (level < 0)
     level = 6; // Default
@@ -17,83 +22,130 @@ static uint32_t xz_level_to_preset(int level) {
   return (uint32_t)level;
 }
 
-static int xz_compress_file(const char *input_path, const char *output_path,
-                            int level) {
-  FILE *input = fopen(input_path, "rb");
-  if (!input) {
+static int xz_open_files(const char *input_path, const char *output_path,
+                         FILE **input, FILE **output) {
+  *input = fopen(input_path, "rb");
+  if (!*input) {
     PyErr_SetFromErrnoWithFilename(PyExc_OSError, input_path);
     return -1;
   }
 
-  FILE *output = fopen(output_path, "wb");
-  if (!output) {
+  *output = fopen(output_path, "wb");
+  if (!*output) {
     PyErr_SetFromErrnoWithFilename(PyExc_OSError, output_path);
-    fclose(input);
-    return -1;
-  }
-
-  // lzma_easy_encoder emits the complete .xz container with an embedded
-  // CRC64 integrity check
-  lzma_stream strm = LZMA_STREAM_INIT;
-  lzma_ret ret =
-      lzma_easy_encoder(&strm, xz_level_to_preset(level), LZMA_CHECK_CRC64);
-  if (ret != LZMA_OK) {
-    PyErr_SetString(comp_BackendError, "Failed to initialize xz compression");
-    fclose(input);
-    fclose(output);
+    fclose(*input);
     return -1;
   }
+  return 0;
+}
 
-  unsigned char in_buf[XZ_CHUNK];
-  unsigned char out_buf[XZ_CHUNK];
-  int return_code = 0;
+// Drive an initialized coder from input to output until LZMA_STREAM_END,
+// then end it. *final_ret holds the failing lzma_code result, if any.
+static int xz_code_file(lzma_stream *strm, FILE *input, FILE *output,
+                        lzma_ret *final_ret) {
+  IOReader *reader = io_reader_open(input);
+  IOWriter *writer = io_writer_open(output);
+  int return_code = reader && writer ? 0 : -1;
+  io_advise_sequential(input);
+  *final_ret = LZMA_OK;
 
   Py_BEGIN_ALLOW_THREADS
 
       lzma_action action = LZMA_RUN;
 
-  while (1) {
-    if (strm.avail_in == 0) {
-      size_t nread = fread(in_buf, 1, XZ_CHUNK, input);
-      if (ferror(input)) {
+  while (return_code == 0) {
+    if (strm->avail_in == 0 && action == LZMA_RUN) {
+      const unsigned char *in_buf;
+      size_t nread;
+      int at_end;
+      if (io_reader_next(reader, &in_buf, &nread, &at_end) != 0) {
         return_code = -1; // Read error
         break;
       }
-      strm.next_in = in_buf;
-      strm.avail_in = nread;
-      if (feof(input)) {
+      strm->next_in = in_buf;
+      strm->avail_in = nread;
+      if (at_end) {
         action = LZMA_FINISH;
       }
     }
 
-    strm.next_out = out_buf;
-    strm.avail_out = XZ_CHUNK;
+    size_t capacity;
+    unsigned char *out_buf = io_writer_buffer(writer, &capacity);
+    if (!out_buf) {
+      return_code = -1; // Write error
+      break;
+    }
+    strm->next_out = out_buf;
+    strm->avail_out = capacity;
 
-    ret = lzma_code(&strm, action);
+    lzma_ret ret = lzma_code(strm, action);
 
-    size_t write_size = XZ_CHUNK - strm.avail_out;
-    if (write_size > 0) {
-      if (fwrite(out_buf, 1, write_size, output) != write_size ||
-          ferror(output)) {
-        return_code = -1; // Write error
-        break;
-      }
+    if (io_writer_commit(writer, capacity - strm->avail_out) != 0) {
+      return_code = -1; // Write error
+      break;
     }
 
     if (ret == LZMA_STREAM_END) {
-      break; // Finished
+      break; // Finished; when decoding, the CRC64 is verified by now
     }
     if (ret != LZMA_OK) {
-      return_code = -1; // Compression error
+      return_code = -1; // Coder / integrity error
+      *final_ret = ret;
       break;
     }
   }
 
   Py_END_ALLOW_THREADS
 
-      lzma_end(&strm);
+      lzma_end(strm);
+  io_reader_close(reader);
+  if (writer && io_writer_close(writer) != 0) {
+    return_code = -1; // Write error
+  }
+  return return_code;
+}
 
-  if (return_code != 0) {
+// Set up the encoder: the multi-threaded one splits the input into blocks
+// compressed side by side, so the .xz also records their sizes and a threaded
+// decoder can split it back up. lzma_easy_encoder emits a single block.
+// Both write the complete .xz container with an embedded CRC64 check.
+static lzma_ret xz_encoder_init(lzma_stream *strm, int level, int threads) {
+#if XZ_HAVE_MT_ENCODER
+  if (threads != 1) {
+    lzma_mt mt = {0};
+    mt.threads = (uint32_t)threadpool_resolve_threads(threads);
+    mt.preset = xz_level_to_preset(level);
+    mt.check = LZMA_CHECK_CRC64;
+    mt.block_size = 0; // liblzma's default: 3x the preset's dictionary
+    mt.timeout = 0;
+    lzma_ret ret = lzma_stream_encoder_mt(strm, &mt);
+    if (ret == LZMA_OK || ret == LZMA_MEM_ERROR)
+      return ret;
+    // Options the threaded encoder rejects: use the single-block one
+  }
+#else
+  (void)threads;
+#endif
+  return lzma_easy_encoder(strm, xz_level_to_preset(level), LZMA_CHECK_CRC64);
+}
+
+static int xz_compress_threads(const char *input_path,
+                               const char *output_path, int level,
+                               int threads) {
+  FILE *input, *output;
+  if (xz_open_files(input_path, output_path, &input, &output) != 0)
+    return -1;
+
+  lzma_stream strm = LZMA_STREAM_INIT;
+  if (xz_encoder_init(&strm, level, threads) != LZMA_OK) {
+    PyErr_SetString(comp_BackendError, "Failed to initialize xz compression");
+    fclose(input);
+    fclose(output);
+    return -1;
+  }
+
+  lzma_ret final_ret;
+  if (xz_code_file(&strm, input, output, &final_ret) != 0) {
     if (!PyErr_Occurred())
       PyErr_SetString(comp_BackendError, "xz compression failed");
     fclose(input);
@@ -106,81 +158,53 @@ static int xz_compress_file(const char *input_path, const char *output_path,
   return 0;
 }
 
-static int xz_decompress_file(const char *input_path, const char *output_path) {
-  FILE *input = fopen(input_path, "rb");
-  if (!input) {
-    PyErr_SetFromErrnoWithFilename(PyExc_OSError, input_path);
-    return -1;
+static int xz_compress_file(const char *input_path, const char *output_path,
+                            int level) {
+  return xz_compress_threads(input_path, output_path, level, 1);
+}
+
+static int xz_compress_file_mt(const char *input_path, const char *output_path,
+                               int level, int threads) {
+  return xz_compress_threads(input_path, output_path, level, threads);
+}
+
+// The threaded decoder only runs blocks in parallel when the file records
+// their sizes (as the multi-threaded encoder does); other files decode on
+// the calling thread exactly as lzma_stream_decoder would
+static lzma_ret xz_decoder_init(lzma_stream *strm, int threads) {
+#if XZ_HAVE_MT_DECODER
+  if (threads != 1) {
+    lzma_mt mt = {0};
+    mt.threads = (uint32_t)threadpool_resolve_threads(threads);
+    mt.timeout = 0;
+    mt.memlimit_threading = XZ_DECOMPRESS_MEMLIMIT;
+    mt.memlimit_stop = XZ_DECOMPRESS_MEMLIMIT;
+    lzma_ret ret = lzma_stream_decoder_mt(strm, &mt);
+    if (ret == LZMA_OK || ret == LZMA_MEM_ERROR)
+      return ret;
   }
+#else
+  (void)threads;
+#endif
+  return lzma_stream_decoder(strm, XZ_DECOMPRESS_MEMLIMIT, 0);
+}
 
-  FILE *output = fopen(output_path, "wb");
-  if (!output) {
-    PyErr_SetFromErrnoWithFilename(PyExc_OSError, output_path);
-    fclose(input);
+static int xz_decompress_threads(const char *input_path,
+                                 const char *output_path, int threads) {
+  FILE *input, *output;
+  if (xz_open_files(input_path, output_path, &input, &output) != 0)
     return -1;
-  }
 
   lzma_stream strm = LZMA_STREAM_INIT;
-  lzma_ret ret = lzma_stream_decoder(&strm, XZ_DECOMPRESS_MEMLIMIT, 0);
-  if (ret != LZMA_OK) {
+  if (xz_decoder_init(&strm, threads) != LZMA_OK) {
     PyErr_SetString(comp_BackendError, "Failed to initialize xz decompression");
     fclose(input);
     fclose(output);
     return -1;
   }
 
-  unsigned char in_buf[XZ_CHUNK];
-  unsigned char out_buf[XZ_CHUNK];
-  int return_code = 0;
-  lzma_ret final_ret = LZMA_OK;
-
-  Py_BEGIN_ALLOW_THREADS
-
-      lzma_action action = LZMA_RUN;
-
-  while (1) {
-    if (strm.avail_in == 0) {
-      size_t nread = fread(in_buf, 1, XZ_CHUNK, input);
-      if (ferror(input)) {
-        return_code = -1; // Read error
-        break;
-      }
-      strm.next_in = in_buf;
-      strm.avail_in = nread;
-      if (feof(input)) {
-        action = LZMA_FINISH;
-      }
-    }
-
-    strm.next_out = out_buf;
-    strm.avail_out = XZ_CHUNK;
-
-    ret = lzma_code(&strm, action);
-
-    size_t write_size = XZ_CHUNK - strm.avail_out;
-    if (write_size > 0) {
-      if (fwrite(out_buf, 1, write_size, output) != write_size ||
-          ferror(output)) {
-        return_code = -1; // Write error
-        break;
-      }
-    }
-
-    if (ret == LZMA_STREAM_END) {
-      break; // Finished, CRC64 verified by the decoder
-    }
-    if (ret != LZMA_OK) {
-      return_code = -1; // Decompression / integrity error
-      final_ret = ret;
-      break;
-    }
-  }
-
-  Py_END_ALLOW_THREADS
-
-      lzma_end(&strm);
-
-  if (return_code != 0) {
+  lzma_ret final_ret;
+  if (xz_code_file(&strm, input, output, &final_ret) != 0) {
     if (!PyErr_Occurred()) {
       if (final_ret == LZMA_MEMLIMIT_ERROR) {
         PyErr_Format(comp_BackendError,
@@ -206,6 +230,15 @@ static int xz_decompress_file(const char *input_path, const char *output_path) {
   return 0;
 }
 
+static int xz_decompress_file(const char *input_path, const char *output_path) {
+  return xz_decompress_threads(input_path, output_path, 1);
+}
+
+static int xz_decompress_file_mt(const char *input_path,
+                                 const char *output_path, int threads) {
+  return xz_decompress_threads(input_path, output_path, threads);
+}
+
 static char *xz_get_original_name(const char *compressed_path) {
   (void)compressed_path; // .xz does not store the original filename
   return NULL;
@@ -217,10 +250,13 @@ static int xz_is_format(const unsigned char *magic, size_t size) {
 }
 
 static const StandaloneFormat xz_format = {
+    .format = FORMAT_XZ,
     .name = "xz",
     .extension = ".xz",
     .compress_file = xz_compress_file,
+    .compress_file_mt = xz_compress_file_mt,
     .decompress_file = xz_decompress_file,
+    .decompress_file_mt = xz_decompress_file_mt,
     .get_original_name = xz_get_original_name,
     .is_format = xz_is_format,
 };
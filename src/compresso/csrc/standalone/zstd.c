@@ -1,11 +1,29 @@
 #define PY_SSIZE_T_CLEAN
 #include "../common.h"
+#include "../fileio.h"
 #include "../standalone.h"
+#include "../threadpool.h"
 #include <Python.h>
 #include <string.h>
 #include <zstd.h>
 
-#define ZSTD_FILE_CHUNK 65536 // 64KB
+// libzstd's recommended buffer size, or the I/O chunk size if larger;
+// the recommendations cover a whole block, so no step stalls on a partial one
+static size_t zstd_chunk(size_t recommended) {
+  size_t chunk = io_chunk_size();
+  return chunk > recommended ? chunk : recommended;
+}
+
+// Open the streams with chunks of at least the recommended sizes
+static void zstd_open_streams(FILE *input, FILE *output, size_t in_size,
+                              size_t out_size, IOReader **reader,
+                              IOWriter **writer) {
+  size_t prev = io_set_chunk_size(zstd_chunk(in_size));
+  *reader = io_reader_open(input);
+  io_set_chunk_size(zstd_chunk(out_size));
+  *writer = io_writer_open(output);
+  io_set_chunk_size(prev);
+}
 
 static int zstd_level_from_generic(int level) {
   if (level < ZSTD_minCLevel())
@@ -15,8 +33,13 @@ static int zstd_level_from_generic(int level) {
   return level;
 }
 
-static int zstd_compress_file(const char *input_path, const char *output_path,
-                              int level) {
+// params may be NULL for the level's defaults
+static int zstd_compress_threads(const char *input_path,
+                                 const char *output_path, int level,
+                                 int threads, const CodecParams *params) {
+  if (params && get_zstd_backend()->check_params(params) != 0)
+    return -1;
+
   FILE *input = fopen(input_path, "rb");
   if (!input) {
     PyErr_SetFromErrnoWithFilename(PyExc_OSError, input_path);
@@ -44,41 +67,56 @@ static int zstd_compress_file(const char *input_path, const char *output_path,
   ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, zlevel);
   // Embed an XXH64 content checksum so decompression verifies integrity
   ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
-
-  unsigned char in_buf[ZSTD_FILE_CHUNK];
-  unsigned char out_buf[ZSTD_FILE_CHUNK];
-  int err = 0;
+  if (threads != 1) {
+    // Workers compress jobs of the input side by side into one frame; a
+    // libzstd built without ZSTD_MULTITHREAD rejects this and stays on the
+    // calling thread
+    (void)ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers,
+                                 threadpool_resolve_threads(threads));
+  }
+  if (params && params->long_distance)
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_enableLongDistanceMatching, 1);
+  if (params && params->window_log)
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_windowLog, params->window_log);
+  if (params && params->match_strategy)
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_strategy, params->match_strategy);
+
+  IOReader *reader;
+  IOWriter *writer;
+  zstd_open_streams(input, output, ZSTD_CStreamInSize(), ZSTD_CStreamOutSize(),
+                    &reader, &writer);
+  int err = reader && writer ? 0 : -1;
+  io_advise_sequential(input);
 
   Py_BEGIN_ALLOW_THREADS
 
-      for (;;) {
-    size_t read = fread(in_buf, 1, ZSTD_FILE_CHUNK, input);
-    if (ferror(input)) {
+      while (!err) {
+    const unsigned char *in_buf;
+    size_t read;
+    int last_chunk;
+    if (io_reader_next(reader, &in_buf, &read, &last_chunk) != 0) {
       err = -1;
       break;
     }
 
-    int last_chunk = feof(input);
     ZSTD_inBuffer inbuf = {in_buf, read, 0};
 
     while (inbuf.pos < inbuf.size || last_chunk) {
-      ZSTD_outBuffer outbuf = {out_buf, ZSTD_FILE_CHUNK, 0};
+      size_t capacity;
+      unsigned char *out_buf = io_writer_buffer(writer, &capacity);
+      if (!out_buf) {
+        err = -1;
+        break;
+      }
+      ZSTD_outBuffer outbuf = {out_buf, capacity, 0};
       ZSTD_EndDirective mode = last_chunk ? ZSTD_e_end : ZSTD_e_continue;
 
       size_t r = ZSTD_compressStream2(cctx, &outbuf, &inbuf, mode);
-      if (ZSTD_isError(r)) {
+      if (ZSTD_isError(r) || io_writer_commit(writer, outbuf.pos) != 0) {
         err = -1;
         break;
       }
 
-      if (outbuf.pos > 0) {
-        if (fwrite(out_buf, 1, outbuf.pos, output) != outbuf.pos ||
-            ferror(output)) {
-          err = -1;
-          break;
-        }
-      }
-
       if (!last_chunk && inbuf.pos == inbuf.size && outbuf.pos == 0) {
         break; // Need more input
       }
@@ -95,6 +133,10 @@ static int zstd_compress_file(const char *input_path, const char *output_path,
   Py_END_ALLOW_THREADS
 
       ZSTD_freeCCtx(cctx);
+  io_reader_close(reader);
+  if (writer && io_writer_close(writer) != 0) {
+    err = -1;
+  }
 
   if (err) {
     if (!PyErr_Occurred())
@@ -109,6 +151,26 @@ static int zstd_compress_file(const char *input_path, const char *output_path,
   return 0;
 }
 
+static int zstd_compress_file(const char *input_path, const char *output_path,
+                              int level) {
+  return zstd_compress_threads(input_path, output_path, level, 1, NULL);
+}
+
+static int zstd_compress_file_mt(const char *input_path,
+                                 const char *output_path, int level,
+                                 int threads) {
+  return zstd_compress_threads(input_path, output_path, level, threads,
+                               NULL);
+}
+
+static int zstd_compress_file_params(const char *input_path,
+                                     const char *output_path, int level,
+                                     int threads,
+                                     const struct CodecParams *params) {
+  return zstd_compress_threads(input_path, output_path, level, threads,
+                               params);
+}
+
 static int zstd_decompress_file(const char *input_path,
                                 const char *output_path) {
   FILE *input = fopen(input_path, "rb");
@@ -132,7 +194,13 @@ static int zstd_decompress_file(const char *input_path,
     return -1;
   }
 
+  // A .zst has nowhere to record a widened window, so accept any this
+  // libzstd can write, as `zstd --long=31` would
   size_t ret = ZSTD_initDStream(dstream);
+  if (!ZSTD_isError(ret))
+    ret = ZSTD_DCtx_setParameter(
+        dstream, ZSTD_d_windowLogMax,
+        ZSTD_dParam_getBounds(ZSTD_d_windowLogMax).upperBound);
   if (ZSTD_isError(ret)) {
     PyErr_SetString(comp_BackendError,
                     "Failed to initialize zstd decompression");
@@ -142,33 +210,41 @@ static int zstd_decompress_file(const char *input_path,
     return -1;
   }
 
-  unsigned char in_buf[ZSTD_FILE_CHUNK];
-  unsigned char out_buf[ZSTD_FILE_CHUNK];
-  int err = 0;
+  IOReader *reader;
+  IOWriter *writer;
+  zstd_open_streams(input, output, ZSTD_DStreamInSize(), ZSTD_DStreamOutSize(),
+                    &reader, &writer);
+  int err = reader && writer ? 0 : -1;
+  io_advise_sequential(input);
 
   Py_BEGIN_ALLOW_THREADS
 
-      size_t input_size = 0;
+      const unsigned char *in_buf = NULL;
+  size_t input_size = 0;
   size_t input_pos = 0;
+  int at_end = 0;
+  size_t r = 1; // non-zero while a frame is incomplete
 
-  for (;;) {
-    if (input_pos == input_size) {
-      input_size = fread(in_buf, 1, ZSTD_FILE_CHUNK, input);
-      if (ferror(input)) {
+  while (!err) {
+    if (input_pos == input_size && !at_end) {
+      if (io_reader_next(reader, &in_buf, &input_size, &at_end) != 0) {
         err = -1;
         break;
       }
       input_pos = 0;
-      if (input_size == 0) {
-        break; // End of input
-      }
     }
 
+    size_t capacity;
+    unsigned char *out_buf = io_writer_buffer(writer, &capacity);
+    if (!out_buf) {
+      err = -1;
+      break;
+    }
     ZSTD_inBuffer inbuf = {in_buf + input_pos, input_size - input_pos, 0};
-    ZSTD_outBuffer outbuf = {out_buf, ZSTD_FILE_CHUNK, 0};
+    ZSTD_outBuffer outbuf = {out_buf, capacity, 0};
 
     // The XXH64 content checksum is verified automatically as the frame ends
-    size_t r = ZSTD_decompressStream(dstream, &outbuf, &inbuf);
+    r = ZSTD_decompressStream(dstream, &outbuf, &inbuf);
     if (ZSTD_isError(r)) {
       err = -1;
       break;
@@ -176,22 +252,29 @@ static int zstd_decompress_file(const char *input_path,
 
     input_pos += inbuf.pos;
 
-    if (outbuf.pos > 0) {
-      if (fwrite(out_buf, 1, outbuf.pos, output) != outbuf.pos ||
-          ferror(output)) {
-        err = -1;
-        break;
-      }
+    if (io_writer_commit(writer, outbuf.pos) != 0) {
+      err = -1;
+      break;
     }
 
-    if (r == 0 && input_pos == input_size && feof(input)) {
-      break; // Finished
+    if (input_pos == input_size && at_end) {
+      if (r == 0) {
+        break; // Finished
+      }
+      if (outbuf.pos == 0) {
+        err = -1; // Truncated frame
+        break;
+      }
     }
   }
 
   Py_END_ALLOW_THREADS
 
       ZSTD_freeDStream(dstream);
+  io_reader_close(reader);
+  if (writer && io_writer_close(writer) != 0) {
+    err = -1;
+  }
 
   if (err) {
     if (!PyErr_Occurred())
@@ -207,6 +290,66 @@ static int zstd_decompress_file(const char *input_path,
   return 0;
 }
 
+// ---- Parallel Decompression ----
+
+// pzstd and `zstd --content-size` runs joined with cat leave frames that
+// each record their decoded size; skippable frames (pzstd's size hints)
+// hold no data. A frame without a size, as `zstd -T` streams write, turns
+// the whole file over to the serial decoder.
+static int zstd_scan_frames(const unsigned char *data, size_t size,
+                            FrameSpan **spans, size_t *count) {
+  size_t capacity = 0;
+  size_t pos = 0;
+  while (pos < size) {
+    size_t n = ZSTD_findFrameCompressedSize(data + pos, size - pos);
+    if (ZSTD_isError(n))
+      return -1;
+    uint32_t magic = (uint32_t)data[pos] | ((uint32_t)data[pos + 1] << 8) |
+                     ((uint32_t)data[pos + 2] << 16) |
+                     ((uint32_t)data[pos + 3] << 24);
+    if ((magic & ZSTD_MAGIC_SKIPPABLE_MASK) != ZSTD_MAGIC_SKIPPABLE_START) {
+      unsigned long long out_size =
+          ZSTD_getFrameContentSize(data + pos, size - pos);
+      if (out_size == ZSTD_CONTENTSIZE_UNKNOWN ||
+          out_size == ZSTD_CONTENTSIZE_ERROR)
+        return -1;
+      FrameSpan *span = frame_span_push(spans, count, &capacity);
+      if (!span)
+        return -1;
+      span->in_offset = pos;
+      span->in_size = n;
+      span->out_size = out_size;
+    }
+    pos += n;
+  }
+  return 0;
+}
+
+static int zstd_decode_frame(const unsigned char *frame,
+                             const FrameSpan *span, unsigned char *out) {
+  ZSTD_DCtx *dctx = ZSTD_createDCtx();
+  if (!dctx)
+    return -1;
+  // As the serial decoder: any window this libzstd can write
+  size_t ret = ZSTD_DCtx_setParameter(
+      dctx, ZSTD_d_windowLogMax,
+      ZSTD_dParam_getBounds(ZSTD_d_windowLogMax).upperBound);
+  if (!ZSTD_isError(ret))
+    ret = ZSTD_decompressDCtx(dctx, out, (size_t)span->out_size, frame,
+                              span->in_size);
+  ZSTD_freeDCtx(dctx);
+  return !ZSTD_isError(ret) && ret == span->out_size ? 0 : -1;
+}
+
+static int zstd_decompress_file_mt(const char *input_path,
+                                   const char *output_path, int threads) {
+  int rc = standalone_decompress_frames(input_path, output_path, threads,
+                                        zstd_scan_frames, zstd_decode_frame);
+  if (rc != 0)
+    return rc > 0 ? 0 : -1;
+  return zstd_decompress_file(input_path, output_path);
+}
+
 static char *zstd_get_original_name(const char *compressed_path) {
   (void)compressed_path; // .zst does not store the original filename
   return NULL;
@@ -218,10 +361,14 @@ static int zstd_is_format(const unsigned char *magic, size_t size) {
 }
 
 static const StandaloneFormat zstd_format = {
+    .format = FORMAT_ZSTD,
     .name = "zstd",
     .extension = ".zst",
     .compress_file = zstd_compress_file,
+    .compress_file_mt = zstd_compress_file_mt,
+    .compress_file_params = zstd_compress_file_params,
     .decompress_file = zstd_decompress_file,
+    .decompress_file_mt = zstd_decompress_file_mt,
     .get_original_name = zstd_get_original_name,
     .is_format = zstd_is_format,
 };
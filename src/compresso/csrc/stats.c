@@ -0,0 +1,245 @@
+#include "stats.h"
+#include <string.h>
+#include <sys/stat.h>
+
+// ---- Counters ----
+
+typedef struct {
+  uint64_t calls, bytes_in, bytes_out, ns, contexts;
+} BackendCounters;
+
+typedef struct {
+  uint64_t calls, errors, bytes_in, bytes_out;
+  uint64_t wall_ns, codec_ns, read_ns, write_ns;
+} FormatCounters;
+
+// [direction][id]; direction 1 is compression
+static BackendCounters backend_stats[2][STATS_BACKEND_SLOTS];
+static FormatCounters format_stats[2][STATS_FORMAT_SLOTS];
+
+static inline void add(uint64_t *counter, uint64_t n) {
+  __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t load(const uint64_t *counter) {
+  return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+// ---- Spans ----
+
+void stats_span_begin(StatsSpan *span) {
+  memset(span, 0, sizeof(*span));
+  span->outer = io_set_waits(&span->io);
+  span->active = 1;
+  span->start_ns = io_monotonic_ns();
+}
+
+static void waits_add(IOWaits *to, const IOWaits *from) {
+  to->reads += from->reads;
+  to->read_bytes += from->read_bytes;
+  to->read_ns += from->read_ns;
+  to->writes += from->writes;
+  to->write_bytes += from->write_bytes;
+  to->write_ns += from->write_ns;
+}
+
+uint64_t stats_span_end(StatsSpan *span) {
+  if (!span->active)
+    return span->wall_ns;
+  span->active = 0;
+  span->wall_ns = io_monotonic_ns() - span->start_ns;
+  io_set_waits(span->outer);
+  if (span->outer)
+    waits_add(span->outer, &span->io);
+  return span->wall_ns;
+}
+
+uint64_t stats_span_codec_ns(const StatsSpan *span) {
+  uint64_t waited = span->io.read_ns + span->io.write_ns;
+  return span->wall_ns > waited ? span->wall_ns - waited : 0;
+}
+
+// ---- Updates ----
+
+void stats_codec(AlgoID algo, int compress, uint64_t bytes_in,
+                 uint64_t bytes_out, uint64_t ns) {
+  if ((unsigned)algo >= STATS_BACKEND_SLOTS)
+    return;
+  BackendCounters *c = &backend_stats[compress ? 1 : 0][algo];
+  add(&c->calls, 1);
+  add(&c->bytes_in, bytes_in);
+  add(&c->bytes_out, bytes_out);
+  add(&c->ns, ns);
+}
+
+void stats_context_created(AlgoID algo, int compress) {
+  if ((unsigned)algo < STATS_BACKEND_SLOTS)
+    add(&backend_stats[compress ? 1 : 0][algo].contexts, 1);
+}
+
+void stats_codec_span(StatsSpan *span, AlgoID algo, int compress,
+                      uint64_t bytes_in, uint64_t bytes_out) {
+  stats_span_end(span);
+  stats_codec(algo, compress, bytes_in, bytes_out, stats_span_codec_ns(span));
+  stats_context_created(algo, compress); // every run opens a stream state
+}
+
+static uint64_t path_size(const char *path, uint64_t moved) {
+  struct stat st;
+  if (!path)
+    return moved;
+  return stat(path, &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+void stats_file_span(StatsSpan *span, Format format, int compress,
+                     const char *src_path, const char *dst_path, int failed) {
+  stats_span_end(span);
+  if ((unsigned)format >= STATS_FORMAT_SLOTS)
+    return;
+  FormatCounters *c = &format_stats[compress ? 1 : 0][format];
+  add(&c->calls, 1);
+  if (failed) {
+    add(&c->errors, 1);
+  } else {
+    add(&c->bytes_in, path_size(src_path, span->io.read_bytes));
+    add(&c->bytes_out, path_size(dst_path, span->io.write_bytes));
+  }
+  add(&c->wall_ns, span->wall_ns);
+  add(&c->codec_ns, stats_span_codec_ns(span));
+  add(&c->read_ns, span->io.read_ns);
+  add(&c->write_ns, span->io.write_ns);
+}
+
+void stats_reset(void) {
+  uint64_t *words[] = {(uint64_t *)backend_stats, (uint64_t *)format_stats};
+  size_t counts[] = {sizeof(backend_stats) / sizeof(uint64_t),
+                     sizeof(format_stats) / sizeof(uint64_t)};
+  for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+    for (size_t j = 0; j < counts[i]; j++)
+      __atomic_store_n(&words[i][j], 0, __ATOMIC_RELAXED);
+  }
+  io_waits_reset();
+  io_buffer_peak_reset();
+}
+
+// ---- Python Views ----
+
+static const Format stats_formats[] = {
+    FORMAT_COMPRESSO, FORMAT_GZIP, FORMAT_BZIP2, FORMAT_XZ,   FORMAT_ZSTD,
+    FORMAT_LZ4,       FORMAT_ZIP,  FORMAT_7Z,    FORMAT_CDAR, FORMAT_TAR};
+
+static const char *const directions[2] = {"decompress", "compress"};
+
+// Sets dict[key] to a new dict holding both directions' views
+static int set_directions(PyObject *dict, const char *key, PyObject *decomp,
+                          PyObject *comp) {
+  if (!decomp || !comp) {
+    Py_XDECREF(decomp);
+    Py_XDECREF(comp);
+    return -1;
+  }
+  PyObject *both = Py_BuildValue("{s:N,s:N}", directions[0], decomp,
+                                 directions[1], comp);
+  if (!both)
+    return -1;
+  int rc = PyDict_SetItemString(dict, key, both);
+  Py_DECREF(both);
+  return rc;
+}
+
+static PyObject *backend_view(const BackendCounters *c) {
+  return Py_BuildValue("{s:K,s:K,s:K,s:K,s:K}", "calls", load(&c->calls),
+                       "bytes_in", load(&c->bytes_in), "bytes_out",
+                       load(&c->bytes_out), "codec_ns", load(&c->ns),
+                       "contexts", load(&c->contexts));
+}
+
+static PyObject *format_view(const FormatCounters *c) {
+  return Py_BuildValue(
+      "{s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K}", "calls", load(&c->calls), "errors",
+      load(&c->errors), "bytes_in", load(&c->bytes_in), "bytes_out",
+      load(&c->bytes_out), "wall_ns", load(&c->wall_ns), "codec_ns",
+      load(&c->codec_ns), "read_ns", load(&c->read_ns), "write_ns",
+      load(&c->write_ns));
+}
+
+static PyObject *backends_view(void) {
+  init_backends();
+  PyObject *dict = PyDict_New();
+  if (!dict)
+    return NULL;
+  for (int id = 0; id < STATS_BACKEND_SLOTS; id++) {
+    const CBackend *backend = id == ALGO_NONE ? get_stored_backend()
+                                              : find_backend_by_id((AlgoID)id);
+    if (!backend)
+      continue;
+    if (set_directions(dict, backend->name, backend_view(&backend_stats[0][id]),
+                       backend_view(&backend_stats[1][id])) != 0) {
+      Py_DECREF(dict);
+      return NULL;
+    }
+  }
+  return dict;
+}
+
+static PyObject *formats_view(void) {
+  PyObject *dict = PyDict_New();
+  if (!dict)
+    return NULL;
+  for (size_t i = 0; i < sizeof(stats_formats) / sizeof(stats_formats[0]);
+       i++) {
+    Format f = stats_formats[i];
+    if (set_directions(dict, format_name_string(f),
+                       format_view(&format_stats[0][f]),
+                       format_view(&format_stats[1][f])) != 0) {
+      Py_DECREF(dict);
+      return NULL;
+    }
+  }
+  return dict;
+}
+
+PyObject *stats_snapshot(void) {
+  IOWaits io;
+  int64_t live, peak;
+  io_waits_total(&io);
+  io_buffer_usage(&live, &peak);
+
+  PyObject *backends = backends_view();
+  PyObject *formats = backends ? formats_view() : NULL;
+  if (!formats) {
+    Py_XDECREF(backends);
+    return NULL;
+  }
+  return Py_BuildValue(
+      "{s:N,s:N,s:{s:K,s:K,s:K,s:K,s:K,s:K},s:{s:L,s:L}}", "backends",
+      backends, "formats", formats, "io", "reads", io.reads, "read_bytes",
+      io.read_bytes, "read_ns", io.read_ns, "writes", io.writes, "write_bytes",
+      io.write_bytes, "write_ns", io.write_ns, "memory", "buffer_bytes",
+      (long long)live, "peak_buffer_bytes", (long long)peak);
+}
+
+int stats_fill_dict(PyObject *dict, const StatsSpan *span,
+                    const char *src_path, const char *dst_path) {
+  struct {
+    const char *key;
+    uint64_t value;
+  } fields[] = {{"wall_ns", span->wall_ns},
+                {"codec_ns", stats_span_codec_ns(span)},
+                {"read_ns", span->io.read_ns},
+                {"write_ns", span->io.write_ns},
+                {"reads", span->io.reads},
+                {"writes", span->io.writes},
+                {"bytes_in", path_size(src_path, span->io.read_bytes)},
+                {"bytes_out", path_size(dst_path, span->io.write_bytes)}};
+  for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+    PyObject *value = PyLong_FromUnsignedLongLong(fields[i].value);
+    if (!value)
+      return -1;
+    int rc = PyDict_SetItemString(dict, fields[i].key, value);
+    Py_DECREF(value);
+    if (rc != 0)
+      return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,67 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "archives.h"
+#include "common.h"
+#include "fileio.h"
+#include <Python.h>
+#include <stdint.h>
+
+// ---- Counters ----
+
+// Process-wide counters kept on at all times: every update is a relaxed
+// atomic add, and a timing costs two monotonic clock reads per codec call.
+// Backend counters cover the codec itself (buffer calls and whole
+// streams); format counters cover one file operation end to end. The I/O
+// side comes from fileio's wait accounting (see IOWaits), so a stream's
+// codec time is its elapsed time less what it waited on reads and writes.
+
+#define STATS_BACKEND_SLOTS 8 // AlgoID values 0..ALGO_ZIP
+#define STATS_FORMAT_SLOTS (FORMAT_TAR + 1)
+
+// A timed region of one thread: its waits are tallied in io while it is
+// open. Spans nest, and ending one adds its waits to the tally it was
+// opened inside.
+typedef struct {
+  IOWaits *outer;
+  uint64_t start_ns;
+  uint64_t wall_ns; // set when the span ends
+  IOWaits io;
+  int active;
+} StatsSpan;
+
+void stats_span_begin(StatsSpan *span);
+// Ends the span (once; later calls do nothing) and returns its elapsed ns
+uint64_t stats_span_end(StatsSpan *span);
+// Elapsed ns of an ended span less its I/O waits
+uint64_t stats_span_codec_ns(const StatsSpan *span);
+
+// One buffer call of the backend, taking ns
+void stats_codec(AlgoID algo, int compress, uint64_t bytes_in,
+                 uint64_t bytes_out, uint64_t ns);
+// A codec context or stream state the backend had to create
+void stats_context_created(AlgoID algo, int compress);
+
+// Ends span as one streaming run of the backend, timed less its I/O waits;
+// the stream state it opened counts as a context
+void stats_codec_span(StatsSpan *span, AlgoID algo, int compress,
+                      uint64_t bytes_in, uint64_t bytes_out);
+
+// Ends span as one file operation in format, sizing it from the paths; for
+// a NULL path (an archive's many members) the bytes the calling thread read
+// or wrote in the span stand in. Failed operations count as errors.
+void stats_file_span(StatsSpan *span, Format format, int compress,
+                     const char *src_path, const char *dst_path, int failed);
+
+// ---- Python Views ----
+
+// get_stats(): the counters as nested dicts
+PyObject *stats_snapshot(void);
+// reset_stats(): zeroes the counters; the peak restarts from what is live
+void stats_reset(void);
+// Fills a caller's stats= dict from an ended span around one file call,
+// sizing it from the paths; returns -1 on error
+int stats_fill_dict(PyObject *dict, const StatsSpan *span,
+                    const char *src_path, const char *dst_path);
+
+#endif // STATS_H
@@ -1,39 +1,293 @@
 #define PY_SSIZE_T_CLEAN
 #include "common.h"
 #include <Python.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 
 // ---- Backend Strategy ----
 
+static const NameEntry strategy_entries[] = {
+    {"balanced", STRAT_BALANCED},
+    {"fast", STRAT_FAST},
+    {"max_ratio", STRAT_MAX_RATIO},
+    {"auto", STRAT_AUTO},
+};
+
+// Every algorithm, available or not
+static const NameEntry algo_entries[] = {
+    {"zlib", ALGO_ZLIB}, {"bzip2", ALGO_BZIP2}, {"lzma", ALGO_LZMA},
+    {"zstd", ALGO_ZSTD}, {"lz4", ALGO_LZ4},     {"snappy", ALGO_SNAPPY},
+};
+
+static NameTable strategy_names;
+static NameTable algo_names;
+static pthread_once_t names_once = PTHREAD_ONCE_INIT;
+
+static void build_name_tables(void) {
+  name_table_build(&strategy_names, strategy_entries,
+                   sizeof(strategy_entries) / sizeof(strategy_entries[0]));
+  name_table_build(&algo_names, algo_entries,
+                   sizeof(algo_entries) / sizeof(algo_entries[0]));
+}
+
 Strategy strategy_from_string(const char *str) {
-  if (!str)
-    return STRAT_BALANCED;
-  if (strcmp(str, "fast") == 0)
-    return STRAT_FAST;
-  if (strcmp(str, "max_ratio") == 0)
-    return STRAT_MAX_RATIO;
-  return STRAT_BALANCED;
+  pthread_once(&names_once, build_name_tables);
+  return (Strategy)name_table_find(&strategy_names, str, STRAT_BALANCED);
 }
 
 AlgoID algo_from_string(const char *str) {
-  if (!str || str[0] == '\0')
-    return ALGO_NONE;
-  if (strcmp(str, "zlib") == 0)
-    return ALGO_ZLIB;
-  if (strcmp(str, "bzip2") == 0)
-    return ALGO_BZIP2;
-  if (strcmp(str, "lzma") == 0)
-    return ALGO_LZMA;
-  if (strcmp(str, "zstd") == 0)
-    return ALGO_ZSTD;
-  if (strcmp(str, "lz4") == 0)
-    return ALGO_LZ4;
-  if (strcmp(str, "snappy") == 0)
-    return ALGO_SNAPPY;
-  return ALGO_NONE;
+  pthread_once(&names_once, build_name_tables);
+  return (AlgoID)name_table_find(&algo_names, str, ALGO_NONE);
 }
 
 const char *get_default_backend_for_strategy(Strategy strat) {
   const CBackend *b = choose_backend(strat);
   return b ? b->name : NULL;
 }
+
+// ---- Budget Selection ----
+
+// Stand-ins until calibration arrives: the same figures as speeds.py's
+// defaults, with typical ratios on mixed data, single-threaded
+static const Calibration default_calibration[] = {
+    {ALGO_ZLIB, -1, 1, 200.0, 250.0, 0.38},
+    {ALGO_BZIP2, -1, 1, 50.0, 60.0, 0.30},
+    {ALGO_LZMA, -1, 1, 30.0, 40.0, 0.27},
+    {ALGO_ZSTD, -1, 1, 400.0, 500.0, 0.34},
+    {ALGO_LZ4, -1, 1, 800.0, 900.0, 0.50},
+    {ALGO_SNAPPY, -1, 1, 600.0, 700.0, 0.52},
+};
+
+static Calibration calibration[CALIBRATION_MAX];
+static size_t calibration_count = 0; // 0: default_calibration applies
+static pthread_mutex_t calibration_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define BUDGET_MB (1024.0 * 1024.0)
+
+// A positive number, then (for times) an optional "s" or "ms" unit
+static int parse_budget_value(const char *str, int is_time, double *value) {
+  char *end = NULL;
+  double v = strtod(str, &end);
+  if (end == str || !(v > 0.0) || !isfinite(v))
+    return -1;
+  if (is_time && strcmp(end, "ms") == 0)
+    v /= 1000.0;
+  else if (!(is_time && strcmp(end, "s") == 0) && *end != '\0')
+    return -1;
+  *value = v;
+  return 0;
+}
+
+int parse_budget(const char *str, Budget *budget) {
+  static const char throughput[] = "target_mb_s=";
+  static const char latency[] = "max_ratio_within=";
+
+  if (!str)
+    return 0;
+  if (strncmp(str, throughput, sizeof(throughput) - 1) == 0) {
+    budget->kind = BUDGET_THROUGHPUT;
+    str += sizeof(throughput) - 1;
+  } else if (strncmp(str, latency, sizeof(latency) - 1) == 0) {
+    budget->kind = BUDGET_LATENCY;
+    str += sizeof(latency) - 1;
+  } else {
+    return 0;
+  }
+  return parse_budget_value(str, budget->kind == BUDGET_LATENCY,
+                            &budget->value) == 0
+             ? 1
+             : -1;
+}
+
+int set_calibration(const Calibration *entries, size_t count) {
+  if (count > CALIBRATION_MAX)
+    return -1;
+  for (size_t i = 0; i < count; i++) {
+    const Calibration *c = &entries[i];
+    if (c->threads < 1 || !(c->comp_mb_s > 0.0) || !(c->ratio > 0.0))
+      return -1;
+  }
+
+  pthread_mutex_lock(&calibration_lock);
+  if (count > 0)
+    memcpy(calibration, entries, count * sizeof(*entries));
+  calibration_count = count;
+  pthread_mutex_unlock(&calibration_lock);
+  return 0;
+}
+
+size_t get_calibration(Calibration *out, size_t max) {
+  pthread_mutex_lock(&calibration_lock);
+  const Calibration *table = calibration;
+  size_t count = calibration_count;
+  if (count == 0) {
+    table = default_calibration;
+    count = sizeof(default_calibration) / sizeof(default_calibration[0]);
+  }
+  memcpy(out, table, (count < max ? count : max) * sizeof(*out));
+  pthread_mutex_unlock(&calibration_lock);
+  return count;
+}
+
+// Compression MB/s an entry would reach on this input: threads only help
+// while there is a block (C_DEFAULT_BLOCK_SIZE) for each of them
+static double effective_mb_s(const Calibration *c, uint64_t size) {
+  if (c->threads <= 1)
+    return c->comp_mb_s;
+  uint64_t blocks = (size + C_DEFAULT_BLOCK_SIZE - 1) / C_DEFAULT_BLOCK_SIZE;
+  if (blocks >= (uint64_t)c->threads)
+    return c->comp_mb_s;
+  return c->comp_mb_s * (double)(blocks ? blocks : 1) / (double)c->threads;
+}
+
+static int meets_budget(const Budget *budget, uint64_t size, double mb_s) {
+  if (budget->kind == BUDGET_THROUGHPUT)
+    return mb_s >= budget->value;
+  return (double)size / BUDGET_MB / mb_s <= budget->value;
+}
+
+int choose_for_budget(const Budget *budget, uint64_t size, int cpus,
+                      Calibration *choice) {
+  Calibration table[CALIBRATION_MAX];
+  size_t count = get_calibration(table, CALIBRATION_MAX);
+
+  const Calibration *best = NULL, *fastest = NULL;
+  double best_mb_s = 0.0, fastest_mb_s = 0.0;
+  for (size_t i = 0; i < count; i++) {
+    const Calibration *c = &table[i];
+    if (c->algo == ALGO_NONE || c->threads > cpus ||
+        !find_backend_by_id(c->algo)) {
+      continue;
+    }
+
+    double mb_s = effective_mb_s(c, size);
+    if (!fastest || mb_s > fastest_mb_s) {
+      fastest = c;
+      fastest_mb_s = mb_s;
+    }
+    if (!meets_budget(budget, size, mb_s))
+      continue;
+    // Best ratio; among equal ratios the faster
+    if (!best || c->ratio < best->ratio ||
+        (c->ratio == best->ratio && mb_s > best_mb_s)) {
+      best = c;
+      best_mb_s = mb_s;
+    }
+  }
+
+  if (!fastest)
+    return -1;
+  *choice = best ? *best : *fastest;
+  choice->comp_mb_s = best ? best_mb_s : fastest_mb_s;
+  return best ? 1 : 0;
+}
+
+// ---- Adaptive Selection ----
+
+// A block is judged by AUTO_SAMPLE_WINDOWS evenly spaced windows (or whole,
+// when smaller), so the cost is independent of the block size
+#define AUTO_SAMPLE_WINDOWS 8
+#define AUTO_SAMPLE_WINDOW (4U * 1024)
+
+// Bits per byte above which data is taken to be already compressed
+#define AUTO_STORE_ENTROPY 7.5
+// lz4 trial ratios: at or above STORE nothing repeats; above FAST matching
+// finds little, so a slower backend would not earn its cost
+#define AUTO_STORE_RATIO 0.97
+#define AUTO_FAST_RATIO 0.85
+#define AUTO_FAST_ENTROPY 7.0
+// Below this a leading magic number is a coincidence, not a payload
+#define AUTO_MAGIC_ENTROPY 6.0
+
+static int is_compressed_format(Format format) {
+  switch (format) {
+  case FORMAT_COMPRESSO:
+  case FORMAT_GZIP:
+  case FORMAT_BZIP2:
+  case FORMAT_XZ:
+  case FORMAT_ZSTD:
+  case FORMAT_LZ4:
+  case FORMAT_ZIP:
+  case FORMAT_7Z:
+  case FORMAT_CDAR:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+// Shannon entropy of the sample, in bits per byte
+static double sample_entropy(const unsigned char *sample, size_t size) {
+  size_t counts[256] = {0};
+  for (size_t i = 0; i < size; i++)
+    counts[sample[i]]++;
+
+  double entropy = 0.0;
+  for (int i = 0; i < 256; i++) {
+    if (counts[i]) {
+      double p = (double)counts[i] / (double)size;
+      entropy -= p * log2(p);
+    }
+  }
+  return entropy;
+}
+
+// Compressed/raw ratio of one fast lz4 pass over the sample, or -1 when lz4
+// is unavailable or the trial could not run
+static double lz4_trial_ratio(const unsigned char *sample, size_t size) {
+  const CBackend *lz4 = find_backend_by_id(ALGO_LZ4);
+  if (!lz4)
+    return -1.0;
+
+  size_t capacity = lz4->max_compressed_size(size);
+  unsigned char *out = (unsigned char *)malloc(capacity);
+  if (!out)
+    return -1.0;
+
+  size_t out_size = 0;
+  double ratio = -1.0;
+  if (lz4->compress_buffer(sample, size, out, &capacity, -1, &out_size) == 0)
+    ratio = (double)out_size / (double)size;
+  free(out);
+  return ratio;
+}
+
+const CBackend *choose_block_backend(const unsigned char *data, size_t size) {
+  const CBackend *balanced = choose_backend(STRAT_BALANCED);
+  if (size == 0)
+    return balanced;
+
+  unsigned char windows[AUTO_SAMPLE_WINDOWS * AUTO_SAMPLE_WINDOW];
+  const unsigned char *sample = data;
+  size_t sample_size = size;
+  if (size > sizeof(windows)) {
+    size_t stride = (size - AUTO_SAMPLE_WINDOW) / (AUTO_SAMPLE_WINDOWS - 1);
+    for (size_t i = 0; i < AUTO_SAMPLE_WINDOWS; i++) {
+      memcpy(windows + i * AUTO_SAMPLE_WINDOW, data + i * stride,
+             AUTO_SAMPLE_WINDOW);
+    }
+    sample = windows;
+    sample_size = sizeof(windows);
+  }
+
+  double entropy = sample_entropy(sample, sample_size);
+  if (is_compressed_format(detect_format_from_magic_bytes(data, size)) &&
+      entropy >= AUTO_MAGIC_ENTROPY) {
+    return NULL;
+  }
+
+  double ratio = lz4_trial_ratio(sample, sample_size);
+  if (ratio < 0) // no trial: entropy alone decides
+    return entropy >= AUTO_STORE_ENTROPY ? NULL : balanced;
+
+  if (ratio >= AUTO_STORE_RATIO && entropy >= AUTO_STORE_ENTROPY)
+    return NULL;
+  if (ratio > AUTO_FAST_RATIO && ratio < AUTO_STORE_RATIO &&
+      entropy >= AUTO_FAST_ENTROPY) {
+    const CBackend *fast = choose_backend(STRAT_FAST);
+    return fast ? fast : balanced;
+  }
+  return balanced;
+}
@@ -0,0 +1,204 @@
+#include "threadpool.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// ---- Internal Types ----
+
+typedef struct {
+  ThreadPoolTask task;
+  void *arg;
+} PoolJob;
+
+struct ThreadPool {
+  pthread_mutex_t lock;
+  pthread_cond_t job_ready; // signalled when a job is queued or on shutdown
+  pthread_cond_t idle;      // signalled when the last pending job finishes
+
+  PoolJob *queue; // ring buffer
+  size_t capacity;
+  size_t head;
+  size_t count;
+
+  size_t pending; // queued + running
+  int shutdown;
+
+  pthread_t *threads;
+  int nthreads;
+};
+
+// ---- Worker ----
+
+static void *worker_main(void *arg) {
+  ThreadPool *pool = (ThreadPool *)arg;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (pool->count == 0 && !pool->shutdown) {
+      pthread_cond_wait(&pool->job_ready, &pool->lock);
+    }
+
+    if (pool->count == 0 && pool->shutdown) {
+      break;
+    }
+
+    PoolJob job = pool->queue[pool->head];
+    pool->head = (pool->head + 1) % pool->capacity;
+    pool->count--;
+    pthread_mutex_unlock(&pool->lock);
+
+    job.task(job.arg);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->pending--;
+    if (pool->pending == 0) {
+      pthread_cond_broadcast(&pool->idle);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  return NULL;
+}
+
+// ---- Queue Helpers ----
+
+static int grow_queue(ThreadPool *pool) {
+  size_t new_capacity = pool->capacity ? pool->capacity * 2 : 64;
+  PoolJob *queue = (PoolJob *)malloc(new_capacity * sizeof(PoolJob));
+  if (!queue) {
+    return -1;
+  }
+
+  // Unroll the ring so the oldest job sits at index 0
+  for (size_t i = 0; i < pool->count; i++) {
+    queue[i] = pool->queue[(pool->head + i) % pool->capacity];
+  }
+
+  free(pool->queue);
+  pool->queue = queue;
+  pool->capacity = new_capacity;
+  pool->head = 0;
+  return 0;
+}
+
+// ---- Public API ----
+
+ThreadPool *threadpool_create(int nthreads) {
+  if (nthreads < 1 || nthreads > THREADPOOL_MAX_THREADS) {
+    return NULL;
+  }
+
+  ThreadPool *pool = (ThreadPool *)calloc(1, sizeof(ThreadPool));
+  if (!pool) {
+    return NULL;
+  }
+
+  pool->threads = (pthread_t *)calloc((size_t)nthreads, sizeof(pthread_t));
+  if (!pool->threads || grow_queue(pool) != 0) {
+    free(pool->threads);
+    free(pool);
+    return NULL;
+  }
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->job_ready, NULL);
+  pthread_cond_init(&pool->idle, NULL);
+
+  for (int i = 0; i < nthreads; i++) {
+    if (pthread_create(&pool->threads[i], NULL, worker_main, pool) != 0) {
+      break;
+    }
+    pool->nthreads++;
+  }
+
+  if (pool->nthreads == 0) {
+    threadpool_destroy(pool);
+    return NULL;
+  }
+
+  return pool;
+}
+
+int threadpool_submit(ThreadPool *pool, ThreadPoolTask task, void *arg) {
+  if (!pool || !task) {
+    return -1;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+
+  if (pool->shutdown ||
+      (pool->count == pool->capacity && grow_queue(pool) != 0)) {
+    pthread_mutex_unlock(&pool->lock);
+    return -1;
+  }
+
+  size_t tail = (pool->head + pool->count) % pool->capacity;
+  pool->queue[tail].task = task;
+  pool->queue[tail].arg = arg;
+  pool->count++;
+  pool->pending++;
+
+  pthread_cond_signal(&pool->job_ready);
+  pthread_mutex_unlock(&pool->lock);
+  return 0;
+}
+
+void threadpool_wait(ThreadPool *pool) {
+  if (!pool) {
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->pending > 0) {
+    pthread_cond_wait(&pool->idle, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void threadpool_destroy(ThreadPool *pool) {
+  if (!pool) {
+    return;
+  }
+
+  threadpool_wait(pool);
+
+  pthread_mutex_lock(&pool->lock);
+  pool->shutdown = 1;
+  pthread_cond_broadcast(&pool->job_ready);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (int i = 0; i < pool->nthreads; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+
+  pthread_cond_destroy(&pool->idle);
+  pthread_cond_destroy(&pool->job_ready);
+  pthread_mutex_destroy(&pool->lock);
+
+  free(pool->threads);
+  free(pool->queue);
+  free(pool);
+}
+
+int threadpool_size(const ThreadPool *pool) { return pool ? pool->nthreads : 0; }
+
+// ---- Helpers ----
+
+int threadpool_cpu_count(void) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n < 1) {
+    return 1;
+  }
+  return n > THREADPOOL_MAX_THREADS ? THREADPOOL_MAX_THREADS : (int)n;
+}
+
+int threadpool_resolve_threads(int requested) {
+  if (requested == 0) {
+    return threadpool_cpu_count();
+  }
+  if (requested < 1) {
+    return 1;
+  }
+  return requested > THREADPOOL_MAX_THREADS ? THREADPOOL_MAX_THREADS
+                                            : requested;
+}
@@ -0,0 +1,43 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <stddef.h>
+
+// ---- Thread Pool ----
+
+// Fixed-size pool of native worker threads. Tasks run without the GIL and
+// must never touch Python objects or the error indicator; report failures
+// through the task's own state and raise from the submitting thread. A task
+// that needs Python takes the GIL itself with PyGILState_Ensure (batch.c),
+// and the submitter must then release it while waiting.
+
+#define THREADPOOL_MAX_THREADS 256
+
+typedef void (*ThreadPoolTask)(void *arg);
+
+typedef struct ThreadPool ThreadPool;
+
+// Returns NULL on failure (no Python exception is set)
+ThreadPool *threadpool_create(int nthreads);
+
+// Queue a task; returns 0 on success, -1 if the pool is shutting down or the
+// queue could not grow
+int threadpool_submit(ThreadPool *pool, ThreadPoolTask task, void *arg);
+
+// Block until every submitted task has finished
+void threadpool_wait(ThreadPool *pool);
+
+// Wait for outstanding tasks, then join and free the workers
+void threadpool_destroy(ThreadPool *pool);
+
+int threadpool_size(const ThreadPool *pool);
+
+// ---- Helpers ----
+
+int threadpool_cpu_count(void);
+
+// Map a user-facing thread count to a worker count: 0 means one per online
+// CPU, anything else is clamped to [1, THREADPOOL_MAX_THREADS]
+int threadpool_resolve_threads(int requested);
+
+#endif // THREADPOOL_H
@@ -7,6 +7,8 @@ from .api import (
     CompressionPlan,
     DecompressionJob,
     DecompressionPlan,
+    acompress,
+    adecompress,
     plan_compression,
     plan_decompression,
 )
@@ -17,6 +19,7 @@ from .archive_api import (
     ArchivePlan,
     ExtractJob,
     ExtractPlan,
+    acreate_archive,
     plan_archive,
     plan_extraction,
 )
@@ -39,4 +42,7 @@ __all__ = [
     "ExtractJob",
     "plan_archive",
     "plan_extraction",
+    "acompress",
+    "adecompress",
+    "acreate_archive",
 ]
@@ -10,12 +10,21 @@ drifting apart.
 
 from __future__ import annotations
 
+import asyncio
+import functools
+import threading
+import weakref
 from dataclasses import dataclass
-from typing import Callable, Protocol, runtime_checkable
+from typing import Any, Callable, Protocol, runtime_checkable
+
+from .._core import AsyncQueue, CancelToken, Progress
 
 # Progress callback signature: (fraction, done_bytes, total_bytes).
 ProgressCallback = Callable[[float, int, int], None]
 
+# Seconds between polls of a native call's byte counter.
+PROGRESS_POLL_INTERVAL = 0.1
+
 
 @dataclass
 class JobResult:
@@ -43,6 +52,182 @@ class Job(Protocol):
 
     plan: object
 
-    def run(self, progress: ProgressCallback | None = None) -> JobResult:
+    def run(
+        self,
+        progress: ProgressCallback | None = None,
+        cancel: CancelToken | None = None,
+    ) -> JobResult:
         """Execute the job and return its result."""
         ...
+
+
+def run_with_progress(
+    call: Callable[[Progress | None], object],
+    total: int,
+    progress: ProgressCallback | None,
+    cancel: CancelToken | None = None,
+) -> None:
+    """Run a native call, reporting its byte counter while it streams.
+
+    Without a callback or a token the call just runs here. Otherwise it
+    runs on a helper thread (native calls drop the GIL while they stream)
+    and this thread reports the counter every PROGRESS_POLL_INTERVAL
+    seconds, between a 0.0 report before and a 1.0 report after. A
+    KeyboardInterrupt arriving meanwhile cancels the token, then waits for
+    the call to stop before propagating.
+
+    Args:
+        call: The native call, taking the Progress to advance (or None).
+        total: Input bytes the call is expected to consume.
+        progress: Optional progress callback.
+        cancel: Optional token the call was given.
+
+    Raises:
+        BaseException: Whatever the call raised.
+    """
+    if progress is None and cancel is None:
+        call(None)
+        return
+
+    if progress is not None:
+        progress(0.0, 0, total)
+    counter: Progress | None = Progress() if progress is not None else None
+    errors: list[BaseException] = []
+
+    def target() -> None:
+        try:
+            call(counter)
+
+        except BaseException as e:
+            errors.append(e)
+
+    worker = threading.Thread(target=target, name="compresso-job", daemon=True)
+    worker.start()
+    try:
+        while True:
+            worker.join(timeout=PROGRESS_POLL_INTERVAL)
+            if not worker.is_alive():
+                break
+
+            if progress is not None and counter is not None:
+                done: int = min(counter.done, total)
+                progress(done / total if total else 0.0, done, total)
+
+    except KeyboardInterrupt:
+        if cancel is not None:
+            cancel.cancel()
+            worker.join()
+        raise
+
+    if errors:
+        raise errors[0]
+
+    if progress is not None:
+        progress(1.0, total, total)
+
+
+class _LoopQueue:
+    """An AsyncQueue whose completions resolve futures on one event loop.
+
+    The queue's descriptor is watched only while calls are outstanding, and
+    every wakeup collects all the outcomes filed since the last one.
+    """
+
+    def __init__(self, loop: asyncio.AbstractEventLoop) -> None:
+        self.loop: asyncio.AbstractEventLoop = loop
+        self.queue: AsyncQueue = AsyncQueue()
+        self.fd: int = self.queue.fileno()
+        self.futures: dict[int, asyncio.Future[Any]] = {}
+
+    def submit(
+        self, call: Callable[..., Any], args: tuple, kwargs: dict[str, Any]
+    ) -> asyncio.Future[Any]:
+        if not self.futures:
+            self.loop.add_reader(self.fd, self._collect)
+
+        ticket: int = self.queue.submit(call, *args, **kwargs)
+        future: asyncio.Future[Any] = self.loop.create_future()
+        self.futures[ticket] = future
+        return future
+
+    def _collect(self) -> None:
+        for ticket, result, error in self.queue.completed():
+            future = self.futures.pop(ticket)
+            if future.cancelled():
+                continue
+
+            if error is not None:
+                future.set_exception(error)
+
+            else:
+                future.set_result(result)
+
+        if not self.futures:
+            self.loop.remove_reader(self.fd)
+
+
+# One queue per running loop; None marks loops that cannot watch descriptors
+# (the Windows proactor loop), which wait on an executor thread instead.
+_loop_queues: weakref.WeakKeyDictionary[
+    asyncio.AbstractEventLoop, _LoopQueue | None
+] = weakref.WeakKeyDictionary()
+
+
+def _submit(
+    loop: asyncio.AbstractEventLoop,
+    call: Callable[..., Any],
+    args: tuple,
+    kwargs: dict[str, Any],
+) -> asyncio.Future[Any]:
+    if loop not in _loop_queues:
+        try:
+            _loop_queues[loop] = _LoopQueue(loop)
+
+        except NotImplementedError:  # no eventfd or pipes
+            _loop_queues[loop] = None
+
+    queue: _LoopQueue | None = _loop_queues[loop]
+    if queue is not None:
+        try:
+            return queue.submit(call, args, kwargs)
+
+        except NotImplementedError:  # raised by add_reader, before submitting
+            _loop_queues[loop] = None
+
+    return loop.run_in_executor(None, functools.partial(call, *args, **kwargs))
+
+
+async def run_native(
+    call: Callable[..., Any],
+    *args: Any,
+    cancel: CancelToken | None = None,
+    **kwargs: Any,
+) -> Any:
+    """Await a native call run on the native worker pool.
+
+    The call runs on the running loop's AsyncQueue, and its completion wakes
+    the loop through the queue's descriptor, so no Python thread waits on
+    it. If the awaiting task is cancelled, cancel is tripped (a token is
+    made when none is given) and the call stops at its next chunk.
+
+    Args:
+        call: A native entry point taking cancel=, e.g. compress_file.
+        *args: Positional arguments for the call.
+        cancel: Optional token passed to the call.
+        **kwargs: Keyword arguments for the call.
+
+    Returns:
+        Whatever the call returned.
+
+    Raises:
+        BaseException: Whatever the call raised.
+    """
+    loop: asyncio.AbstractEventLoop = asyncio.get_running_loop()
+    token: CancelToken = cancel if cancel is not None else CancelToken()
+    future: asyncio.Future[Any] = _submit(loop, call, args, {**kwargs, "cancel": token})
+    try:
+        return await future
+
+    except asyncio.CancelledError:
+        token.cancel()
+        raise
@@ -2,15 +2,24 @@
 
 from __future__ import annotations
 
+from collections.abc import Callable, Sequence
 from dataclasses import dataclass
 from pathlib import Path
 
-from .._core import compress_file, decompress_file
+from .._core import (
+    CancelToken,
+    Dictionary,
+    choose_for_budget,
+    compress_file,
+    compress_many,
+    decompress_file,
+    decompress_many,
+)
 from .._core import get_default_backend_for_strategy as default_backend
 from ..backend.file_inspect import InspectResult
 from ..backend.file_inspect import inspect as inspect_file
-from ..backend.speeds import get_estimated_speeds
-from ._job import JobResult, ProgressCallback
+from ..backend.speeds import get_estimated_speeds, load_calibration
+from ._job import JobResult, ProgressCallback, run_native, run_with_progress
 
 MB = 1024 * 1024
 
@@ -21,13 +30,41 @@ class CompressionOptions:
 
     Attributes:
         algo: Compression algorithm name, or None for auto.
-        strategy: Compression strategy - "fast", "balanced", or "max_ratio".
+        strategy: Compression strategy - "fast", "balanced", "max_ratio",
+            "auto" (chosen per block from a sample of the data), or a budget:
+            "target_mb_s=N" or "max_ratio_within=T" (seconds) picks the best
+            calibrated ratio that compresses at N MB/s or within T.
         level: Compression level (0-9), or None for auto.
+        threads: Worker threads - 1 for a single stream, 0 for one per CPU.
+        seekable: Write a block-indexed file that supports random access.
+        dictionary: Path of a trained dictionary file, or None.
+        checksum: Store a checksum of the data, checked on decompression.
+            Block-split files already checksum every block.
+        io_chunk_size: Bytes per read/write in the streaming loops, from
+            64 KiB to 16 MiB, or 0 for the default (64 KiB).
+        io_engine: "stdio", "uring" to overlap that I/O with compression
+            through io_uring on Linux, or "threads" to read ahead and write
+            behind on helper threads (see io_engines()).
+        long_distance: Match over a long window (zstd), for inputs such as
+            disk images and dumps with far-apart repeats. Single stream only.
+        window_log: Log2 of the zstd match window (10-31), 0 for the level's.
+            Decompression raises its limit to match.
+        match_strategy: zstd match finder from 1 (fast) to 9 (btultra2), 0
+            for the level's.
     """
 
     algo: str | None = None
     strategy: str = "balanced"
     level: int | None = None
+    threads: int = 1
+    seekable: bool = False
+    dictionary: Path | None = None
+    checksum: bool = False
+    io_chunk_size: int = 0
+    io_engine: str = "stdio"
+    long_distance: bool = False
+    window_log: int = 0
+    match_strategy: int = 0
 
 
 @dataclass(frozen=True)
@@ -65,6 +102,11 @@ class DecompressionPlan:
         dest: Destination file path.
         inspection: Result of the file inspection.
         estimated_seconds: Estimated decompression time in seconds, or None if unavailable.
+        threads: Worker threads for block-indexed files, 0 for one per CPU.
+        dictionary: Path of the dictionary the file was compressed with, or None.
+        io_chunk_size: Bytes per read/write when streaming, 0 for the default.
+        io_engine: "stdio", "uring" or "threads" to overlap I/O with
+            decompression.
     """
 
     src: Path
@@ -72,6 +114,24 @@ class DecompressionPlan:
 
     inspection: InspectResult
     estimated_seconds: float | None
+    threads: int = 1
+    dictionary: Path | None = None
+    io_chunk_size: int = 0
+    io_engine: str = "stdio"
+
+
+def _is_budget(strategy: str | None) -> bool:
+    """Whether a strategy is a throughput or latency budget.
+
+    Args:
+        strategy: The strategy name.
+
+    Returns:
+        True for "target_mb_s=..." and "max_ratio_within=..." strategies.
+    """
+    return bool(strategy) and strategy.startswith(
+        ("target_mb_s=", "max_ratio_within=")
+    )
 
 
 def plan_compression(
@@ -113,6 +173,48 @@ def plan_compression(
 
     input_size: int = src_path.stat().st_size
 
+    if options.dictionary is not None and not options.algo and options.strategy == "auto":
+        return CompressionPlan(
+            src=src_path,
+            dest=dest_path,
+            options=options,
+            input_size=input_size,
+            backend_name=None,
+            estimated_seconds=None,
+            can_compress=False,
+            reason_if_unavailable="A dictionary needs an explicit algorithm or a fixed strategy",
+        )
+
+    if not options.algo and _is_budget(options.strategy):
+        load_calibration()
+        try:
+            choice = choose_for_budget(
+                options.strategy, input_size, threads=options.threads
+            )
+
+        except ValueError as e:
+            return CompressionPlan(
+                src=src_path,
+                dest=dest_path,
+                options=options,
+                input_size=input_size,
+                backend_name=None,
+                estimated_seconds=None,
+                can_compress=False,
+                reason_if_unavailable=str(e),
+            )
+
+        return CompressionPlan(
+            src=src_path,
+            dest=dest_path,
+            options=options,
+            input_size=input_size,
+            backend_name=choice["algo"],
+            estimated_seconds=choice["estimated_seconds"],
+            can_compress=True,
+            reason_if_unavailable=None,
+        )
+
     if options.algo:
         backend_name: str = options.algo.lower()
 
@@ -147,7 +249,12 @@ def plan_compression(
 
 
 def plan_decompression(
-    src: str | Path, dest: str | Path | None = None
+    src: str | Path,
+    dest: str | Path | None = None,
+    threads: int = 1,
+    dictionary: str | Path | None = None,
+    io_chunk_size: int = 0,
+    io_engine: str = "stdio",
 ) -> DecompressionPlan:
     """Plan a decompression operation based on file inspection.
 
@@ -155,6 +262,11 @@ def plan_decompression(
         src: Source file path.
         dest: Destination file path. If None, removes
             ".comp" suffix from source if present.
+        threads: Worker threads for block-indexed files, 0 for one per CPU.
+        dictionary: Dictionary file the source was compressed with, or None.
+        io_chunk_size: Bytes per read/write when streaming, 0 for the default.
+        io_engine: "stdio", "uring" or "threads" to overlap I/O with
+            decompression.
 
     Returns:
         DecompressionPlan: The resulting decompression plan.
@@ -178,9 +290,52 @@ def plan_decompression(
         dest=dest_path,
         inspection=inspection,
         estimated_seconds=est_seconds,
+        threads=threads,
+        dictionary=Path(dictionary) if dictionary is not None else None,
+        io_chunk_size=io_chunk_size,
+        io_engine=io_engine,
     )
 
 
+def _load_dictionary(path: Path | None) -> Dictionary | None:
+    """Load a dictionary file saved from Dictionary.data.
+
+    Args:
+        path: Dictionary file path, or None.
+
+    Returns:
+        Dictionary | None: The loaded dictionary, or None if no path was given.
+    """
+    return Dictionary(path.read_bytes()) if path is not None else None
+
+
+def _batch_results(
+    plans: Sequence[object],
+    run: Callable[[list[tuple[str, str]]], list[BaseException | None]],
+    pairs: list[tuple[str, str]],
+) -> list[JobResult]:
+    """Run a native batch and wrap its per-file outcomes as JobResults.
+
+    Args:
+        plans: The plan of each pair, in order.
+        run: Callable taking the pairs and returning one error (or None) each.
+        pairs: The (src, dest) path pair of each plan.
+
+    Returns:
+        list[JobResult]: One result per plan, in order.
+    """
+    try:
+        errors: list[BaseException | None] = run(pairs)
+
+    except BaseException as e:
+        errors = [e] * len(pairs)
+
+    return [
+        JobResult(ok=error is None, error=error, plan=plan)
+        for plan, error in zip(plans, errors)
+    ]
+
+
 class CompressionJob:
     """Compression job high-level wrapper."""
 
@@ -211,11 +366,19 @@ class CompressionJob:
         """
         return cls(plan=plan_compression(src, dest, options))
 
-    def run(self, progress: ProgressCallback | None = None) -> JobResult:
+    def run(
+        self,
+        progress: ProgressCallback | None = None,
+        cancel: CancelToken | None = None,
+    ) -> JobResult:
         """Run the compression job.
 
         Args:
-            progress: Optional progress callback.
+            progress: Optional progress callback, fed the input bytes
+                compressed so far while the job runs.
+            cancel: Optional token that stops the job part way; the partial
+                output is removed and the result's error is a
+                CancelledError.
 
         Returns:
             JobResult: The result of the compression job.
@@ -231,24 +394,16 @@ class CompressionJob:
 
         total: int = self.plan.input_size
         try:
-            if progress:
-                progress(0.0, 0, total)
-
-            lvl: int = (
-                -1 if self.plan.options.level is None else int(self.plan.options.level)
-            )
-
-            compress_file(
-                src_path=str(object=self.plan.src),
-                dst_path=str(object=self.plan.dest),
-                algo=self.plan.backend_name or "",
-                strategy=self.plan.options.strategy or "",
-                level=lvl,
+            kwargs: dict[str, object] = self._call_kwargs()
+            run_with_progress(
+                lambda counter: compress_file(
+                    **kwargs, progress=counter, cancel=cancel
+                ),
+                total,
+                progress,
+                cancel,
             )
 
-            if progress:
-                progress(1.0, total, total)
-
             return JobResult(
                 ok=True,
                 error=None,
@@ -262,6 +417,116 @@ class CompressionJob:
                 plan=self.plan,
             )
 
+    async def arun(self, cancel: CancelToken | None = None) -> JobResult:
+        """Run the compression job from a coroutine.
+
+        The file is compressed on a native worker whose completion wakes
+        the event loop, so no Python thread is held while it runs.
+        Cancelling the awaiting task cancels the job as cancel would.
+
+        Args:
+            cancel: Optional token, as for run.
+
+        Returns:
+            JobResult: The result of the compression job.
+        """
+        if not self.plan.can_compress:
+            return self.run()  # reports why it cannot run
+
+        try:
+            await run_native(compress_file, cancel=cancel, **self._call_kwargs())
+            return JobResult(ok=True, error=None, plan=self.plan)
+
+        except Exception as e:
+            return JobResult(ok=False, error=e, plan=self.plan)
+
+    def _call_kwargs(self) -> dict[str, object]:
+        """Build compress_file's arguments for this job, less progress and cancel.
+
+        Returns:
+            dict[str, object]: The keyword arguments.
+        """
+        options: CompressionOptions = self.plan.options
+        # A budget's level and thread count are chosen natively with the backend
+        algo: str = (
+            ""
+            if _is_budget(options.strategy) and not options.algo
+            else self.plan.backend_name or ""
+        )
+        return {
+            "src_path": str(object=self.plan.src),
+            "dst_path": str(object=self.plan.dest),
+            "algo": algo,
+            "strategy": options.strategy or "",
+            "level": -1 if options.level is None else int(options.level),
+            "threads": options.threads,
+            "seekable": options.seekable,
+            "dictionary": _load_dictionary(options.dictionary),
+            "checksum": options.checksum,
+            "io_chunk_size": options.io_chunk_size,
+            "io_engine": options.io_engine,
+            "long_distance": options.long_distance,
+            "window_log": options.window_log,
+            "match_strategy": options.match_strategy,
+        }
+
+    @staticmethod
+    def run_many(
+        jobs: Sequence[CompressionJob], threads: int = 0
+    ) -> list[JobResult]:
+        """Run several compression jobs side by side on native workers.
+
+        Up to `threads` files are in flight at once, each compressed on a
+        single thread, so options.threads is not used. Jobs that share
+        options go through one compress_many call.
+
+        Args:
+            jobs: The compression jobs to run.
+            threads: Files in flight at once, 0 for one per CPU.
+
+        Returns:
+            list[JobResult]: One result per job, in order.
+        """
+        results: list[JobResult | None] = [None] * len(jobs)
+        groups: dict[CompressionOptions, list[int]] = {}
+        for i, job in enumerate(jobs):
+            if job.plan.can_compress:
+                groups.setdefault(job.plan.options, []).append(i)
+
+            else:
+                results[i] = job.run()
+
+        for options, indices in groups.items():
+            plan: CompressionPlan = jobs[indices[0]].plan
+            lvl: int = -1 if options.level is None else int(options.level)
+
+            def run(pairs, options=options, plan=plan, lvl=lvl):
+                return compress_many(
+                    pairs,
+                    algo=plan.backend_name or "",
+                    strategy=options.strategy or "",
+                    level=lvl,
+                    threads=threads,
+                    seekable=options.seekable,
+                    dictionary=_load_dictionary(options.dictionary),
+                    checksum=options.checksum,
+                    io_chunk_size=options.io_chunk_size,
+                    io_engine=options.io_engine,
+                    long_distance=options.long_distance,
+                    window_log=options.window_log,
+                    match_strategy=options.match_strategy,
+                )
+
+            batch: list[JobResult] = _batch_results(
+                [jobs[i].plan for i in indices],
+                run,
+                [(str(jobs[i].plan.src), str(jobs[i].plan.dest)) for i in indices],
+            )
+            for i, result in zip(indices, batch):
+                results[i] = result
+
+        return results
+
 
 class DecompressionJob:
     """Decompression job high-level wrapper."""
@@ -276,74 +541,233 @@ class DecompressionJob:
 
     @classmethod
     def from_file(
-        cls, src: str | Path, dest: str | Path | None = None
+        cls,
+        src: str | Path,
+        dest: str | Path | None = None,
+        threads: int = 1,
+        dictionary: str | Path | None = None,
+        io_chunk_size: int = 0,
+        io_engine: str = "stdio",
     ) -> DecompressionJob:
         """Create a DecompressionJob from file paths.
 
         Args:
             src: Source file path.
             dest: Destination file path. If None, defaults to the source path.
+            threads: Worker threads for block-indexed files, 0 for one per CPU.
+            dictionary: Dictionary file the source was compressed with, or None.
+            io_chunk_size: Bytes per read/write when streaming, 0 for the default.
+            io_engine: "stdio", "uring" or "threads" to overlap I/O with
+                decompression.
 
         Returns:
             DecompressionJob: The created decompression job.
         """
-        return cls(plan=plan_decompression(src, dest))
+        return cls(
+            plan=plan_decompression(
+                src,
+                dest,
+                threads=threads,
+                dictionary=dictionary,
+                io_chunk_size=io_chunk_size,
+                io_engine=io_engine,
+            )
+        )
 
-    def run(self, progress: ProgressCallback | None = None) -> JobResult:
+    def run(
+        self,
+        progress: ProgressCallback | None = None,
+        cancel: CancelToken | None = None,
+    ) -> JobResult:
         """Run the decompression job.
 
         Args:
-            progress: Optional progress callback.
+            progress: Optional progress callback, fed the compressed bytes
+                consumed so far (out of the source file's size).
+            cancel: Optional token that stops the job part way, as for
+                CompressionJob.run.
 
         Returns:
             JobResult: The result of the decompression job.
         """
-        insp: InspectResult = self.plan.inspection
+        unavailable: JobResult | None = self._unavailable()
+        if unavailable is not None:
+            return unavailable
 
-        if not insp.is_compresso:
-            return JobResult(
-                ok=False,
-                error=RuntimeError("Source file is not a Compresso archive"),
-                plan=self.plan,
+        try:
+            # Progress counts the compressed bytes consumed
+            total: int = self.plan.src.stat().st_size
+            kwargs: dict[str, object] = self._call_kwargs()
+            run_with_progress(
+                lambda counter: decompress_file(
+                    **kwargs, progress=counter, cancel=cancel
+                ),
+                total,
+                progress,
+                cancel,
             )
 
-        if not insp.header_ok:
             return JobResult(
-                ok=False,
-                error=RuntimeError("Compresso file header is invalid"),
+                ok=True,
+                error=None,
                 plan=self.plan,
             )
 
-        if not insp.can_decompress:
+        except BaseException as e:
             return JobResult(
                 ok=False,
-                error=RuntimeError("No available backend can decompress this file"),
+                error=e,
                 plan=self.plan,
             )
 
-        total = insp.orig_size or 0
+    async def arun(self, cancel: CancelToken | None = None) -> JobResult:
+        """Run the decompression job from a coroutine, as CompressionJob.arun.
+
+        Args:
+            cancel: Optional token, as for run.
+
+        Returns:
+            JobResult: The result of the decompression job.
+        """
+        unavailable: JobResult | None = self._unavailable()
+        if unavailable is not None:
+            return unavailable
+
         try:
-            if progress:
-                progress(0.0, 0, total)
+            await run_native(decompress_file, cancel=cancel, **self._call_kwargs())
+            return JobResult(ok=True, error=None, plan=self.plan)
 
-            decompress_file(
-                src_path=str(object=self.plan.src),
-                dst_path=str(object=self.plan.dest),
-                algo="",
-            )
+        except Exception as e:
+            return JobResult(ok=False, error=e, plan=self.plan)
 
-            if progress:
-                progress(1.0, total, total)
+    def _unavailable(self) -> JobResult | None:
+        """Report why the source cannot be decompressed, if it cannot.
 
-            return JobResult(
-                ok=True,
-                error=None,
-                plan=self.plan,
-            )
+        Returns:
+            JobResult | None: A failed result, or None when the job can run.
+        """
+        insp: InspectResult = self.plan.inspection
+        reason: str | None = (
+            "Source file is not a Compresso archive"
+            if not insp.is_compresso
+            else "Compresso file header is invalid"
+            if not insp.header_ok
+            else "No available backend can decompress this file"
+            if not insp.can_decompress
+            else None
+        )
+        if reason is None:
+            return None
 
-        except BaseException as e:
-            return JobResult(
-                ok=False,
-                error=e,
-                plan=self.plan,
+        return JobResult(ok=False, error=RuntimeError(reason), plan=self.plan)
+
+    def _call_kwargs(self) -> dict[str, object]:
+        """Build decompress_file's arguments for this job, less progress and cancel.
+
+        Returns:
+            dict[str, object]: The keyword arguments.
+        """
+        return {
+            "src_path": str(object=self.plan.src),
+            "dst_path": str(object=self.plan.dest),
+            "algo": "",
+            "threads": self.plan.threads,
+            "dictionary": _load_dictionary(self.plan.dictionary),
+            "io_chunk_size": self.plan.io_chunk_size,
+            "io_engine": self.plan.io_engine,
+        }
+
+    @staticmethod
+    def run_many(
+        jobs: Sequence[DecompressionJob], threads: int = 0
+    ) -> list[JobResult]:
+        """Run several decompression jobs side by side on native workers.
+
+        Up to `threads` files are in flight at once, each decoded on a
+        single thread, so plan.threads is not used. Jobs that share a
+        dictionary and I/O settings go through one decompress_many call.
+
+        Args:
+            jobs: The decompression jobs to run.
+            threads: Files in flight at once, 0 for one per CPU.
+
+        Returns:
+            list[JobResult]: One result per job, in order.
+        """
+        results: list[JobResult | None] = [None] * len(jobs)
+        groups: dict[tuple[Path | None, int, str], list[int]] = {}
+        for i, job in enumerate(jobs):
+            insp: InspectResult = job.plan.inspection
+            if insp.is_compresso and insp.header_ok and insp.can_decompress:
+                key = (job.plan.dictionary, job.plan.io_chunk_size, job.plan.io_engine)
+                groups.setdefault(key, []).append(i)
+
+            else:
+                results[i] = job.run()  # reports why it cannot run
+
+        for (dictionary, io_chunk_size, io_engine), indices in groups.items():
+
+            def run(
+                pairs, dictionary=dictionary, chunk=io_chunk_size, engine=io_engine
+            ):
+                return decompress_many(
+                    pairs,
+                    algo="",
+                    threads=threads,
+                    dictionary=_load_dictionary(dictionary),
+                    io_chunk_size=chunk,
+                    io_engine=engine,
+                )
+
+            batch: list[JobResult] = _batch_results(
+                [jobs[i].plan for i in indices],
+                run,
+                [(str(jobs[i].plan.src), str(jobs[i].plan.dest)) for i in indices],
             )
+            for i, result in zip(indices, batch):
+                results[i] = result
+
+        return results
+
+
+async def acompress(
+    src: str | Path,
+    dest: str | Path | None = None,
+    options: CompressionOptions | None = None,
+    cancel: CancelToken | None = None,
+) -> JobResult:
+    """Compress a file from a coroutine; see CompressionJob.arun.
+
+    Args:
+        src: Source file path.
+        dest: Destination file path, as for CompressionJob.from_file.
+        options: Compression options. If None, defaults are used.
+        cancel: Optional token that stops the job part way.
+
+    Returns:
+        JobResult: The result of the compression job.
+    """
+    return await CompressionJob.from_file(src, dest, options).arun(cancel)
+
+
+async def adecompress(
+    src: str | Path,
+    dest: str | Path | None = None,
+    threads: int = 1,
+    dictionary: str | Path | None = None,
+    cancel: CancelToken | None = None,
+) -> JobResult:
+    """Decompress a file from a coroutine; see DecompressionJob.arun.
+
+    Args:
+        src: Source file path.
+        dest: Destination file path, as for DecompressionJob.from_file.
+        threads: Worker threads for block-indexed files, 0 for one per CPU.
+        dictionary: Dictionary file the source was compressed with, or None.
+        cancel: Optional token that stops the job part way.
+
+    Returns:
+        JobResult: The result of the decompression job.
+    """
+    job = DecompressionJob.from_file(src, dest, threads=threads, dictionary=dictionary)
+    return await job.arun(cancel)
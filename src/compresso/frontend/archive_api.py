@@ -6,8 +6,13 @@ from collections.abc import Sequence
 from dataclasses import dataclass
 from pathlib import Path
 
-from .._core import create_archive, extract_archive, list_archive_contents
-from ._job import JobResult, ProgressCallback
+from .._core import (
+    CancelToken,
+    create_archive,
+    extract_archive,
+    list_archive_entries,
+)
+from ._job import JobResult, ProgressCallback, run_native
 
 # Formats whose container cannot hold multiple entries
 _NON_ARCHIVE_FORMATS = {"gz", "gzip", "bz2", "bzip2", "xz", "zst", "zstd", "lz4"}
@@ -32,6 +37,9 @@ class ArchiveOptions:
 
     format: str = "tar.zst"  # Default to tar with zstd
     compression_level: int | None = None
+    threads: int = 1  # Compression workers, 0 = one per CPU
+    base: Path | None = None  # cdar only: earlier archive to deduplicate against
+    catalog: bool = False  # tar only: also write <output>.catalog for fast listing
     preserve_permissions: bool = True
     preserve_timestamps: bool = True
     exclude_patterns: list[str] | None = None
@@ -150,6 +158,17 @@ def plan_archive(
             reason_if_unavailable=f"Format does not support archives: {options.format}",
         )
 
+    if options.base is not None and not Path(options.base).is_file():
+        return ArchivePlan(
+            sources=source_paths,
+            output=output_path,
+            options=options,
+            total_input_size=0,
+            entry_count=len(source_paths),
+            can_run=False,
+            reason_if_unavailable=f"Base archive does not exist: {options.base}",
+        )
+
     total_input_size: int = sum(
         f.stat().st_size for f in _iter_files(source_paths) if f.is_file()
     )
@@ -182,6 +201,26 @@ def _iter_files(paths: list[Path]):
             yield p
 
 
+def _archive_entry(info: dict) -> ArchiveEntry:
+    """Build an ArchiveEntry from one entry of list_archive_entries.
+
+    Args:
+        info: The entry's metadata, as the native listing returns it.
+
+    Returns:
+        The ArchiveEntry.
+    """
+    return ArchiveEntry(
+        path=info["path"],
+        size=info["size"],
+        is_dir=info["type"] == "dir",
+        is_symlink=info["type"] == "symlink",
+        mtime=float(info["mtime"]),
+        mode=info["mode"],
+        link_target=info["link_target"],
+    )
+
+
 def plan_extraction(
     archive: str | Path,
     output_dir: str | Path | None = None,
@@ -212,7 +251,7 @@ def plan_extraction(
 
     try:
         entries: list[ArchiveEntry] = [
-            ArchiveEntry(path=name) for name in list_archive_contents(str(archive_path))
+            _archive_entry(info) for info in list_archive_entries(str(archive_path))
         ]
     except BaseException as e:  # noqa: BLE001 - surface as an unavailable plan
         return ExtractPlan(
@@ -264,11 +303,17 @@ class ArchiveJob:
         """
         return cls(plan=plan_archive(sources, output, options))
 
-    def run(self, progress: ProgressCallback | None = None) -> JobResult:
+    def run(
+        self,
+        progress: ProgressCallback | None = None,
+        cancel: CancelToken | None = None,
+    ) -> JobResult:
         """Create the archive.
 
         Args:
             progress: Optional progress callback.
+            cancel: Optional token that stops the job between entries (and
+                between chunks of an entry); no partial archive is left.
 
         Returns:
             JobResult indicating success or failure.
@@ -288,10 +333,7 @@ class ArchiveJob:
                 progress(0.0, 0, total)
 
             create_archive(
-                str(self.plan.output),
-                self.plan.options.format,
-                [str(s) for s in self.plan.sources],
-                self.plan.options.compression_level or -1,
+                *self._call_args(), cancel, catalog=self.plan.options.catalog
             )
 
             if progress:
@@ -302,17 +344,83 @@ class ArchiveJob:
         except BaseException as e:
             return JobResult(ok=False, error=e, plan=self.plan)
 
+    async def arun(self, cancel: CancelToken | None = None) -> JobResult:
+        """Create the archive from a coroutine.
+
+        The archive is written on a native worker whose completion wakes
+        the event loop, so no Python thread is held while it runs.
+        Cancelling the awaiting task cancels the job as cancel would.
+
+        Args:
+            cancel: Optional token, as for run.
+
+        Returns:
+            JobResult indicating success or failure.
+        """
+        if not self.plan.can_run:
+            return self.run()  # reports why it cannot run
+
+        try:
+            await run_native(
+                create_archive,
+                *self._call_args(),
+                cancel=cancel,
+                catalog=self.plan.options.catalog,
+            )
+            return JobResult(ok=True, error=None, plan=self.plan)
+
+        except Exception as e:
+            return JobResult(ok=False, error=e, plan=self.plan)
+
+    def _call_args(self) -> tuple:
+        """Build create_archive's arguments for this job, less cancel.
+
+        Returns:
+            The positional arguments.
+        """
+        options: ArchiveOptions = self.plan.options
+        return (
+            str(self.plan.output),
+            options.format,
+            [str(s) for s in self.plan.sources],
+            options.compression_level or -1,
+            options.threads,
+            str(options.base) if options.base else None,
+        )
+
+
+async def acreate_archive(
+    sources: Sequence[str | Path],
+    output: str | Path,
+    options: ArchiveOptions | None = None,
+    cancel: CancelToken | None = None,
+) -> JobResult:
+    """Create an archive from a coroutine; see ArchiveJob.arun.
+
+    Args:
+        sources: Source paths to archive.
+        output: Destination archive path.
+        options: Archive options. If None, defaults are used.
+        cancel: Optional token that stops the job between entries.
+
+    Returns:
+        JobResult indicating success or failure.
+    """
+    return await ArchiveJob.from_paths(sources, output, options).arun(cancel)
+
 
 class ExtractJob:
     """Job for extracting an archive."""
 
-    def __init__(self, plan: ExtractPlan) -> None:
+    def __init__(self, plan: ExtractPlan, threads: int = 1) -> None:
         """Initialise extract job.
 
         Args:
             plan: ExtractPlan instance.
+            threads: Worker threads for writing files, 0 for all CPUs.
         """
         self.plan: ExtractPlan = plan
+        self.threads: int = threads
 
     @classmethod
     def from_archive(
@@ -320,6 +428,7 @@ class ExtractJob:
         archive: str | Path,
         output_dir: str | Path | None = None,
         files: list[str] | None = None,
+        threads: int = 1,
     ) -> ExtractJob:
         """Create extract job from archive path.
 
@@ -327,25 +436,35 @@ class ExtractJob:
             archive: Path to the archive file.
             output_dir: Directory to extract to. If None, extracts to current directory.
             files: Optional list of files to extract from the archive. If None, extracts all files.
+            threads: Worker threads for writing files, 0 for all CPUs.
 
         Returns:
             ExtractJob instance.
         """
-        return cls(plan=plan_extraction(archive, output_dir, files))
+        return cls(plan=plan_extraction(archive, output_dir, files), threads=threads)
 
     def list_contents(self) -> list[ArchiveEntry]:
-        """List archive entry paths without extracting.
+        """List archive entries and their metadata without extracting.
+
+        Tar archives created with a catalog are listed from it, without
+        decoding the archive; zip is listed from its central directory.
 
         Returns:
             List of ArchiveEntry instances.
         """
         return list(self.plan.entries)
 
-    def run(self, progress: ProgressCallback | None = None) -> JobResult:
+    def run(
+        self,
+        progress: ProgressCallback | None = None,
+        cancel: CancelToken | None = None,
+    ) -> JobResult:
         """Extract the archive.
 
         Args:
             progress: Optional progress callback.
+            cancel: Optional token that stops the job between entries; the
+                entries already written are kept.
 
         Returns:
             JobResult indicating success or failure.
@@ -369,6 +488,8 @@ class ExtractJob:
                 str(self.plan.archive),
                 str(self.plan.output_dir),
                 self.plan.files or [],
+                self.threads,
+                cancel,
             )
 
             if progress:
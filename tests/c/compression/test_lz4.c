@@ -244,3 +244,122 @@ void test_lz4_binary_data_roundtrip(void) {
     free(compressed);
     free(decompressed);
 }
+
+void test_lz4_context_reuse_roundtrip(void) {
+    const CBackend *backend = get_lz4_backend();
+    if (!backend->is_available()) {
+        TEST_IGNORE_MESSAGE("lz4 not available");
+    }
+
+    TEST_ASSERT_NOT_NULL(backend->context_new);
+    void *cctx = backend->context_new(1);
+    void *dctx = backend->context_new(0);
+    TEST_ASSERT_NOT_NULL(cctx);
+    TEST_ASSERT_NOT_NULL(dctx);
+
+    size_t input_size = 5000;
+    unsigned char *data = safe_malloc(input_size);
+    size_t compressed_capacity = backend->max_compressed_size(input_size);
+    unsigned char *compressed = safe_malloc(compressed_capacity);
+    unsigned char *decompressed = safe_malloc(input_size);
+
+    // Same contexts across rounds and levels; output stays readable by the
+    // stateless decoder
+    for (int round = 0; round < 3; round++) {
+        for (size_t i = 0; i < input_size; i++) {
+            data[i] = (unsigned char)((i * 137 + round) % 256);
+        }
+
+        size_t capacity = compressed_capacity;
+        size_t compressed_size = 0;
+        TEST_ASSERT_EQUAL_INT(0, backend->compress_buffer_ctx(
+                                     cctx, data, input_size, compressed,
+                                     &capacity, round * 3, &compressed_size));
+
+        size_t decompressed_capacity = input_size;
+        size_t decompressed_size = 0;
+        TEST_ASSERT_EQUAL_INT(0, backend->decompress_buffer_ctx(
+                                     dctx, compressed, compressed_size,
+                                     decompressed, &decompressed_capacity,
+                                     &decompressed_size));
+        TEST_ASSERT_EQUAL_size_t(input_size, decompressed_size);
+        TEST_ASSERT_EQUAL_MEMORY(data, decompressed, input_size);
+
+        decompressed_capacity = input_size;
+        TEST_ASSERT_EQUAL_INT(0, backend->decompress_buffer(
+                                     compressed, compressed_size, decompressed,
+                                     &decompressed_capacity,
+                                     &decompressed_size));
+        TEST_ASSERT_EQUAL_MEMORY(data, decompressed, input_size);
+    }
+
+    backend->context_free(cctx, 1);
+    backend->context_free(dctx, 0);
+    free(data);
+    free(compressed);
+    free(decompressed);
+}
+
+void test_lz4_memory_stream_roundtrip(void) {
+    const CBackend *backend = get_lz4_backend();
+    if (!backend->is_available()) {
+        TEST_IGNORE_MESSAGE("lz4 not available");
+    }
+
+    TEST_ASSERT_NOT_NULL(backend->stream_new);
+    void *cstate = backend->stream_new(1, -1);
+    void *dstate = backend->stream_new(0, -1);
+    TEST_ASSERT_NOT_NULL(cstate);
+    TEST_ASSERT_NOT_NULL(dstate);
+
+    size_t input_size = 200000;
+    unsigned char *data = safe_malloc(input_size);
+    for (size_t i = 0; i < input_size; i++) {
+        data[i] = (unsigned char)((i / 64) % 256);
+    }
+
+    size_t compressed_capacity = backend->max_compressed_size(input_size) + 4096;
+    unsigned char *compressed = safe_malloc(compressed_capacity);
+    unsigned char *decompressed = safe_malloc(input_size);
+
+    // Odd-sized input pieces and a 100-byte output window force the steps
+    // through partial consumption and C_STREAM_MORE
+    size_t compressed_size = 0;
+    size_t fed = 0;
+    while (fed < input_size) {
+        size_t piece = input_size - fed < 7001 ? input_size - fed : 7001;
+        CStreamIn in = {data + fed, piece, 0};
+        CStreamOp op = fed + piece == input_size ? C_STREAM_FINISH : C_STREAM_RUN;
+        int r;
+        do {
+            size_t room = compressed_capacity - compressed_size;
+            CStreamOut out = {compressed + compressed_size, room < 100 ? room : 100, 0};
+            r = backend->stream_compress_step(cstate, &in, &out, op);
+            TEST_ASSERT_NOT_EQUAL(C_STREAM_ERROR, r);
+            compressed_size += out.pos;
+        } while (r == C_STREAM_MORE);
+        TEST_ASSERT_EQUAL_size_t(piece, in.pos);
+        fed += piece;
+    }
+
+    CStreamIn in = {compressed, compressed_size, 0};
+    size_t decompressed_size = 0;
+    int r;
+    do {
+        size_t room = input_size - decompressed_size;
+        CStreamOut out = {decompressed + decompressed_size, room < 100 ? room : 100, 0};
+        r = backend->stream_decompress_step(dstate, &in, &out);
+        TEST_ASSERT_NOT_EQUAL(C_STREAM_ERROR, r);
+        decompressed_size += out.pos;
+    } while (r == C_STREAM_MORE || in.pos < in.size);
+
+    TEST_ASSERT_EQUAL_INT(C_STREAM_END, r);
+    TEST_ASSERT_EQUAL_size_t(input_size, decompressed_size);
+    TEST_ASSERT_EQUAL_MEMORY(data, decompressed, input_size);
+
+    backend->stream_free(cstate, 1);
+    backend->stream_free(dstate, 0);
+    free(data);
+    free(compressed);
+    free(decompressed);
+}
@@ -247,3 +247,67 @@ void test_snappy_repetitive_data(void) {
     free(data);
     free(output);
 }
+
+void test_snappy_memory_stream_roundtrip(void) {
+    const CBackend *backend = get_snappy_backend();
+    if (!backend->is_available()) {
+        TEST_IGNORE_MESSAGE("snappy not available");
+    }
+
+    TEST_ASSERT_NOT_NULL(backend->stream_new);
+    void *cstate = backend->stream_new(1, -1);
+    void *dstate = backend->stream_new(0, -1);
+    TEST_ASSERT_NOT_NULL(cstate);
+    TEST_ASSERT_NOT_NULL(dstate);
+
+    size_t input_size = 200000;
+    unsigned char *data = safe_malloc(input_size);
+    for (size_t i = 0; i < input_size; i++) {
+        data[i] = (unsigned char)((i / 64) % 256);
+    }
+
+    size_t compressed_capacity = backend->max_compressed_size(input_size) + 4096;
+    unsigned char *compressed = safe_malloc(compressed_capacity);
+    unsigned char *decompressed = safe_malloc(input_size);
+
+    // Odd-sized input pieces and a 100-byte output window force the steps
+    // through partial consumption and C_STREAM_MORE
+    size_t compressed_size = 0;
+    size_t fed = 0;
+    while (fed < input_size) {
+        size_t piece = input_size - fed < 7001 ? input_size - fed : 7001;
+        CStreamIn in = {data + fed, piece, 0};
+        CStreamOp op = fed + piece == input_size ? C_STREAM_FINISH : C_STREAM_RUN;
+        int r;
+        do {
+            size_t room = compressed_capacity - compressed_size;
+            CStreamOut out = {compressed + compressed_size, room < 100 ? room : 100, 0};
+            r = backend->stream_compress_step(cstate, &in, &out, op);
+            TEST_ASSERT_NOT_EQUAL(C_STREAM_ERROR, r);
+            compressed_size += out.pos;
+        } while (r == C_STREAM_MORE);
+        TEST_ASSERT_EQUAL_size_t(piece, in.pos);
+        fed += piece;
+    }
+
+    CStreamIn in = {compressed, compressed_size, 0};
+    size_t decompressed_size = 0;
+    int r;
+    do {
+        size_t room = input_size - decompressed_size;
+        CStreamOut out = {decompressed + decompressed_size, room < 100 ? room : 100, 0};
+        r = backend->stream_decompress_step(dstate, &in, &out);
+        TEST_ASSERT_NOT_EQUAL(C_STREAM_ERROR, r);
+        decompressed_size += out.pos;
+    } while (r == C_STREAM_MORE || in.pos < in.size);
+
+    TEST_ASSERT_EQUAL_INT(C_STREAM_END, r);
+    TEST_ASSERT_EQUAL_size_t(input_size, decompressed_size);
+    TEST_ASSERT_EQUAL_MEMORY(data, decompressed, input_size);
+
+    backend->stream_free(cstate, 1);
+    backend->stream_free(dstate, 0);
+    free(data);
+    free(compressed);
+    free(decompressed);
+}
@@ -247,3 +247,178 @@ void test_zstd_binary_data_roundtrip(void) {
     free(compressed);
     free(decompressed);
 }
+
+void test_zstd_context_reuse_roundtrip(void) {
+    const CBackend *backend = get_zstd_backend();
+    if (!backend->is_available()) {
+        TEST_IGNORE_MESSAGE("zstd not available");
+    }
+
+    TEST_ASSERT_NOT_NULL(backend->context_new);
+    void *cctx = backend->context_new(1);
+    void *dctx = backend->context_new(0);
+    TEST_ASSERT_NOT_NULL(cctx);
+    TEST_ASSERT_NOT_NULL(dctx);
+
+    size_t input_size = 5000;
+    unsigned char *data = safe_malloc(input_size);
+    size_t compressed_capacity = backend->max_compressed_size(input_size);
+    unsigned char *compressed = safe_malloc(compressed_capacity);
+    unsigned char *decompressed = safe_malloc(input_size);
+
+    // Same contexts across rounds and levels; output stays readable by the
+    // stateless decoder
+    for (int round = 0; round < 3; round++) {
+        for (size_t i = 0; i < input_size; i++) {
+            data[i] = (unsigned char)((i * 137 + round) % 256);
+        }
+
+        size_t capacity = compressed_capacity;
+        size_t compressed_size = 0;
+        TEST_ASSERT_EQUAL_INT(0, backend->compress_buffer_ctx(
+                                     cctx, data, input_size, compressed,
+                                     &capacity, round * 3, &compressed_size));
+
+        size_t decompressed_capacity = input_size;
+        size_t decompressed_size = 0;
+        TEST_ASSERT_EQUAL_INT(0, backend->decompress_buffer_ctx(
+                                     dctx, compressed, compressed_size,
+                                     decompressed, &decompressed_capacity,
+                                     &decompressed_size));
+        TEST_ASSERT_EQUAL_size_t(input_size, decompressed_size);
+        TEST_ASSERT_EQUAL_MEMORY(data, decompressed, input_size);
+
+        decompressed_capacity = input_size;
+        TEST_ASSERT_EQUAL_INT(0, backend->decompress_buffer(
+                                     compressed, compressed_size, decompressed,
+                                     &decompressed_capacity,
+                                     &decompressed_size));
+        TEST_ASSERT_EQUAL_MEMORY(data, decompressed, input_size);
+    }
+
+    backend->context_free(cctx, 1);
+    backend->context_free(dctx, 0);
+    free(data);
+    free(compressed);
+    free(decompressed);
+}
+
+void test_zstd_dictionary_roundtrip(void) {
+    const CBackend *backend = get_zstd_backend();
+    if (!backend->is_available()) {
+        TEST_IGNORE_MESSAGE("zstd not available");
+    }
+
+    // A raw-content dictionary sharing most of its bytes with the input
+    const char *dict_data = "{\"name\": \"compresso\", \"kind\": \"record\", "
+                            "\"tags\": [\"alpha\", \"beta\", \"gamma\"]}";
+    const char *input = "{\"name\": \"compresso\", \"kind\": \"record\", "
+                        "\"tags\": [\"alpha\", \"gamma\"]}";
+    size_t input_size = strlen(input);
+
+    TEST_ASSERT_NOT_NULL(backend->dict_new);
+    void *cdict = backend->dict_new((const unsigned char *)dict_data,
+                                    strlen(dict_data), 1, 3);
+    void *ddict = backend->dict_new((const unsigned char *)dict_data,
+                                    strlen(dict_data), 0, -1);
+    TEST_ASSERT_NOT_NULL(cdict);
+    TEST_ASSERT_NOT_NULL(ddict);
+
+    size_t compressed_capacity = backend->max_compressed_size(input_size);
+    unsigned char *compressed = safe_malloc(compressed_capacity);
+    unsigned char decompressed[256];
+
+    size_t capacity = compressed_capacity;
+    size_t compressed_size = 0;
+    TEST_ASSERT_EQUAL_INT(0, backend->compress_buffer_dict(
+                                 NULL, cdict, (const unsigned char *)input,
+                                 input_size, compressed, &capacity,
+                                 &compressed_size));
+    TEST_ASSERT_LESS_THAN_size_t(input_size, compressed_size);
+
+    size_t decompressed_capacity = sizeof(decompressed);
+    size_t decompressed_size = 0;
+    TEST_ASSERT_EQUAL_INT(0, backend->decompress_buffer_dict(
+                                 NULL, ddict, compressed, compressed_size,
+                                 decompressed, &decompressed_capacity,
+                                 &decompressed_size));
+    TEST_ASSERT_EQUAL_size_t(input_size, decompressed_size);
+    TEST_ASSERT_EQUAL_MEMORY(input, decompressed, input_size);
+
+    // Without the dictionary the frame does not decode
+    decompressed_capacity = sizeof(decompressed);
+    TEST_ASSERT_NOT_EQUAL(0, backend->decompress_buffer(
+                                 compressed, compressed_size, decompressed,
+                                 &decompressed_capacity, &decompressed_size));
+
+    backend->dict_free(cdict, 1);
+    backend->dict_free(ddict, 0);
+    free(compressed);
+}
+
+// Fed in two steps the encoder never learns the input size, so the frame
+// keeps the full 512 MB window; only a decoder raised to it accepts that
+void test_zstd_wide_window_needs_raised_decoder(void) {
+    const CBackend *backend = get_zstd_backend();
+    TEST_ASSERT_NOT_NULL(backend->stream_new_params);
+    TEST_ASSERT_NOT_NULL(backend->stream_new_window);
+
+    size_t original_size = 0;
+    unsigned char *original = read_file("../fixtures/alice29.txt", &original_size);
+    TEST_ASSERT_NOT_NULL(original);
+
+    CodecParams params = CODEC_PARAMS_INIT;
+    params.long_distance = 1;
+    params.window_log = 29;
+    TEST_ASSERT_EQUAL_INT(0, backend->check_params(&params));
+
+    void *enc = backend->stream_new_params(3, &params, 0, C_SIZE_UNKNOWN);
+    TEST_ASSERT_NOT_NULL(enc);
+    unsigned char *head = NULL, *tail = NULL;
+    size_t head_size = 0, tail_size = 0;
+    TEST_ASSERT_EQUAL_INT(0, stream_compress_mem(backend->stream_compress_step,
+                                                 enc, original, original_size,
+                                                 C_STREAM_RUN, &head, &head_size));
+    TEST_ASSERT_EQUAL_INT(0, stream_compress_mem(backend->stream_compress_step,
+                                                 enc, NULL, 0, C_STREAM_FINISH,
+                                                 &tail, &tail_size));
+    backend->stream_free(enc, 1);
+
+    size_t comp_size = head_size + tail_size;
+    unsigned char *comp = safe_malloc(comp_size);
+    TEST_ASSERT_NOT_NULL(comp);
+    if (head_size)
+        memcpy(comp, head, head_size);
+    if (tail_size)
+        memcpy(comp + head_size, tail, tail_size);
+
+    unsigned char *out = NULL;
+    size_t out_size = 0;
+    void *plain = backend->stream_new(0, -1);
+    TEST_ASSERT_EQUAL_INT(-1, stream_decompress_mem(backend->stream_decompress_step,
+                                                    plain, comp, comp_size,
+                                                    &out, &out_size));
+    backend->stream_free(plain, 0);
+    free(out);
+    out = NULL;
+
+    void *wide = backend->stream_new_window(29);
+    TEST_ASSERT_NOT_NULL(wide);
+    TEST_ASSERT_EQUAL_INT(C_STREAM_END,
+                          stream_decompress_mem(backend->stream_decompress_step,
+                                                wide, comp, comp_size, &out,
+                                                &out_size));
+    backend->stream_free(wide, 0);
+    TEST_ASSERT_EQUAL_size_t(original_size, out_size);
+    TEST_ASSERT_EQUAL_MEMORY(original, out, original_size);
+
+    params.window_log = 40;
+    TEST_ASSERT_EQUAL_INT(-1, backend->check_params(&params));
+    PyErr_Clear();
+
+    free(out);
+    free(comp);
+    free(head);
+    free(tail);
+    free(original);
+}
@@ -43,6 +43,7 @@ LDFLAGS << "-L#{py_libpl}" if py_libpl && !py_libpl.empty?
 LDFLAGS << "-L#{py_libdir}" if py_libdir && !py_libdir.empty?
 LDFLAGS << (py_ldversion && !py_ldversion.empty? ? "-lpython#{py_ldversion}" : '-lpython3')
 LDFLAGS << '-ldl'
+LDFLAGS << '-lm'
 
 # BUILD_DIR is set by rakefile before requiring this file
 # SRC_DIR is calculated relative to tests/c/ directory
@@ -56,20 +57,27 @@ SRC_DIR = File.join(__dir__, '..', '..', '..', 'src', 'compresso', 'csrc')
 SOURCE_FILES = [
   'unity.c',  # Unity framework implementation
   File.join(__dir__, 'test_stubs.c'),
+  File.join(SRC_DIR, 'checksum.c'),
+  File.join(SRC_DIR, 'deflate_accel.c'),
+  File.join(SRC_DIR, 'fileio.c'),
   File.join(SRC_DIR, 'format.c'),
   File.join(SRC_DIR, 'registry.c'),
   File.join(SRC_DIR, 'strategy.c'),
+  File.join(SRC_DIR, 'threadpool.c'),
+  File.join(SRC_DIR, 'compression', 'stream_io.c'),
   File.join(SRC_DIR, 'compression', 'py_zlib.c'),
   File.join(SRC_DIR, 'compression', 'py_bzip2.c'),
   File.join(SRC_DIR, 'compression', 'py_lzma.c'),
   File.join(SRC_DIR, 'compression', 'py_zstd.c'),
   File.join(SRC_DIR, 'compression', 'py_lz4.c'),
   File.join(SRC_DIR, 'compression', 'py_snappy.c'),
+  File.join(SRC_DIR, 'compression', 'py_stored.c'),
   File.join(SRC_DIR, 'standalone', 'gzip.c'),
   File.join(SRC_DIR, 'standalone', 'bzip2.c'),
   File.join(SRC_DIR, 'standalone', 'xz.c'),
   File.join(SRC_DIR, 'standalone', 'zstd.c'),
   File.join(SRC_DIR, 'standalone', 'lz4.c'),
+  File.join(SRC_DIR, 'standalone', 'frames.c'),
   File.join(SRC_DIR, 'standalone', 'registry.c')
 ]
 
@@ -10,11 +10,20 @@
  *     (this validates the library's built-in CRC/checksum verification)
  */
 
+// fileno and ftruncate under the harness's -std=c11
+#define _POSIX_C_SOURCE 200809L
+
 #include "../unity.h"
+#include "../../../src/compresso/csrc/checksum.h"
 #include "../../../src/compresso/csrc/common.h"
+#include "../../../src/compresso/csrc/fileio.h"
+#include <lz4frame.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <zstd.h>
 
 #define TEST_INPUT "../fixtures/alice29.txt"
 
@@ -137,6 +146,55 @@ void test_gzip_is_format(void) {
 void test_gzip_round_trip(void) { round_trip(get_gzip_format()); }
 void test_gzip_detect_corruption(void) { detect_corruption(get_gzip_format()); }
 
+// The input spans two parallel blocks, so the second is primed with the
+// first's tail and the CRCs are combined
+void test_gzip_parallel_round_trip(void) {
+  const StandaloneFormat *fmt = get_gzip_format();
+  TEST_ASSERT_NOT_NULL(fmt->compress_file_mt);
+  TEST_ASSERT_EQUAL_INT(
+      0, fmt->compress_file_mt(TEST_INPUT, "tmp_gzip_mt.gz", 6, 4));
+  TEST_ASSERT_EQUAL_INT(0, fmt->decompress_file("tmp_gzip_mt.gz",
+                                                "tmp_gzip_mt.out"));
+  TEST_ASSERT_TRUE(files_equal(TEST_INPUT, "tmp_gzip_mt.out"));
+
+  // Still a single member: the trailer holds the whole input's CRC
+  FILE *f = fopen("tmp_gzip_mt.gz", "rb");
+  TEST_ASSERT_NOT_NULL(f);
+  fseek(f, -8, SEEK_END);
+  unsigned char trailer[8];
+  TEST_ASSERT_EQUAL_size_t(8, fread(trailer, 1, 8, f));
+  fclose(f);
+
+  FILE *in = fopen(TEST_INPUT, "rb");
+  TEST_ASSERT_NOT_NULL(in);
+  static unsigned char data[1 << 20];
+  size_t size = fread(data, 1, sizeof(data), in);
+  fclose(in);
+  uint32_t crc = (uint32_t)trailer[0] | (uint32_t)trailer[1] << 8 |
+                 (uint32_t)trailer[2] << 16 | (uint32_t)trailer[3] << 24;
+  TEST_ASSERT_EQUAL_HEX32((uint32_t)crc32(0L, data, (uInt)size), crc);
+
+  remove("tmp_gzip_mt.gz");
+  remove("tmp_gzip_mt.out");
+}
+
+// gzip's CRC goes through crc32_fast; it must agree with zlib for every
+// length and alignment, chained or not
+void test_gzip_crc32_fast_matches_zlib(void) {
+  static unsigned char buf[4096 + 16];
+  for (size_t i = 0; i < sizeof(buf); i++)
+    buf[i] = (unsigned char)(i * 131 + (i >> 7));
+
+  for (size_t len = 0; len <= 4096; len += (len < 256 ? 1 : 61)) {
+    for (size_t off = 0; off < 4; off++) {
+      uint32_t expected = (uint32_t)crc32(0L, buf + off, (uInt)len);
+      TEST_ASSERT_EQUAL_HEX32(expected, crc32_fast(0, buf + off, len));
+      TEST_ASSERT_EQUAL_HEX32((uint32_t)crc32(expected, buf, (uInt)len),
+                              crc32_fast(expected, buf, len));
+    }
+  }
+}
+
 // ---- bzip2 ----
 
 void test_bzip2_descriptor(void) {
@@ -181,6 +239,31 @@ void test_xz_is_format(void) {
 void test_xz_round_trip(void) { round_trip(get_xz_format()); }
 void test_xz_detect_corruption(void) { detect_corruption(get_xz_format()); }
 
+// The threaded writer's output reads back through the single-threaded
+// decoder, and through the threaded one where the format has it
+static void parallel_round_trip(const StandaloneFormat *fmt) {
+  TEST_ASSERT_NOT_NULL(fmt->compress_file_mt);
+  TEST_ASSERT_EQUAL_INT(0,
+                        fmt->compress_file_mt(TEST_INPUT, "tmp_mt.comp", 6, 4));
+  TEST_ASSERT_EQUAL_INT(0, fmt->decompress_file("tmp_mt.comp", "tmp_mt.out"));
+  TEST_ASSERT_TRUE(files_equal(TEST_INPUT, "tmp_mt.out"));
+
+  if (fmt->decompress_file_mt) {
+    remove("tmp_mt.out");
+    TEST_ASSERT_EQUAL_INT(
+        0, fmt->decompress_file_mt("tmp_mt.comp", "tmp_mt.out", 4));
+    TEST_ASSERT_TRUE(files_equal(TEST_INPUT, "tmp_mt.out"));
+  }
+
+  remove("tmp_mt.comp");
+  remove("tmp_mt.out");
+}
+
+void test_xz_parallel_round_trip(void) {
+  TEST_ASSERT_NOT_NULL(get_xz_format()->decompress_file_mt);
+  parallel_round_trip(get_xz_format());
+}
+
 // ---- zstd ----
 
 void test_zstd_descriptor(void) {
@@ -202,6 +285,10 @@ void test_zstd_is_format(void) {
 void test_zstd_round_trip(void) { round_trip(get_zstd_format()); }
 void test_zstd_detect_corruption(void) { detect_corruption(get_zstd_format()); }
 
+void test_zstd_parallel_round_trip(void) {
+  parallel_round_trip(get_zstd_format());
+}
+
 // ---- lz4 ----
 
 void test_lz4_descriptor(void) {
@@ -223,6 +310,404 @@ void test_lz4_is_format(void) {
 void test_lz4_round_trip(void) { round_trip(get_lz4_format()); }
 void test_lz4_detect_corruption(void) { detect_corruption(get_lz4_format()); }
 
+// ---- Multi-frame files ----
+
+// Frames of independently compressed pieces, as pzstd, bgzip and
+// `lz4 --content-size` write them. The data is mostly noise so the file
+// is big enough to be decoded frame by frame.
+
+#define FRAMES_DATA_SIZE (3U << 20)
+#define FRAMES_PIECE (256U << 10)
+
+typedef size_t (*PieceEncoder)(const unsigned char *in, size_t size,
+                               unsigned char *out, size_t capacity);
+
+static size_t encode_gzip_piece(const unsigned char *in, size_t size,
+                                unsigned char *out, size_t capacity) {
+  z_stream strm;
+  memset(&strm, 0, sizeof(strm));
+  if (deflateInit2(&strm, 1, Z_DEFLATED, 16 + MAX_WBITS, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    return 0;
+  strm.next_in = (Bytef *)in;
+  strm.avail_in = (uInt)size;
+  strm.next_out = out;
+  strm.avail_out = (uInt)capacity;
+  int ret = deflate(&strm, Z_FINISH);
+  size_t n = capacity - strm.avail_out;
+  deflateEnd(&strm);
+  return ret == Z_STREAM_END ? n : 0;
+}
+
+static size_t encode_zstd_piece(const unsigned char *in, size_t size,
+                                unsigned char *out, size_t capacity) {
+  // One-shot frames record their size; the checksum catches damage in
+  // blocks stored raw
+  ZSTD_CCtx *cctx = ZSTD_createCCtx();
+  if (!cctx)
+    return 0;
+  ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+  size_t n = ZSTD_compress2(cctx, out, capacity, in, size);
+  ZSTD_freeCCtx(cctx);
+  return ZSTD_isError(n) ? 0 : n;
+}
+
+static size_t encode_lz4_piece(const unsigned char *in, size_t size,
+                               unsigned char *out, size_t capacity) {
+  LZ4F_preferences_t prefs;
+  memset(&prefs, 0, sizeof(prefs));
+  prefs.frameInfo.contentSize = size;
+  prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+  size_t n = LZ4F_compressFrame(out, capacity, in, size, &prefs);
+  return LZ4F_isError(n) ? 0 : n;
+}
+
+// Write the data to data_path and its frames to comp_path, then tail_size
+// bytes of tail after them
+static void write_frames(PieceEncoder encode, const char *data_path,
+                         const char *comp_path, const unsigned char *tail,
+                         size_t tail_size) {
+  unsigned char *data = malloc(FRAMES_DATA_SIZE);
+  size_t capacity = FRAMES_PIECE * 2;
+  unsigned char *piece = malloc(capacity);
+  TEST_ASSERT_NOT_NULL(data);
+  TEST_ASSERT_NOT_NULL(piece);
+  uint32_t x = 12345;
+  for (size_t i = 0; i < FRAMES_DATA_SIZE; i++) {
+    x = x * 1103515245U + 12345U;
+    data[i] = (i & 1024) ? (unsigned char)(x >> 24) : (unsigned char)'a';
+  }
+
+  FILE *f = fopen(data_path, "wb");
+  TEST_ASSERT_NOT_NULL(f);
+  TEST_ASSERT_EQUAL_size_t(FRAMES_DATA_SIZE,
+                           fwrite(data, 1, FRAMES_DATA_SIZE, f));
+  fclose(f);
+
+  f = fopen(comp_path, "wb");
+  TEST_ASSERT_NOT_NULL(f);
+  for (size_t pos = 0; pos < FRAMES_DATA_SIZE; pos += FRAMES_PIECE) {
+    size_t n = encode(data + pos, FRAMES_PIECE, piece, capacity);
+    TEST_ASSERT_TRUE(n > 0);
+    TEST_ASSERT_EQUAL_size_t(n, fwrite(piece, 1, n, f));
+  }
+  if (tail_size)
+    fwrite(tail, 1, tail_size, f);
+  fclose(f);
+  free(piece);
+  free(data);
+}
+
+// Every frame decodes, serially and on workers, into the whole input
+static void multi_frame_round_trip(const StandaloneFormat *fmt,
+                                   PieceEncoder encode) {
+  TEST_ASSERT_NOT_NULL(fmt->decompress_file_mt);
+  write_frames(encode, "tmp_frames.bin", "tmp_frames.comp", NULL, 0);
+
+  TEST_ASSERT_EQUAL_INT(
+      0, fmt->decompress_file("tmp_frames.comp", "tmp_frames.out"));
+  TEST_ASSERT_TRUE(files_equal("tmp_frames.bin", "tmp_frames.out"));
+  remove("tmp_frames.out");
+  TEST_ASSERT_EQUAL_INT(
+      0, fmt->decompress_file_mt("tmp_frames.comp", "tmp_frames.out", 4));
+  TEST_ASSERT_TRUE(files_equal("tmp_frames.bin", "tmp_frames.out"));
+
+  remove("tmp_frames.bin");
+  remove("tmp_frames.comp");
+  remove("tmp_frames.out");
+}
+
+void test_gzip_multi_member_round_trip(void) {
+  multi_frame_round_trip(get_gzip_format(), encode_gzip_piece);
+}
+
+void test_zstd_multi_frame_round_trip(void) {
+  multi_frame_round_trip(get_zstd_format(), encode_zstd_piece);
+}
+
+void test_lz4_multi_frame_round_trip(void) {
+  multi_frame_round_trip(get_lz4_format(), encode_lz4_piece);
+}
+
+// Padding after the last member is skipped as before, whether or not the
+// file went to the workers first
+void test_gzip_multi_member_trailing_zeros(void) {
+  const StandaloneFormat *fmt = get_gzip_format();
+  static const unsigned char zeros[512];
+  write_frames(encode_gzip_piece, "tmp_frames.bin", "tmp_frames.comp", zeros,
+               sizeof(zeros));
+
+  TEST_ASSERT_EQUAL_INT(
+      0, fmt->decompress_file_mt("tmp_frames.comp", "tmp_frames.out", 4));
+  TEST_ASSERT_TRUE(files_equal("tmp_frames.bin", "tmp_frames.out"));
+
+  remove("tmp_frames.bin");
+  remove("tmp_frames.comp");
+  remove("tmp_frames.out");
+}
+
+// A damaged frame fails the call the way the serial decoder reports it
+void test_zstd_multi_frame_detect_corruption(void) {
+  const StandaloneFormat *fmt = get_zstd_format();
+  write_frames(encode_zstd_piece, "tmp_frames.bin", "tmp_frames.comp", NULL,
+               0);
+  FILE *f = fopen("tmp_frames.comp", "rb+");
+  TEST_ASSERT_NOT_NULL(f);
+  fseek(f, 0, SEEK_END);
+  long pos = ftell(f) / 2;
+  fseek(f, pos, SEEK_SET);
+  int c = fgetc(f);
+  fseek(f, pos, SEEK_SET);
+  fputc(c ^ 0xFF, f);
+  fclose(f);
+
+  TEST_ASSERT_EQUAL_INT(
+      -1, fmt->decompress_file_mt("tmp_frames.comp", "tmp_frames.out", 4));
+  PyErr_Clear();
+
+  remove("tmp_frames.bin");
+  remove("tmp_frames.comp");
+  remove("tmp_frames.out");
+}
+
+// ---- I/O chunk size ----
+
+void test_io_chunk_size_is_clamped_and_restorable(void) {
+  TEST_ASSERT_EQUAL_UINT(IO_CHUNK_DEFAULT, io_chunk_size());
+
+  size_t prev = io_set_chunk_size(1);
+  TEST_ASSERT_EQUAL_UINT(IO_CHUNK_DEFAULT, prev);
+  TEST_ASSERT_EQUAL_UINT(IO_CHUNK_MIN, io_chunk_size());
+
+  io_set_chunk_size((size_t)1 << 40);
+  TEST_ASSERT_EQUAL_UINT(IO_CHUNK_MAX, io_chunk_size());
+
+  io_set_chunk_size(0);
+  TEST_ASSERT_EQUAL_UINT(IO_CHUNK_DEFAULT, io_chunk_size());
+}
+
+void test_round_trip_with_largest_chunks(void) {
+  size_t prev = io_set_chunk_size(IO_CHUNK_MAX);
+  round_trip(get_gzip_format());
+  round_trip(get_bzip2_format());
+  round_trip(get_xz_format());
+  round_trip(get_zstd_format());
+  round_trip(get_lz4_format());
+  io_set_chunk_size(prev);
+}
+
+// Copy TEST_INPUT through an IOReader/IOWriter pair on the given engine
+static void copy_through_streams(IOEngine engine) {
+  IOEngine prev = io_set_engine(engine);
+  FILE *in = fopen(TEST_INPUT, "rb");
+  FILE *out = fopen("tmp_io_copy.out", "w+b");
+  TEST_ASSERT_NOT_NULL(in);
+  TEST_ASSERT_NOT_NULL(out);
+
+  IOReader *reader = io_reader_open(in);
+  IOWriter *writer = io_writer_open(out);
+  TEST_ASSERT_NOT_NULL(reader);
+  TEST_ASSERT_NOT_NULL(writer);
+
+  int at_end = 0;
+  while (!at_end) {
+    const unsigned char *data;
+    size_t size;
+    TEST_ASSERT_EQUAL_INT(0, io_reader_next(reader, &data, &size, &at_end));
+    // Split each chunk so writes land at offsets that are not chunk-aligned
+    for (size_t done = 0; done < size;) {
+      size_t capacity;
+      unsigned char *buf = io_writer_buffer(writer, &capacity);
+      TEST_ASSERT_NOT_NULL(buf);
+      size_t n = size - done < 1000 ? size - done : 1000;
+      memcpy(buf, data + done, n);
+      TEST_ASSERT_EQUAL_INT(0, io_writer_commit(writer, n));
+      done += n;
+    }
+  }
+  io_reader_close(reader);
+  TEST_ASSERT_EQUAL_INT(0, io_writer_close(writer));
+
+  // Both FILEs pick up where the streams stopped
+  TEST_ASSERT_EQUAL_INT(EOF, fgetc(in));
+  TEST_ASSERT_NOT_EQUAL(EOF, fputc('!', out));
+  fclose(in);
+  fclose(out);
+  io_set_engine(prev);
+
+  FILE *f = fopen("tmp_io_copy.out", "r+b");
+  TEST_ASSERT_NOT_NULL(f);
+  fseek(f, -1, SEEK_END);
+  TEST_ASSERT_EQUAL_INT('!', fgetc(f));
+  long size = ftell(f);
+  TEST_ASSERT_EQUAL_INT(0, ftruncate(fileno(f), size - 1));
+  fclose(f);
+  TEST_ASSERT_TRUE(files_equal(TEST_INPUT, "tmp_io_copy.out"));
+  remove("tmp_io_copy.out");
+}
+
+void test_io_streams_copy_on_stdio(void) {
+  copy_through_streams(IO_ENGINE_STDIO);
+}
+
+// Falls back to stdio when the kernel has no io_uring, so passes regardless
+void test_io_streams_copy_on_uring(void) {
+  copy_through_streams(IO_ENGINE_URING);
+}
+
+void test_io_streams_copy_on_threads(void) {
+  copy_through_streams(IO_ENGINE_THREADS);
+}
+
+// ---- progress ----
+
+static unsigned progress_calls;
+static uint64_t progress_last;
+
+static void count_progress(IOProgress *progress, uint64_t done) {
+  (void)progress;
+  progress_calls++;
+  progress_last = done;
+}
+
+void test_progress_counts_every_input_byte(void) {
+  FILE *f = fopen(TEST_INPUT, "rb");
+  TEST_ASSERT_NOT_NULL(f);
+  fseek(f, 0, SEEK_END);
+  uint64_t input_size = (uint64_t)ftell(f);
+  fclose(f);
+
+  const StandaloneFormat *formats[] = {get_gzip_format(), get_bzip2_format(),
+                                       get_xz_format(), get_zstd_format(),
+                                       get_lz4_format()};
+  for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+    IOProgress progress = {0};
+    progress.notify = count_progress;
+    progress_calls = 0;
+
+    IOProgress *prev = io_set_progress(&progress);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(
+        0, formats[i]->compress_file(TEST_INPUT, "tmp_progress.out", 1),
+        formats[i]->name);
+    io_set_progress(prev);
+
+    TEST_ASSERT_EQUAL_UINT64_MESSAGE(input_size, io_progress_done(&progress),
+                                     formats[i]->name);
+    TEST_ASSERT_TRUE(progress_calls > 0);
+    TEST_ASSERT_EQUAL_UINT64(input_size, progress_last);
+  }
+  remove("tmp_progress.out");
+}
+
+// ---- cancellation ----
+
+void test_cancel_state_reports_request_and_deadline(void) {
+  TEST_ASSERT_EQUAL_INT(IO_CANCEL_NONE, io_cancel_state(NULL));
+
+  IOCancel cancel = {0};
+  TEST_ASSERT_EQUAL_INT(IO_CANCEL_NONE, io_cancel_state(&cancel));
+  cancel.deadline_ns = io_monotonic_ns() + 3600ULL * 1000000000ULL;
+  TEST_ASSERT_EQUAL_INT(IO_CANCEL_NONE, io_cancel_state(&cancel));
+  cancel.deadline_ns = io_monotonic_ns();
+  TEST_ASSERT_EQUAL_INT(IO_CANCEL_DEADLINE, io_cancel_state(&cancel));
+  io_cancel_request(&cancel);
+  TEST_ASSERT_EQUAL_INT(IO_CANCEL_REQUESTED, io_cancel_state(&cancel));
+
+  IOCancel *prev = io_set_cancel(&cancel);
+  TEST_ASSERT_EQUAL_INT(IO_CANCEL_REQUESTED, io_cancelled());
+  TEST_ASSERT_EQUAL_PTR(&cancel, io_set_cancel(prev));
+}
+
+// The reader stops handing out data as soon as the token trips
+void test_cancel_stops_reader(void) {
+  IOCancel cancel = {0};
+  IOCancel *prev = io_set_cancel(&cancel);
+  FILE *f = fopen(TEST_INPUT, "rb");
+  TEST_ASSERT_NOT_NULL(f);
+  IOReader *reader = io_reader_open(f);
+  io_set_cancel(prev); // the stream keeps the token it opened with
+  TEST_ASSERT_NOT_NULL(reader);
+
+  const unsigned char *data;
+  size_t size;
+  int at_end;
+  TEST_ASSERT_EQUAL_INT(0, io_reader_next(reader, &data, &size, &at_end));
+  TEST_ASSERT_TRUE(size > 0);
+  io_cancel_request(&cancel);
+  TEST_ASSERT_EQUAL_INT(-1, io_reader_next(reader, &data, &size, &at_end));
+  io_reader_close(reader);
+  fclose(f);
+}
+
+void test_cancel_fails_every_format(void) {
+  const StandaloneFormat *formats[] = {get_gzip_format(), get_bzip2_format(),
+                                       get_xz_format(), get_zstd_format(),
+                                       get_lz4_format()};
+  IOCancel cancel = {0};
+  cancel.deadline_ns = io_monotonic_ns(); // already past
+  for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+    IOCancel *prev = io_set_cancel(&cancel);
+    int rc = formats[i]->compress_file(TEST_INPUT, "tmp_cancel.out", 1);
+    io_set_cancel(prev);
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0, rc, formats[i]->name);
+    PyErr_Clear();
+  }
+  remove("tmp_cancel.out");
+}
+
+// ---- sparse files ----
+
+// Zero grains are seeked over, and the file still reads back byte for byte
+void test_sparse_writes_round_trip(void) {
+  size_t size = 8 * IO_SPARSE_GRAIN + 100;
+  unsigned char *data = calloc(1, size);
+  TEST_ASSERT_NOT_NULL(data);
+  memset(data + 10, 'a', 100);                     // inside the first grain
+  memset(data + 3 * IO_SPARSE_GRAIN + 5, 'b', 50); // between zero runs
+  TEST_ASSERT_FALSE(io_is_zero(data, IO_SPARSE_GRAIN));
+  TEST_ASSERT_TRUE(io_is_zero(data + IO_SPARSE_GRAIN, IO_SPARSE_GRAIN));
+
+  FILE *f = fopen("tmp_sparse.out", "w+b");
+  TEST_ASSERT_NOT_NULL(f);
+  TEST_ASSERT_EQUAL_INT(0, io_write_sparse(f, data, 7)); // off the grid
+  TEST_ASSERT_EQUAL_INT(0, io_write_sparse(f, data + 7, size - 7 - 100));
+  TEST_ASSERT_EQUAL_INT(0, io_write_hole(f, 100)); // a trailing hole
+  TEST_ASSERT_EQUAL_INT(0, io_sparse_finish(f));
+  TEST_ASSERT_EQUAL_INT(0, fseek(f, 0, SEEK_END));
+  TEST_ASSERT_EQUAL_INT((long)size, ftell(f));
+
+  unsigned char *back = malloc(size);
+  TEST_ASSERT_NOT_NULL(back);
+  rewind(f);
+  TEST_ASSERT_EQUAL_size_t(size, fread(back, 1, size, f));
+  TEST_ASSERT_EQUAL_MEMORY(data, back, size);
+  fclose(f);
+
+  free(back);
+  free(data);
+  remove("tmp_sparse.out");
+}
+
+void test_holes_are_found_without_reading(void) {
+  FILE *f = fopen("tmp_holes.out", "w+b");
+  TEST_ASSERT_NOT_NULL(f);
+  uint64_t size = 4ULL * 1024 * 1024;
+  TEST_ASSERT_EQUAL_INT(0, ftruncate(fileno(f), (off_t)size));
+  TEST_ASSERT_EQUAL_INT(0, fseek(f, 1024 * 1024, SEEK_SET));
+  TEST_ASSERT_NOT_EQUAL(EOF, fputc('x', f));
+  TEST_ASSERT_EQUAL_INT(0, fflush(f));
+  long pos = ftell(f);
+
+  uint64_t data = io_next_data(f, 0, size);
+  uint64_t hole = io_next_hole(f, data, size);
+  TEST_ASSERT_TRUE(data <= 1024 * 1024);        // exactly there with holes
+  TEST_ASSERT_TRUE(hole > 1024 * 1024);         // the data block ends
+  TEST_ASSERT_EQUAL_UINT64(size, io_next_hole(f, size, size));
+  TEST_ASSERT_EQUAL_INT(pos, ftell(f)); // the stdio position is left alone
+  fclose(f);
+  remove("tmp_holes.out");
+}
+
 // ---- registry ----
 
 void test_registry_resolves_all_standalone_formats(void) {
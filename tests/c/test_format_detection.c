@@ -1,5 +1,9 @@
+// fileno under the harness's -std=c11
+#define _POSIX_C_SOURCE 200809L
+
 #include "unity.h"
 #include "../../src/compresso/csrc/archives.h"
+#include <stdio.h>
 #include <string.h>
 
 // Forward declaration of the function we're testing
@@ -53,6 +57,12 @@ void test_detect_7z_format(void) {
     TEST_ASSERT_EQUAL(FORMAT_7Z, detect_format_from_magic_bytes(sz_magic, 6));
 }
 
+void test_detect_cdar_format(void) {
+    unsigned char cdar_magic[] = {'C', 'D', 'A', 'R', 0x01, 0x04};
+    TEST_ASSERT_EQUAL(FORMAT_CDAR, detect_format_from_magic_bytes(cdar_magic, 6));
+    TEST_ASSERT_TRUE(format_is_archive(FORMAT_CDAR));
+}
+
 void test_detect_with_insufficient_data(void) {
     unsigned char small_buffer[] = {0x1f};
     TEST_ASSERT_EQUAL(FORMAT_UNKNOWN, detect_format_from_magic_bytes(small_buffer, 1));
@@ -71,3 +81,36 @@ void test_detect_unknown_format(void) {
     unsigned char unknown[] = {0xff, 0xff, 0xff, 0xff};
     TEST_ASSERT_EQUAL(FORMAT_UNKNOWN, detect_format_from_magic_bytes(unknown, 4));
 }
+
+void test_format_from_name_and_aliases(void) {
+    TEST_ASSERT_EQUAL(FORMAT_COMPRESSO, format_from_name("compresso"));
+    TEST_ASSERT_EQUAL(FORMAT_GZIP, format_from_name("gzip"));
+    TEST_ASSERT_EQUAL(FORMAT_GZIP, format_from_name("gz"));
+    TEST_ASSERT_EQUAL(FORMAT_BZIP2, format_from_name("bz2"));
+    TEST_ASSERT_EQUAL(FORMAT_XZ, format_from_name("lzma"));
+    TEST_ASSERT_EQUAL(FORMAT_ZSTD, format_from_name("zst"));
+    TEST_ASSERT_EQUAL(FORMAT_TAR, format_from_name("tar"));
+    TEST_ASSERT_EQUAL(FORMAT_UNKNOWN, format_from_name("tarball"));
+    TEST_ASSERT_EQUAL(FORMAT_UNKNOWN, format_from_name(""));
+    TEST_ASSERT_EQUAL(FORMAT_UNKNOWN, format_from_name(NULL));
+}
+
+void test_detect_format_from_fd_keeps_offset(void) {
+    FILE *f = tmpfile();
+    TEST_ASSERT_NOT_NULL(f);
+    const unsigned char zstd_magic[] = {0x28, 0xb5, 0x2f, 0xfd, 0x00, 0x00};
+    TEST_ASSERT_EQUAL(sizeof(zstd_magic),
+                      fwrite(zstd_magic, 1, sizeof(zstd_magic), f));
+    fflush(f);
+
+    TEST_ASSERT_EQUAL(FORMAT_ZSTD, detect_format_from_fd(fileno(f)));
+    TEST_ASSERT_EQUAL(sizeof(zstd_magic), ftell(f)); // still at the end
+    fclose(f);
+}
+
+void test_detect_format_from_head_finds_tar(void) {
+    unsigned char head[FORMAT_HEAD_SIZE] = {0};
+    memcpy(head + 257, "ustar", 5);
+    TEST_ASSERT_EQUAL(FORMAT_TAR, detect_format_from_head(head, sizeof(head)));
+    TEST_ASSERT_EQUAL(FORMAT_UNKNOWN, detect_format_from_head(head, 200));
+}
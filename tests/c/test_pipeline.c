@@ -32,6 +32,14 @@ void test_name_zip(void) {
     TEST_ASSERT_EQUAL(FORMAT_UNKNOWN, p.codec);
 }
 
+void test_name_cdar_with_chunk_codec(void) {
+    CompressionPipeline p = pipeline_from_name("cdar.lz4", -1);
+    TEST_ASSERT_EQUAL(ARCHIVE_CDAR, p.archive);
+    TEST_ASSERT_EQUAL(FORMAT_LZ4, p.codec);
+    TEST_ASSERT_NULL(p.base);
+    TEST_ASSERT_TRUE(pipeline_is_valid(&p));
+}
+
 void test_name_standalone_codec(void) {
     CompressionPipeline p = pipeline_from_name("gzip", -1);
     TEST_ASSERT_EQUAL(ARCHIVE_NONE, p.archive);
@@ -56,21 +64,30 @@ void test_archive_id_from_format(void) {
 // ---- pipeline_display_name ----
 
 void test_display_name_combined(void) {
-    CompressionPipeline p = {ARCHIVE_TAR, FORMAT_GZIP, -1};
+    CompressionPipeline p = {.archive = ARCHIVE_TAR,
+                             .codec = FORMAT_GZIP,
+                             .compression_level = -1,
+                             .threads = 1};
     char buf[32];
     pipeline_display_name(&p, buf, sizeof(buf));
     TEST_ASSERT_EQUAL_STRING("tar.gz", buf);
 }
 
 void test_display_name_plain_tar(void) {
-    CompressionPipeline p = {ARCHIVE_TAR, FORMAT_UNKNOWN, -1};
+    CompressionPipeline p = {.archive = ARCHIVE_TAR,
+                             .codec = FORMAT_UNKNOWN,
+                             .compression_level = -1,
+                             .threads = 1};
     char buf[32];
     pipeline_display_name(&p, buf, sizeof(buf));
     TEST_ASSERT_EQUAL_STRING("tar", buf);
 }
 
 void test_display_name_standalone(void) {
-    CompressionPipeline p = {ARCHIVE_NONE, FORMAT_ZSTD, -1};
+    CompressionPipeline p = {.archive = ARCHIVE_NONE,
+                             .codec = FORMAT_ZSTD,
+                             .compression_level = -1,
+                             .threads = 1};
     char buf[32];
     pipeline_display_name(&p, buf, sizeof(buf));
     TEST_ASSERT_EQUAL_STRING("zstd", buf);
@@ -91,39 +108,60 @@ void test_name_roundtrip(void) {
 // ---- pipeline_is_valid ----
 
 void test_valid_tar_with_codec(void) {
-    CompressionPipeline p = {ARCHIVE_TAR, FORMAT_GZIP, -1};
+    CompressionPipeline p = {.archive = ARCHIVE_TAR,
+                             .codec = FORMAT_GZIP,
+                             .compression_level = -1,
+                             .threads = 1};
     TEST_ASSERT_TRUE(pipeline_is_valid(&p));
 }
 
 void test_valid_plain_tar(void) {
-    CompressionPipeline p = {ARCHIVE_TAR, FORMAT_UNKNOWN, -1};
+    CompressionPipeline p = {.archive = ARCHIVE_TAR,
+                             .codec = FORMAT_UNKNOWN,
+                             .compression_level = -1,
+                             .threads = 1};
     TEST_ASSERT_TRUE(pipeline_is_valid(&p));
 }
 
 void test_valid_zip(void) {
-    CompressionPipeline p = {ARCHIVE_ZIP, FORMAT_UNKNOWN, -1};
+    CompressionPipeline p = {.archive = ARCHIVE_ZIP,
+                             .codec = FORMAT_UNKNOWN,
+                             .compression_level = -1,
+                             .threads = 1};
     TEST_ASSERT_TRUE(pipeline_is_valid(&p));
 }
 
 void test_valid_standalone_codec(void) {
-    CompressionPipeline p = {ARCHIVE_NONE, FORMAT_ZSTD, -1};
+    CompressionPipeline p = {.archive = ARCHIVE_NONE,
+                             .codec = FORMAT_ZSTD,
+                             .compression_level = -1,
+                             .threads = 1};
     TEST_ASSERT_TRUE(pipeline_is_valid(&p));
 }
 
 void test_invalid_empty_pipeline(void) {
-    CompressionPipeline p = {ARCHIVE_NONE, FORMAT_UNKNOWN, -1};
+    CompressionPipeline p = {.archive = ARCHIVE_NONE,
+                             .codec = FORMAT_UNKNOWN,
+                             .compression_level = -1,
+                             .threads = 1};
     TEST_ASSERT_FALSE(pipeline_is_valid(&p));
 }
 
 void test_invalid_zip_with_codec(void) {
     // ZIP compresses internally; an external codec stage is not allowed.
-    CompressionPipeline p = {ARCHIVE_ZIP, FORMAT_GZIP, -1};
+    CompressionPipeline p = {.archive = ARCHIVE_ZIP,
+                             .codec = FORMAT_GZIP,
+                             .compression_level = -1,
+                             .threads = 1};
     TEST_ASSERT_FALSE(pipeline_is_valid(&p));
 }
 
 void test_invalid_unresolvable_codec(void) {
     // FORMAT_ZIP is not a standalone codec, so it cannot be a codec stage.
-    CompressionPipeline p = {ARCHIVE_TAR, FORMAT_ZIP, -1};
+    CompressionPipeline p = {.archive = ARCHIVE_TAR,
+                             .codec = FORMAT_ZIP,
+                             .compression_level = -1,
+                             .threads = 1};
     TEST_ASSERT_FALSE(pipeline_is_valid(&p));
 }
 
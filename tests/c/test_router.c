@@ -8,6 +8,10 @@ const CBackend *find_backend_by_name(const char *name);
 const CBackend *find_backend_by_id(uint8_t id);
 
 void setUp(void) {
+    // choose_block_backend runs backends, whose GIL helpers need Python
+    if (!Py_IsInitialized()) {
+        Py_Initialize();
+    }
 }
 
 void tearDown(void) {
@@ -65,6 +69,28 @@ void test_find_backend_by_name_null(void) {
     TEST_ASSERT_NULL(backend);
 }
 
+void test_find_backend_by_name_matches_every_registered_backend(void) {
+    for (uint8_t id = 0; id <= ALGO_SNAPPY; id++) {
+        const CBackend *backend = find_backend_by_id(id);
+        if (backend)
+            TEST_ASSERT_EQUAL_PTR(backend, find_backend_by_name(backend->name));
+    }
+    TEST_ASSERT_NULL(find_backend_by_name(""));
+    TEST_ASSERT_NULL(find_backend_by_name("zlib "));
+}
+
+void test_algo_from_string(void) {
+    TEST_ASSERT_EQUAL(ALGO_ZLIB, algo_from_string("zlib"));
+    TEST_ASSERT_EQUAL(ALGO_BZIP2, algo_from_string("bzip2"));
+    TEST_ASSERT_EQUAL(ALGO_LZMA, algo_from_string("lzma"));
+    TEST_ASSERT_EQUAL(ALGO_ZSTD, algo_from_string("zstd"));
+    TEST_ASSERT_EQUAL(ALGO_LZ4, algo_from_string("lz4"));
+    TEST_ASSERT_EQUAL(ALGO_SNAPPY, algo_from_string("snappy"));
+    TEST_ASSERT_EQUAL(ALGO_NONE, algo_from_string(""));
+    TEST_ASSERT_EQUAL(ALGO_NONE, algo_from_string(NULL));
+    TEST_ASSERT_EQUAL(ALGO_NONE, algo_from_string("brotli"));
+}
+
 void test_find_backend_by_id_zlib(void) {
     const CBackend *backend = find_backend_by_id(ALGO_ZLIB);
     TEST_ASSERT_NOT_NULL(backend);
@@ -143,7 +169,121 @@ void test_strategy_from_string_max_ratio(void) {
     TEST_ASSERT_EQUAL(STRAT_MAX_RATIO, strat);
 }
 
+void test_strategy_from_string_auto(void) {
+    Strategy strat = strategy_from_string("auto");
+    TEST_ASSERT_EQUAL(STRAT_AUTO, strat);
+    TEST_ASSERT_EQUAL_PTR(choose_backend(STRAT_BALANCED), choose_backend(strat));
+}
+
+void test_choose_block_backend_stores_random_data(void) {
+    size_t size = 256 * 1024;
+    unsigned char *data = (unsigned char *)malloc(size);
+    TEST_ASSERT_NOT_NULL(data);
+    uint64_t x = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < size; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        data[i] = (unsigned char)(x >> 24);
+    }
+    TEST_ASSERT_NULL(choose_block_backend(data, size));
+    free(data);
+}
+
+void test_choose_block_backend_compresses_text(void) {
+    const char *line = "the quick brown fox jumps over the lazy dog\n";
+    size_t len = strlen(line);
+    size_t size = 1000 * len;
+    unsigned char *data = (unsigned char *)malloc(size);
+    TEST_ASSERT_NOT_NULL(data);
+    for (size_t i = 0; i < 1000; i++)
+        memcpy(data + i * len, line, len);
+    TEST_ASSERT_EQUAL_PTR(choose_backend(STRAT_BALANCED),
+                          choose_block_backend(data, size));
+    free(data);
+}
+
 void test_strategy_from_string_default(void) {
     Strategy strat = strategy_from_string("unknown");
     TEST_ASSERT_EQUAL(STRAT_BALANCED, strat);
 }
+
+void test_find_backend_by_id_stored(void) {
+    const CBackend *backend = find_backend_by_id(ALGO_NONE);
+    TEST_ASSERT_NOT_NULL(backend);
+    TEST_ASSERT_EQUAL_STRING("stored", backend->name);
+    TEST_ASSERT_EQUAL(1000, backend->max_compressed_size(1000));
+
+    const unsigned char input[] = "stored as-is";
+    unsigned char output[sizeof(input)];
+    size_t capacity = sizeof(output);
+    size_t output_size = 0;
+    TEST_ASSERT_EQUAL(0, backend->compress_buffer(input, sizeof(input), output,
+                                                  &capacity, -1, &output_size));
+    TEST_ASSERT_EQUAL(sizeof(input), output_size);
+    TEST_ASSERT_EQUAL_MEMORY(input, output, sizeof(input));
+}
+
+void test_parse_budget(void) {
+    Budget budget;
+    TEST_ASSERT_EQUAL(1, parse_budget("target_mb_s=500", &budget));
+    TEST_ASSERT_EQUAL(BUDGET_THROUGHPUT, budget.kind);
+    TEST_ASSERT_TRUE(budget.value == 500.0);
+
+    TEST_ASSERT_EQUAL(1, parse_budget("max_ratio_within=2s", &budget));
+    TEST_ASSERT_EQUAL(BUDGET_LATENCY, budget.kind);
+    TEST_ASSERT_TRUE(budget.value == 2.0);
+    TEST_ASSERT_EQUAL(1, parse_budget("max_ratio_within=250ms", &budget));
+    TEST_ASSERT_TRUE(budget.value == 0.25);
+
+    TEST_ASSERT_EQUAL(0, parse_budget("balanced", &budget));
+    TEST_ASSERT_EQUAL(0, parse_budget(NULL, &budget));
+    TEST_ASSERT_EQUAL(-1, parse_budget("target_mb_s=", &budget));
+    TEST_ASSERT_EQUAL(-1, parse_budget("target_mb_s=0", &budget));
+    TEST_ASSERT_EQUAL(-1, parse_budget("target_mb_s=5s", &budget));
+    TEST_ASSERT_EQUAL(-1, parse_budget("max_ratio_within=1h", &budget));
+}
+
+void test_choose_for_budget(void) {
+    const Calibration table[] = {
+        {ALGO_ZSTD, 9, 1, 5.0, 0.0, 0.25},
+        {ALGO_ZSTD, 3, 1, 300.0, 0.0, 0.33},
+        {ALGO_LZ4, 1, 1, 900.0, 0.0, 0.50},
+        {ALGO_ZSTD, 6, 4, 800.0, 0.0, 0.30},
+    };
+    TEST_ASSERT_EQUAL(0, set_calibration(table, 4));
+
+    Budget budget = {BUDGET_THROUGHPUT, 100.0};
+    Calibration choice;
+    uint64_t large = 64ULL * 1024 * 1024;
+    TEST_ASSERT_EQUAL(1, choose_for_budget(&budget, large, 1, &choice));
+    TEST_ASSERT_EQUAL(ALGO_ZSTD, choice.algo);
+    TEST_ASSERT_EQUAL(3, choice.level);
+
+    // Four threads on enough blocks: a better ratio at 800 MB/s
+    budget.value = 500.0;
+    TEST_ASSERT_EQUAL(1, choose_for_budget(&budget, large, 4, &choice));
+    TEST_ASSERT_EQUAL(6, choice.level);
+    TEST_ASSERT_EQUAL(4, choice.threads);
+    // One block: the threads would idle, so lz4 is the only fit
+    TEST_ASSERT_EQUAL(1, choose_for_budget(&budget, C_DEFAULT_BLOCK_SIZE, 4,
+                                           &choice));
+    TEST_ASSERT_EQUAL(ALGO_LZ4, choice.algo);
+
+    // 64 MiB within 20 s needs 3.2 MB/s; within 1 ms nothing fits
+    budget.kind = BUDGET_LATENCY;
+    budget.value = 20.0;
+    TEST_ASSERT_EQUAL(1, choose_for_budget(&budget, large, 1, &choice));
+    TEST_ASSERT_EQUAL(9, choice.level);
+    budget.value = 0.001;
+    TEST_ASSERT_EQUAL(0, choose_for_budget(&budget, large, 1, &choice));
+    TEST_ASSERT_EQUAL(ALGO_LZ4, choice.algo);
+
+    Calibration invalid = {ALGO_ZSTD, 3, 0, 300.0, 0.0, 0.33};
+    TEST_ASSERT_EQUAL(-1, set_calibration(&invalid, 1));
+    TEST_ASSERT_EQUAL(4, get_calibration(&choice, 1));
+
+    TEST_ASSERT_EQUAL(0, set_calibration(NULL, 0));
+    Calibration defaults[CALIBRATION_MAX];
+    TEST_ASSERT_TRUE(get_calibration(defaults, CALIBRATION_MAX) >= 6);
+}
@@ -73,6 +73,22 @@ def large_compressible_file(temp_dir: Path) -> Path:
     return file_path
 
 
+@pytest.fixture
+def multi_block_file(temp_dir: Path) -> Path:
+    """Create a file spanning several 4MB compression blocks.
+
+    Args:
+        temp_dir: Temporary directory fixture.
+
+    Returns:
+        Path to the multi-block file.
+    """
+    file_path = temp_dir / "multi_block.txt"
+    lines = b"".join(b"line %06d of the block test corpus\n" % i for i in range(1000))
+    file_path.write_bytes(lines * 300)  # ~10MB
+    return file_path
+
+
 @pytest.fixture
 def empty_file(temp_dir: Path) -> Path:
     """Create an empty file for edge case testing.
@@ -103,6 +119,38 @@ def small_file(temp_dir: Path) -> Path:
     return file_path
 
 
+@pytest.fixture(scope="session")
+def dictionary_samples() -> list[bytes]:
+    """Create many small, similar JSON records for dictionary training.
+
+    Returns:
+        List of encoded records.
+    """
+    return [
+        (
+            f'{{"id": {i}, "user": "user{i % 97}", "email": "user{i % 97}@example.com", '
+            f'"active": {str(i % 3 == 0).lower()}, "tags": ["alpha", "beta", "gamma"], '
+            f'"score": {i * 7 % 1000}}}'
+        ).encode()
+        for i in range(2000)
+    ]
+
+
+@pytest.fixture(scope="session")
+def trained_dictionary(dictionary_samples: list[bytes]):
+    """Train a small zstd dictionary from the dictionary samples.
+
+    Args:
+        dictionary_samples: Dictionary samples fixture.
+
+    Returns:
+        The trained compresso.Dictionary.
+    """
+    from compresso import train_dictionary
+
+    return train_dictionary(dictionary_samples, size=4096)
+
+
 @pytest.fixture(params=["zlib", "bzip2", "lzma", "zstd", "lz4", "snappy"])
 def compression_algo(request) -> str:
     """Parameterized fixture for all compression algorithms.
@@ -143,7 +191,7 @@ def compression_level(request) -> int:
 
 
 @pytest.fixture
-def mock_speeds_file(temp_dir: Path, monkeypatch) -> Path:
+def mock_speeds_file(temp_dir: Path, monkeypatch) -> Generator[Path, None, None]:
     """Mock the speeds file location for testing.
 
     Args:
@@ -162,5 +210,32 @@ def mock_speeds_file(temp_dir: Path, monkeypatch) -> Path:
 
     monkeypatch.setattr(speeds, "_CONFIG_DIR", config_dir)
     monkeypatch.setattr(speeds, "_SPEEDS_FILE", config_dir / "speeds.json")
+    monkeypatch.setattr(speeds, "_CALIBRATION_FILE", config_dir / "calibration.json")
+
+    yield speeds_file
+
+    # Pushed calibration is process-wide: back to the built-in estimates
+    from compresso._core import set_calibration
+
+    set_calibration([])
+
+
+@pytest.fixture
+def budget_calibration() -> Generator[list[dict], None, None]:
+    """Install a known calibration for budget strategies.
+
+    Yields:
+        The calibration entries; the built-in estimates return afterwards.
+    """
+    from compresso._core import set_calibration
+
+    entries = [
+        {"algo": "zstd", "level": 9, "comp_mb_s": 5.0, "ratio": 0.25},
+        {"algo": "zstd", "level": 3, "comp_mb_s": 300.0, "ratio": 0.33},
+        {"algo": "lz4", "level": 1, "comp_mb_s": 900.0, "ratio": 0.5},
+        {"algo": "zstd", "level": 6, "threads": 4, "comp_mb_s": 800.0, "ratio": 0.3},
+    ]
+    set_calibration(entries)
+    yield entries
+    set_calibration([])
 
-    return speeds_file
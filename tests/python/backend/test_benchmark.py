@@ -148,6 +148,69 @@ class TestBenchmarkFile:
         assert len(sig.parameters) > 0
 
 
+    def test_benchmark_file_times_in_memory(self, sample_text_file, temp_dir):
+        """Test that results come from the native engine, with no files left."""
+        before = set(temp_dir.iterdir())
+        results = benchmark_file(
+            sample_text_file,
+            algos=["zlib", "lz4"],
+            strategies=["balanced"],
+            levels=[None],
+            repeats=3,
+        )
+
+        assert [r.algo for r in results] == ["zlib", "lz4"]
+        for r in results:
+            assert r.input_size == sample_text_file.stat().st_size
+            assert 0 < r.compressed_size < r.input_size
+            assert r.compress_time == r.compress_stats["median"]
+            assert r.decompress_time == r.decompress_stats["median"]
+        assert set(temp_dir.iterdir()) == before
+
+
+class TestNativeBenchmark:
+    """Test the _core.benchmark engine."""
+
+    DATA = b"compresso benchmark data " * 4000
+
+    def test_reports_ordered_statistics(self):
+        """Test that the per-call statistics are consistent."""
+        from compresso._core import benchmark
+
+        run = benchmark(self.DATA, "zstd", repeats=7, warmup=2)
+
+        assert run["algo"] == "zstd"
+        assert run["input_size"] == len(self.DATA)
+        assert 0 < run["compressed_size"] < len(self.DATA)
+        assert (run["repeats"], run["warmup"], run["threads"]) == (7, 2, 1)
+        for direction in ("compress", "decompress"):
+            stats = run[direction]
+            assert 0 < stats["min"] <= stats["median"] <= stats["p99"]
+            assert stats["min"] <= stats["mean"] <= stats["p99"]
+            assert stats["user"] >= 0 and stats["system"] >= 0
+            assert stats["wall"] >= stats["min"]
+
+    def test_strategy_and_threads(self):
+        """Test that a strategy picks the backend and workers run side by side."""
+        from compresso._core import benchmark, get_default_backend_for_strategy
+
+        run = benchmark(self.DATA, strategy="fast", repeats=2, threads=3)
+
+        assert run["algo"] == get_default_backend_for_strategy("fast")
+        assert run["threads"] == 3
+
+    @pytest.mark.parametrize(
+        "kwargs",
+        [{"repeats": 0}, {"warmup": -1}, {"threads": -1}, {"algo": "nope"}],
+    )
+    def test_rejects_bad_arguments(self, kwargs):
+        """Test argument validation."""
+        from compresso._core import benchmark
+
+        with pytest.raises(ValueError):
+            benchmark(self.DATA, **kwargs)
+
+
 class TestPrintResults:
     """Test the print_results function."""
 
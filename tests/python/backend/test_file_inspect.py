@@ -6,6 +6,7 @@ from pathlib import Path
 from compresso.backend.file_inspect import (
     InspectResult,
     inspect,
+    verify,
     COMP_HEADER_STRUCT,
 )
 from compresso import compress_file
@@ -171,3 +172,177 @@ class TestInspect:
         assert result.level is None
         assert result.orig_size is None
         assert result.estimated_decomp_s is None
+
+    def test_inspect_seekable_reports_block_index(
+        self, multi_block_file: Path, temp_dir: Path
+    ):
+        """Test that inspecting a seekable file returns its block index."""
+        compressed_file = temp_dir / "seekable.comp"
+        compress_file(
+            str(multi_block_file),
+            str(compressed_file),
+            "zstd",
+            "balanced",
+            3,
+            seekable=True,
+            block_size=1 << 20,
+        )
+
+        result = inspect(compressed_file)
+        orig_size = multi_block_file.stat().st_size
+
+        assert result.header_ok is True
+        assert result.version == 2
+        assert result.block_size == 1 << 20
+        assert result.blocks is not None
+        assert len(result.blocks) == -(-orig_size // (1 << 20))
+        assert sum(block.raw_size for block in result.blocks) == orig_size
+        assert result.blocks[0].comp_offset == COMP_HEADER_STRUCT.size
+        assert all(block.algo_id is None for block in result.blocks)
+
+    def test_inspect_auto_file_reports_block_algorithms(self, temp_dir: Path):
+        """Test that "auto" files report each block's algorithm."""
+        import os
+
+        src = temp_dir / "mixed.bin"
+        src.write_bytes(os.urandom(65536) + b"abcd" * 16384)
+        compressed_file = temp_dir / "mixed.comp"
+        compress_file(str(src), str(compressed_file), "", "auto", 6, block_size=65536)
+
+        result = inspect(compressed_file)
+
+        assert result.header_ok is True
+        assert result.can_decompress is True
+        assert result.blocks is not None
+        assert result.blocks[0].algo_id == 0
+        assert result.blocks[0].comp_size == result.blocks[0].raw_size
+        assert result.blocks[1].algo_id not in (None, 0)
+
+    def test_inspect_stream_file_has_no_blocks(
+        self, sample_text_file: Path, temp_dir: Path
+    ):
+        """Test that version 1 files report no block index."""
+        compressed_file = temp_dir / "stream.comp"
+        compress_file(
+            str(sample_text_file), str(compressed_file), "zlib", "balanced", 6
+        )
+
+        result = inspect(compressed_file)
+
+        assert result.version == 1
+        assert result.blocks is None
+        assert result.block_size is None
+
+    def test_inspect_reports_checksum(self, sample_text_file: Path, temp_dir: Path):
+        """Test that a checksummed file reports its stored hash."""
+        compressed_file = temp_dir / "summed.comp"
+        compress_file(
+            str(sample_text_file),
+            str(compressed_file),
+            "zlib",
+            "balanced",
+            6,
+            checksum=True,
+        )
+
+        result = inspect(compressed_file)
+
+        assert result.header_ok
+        assert result.flags == 0x04
+        assert result.checksum == int.from_bytes(
+            compressed_file.read_bytes()[16:24], "little"
+        )
+
+    def test_inspect_reports_window_log(
+        self, sample_text_file: Path, temp_dir: Path
+    ):
+        """Test that a widened zstd window is reported from the header."""
+        compressed_file = temp_dir / "wide.comp"
+        compress_file(
+            str(sample_text_file),
+            str(compressed_file),
+            "zstd",
+            "balanced",
+            3,
+            window_log=28,
+        )
+
+        result = inspect(compressed_file)
+
+        assert result.header_ok
+        assert result.flags == 0x08
+        assert result.window_log == 28
+        assert result.checksum is None
+
+
+    def test_inspect_reports_holes(self, temp_dir: Path):
+        """Test that blocks of zeros are reported as holes."""
+        import os
+
+        src = temp_dir / "zeros.bin"
+        src.write_bytes(os.urandom(65536) + bytes(2 * 65536))
+        compressed_file = temp_dir / "zeros.comp"
+        compress_file(
+            str(src),
+            str(compressed_file),
+            "zlib",
+            "",
+            6,
+            seekable=True,
+            block_size=65536,
+        )
+
+        result = inspect(compressed_file)
+
+        assert result.header_ok
+        assert result.can_decompress
+        assert result.flags & 0x10
+        assert [block.is_hole for block in result.blocks] == [False, True, True]
+        assert result.blocks[1].raw_size == 65536
+
+
+class TestVerify:
+    """Test the verify function."""
+
+    def test_verify_intact_file(self, sample_text_file: Path, temp_dir: Path):
+        """Test that an intact file verifies."""
+        compressed_file = temp_dir / "ok.comp"
+        compress_file(
+            str(sample_text_file),
+            str(compressed_file),
+            "zlib",
+            "balanced",
+            6,
+            checksum=True,
+        )
+
+        result = verify(compressed_file)
+
+        assert result.ok
+        assert result.reason is None
+
+    def test_verify_corrupt_file(self, sample_text_file: Path, temp_dir: Path):
+        """Test that a damaged file fails with a reason."""
+        compressed_file = temp_dir / "bad.comp"
+        compress_file(
+            str(sample_text_file),
+            str(compressed_file),
+            "zlib",
+            "balanced",
+            6,
+            checksum=True,
+        )
+        data = bytearray(compressed_file.read_bytes())
+        data[20] ^= 0x01
+        compressed_file.write_bytes(bytes(data))
+
+        result = verify(compressed_file)
+
+        assert not result.ok
+        assert result.reason
+
+    def test_verify_non_compresso_file(self, sample_text_file: Path):
+        """Test that other files fail verification instead of raising."""
+        result = verify(sample_text_file)
+
+        assert not result.ok
@@ -4,8 +4,11 @@ import pytest
 from pathlib import Path
 import json
 
+from compresso._core import get_calibration
 from compresso.backend.speeds import (
     AlgoSpeeds,
+    load_calibration,
+    record_calibration,
     update_from_benchmarks,
 )
 
@@ -170,3 +173,74 @@ class TestSpeedsFilePersistence:
             assert isinstance(algo_data["comp_mb_s"], (int, float))
             assert isinstance(algo_data["decomp_mb_s"], (int, float))
             assert isinstance(algo_data["samples"], int)
+
+
+class TestCalibration:
+    """Test the per-level calibration behind budget strategies."""
+
+    def test_record_calibration_merges_and_pushes(self, mock_speeds_file: Path):
+        """Test that measurements merge per level and thread count."""
+        from compresso.backend.benchmark import BenchmarkResult
+
+        def result(compress_time: float, threads: int = 1) -> BenchmarkResult:
+            return BenchmarkResult(
+                algo="zstd",
+                strategy="balanced",
+                level=3,
+                compress_time=compress_time,
+                decompress_time=0.5,
+                input_size=1024 * 1024,
+                compressed_size=256 * 1024,
+                threads=threads,
+            )
+
+        record_calibration([result(0.01), result(0.02 / 3)])
+        record_calibration([result(0.01, threads=4)])
+
+        pushed = {(e["algo"], e["level"], e["threads"]): e for e in get_calibration()}
+        assert pushed[("zstd", 3, 1)]["comp_mb_s"] == pytest.approx(125.0)
+        assert pushed[("zstd", 3, 1)]["ratio"] == pytest.approx(0.25)
+        # Per-stream figures from four workers add up
+        assert pushed[("zstd", 3, 4)]["comp_mb_s"] == pytest.approx(400.0)
+
+        stored = json.loads(
+            (mock_speeds_file.parent / ".compresso" / "calibration.json").read_text()
+        )
+        assert {e["samples"] for e in stored} == {1, 2}
+
+    def test_record_calibration_from_suite_report(self, mock_speeds_file: Path):
+        """Test that only a suite report's backend results calibrate."""
+        common = {"level": 1, "threads": 1, "decomp_mb_s": 900.0}
+        results = [
+            {"kind": "backend", "target": "lz4", "comp_mb_s": 700.0, "ratio": 0.5},
+            {"kind": "standalone", "target": "gzip", "comp_mb_s": 90.0, "ratio": 0.4},
+        ]
+        results = [{**common, **r} for r in results]
+
+        record_calibration(results)
+
+        assert [(e["algo"], e["comp_mb_s"]) for e in get_calibration()] == [
+            ("lz4", 700.0)
+        ]
+
+    def test_load_calibration_from_speeds(self, mock_speeds_file: Path):
+        """Test that speeds.json alone gives one entry per algorithm."""
+        speeds_file = mock_speeds_file.parent / ".compresso" / "speeds.json"
+        speeds_file.write_text(
+            json.dumps({"zstd": {"comp_mb_s": 350.0, "decomp_mb_s": 1.0, "samples": 1}})
+        )
+
+        entries = load_calibration()
+
+        assert entries == get_calibration()
+        assert [(e["algo"], e["level"], e["comp_mb_s"]) for e in entries] == [
+            ("zstd", -1, 350.0)
+        ]
+
+    def test_load_calibration_without_files(self, mock_speeds_file: Path):
+        """Test that nothing is pushed without calibration files."""
+        before = get_calibration()
+
+        assert load_calibration() == []
+        assert get_calibration() == before
+
@@ -0,0 +1,135 @@
+"""Tests for the benchmark corpus suite."""
+
+import pytest
+
+from compresso.backend.suite import (
+    compare,
+    corpus_manifest,
+    corpus_mismatches,
+    generate_corpus,
+    load_corpus,
+    load_report,
+    run_suite,
+    save_report,
+)
+
+
+def _report(*results, corpus=None):
+    return {"results": list(results), "corpus": corpus or {}}
+
+
+def _result(key, comp=100.0, decomp=200.0, ratio=0.5):
+    return {"key": key, "comp_mb_s": comp, "decomp_mb_s": decomp, "ratio": ratio}
+
+
+class TestCorpus:
+    """Test corpus generation and loading."""
+
+    def test_generate_is_deterministic(self, tmp_path):
+        """The same seed produces byte-identical sets."""
+        first = generate_corpus(tmp_path / "a", size=32 * 1024, small_count=16)
+        second = generate_corpus(tmp_path / "b", size=32 * 1024, small_count=16)
+
+        assert corpus_manifest(first) == corpus_manifest(second)
+        assert "small" in first and first["small"].is_dir()
+        assert first["text"].stat().st_size == 32 * 1024
+
+    def test_seed_changes_contents(self, tmp_path):
+        """A different seed produces different data."""
+        first = generate_corpus(tmp_path / "a", size=8 * 1024, small_count=4)
+        second = generate_corpus(tmp_path / "b", size=8 * 1024, small_count=4, seed=7)
+
+        report = {"corpus": corpus_manifest(first)}
+        other = {"corpus": corpus_manifest(second)}
+        assert corpus_mismatches(report, other) == sorted(first)
+
+    def test_load_corpus(self, tmp_path):
+        """Files and directories of an existing corpus become its sets."""
+        (tmp_path / "dickens").write_bytes(b"It was the best of times" * 100)
+        (tmp_path / "objects").mkdir()
+        (tmp_path / "objects" / "one").write_bytes(b"x" * 10)
+
+        corpus = load_corpus(tmp_path)
+        assert sorted(corpus) == ["dickens", "objects"]
+
+    def test_load_missing_corpus(self, tmp_path):
+        """A missing corpus directory raises FileNotFoundError."""
+        with pytest.raises(FileNotFoundError):
+            load_corpus(tmp_path / "missing")
+
+
+class TestCompare:
+    """Test baseline comparison."""
+
+    def test_flags_throughput_drop(self):
+        """A throughput drop beyond the threshold is a regression."""
+        baseline = _report(_result("backend/zlib/text/L1/T1"))
+        current = _report(_result("backend/zlib/text/L1/T1", comp=80.0))
+
+        regressions = compare(current, baseline, threshold=0.10)
+        assert len(regressions) == 1
+        assert regressions[0].metric == "comp_mb_s"
+        assert regressions[0].change == pytest.approx(-0.2)
+
+    def test_ignores_noise_within_threshold(self):
+        """Small slowdowns and speedups are not regressions."""
+        baseline = _report(_result("k"))
+        current = _report(_result("k", comp=95.0, decomp=400.0))
+
+        assert compare(current, baseline, threshold=0.10) == []
+
+    def test_flags_ratio_growth(self):
+        """Output that grows beyond ratio_threshold is a regression."""
+        baseline = _report(_result("k"))
+        current = _report(_result("k", ratio=0.55))
+
+        regressions = compare(current, baseline)
+        assert [r.metric for r in regressions] == ["ratio"]
+
+    def test_unmatched_keys_ignored(self):
+        """Results missing from either report are not compared."""
+        baseline = _report(_result("old"))
+        current = _report(_result("new", comp=1.0))
+
+        assert compare(current, baseline) == []
+
+    def test_worst_first(self):
+        """Regressions are ordered by the size of the change."""
+        baseline = _report(_result("a"), _result("b"))
+        current = _report(_result("a", comp=85.0), _result("b", comp=50.0))
+
+        assert [r.key for r in compare(current, baseline)] == ["b", "a"]
+
+
+class TestRunSuite:
+    """Test running the suite."""
+
+    def test_small_run(self, tmp_path):
+        """A run over a tiny corpus produces results and round-trips as JSON."""
+        corpus = generate_corpus(tmp_path / "corpus", size=16 * 1024, small_count=8)
+        seen = []
+
+        report = run_suite(
+            corpus,
+            levels=(1,),
+            threads=(1,),
+            repeats=1,
+            kinds=("backend", "standalone"),
+            work_dir=tmp_path,
+            progress=seen.append,
+        )
+
+        assert report["results"]
+        assert len(seen) == len(report["results"])
+        assert set(report["corpus"]) == set(corpus)
+        for r in report["results"]:
+            assert r["kind"] in ("backend", "standalone")
+            assert r["input_size"] > 0
+            assert r["comp_mb_s"] > 0 and r["decomp_mb_s"] > 0
+
+        path = tmp_path / "report.json"
+        save_report(report, path)
+        loaded = load_report(path)
+        assert loaded["results"] == report["results"]
+        assert compare(loaded, report) == []
+        assert corpus_mismatches(loaded, report) == []
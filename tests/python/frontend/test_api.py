@@ -1,5 +1,8 @@
 """Tests for the frontend API module."""
 
+import asyncio
+import threading
+
 import pytest
 from pathlib import Path
 
@@ -9,6 +12,8 @@ from compresso.frontend.api import (
     DecompressionPlan,
     CompressionJob,
     DecompressionJob,
+    acompress,
+    adecompress,
 )
 
 
@@ -150,6 +155,124 @@ class TestCompressionJob:
         assert callable(CompressionJob)
 
 
+    def test_run_many(self, sample_text_file: Path, sample_binary_file: Path, temp_dir: Path):
+        """Test that run_many reports one result per job, in order."""
+        opts = CompressionOptions(algo="zstd", strategy="balanced", level=3)
+        jobs = [
+            CompressionJob.from_file(src, temp_dir / f"{src.name}.comp", opts)
+            for src in (sample_text_file, temp_dir / "missing.txt", sample_binary_file)
+        ]
+        jobs.append(
+            CompressionJob.from_file(
+                sample_text_file,
+                temp_dir / "fast.comp",
+                CompressionOptions(algo="lz4", strategy="fast"),
+            )
+        )
+
+        results = CompressionJob.run_many(jobs, threads=2)
+
+        assert [r.ok for r in results] == [True, False, True, True]
+        assert [r.plan for r in results] == [job.plan for job in jobs]
+
+        extracted = DecompressionJob.run_many(
+            [
+                DecompressionJob.from_file(job.plan.dest, temp_dir / f"out{i}")
+                for i, job in enumerate(jobs)
+                if job.plan.can_compress
+            ]
+        )
+
+        assert all(r.ok for r in extracted)
+        assert (temp_dir / "out0").read_bytes() == sample_text_file.read_bytes()
+        assert (temp_dir / "out2").read_bytes() == sample_binary_file.read_bytes()
+        assert (temp_dir / "out3").read_bytes() == sample_text_file.read_bytes()
+
+
+    def test_run_reports_progress(self, multi_block_file: Path, temp_dir: Path):
+        """Test that progress runs from 0.0 to 1.0 without going backwards."""
+        reports: list[tuple[float, int, int]] = []
+        job = CompressionJob.from_file(
+            multi_block_file,
+            temp_dir / "large.comp",
+            CompressionOptions(algo="lzma", level=6),
+        )
+
+        result = job.run(progress=lambda *report: reports.append(report))
+
+        assert result.ok
+        size = multi_block_file.stat().st_size
+        assert reports[0] == (0.0, 0, size)
+        assert reports[-1] == (1.0, size, size)
+        assert [done for _, done, _ in reports] == sorted(done for _, done, _ in reports)
+
+        reports.clear()
+        result = DecompressionJob.from_file(
+            temp_dir / "large.comp", temp_dir / "large.out"
+        ).run(progress=lambda *report: reports.append(report))
+
+        assert result.ok
+        size = (temp_dir / "large.comp").stat().st_size
+        assert reports[-1] == (1.0, size, size)
+        assert (temp_dir / "large.out").read_bytes() == multi_block_file.read_bytes()
+
+    def test_run_cancelled(self, multi_block_file: Path, temp_dir: Path):
+        """Test that a tripped token fails the job and leaves no output."""
+        from compresso import CancelledError, CancelToken
+
+        reports: list[tuple[float, int, int]] = []
+        job = CompressionJob.from_file(
+            multi_block_file,
+            temp_dir / "large.comp",
+            CompressionOptions(algo="lzma", level=6),
+        )
+
+        result = job.run(
+            progress=lambda *report: reports.append(report),
+            cancel=CancelToken(timeout=0),
+        )
+
+        assert not result.ok
+        assert isinstance(result.error, CancelledError)
+        assert not (temp_dir / "large.comp").exists()
+        assert reports[0][0] == 0.0 and reports[-1][0] < 1.0
+
+    def test_run_budget_strategy(
+        self,
+        sample_text_file: Path,
+        temp_dir: Path,
+        mock_speeds_file: Path,
+        budget_calibration: list[dict],
+    ):
+        """Test that a budget plan names the choice it compresses with."""
+        from compresso import inspect
+
+        job = CompressionJob.from_file(
+            sample_text_file,
+            temp_dir / "budget.comp",
+            CompressionOptions(strategy="target_mb_s=100"),
+        )
+
+        assert job.plan.can_compress
+        assert job.plan.backend_name == "zstd"
+        assert job.plan.estimated_seconds is not None
+
+        assert job.run().ok
+        result = inspect(temp_dir / "budget.comp")
+        assert (result.algo_name, result.level) == ("zstd", 3)
+
+    def test_plan_malformed_budget(self, sample_text_file: Path, temp_dir: Path):
+        """Test that a malformed budget makes the plan unavailable."""
+        job = CompressionJob.from_file(
+            sample_text_file,
+            temp_dir / "budget.comp",
+            CompressionOptions(strategy="target_mb_s=fast"),
+        )
+
+        assert not job.plan.can_compress
+        assert "budget" in job.plan.reason_if_unavailable
+
+
 class TestDecompressionJob:
     """Test the DecompressionJob class."""
 
@@ -163,6 +286,72 @@ class TestDecompressionJob:
         assert callable(DecompressionJob)
 
 
+class TestAsyncJobs:
+    """Test the awaitable job API."""
+
+    def test_many_in_flight_without_python_threads(
+        self, sample_text_file: Path, temp_dir: Path
+    ):
+        """Concurrent jobs run on native workers and round-trip."""
+        opts = CompressionOptions(algo="zstd", level=3)
+        seen_threads: list[int] = []
+
+        async def main():
+            comp = asyncio.gather(
+                *[
+                    acompress(sample_text_file, temp_dir / f"{i}.comp", opts)
+                    for i in range(64)
+                ]
+            )
+            seen_threads.append(threading.active_count())
+            compressed = await comp
+            decompressed = await asyncio.gather(
+                *[
+                    adecompress(temp_dir / f"{i}.comp", temp_dir / f"{i}.out")
+                    for i in range(64)
+                ]
+            )
+            return compressed + decompressed
+
+        before = threading.active_count()
+        results = asyncio.run(main())
+
+        assert all(r.ok for r in results), [r.error for r in results if not r.ok]
+        assert seen_threads == [before]
+        assert (temp_dir / "63.out").read_bytes() == sample_text_file.read_bytes()
+
+    def test_errors_become_results(self, temp_dir: Path):
+        """A failing job resolves to a failed JobResult instead of raising."""
+        result = asyncio.run(acompress(temp_dir / "missing.txt", temp_dir / "m.comp"))
+
+        assert not result.ok
+        assert result.error is not None
+
+    def test_task_cancel_stops_the_job(self, temp_dir: Path):
+        """Cancelling the awaiting task cancels the native call."""
+        import os
+
+        src = temp_dir / "big.bin"
+        src.write_bytes(os.urandom(64 * 1024 * 1024))
+        dest = temp_dir / "big.comp"
+
+        async def main():
+            task = asyncio.ensure_future(
+                acompress(src, dest, CompressionOptions(algo="lzma", level=6))
+            )
+            await asyncio.sleep(0.05)
+            task.cancel()
+            with pytest.raises(asyncio.CancelledError):
+                await task
+            for _ in range(100):  # the worker removes its partial output
+                if not dest.exists():
+                    break
+                await asyncio.sleep(0.05)
+
+        asyncio.run(main())
+        assert not dest.exists()
+
+
 class TestAPIIntegration:
     """Integration tests for the API module."""
 
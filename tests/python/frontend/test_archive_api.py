@@ -1,7 +1,12 @@
 """Tests for the frontend archive API module."""
 
+import asyncio
+import os
+import tarfile
 from pathlib import Path
 
+import pytest
+
 from compresso.frontend._job import JobResult
 from compresso.frontend.archive_api import (
     ArchiveEntry,
@@ -10,6 +15,7 @@ from compresso.frontend.archive_api import (
     ArchivePlan,
     ExtractJob,
     ExtractPlan,
+    acreate_archive,
     plan_archive,
     plan_extraction,
 )
@@ -24,6 +30,7 @@ class TestArchiveOptions:
 
         assert opts.format == "tar.zst"
         assert opts.compression_level is None
+        assert opts.threads == 1
         assert opts.preserve_permissions is True
 
     def test_archive_options_with_format(self):
@@ -92,6 +99,18 @@ class TestArchiveJob:
         assert result.ok is False
         assert result.error is not None
 
+    def test_acreate_archive(self, sample_text_file: Path, temp_dir: Path):
+        """acreate_archive writes the same archive run() would."""
+        options = ArchiveOptions(format="tar.gz")
+        out = temp_dir / "out.tar.gz"
+        result = asyncio.run(acreate_archive([sample_text_file], out, options))
+        ArchiveJob.from_paths([sample_text_file], temp_dir / "sync.tar.gz", options).run()
+
+        assert result.ok, result.error
+        with tarfile.open(out) as tar, tarfile.open(temp_dir / "sync.tar.gz") as sync:
+            assert tar.getnames() == sync.getnames()
+            assert len(tar.getnames()) == 1
+
 
 class TestExtractJob:
     """Test the ExtractJob class."""
@@ -167,3 +186,270 @@ class TestArchiveRoundTrip:
         assert (
             temp_dir / "out" / "tree" / "deep" / "leaf.txt"
         ).read_bytes() == b"leaf content"
+
+    @pytest.mark.parametrize("fmt", ["tar", "cdar"])
+    def test_wide_tree_lists_every_entry(self, temp_dir: Path, monkeypatch, fmt: str):
+        """Every file and directory of a wide tree, empty ones too, is stored."""
+        monkeypatch.chdir(temp_dir)
+        src = Path("tree")
+        expected = {"tree"}
+        for i in range(20):
+            (src / f"d{i}" / "empty").mkdir(parents=True)
+            expected |= {f"tree/d{i}", f"tree/d{i}/empty"}
+            for j in range(50):
+                (src / f"d{i}" / f"f{j}").write_bytes(b"x" * j)
+                expected.add(f"tree/d{i}/f{j}")
+        archive_path = Path(f"tree.{fmt}")
+
+        options = ArchiveOptions(format=fmt)
+        assert ArchiveJob.from_paths([src], archive_path, options).run().ok
+
+        entries = ExtractJob.from_archive(archive_path).list_contents()
+        assert {e.path.rstrip("/") for e in entries} == expected
+
+    @pytest.mark.parametrize("fmt", ["tar.zst", "tar.xz", "tar.gz", "tar.lz4"])
+    def test_threaded_codec_round_trip(self, temp_dir: Path, monkeypatch, fmt: str):
+        """Multi-threaded archiving streams the tar through the codec intact."""
+        monkeypatch.chdir(temp_dir)
+        src = Path("tree")
+        src.mkdir()
+        for i in range(8):
+            (src / f"file{i}.txt").write_bytes(f"entry {i} ".encode() * 5000)
+        archive_path = Path(f"tree.{fmt}")
+
+        options = ArchiveOptions(format=fmt, compression_level=3, threads=0)
+        result = ArchiveJob.from_paths([src], archive_path, options).run()
+        assert result.ok, result.error
+
+        assert ExtractJob.from_archive(archive_path, temp_dir / "out").run().ok
+        for i in range(8):
+            restored = temp_dir / "out" / "tree" / f"file{i}.txt"
+            assert restored.read_bytes() == (src / f"file{i}.txt").read_bytes()
+
+    @pytest.mark.parametrize("mode", ["gz", "bz2", "xz"])
+    def test_reads_foreign_compressed_tar(self, temp_dir: Path, mode: str):
+        """Tarballs from other tools are decompressed on the fly when read."""
+        member = temp_dir / "member.txt"
+        member.write_bytes(b"written by tarfile " * 1000)
+        archive_path = temp_dir / f"foreign.tar.{mode}"
+        with tarfile.open(archive_path, f"w:{mode}") as tar:
+            tar.add(member, arcname="member.txt")
+
+        job = ExtractJob.from_archive(archive_path, temp_dir / "out")
+        assert [e.path for e in job.list_contents()] == ["member.txt"]
+        assert job.run().ok
+        assert (temp_dir / "out" / "member.txt").read_bytes() == member.read_bytes()
+
+    @pytest.mark.parametrize("threads", [0, 4])
+    def test_threaded_extraction(self, temp_dir: Path, monkeypatch, threads: int):
+        """Writer threads restore every file, small and large, with its mode."""
+        monkeypatch.chdir(temp_dir)
+        src = Path("bundle")
+        for d in range(4):
+            (src / f"dir{d}").mkdir(parents=True)
+            for i in range(25):
+                (src / f"dir{d}" / f"f{i}.txt").write_bytes(f"{d}/{i} ".encode() * 50)
+        large = src / "large.bin"
+        large.write_bytes(bytes(range(256)) * 8192)  # Streamed, not buffered
+        large.chmod(0o600)
+        archive_path = Path("bundle.tar.zst")
+        assert ArchiveJob.from_paths([src], archive_path).run().ok
+
+        job = ExtractJob.from_archive(archive_path, temp_dir / "out", threads=threads)
+        result = job.run()
+        assert result.ok, result.error
+
+        for path in src.rglob("*"):
+            restored = temp_dir / "out" / path
+            if path.is_file():
+                assert restored.read_bytes() == path.read_bytes()
+        assert (temp_dir / "out" / large).stat().st_mode & 0o777 == 0o600
+
+    @pytest.mark.parametrize("threads", [4, 8])
+    def test_threaded_extraction_keeps_last_duplicate(
+        self, temp_dir: Path, threads: int
+    ):
+        """The last of several entries with one name wins, as with one thread."""
+        import io
+
+        archive_path = temp_dir / "dup.tar"
+        with tarfile.open(archive_path, "w") as tar:
+            for i in range(200):
+                data = f"version {i}\n".encode() * (i % 7 + 1)
+                info = tarfile.TarInfo("same.txt")
+                info.size = len(data)
+                tar.addfile(info, io.BytesIO(data))
+
+        for run in range(5):
+            out = temp_dir / f"out{run}"
+            result = ExtractJob.from_archive(archive_path, out, threads=threads).run()
+            assert result.ok, result.error
+            assert (out / "same.txt").read_bytes() == b"version 199\n" * 4
+
+    def test_selective_extraction(self, temp_dir: Path, monkeypatch):
+        """Only requested entries are written; unknown and repeated names are fine."""
+        monkeypatch.chdir(temp_dir)
+        src = Path("many")
+        src.mkdir()
+        for i in range(200):
+            (src / f"f{i}.txt").write_bytes(f"file {i}".encode())
+        archive_path = Path("many.tar.gz")
+        assert ArchiveJob.from_paths([src], archive_path).run().ok
+
+        wanted = ["many/f7.txt", "many/f150.txt", "many/f7.txt", "many/absent.txt"]
+        result = ExtractJob.from_archive(archive_path, temp_dir / "out", wanted).run()
+        assert result.ok, result.error
+
+        extracted = sorted(p.name for p in (temp_dir / "out" / "many").iterdir())
+        assert extracted == ["f150.txt", "f7.txt"]
+        assert (temp_dir / "out" / "many" / "f7.txt").read_bytes() == b"file 7"
+
+    def test_cdar_round_trip(self, temp_dir: Path, monkeypatch):
+        """A deduplicating archive restores files, including repeated content."""
+        monkeypatch.chdir(temp_dir)
+        src = Path("snap")
+        (src / "nested").mkdir(parents=True)
+        blob = bytes(range(256)) * 4096
+        (src / "a.bin").write_bytes(blob)
+        (src / "nested" / "copy.bin").write_bytes(blob)  # Stored once
+        (src / "empty.txt").write_bytes(b"")
+        archive_path = Path("snap.cdar")
+
+        options = ArchiveOptions(format="cdar")
+        assert ArchiveJob.from_paths([src], archive_path, options).run().ok
+        assert archive_path.stat().st_size < len(blob)
+
+        names = {e.path for e in ExtractJob.from_archive(archive_path).list_contents()}
+        assert {"snap/a.bin", "snap/nested/copy.bin", "snap/empty.txt"} <= names
+
+        assert ExtractJob.from_archive(archive_path, temp_dir / "out").run().ok
+        for path in src.rglob("*"):
+            if path.is_file():
+                assert (temp_dir / "out" / path).read_bytes() == path.read_bytes()
+
+    def test_cdar_incremental(self, temp_dir: Path, monkeypatch):
+        """An archive against a base stores only changed chunks and restores fully."""
+        monkeypatch.chdir(temp_dir)
+        src = Path("snap")
+        src.mkdir()
+        data = bytearray(
+            b"".join(i.to_bytes(4, "little") * 3 for i in range(200_000))
+        )
+        (src / "data.bin").write_bytes(data)
+        full = Path("full.cdar")
+        assert ArchiveJob.from_paths([src], full, ArchiveOptions(format="cdar")).run().ok
+
+        data[1_000_000:1_000_000] = b"an edit in the middle"
+        (src / "data.bin").write_bytes(data)
+        (src / "new.txt").write_bytes(b"added after the full backup")
+        incremental = Path("incremental.cdar.lz4")
+        options = ArchiveOptions(format="cdar.lz4", base=full)
+        result = ArchiveJob.from_paths([src], incremental, options).run()
+        assert result.ok, result.error
+        assert incremental.stat().st_size * 10 < full.stat().st_size
+
+        job = ExtractJob.from_archive(incremental, temp_dir / "out", threads=2)
+        assert job.run().ok
+        assert (temp_dir / "out" / src / "data.bin").read_bytes() == bytes(data)
+        assert (temp_dir / "out" / src / "new.txt").read_bytes() == (
+            b"added after the full backup"
+        )
+
+        # Chunks still live in the base, so it must stay next to the increment
+        full.rename("moved.cdar")
+        assert not ExtractJob.from_archive(incremental, temp_dir / "again").run().ok
+
+    def test_cdar_missing_base_cannot_run(self, sample_text_file: Path, temp_dir: Path):
+        """A base archive that does not exist makes the plan unavailable."""
+        options = ArchiveOptions(format="cdar", base=temp_dir / "absent.cdar")
+        plan = plan_archive([sample_text_file], temp_dir / "out.cdar", options)
+
+        assert plan.can_run is False
+        assert "absent.cdar" in (plan.reason_if_unavailable or "")
+
+
+class TestArchiveListing:
+    """Test entry metadata in listings and the tar catalog sidecar."""
+
+    @staticmethod
+    def _make_tree(root: Path) -> Path:
+        """Write a small tree with a distinct mode and mtime to archive."""
+        src = root / "tree"
+        (src / "sub").mkdir(parents=True)
+        for i in range(30):
+            (src / "sub" / f"f{i}.txt").write_bytes(b"x" * (i * 100))
+        script = src / "run.sh"
+        script.write_bytes(b"#!/bin/sh\n")
+        script.chmod(0o751)
+        os.utime(script, (1_600_000_000, 1_600_000_000))
+        return src
+
+    @pytest.mark.parametrize("fmt", ["tar", "tar.zst", "cdar"])
+    def test_listing_carries_metadata(self, temp_dir: Path, monkeypatch, fmt: str):
+        """Listed entries report size, type, mode and mtime, not just paths."""
+        monkeypatch.chdir(temp_dir)
+        src = self._make_tree(Path("."))
+        archive_path = Path(f"tree.{fmt}")
+        options = ArchiveOptions(format=fmt)
+        assert ArchiveJob.from_paths([src.name], archive_path, options).run().ok
+
+        entries = {
+            e.path.rstrip("/"): e
+            for e in ExtractJob.from_archive(archive_path).list_contents()
+        }
+        assert entries["tree/sub"].is_dir
+        assert entries["tree/sub/f7.txt"].size == 700
+        assert not entries["tree/sub/f7.txt"].is_dir
+        assert entries["tree/run.sh"].mtime == 1_600_000_000
+        assert entries["tree/run.sh"].mode == 0o751
+
+    @pytest.mark.parametrize("fmt", ["tar", "tar.gz", "tar.zst"])
+    def test_catalog_matches_archive(self, temp_dir: Path, monkeypatch, fmt: str):
+        """A catalog lists exactly what walking the archive lists."""
+        monkeypatch.chdir(temp_dir)
+        src = self._make_tree(Path("."))
+        archive_path = Path(f"tree.{fmt}")
+        options = ArchiveOptions(format=fmt, catalog=True)
+        assert ArchiveJob.from_paths([src.name], archive_path, options).run().ok
+        catalog = Path(f"tree.{fmt}.catalog")
+        assert catalog.is_file()
+
+        from_catalog = ExtractJob.from_archive(archive_path).list_contents()
+        catalog.rename("aside")
+        walked = ExtractJob.from_archive(archive_path).list_contents()
+        assert from_catalog == walked
+
+    def test_stale_catalog_is_ignored(self, temp_dir: Path, monkeypatch):
+        """Once the archive is rewritten, its old catalog is no longer used."""
+        monkeypatch.chdir(temp_dir)
+        src = self._make_tree(Path("."))
+        archive_path = Path("tree.tar")
+        options = ArchiveOptions(format="tar", catalog=True)
+        assert ArchiveJob.from_paths([src.name], archive_path, options).run().ok
+
+        (src / "late.txt").write_bytes(b"added later")
+        options = ArchiveOptions(format="tar")
+        assert ArchiveJob.from_paths([src.name], archive_path, options).run().ok
+
+        names = {e.path for e in ExtractJob.from_archive(archive_path).list_contents()}
+        assert "tree/late.txt" in names
+
+    def test_selective_extraction_through_catalog(self, temp_dir: Path, monkeypatch):
+        """Requested entries of a cataloged plain tar are read in place."""
+        monkeypatch.chdir(temp_dir)
+        src = self._make_tree(Path("."))
+        archive_path = Path("tree.tar")
+        options = ArchiveOptions(format="tar", catalog=True)
+        assert ArchiveJob.from_paths([src.name], archive_path, options).run().ok
+
+        wanted = ["tree/sub/f29.txt", "tree/run.sh", "tree/absent.txt"]
+        result = ExtractJob.from_archive(archive_path, temp_dir / "out", wanted).run()
+        assert result.ok, result.error
+
+        out = temp_dir / "out" / "tree"
+        assert sorted(p.name for p in out.rglob("*") if p.is_file()) == [
+            "f29.txt",
+            "run.sh",
+        ]
+        assert (out / "sub" / "f29.txt").read_bytes() == b"x" * 2900
+        assert (out / "run.sh").stat().st_mode & 0o777 == 0o751
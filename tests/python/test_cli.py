@@ -67,3 +67,10 @@ class TestCLIModule:
 
         assert hasattr(cli, "decompress")
         assert callable(cli.decompress)
+
+    def test_verify_command_exists(self):
+        """Test that verify command is defined."""
+        from compresso import cli
+
+        assert hasattr(cli, "verify")
+        assert callable(cli.verify)
@@ -4,13 +4,40 @@ import pytest
 from pathlib import Path
 
 from compresso import (
+    Compressor,
+    CompressorStream,
+    Decompressor,
+    DecompressorStream,
+    Dictionary,
+    compress_bound,
+    compress_bytes,
     compress_file,
+    compress_into,
+    compress_many,
+    decompress_bytes,
     decompress_file,
+    decompress_into,
+    decompress_many,
+    decompress_range,
+    get_stats,
+    io_engines,
+    reset_stats,
+    train_dictionary,
+    verify_file,
     Error,
     HeaderError,
     BackendError,
+    CancelledError,
+    CancelToken,
+    Progress,
 )
-from compresso._core import get_capabilities
+from compresso._core import (
+    choose_for_budget,
+    get_calibration,
+    get_capabilities,
+    set_calibration,
+)
+from compresso.backend.file_inspect import inspect as inspect_file
 
 
 class TestCoreExceptions:
@@ -67,6 +94,48 @@ class TestCapabilities:
         caps_str = str(caps).lower()
         assert "zlib" in caps_str
 
+    def test_zlib_reports_implementation(self, tmp_path):
+        """zlib names the library it runs on, and gzip stays stock-compatible."""
+        import gzip
+
+        from compresso._core import compress_standalone, decompress_standalone
+
+        (entry,) = [c for c in get_capabilities() if c and c["name"] == "zlib"]
+        assert entry["implementation"] in ("zlib", "libdeflate")
+
+        data = b"partner exchange " * 4096
+        src = tmp_path / "data"
+        src.write_bytes(data)
+        compress_standalone(str(src), str(tmp_path / "ours.gz"), "gzip", 6)
+        assert gzip.decompress((tmp_path / "ours.gz").read_bytes()) == data
+
+        (tmp_path / "stock.gz").write_bytes(gzip.compress(data))
+        decompress_standalone(str(tmp_path / "stock.gz"), str(tmp_path / "out"), "gzip")
+        assert (tmp_path / "out").read_bytes() == data
+
+    def test_concurrent_use_across_threads(self):
+        """Many threads can look up backends and compress side by side."""
+        from concurrent.futures import ThreadPoolExecutor
+
+        payload = b"compresso thread safety " * 4096
+
+        def round_trip(algo):
+            packed = compress_bytes(payload, algo)
+            return decompress_bytes(packed) == payload
+
+        algos = [c["name"] for c in get_capabilities() if c["name"] != "stored"]
+        with ThreadPoolExecutor(max_workers=16) as pool:
+            assert all(pool.map(round_trip, algos * 8))
+
+    def test_import_keeps_gil_disabled(self):
+        """On free-threaded builds, importing the extension leaves the GIL off."""
+        import sys
+        import sysconfig
+
+        if not sysconfig.get_config_var("Py_GIL_DISABLED"):
+            pytest.skip("not a free-threaded build")
+        assert not sys._is_gil_enabled()
+
 
 class TestCompressFile:
     """Test the compress_file function."""
@@ -153,6 +222,23 @@ class TestCompressFile:
         # Highly compressible content should be much smaller
         assert output_file.stat().st_size < large_compressible_file.stat().st_size / 10
 
+    @pytest.mark.parametrize("algo", ["zlib", "lzma", "lz4"])
+    def test_incompressible_file_is_stored(self, temp_dir: Path, algo: str):
+        """Test that a payload that does not shrink is replaced by the input."""
+        import os
+
+        src = temp_dir / "noise.bin"
+        compressed_file = temp_dir / "noise.comp"
+        decompressed_file = temp_dir / "noise.out"
+        src.write_bytes(os.urandom(300000))
+
+        compress_file(str(src), str(compressed_file), algo, "balanced", 6)
+        decompress_file(str(compressed_file), str(decompressed_file), "")
+
+        data = compressed_file.read_bytes()
+        assert data[5] == 0 and len(data) == 16 + 300000
+        assert decompressed_file.read_bytes() == src.read_bytes()
+
 
 class TestDecompressFile:
     """Test the decompress_file function."""
@@ -238,3 +324,1829 @@ class TestDecompressFile:
         decompress_file(str(compressed_file), str(decompressed_file), "")
 
         assert decompressed_file.read_text() == original_content
+
+
+class TestParallelCompression:
+    """Test block-parallel compression via the threads argument."""
+
+    def test_round_trip_threaded(
+        self, multi_block_file: Path, temp_dir: Path, compression_algo: str
+    ):
+        """Test that threaded compression round-trips for every backend."""
+        compressed_file = temp_dir / f"threaded_{compression_algo}.comp"
+        decompressed_file = temp_dir / f"threaded_{compression_algo}.out"
+
+        compress_file(
+            str(multi_block_file),
+            str(compressed_file),
+            compression_algo,
+            "balanced",
+            1,
+            threads=4,
+        )
+        decompress_file(str(compressed_file), str(decompressed_file), "")
+
+        assert decompressed_file.read_bytes() == multi_block_file.read_bytes()
+
+    @pytest.mark.parametrize("algo,version", [("zlib", 2), ("zstd", 1)])
+    def test_threaded_header_version(
+        self, multi_block_file: Path, temp_dir: Path, algo: str, version: int
+    ):
+        """Test that block-split output is version 2 and native zstd MT is not."""
+        compressed_file = temp_dir / f"version_{algo}.comp"
+
+        compress_file(
+            str(multi_block_file), str(compressed_file), algo, "balanced", 1, threads=2
+        )
+
+        assert compressed_file.read_bytes()[4] == version
+
+    def test_single_thread_is_plain_stream(
+        self, multi_block_file: Path, temp_dir: Path
+    ):
+        """Test that the default single-threaded path writes a version 1 stream."""
+        compressed_file = temp_dir / "single.comp"
+
+        compress_file(
+            str(multi_block_file), str(compressed_file), "zlib", "balanced", 1
+        )
+
+        assert compressed_file.read_bytes()[4] == 1
+
+    def test_auto_threads(self, multi_block_file: Path, temp_dir: Path):
+        """Test that threads=0 selects a worker per CPU and still round-trips."""
+        compressed_file = temp_dir / "auto.comp"
+        decompressed_file = temp_dir / "auto.out"
+
+        compress_file(
+            str(multi_block_file), str(compressed_file), "lz4", "balanced", 1, threads=0
+        )
+        decompress_file(str(compressed_file), str(decompressed_file), "")
+
+        assert decompressed_file.read_bytes() == multi_block_file.read_bytes()
+
+    def test_negative_threads_rejected(self, sample_text_file: Path, temp_dir: Path):
+        """Test that a negative thread count raises ValueError."""
+        with pytest.raises(ValueError):
+            compress_file(
+                str(sample_text_file),
+                str(temp_dir / "neg.comp"),
+                "zlib",
+                "balanced",
+                6,
+                threads=-1,
+            )
+
+    # Empty, one block, a block and a byte, one full batch of 4 workers
+    # (8 x 128 KiB) and something in between
+    @pytest.mark.parametrize("size", [0, 131072, 131073, 1048576, 3146505])
+    def test_parallel_gzip_is_plain_gzip(self, temp_dir: Path, size: int):
+        """Test that threaded standalone gzip writes one standard member."""
+        import gzip
+        from compresso._core import compress_standalone, decompress_standalone
+
+        text = b"".join(b"line %d of the parallel gzip input\n" % i for i in range(4096))
+        data = (text * (size // len(text) + 1))[:size]
+        src = temp_dir / "input.bin"
+        src.write_bytes(data)
+
+        gz = temp_dir / "input.bin.gz"
+        compress_standalone(str(src), str(gz), "gzip", 6, threads=4)
+        assert gzip.decompress(gz.read_bytes()) == data
+
+        out = temp_dir / "input.out"
+        decompress_standalone(str(gz), str(out), "gzip")
+        assert out.read_bytes() == data
+
+    # Chunks smaller than, equal to and larger than a batch of 4 workers
+    @pytest.mark.parametrize("chunk", [64 * 1024, 1 << 20, 4 << 20])
+    @pytest.mark.parametrize("engine", ["stdio", "uring", "threads"])
+    def test_parallel_gzip_io_options(self, temp_dir: Path, chunk: int, engine: str):
+        """Test that threaded standalone gzip streams through any I/O engine."""
+        import gzip
+        from compresso._core import compress_standalone
+
+        data = b"".join(
+            b"record %d of the parallel gzip input\n" % i for i in range(90000)
+        )
+        src = temp_dir / "input.bin"
+        src.write_bytes(data)
+
+        baseline = temp_dir / "baseline.gz"
+        compress_standalone(str(src), str(baseline), "gzip", 6, threads=4)
+        gz = temp_dir / "input.bin.gz"
+        compress_standalone(
+            str(src),
+            str(gz),
+            "gzip",
+            6,
+            io_chunk_size=chunk,
+            io_engine=engine,
+            threads=4,
+        )
+        assert gz.read_bytes() == baseline.read_bytes()
+        assert gzip.decompress(gz.read_bytes()) == data
+
+    # At level 1 xz cuts 3 MiB blocks, so the 4 MiB input spans two
+    @pytest.mark.parametrize("fmt", ["xz", "zstd"])
+    def test_parallel_standalone_round_trip(self, temp_dir: Path, fmt: str):
+        """Test that threaded xz/zstd files read back on one thread and many."""
+        from compresso._core import compress_standalone, decompress_standalone
+
+        text = b"".join(b"line %d of the parallel input\n" % i for i in range(4096))
+        data = (text * ((4 << 20) // len(text) + 1))[: 4 << 20]
+        src = temp_dir / "input.bin"
+        src.write_bytes(data)
+
+        comp = temp_dir / "input.comp"
+        compress_standalone(str(src), str(comp), fmt, 1, threads=4)
+        if fmt == "xz":
+            import lzma
+
+            assert lzma.decompress(comp.read_bytes()) == data
+
+        for threads in (1, 4):
+            out = temp_dir / f"input.{threads}.out"
+            decompress_standalone(str(comp), str(out), fmt, threads=threads)
+            assert out.read_bytes() == data
+
+    def test_multi_member_gzip_reads_every_member(self, temp_dir: Path):
+        """Test that concatenated gzip members decode whole on any thread count."""
+        import gzip
+        import random
+
+        from compresso._core import decompress_standalone
+
+        rng = random.Random(7)
+        pieces = [rng.randbytes(256 << 10) + b"text " * 4096 for _ in range(8)]
+        gz = temp_dir / "joined.gz"
+        gz.write_bytes(b"".join(gzip.compress(p, 1) for p in pieces))
+
+        for threads in (1, 4):
+            out = temp_dir / f"joined.{threads}.out"
+            decompress_standalone(str(gz), str(out), "gzip", threads=threads)
+            assert out.read_bytes() == b"".join(pieces)
+
+    def test_parallel_gzip_negative_threads_rejected(
+        self, sample_text_file: Path, temp_dir: Path
+    ):
+        """Test that the standalone writers reject a negative thread count."""
+        from compresso._core import compress_standalone
+
+        with pytest.raises(ValueError):
+            compress_standalone(
+                str(sample_text_file), str(temp_dir / "neg.gz"), "gzip", threads=-1
+            )
+
+
+class TestSeekableFormat:
+    """Test block-indexed (version 2) files and random-access reads."""
+
+    def _compress_seekable(self, src: Path, dst: Path, algo: str = "zlib") -> None:
+        """Compress src into a seekable file with 64KB blocks."""
+        compress_file(
+            str(src), str(dst), algo, "balanced", 1, seekable=True, block_size=65536
+        )
+
+    def test_seekable_round_trip(
+        self, multi_block_file: Path, temp_dir: Path, compression_algo: str
+    ):
+        """Test that seekable files round-trip with parallel decompression."""
+        compressed_file = temp_dir / "seekable.comp"
+        decompressed_file = temp_dir / "seekable.out"
+
+        self._compress_seekable(multi_block_file, compressed_file, compression_algo)
+        decompress_file(str(compressed_file), str(decompressed_file), "", threads=4)
+
+        assert compressed_file.read_bytes()[4] == 2
+        assert decompressed_file.read_bytes() == multi_block_file.read_bytes()
+
+    @pytest.mark.parametrize(
+        "offset,length",
+        [(0, 10), (65530, 20), (100000, 300000), (0, 1 << 40), (10**8, 5), (7, 0)],
+    )
+    def test_decompress_range_matches_slice(
+        self, multi_block_file: Path, temp_dir: Path, offset: int, length: int
+    ):
+        """Test that decompress_range behaves like slicing the original data."""
+        compressed_file = temp_dir / "range.comp"
+        self._compress_seekable(multi_block_file, compressed_file)
+
+        data = multi_block_file.read_bytes()
+        result = decompress_range(str(compressed_file), offset, length)
+
+        assert result == data[offset : offset + length]
+
+    def test_decompress_range_requires_index(
+        self, sample_text_file: Path, temp_dir: Path
+    ):
+        """Test that decompress_range rejects version 1 files."""
+        compressed_file = temp_dir / "stream.comp"
+        compress_file(
+            str(sample_text_file), str(compressed_file), "zlib", "balanced", 6
+        )
+
+        with pytest.raises(Error):
+            decompress_range(str(compressed_file), 0, 10)
+
+    def test_decompress_range_negative_offset(
+        self, multi_block_file: Path, temp_dir: Path
+    ):
+        """Test that negative offsets raise ValueError."""
+        compressed_file = temp_dir / "neg.comp"
+        self._compress_seekable(multi_block_file, compressed_file)
+
+        with pytest.raises(ValueError):
+            decompress_range(str(compressed_file), -1, 10)
+
+    def test_corrupt_block_detected(self, multi_block_file: Path, temp_dir: Path):
+        """Test that a damaged block fails its checksum or codec check."""
+        compressed_file = temp_dir / "corrupt.comp"
+        self._compress_seekable(multi_block_file, compressed_file)
+
+        data = bytearray(compressed_file.read_bytes())
+        data[40] ^= 0xFF
+        compressed_file.write_bytes(bytes(data))
+
+        with pytest.raises(Error):
+            decompress_file(str(compressed_file), str(temp_dir / "corrupt.out"), "")
+
+    def test_invalid_block_size_rejected(self, sample_text_file: Path, temp_dir: Path):
+        """Test that block sizes outside the supported range raise ValueError."""
+        with pytest.raises(ValueError):
+            compress_file(
+                str(sample_text_file),
+                str(temp_dir / "bad.comp"),
+                "zlib",
+                "balanced",
+                6,
+                seekable=True,
+                block_size=100,
+            )
+
+    def test_auto_strategy_picks_per_block(self, temp_dir: Path):
+        """Test that "auto" stores random blocks raw and compresses the rest."""
+        import os
+
+        src = temp_dir / "mixed.bin"
+        compressed_file = temp_dir / "mixed.comp"
+        decompressed_file = temp_dir / "mixed.out"
+        text = b"the quick brown fox jumps over the lazy dog\n" * 1490
+        src.write_bytes(os.urandom(65536) + text[:65536] + os.urandom(30000))
+
+        compress_file(str(src), str(compressed_file), "", "auto", 6, block_size=65536)
+        decompress_file(str(compressed_file), str(decompressed_file), "", threads=2)
+
+        data = compressed_file.read_bytes()
+        assert data[4] == 2 and data[7] & 0x02
+        assert decompressed_file.read_bytes() == src.read_bytes()
+        assert decompress_range(str(compressed_file), 65530, 100) == (
+            src.read_bytes()[65530:65630]
+        )
+        # Two random blocks stored raw, the text block well under its size
+        assert 65536 + 30000 < len(data) < 65536 + 30000 + 8192
+
+    def test_incompressible_blocks_are_stored(self, temp_dir: Path):
+        """Test that blocks a fixed backend cannot shrink are stored raw."""
+        import os
+
+        src = temp_dir / "noise.bin"
+        compressed_file = temp_dir / "noise.comp"
+        src.write_bytes(os.urandom(65536) + b"a" * 65536)
+        self._compress_seekable(src, compressed_file)
+
+        data = compressed_file.read_bytes()
+        assert data[5] == 1 and data[7] & 0x02
+        assert decompress_range(str(compressed_file), 65000, 1000) == (
+            src.read_bytes()[65000:66000]
+        )
+
+    def test_auto_strategy_rejects_dictionary(
+        self, sample_text_file: Path, temp_dir: Path
+    ):
+        """Test that "auto" cannot be combined with a dictionary."""
+        dictionary = train_dictionary([b"sample %d text" % i for i in range(200)])
+        with pytest.raises(ValueError):
+            compress_file(
+                str(sample_text_file),
+                str(temp_dir / "dict.comp"),
+                "",
+                "auto",
+                6,
+                dictionary=dictionary,
+            )
+
+
+class TestIntegrity:
+    """Test the optional content checksum and verify_file."""
+
+    @pytest.mark.parametrize("algo", ["zlib", "lz4", "zstd"])
+    def test_checksum_round_trip(
+        self, sample_binary_file: Path, temp_dir: Path, algo: str
+    ):
+        """Test that a checksummed file is flagged and decompresses."""
+        compressed_file = temp_dir / "summed.comp"
+        decompressed_file = temp_dir / "summed.out"
+
+        compress_file(
+            str(sample_binary_file),
+            str(compressed_file),
+            algo,
+            "balanced",
+            6,
+            checksum=True,
+        )
+        decompress_file(str(compressed_file), str(decompressed_file), "")
+
+        data = compressed_file.read_bytes()
+        assert data[7] & 0x04
+        assert decompressed_file.read_bytes() == sample_binary_file.read_bytes()
+        assert decompress_bytes(data) == sample_binary_file.read_bytes()
+
+    def test_checksum_mismatch_detected(self, sample_text_file: Path, temp_dir: Path):
+        """Test that data disagreeing with the stored checksum raises."""
+        compressed_file = temp_dir / "summed.comp"
+        compress_file(
+            str(sample_text_file),
+            str(compressed_file),
+            "zlib",
+            "balanced",
+            6,
+            checksum=True,
+        )
+
+        data = bytearray(compressed_file.read_bytes())
+        data[16] ^= 0xFF  # the stored hash itself
+        compressed_file.write_bytes(bytes(data))
+
+        with pytest.raises(Error, match="Checksum mismatch"):
+            decompress_file(str(compressed_file), str(temp_dir / "bad.out"), "")
+        with pytest.raises(Error, match="Checksum mismatch"):
+            decompress_bytes(bytes(data))
+        with pytest.raises(Error, match="Checksum mismatch"):
+            verify_file(str(compressed_file))
+
+    def test_stored_file_keeps_checksum(self, temp_dir: Path):
+        """Test that the stored fallback still carries the checksum."""
+        import os
+
+        src = temp_dir / "noise.bin"
+        compressed_file = temp_dir / "noise.comp"
+        src.write_bytes(os.urandom(100000))
+
+        compress_file(
+            str(src), str(compressed_file), "zlib", "balanced", 6, checksum=True
+        )
+
+        data = compressed_file.read_bytes()
+        assert data[5] == 0 and data[7] == 0x04
+        assert len(data) == 24 + 100000
+        verify_file(str(compressed_file))
+
+    def test_block_files_skip_checksum(self, multi_block_file: Path, temp_dir: Path):
+        """Test that seekable files rely on their block CRCs instead."""
+        compressed_file = temp_dir / "blocks.comp"
+        compress_file(
+            str(multi_block_file),
+            str(compressed_file),
+            "zlib",
+            "balanced",
+            6,
+            seekable=True,
+            block_size=65536,
+            checksum=True,
+        )
+
+        data = compressed_file.read_bytes()
+        assert data[4] == 2 and not data[7] & 0x04
+
+    @pytest.mark.parametrize("seekable", [False, True])
+    def test_verify_intact_file(
+        self, multi_block_file: Path, temp_dir: Path, seekable: bool
+    ):
+        """Test that verify_file accepts intact files and writes nothing."""
+        compressed_file = temp_dir / "intact.comp"
+        compress_file(
+            str(multi_block_file),
+            str(compressed_file),
+            "zstd",
+            "balanced",
+            3,
+            seekable=seekable,
+            block_size=65536,
+        )
+
+        assert verify_file(str(compressed_file), threads=2) is None
+        assert sorted(p.name for p in temp_dir.iterdir()) == sorted(
+            [multi_block_file.name, "intact.comp"]
+        )
+
+    def test_verify_detects_corrupt_block(
+        self, multi_block_file: Path, temp_dir: Path
+    ):
+        """Test that verify_file checks every block of a seekable file."""
+        compressed_file = temp_dir / "corrupt.comp"
+        compress_file(
+            str(multi_block_file),
+            str(compressed_file),
+            "zlib",
+            "balanced",
+            6,
+            seekable=True,
+            block_size=65536,
+        )
+
+        data = bytearray(compressed_file.read_bytes())
+        data[40] ^= 0xFF
+        compressed_file.write_bytes(bytes(data))
+
+        with pytest.raises(Error):
+            verify_file(str(compressed_file))
+
+    def test_verify_detects_truncation(self, sample_text_file: Path, temp_dir: Path):
+        """Test that verify_file rejects a file cut short."""
+        compressed_file = temp_dir / "short.comp"
+        compress_file(
+            str(sample_text_file), str(compressed_file), "lzma", "balanced", 6
+        )
+        compressed_file.write_bytes(compressed_file.read_bytes()[:-8])
+
+        with pytest.raises(Error):
+            verify_file(str(compressed_file))
+
+
+class TestCodecParams:
+    """Test long-distance matching and the zstd window/strategy controls."""
+
+    def test_long_distance_finds_far_repeats(self, temp_dir: Path):
+        """Test that LDM matches a repeat beyond level 1's 512 KiB window."""
+        import os
+
+        src = temp_dir / "repeated.bin"
+        src.write_bytes(os.urandom(1 << 20) * 2)
+
+        plain = temp_dir / "plain.comp"
+        tuned = temp_dir / "tuned.comp"
+        compress_file(str(src), str(plain), "zstd", "balanced", 1)
+        compress_file(
+            str(src), str(tuned), "zstd", "balanced", 1, long_distance=True
+        )
+        assert tuned.stat().st_size < plain.stat().st_size * 0.6
+
+        out = temp_dir / "tuned.out"
+        decompress_file(str(tuned), str(out), "")
+        assert out.read_bytes() == src.read_bytes()
+
+    def test_window_log_recorded_and_honoured(
+        self, sample_binary_file: Path, temp_dir: Path
+    ):
+        """Test that a window past the decoder default is in the header."""
+        compressed_file = temp_dir / "wide.comp"
+        compress_file(
+            str(sample_binary_file),
+            str(compressed_file),
+            "zstd",
+            "balanced",
+            3,
+            checksum=True,
+            long_distance=True,
+            window_log=29,
+            match_strategy=5,
+        )
+
+        data = compressed_file.read_bytes()
+        assert data[7] == 0x04 | 0x08
+        assert data[24] == 29  # after the header and the XXH64
+        verify_file(str(compressed_file))
+        out = temp_dir / "wide.out"
+        decompress_file(str(compressed_file), str(out), "")
+        assert out.read_bytes() == sample_binary_file.read_bytes()
+
+    def test_threaded_long_distance_round_trip(
+        self, multi_block_file: Path, temp_dir: Path
+    ):
+        """Test that the tuning also applies to libzstd's own workers."""
+        compressed_file = temp_dir / "mt.comp"
+        out = temp_dir / "mt.out"
+        compress_file(
+            str(multi_block_file),
+            str(compressed_file),
+            "zstd",
+            "balanced",
+            3,
+            threads=4,
+            long_distance=True,
+            window_log=28,
+        )
+
+        assert compressed_file.read_bytes()[4] == 1  # still a single stream
+        decompress_file(str(compressed_file), str(out), "")
+        assert out.read_bytes() == multi_block_file.read_bytes()
+
+    @pytest.mark.parametrize(
+        "algo,kwargs",
+        [
+            ("zstd", {"window_log": 40}),
+            ("zstd", {"window_log": 5}),
+            ("zstd", {"match_strategy": 12}),
+            ("zstd", {"long_distance": True, "seekable": True}),
+            ("zlib", {"long_distance": True}),
+        ],
+    )
+    def test_invalid_params_rejected(
+        self, sample_text_file: Path, temp_dir: Path, algo: str, kwargs: dict
+    ):
+        """Test that out-of-range or unsupported tuning raises ValueError."""
+        with pytest.raises(ValueError):
+            compress_file(
+                str(sample_text_file),
+                str(temp_dir / "bad.comp"),
+                algo,
+                "balanced",
+                3,
+                **kwargs,
+            )
+
+    def test_standalone_zstd_wide_window(
+        self, sample_binary_file: Path, temp_dir: Path
+    ):
+        """Test that a standalone .zst with a 1 GiB window reads back."""
+        from compresso._core import compress_standalone, decompress_standalone
+
+        zst = temp_dir / "wide.zst"
+        compress_standalone(
+            str(sample_binary_file),
+            str(zst),
+            "zstd",
+            3,
+            long_distance=True,
+            window_log=30,
+        )
+        out = temp_dir / "wide.out"
+        decompress_standalone(str(zst), str(out), "zstd")
+        assert out.read_bytes() == sample_binary_file.read_bytes()
+
+        with pytest.raises(ValueError):
+            compress_standalone(
+                str(sample_binary_file),
+                str(temp_dir / "wide.gz"),
+                "gzip",
+                long_distance=True,
+            )
+
+
+class TestKnownSize:
+    """Test that the input size is pledged and drives exact-size decoding."""
+
+    def test_zstd_frame_records_content_size(
+        self, sample_text_file: Path, temp_dir: Path
+    ):
+        """Test that the zstd payload's frame header carries the size."""
+        compressed_file = temp_dir / "sized.comp"
+        compress_file(str(sample_text_file), str(compressed_file), "zstd", "", 3)
+
+        payload = compressed_file.read_bytes()[16:]
+        assert payload[:4] == b"\x28\xb5\x2f\xfd"
+        descriptor = payload[4]
+        assert descriptor >> 6 or descriptor & 0x20  # content size or single segment
+
+    def test_lz4_frame_records_content_size(
+        self, sample_text_file: Path, temp_dir: Path
+    ):
+        """Test that the LZ4 frame payload has its content-size field."""
+        compressed_file = temp_dir / "sized.comp"
+        compress_file(str(sample_text_file), str(compressed_file), "lz4", "", 3)
+
+        payload = compressed_file.read_bytes()[16:]
+        assert payload[:4] == b"\x04\x22\x4d\x18"
+        assert payload[4] & 0x08
+        size = int.from_bytes(payload[6:14], "little")
+        assert size == sample_text_file.stat().st_size
+
+    @pytest.mark.parametrize("algo", ["zstd", "lz4", "zlib"])
+    def test_header_size_mismatch_detected(
+        self, sample_text_file: Path, temp_dir: Path, algo: str
+    ):
+        """Test that a payload not decoding to the header's size raises."""
+        compressed_file = temp_dir / "sized.comp"
+        compress_file(str(sample_text_file), str(compressed_file), algo, "", 3)
+
+        data = bytearray(compressed_file.read_bytes())
+        size = int.from_bytes(data[8:16], "little")
+        data[8:16] = (size + 1).to_bytes(8, "little")
+        compressed_file.write_bytes(bytes(data))
+
+        with pytest.raises(Error):
+            decompress_file(str(compressed_file), str(temp_dir / "bad.out"), "")
+
+
+class TestSparseFiles:
+    """Test that holes and zero runs are skipped on the way in and out."""
+
+    @staticmethod
+    def _sparse_file(path: Path) -> Path:
+        """Write 2MB of data around a 20MB hole, then a trailing hole."""
+        import os
+
+        with open(path, "wb") as f:
+            f.write(os.urandom(1 << 20))
+            f.seek(21 << 20)
+            f.write(b"tail block" * 1000)
+            f.truncate(32 << 20)
+        if path.stat().st_blocks * 512 >= path.stat().st_size:
+            pytest.skip("filesystem has no holes")
+        return path
+
+    @staticmethod
+    def _allocated(path: Path) -> int:
+        return path.stat().st_blocks * 512
+
+    def test_sparse_input_records_holes(self, temp_dir: Path):
+        """Test that a sparse input is written with hole blocks and restored
+        sparse."""
+        src = self._sparse_file(temp_dir / "disk.img")
+        compressed_file = temp_dir / "disk.comp"
+        decompressed_file = temp_dir / "disk.out"
+
+        compress_file(str(src), str(compressed_file), "zstd", "", 3)
+        data = compressed_file.read_bytes()
+        assert data[4] == 2 and data[7] & 0x10
+        assert len(data) < (1 << 20) + 65536
+
+        decompress_file(str(compressed_file), str(decompressed_file), "", threads=2)
+        assert decompressed_file.read_bytes() == src.read_bytes()
+        assert self._allocated(decompressed_file) < 4 << 20
+
+    def test_zero_blocks_become_holes(self, temp_dir: Path):
+        """Test that written-out zeros are stored as holes in seekable files."""
+        import os
+
+        src = temp_dir / "zeros.bin"
+        compressed_file = temp_dir / "zeros.comp"
+        src.write_bytes(os.urandom(65536) + bytes(4 * 65536) + b"end")
+        compress_file(
+            str(src),
+            str(compressed_file),
+            "zlib",
+            "",
+            6,
+            seekable=True,
+            block_size=65536,
+        )
+
+        data = compressed_file.read_bytes()
+        assert data[7] & 0x10
+        assert decompress_range(str(compressed_file), 60000, 100000) == (
+            src.read_bytes()[60000:160000]
+        )
+        verify_file(str(compressed_file))
+
+    def test_one_shot_output_is_punched(self, temp_dir: Path):
+        """Test that zero runs of a single-stream payload become holes."""
+        src = temp_dir / "zeros.bin"
+        compressed_file = temp_dir / "zeros.comp"
+        decompressed_file = temp_dir / "zeros.out"
+        src.write_bytes(b"head" * 1024 + bytes(16 << 20))
+
+        compress_file(str(src), str(compressed_file), "zstd", "", 3)
+        assert compressed_file.read_bytes()[4] == 1
+        decompress_file(str(compressed_file), str(decompressed_file), "")
+
+        assert decompressed_file.read_bytes() == src.read_bytes()
+        if self._allocated(src) > self._allocated(decompressed_file):
+            assert self._allocated(decompressed_file) < 1 << 20
+
+    @pytest.mark.parametrize("fmt", ["tar", "tar.zst", "cdar"])
+    def test_archive_round_trip(self, temp_dir: Path, monkeypatch, fmt: str):
+        """Test that archives keep holes out and extraction puts them back."""
+        from compresso._core import create_archive, extract_archive
+
+        monkeypatch.chdir(temp_dir)  # entries keep the relative source name
+        src = self._sparse_file(Path("disk.img"))
+        archive = temp_dir / f"disk.{fmt}"
+        create_archive(str(archive), fmt, [str(src)])
+        assert archive.stat().st_size < 2 << 20
+
+        for threads in (1, 2):
+            out = temp_dir / f"out-{threads}"
+            extract_archive(str(archive), str(out), threads=threads)
+            restored = out / src.name
+            assert restored.read_bytes() == src.read_bytes()
+            assert self._allocated(restored) < 8 << 20
+
+
+class TestIOChunkSize:
+    """Test the io_chunk_size option of the file-level functions."""
+
+    @pytest.mark.parametrize("algo", ["zlib", "bzip2", "lzma", "zstd", "lz4"])
+    @pytest.mark.parametrize("chunk", [64 * 1024, 16 << 20])
+    def test_round_trip(self, multi_block_file: Path, temp_dir: Path, algo: str, chunk: int):
+        """Test that any chunk size in range round-trips."""
+        compressed_file = temp_dir / "large.comp"
+        decompressed_file = temp_dir / "large.out"
+
+        compress_file(
+            str(multi_block_file),
+            str(compressed_file),
+            algo,
+            "balanced",
+            3,
+            checksum=True,
+            io_chunk_size=chunk,
+        )
+        decompress_file(
+            str(compressed_file), str(decompressed_file), "", io_chunk_size=chunk
+        )
+        verify_file(str(compressed_file), io_chunk_size=chunk)
+
+        assert decompressed_file.read_bytes() == multi_block_file.read_bytes()
+
+    @pytest.mark.parametrize("fmt", ["gzip", "bzip2", "xz", "zstd", "lz4"])
+    def test_standalone_round_trip(self, multi_block_file: Path, temp_dir: Path, fmt: str):
+        """Test that the standalone formats honour the chunk size too."""
+        from compresso._core import compress_standalone, decompress_standalone
+
+        compressed_file = temp_dir / "large.std"
+        decompressed_file = temp_dir / "large.out"
+
+        compress_standalone(
+            str(multi_block_file), str(compressed_file), fmt, 3, io_chunk_size=1 << 20
+        )
+        decompress_standalone(
+            str(compressed_file), str(decompressed_file), fmt, io_chunk_size=4 << 20
+        )
+
+        assert decompressed_file.read_bytes() == multi_block_file.read_bytes()
+
+    @pytest.mark.parametrize("chunk", [-1, 1, 64 * 1024 - 1, (16 << 20) + 1])
+    def test_out_of_range_rejected(
+        self, sample_text_file: Path, temp_dir: Path, chunk: int
+    ):
+        """Test that chunk sizes outside 64 KiB..16 MiB raise ValueError."""
+        with pytest.raises(ValueError, match="io_chunk_size"):
+            compress_file(
+                str(sample_text_file),
+                str(temp_dir / "x.comp"),
+                "zlib",
+                "balanced",
+                6,
+                io_chunk_size=chunk,
+            )
+
+    def test_setting_is_scoped_to_the_call(self, sample_text_file: Path, temp_dir: Path):
+        """Test that a later call without the option uses the default again."""
+        compressed_file = temp_dir / "a.comp"
+        compress_file(
+            str(sample_text_file),
+            str(compressed_file),
+            "zstd",
+            "balanced",
+            3,
+            io_chunk_size=1 << 20,
+        )
+        compress_file(
+            str(sample_text_file), str(temp_dir / "b.comp"), "zstd", "balanced", 3
+        )
+
+        assert compressed_file.read_bytes() == (temp_dir / "b.comp").read_bytes()
+
+
+class TestIOEngines:
+    """Test the io_engine option of the file-level functions."""
+
+    def test_stdio_always_listed(self):
+        """Test that the blocking engine is available everywhere."""
+        engines = io_engines()
+        assert "stdio" in engines
+        assert "threads" in engines
+        assert set(engines) <= {"stdio", "threads", "uring"}
+
+    @pytest.mark.parametrize("algo", ["zlib", "bzip2", "lzma", "zstd", "lz4", "snappy"])
+    @pytest.mark.parametrize("chunk", [0, 1 << 20])
+    @pytest.mark.parametrize("engine", ["uring", "threads"])
+    def test_engine_round_trip(
+        self,
+        multi_block_file: Path,
+        temp_dir: Path,
+        algo: str,
+        chunk: int,
+        engine: str,
+    ):
+        """Test that overlapped streams match stdio ones byte for byte.
+
+        Where io_uring is unavailable the option falls back to stdio, so
+        this holds either way.
+        """
+        via_stdio = temp_dir / "stdio.comp"
+        via_engine = temp_dir / "engine.comp"
+        decompressed_file = temp_dir / "engine.out"
+
+        for dst, name in ((via_stdio, "stdio"), (via_engine, engine)):
+            compress_file(
+                str(multi_block_file),
+                str(dst),
+                algo,
+                "balanced",
+                1,
+                checksum=True,
+                io_chunk_size=chunk,
+                io_engine=name,
+            )
+        decompress_file(
+            str(via_engine), str(decompressed_file), "", io_engine=engine
+        )
+        verify_file(str(via_engine), io_engine=engine)
+
+        assert via_engine.read_bytes() == via_stdio.read_bytes()
+        assert decompressed_file.read_bytes() == multi_block_file.read_bytes()
+
+    @pytest.mark.parametrize("engine", ["uring", "threads"])
+    def test_engine_detects_truncation(
+        self, sample_text_file: Path, temp_dir: Path, engine: str
+    ):
+        """Test that a cut-short stream still fails on every engine."""
+        compressed_file = temp_dir / "short.comp"
+        compress_file(
+            str(sample_text_file), str(compressed_file), "zstd", "balanced", 3
+        )
+        compressed_file.write_bytes(compressed_file.read_bytes()[:-8])
+
+        with pytest.raises(Error):
+            decompress_file(
+                str(compressed_file), str(temp_dir / "short.out"), "", io_engine=engine
+            )
+
+    @pytest.mark.parametrize("fmt", ["gzip", "bzip2", "xz", "zstd", "lz4"])
+    @pytest.mark.parametrize("chunk", [0, 16 << 20])
+    @pytest.mark.parametrize("engine", ["uring", "threads"])
+    def test_standalone_engine_round_trip(
+        self,
+        multi_block_file: Path,
+        temp_dir: Path,
+        fmt: str,
+        chunk: int,
+        engine: str,
+    ):
+        """Test that the standalone formats run on every engine."""
+        from compresso._core import compress_standalone, decompress_standalone
+
+        via_stdio = temp_dir / "stdio.std"
+        via_engine = temp_dir / "engine.std"
+        decompressed_file = temp_dir / "engine.out"
+
+        for dst, name in ((via_stdio, "stdio"), (via_engine, engine)):
+            compress_standalone(
+                str(multi_block_file),
+                str(dst),
+                fmt,
+                1,
+                io_chunk_size=chunk,
+                io_engine=name,
+            )
+        decompress_standalone(
+            str(via_engine),
+            str(decompressed_file),
+            fmt,
+            io_chunk_size=chunk,
+            io_engine=engine,
+        )
+
+        assert via_engine.read_bytes() == via_stdio.read_bytes()
+        assert decompressed_file.read_bytes() == multi_block_file.read_bytes()
+
+    @pytest.mark.parametrize("fmt", ["gzip", "bzip2", "xz", "zstd", "lz4"])
+    def test_standalone_truncation_on_threads(
+        self, sample_text_file: Path, temp_dir: Path, fmt: str
+    ):
+        """Test that a cut-short standalone file fails behind the threads."""
+        from compresso._core import compress_standalone, decompress_standalone
+
+        compressed_file = temp_dir / "short.std"
+        compress_standalone(str(sample_text_file), str(compressed_file), fmt, 1)
+        compressed_file.write_bytes(compressed_file.read_bytes()[:-8])
+
+        with pytest.raises(Error):
+            decompress_standalone(
+                str(compressed_file),
+                str(temp_dir / "short.out"),
+                fmt,
+                io_engine="threads",
+            )
+
+    def test_unknown_engine_rejected(self, sample_text_file: Path, temp_dir: Path):
+        """Test that an unknown engine name raises ValueError."""
+        with pytest.raises(ValueError, match="io_engine"):
+            compress_file(
+                str(sample_text_file),
+                str(temp_dir / "x.comp"),
+                "zlib",
+                "balanced",
+                6,
+                io_engine="aio",
+            )
+
+
+class TestProgress:
+    """Test the Progress counter of the file-level functions."""
+
+    @pytest.mark.parametrize(
+        "options",
+        [
+            {"algo": "zstd"},
+            {"algo": "zlib", "threads": 2},
+            {"algo": "lz4", "seekable": True},
+            {"algo": "bzip2"},
+            {"algo": "", "strategy": "auto"},
+        ],
+    )
+    def test_counts_every_input_byte(
+        self, multi_block_file: Path, temp_dir: Path, options: dict
+    ):
+        """Test that compression and decoding advance the counter fully."""
+        options = dict(options)
+        algo = options.pop("algo")
+        strategy = options.pop("strategy", "balanced")
+        compressed_file = temp_dir / "large.comp"
+
+        progress = Progress()
+        compress_file(
+            str(multi_block_file),
+            str(compressed_file),
+            algo,
+            strategy,
+            1,
+            progress=progress,
+            **options,
+        )
+        assert progress.done == multi_block_file.stat().st_size
+
+        # Decoding counts the compressed bytes consumed, headers aside
+        for run in (
+            lambda p: decompress_file(
+                str(compressed_file), str(temp_dir / "large.out"), "", progress=p
+            ),
+            lambda p: verify_file(str(compressed_file), progress=p),
+        ):
+            progress.reset()
+            run(progress)
+            assert 0 < progress.done <= compressed_file.stat().st_size
+
+    def test_standalone_and_batch(self, sample_text_file: Path, temp_dir: Path):
+        """Test that standalone formats and batches advance the counter."""
+        from compresso._core import compress_standalone
+
+        size = sample_text_file.stat().st_size
+        progress = Progress()
+        compress_standalone(
+            str(sample_text_file), str(temp_dir / "a.gz"), "gzip", progress=progress
+        )
+        assert progress.done == size
+
+        progress.reset()
+        pairs = [(sample_text_file, temp_dir / f"{i}.comp") for i in range(3)]
+        compress_many(pairs, "zstd", "balanced", 3, threads=2, progress=progress)
+        assert progress.done == 3 * size
+
+    def test_polled_from_another_thread(self, multi_block_file: Path, temp_dir: Path):
+        """Test that the counter can be read while the call is running."""
+        import threading
+
+        progress = Progress()
+        seen: list[int] = []
+        worker = threading.Thread(
+            target=compress_file,
+            args=(str(multi_block_file), str(temp_dir / "x.comp"), "lzma", "balanced", 6),
+            kwargs={"progress": progress},
+        )
+        worker.start()
+        while worker.is_alive():
+            seen.append(progress.done)
+            worker.join(timeout=0.01)
+
+        assert seen == sorted(seen)
+        assert progress.done == multi_block_file.stat().st_size
+
+    def test_rejects_other_types(self, sample_text_file: Path, temp_dir: Path):
+        """Test that progress must be a Progress or None."""
+        with pytest.raises(TypeError, match="Progress"):
+            compress_file(
+                str(sample_text_file),
+                str(temp_dir / "x.comp"),
+                "zlib",
+                "balanced",
+                6,
+                progress=0,
+            )
+
+
+class TestCancellation:
+    """Test CancelToken on the file-level and archive functions."""
+
+    @pytest.mark.parametrize(
+        "options",
+        [
+            {"algo": "zstd"},
+            {"algo": "zlib", "threads": 2},
+            {"algo": "lzma", "seekable": True},
+            {"algo": "snappy"},
+            {"algo": "", "strategy": "auto"},
+        ],
+    )
+    def test_cancelled_before_start(
+        self, multi_block_file: Path, temp_dir: Path, options: dict
+    ):
+        """Test that a cancelled token stops compression and removes the output."""
+        options = dict(options)
+        algo = options.pop("algo")
+        strategy = options.pop("strategy", "balanced")
+        dst = temp_dir / "large.comp"
+
+        token = CancelToken()
+        token.cancel()
+        with pytest.raises(CancelledError, match="cancelled"):
+            compress_file(
+                str(multi_block_file), str(dst), algo, strategy, 1, cancel=token, **options
+            )
+        assert not dst.exists()
+
+    def test_cancelled_from_another_thread(self, multi_block_file: Path, temp_dir: Path):
+        """Test that cancel() stops a call already running without the GIL."""
+        import threading
+
+        dst = temp_dir / "large.comp"
+        token = CancelToken()
+        timer = threading.Timer(0.05, token.cancel)
+        timer.start()
+        try:
+            with pytest.raises(CancelledError):
+                # Slow enough that it is still running when the timer fires
+                for _ in range(20):
+                    compress_file(
+                        str(multi_block_file), str(dst), "lzma", "balanced", 9,
+                        cancel=token,
+                    )
+        finally:
+            timer.cancel()
+        assert not dst.exists()
+
+    def test_deadline(self, multi_block_file: Path, temp_dir: Path):
+        """Test that an expired deadline raises its own message."""
+        compressed = temp_dir / "large.comp"
+        compress_file(str(multi_block_file), str(compressed), "zstd", "balanced", 1)
+
+        token = CancelToken(timeout=0)
+        assert token.cancelled and token.expired
+        out = temp_dir / "large.out"
+        for threads in (1, 4):
+            with pytest.raises(CancelledError, match="Deadline exceeded"):
+                decompress_file(
+                    str(compressed), str(out), "", threads=threads, cancel=token
+                )
+            assert not out.exists()
+        with pytest.raises(CancelledError):
+            verify_file(str(compressed), cancel=token)
+
+        token.set_timeout(None)
+        assert not token.cancelled
+        decompress_file(str(compressed), str(out), "", cancel=token)
+        assert out.read_bytes() == multi_block_file.read_bytes()
+
+    def test_unused_token_changes_nothing(self, sample_text_file: Path, temp_dir: Path):
+        """Test that a token that never trips leaves the output as without one."""
+        plain = temp_dir / "plain.comp"
+        tokened = temp_dir / "tokened.comp"
+        compress_file(str(sample_text_file), str(plain), "zstd", "balanced", 3)
+        compress_file(
+            str(sample_text_file), str(tokened), "zstd", "balanced", 3,
+            cancel=CancelToken(timeout=3600),
+        )
+        assert tokened.read_bytes() == plain.read_bytes()
+
+    def test_standalone_and_batch(self, sample_text_file: Path, temp_dir: Path):
+        """Test that standalone formats and batches honour the token."""
+        from compresso._core import compress_standalone
+
+        token = CancelToken()
+        token.cancel()
+        for fmt in ("gzip", "xz", "zstd", "lz4", "bz2"):
+            dst = temp_dir / f"a.{fmt}"
+            with pytest.raises(CancelledError):
+                compress_standalone(str(sample_text_file), str(dst), fmt, cancel=token)
+            assert not dst.exists()
+
+        pairs = [(sample_text_file, temp_dir / f"{i}.comp") for i in range(3)]
+        results = compress_many(pairs, "zstd", "balanced", 3, threads=2, cancel=token)
+        assert all(isinstance(r, CancelledError) for r in results)
+        assert not any(dst.exists() for _, dst in pairs)
+
+    def test_archives(self, sample_text_file: Path, temp_dir: Path):
+        """Test that archive creation and extraction honour the token."""
+        from compresso._core import create_archive, extract_archive
+
+        token = CancelToken()
+        token.cancel()
+        for fmt in ("tar", "tar.zst", "cdar"):
+            archive = temp_dir / f"a.{fmt}"
+            with pytest.raises(CancelledError):
+                create_archive(str(archive), fmt, [str(sample_text_file)], cancel=token)
+            assert not archive.exists()
+
+            create_archive(str(archive), fmt, [str(sample_text_file)])
+            out = temp_dir / f"out-{fmt}"
+            for threads in (1, 2):
+                with pytest.raises(CancelledError):
+                    extract_archive(str(archive), str(out), threads=threads, cancel=token)
+                assert not (out / sample_text_file.name).exists()
+
+    def test_rejects_bad_arguments(self, sample_text_file: Path, temp_dir: Path):
+        """Test that cancel must be a CancelToken and timeouts non-negative."""
+        with pytest.raises(TypeError, match="CancelToken"):
+            compress_file(
+                str(sample_text_file), str(temp_dir / "x.comp"), "zlib", "balanced", 6,
+                cancel=True,
+            )
+        with pytest.raises(ValueError, match="timeout"):
+            CancelToken(timeout=-1)
+        assert issubclass(CancelledError, Error)
+
+
+class TestBatchAPI:
+    """Test compress_many/decompress_many."""
+
+    def test_round_trip_many(self, temp_dir: Path):
+        """Test that every file of a batch round-trips."""
+        sources = []
+        for i in range(12):
+            src = temp_dir / f"f{i}.txt"
+            src.write_bytes(f"file {i} ".encode() * (1000 + 500 * i))
+            sources.append(src)
+
+        pairs = [(src, src.with_suffix(".comp")) for src in sources]
+        assert compress_many(pairs, "zstd", "balanced", 3, threads=4) == [None] * 12
+
+        back = [(dst, dst.with_suffix(".out")) for _, dst in pairs]
+        assert decompress_many(back, threads=0) == [None] * 12
+        for src, (_, out) in zip(sources, back):
+            assert out.read_bytes() == src.read_bytes()
+
+    def test_matches_compress_file(self, sample_text_file: Path, temp_dir: Path):
+        """Test that a batch writes what compress_file writes."""
+        single = temp_dir / "single.comp"
+        batch = temp_dir / "batch.comp"
+        compress_file(str(sample_text_file), str(single), "lz4", "fast", 1, checksum=True)
+        compress_many([(str(sample_text_file), str(batch))], "lz4", "fast", 1, checksum=True)
+
+        assert batch.read_bytes() == single.read_bytes()
+
+    def test_per_file_errors(self, sample_text_file: Path, temp_dir: Path):
+        """Test that a failing file is reported without stopping the rest."""
+        missing = temp_dir / "missing.txt"
+        compressed = temp_dir / "ok.comp"
+        results = compress_many(
+            [(missing, temp_dir / "missing.comp"), (sample_text_file, compressed)],
+            "zlib",
+            "balanced",
+            6,
+            threads=2,
+        )
+
+        assert isinstance(results[0], OSError)
+        assert results[1] is None
+
+        corrupt = temp_dir / "corrupt.comp"
+        corrupt.write_bytes(b"COMP" + b"\x00" * 60)
+        results = decompress_many(
+            [(corrupt, temp_dir / "corrupt.out"), (compressed, temp_dir / "ok.out")]
+        )
+
+        assert isinstance(results[0], Error)
+        assert results[1] is None
+        assert (temp_dir / "ok.out").read_bytes() == sample_text_file.read_bytes()
+
+    def test_empty_batch(self):
+        """Test that an empty batch returns an empty list."""
+        assert compress_many([], "zlib", "balanced", 6) == []
+        assert decompress_many([]) == []
+
+    def test_bad_pairs_rejected(self, sample_text_file: Path):
+        """Test that entries other than (src, dst) tuples raise TypeError."""
+        with pytest.raises(TypeError):
+            compress_many([(str(sample_text_file),)], "zlib", "balanced", 6)
+        with pytest.raises(TypeError):
+            decompress_many(None)
+
+    def test_negative_threads_rejected(self):
+        """Test that a negative worker count raises ValueError."""
+        with pytest.raises(ValueError, match="threads"):
+            compress_many([], "zlib", "balanced", 6, threads=-1)
+
+
+class TestInMemoryAPI:
+    """Test compress_bytes/decompress_bytes and the *_into variants."""
+
+    DATA = b"Hello, World! " * 1000
+
+    def test_bytes_round_trip(self, compression_algo: str):
+        """Test that every backend round-trips through bytes."""
+        frame = compress_bytes(self.DATA, compression_algo)
+
+        assert frame[:4] == b"COMP"
+        assert decompress_bytes(frame) == self.DATA
+
+    def test_accepts_buffer_protocol(self):
+        """Test that bytearray and memoryview inputs are accepted."""
+        frame = compress_bytes(memoryview(bytearray(self.DATA)), "zstd")
+
+        assert decompress_bytes(bytearray(frame)) == self.DATA
+
+    def test_into_round_trip(self, compression_algo: str):
+        """Test compress_into/decompress_into with bound-sized buffers."""
+        out = bytearray(compress_bound(len(self.DATA), compression_algo))
+        written = compress_into(self.DATA, out, compression_algo)
+
+        restored = bytearray(len(self.DATA))
+        size = decompress_into(memoryview(out)[:written], restored)
+
+        assert size == len(self.DATA)
+        assert restored == self.DATA
+
+    def test_frame_matches_file_format(self, temp_dir: Path):
+        """Test that a frame written to disk decompresses as a file."""
+        compressed_file = temp_dir / "frame.comp"
+        decompressed_file = temp_dir / "frame.out"
+        compressed_file.write_bytes(compress_bytes(self.DATA, "lz4"))
+
+        decompress_file(str(compressed_file), str(decompressed_file), "")
+
+        assert decompressed_file.read_bytes() == self.DATA
+
+    def test_output_buffer_too_small(self):
+        """Test that undersized output buffers raise ValueError."""
+        with pytest.raises(ValueError):
+            compress_into(self.DATA, bytearray(8), "zlib")
+
+        with pytest.raises(ValueError):
+            decompress_into(compress_bytes(self.DATA, "zlib"), bytearray(10))
+
+    def test_read_only_output_rejected(self):
+        """Test that a read-only output buffer raises TypeError."""
+        with pytest.raises(TypeError):
+            compress_into(self.DATA, bytes(100000), "zlib")
+
+    def test_invalid_frame(self):
+        """Test that truncated or foreign data raises HeaderError."""
+        with pytest.raises(HeaderError):
+            decompress_bytes(b"COMP")
+
+        with pytest.raises(HeaderError):
+            decompress_bytes(b"not a frame at all")
+
+    def test_incompressible_frame_is_stored(self):
+        """Test that data no backend can shrink is framed as-is."""
+        import os
+
+        payload = os.urandom(4096)
+        frame = compress_bytes(payload, "zlib")
+
+        assert len(frame) == 16 + len(payload)
+        assert frame[5] == 0 and frame[16:] == payload
+        assert decompress_bytes(frame) == payload
+        assert decompress_bytes(frame, "zstd") == payload
+
+    def test_empty_input_rejected(self):
+        """Test that empty input raises ValueError, like an empty file."""
+        with pytest.raises(ValueError):
+            compress_bytes(b"", "zlib")
+
+
+class TestContextObjects:
+    """Test reusable Compressor/Decompressor contexts."""
+
+    DATA = b"Hello, World! " * 1000
+
+    def test_reuse_round_trip(self, compression_algo: str):
+        """Test that one context pair handles many frames."""
+        compressor = Compressor(compression_algo, level=3)
+        decompressor = Decompressor()
+
+        for i in range(20):
+            payload = self.DATA + bytes([i])
+            assert decompressor.decompress(compressor.compress(payload)) == payload
+
+        assert compressor.algo == compression_algo
+        assert decompressor.algo == compression_algo
+
+    def test_frames_interoperate(self):
+        """Test that context frames match the module-level functions."""
+        frame = Compressor("zstd").compress(self.DATA)
+
+        assert decompress_bytes(frame) == self.DATA
+        assert Decompressor().decompress(compress_bytes(self.DATA, "lz4")) == (
+            self.DATA
+        )
+
+    def test_into_variants(self):
+        """Test compress_into/decompress_into on context objects."""
+        out = bytearray(compress_bound(len(self.DATA), "zlib"))
+        written = Compressor("zlib").compress_into(self.DATA, out)
+
+        restored = bytearray(len(self.DATA))
+        assert Decompressor("zlib").decompress_into(out[:written], restored) == len(
+            self.DATA
+        )
+        assert restored == self.DATA
+
+    def test_decompressor_switches_backend(self):
+        """Test that an unbound Decompressor follows each frame's algorithm."""
+        decompressor = Decompressor()
+
+        for algo in ("zstd", "zlib", "zstd"):
+            frame = compress_bytes(self.DATA, algo)
+            assert decompressor.decompress(frame) == self.DATA
+            assert decompressor.algo == algo
+
+    def test_invalid_algorithm(self):
+        """Test that unknown algorithms raise ValueError."""
+        with pytest.raises(ValueError):
+            Compressor("nope")
+
+        with pytest.raises(ValueError):
+            Decompressor("nope")
+
+
+class TestStreamObjects:
+    """Test incremental CompressorStream/DecompressorStream."""
+
+    DATA = b"Hello, World! " * 20000
+
+    @staticmethod
+    def chunks(data: bytes, size: int):
+        return [data[i : i + size] for i in range(0, len(data), size)]
+
+    def test_chunked_round_trip(self, compression_algo: str):
+        """Test that every backend round-trips through many small feeds."""
+        compressor = CompressorStream(compression_algo)
+        compressed = b"".join(compressor.feed(c) for c in self.chunks(self.DATA, 7001))
+        compressed += compressor.finish()
+
+        decompressor = DecompressorStream(compression_algo)
+        restored = b"".join(
+            decompressor.feed(c) for c in self.chunks(compressed, 997)
+        )
+        restored += decompressor.finish()
+
+        assert compressor.finished
+        assert decompressor.eof
+        assert restored == self.DATA
+
+    def test_matches_file_payload(self, temp_dir: Path):
+        """Test that a file's payload decodes as a stream."""
+        input_file = temp_dir / "stream.txt"
+        compressed_file = temp_dir / "stream.comp"
+        input_file.write_bytes(self.DATA)
+        compress_file(str(input_file), str(compressed_file), "zlib", "balanced", 6)
+
+        decompressor = DecompressorStream("zlib")
+        restored = decompressor.feed(compressed_file.read_bytes()[16:])
+
+        assert restored + decompressor.finish() == self.DATA
+
+    def test_flush_makes_output_decodable(self, compression_algo: str):
+        """Test that flush() emits everything fed so far."""
+        if compression_algo == "bzip2":
+            pytest.skip("bzip2 decoders hold a block until the next one begins")
+
+        compressor = CompressorStream(compression_algo)
+        partial = compressor.feed(self.DATA[:5000]) + compressor.flush()
+
+        decompressor = DecompressorStream(compression_algo)
+        assert decompressor.feed(partial) == self.DATA[:5000]
+
+    def test_truncated_stream_detected(self):
+        """Test that finish() rejects a stream cut short."""
+        compressor = CompressorStream("zstd")
+        compressed = compressor.feed(self.DATA) + compressor.finish()
+
+        decompressor = DecompressorStream("zstd")
+        decompressor.feed(compressed[:-10])
+        assert not decompressor.eof
+        with pytest.raises(Error):
+            decompressor.finish()
+
+    def test_feed_after_finish_rejected(self):
+        """Test that a finished compressor refuses more input."""
+        compressor = CompressorStream("lz4")
+        compressor.feed(self.DATA)
+        compressor.finish()
+
+        with pytest.raises(Error):
+            compressor.feed(b"more")
+
+    def test_decompressor_requires_algorithm(self):
+        """Test that raw streams need an explicit, known backend."""
+        with pytest.raises(TypeError):
+            DecompressorStream()
+
+        with pytest.raises(ValueError):
+            DecompressorStream("nope")
+
+
+class TestDictionaries:
+    """Test trained dictionaries across the buffer, file and stream APIs."""
+
+    RECORD = b'{"id": 5000, "user": "user53", "email": "user53@example.com"}'
+
+    @pytest.mark.parametrize("algo", ["zstd", "lz4"])
+    def test_bytes_round_trip(self, trained_dictionary: Dictionary, algo: str):
+        """Test that small records shrink with a dictionary and round-trip."""
+        frame = compress_bytes(self.RECORD, algo, dictionary=trained_dictionary)
+
+        assert frame[8] & 0x01
+        assert len(frame) < len(compress_bytes(self.RECORD, algo))
+        assert decompress_bytes(frame, dictionary=trained_dictionary) == self.RECORD
+
+    @pytest.mark.parametrize("algo", ["zstd", "lz4"])
+    def test_file_round_trip(
+        self,
+        trained_dictionary: Dictionary,
+        dictionary_samples: list[bytes],
+        algo: str,
+        temp_dir: Path,
+    ):
+        """Test that files compressed with a dictionary need it to decompress."""
+        input_file = temp_dir / "records.json"
+        compressed_file = temp_dir / "records.comp"
+        decompressed_file = temp_dir / "records.out"
+        input_file.write_bytes(b"\n".join(dictionary_samples))
+
+        compress_file(
+            str(input_file),
+            str(compressed_file),
+            algo,
+            "balanced",
+            3,
+            dictionary=trained_dictionary,
+        )
+        decompress_file(
+            str(compressed_file),
+            str(decompressed_file),
+            "",
+            dictionary=trained_dictionary,
+        )
+
+        assert decompressed_file.read_bytes() == input_file.read_bytes()
+
+    def test_missing_or_wrong_dictionary(
+        self, trained_dictionary: Dictionary, dictionary_samples: list[bytes]
+    ):
+        """Test that the header names the dictionary the data needs."""
+        frame = compress_bytes(self.RECORD, "zstd", dictionary=trained_dictionary)
+        other = train_dictionary(dictionary_samples[::2], size=2048)
+
+        with pytest.raises(HeaderError):
+            decompress_bytes(frame)
+
+        with pytest.raises(HeaderError):
+            decompress_bytes(frame, dictionary=other)
+
+    def test_dictionary_id_is_stable(self, trained_dictionary: Dictionary):
+        """Test that a reloaded dictionary keeps its ID."""
+        reloaded = Dictionary(trained_dictionary.data)
+
+        assert reloaded.id == trained_dictionary.id
+        frame = compress_bytes(self.RECORD, "zstd", dictionary=trained_dictionary)
+        assert decompress_bytes(frame, dictionary=reloaded) == self.RECORD
+
+    def test_context_and_stream_objects(self, trained_dictionary: Dictionary):
+        """Test that the reusable objects accept a dictionary."""
+        compressor = Compressor("zstd", dictionary=trained_dictionary)
+        decompressor = Decompressor(dictionary=trained_dictionary)
+        assert decompressor.decompress(compressor.compress(self.RECORD)) == self.RECORD
+
+        stream = CompressorStream("zstd", dictionary=trained_dictionary)
+        compressed = stream.feed(self.RECORD) + stream.finish()
+        restored = DecompressorStream("zstd", dictionary=trained_dictionary)
+        assert restored.feed(compressed) + restored.finish() == self.RECORD
+
+    def test_unsupported_backend_rejected(self, trained_dictionary: Dictionary):
+        """Test that backends without dictionary support raise ValueError."""
+        with pytest.raises(ValueError):
+            compress_bytes(self.RECORD, "bzip2", dictionary=trained_dictionary)
+
+        with pytest.raises(TypeError):
+            compress_bytes(self.RECORD, "zstd", dictionary=b"raw bytes")
+
+
+class TestBudgetStrategies:
+    """Test the throughput and latency budget strategies."""
+
+    @pytest.mark.parametrize(
+        "strategy,level",
+        [("target_mb_s=100", 3), ("target_mb_s=2", 9), ("target_mb_s=500", 1)],
+    )
+    def test_throughput_picks_best_ratio(
+        self, budget_calibration: list[dict], strategy: str, level: int
+    ):
+        """Test that the best ratio meeting the throughput is chosen."""
+        choice = choose_for_budget(strategy, 100 * 1024 * 1024, threads=1)
+
+        assert choice["level"] == level
+        assert choice["threads"] == 1
+        assert choice["meets_budget"] is True
+
+    def test_latency_budget(self, budget_calibration: list[dict]):
+        """Test that a time budget scales with the input size."""
+        size = 10 * 1024 * 1024
+
+        assert choose_for_budget("max_ratio_within=5s", size, 1)["level"] == 9
+        assert choose_for_budget("max_ratio_within=1", size, 1)["level"] == 3
+        choice = choose_for_budget("max_ratio_within=20ms", size, 1)
+        assert choice["algo"] == "lz4"
+        assert choice["estimated_seconds"] == pytest.approx(10 / 900)
+
+    def test_unmet_budget_falls_back_to_fastest(self, budget_calibration: list[dict]):
+        """Test that an impossible budget returns the fastest option."""
+        choice = choose_for_budget("target_mb_s=5000", 1024 * 1024, threads=1)
+
+        assert choice["algo"] == "lz4"
+        assert choice["meets_budget"] is False
+
+    def test_threads_need_cpus_and_blocks(self, budget_calibration: list[dict]):
+        """Test that multi-threaded entries need the allowance and the input."""
+        large = 64 * 1024 * 1024
+
+        assert choose_for_budget("target_mb_s=500", large, 1)["algo"] == "lz4"
+        choice = choose_for_budget("target_mb_s=500", large, threads=4)
+        assert (choice["algo"], choice["level"], choice["threads"]) == ("zstd", 6, 4)
+
+        # One 4 MiB block keeps three of the four threads idle
+        small = choose_for_budget("target_mb_s=500", 4 * 1024 * 1024, threads=4)
+        assert small["algo"] == "lz4"
+
+    def test_compress_file_uses_choice(
+        self, budget_calibration: list[dict], temp_dir: Path, sample_text_file: Path
+    ):
+        """Test that compress_file compresses with the chosen backend and level."""
+        dst = temp_dir / "input.comp"
+        out = temp_dir / "output.txt"
+
+        compress_file(str(sample_text_file), str(dst), "", "target_mb_s=500", -1)
+        assert inspect_file(dst).algo_name == "lz4"
+
+        compress_file(str(sample_text_file), str(dst), "", "target_mb_s=100", -1)
+        result = inspect_file(dst)
+        assert (result.algo_name, result.level) == ("zstd", 3)
+        decompress_file(str(dst), str(out), "")
+        assert out.read_bytes() == sample_text_file.read_bytes()
+
+    def test_explicit_algo_wins(
+        self, budget_calibration: list[dict], sample_text_file: Path
+    ):
+        """Test that an explicit algorithm ignores the budget's choice."""
+        data = sample_text_file.read_bytes()
+        frame = compress_bytes(data, "zlib", "target_mb_s=500")
+
+        assert decompress_bytes(frame, "zlib") == data
+
+    @pytest.mark.parametrize(
+        "strategy",
+        ["target_mb_s=", "target_mb_s=-1", "target_mb_s=5x", "max_ratio_within=2h"],
+    )
+    def test_malformed_budget_rejected(
+        self, budget_calibration: list[dict], strategy: str, temp_dir: Path
+    ):
+        """Test that malformed budgets raise ValueError."""
+        with pytest.raises(ValueError):
+            compress_bytes(b"data", strategy=strategy)
+
+        with pytest.raises(ValueError):
+            choose_for_budget(strategy, 1024)
+
+        src = temp_dir / "input.bin"
+        src.write_bytes(b"data")
+        with pytest.raises(ValueError):
+            compress_file(str(src), str(temp_dir / "out.comp"), "", strategy, -1)
+
+    def test_calibration_round_trip(self, budget_calibration: list[dict]):
+        """Test that set_calibration fills in defaults and validates entries."""
+        table = get_calibration()
+
+        assert len(table) == len(budget_calibration)
+        assert table[0]["threads"] == 1 and table[0]["decomp_mb_s"] == 0.0
+
+        for entries in (
+            [{"algo": "nope", "comp_mb_s": 1.0, "ratio": 0.5}],
+            [{"algo": "zstd", "comp_mb_s": 0.0, "ratio": 0.5}],
+            [{"algo": "zstd", "comp_mb_s": 1.0, "ratio": 0.5, "threads": 0}],
+        ):
+            with pytest.raises(ValueError):
+                set_calibration(entries)
+
+        with pytest.raises(TypeError):
+            set_calibration([("zstd", 1.0)])
+
+        # A rejected table leaves the previous one in place
+        assert get_calibration() == table
+
+        set_calibration([])
+        assert {e["algo"] for e in get_calibration()} >= {"zlib", "lz4"}
+
+
+class TestStats:
+    """Test the native counters and per-call stats."""
+
+    def test_call_stats(self, temp_dir: Path, sample_text_file: Path):
+        """Test that a stats dict receives the call's timings and sizes."""
+        dst = temp_dir / "input.comp"
+        out = temp_dir / "output.txt"
+        comp: dict = {}
+        decomp: dict = {}
+
+        compress_file(str(sample_text_file), str(dst), "zstd", stats=comp)
+        decompress_file(str(dst), str(out), "", stats=decomp)
+
+        assert comp["bytes_in"] == sample_text_file.stat().st_size
+        assert comp["bytes_out"] == dst.stat().st_size
+        assert decomp["bytes_out"] == out.stat().st_size
+        for stats in (comp, decomp):
+            assert stats["wall_ns"] > 0
+            assert stats["codec_ns"] + stats["read_ns"] + stats["write_ns"] == (
+                stats["wall_ns"]
+            )
+
+    def test_counters_by_backend_and_format(
+        self, temp_dir: Path, sample_text_file: Path
+    ):
+        """Test that backend and format counters follow the calls made."""
+        reset_stats()
+        dst = temp_dir / "input.comp"
+
+        compress_file(str(sample_text_file), str(dst), "zlib")
+        compress_file(str(sample_text_file), str(dst), "zlib", seekable=True)
+        compress_bytes(b"x" * 1000, "lz4")
+        stats = get_stats()
+
+        zlib = stats["backends"]["zlib"]["compress"]
+        assert zlib["calls"] >= 2
+        assert zlib["bytes_in"] == 2 * sample_text_file.stat().st_size
+        assert zlib["codec_ns"] > 0 and zlib["contexts"] >= 1
+        assert stats["backends"]["lz4"]["compress"]["bytes_in"] == 1000
+
+        fmt = stats["formats"]["compresso"]["compress"]
+        assert (fmt["calls"], fmt["errors"]) == (2, 0)
+        assert fmt["wall_ns"] >= fmt["codec_ns"]
+        assert stats["io"]["read_bytes"] > 0
+        assert stats["memory"]["peak_buffer_bytes"] > 0
+
+    def test_failures_count_as_errors(self, temp_dir: Path):
+        """Test that a failed file call is counted as an error."""
+        reset_stats()
+        src = temp_dir / "bad.comp"
+        src.write_bytes(b"COMP" + b"\xff" * 60)
+
+        with pytest.raises(Error):
+            decompress_file(str(src), str(temp_dir / "out"), "")
+
+        fmt = get_stats()["formats"]["compresso"]["decompress"]
+        assert (fmt["calls"], fmt["errors"], fmt["bytes_out"]) == (1, 1, 0)
+
+    def test_reset(self):
+        """Test that reset_stats zeroes every counter."""
+        compress_bytes(b"data" * 100, "zlib")
+        reset_stats()
+        stats = get_stats()
+
+        for backend in stats["backends"].values():
+            assert backend["compress"]["calls"] == 0
+        assert stats["io"]["reads"] == 0
+        assert stats["memory"]["peak_buffer_bytes"] == (
+            stats["memory"]["buffer_bytes"]
+        )
+
+    def test_stats_must_be_dict(self, temp_dir: Path, sample_text_file: Path):
+        """Test that a stats argument other than a dict raises TypeError."""
+        with pytest.raises(TypeError):
+            compress_file(
+                str(sample_text_file), str(temp_dir / "o"), "zlib", stats=[]
+            )
+
+
+class TestConvertArchive:
+    """Test single-pass archive conversion."""
+
+    @staticmethod
+    def _tree(root: Path) -> Path:
+        src = root / "tree"
+        (src / "sub").mkdir(parents=True)
+        (src / "a.txt").write_bytes(b"hello world\n" * 10000)
+        (src / "sub" / "b.bin").write_bytes(bytes(range(256)) * 1000)
+        (src / "empty").write_bytes(b"")
+        return src
+
+    @staticmethod
+    def _assert_same_tree(src: Path, restored: Path):
+        files = sorted(p.relative_to(src) for p in src.rglob("*"))
+        assert sorted(p.relative_to(restored) for p in restored.rglob("*")) == files
+        for rel in files:
+            if (src / rel).is_file():
+                assert (restored / rel).read_bytes() == (src / rel).read_bytes()
+
+    def test_codec_change_keeps_tar_bytes(self, temp_dir: Path, monkeypatch):
+        """Test that a tar.gz re-compressed as tar.zst holds the same tar."""
+        import gzip
+
+        from compresso._core import convert_archive, create_archive
+
+        monkeypatch.chdir(temp_dir)
+        src = self._tree(Path("."))
+        create_archive("in.tar.gz", "tar.gz", [str(src)])
+
+        convert_archive("in.tar.gz", "out.tar.zst", "tar.zst", threads=2)
+        convert_archive("out.tar.zst", "out.tar", "tar")
+
+        assert Path("out.tar").read_bytes() == gzip.open("in.tar.gz").read()
+
+    @pytest.mark.parametrize(
+        "source,target", [("tar.gz", "cdar"), ("cdar", "tar.xz"), ("tar", "cdar")]
+    )
+    def test_repack_entries(
+        self, temp_dir: Path, monkeypatch, source: str, target: str
+    ):
+        """Test that entries are carried across archive formats intact."""
+        from compresso._core import convert_archive, create_archive, extract_archive
+
+        monkeypatch.chdir(temp_dir)
+        src = self._tree(Path("."))
+        create_archive(f"in.{source}", source, [str(src)])
+
+        convert_archive(f"in.{source}", f"out.{target}", target)
+        extract_archive(f"out.{target}", "restored")
+
+        self._assert_same_tree(src, Path("restored") / src.name)
+
+    def test_rejects_bad_targets(self, temp_dir: Path, sample_text_file: Path):
+        """Test that non-archive targets and in-place conversion fail."""
+        from compresso._core import convert_archive, create_archive
+
+        archive = temp_dir / "in.cdar"
+        create_archive(str(archive), "cdar", [str(sample_text_file)])
+
+        with pytest.raises(ValueError, match="Unknown archive format"):
+            convert_archive(str(archive), str(temp_dir / "out.zst"), "zstd")
+        with pytest.raises(ValueError, match="onto itself"):
+            convert_archive(str(archive), str(archive), "cdar")
+
+    def test_cancel(self, temp_dir: Path, sample_text_file: Path):
+        """Test that a tripped token stops conversion and drops the output."""
+        from compresso._core import convert_archive, create_archive
+
+        archive = temp_dir / "in.tar.gz"
+        create_archive(str(archive), "tar.gz", [str(sample_text_file)])
+        token = CancelToken()
+        token.cancel()
+
+        for fmt in ("tar.zst", "cdar"):
+            out = temp_dir / f"out.{fmt}"
+            with pytest.raises(CancelledError):
+                convert_archive(str(archive), str(out), fmt, cancel=token)
+            assert not out.exists()
+
+
+class TestAsyncQueue:
+    """Test the native completion queue behind the awaitable API."""
+
+    def test_completions_wake_the_descriptor(self, tmp_path):
+        """Finished calls make fileno() readable and come back by ticket."""
+        import select
+
+        from compresso._core import AsyncQueue
+
+        src = tmp_path / "data"
+        src.write_bytes(b"queued " * 10000)
+        queue = AsyncQueue(threads=2)
+        tickets = {
+            queue.submit(
+                compress_file,
+                src_path=str(src),
+                dst_path=str(tmp_path / f"{i}.comp"),
+                algo="zstd",
+            ): i
+            for i in range(8)
+        }
+        queue.submit(compress_file, src_path=str(tmp_path / "missing"), dst_path="x")
+        assert queue.pending == 9
+
+        outcomes = []
+        while len(outcomes) < 9:
+            readable, _, _ = select.select([queue.fileno()], [], [], 10)
+            assert readable
+            outcomes.extend(queue.completed())
+
+        assert queue.pending == 0
+        errors = {ticket: error for ticket, _, error in outcomes}
+        assert all(errors[t] is None for t in tickets)
+        assert isinstance(errors[max(errors)], OSError)
+        assert queue.completed() == []
+        queue.close()
+        with pytest.raises(RuntimeError):
+            queue.submit(compress_file, src_path=str(src), dst_path="y")